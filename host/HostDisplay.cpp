@@ -0,0 +1,101 @@
+//----------------------------------------------
+// Host stand-in for the display and controller
+// The display keeps the frame buffer it was last given for hostGetDisplayedFrame() and
+// passes every one to the hostSetDisplayCallback() callback,
+// the controller reports whatever buttons hostSetButtons() pressed
+//-----------------------------------------------
+
+#include <psp2/display.h>
+#include <psp2/ctrl.h>
+#include <psp2/kernel/processmgr.h>
+
+#include "HostPlatform.h"
+
+#include <string.h>
+
+#include <atomic>
+#include <mutex>
+
+static std::mutex _displayMutex;
+static SceDisplayFrameBuf _displayedFrame;
+static HostDisplayCallback _displayCallback = nullptr;
+static void* _displayCallbackData = nullptr;
+static std::atomic<unsigned int> _buttons(0);
+
+/*----- Display -----*/
+
+int sceDisplaySetFrameBuf(const SceDisplayFrameBuf *pParam, SceDisplaySetBufSync sync)
+{
+	(void)sync;
+	if (pParam == nullptr || pParam->size != sizeof(SceDisplayFrameBuf) || pParam->pitch < pParam->width)
+		return -1;
+
+	HostDisplayCallback callback;
+	void* userData;
+	{
+		std::lock_guard<std::mutex> lock(_displayMutex);
+		_displayedFrame = *pParam;
+		callback = _displayCallback;
+		userData = _displayCallbackData;
+	}
+	//outside the lock, the callback may well look at the displayed frame
+	if (callback != nullptr)
+		callback(pParam, userData);
+	return 0;
+}
+
+int sceDisplayWaitVblankStart(void)
+{
+	return 0;
+}
+
+int sceDisplayWaitVblankStartMulti(unsigned int vcount)
+{
+	(void)vcount;
+	return 0;
+}
+
+void hostGetDisplayedFrame(SceDisplayFrameBuf* frame)
+{
+	std::lock_guard<std::mutex> lock(_displayMutex);
+	*frame = _displayedFrame;
+}
+
+void hostSetDisplayCallback(HostDisplayCallback callback, void* userData)
+{
+	std::lock_guard<std::mutex> lock(_displayMutex);
+	_displayCallback = callback;
+	_displayCallbackData = userData;
+}
+
+/*----- Controller -----*/
+
+int sceCtrlSetSamplingMode(int mode)
+{
+	//returns the previous mode on the Vita, the stand-in is always analog
+	(void)mode;
+	return SCE_CTRL_MODE_ANALOG;
+}
+
+int sceCtrlPeekBufferPositive(int port, SceCtrlData *pad_data, int count)
+{
+	if (port != 0 || pad_data == nullptr || count < 1)
+		return -1;
+
+	for (int i = 0; i < count; i++)
+	{
+		memset(&pad_data[i], 0, sizeof(SceCtrlData));
+		pad_data[i].timeStamp = sceKernelGetProcessTimeWide();
+		pad_data[i].buttons = _buttons.load();
+		pad_data[i].lx = 128;
+		pad_data[i].ly = 128;
+		pad_data[i].rx = 128;
+		pad_data[i].ry = 128;
+	}
+	return count;
+}
+
+void hostSetButtons(unsigned int buttons)
+{
+	_buttons.store(buttons);
+}
@@ -0,0 +1,1095 @@
+//----------------------------------------------
+// Host stand-in for libgxm
+// Keeps the state a context is given and checks it the way the GPU would need it. Scenes are
+// only rasterized when hostSetRasterizer() turned the software rasterizer on (HostRaster.cpp),
+// either way a scene is complete the moment it ends: its notifications are written and the
+// display queue callback runs on the thread that queued the frame.
+// The shader patcher makes its objects with the host allocation callbacks it was given and
+// shares identical programs the way the real one does
+//-----------------------------------------------
+
+#include <psp2/gxm.h>
+
+#include "HostPlatform.h"
+#include "HostRaster.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <mutex>
+#include <new>
+#include <vector>
+
+//Default uniform buffers start on 16 bytes in the rings
+#define ALIGN_UNIFORMS(size)	(((size) + 15) & ~15)
+
+/*----- Opaque types -----*/
+
+struct SceGxmSyncObject
+{
+	unsigned int lastFrame;
+};
+
+struct SceGxmRenderTarget
+{
+	SceGxmRenderTargetParams params;
+};
+
+struct SceGxmRegisteredProgram
+{
+	const SceGxmProgram* program;
+	unsigned int users;				//vertex and fragment programs made from it
+};
+
+struct SceGxmVertexProgram
+{
+	SceGxmShaderPatcherId programId;
+	unsigned int attributeCount;
+	SceGxmVertexAttribute attributes[SCE_GXM_MAX_VERTEX_ATTRIBUTES];
+	unsigned int streamCount;
+	SceGxmVertexStream streams[SCE_GXM_MAX_VERTEX_STREAMS];
+	unsigned int refCount;
+};
+
+struct SceGxmFragmentProgram
+{
+	SceGxmShaderPatcherId programId;
+	SceGxmOutputRegisterFormat outputFormat;
+	SceGxmMultisampleMode multisampleMode;
+	bool blendEnabled;
+	SceGxmBlendInfo blendInfo;
+	const SceGxmProgram* vertexProgram;
+	unsigned int refCount;
+};
+
+struct SceGxmShaderPatcher
+{
+	SceGxmShaderPatcherParams params;
+	std::vector<SceGxmRegisteredProgram*>* registered;
+	std::vector<SceGxmVertexProgram*>* vertexPrograms;
+	std::vector<SceGxmFragmentProgram*>* fragmentPrograms;
+};
+
+//A uniform ring carved out of the context's ring buffer memory, like the GPU's
+typedef struct HostUniformRing
+{
+	uint8_t* base;
+	SceSize size;
+	SceSize offset;
+} HostUniformRing;
+
+struct SceGxmContext
+{
+	SceGxmContextParams params;
+	bool inScene;
+	const SceGxmRenderTarget* renderTarget;
+	SceGxmColorSurface colorSurface;
+	bool hasColorSurface;
+
+	const SceGxmVertexProgram* vertexProgram;
+	const SceGxmFragmentProgram* fragmentProgram;
+	const void* streams[SCE_GXM_MAX_VERTEX_STREAMS];
+	SceGxmTexture textures[SCE_GXM_MAX_TEXTURE_UNITS];
+	bool textureSet[SCE_GXM_MAX_TEXTURE_UNITS];
+	const void* vertexUniformBuffers[SCE_GXM_MAX_UNIFORM_BUFFERS];
+	const void* fragmentUniformBuffers[SCE_GXM_MAX_UNIFORM_BUFFERS];
+	void* vertexDefaultUniforms;
+	void* fragmentDefaultUniforms;
+	HostUniformRing vertexRing;
+	HostUniformRing fragmentRing;
+
+	SceGxmDepthFunc depthFunc;
+	SceGxmDepthWriteMode depthWrite;
+	SceGxmCullMode cullMode;
+	SceGxmRegionClipMode clipMode;
+	unsigned int clip[4];
+	bool viewportSet;
+	float viewport[6];
+
+	HostRasterScene* raster;
+};
+
+/*----- Global state -----*/
+
+typedef struct HostMappedRange
+{
+	const uint8_t* base;
+	SceSize size;
+} HostMappedRange;
+
+static std::mutex _gxmMutex;
+static bool _initialized = false;
+static SceGxmInitializeParams _initParams;
+static volatile unsigned int _notificationRegion[SCE_GXM_NOTIFICATION_COUNT];
+static std::vector<HostMappedRange> _mappedRanges;
+static HostGxmStats _stats;
+
+void hostGetGxmStats(HostGxmStats* stats)
+{
+	std::lock_guard<std::mutex> lock(_gxmMutex);
+	*stats = _stats;
+}
+
+void hostResetGxmStats()
+{
+	std::lock_guard<std::mutex> lock(_gxmMutex);
+	//what is live is still live
+	unsigned int programsLive = _stats.programsLive;
+	unsigned int mappedBytes = _stats.mappedBytes;
+	memset(&_stats, 0, sizeof(HostGxmStats));
+	_stats.programsLive = programsLive;
+	_stats.mappedBytes = mappedBytes;
+}
+
+//True when size bytes at data are inside memory mapped with sceGxmMapMemory()
+static bool isMapped(const void* data, SceSize size)
+{
+	std::lock_guard<std::mutex> lock(_gxmMutex);
+	const uint8_t* start = (const uint8_t*)data;
+	for (size_t i = 0; i < _mappedRanges.size(); i++)
+	{
+		if (start >= _mappedRanges[i].base && start + size <= _mappedRanges[i].base + _mappedRanges[i].size)
+			return true;
+	}
+	return false;
+}
+
+/*----- Initialization and memory -----*/
+
+int sceGxmInitialize(const SceGxmInitializeParams *params)
+{
+	if (_initialized)
+		return SCE_GXM_ERROR_ALREADY_INITIALIZED;
+	if (params == nullptr || params->displayQueueMaxPendingCount == 0)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+
+	_initParams = *params;
+	for (unsigned int i = 0; i < SCE_GXM_NOTIFICATION_COUNT; i++)
+		_notificationRegion[i] = 0;
+	_initialized = true;
+	return 0;
+}
+
+int sceGxmTerminate(void)
+{
+	if (!_initialized)
+		return SCE_GXM_ERROR_UNINITIALIZED;
+	_initialized = false;
+	return 0;
+}
+
+volatile unsigned int *sceGxmGetNotificationRegion(void)
+{
+	return _notificationRegion;
+}
+
+int sceGxmMapMemory(void *base, SceSize size, SceGxmMemoryAttribFlags attr)
+{
+	(void)attr;
+	if (base == nullptr || size == 0)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+
+	std::lock_guard<std::mutex> lock(_gxmMutex);
+	HostMappedRange range;
+	range.base = (const uint8_t*)base;
+	range.size = size;
+	_mappedRanges.push_back(range);
+	_stats.mappedBytes += size;
+	return 0;
+}
+
+int sceGxmUnmapMemory(void *base)
+{
+	std::lock_guard<std::mutex> lock(_gxmMutex);
+	for (size_t i = 0; i < _mappedRanges.size(); i++)
+	{
+		if (_mappedRanges[i].base == base)
+		{
+			_stats.mappedBytes -= _mappedRanges[i].size;
+			_mappedRanges.erase(_mappedRanges.begin() + i);
+			return 0;
+		}
+	}
+	return SCE_GXM_ERROR_INVALID_POINTER;
+}
+
+//USSE memory only ever holds program code, which the stand-in doesn't have
+int sceGxmMapVertexUsseMemory(void *base, SceSize size, unsigned int *offset)
+{
+	if (base == nullptr || size == 0)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	*offset = 0;
+	return 0;
+}
+
+int sceGxmUnmapVertexUsseMemory(void *base)
+{
+	return (base != nullptr) ? 0 : SCE_GXM_ERROR_INVALID_POINTER;
+}
+
+int sceGxmMapFragmentUsseMemory(void *base, SceSize size, unsigned int *offset)
+{
+	if (base == nullptr || size == 0)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	*offset = 0;
+	return 0;
+}
+
+int sceGxmUnmapFragmentUsseMemory(void *base)
+{
+	return (base != nullptr) ? 0 : SCE_GXM_ERROR_INVALID_POINTER;
+}
+
+/*----- Display queue -----*/
+
+int sceGxmDisplayQueueAddEntry(SceGxmSyncObject *oldBuffer, SceGxmSyncObject *newBuffer, const void *callbackData)
+{
+	(void)oldBuffer;
+	if (!_initialized)
+		return SCE_GXM_ERROR_UNINITIALIZED;
+	if (newBuffer == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+
+	//the real queue copies the data too, the caller's copy is usually on its stack
+	std::vector<uint8_t> data((const uint8_t*)callbackData, (const uint8_t*)callbackData + _initParams.displayQueueCallbackDataSize);
+	if (_initParams.displayQueueCallback != nullptr)
+		_initParams.displayQueueCallback(data.empty() ? nullptr : &data[0]);
+	return 0;
+}
+
+int sceGxmDisplayQueueFinish(void)
+{
+	return _initialized ? 0 : SCE_GXM_ERROR_UNINITIALIZED;
+}
+
+int sceGxmSyncObjectCreate(SceGxmSyncObject **syncObject)
+{
+	*syncObject = new SceGxmSyncObject();
+	return 0;
+}
+
+int sceGxmSyncObjectDestroy(SceGxmSyncObject *syncObject)
+{
+	delete syncObject;
+	return 0;
+}
+
+/*----- Contexts and scenes -----*/
+
+int sceGxmCreateContext(const SceGxmContextParams *params, SceGxmContext **context)
+{
+	if (!_initialized)
+		return SCE_GXM_ERROR_UNINITIALIZED;
+	if (params == nullptr || params->hostMem == nullptr || params->hostMemSize < SCE_GXM_MINIMUM_CONTEXT_HOST_MEM_SIZE)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+	if (params->vertexRingBufferMem == nullptr || params->fragmentRingBufferMem == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+
+	SceGxmContext* created = new SceGxmContext();
+	created->params = *params;
+	created->vertexRing.base = (uint8_t*)params->vertexRingBufferMem;
+	created->vertexRing.size = params->vertexRingBufferMemSize;
+	created->fragmentRing.base = (uint8_t*)params->fragmentRingBufferMem;
+	created->fragmentRing.size = params->fragmentRingBufferMemSize;
+	created->depthFunc = SCE_GXM_DEPTH_FUNC_ALWAYS;
+	created->depthWrite = SCE_GXM_DEPTH_WRITE_ENABLED;
+	created->raster = hostRasterCreateScene();
+	*context = created;
+	return 0;
+}
+
+int sceGxmDestroyContext(SceGxmContext *context)
+{
+	if (context == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	if (context->inScene)
+		return SCE_GXM_ERROR_WITHIN_SCENE;
+	hostRasterDestroyScene(context->raster);
+	delete context;
+	return 0;
+}
+
+int sceGxmCreateRenderTarget(const SceGxmRenderTargetParams *params, SceGxmRenderTarget **renderTarget)
+{
+	if (params == nullptr || params->width == 0 || params->height == 0 || params->scenesPerFrame == 0
+		|| params->scenesPerFrame > SCE_GXM_MAX_SCENES_PER_RENDERTARGET)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+
+	SceGxmRenderTarget* created = new SceGxmRenderTarget();
+	created->params = *params;
+	*renderTarget = created;
+	return 0;
+}
+
+int sceGxmDestroyRenderTarget(SceGxmRenderTarget *renderTarget)
+{
+	delete renderTarget;
+	return 0;
+}
+
+int sceGxmGetRenderTargetMemSize(const SceGxmRenderTargetParams *params, unsigned int *driverMemSize)
+{
+	if (params == nullptr || driverMemSize == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+
+	//a tile list per tile and scene plus a fixed overhead, about what the driver asks for
+	unsigned int tilesX = (params->width + SCE_GXM_TILE_SIZEX - 1) / SCE_GXM_TILE_SIZEX;
+	unsigned int tilesY = (params->height + SCE_GXM_TILE_SIZEY - 1) / SCE_GXM_TILE_SIZEY;
+	*driverMemSize = 64 * 1024 + tilesX * tilesY * params->scenesPerFrame * 128;
+	return 0;
+}
+
+int sceGxmBeginScene(SceGxmContext *context, unsigned int flags, const SceGxmRenderTarget *renderTarget, const SceGxmValidRegion *validRegion,
+	SceGxmSyncObject *vertexSyncObject, SceGxmSyncObject *fragmentSyncObject, const SceGxmColorSurface *colorSurface,
+	const SceGxmDepthStencilSurface *depthStencil)
+{
+	(void)flags;
+	(void)vertexSyncObject;
+	(void)fragmentSyncObject;
+	if (context == nullptr || renderTarget == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	if (context->inScene)
+		return SCE_GXM_ERROR_WITHIN_SCENE;
+	if (validRegion != nullptr && (validRegion->xMax >= renderTarget->params.width || validRegion->yMax >= renderTarget->params.height))
+		return SCE_GXM_ERROR_INVALID_VALUE;
+
+	context->inScene = true;
+	context->renderTarget = renderTarget;
+	context->hasColorSurface = (colorSurface != nullptr);
+	if (colorSurface != nullptr)
+		context->colorSurface = *colorSurface;
+	//until one is set the viewport covers the render target, y up
+	if (!context->viewportSet)
+	{
+		float halfWidth = 0.5f * renderTarget->params.width;
+		float halfHeight = 0.5f * renderTarget->params.height;
+		sceGxmSetViewport(context, halfWidth, halfWidth, halfHeight, -halfHeight, 0.5f, 0.5f);
+	}
+	hostRasterBeginScene(context->raster, colorSurface, depthStencil, validRegion);
+
+	std::lock_guard<std::mutex> lock(_gxmMutex);
+	_stats.scenes++;
+	return 0;
+}
+
+int sceGxmEndScene(SceGxmContext *context, const SceGxmNotification *vertexNotification, const SceGxmNotification *fragmentNotification)
+{
+	if (context == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	if (!context->inScene)
+		return SCE_GXM_ERROR_NOT_WITHIN_SCENE;
+	context->inScene = false;
+	hostRasterEndScene(context->raster);
+
+	//the scene is done as soon as it is submitted
+	if (vertexNotification != nullptr)
+		*vertexNotification->address = vertexNotification->value;
+	if (fragmentNotification != nullptr)
+		*fragmentNotification->address = fragmentNotification->value;
+	return 0;
+}
+
+int sceGxmFinish(SceGxmContext *context)
+{
+	return (context != nullptr) ? 0 : SCE_GXM_ERROR_INVALID_POINTER;
+}
+
+int sceGxmPadHeartbeat(const SceGxmColorSurface *displaySurface, SceGxmSyncObject *displaySyncObject)
+{
+	if (displaySurface == nullptr || displaySyncObject == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	return 0;
+}
+
+/*----- State -----*/
+
+void sceGxmSetVertexProgram(SceGxmContext *context, const SceGxmVertexProgram *vertexProgram)
+{
+	context->vertexProgram = vertexProgram;
+}
+
+void sceGxmSetFragmentProgram(SceGxmContext *context, const SceGxmFragmentProgram *fragmentProgram)
+{
+	context->fragmentProgram = fragmentProgram;
+}
+
+//Takes the program's default uniform buffer from the ring, starting over at the front when it runs out
+static int reserveDefaultUniforms(HostUniformRing* ring, const SceGxmProgram* program, void** uniformBuffer)
+{
+	SceSize size = ALIGN_UNIFORMS(sceGxmProgramGetDefaultUniformBufferSize(program));
+	if (size > ring->size)
+		return SCE_GXM_ERROR_RESERVE_FAILED;
+	if (ring->offset + size > ring->size)
+		ring->offset = 0;
+
+	*uniformBuffer = ring->base + ring->offset;
+	ring->offset += size;
+
+	std::lock_guard<std::mutex> lock(_gxmMutex);
+	_stats.uniformReserves++;
+	return 0;
+}
+
+int sceGxmReserveVertexDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer)
+{
+	if (context->vertexProgram == nullptr)
+		return SCE_GXM_ERROR_NULL_PROGRAM;
+	int error = reserveDefaultUniforms(&context->vertexRing, context->vertexProgram->programId->program, uniformBuffer);
+	if (error == 0)
+		context->vertexDefaultUniforms = *uniformBuffer;
+	return error;
+}
+
+int sceGxmReserveFragmentDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer)
+{
+	if (context->fragmentProgram == nullptr)
+		return SCE_GXM_ERROR_NULL_PROGRAM;
+	int error = reserveDefaultUniforms(&context->fragmentRing, context->fragmentProgram->programId->program, uniformBuffer);
+	if (error == 0)
+		context->fragmentDefaultUniforms = *uniformBuffer;
+	return error;
+}
+
+int sceGxmSetVertexUniformBuffer(SceGxmContext *context, unsigned int bufferIndex, const void *bufferData)
+{
+	if (bufferIndex >= SCE_GXM_MAX_UNIFORM_BUFFERS)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+	context->vertexUniformBuffers[bufferIndex] = bufferData;
+	return 0;
+}
+
+int sceGxmSetFragmentUniformBuffer(SceGxmContext *context, unsigned int bufferIndex, const void *bufferData)
+{
+	if (bufferIndex >= SCE_GXM_MAX_UNIFORM_BUFFERS)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+	context->fragmentUniformBuffers[bufferIndex] = bufferData;
+	return 0;
+}
+
+int sceGxmSetVertexStream(SceGxmContext *context, unsigned int streamIndex, const void *streamData)
+{
+	if (streamIndex >= SCE_GXM_MAX_VERTEX_STREAMS)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+	context->streams[streamIndex] = streamData;
+	return 0;
+}
+
+int sceGxmSetFragmentTexture(SceGxmContext *context, unsigned int textureIndex, const SceGxmTexture *texture)
+{
+	if (textureIndex >= SCE_GXM_MAX_TEXTURE_UNITS)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+	if (texture == nullptr || texture->data == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	//the texture control words are copied into the context, the caller's can change afterwards
+	context->textures[textureIndex] = *texture;
+	context->textureSet[textureIndex] = true;
+	return 0;
+}
+
+void sceGxmSetFrontDepthFunc(SceGxmContext *context, SceGxmDepthFunc depthFunc)
+{
+	context->depthFunc = depthFunc;
+}
+
+void sceGxmSetFrontDepthWriteEnable(SceGxmContext *context, SceGxmDepthWriteMode enable)
+{
+	context->depthWrite = enable;
+}
+
+void sceGxmSetCullMode(SceGxmContext *context, SceGxmCullMode mode)
+{
+	context->cullMode = mode;
+}
+
+void sceGxmSetRegionClip(SceGxmContext *context, SceGxmRegionClipMode mode, unsigned int xMin, unsigned int yMin, unsigned int xMax, unsigned int yMax)
+{
+	context->clipMode = mode;
+	context->clip[0] = xMin;
+	context->clip[1] = yMin;
+	context->clip[2] = xMax;
+	context->clip[3] = yMax;
+}
+
+void sceGxmSetViewport(SceGxmContext *context, float xOffset, float xScale, float yOffset, float yScale, float zOffset, float zScale)
+{
+	context->viewport[0] = xOffset;
+	context->viewport[1] = xScale;
+	context->viewport[2] = yOffset;
+	context->viewport[3] = yScale;
+	context->viewport[4] = zOffset;
+	context->viewport[5] = zScale;
+	context->viewportSet = true;
+}
+
+//Largest index in an index buffer, the vertices up to it are what a draw reads
+static unsigned int maxIndex(SceGxmIndexFormat indexType, const void *indexData, unsigned int indexCount)
+{
+	unsigned int largest = 0;
+	for (unsigned int i = 0; i < indexCount; i++)
+	{
+		unsigned int index = (indexType == SCE_GXM_INDEX_FORMAT_U32) ? ((const uint32_t*)indexData)[i] : ((const uint16_t*)indexData)[i];
+		if (index > largest)
+			largest = index;
+	}
+	return largest;
+}
+
+/*	Everything the GPU would read for this draw has to be there and mapped: both programs,
+a scene to draw into, the index buffer and every vertex stream the attributes use, up to the
+largest index, or for instance streams up to the last instance. An instanced draw reads its
+indexWrap indices over and over, indexWrap is indexCount otherwise. Anything missing would
+hang or fault the GPU, here the draw is rejected and counted in HostGxmStats::drawErrors
+*/
+static int validateDraw(SceGxmContext *context, SceGxmIndexFormat indexType, const void *indexData, unsigned int indexCount,
+	unsigned int indexWrap)
+{
+	if (!context->inScene)
+		return SCE_GXM_ERROR_NOT_WITHIN_SCENE;
+	if (context->vertexProgram == nullptr || context->fragmentProgram == nullptr)
+		return SCE_GXM_ERROR_NULL_PROGRAM;
+	if (indexCount == 0)
+		return SCE_GXM_ERROR_INVALID_INDEX_COUNT;
+	if (indexData == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+
+	SceSize indexSize = (indexType == SCE_GXM_INDEX_FORMAT_U32) ? 4 : 2;
+	if (!isMapped(indexData, indexWrap * indexSize))
+		return SCE_GXM_ERROR_INVALID_POINTER;
+
+	const SceGxmVertexProgram* program = context->vertexProgram;
+	unsigned int vertexCount = maxIndex(indexType, indexData, indexWrap) + 1;
+	unsigned int instanceCount = indexCount / indexWrap;
+	for (unsigned int i = 0; i < program->attributeCount; i++)
+	{
+		unsigned int stream = program->attributes[i].streamIndex;
+		if (stream >= program->streamCount || context->streams[stream] == nullptr)
+			return SCE_GXM_ERROR_INVALID_POINTER;
+		bool instanced = program->streams[stream].indexSource == SCE_GXM_INDEX_SOURCE_INSTANCE_16BIT
+			|| program->streams[stream].indexSource == SCE_GXM_INDEX_SOURCE_INSTANCE_32BIT;
+		if (!isMapped(context->streams[stream], (instanced ? instanceCount : vertexCount) * program->streams[stream].stride))
+			return SCE_GXM_ERROR_INVALID_POINTER;
+	}
+
+	//default uniforms have to have been reserved once the program has any
+	if (sceGxmProgramGetDefaultUniformBufferSize(program->programId->program) > 0 && context->vertexDefaultUniforms == nullptr)
+		return SCE_GXM_ERROR_NULL_PROGRAM;
+	//and every uniform buffer it reads bound, in GPU mapped memory
+	const SceGxmProgram* gxp = program->programId->program;
+	for (unsigned int i = 0; i < gxp->parameterCount; i++)
+	{
+		const SceGxmProgramParameter* parameter = &gxp->parameters[i];
+		if (parameter->category != SCE_GXM_PARAMETER_CATEGORY_UNIFORM || parameter->containerIndex >= SCE_GXM_MAX_UNIFORM_BUFFERS)
+			continue;
+		const void* buffer = context->vertexUniformBuffers[parameter->containerIndex];
+		if (buffer == nullptr ||
+			!isMapped(buffer, (parameter->resourceIndex + parameter->componentCount * parameter->arraySize) * sizeof(float)))
+			return SCE_GXM_ERROR_INVALID_POINTER;
+	}
+	return 0;
+}
+
+//Hands a validated draw to the software rasterizer, which ignores it unless it is on
+static void rasterizeDraw(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, const void *indexData,
+	unsigned int indexCount, unsigned int indexWrap)
+{
+	const SceGxmVertexProgram* vertexProgram = context->vertexProgram;
+	const SceGxmFragmentProgram* fragmentProgram = context->fragmentProgram;
+	HostRasterDraw draw;
+	draw.vertexProgram = vertexProgram->programId->program;
+	draw.fragmentProgram = fragmentProgram->programId->program;
+	draw.attributes = vertexProgram->attributes;
+	draw.attributeCount = vertexProgram->attributeCount;
+	draw.streams = vertexProgram->streams;
+	draw.streamData = context->streams;
+	draw.vertexUniforms = context->vertexDefaultUniforms;
+	draw.vertexUniformBuffers = context->vertexUniformBuffers;
+	draw.fragmentUniforms = context->fragmentDefaultUniforms;
+	draw.textures = context->textures;
+	draw.textureSet = context->textureSet;
+	draw.blendEnabled = fragmentProgram->blendEnabled;
+	draw.blendInfo = fragmentProgram->blendInfo;
+	draw.primitive = primType;
+	draw.indexFormat = indexType;
+	draw.indexData = indexData;
+	draw.indexCount = indexCount;
+	draw.indexWrap = indexWrap;
+	draw.cullMode = context->cullMode;
+	draw.depthFunc = context->depthFunc;
+	draw.depthWrite = context->depthWrite;
+	draw.clipMode = context->clipMode;
+	draw.clip = context->clip;
+	draw.viewport = context->viewport;
+	hostRasterDraw(context->raster, &draw);
+}
+
+//sceGxmDraw() is an instanced draw of one instance
+static int submitDraw(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, const void *indexData,
+	unsigned int indexCount, unsigned int indexWrap)
+{
+	int error = validateDraw(context, indexType, indexData, indexCount, indexWrap);
+	if (error == 0)
+		rasterizeDraw(context, primType, indexType, indexData, indexCount, indexWrap);
+
+	std::lock_guard<std::mutex> lock(_gxmMutex);
+	if (error != 0)
+	{
+		_stats.drawErrors++;
+		return error;
+	}
+	_stats.draws++;
+	_stats.indices += indexCount;
+	return 0;
+}
+
+int sceGxmDraw(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, const void *indexData, unsigned int indexCount)
+{
+	return submitDraw(context, primType, indexType, indexData, indexCount, indexCount);
+}
+
+int sceGxmDrawInstanced(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, const void *indexData,
+	unsigned int indexCount, unsigned int indexWrap)
+{
+	if (indexWrap == 0 || (indexCount % indexWrap) != 0)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+	return submitDraw(context, primType, indexType, indexData, indexCount, indexWrap);
+}
+
+/*----- Surfaces -----*/
+
+int sceGxmColorSurfaceInit(SceGxmColorSurface *surface, SceGxmColorFormat colorFormat, SceGxmColorSurfaceType surfaceType,
+	SceGxmColorSurfaceScaleMode scaleMode, SceGxmOutputRegisterSize outputRegisterSize, unsigned int width, unsigned int height,
+	unsigned int strideInPixels, void *data)
+{
+	if (surface == nullptr || data == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	if (width == 0 || height == 0 || strideInPixels < width || (strideInPixels % 32) != 0)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+
+	surface->data = data;
+	surface->format = colorFormat;
+	surface->surfaceType = surfaceType;
+	surface->scaleMode = scaleMode;
+	surface->outputRegisterSize = outputRegisterSize;
+	surface->width = width;
+	surface->height = height;
+	surface->strideInPixels = strideInPixels;
+	return 0;
+}
+
+int sceGxmDepthStencilSurfaceInit(SceGxmDepthStencilSurface *surface, SceGxmDepthStencilFormat depthStencilFormat,
+	SceGxmDepthStencilSurfaceType surfaceType, unsigned int strideInSamples, void *depthData, void *stencilData)
+{
+	if (surface == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	if ((strideInSamples % SCE_GXM_TILE_SIZEX) != 0)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+
+	memset(surface, 0, sizeof(SceGxmDepthStencilSurface));
+	surface->format = depthStencilFormat;
+	surface->surfaceType = surfaceType;
+	surface->strideInSamples = strideInSamples;
+	surface->depthData = depthData;
+	surface->stencilData = stencilData;
+	surface->backgroundDepth = 1.0f;
+	return 0;
+}
+
+int sceGxmDepthStencilSurfaceSetForceLoadMode(SceGxmDepthStencilSurface *surface, SceGxmDepthStencilForceLoadMode forceLoad)
+{
+	surface->forceLoad = forceLoad;
+	return 0;
+}
+
+int sceGxmDepthStencilSurfaceSetForceStoreMode(SceGxmDepthStencilSurface *surface, SceGxmDepthStencilForceStoreMode forceStore)
+{
+	surface->forceStore = forceStore;
+	return 0;
+}
+
+void sceGxmDepthStencilSurfaceSetBackgroundDepth(SceGxmDepthStencilSurface *surface, float backgroundDepth)
+{
+	surface->backgroundDepth = backgroundDepth;
+}
+
+/*----- Textures -----*/
+
+static int textureInit(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat, SceGxmTextureType type,
+	unsigned int width, unsigned int height, unsigned int mipCount)
+{
+	if (texture == nullptr || data == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	if (width == 0 || height == 0 || width > 4096 || height > 4096 || mipCount > 13)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+
+	memset(texture, 0, sizeof(SceGxmTexture));
+	texture->data = data;
+	texture->format = texFormat;
+	texture->type = type;
+	texture->width = (unsigned short)width;
+	texture->height = (unsigned short)height;
+	texture->mipCount = (unsigned char)((mipCount == 0) ? 1 : mipCount);
+	texture->minFilter = SCE_GXM_TEXTURE_FILTER_POINT;
+	texture->magFilter = SCE_GXM_TEXTURE_FILTER_POINT;
+	texture->uAddrMode = SCE_GXM_TEXTURE_ADDR_CLAMP;
+	texture->vAddrMode = SCE_GXM_TEXTURE_ADDR_CLAMP;
+	return 0;
+}
+
+int sceGxmTextureInitLinear(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat, unsigned int width, unsigned int height, unsigned int mipCount)
+{
+	return textureInit(texture, data, texFormat, SCE_GXM_TEXTURE_LINEAR, width, height, mipCount);
+}
+
+int sceGxmTextureInitSwizzled(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat, unsigned int width, unsigned int height, unsigned int mipCount)
+{
+	return textureInit(texture, data, texFormat, SCE_GXM_TEXTURE_SWIZZLED, width, height, mipCount);
+}
+
+int sceGxmTextureSetMinFilter(SceGxmTexture *texture, SceGxmTextureFilter minFilter)
+{
+	texture->minFilter = (unsigned char)minFilter;
+	return 0;
+}
+
+int sceGxmTextureSetMagFilter(SceGxmTexture *texture, SceGxmTextureFilter magFilter)
+{
+	texture->magFilter = (unsigned char)magFilter;
+	return 0;
+}
+
+int sceGxmTextureSetMipFilter(SceGxmTexture *texture, SceGxmTextureMipFilter mipFilter)
+{
+	texture->mipFilter = (unsigned short)mipFilter;
+	return 0;
+}
+
+int sceGxmTextureSetUAddrMode(SceGxmTexture *texture, SceGxmTextureAddrMode mode)
+{
+	texture->uAddrMode = (unsigned char)mode;
+	return 0;
+}
+
+int sceGxmTextureSetVAddrMode(SceGxmTexture *texture, SceGxmTextureAddrMode mode)
+{
+	texture->vAddrMode = (unsigned char)mode;
+	return 0;
+}
+
+int sceGxmTextureSetLodBias(SceGxmTexture *texture, unsigned int bias)
+{
+	if (bias > 63)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+	texture->lodBias = (unsigned char)bias;
+	return 0;
+}
+
+const void *sceGxmTextureGetData(const SceGxmTexture *texture) { return texture->data; }
+SceGxmTextureFormat sceGxmTextureGetFormat(const SceGxmTexture *texture) { return (SceGxmTextureFormat)texture->format; }
+SceGxmTextureType sceGxmTextureGetType(const SceGxmTexture *texture) { return (SceGxmTextureType)texture->type; }
+unsigned int sceGxmTextureGetWidth(const SceGxmTexture *texture) { return texture->width; }
+unsigned int sceGxmTextureGetHeight(const SceGxmTexture *texture) { return texture->height; }
+unsigned int sceGxmTextureGetMipmapCount(const SceGxmTexture *texture) { return texture->mipCount; }
+SceGxmTextureFilter sceGxmTextureGetMinFilter(const SceGxmTexture *texture) { return (SceGxmTextureFilter)texture->minFilter; }
+SceGxmTextureFilter sceGxmTextureGetMagFilter(const SceGxmTexture *texture) { return (SceGxmTextureFilter)texture->magFilter; }
+SceGxmTextureMipFilter sceGxmTextureGetMipFilter(const SceGxmTexture *texture) { return (SceGxmTextureMipFilter)texture->mipFilter; }
+SceGxmTextureAddrMode sceGxmTextureGetUAddrMode(const SceGxmTexture *texture) { return (SceGxmTextureAddrMode)texture->uAddrMode; }
+SceGxmTextureAddrMode sceGxmTextureGetVAddrMode(const SceGxmTexture *texture) { return (SceGxmTextureAddrMode)texture->vAddrMode; }
+unsigned int sceGxmTextureGetLodBias(const SceGxmTexture *texture) { return texture->lodBias; }
+
+/*----- Programs -----*/
+
+int sceGxmProgramCheck(const SceGxmProgram *program)
+{
+	if (program == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	//a real gxp binary fails the magic check, it can't run on the stand-in
+	if (program->magic != HOST_GXM_PROGRAM_MAGIC || program->size != sizeof(SceGxmProgram)
+		|| program->parameterCount > HOST_GXM_MAX_PARAMETERS || program->type > SCE_GXM_FRAGMENT_PROGRAM)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+	return 0;
+}
+
+unsigned int sceGxmProgramGetSize(const SceGxmProgram *program) { return program->size; }
+SceGxmProgramType sceGxmProgramGetType(const SceGxmProgram *program) { return (SceGxmProgramType)program->type; }
+unsigned int sceGxmProgramGetParameterCount(const SceGxmProgram *program) { return program->parameterCount; }
+
+//In bytes, like the real one
+unsigned int sceGxmProgramGetDefaultUniformBufferSize(const SceGxmProgram *program)
+{
+	return program->defaultUniformSize * sizeof(float);
+}
+
+const SceGxmProgramParameter *sceGxmProgramGetParameter(const SceGxmProgram *program, unsigned int index)
+{
+	return (index < program->parameterCount) ? &program->parameters[index] : nullptr;
+}
+
+const SceGxmProgramParameter *sceGxmProgramFindParameterByName(const SceGxmProgram *program, const char *name)
+{
+	for (unsigned int i = 0; i < program->parameterCount; i++)
+	{
+		if (strcmp(program->parameters[i].name, name) == 0)
+			return &program->parameters[i];
+	}
+	return nullptr;
+}
+
+const char *sceGxmProgramParameterGetName(const SceGxmProgramParameter *parameter) { return parameter->name; }
+SceGxmParameterCategory sceGxmProgramParameterGetCategory(const SceGxmProgramParameter *parameter) { return (SceGxmParameterCategory)parameter->category; }
+unsigned int sceGxmProgramParameterGetComponentCount(const SceGxmProgramParameter *parameter) { return parameter->componentCount; }
+unsigned int sceGxmProgramParameterGetArraySize(const SceGxmProgramParameter *parameter) { return parameter->arraySize; }
+unsigned int sceGxmProgramParameterGetResourceIndex(const SceGxmProgramParameter *parameter) { return parameter->resourceIndex; }
+unsigned int sceGxmProgramParameterGetContainerIndex(const SceGxmProgramParameter *parameter) { return parameter->containerIndex; }
+
+int sceGxmSetUniformDataF(void *uniformBuffer, const SceGxmProgramParameter *parameter, unsigned int componentOffset,
+	unsigned int componentCount, const float *sourceData)
+{
+	if (uniformBuffer == nullptr || parameter == nullptr || sourceData == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	if (parameter->category != SCE_GXM_PARAMETER_CATEGORY_UNIFORM)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+	if (componentOffset + componentCount > parameter->componentCount * parameter->arraySize)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+
+	memcpy((float*)uniformBuffer + parameter->resourceIndex + componentOffset, sourceData, componentCount * sizeof(float));
+	return 0;
+}
+
+/*----- Shader patcher -----*/
+
+template<typename T>
+static T* patcherNew(SceGxmShaderPatcher* patcher)
+{
+	void* memory = patcher->params.hostAllocCallback(patcher->params.userData, sizeof(T));
+	return (memory != nullptr) ? new (memory) T() : nullptr;
+}
+
+template<typename T>
+static void patcherDelete(SceGxmShaderPatcher* patcher, T* object)
+{
+	object->~T();
+	patcher->params.hostFreeCallback(patcher->params.userData, object);
+}
+
+static void programCreated()
+{
+	std::lock_guard<std::mutex> lock(_gxmMutex);
+	_stats.programsCreated++;
+	_stats.programsLive++;
+}
+
+static void programReleased()
+{
+	std::lock_guard<std::mutex> lock(_gxmMutex);
+	_stats.programsLive--;
+}
+
+int sceGxmShaderPatcherCreate(const SceGxmShaderPatcherParams *params, SceGxmShaderPatcher **shaderPatcher)
+{
+	if (params == nullptr || params->hostAllocCallback == nullptr || params->hostFreeCallback == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+
+	void* memory = params->hostAllocCallback(params->userData, sizeof(SceGxmShaderPatcher));
+	if (memory == nullptr)
+		return SCE_GXM_ERROR_OUT_OF_MEMORY;
+	SceGxmShaderPatcher* patcher = new (memory) SceGxmShaderPatcher();
+	patcher->params = *params;
+	patcher->registered = new std::vector<SceGxmRegisteredProgram*>();
+	patcher->vertexPrograms = new std::vector<SceGxmVertexProgram*>();
+	patcher->fragmentPrograms = new std::vector<SceGxmFragmentProgram*>();
+	*shaderPatcher = patcher;
+	return 0;
+}
+
+//Whatever is still alive goes with the patcher
+int sceGxmShaderPatcherDestroy(SceGxmShaderPatcher *shaderPatcher)
+{
+	if (shaderPatcher == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+
+	for (size_t i = 0; i < shaderPatcher->vertexPrograms->size(); i++)
+	{
+		patcherDelete(shaderPatcher, (*shaderPatcher->vertexPrograms)[i]);
+		programReleased();
+	}
+	for (size_t i = 0; i < shaderPatcher->fragmentPrograms->size(); i++)
+	{
+		patcherDelete(shaderPatcher, (*shaderPatcher->fragmentPrograms)[i]);
+		programReleased();
+	}
+	for (size_t i = 0; i < shaderPatcher->registered->size(); i++)
+		patcherDelete(shaderPatcher, (*shaderPatcher->registered)[i]);
+	delete shaderPatcher->registered;
+	delete shaderPatcher->vertexPrograms;
+	delete shaderPatcher->fragmentPrograms;
+
+	SceGxmShaderPatcherParams params = shaderPatcher->params;
+	shaderPatcher->~SceGxmShaderPatcher();
+	params.hostFreeCallback(params.userData, shaderPatcher);
+	return 0;
+}
+
+int sceGxmShaderPatcherRegisterProgram(SceGxmShaderPatcher *shaderPatcher, const SceGxmProgram *programHeader, SceGxmShaderPatcherId *programId)
+{
+	if (shaderPatcher == nullptr || programId == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	int error = sceGxmProgramCheck(programHeader);
+	if (error != 0)
+		return error;
+
+	SceGxmRegisteredProgram* registered = patcherNew<SceGxmRegisteredProgram>(shaderPatcher);
+	if (registered == nullptr)
+		return SCE_GXM_ERROR_OUT_OF_MEMORY;
+	registered->program = programHeader;
+	registered->users = 0;
+	shaderPatcher->registered->push_back(registered);
+	*programId = registered;
+	return 0;
+}
+
+//Programs made from it have to be released first
+int sceGxmShaderPatcherUnregisterProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId)
+{
+	if (shaderPatcher == nullptr || programId == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	if (programId->users > 0)
+		return SCE_GXM_ERROR_PROGRAM_IN_USE;
+
+	std::vector<SceGxmRegisteredProgram*>* registered = shaderPatcher->registered;
+	for (size_t i = 0; i < registered->size(); i++)
+	{
+		if ((*registered)[i] == programId)
+		{
+			registered->erase(registered->begin() + i);
+			patcherDelete(shaderPatcher, programId);
+			return 0;
+		}
+	}
+	return SCE_GXM_ERROR_INVALID_VALUE;
+}
+
+const SceGxmProgram *sceGxmShaderPatcherGetProgramFromId(SceGxmShaderPatcherId programId)
+{
+	return (programId != nullptr) ? programId->program : nullptr;
+}
+
+int sceGxmShaderPatcherCreateVertexProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId,
+	const SceGxmVertexAttribute *attributes, unsigned int attributeCount, const SceGxmVertexStream *streams, unsigned int streamCount,
+	SceGxmVertexProgram **vertexProgram)
+{
+	if (shaderPatcher == nullptr || programId == nullptr || vertexProgram == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	if (programId->program->type != SCE_GXM_VERTEX_PROGRAM)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+	if (attributeCount > SCE_GXM_MAX_VERTEX_ATTRIBUTES || streamCount > SCE_GXM_MAX_VERTEX_STREAMS)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+	for (unsigned int i = 0; i < attributeCount; i++)
+	{
+		if (attributes[i].streamIndex >= streamCount)
+			return SCE_GXM_ERROR_INVALID_VALUE;
+	}
+
+	//the same program with the same layout is the same patched program
+	std::vector<SceGxmVertexProgram*>* programs = shaderPatcher->vertexPrograms;
+	for (size_t i = 0; i < programs->size(); i++)
+	{
+		SceGxmVertexProgram* existing = (*programs)[i];
+		if (existing->programId == programId && existing->attributeCount == attributeCount && existing->streamCount == streamCount
+			&& memcmp(existing->attributes, attributes, attributeCount * sizeof(SceGxmVertexAttribute)) == 0
+			&& memcmp(existing->streams, streams, streamCount * sizeof(SceGxmVertexStream)) == 0)
+		{
+			existing->refCount++;
+			*vertexProgram = existing;
+			return 0;
+		}
+	}
+
+	SceGxmVertexProgram* created = patcherNew<SceGxmVertexProgram>(shaderPatcher);
+	if (created == nullptr)
+		return SCE_GXM_ERROR_OUT_OF_MEMORY;
+	created->programId = programId;
+	created->attributeCount = attributeCount;
+	memcpy(created->attributes, attributes, attributeCount * sizeof(SceGxmVertexAttribute));
+	created->streamCount = streamCount;
+	memcpy(created->streams, streams, streamCount * sizeof(SceGxmVertexStream));
+	created->refCount = 1;
+	programId->users++;
+	programs->push_back(created);
+	programCreated();
+	*vertexProgram = created;
+	return 0;
+}
+
+int sceGxmShaderPatcherCreateFragmentProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId,
+	SceGxmOutputRegisterFormat outputFormat, SceGxmMultisampleMode multisampleMode, const SceGxmBlendInfo *blendInfo,
+	const SceGxmProgram *vertexProgram, SceGxmFragmentProgram **fragmentProgram)
+{
+	if (shaderPatcher == nullptr || programId == nullptr || fragmentProgram == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	if (programId->program->type != SCE_GXM_FRAGMENT_PROGRAM)
+		return SCE_GXM_ERROR_INVALID_VALUE;
+
+	std::vector<SceGxmFragmentProgram*>* programs = shaderPatcher->fragmentPrograms;
+	for (size_t i = 0; i < programs->size(); i++)
+	{
+		SceGxmFragmentProgram* existing = (*programs)[i];
+		if (existing->programId == programId && existing->outputFormat == outputFormat && existing->multisampleMode == multisampleMode
+			&& existing->vertexProgram == vertexProgram && existing->blendEnabled == (blendInfo != nullptr)
+			&& (blendInfo == nullptr || memcmp(&existing->blendInfo, blendInfo, sizeof(SceGxmBlendInfo)) == 0))
+		{
+			existing->refCount++;
+			*fragmentProgram = existing;
+			return 0;
+		}
+	}
+
+	SceGxmFragmentProgram* created = patcherNew<SceGxmFragmentProgram>(shaderPatcher);
+	if (created == nullptr)
+		return SCE_GXM_ERROR_OUT_OF_MEMORY;
+	created->programId = programId;
+	created->outputFormat = outputFormat;
+	created->multisampleMode = multisampleMode;
+	created->blendEnabled = (blendInfo != nullptr);
+	if (blendInfo != nullptr)
+		created->blendInfo = *blendInfo;
+	created->vertexProgram = vertexProgram;
+	created->refCount = 1;
+	programId->users++;
+	programs->push_back(created);
+	programCreated();
+	*fragmentProgram = created;
+	return 0;
+}
+
+template<typename T>
+static int releaseProgram(SceGxmShaderPatcher* patcher, std::vector<T*>* programs, T* program)
+{
+	for (size_t i = 0; i < programs->size(); i++)
+	{
+		if ((*programs)[i] != program)
+			continue;
+		if (--program->refCount == 0)
+		{
+			program->programId->users--;
+			programs->erase(programs->begin() + i);
+			patcherDelete(patcher, program);
+			programReleased();
+		}
+		return 0;
+	}
+	return SCE_GXM_ERROR_INVALID_VALUE;
+}
+
+int sceGxmShaderPatcherReleaseVertexProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmVertexProgram *vertexProgram)
+{
+	if (shaderPatcher == nullptr || vertexProgram == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	return releaseProgram(shaderPatcher, shaderPatcher->vertexPrograms, vertexProgram);
+}
+
+int sceGxmShaderPatcherReleaseFragmentProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmFragmentProgram *fragmentProgram)
+{
+	if (shaderPatcher == nullptr || fragmentProgram == nullptr)
+		return SCE_GXM_ERROR_INVALID_POINTER;
+	return releaseProgram(shaderPatcher, shaderPatcher->fragmentPrograms, fragmentProgram);
+}
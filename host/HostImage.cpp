@@ -0,0 +1,91 @@
+//----------------------------------------------
+// Host image files
+// Frames written out and compared as binary PPM: no library needed to write or read them,
+// and most image viewers open them. Alpha is left out, it never reaches the display
+//-----------------------------------------------
+
+#include "HostPlatform.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+bool hostWriteImage(const char* path, const void* pixels, unsigned int width, unsigned int height, unsigned int strideInPixels)
+{
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr)
+		return false;
+
+	fprintf(file, "P6\n%u %u\n255\n", width, height);
+	std::vector<uint8_t> row(width * 3);
+	bool written = true;
+	for (unsigned int y = 0; y < height && written; y++)
+	{
+		//A8B8G8R8 has red in the low byte
+		const uint32_t* source = (const uint32_t*)pixels + (size_t)y * strideInPixels;
+		for (unsigned int x = 0; x < width; x++)
+		{
+			row[x * 3] = source[x] & 0xFF;
+			row[x * 3 + 1] = (source[x] >> 8) & 0xFF;
+			row[x * 3 + 2] = (source[x] >> 16) & 0xFF;
+		}
+		written = fwrite(&row[0], 1, row.size(), file) == row.size();
+	}
+	return (fclose(file) == 0) && written;
+}
+
+bool hostCompareImage(const char* path, const void* pixels, unsigned int width, unsigned int height, unsigned int strideInPixels,
+	unsigned int tolerance, HostImageDiff* diff)
+{
+	HostImageDiff result;
+	memset(&result, 0, sizeof(HostImageDiff));
+	if (diff != nullptr)
+		*diff = result;
+
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr)
+		return false;
+
+	//only what hostWriteImage() writes: no comments, 8 bits a channel
+	unsigned int fileWidth = 0;
+	unsigned int fileHeight = 0;
+	unsigned int maxValue = 0;
+	if (fscanf(file, "P6 %u %u %u", &fileWidth, &fileHeight, &maxValue) != 3 || fgetc(file) == EOF
+		|| fileWidth != width || fileHeight != height || maxValue != 255)
+	{
+		fclose(file);
+		return false;
+	}
+
+	std::vector<uint8_t> row(width * 3);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		if (fread(&row[0], 1, row.size(), file) != row.size())
+		{
+			fclose(file);
+			return false;
+		}
+
+		const uint32_t* source = (const uint32_t*)pixels + (size_t)y * strideInPixels;
+		for (unsigned int x = 0; x < width; x++)
+		{
+			unsigned int largest = 0;
+			for (unsigned int c = 0; c < 3; c++)
+			{
+				int difference = (int)((source[x] >> (c * 8)) & 0xFF) - (int)row[x * 3 + c];
+				unsigned int distance = (unsigned int)((difference < 0) ? -difference : difference);
+				largest = (distance > largest) ? distance : largest;
+			}
+			if (largest > tolerance)
+				result.differentPixels++;
+			if (largest > result.maxDifference)
+				result.maxDifference = largest;
+		}
+	}
+	fclose(file);
+
+	if (diff != nullptr)
+		*diff = result;
+	return result.differentPixels == 0;
+}
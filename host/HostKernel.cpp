@@ -0,0 +1,504 @@
+//----------------------------------------------
+// Host stand-in for the Vita kernel, sysmodule and file I/O
+// Memblocks are aligned heap blocks with the Vita's size rules, threads, semaphores and mutexes
+// run on the host's, devices are host directories
+//-----------------------------------------------
+
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/sysmem.h>
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/sysmodule.h>
+
+#include "HostPlatform.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Vita errno style errors from the I/O calls
+#define HOST_IO_ERROR(err)		((int)(0x80010000 | (err)))
+
+//Roughly what a game gets of each pool on the Vita, blocks are counted against these
+#define HOST_CDRAM_SIZE			(112 * 1024 * 1024)
+#define HOST_USER_SIZE			(256 * 1024 * 1024)
+#define HOST_PHYCONT_SIZE		(26 * 1024 * 1024)
+
+static std::mutex _kernelMutex;
+static SceUID _nextUID = 0x40010001;
+
+static SceUID newUID()
+{
+	//UIDs are odd and positive on the Vita, the engine only relies on them being >= 0
+	SceUID uid = _nextUID;
+	_nextUID += 2;
+	return uid;
+}
+
+/*----- Process -----*/
+
+static const std::chrono::steady_clock::time_point _processStart = std::chrono::steady_clock::now();
+
+int sceKernelExitProcess(int res)
+{
+	exit(res);
+	return 0;
+}
+
+SceUInt64 sceKernelGetProcessTimeWide(void)
+{
+	return (SceUInt64)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _processStart).count();
+}
+
+SceUInt32 sceKernelGetProcessTimeLow(void)
+{
+	return (SceUInt32)sceKernelGetProcessTimeWide();
+}
+
+/*----- Memory blocks -----*/
+
+typedef struct HostMemBlock
+{
+	void* base;
+	SceSize size;
+	SceKernelMemBlockType type;
+} HostMemBlock;
+static std::map<SceUID, HostMemBlock> _memBlocks;
+static SceSize _cdramUsed = 0;
+static SceSize _userUsed = 0;
+
+SceUID sceKernelAllocMemBlock(const char *name, SceKernelMemBlockType type, SceSize size, SceKernelAllocMemBlockOpt *optp)
+{
+	(void)name;
+	(void)optp;
+	bool cdram = (type == SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW);
+	SceSize granularity = cdram ? 256 * 1024 : 4 * 1024;
+	if (size == 0 || (size & (granularity - 1)) != 0)
+		return SCE_KERNEL_ERROR_ILLEGAL_MEMBLOCK_SIZE;
+
+	std::lock_guard<std::mutex> lock(_kernelMutex);
+	SceSize* used = cdram ? &_cdramUsed : &_userUsed;
+	if (*used + size > (cdram ? (SceSize)HOST_CDRAM_SIZE : (SceSize)HOST_USER_SIZE))
+		return SCE_KERNEL_ERROR_NO_MEMORY;
+
+	//blocks start on their granularity like the Vita's do, the engine aligns inside them assuming it
+	void* base = nullptr;
+	if (posix_memalign(&base, granularity, size) != 0)
+		return SCE_KERNEL_ERROR_NO_MEMORY;
+	*used += size;
+
+	HostMemBlock block;
+	block.base = base;
+	block.size = size;
+	block.type = type;
+	SceUID uid = newUID();
+	_memBlocks[uid] = block;
+	return uid;
+}
+
+int sceKernelFreeMemBlock(SceUID uid)
+{
+	std::lock_guard<std::mutex> lock(_kernelMutex);
+	std::map<SceUID, HostMemBlock>::iterator iter = _memBlocks.find(uid);
+	if (iter == _memBlocks.end())
+		return SCE_KERNEL_ERROR_UNKNOWN_UID;
+
+	if (iter->second.type == SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW)
+		_cdramUsed -= iter->second.size;
+	else
+		_userUsed -= iter->second.size;
+	free(iter->second.base);
+	_memBlocks.erase(iter);
+	return 0;
+}
+
+int sceKernelGetMemBlockBase(SceUID uid, void **basep)
+{
+	std::lock_guard<std::mutex> lock(_kernelMutex);
+	std::map<SceUID, HostMemBlock>::iterator iter = _memBlocks.find(uid);
+	if (iter == _memBlocks.end())
+		return SCE_KERNEL_ERROR_UNKNOWN_UID;
+	*basep = iter->second.base;
+	return 0;
+}
+
+int sceKernelGetFreeMemorySize(SceKernelFreeMemorySizeInfo *info)
+{
+	std::lock_guard<std::mutex> lock(_kernelMutex);
+	info->size = sizeof(SceKernelFreeMemorySizeInfo);
+	info->size_user = HOST_USER_SIZE - _userUsed;
+	info->size_cdram = HOST_CDRAM_SIZE - _cdramUsed;
+	info->size_phycont = HOST_PHYCONT_SIZE;
+	return 0;
+}
+
+/*----- Threads -----*/
+
+typedef struct HostThread
+{
+	SceKernelThreadEntry entry;
+	std::vector<char> args;
+	std::thread thread;
+	int exitStatus;
+} HostThread;
+static std::map<SceUID, HostThread*> _threads;
+
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int initPriority, SceSize stackSize, SceUInt attr, int cpuAffinityMask, const SceKernelThreadOptParam *option)
+{
+	(void)name;
+	(void)initPriority;
+	(void)stackSize;
+	(void)attr;
+	(void)cpuAffinityMask;
+	(void)option;
+
+	HostThread* thread = new HostThread;
+	thread->entry = entry;
+	thread->exitStatus = 0;
+
+	std::lock_guard<std::mutex> lock(_kernelMutex);
+	SceUID uid = newUID();
+	_threads[uid] = thread;
+	return uid;
+}
+
+static HostThread* findThread(SceUID thid)
+{
+	std::lock_guard<std::mutex> lock(_kernelMutex);
+	std::map<SceUID, HostThread*>::iterator iter = _threads.find(thid);
+	return (iter != _threads.end()) ? iter->second : nullptr;
+}
+
+int sceKernelStartThread(SceUID thid, SceSize arglen, void *argp)
+{
+	HostThread* thread = findThread(thid);
+	if (thread == nullptr)
+		return SCE_KERNEL_ERROR_UNKNOWN_UID;
+
+	if (argp != nullptr && arglen > 0)
+		thread->args.assign((char*)argp, (char*)argp + arglen);
+	thread->thread = std::thread([thread, arglen]()
+	{
+		thread->exitStatus = thread->entry(arglen, thread->args.empty() ? nullptr : &thread->args[0]);
+	});
+	return 0;
+}
+
+int sceKernelWaitThreadEnd(SceUID thid, int *stat, SceUInt *timeout)
+{
+	(void)timeout;
+	HostThread* thread = findThread(thid);
+	if (thread == nullptr)
+		return SCE_KERNEL_ERROR_UNKNOWN_UID;
+
+	if (thread->thread.joinable())
+		thread->thread.join();
+	if (stat != nullptr)
+		*stat = thread->exitStatus;
+	return 0;
+}
+
+int sceKernelDeleteThread(SceUID thid)
+{
+	HostThread* thread = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(_kernelMutex);
+		std::map<SceUID, HostThread*>::iterator iter = _threads.find(thid);
+		if (iter == _threads.end())
+			return SCE_KERNEL_ERROR_UNKNOWN_UID;
+		thread = iter->second;
+		_threads.erase(iter);
+	}
+	//the Vita only deletes threads that have ended
+	if (thread->thread.joinable())
+		thread->thread.join();
+	delete thread;
+	return 0;
+}
+
+int sceKernelDelayThread(SceUInt delay)
+{
+	std::this_thread::sleep_for(std::chrono::microseconds(delay));
+	return 0;
+}
+
+/*----- Semaphores -----*/
+
+typedef struct HostSema
+{
+	std::mutex mutex;
+	std::condition_variable condition;
+	int count;
+	int maxCount;
+} HostSema;
+static std::map<SceUID, HostSema*> _semas;
+
+static HostSema* findSema(SceUID semaid)
+{
+	std::lock_guard<std::mutex> lock(_kernelMutex);
+	std::map<SceUID, HostSema*>::iterator iter = _semas.find(semaid);
+	return (iter != _semas.end()) ? iter->second : nullptr;
+}
+
+SceUID sceKernelCreateSema(const char *name, SceUInt attr, int initVal, int maxVal, void *option)
+{
+	(void)name;
+	(void)attr;
+	(void)option;
+	if (initVal < 0 || maxVal <= 0 || initVal > maxVal)
+		return SCE_KERNEL_ERROR_ILLEGAL_COUNT;
+
+	HostSema* sema = new HostSema;
+	sema->count = initVal;
+	sema->maxCount = maxVal;
+
+	std::lock_guard<std::mutex> lock(_kernelMutex);
+	SceUID uid = newUID();
+	_semas[uid] = sema;
+	return uid;
+}
+
+int sceKernelDeleteSema(SceUID semaid)
+{
+	HostSema* sema = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(_kernelMutex);
+		std::map<SceUID, HostSema*>::iterator iter = _semas.find(semaid);
+		if (iter == _semas.end())
+			return SCE_KERNEL_ERROR_UNKNOWN_UID;
+		sema = iter->second;
+		_semas.erase(iter);
+	}
+	delete sema;
+	return 0;
+}
+
+int sceKernelSignalSema(SceUID semaid, int signal)
+{
+	HostSema* sema = findSema(semaid);
+	if (sema == nullptr)
+		return SCE_KERNEL_ERROR_UNKNOWN_UID;
+
+	std::lock_guard<std::mutex> lock(sema->mutex);
+	if (sema->count + signal > sema->maxCount)
+		return SCE_KERNEL_ERROR_SEMA_OVF;
+	sema->count += signal;
+	sema->condition.notify_all();
+	return 0;
+}
+
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt *timeout)
+{
+	(void)timeout;
+	HostSema* sema = findSema(semaid);
+	if (sema == nullptr)
+		return SCE_KERNEL_ERROR_UNKNOWN_UID;
+
+	std::unique_lock<std::mutex> lock(sema->mutex);
+	sema->condition.wait(lock, [sema, signal]() { return sema->count >= signal; });
+	sema->count -= signal;
+	return 0;
+}
+
+int sceKernelPollSema(SceUID semaid, int signal)
+{
+	HostSema* sema = findSema(semaid);
+	if (sema == nullptr)
+		return SCE_KERNEL_ERROR_UNKNOWN_UID;
+
+	std::lock_guard<std::mutex> lock(sema->mutex);
+	if (sema->count < signal)
+		return SCE_KERNEL_ERROR_SEMA_ZERO;
+	sema->count -= signal;
+	return 0;
+}
+
+/*----- Lightweight mutexes -----*/
+
+static std::recursive_mutex* getLwMutex(SceKernelLwMutexWork* work)
+{
+	std::recursive_mutex* mutex = nullptr;
+	memcpy(&mutex, work->data, sizeof(mutex));
+	return mutex;
+}
+
+int sceKernelCreateLwMutex(SceKernelLwMutexWork *pWork, const char *pName, unsigned int attr, int initCount, const SceKernelLwMutexOptParam *pOptParam)
+{
+	(void)pName;
+	(void)attr;
+	(void)pOptParam;
+	if (initCount < 0)
+		return SCE_KERNEL_ERROR_ILLEGAL_COUNT;
+
+	std::recursive_mutex* mutex = new std::recursive_mutex;
+	memset(pWork, 0, sizeof(SceKernelLwMutexWork));
+	memcpy(pWork->data, &mutex, sizeof(mutex));
+	for (int i = 0; i < initCount; i++)
+		mutex->lock();
+	return 0;
+}
+
+int sceKernelDeleteLwMutex(SceKernelLwMutexWork *pWork)
+{
+	std::recursive_mutex* mutex = getLwMutex(pWork);
+	if (mutex == nullptr)
+		return SCE_KERNEL_ERROR_UNKNOWN_UID;
+	delete mutex;
+	memset(pWork, 0, sizeof(SceKernelLwMutexWork));
+	return 0;
+}
+
+int sceKernelLockLwMutex(SceKernelLwMutexWork *pWork, int lockCount, unsigned int *pTimeout)
+{
+	(void)pTimeout;
+	std::recursive_mutex* mutex = getLwMutex(pWork);
+	if (mutex == nullptr)
+		return SCE_KERNEL_ERROR_UNKNOWN_UID;
+	if (lockCount <= 0)
+		return SCE_KERNEL_ERROR_ILLEGAL_COUNT;
+	for (int i = 0; i < lockCount; i++)
+		mutex->lock();
+	return 0;
+}
+
+int sceKernelTryLockLwMutex(SceKernelLwMutexWork *pWork, int lockCount)
+{
+	std::recursive_mutex* mutex = getLwMutex(pWork);
+	if (mutex == nullptr)
+		return SCE_KERNEL_ERROR_UNKNOWN_UID;
+	if (lockCount <= 0)
+		return SCE_KERNEL_ERROR_ILLEGAL_COUNT;
+	if (!mutex->try_lock())
+		return SCE_KERNEL_ERROR_LW_MUTEX_FAILED_TO_OWN;
+	for (int i = 1; i < lockCount; i++)
+		mutex->lock();
+	return 0;
+}
+
+int sceKernelUnlockLwMutex(SceKernelLwMutexWork *pWork, int unlockCount)
+{
+	std::recursive_mutex* mutex = getLwMutex(pWork);
+	if (mutex == nullptr)
+		return SCE_KERNEL_ERROR_UNKNOWN_UID;
+	if (unlockCount <= 0)
+		return SCE_KERNEL_ERROR_ILLEGAL_COUNT;
+	for (int i = 0; i < unlockCount; i++)
+		mutex->unlock();
+	return 0;
+}
+
+/*----- Sysmodules -----*/
+
+//Everything the stand-in provides is always there
+int sceSysmoduleLoadModule(SceUInt16 id)
+{
+	(void)id;
+	return 0;
+}
+
+int sceSysmoduleUnloadModule(SceUInt16 id)
+{
+	(void)id;
+	return 0;
+}
+
+/*----- File I/O -----*/
+
+static std::map<std::string, std::string> _deviceRoots;
+
+void hostSetDeviceRoot(const char* device, const char* directory)
+{
+	std::lock_guard<std::mutex> lock(_kernelMutex);
+	_deviceRoots[device] = directory;
+}
+
+//"ux0:/data/x" to the host path of x, paths without a device are left alone
+static std::string hostPath(const char* file)
+{
+	const char* colon = strchr(file, ':');
+	if (colon == nullptr)
+		return file;
+
+	std::string device(file, colon - file + 1);
+	std::string root;
+	{
+		std::lock_guard<std::mutex> lock(_kernelMutex);
+		std::map<std::string, std::string>::iterator iter = _deviceRoots.find(device);
+		if (iter != _deviceRoots.end())
+			root = iter->second;
+		else if (device == "app0:")
+			root = ".";
+		else
+			root = device.substr(0, device.size() - 1);
+	}
+
+	const char* rest = colon + 1;
+	while (*rest == '/')
+		rest++;
+	return root + "/" + rest;
+}
+
+//Creates the directories leading up to path, the memory card always has them
+static void makeParentDirectories(const std::string& path)
+{
+	for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1))
+		mkdir(path.substr(0, slash).c_str(), 0755);
+}
+
+SceUID sceIoOpen(const char *file, int flags, SceMode mode)
+{
+	int hostFlags = 0;
+	if ((flags & SCE_O_RDWR) == SCE_O_RDWR)
+		hostFlags = O_RDWR;
+	else if (flags & SCE_O_WRONLY)
+		hostFlags = O_WRONLY;
+	else
+		hostFlags = O_RDONLY;
+	if (flags & SCE_O_APPEND)
+		hostFlags |= O_APPEND;
+	if (flags & SCE_O_CREAT)
+		hostFlags |= O_CREAT;
+	if (flags & SCE_O_TRUNC)
+		hostFlags |= O_TRUNC;
+
+	std::string path = hostPath(file);
+	if (flags & SCE_O_CREAT)
+		makeParentDirectories(path);
+	int fd = open(path.c_str(), hostFlags, mode ? mode : 0644);
+	return (fd >= 0) ? fd : HOST_IO_ERROR(errno);
+}
+
+int sceIoClose(SceUID fd)
+{
+	return (close(fd) == 0) ? 0 : HOST_IO_ERROR(errno);
+}
+
+int sceIoRead(SceUID fd, void *data, SceSize size)
+{
+	ssize_t result = read(fd, data, size);
+	return (result >= 0) ? (int)result : HOST_IO_ERROR(errno);
+}
+
+int sceIoWrite(SceUID fd, const void *data, SceSize size)
+{
+	ssize_t result = write(fd, data, size);
+	return (result >= 0) ? (int)result : HOST_IO_ERROR(errno);
+}
+
+SceOff sceIoLseek(SceUID fd, SceOff offset, int whence)
+{
+	int hostWhence = (whence == SCE_SEEK_END) ? SEEK_END : (whence == SCE_SEEK_CUR) ? SEEK_CUR : SEEK_SET;
+	off_t result = lseek(fd, (off_t)offset, hostWhence);
+	return (result >= 0) ? (SceOff)result : (SceOff)HOST_IO_ERROR(errno);
+}
@@ -0,0 +1,212 @@
+//----------------------------------------------
+// Host stand-in for libpgf
+// One font of box glyphs for printable ASCII: every glyph is a hollow rectangle as tall as the
+// capitals and half the line height wide. Text measures, lays out and caches the same way as with
+// a real font, it just isn't readable
+//-----------------------------------------------
+
+#include <psp2/pgf.h>
+
+#include <string.h>
+#include <stdlib.h>
+
+//Design size in points, glyph metrics are scaled by resolution / 72
+#define HOST_FONT_POINTS	10.0f
+
+typedef struct HostFontLib
+{
+	SceFontNewLibParams params;
+	float hResolution;
+	float vResolution;
+} HostFontLib;
+
+typedef struct HostFont
+{
+	HostFontLib* lib;
+} HostFont;
+
+//Pixel metrics of the box glyphs at the library's resolution
+typedef struct HostGlyphMetrics
+{
+	int lineHeight;
+	int ascender;
+	int width;
+	int height;
+	int advance;
+} HostGlyphMetrics;
+
+static void glyphMetrics(const HostFontLib* lib, HostGlyphMetrics* metrics)
+{
+	float pixels = HOST_FONT_POINTS * lib->vResolution / 72.0f;
+	metrics->lineHeight = (int)(pixels + 0.5f);
+	if (metrics->lineHeight < 4)
+		metrics->lineHeight = 4;
+	metrics->ascender = (metrics->lineHeight * 4) / 5;
+	metrics->height = (metrics->ascender * 7) / 8;
+	metrics->width = metrics->lineHeight / 2;
+	metrics->advance = metrics->width + metrics->lineHeight / 8 + 1;
+}
+
+static bool hasGlyph(unsigned int charCode)
+{
+	return charCode >= 0x21 && charCode <= 0x7E;
+}
+
+SceFontLibHandle sceFontNewLib(SceFontNewLibParams* params, unsigned int* errorCode)
+{
+	if (params == nullptr || params->allocFunc == nullptr)
+	{
+		*errorCode = SCE_FONT_ERROR_INVALID_PARAMETER;
+		return nullptr;
+	}
+
+	HostFontLib* lib = (HostFontLib*)params->allocFunc(params->userData, sizeof(HostFontLib));
+	lib->params = *params;
+	lib->hResolution = 72.0f;
+	lib->vResolution = 72.0f;
+	*errorCode = 0;
+	return lib;
+}
+
+int sceFontDoneLib(SceFontLibHandle libHandle)
+{
+	HostFontLib* lib = (HostFontLib*)libHandle;
+	if (lib == nullptr)
+		return SCE_FONT_ERROR_INVALID_PARAMETER;
+	lib->params.freeFunc(lib->params.userData, lib);
+	return 0;
+}
+
+int sceFontSetResolution(SceFontLibHandle libHandle, float hResolution, float vResolution)
+{
+	HostFontLib* lib = (HostFontLib*)libHandle;
+	if (lib == nullptr || hResolution <= 0.0f || vResolution <= 0.0f)
+		return SCE_FONT_ERROR_INVALID_PARAMETER;
+	lib->hResolution = hResolution;
+	lib->vResolution = vResolution;
+	return 0;
+}
+
+int sceFontFindOptimumFont(SceFontLibHandle libHandle, SceFontStyle* fontStyle, unsigned int* errorCode)
+{
+	(void)fontStyle;
+	*errorCode = (libHandle != nullptr) ? 0 : SCE_FONT_ERROR_INVALID_PARAMETER;
+	return 0;
+}
+
+SceFontHandle sceFontOpen(SceFontLibHandle libHandle, unsigned int index, unsigned int mode, unsigned int* errorCode)
+{
+	(void)mode;
+	HostFontLib* lib = (HostFontLib*)libHandle;
+	if (lib == nullptr || index != 0)
+	{
+		*errorCode = SCE_FONT_ERROR_INVALID_PARAMETER;
+		return nullptr;
+	}
+
+	HostFont* font = (HostFont*)lib->params.allocFunc(lib->params.userData, sizeof(HostFont));
+	font->lib = lib;
+	*errorCode = 0;
+	return font;
+}
+
+int sceFontClose(SceFontHandle fontHandle)
+{
+	HostFont* font = (HostFont*)fontHandle;
+	if (font == nullptr)
+		return SCE_FONT_ERROR_INVALID_PARAMETER;
+	font->lib->params.freeFunc(font->lib->params.userData, font);
+	return 0;
+}
+
+int sceFontGetFontInfo(SceFontHandle fontHandle, SceFontInfo* fontInfo)
+{
+	HostFont* font = (HostFont*)fontHandle;
+	if (font == nullptr || fontInfo == nullptr)
+		return SCE_FONT_ERROR_INVALID_PARAMETER;
+
+	HostGlyphMetrics metrics;
+	glyphMetrics(font->lib, &metrics);
+	memset(fontInfo, 0, sizeof(SceFontInfo));
+	fontInfo->maxGlyphWidthI = metrics.width << 6;
+	fontInfo->maxGlyphHeightI = metrics.lineHeight << 6;
+	fontInfo->maxGlyphAscenderI = metrics.ascender << 6;
+	fontInfo->maxGlyphDescenderI = (metrics.lineHeight - metrics.ascender) << 6;
+	fontInfo->maxGlyphBaseYI = metrics.ascender << 6;
+	fontInfo->maxGlyphAdvanceXI = metrics.advance << 6;
+	fontInfo->maxGlyphWidthF = (float)metrics.width;
+	fontInfo->maxGlyphHeightF = (float)metrics.lineHeight;
+	fontInfo->maxGlyphAscenderF = (float)metrics.ascender;
+	fontInfo->maxGlyphBaseYF = (float)metrics.ascender;
+	fontInfo->maxGlyphAdvanceXF = (float)metrics.advance;
+	fontInfo->maxGlyphWidth = (unsigned short)metrics.width;
+	fontInfo->maxGlyphHeight = (unsigned short)metrics.height;
+	fontInfo->fontStyle.fontH = HOST_FONT_POINTS;
+	fontInfo->fontStyle.fontV = HOST_FONT_POINTS;
+	fontInfo->fontStyle.fontHRes = font->lib->hResolution;
+	fontInfo->fontStyle.fontVRes = font->lib->vResolution;
+	fontInfo->fontStyle.fontFamily = SCE_FONT_FAMILY_SANS_SERIF;
+	fontInfo->fontStyle.fontStyle = SCE_FONT_STYLE_REGULAR;
+	fontInfo->fontStyle.fontLanguage = SCE_FONT_LANGUAGE_LATIN;
+	strcpy(fontInfo->fontStyle.fontName, "Host Boxes");
+	fontInfo->BPP = 8;
+	return 0;
+}
+
+int sceFontGetCharInfo(SceFontHandle fontHandle, unsigned int charCode, SceFontCharInfo* charInfo)
+{
+	HostFont* font = (HostFont*)fontHandle;
+	if (font == nullptr || charInfo == nullptr)
+		return SCE_FONT_ERROR_INVALID_PARAMETER;
+
+	HostGlyphMetrics metrics;
+	glyphMetrics(font->lib, &metrics);
+	memset(charInfo, 0, sizeof(SceFontCharInfo));
+	charInfo->sfp26AdvanceH = metrics.advance << 6;
+	charInfo->sfp26AdvanceV = metrics.lineHeight << 6;
+	//a space has no bitmap, only an advance
+	if (charCode == ' ')
+		return 0;
+	if (!hasGlyph(charCode))
+		return SCE_FONT_ERROR_NO_SUPPORT_GLYPH;
+
+	charInfo->bitmapWidth = metrics.width;
+	charInfo->bitmapHeight = metrics.height;
+	charInfo->bitmapLeft = 0;
+	charInfo->bitmapTop = metrics.height;
+	charInfo->sfp26Width = metrics.width << 6;
+	charInfo->sfp26Height = metrics.height << 6;
+	charInfo->sfp26Ascender = metrics.ascender << 6;
+	charInfo->sfp26Descender = -((metrics.lineHeight - metrics.ascender) << 6);
+	charInfo->sfp26BearingHY = metrics.height << 6;
+	return 0;
+}
+
+int sceFontGetCharGlyphImage(SceFontHandle fontHandle, unsigned int charCode, SceFontGlyphImage* glyphImage)
+{
+	HostFont* font = (HostFont*)fontHandle;
+	if (font == nullptr || glyphImage == nullptr || glyphImage->bufferPtr == nullptr || glyphImage->pixelFormat != SCE_FONT_PIXELFORMAT_8)
+		return SCE_FONT_ERROR_INVALID_PARAMETER;
+	if (!hasGlyph(charCode))
+		return SCE_FONT_ERROR_NO_SUPPORT_GLYPH;
+
+	HostGlyphMetrics metrics;
+	glyphMetrics(font->lib, &metrics);
+	int left = glyphImage->xPos64 >> 6;
+	int top = glyphImage->yPos64 >> 6;
+	uint8_t* pixels = (uint8_t*)glyphImage->bufferPtr;
+	for (int y = 0; y < metrics.height; y++)
+	{
+		if (top + y < 0 || top + y >= glyphImage->bufHeight)
+			continue;
+		uint8_t* row = pixels + (top + y) * glyphImage->bytesPerLine;
+		for (int x = 0; x < metrics.width; x++)
+		{
+			if (left + x < 0 || left + x >= glyphImage->bufWidth)
+				continue;
+			bool edge = (x == 0 || y == 0 || x == metrics.width - 1 || y == metrics.height - 1);
+			row[left + x] = edge ? 0xFF : 0x00;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,1036 @@
+//----------------------------------------------
+// Host software rasterizer
+// Renders like the tile based GPU it stands in for: a draw is vertex shaded and its triangles
+// binned into 32x32 tiles as it is submitted, the tiles are rasterized when the scene ends by
+// a number of threads taking them one at a time. Tiles share no pixels, so nothing is locked
+// and a tile's triangles are always drawn in submission order, the image doesn't depend on how
+// many threads there are.
+// Triangles are clipped to w > 0 and a guard band, snapped to 1/16 pixel and rasterized with
+// edge functions and the top left fill rule. Coverage and interpolation are worked out 4 pixels
+// at a time with SSE2 where the host has it, the scalar version does the same float operations
+// in the same order so both give the same image. Depth is tested against a buffer per tile that
+// starts at the background depth, like the GPU without a forced load, and is never stored
+//-----------------------------------------------
+
+#include "HostRaster.h"
+#include "HostPlatform.h"
+
+#include <psp2/kernel/processmgr.h>
+
+#include <string.h>
+#include <math.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define TILE_SIZE				SCE_GXM_TILE_SIZEX
+#define SUBPIXEL_BITS			4
+#define SUBPIXELS				(1 << SUBPIXEL_BITS)
+//how far from the surface origin, in pixels, triangles are clipped to. Keeps the fixed point
+//edge functions of a row inside 32 bits, see rasterizeRow()
+#define GUARD_BAND				8192.0f
+#define MIN_W					0.00001f
+//w > 0, then the guard band's left, right, top and bottom
+#define CLIP_PLANE_COUNT		5
+#define MAX_CLIPPED_VERTICES	(3 + CLIP_PLANE_COUNT)
+//an interpolated value is a plane: its value at the triangle's first vertex, x and y gradients
+#define PLANE_SIZE				3
+//1/w and depth come before the varyings
+#define FIXED_PLANES			2
+
+typedef struct ShadedVertex
+{
+	float position[4];
+	float varyings[HOST_RASTER_MAX_VARYINGS];
+} ShadedVertex;
+
+//How a draw's pixels are shaded and written, shared by its triangles
+typedef struct RasterState
+{
+	const SceGxmProgram* fragmentProgram;
+	HostFragmentShader fragmentShader;
+	HostShaderInputs inputs;		//pointed into the scene's copies by resolveInputs()
+	size_t uniformOffset;			//the fragment default uniforms, copied into HostRasterScene::_uniforms
+	size_t textureOffset;			//a texture for each sampler parameter in HostRasterScene::_textures
+	unsigned int varyingCount;
+	bool blendEnabled;
+	SceGxmBlendInfo blendInfo;
+	SceGxmDepthFunc depthFunc;
+	bool depthWrite;
+	bool clipInside;				//pixels inside clip are thrown away
+	unsigned int clip[4];
+} RasterState;
+
+typedef struct RasterTriangle
+{
+	//edge functions in 28.4 fixed point, a pixel center is inside when all three are >= 0
+	int32_t edgeA[3];
+	int32_t edgeB[3];
+	int64_t edgeC[3];
+	//pixels that can be covered, inclusive
+	int minX;
+	int minY;
+	int maxX;
+	int maxY;
+	//planes are relative to the first vertex
+	float originX;
+	float originY;
+	size_t planeOffset;
+	unsigned int stateIndex;
+} RasterTriangle;
+
+//Clip space bounds of the guard band for a draw's viewport
+typedef struct ClipPlanes
+{
+	float xMin;
+	float xMax;
+	float yMin;
+	float yMax;
+} ClipPlanes;
+
+//4 pixels of a row: which are covered and what they interpolate to
+typedef struct PixelQuad
+{
+	unsigned int mask;
+	float invW[4];
+	float depth[4];
+	float varyings[HOST_RASTER_MAX_VARYINGS][4];
+} PixelQuad;
+
+struct HostRasterScene
+{
+	bool active;
+	SceGxmColorSurface colorSurface;
+	bool hasDepth;
+	float backgroundDepth;
+	int bounds[4];					//pixels of the surface inside the valid region, inclusive
+	unsigned int tilesX;
+	unsigned int tilesY;
+
+	std::vector<RasterState> _states;
+	std::vector<RasterTriangle> _triangles;
+	std::vector<float> _planes;
+	std::vector<float> _uniforms;
+	std::vector<SceGxmTexture> _textures;
+	std::vector<std::vector<uint32_t> > _bins;
+
+	//a draw's shaded vertices, kept between draws to save allocating them again
+	std::vector<ShadedVertex> _vertices;
+	std::vector<int32_t> _vertexSlots;
+
+	HostRasterStats stats;
+};
+
+//Work shared by the threads rasterizing a scene
+typedef struct RasterWorker
+{
+	HostRasterScene* scene;
+	const std::vector<unsigned int>* tiles;
+	std::atomic<unsigned int>* nextTile;
+	SceUInt64 pixels;
+} RasterWorker;
+
+static std::atomic<bool> _enabled(false);
+static std::atomic<unsigned int> _threadCount(0);
+static std::mutex _statsMutex;
+static HostRasterStats _stats;
+
+void hostSetRasterizer(bool enable, unsigned int threads)
+{
+	_threadCount = threads;
+	_enabled = enable;
+}
+
+void hostGetRasterStats(HostRasterStats* stats)
+{
+	std::lock_guard<std::mutex> lock(_statsMutex);
+	*stats = _stats;
+}
+
+void hostResetRasterStats()
+{
+	std::lock_guard<std::mutex> lock(_statsMutex);
+	memset(&_stats, 0, sizeof(HostRasterStats));
+}
+
+/*----- Vertices -----*/
+
+static float halfToFloat(uint16_t half)
+{
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+	uint32_t bits;
+	if (exponent == 0x1F)
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	else if (exponent != 0)
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	else if (mantissa == 0)
+		bits = sign;
+	else
+	{
+		//denormal, normalized for the float
+		exponent = 113;
+		while ((mantissa & 0x400) == 0)
+		{
+			mantissa <<= 1;
+			exponent--;
+		}
+		bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+	}
+	float value;
+	memcpy(&value, &bits, sizeof(float));
+	return value;
+}
+
+//Reads an attribute of the vertex at data into value, the components it doesn't have are 0, 0, 0, 1
+static void fetchAttribute(const SceGxmVertexAttribute* attribute, const uint8_t* data, float* value)
+{
+	value[0] = 0.0f;
+	value[1] = 0.0f;
+	value[2] = 0.0f;
+	value[3] = 1.0f;
+
+	const uint8_t* source = data + attribute->offset;
+	for (unsigned int i = 0; i < attribute->componentCount && i < 4; i++)
+	{
+		switch (attribute->format)
+		{
+		case SCE_GXM_ATTRIBUTE_FORMAT_U8:
+			value[i] = (float)source[i];
+			break;
+		case SCE_GXM_ATTRIBUTE_FORMAT_S8:
+			value[i] = (float)(int8_t)source[i];
+			break;
+		case SCE_GXM_ATTRIBUTE_FORMAT_U8N:
+			value[i] = source[i] / 255.0f;
+			break;
+		case SCE_GXM_ATTRIBUTE_FORMAT_S8N:
+			value[i] = fmaxf((int8_t)source[i] / 127.0f, -1.0f);
+			break;
+		case SCE_GXM_ATTRIBUTE_FORMAT_U16:
+		case SCE_GXM_ATTRIBUTE_FORMAT_S16:
+		case SCE_GXM_ATTRIBUTE_FORMAT_U16N:
+		case SCE_GXM_ATTRIBUTE_FORMAT_S16N:
+		case SCE_GXM_ATTRIBUTE_FORMAT_F16:
+		{
+			uint16_t bits;
+			memcpy(&bits, source + i * 2, sizeof(uint16_t));
+			if (attribute->format == SCE_GXM_ATTRIBUTE_FORMAT_U16)
+				value[i] = (float)bits;
+			else if (attribute->format == SCE_GXM_ATTRIBUTE_FORMAT_S16)
+				value[i] = (float)(int16_t)bits;
+			else if (attribute->format == SCE_GXM_ATTRIBUTE_FORMAT_U16N)
+				value[i] = bits / 65535.0f;
+			else if (attribute->format == SCE_GXM_ATTRIBUTE_FORMAT_S16N)
+				value[i] = fmaxf((int16_t)bits / 32767.0f, -1.0f);
+			else
+				value[i] = halfToFloat(bits);
+			break;
+		}
+		default:
+			//F32, and untyped data is handed over as it is
+			memcpy(&value[i], source + i * 4, sizeof(float));
+			break;
+		}
+	}
+}
+
+static unsigned int readIndex(SceGxmIndexFormat format, const void* indexData, unsigned int i)
+{
+	return (format == SCE_GXM_INDEX_FORMAT_U32) ? ((const uint32_t*)indexData)[i] : ((const uint16_t*)indexData)[i];
+}
+
+//Where the vertex the draw's ith index reads is in _vertexSlots, an instance's vertices come after the one before's
+static unsigned int vertexKey(const HostRasterDraw* draw, unsigned int vertexCount, unsigned int i)
+{
+	return (i / draw->indexWrap) * vertexCount + readIndex(draw->indexFormat, draw->indexData, i % draw->indexWrap);
+}
+
+/*	Runs the vertex shader once for every vertex of every instance the draw's indices use, leaving
+the results in _vertices with _vertexSlots giving where each vertex went. Instance streams are read
+by the instance instead of the index
+*/
+static unsigned int shadeVertices(HostRasterScene* scene, const HostRasterDraw* draw, const HostRasterShader* shader)
+{
+	unsigned int vertexCount = 0;
+	for (unsigned int i = 0; i < draw->indexWrap; i++)
+	{
+		unsigned int index = readIndex(draw->indexFormat, draw->indexData, i);
+		if (index + 1 > vertexCount)
+			vertexCount = index + 1;
+	}
+	scene->_vertices.clear();
+	scene->_vertexSlots.assign(vertexCount * (draw->indexCount / draw->indexWrap), -1);
+
+	//the inputs point at attribute values refilled for every vertex, or straight at the uniforms
+	const SceGxmProgram* program = draw->vertexProgram;
+	float attributeValues[HOST_GXM_MAX_PARAMETERS][4];
+	int attributeIndices[HOST_GXM_MAX_PARAMETERS];
+	HostShaderInputs inputs;
+	for (unsigned int p = 0; p < HOST_GXM_MAX_PARAMETERS; p++)
+	{
+		inputs.parameters[p] = nullptr;
+		attributeIndices[p] = -1;
+		if (p >= program->parameterCount)
+			continue;
+
+		const SceGxmProgramParameter* parameter = &program->parameters[p];
+		if (parameter->category == SCE_GXM_PARAMETER_CATEGORY_ATTRIBUTE)
+		{
+			inputs.parameters[p] = attributeValues[p];
+			for (unsigned int a = 0; a < draw->attributeCount; a++)
+			{
+				if (draw->attributes[a].regIndex == parameter->resourceIndex)
+					attributeIndices[p] = (int)a;
+			}
+		}
+		else if (parameter->category == SCE_GXM_PARAMETER_CATEGORY_UNIFORM)
+		{
+			const void* buffer = (parameter->containerIndex < SCE_GXM_MAX_UNIFORM_BUFFERS) ?
+				draw->vertexUniformBuffers[parameter->containerIndex] : draw->vertexUniforms;
+			if (buffer != nullptr)
+				inputs.parameters[p] = (const float*)buffer + parameter->resourceIndex;
+		}
+	}
+
+	for (unsigned int i = 0; i < draw->indexCount; i++)
+	{
+		unsigned int key = vertexKey(draw, vertexCount, i);
+		if (scene->_vertexSlots[key] >= 0)
+			continue;
+		unsigned int index = readIndex(draw->indexFormat, draw->indexData, i % draw->indexWrap);
+		unsigned int instance = i / draw->indexWrap;
+
+		for (unsigned int p = 0; p < program->parameterCount && p < HOST_GXM_MAX_PARAMETERS; p++)
+		{
+			if (program->parameters[p].category != SCE_GXM_PARAMETER_CATEGORY_ATTRIBUTE)
+				continue;
+			if (attributeIndices[p] < 0)
+			{
+				//an input nothing feeds reads the defaults
+				static const SceGxmVertexAttribute missing = { 0, 0, SCE_GXM_ATTRIBUTE_FORMAT_F32, 0, 0 };
+				fetchAttribute(&missing, nullptr, attributeValues[p]);
+				continue;
+			}
+			const SceGxmVertexAttribute* attribute = &draw->attributes[attributeIndices[p]];
+			const SceGxmVertexStream* stream = &draw->streams[attribute->streamIndex];
+			bool instanced = stream->indexSource == SCE_GXM_INDEX_SOURCE_INSTANCE_16BIT || stream->indexSource == SCE_GXM_INDEX_SOURCE_INSTANCE_32BIT;
+			const uint8_t* data = (const uint8_t*)draw->streamData[attribute->streamIndex];
+			fetchAttribute(attribute, data + (instanced ? instance : index) * stream->stride, attributeValues[p]);
+		}
+
+		ShadedVertex vertex;
+		memset(&vertex, 0, sizeof(ShadedVertex));
+		shader->vertexShader(&inputs, vertex.position, vertex.varyings);
+		scene->_vertexSlots[key] = (int32_t)scene->_vertices.size();
+		scene->_vertices.push_back(vertex);
+	}
+	return vertexCount;
+}
+
+/*----- Triangle setup -----*/
+
+//Signed distance of a clip space position from a clipping plane, inside when not negative
+static float clipDistance(const ClipPlanes* planes, unsigned int plane, const float* position)
+{
+	switch (plane)
+	{
+	case 0:
+		return position[3] - MIN_W;
+	case 1:
+		return position[0] - planes->xMin * position[3];
+	case 2:
+		return planes->xMax * position[3] - position[0];
+	case 3:
+		return position[1] - planes->yMin * position[3];
+	default:
+		return planes->yMax * position[3] - position[1];
+	}
+}
+
+//Clips the polygon in place against every plane, returns how many vertices are left
+static unsigned int clipPolygon(const ClipPlanes* planes, unsigned int varyingCount, ShadedVertex* polygon, unsigned int count)
+{
+	ShadedVertex clipped[MAX_CLIPPED_VERTICES];
+	for (unsigned int plane = 0; plane < CLIP_PLANE_COUNT && count >= 3; plane++)
+	{
+		unsigned int clippedCount = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const ShadedVertex* a = &polygon[i];
+			const ShadedVertex* b = &polygon[(i + 1) % count];
+			float distanceA = clipDistance(planes, plane, a->position);
+			float distanceB = clipDistance(planes, plane, b->position);
+			if (distanceA >= 0.0f)
+				clipped[clippedCount++] = *a;
+			if ((distanceA >= 0.0f) != (distanceB >= 0.0f))
+			{
+				float t = distanceA / (distanceA - distanceB);
+				ShadedVertex* vertex = &clipped[clippedCount++];
+				for (unsigned int c = 0; c < 4; c++)
+					vertex->position[c] = a->position[c] + (b->position[c] - a->position[c]) * t;
+				for (unsigned int v = 0; v < varyingCount; v++)
+					vertex->varyings[v] = a->varyings[v] + (b->varyings[v] - a->varyings[v]) * t;
+			}
+		}
+		memcpy(polygon, clipped, clippedCount * sizeof(ShadedVertex));
+		count = clippedCount;
+	}
+	return (count >= 3) ? count : 0;
+}
+
+/*	Takes a clipped triangle to the screen and sets it up for rasterizing: snapped to the
+subpixel grid, culled, turned so the inside has positive edge functions, and binned into every
+tile its bounds touch. bounds are the pixels the draw may write
+*/
+static void setupTriangle(HostRasterScene* scene, const HostRasterDraw* draw, unsigned int stateIndex, const int* bounds,
+	const ShadedVertex* const* vertices)
+{
+	const float* viewport = draw->viewport;
+	const RasterState* state = &scene->_states[stateIndex];
+	int32_t x[3];
+	int32_t y[3];
+	float invW[3];
+	float depth[3];
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		const float* position = vertices[i]->position;
+		invW[i] = 1.0f / position[3];
+		float screenX = viewport[0] + viewport[1] * position[0] * invW[i];
+		float screenY = viewport[2] + viewport[3] * position[1] * invW[i];
+		depth[i] = viewport[4] + viewport[5] * position[2] * invW[i];
+		x[i] = (int32_t)floorf(screenX * SUBPIXELS + 0.5f);
+		y[i] = (int32_t)floorf(screenY * SUBPIXELS + 0.5f);
+	}
+
+	//y points down the screen, so a positive area is clockwise
+	int64_t area = (int64_t)(x[1] - x[0]) * (y[2] - y[0]) - (int64_t)(x[2] - x[0]) * (y[1] - y[0]);
+	if (area == 0 || (draw->cullMode == SCE_GXM_CULL_CW && area > 0) || (draw->cullMode == SCE_GXM_CULL_CCW && area < 0))
+	{
+		scene->stats.culledTriangles++;
+		return;
+	}
+	unsigned int order[3] = { 0, 1, 2 };
+	if (area < 0)
+	{
+		order[1] = 2;
+		order[2] = 1;
+	}
+
+	RasterTriangle triangle;
+	int32_t minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+	for (unsigned int e = 0; e < 3; e++)
+	{
+		unsigned int a = order[e];
+		unsigned int b = order[(e + 1) % 3];
+		int32_t dx = x[b] - x[a];
+		int32_t dy = y[b] - y[a];
+		triangle.edgeA[e] = -dy;
+		triangle.edgeB[e] = dx;
+		triangle.edgeC[e] = (int64_t)x[a] * y[b] - (int64_t)y[a] * x[b];
+		//pixel centers exactly on an edge belong to the triangle only for its top and left edges
+		bool topLeft = (dy < 0) || (dy == 0 && dx > 0);
+		if (!topLeft)
+			triangle.edgeC[e] -= 1;
+
+		minX = (x[e] < minX) ? x[e] : minX;
+		maxX = (x[e] > maxX) ? x[e] : maxX;
+		minY = (y[e] < minY) ? y[e] : minY;
+		maxY = (y[e] > maxY) ? y[e] : maxY;
+	}
+
+	//the pixels whose centers can be inside, within what the draw may write
+	triangle.minX = (minX - SUBPIXELS / 2 + SUBPIXELS - 1) >> SUBPIXEL_BITS;
+	triangle.maxX = (maxX - SUBPIXELS / 2) >> SUBPIXEL_BITS;
+	triangle.minY = (minY - SUBPIXELS / 2 + SUBPIXELS - 1) >> SUBPIXEL_BITS;
+	triangle.maxY = (maxY - SUBPIXELS / 2) >> SUBPIXEL_BITS;
+	triangle.minX = (triangle.minX > bounds[0]) ? triangle.minX : bounds[0];
+	triangle.minY = (triangle.minY > bounds[1]) ? triangle.minY : bounds[1];
+	triangle.maxX = (triangle.maxX < bounds[2]) ? triangle.maxX : bounds[2];
+	triangle.maxY = (triangle.maxY < bounds[3]) ? triangle.maxY : bounds[3];
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		return;
+
+	//planes for 1/w, depth and the varyings divided by w, from the snapped positions
+	double x0 = x[order[0]] / (double)SUBPIXELS, y0 = y[order[0]] / (double)SUBPIXELS;
+	double x1 = x[order[1]] / (double)SUBPIXELS - x0, y1 = y[order[1]] / (double)SUBPIXELS - y0;
+	double x2 = x[order[2]] / (double)SUBPIXELS - x0, y2 = y[order[2]] / (double)SUBPIXELS - y0;
+	double planeArea = x1 * y2 - x2 * y1;
+	triangle.originX = (float)x0;
+	triangle.originY = (float)y0;
+	triangle.planeOffset = scene->_planes.size();
+	for (unsigned int p = 0; p < FIXED_PLANES + state->varyingCount; p++)
+	{
+		double value[3];
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			unsigned int v = order[i];
+			if (p == 0)
+				value[i] = invW[v];
+			else if (p == 1)
+				value[i] = depth[v];
+			else
+				value[i] = vertices[v]->varyings[p - FIXED_PLANES] * (double)invW[v];
+		}
+		double d1 = value[1] - value[0];
+		double d2 = value[2] - value[0];
+		scene->_planes.push_back((float)value[0]);
+		scene->_planes.push_back((float)((d1 * y2 - d2 * y1) / planeArea));
+		scene->_planes.push_back((float)((d2 * x1 - d1 * x2) / planeArea));
+	}
+
+	triangle.stateIndex = stateIndex;
+	uint32_t triangleIndex = (uint32_t)scene->_triangles.size();
+	scene->_triangles.push_back(triangle);
+	scene->stats.triangles++;
+
+	for (int tileY = triangle.minY / TILE_SIZE; tileY <= triangle.maxY / TILE_SIZE; tileY++)
+	{
+		for (int tileX = triangle.minX / TILE_SIZE; tileX <= triangle.maxX / TILE_SIZE; tileX++)
+			scene->_bins[tileY * scene->tilesX + tileX].push_back(triangleIndex);
+	}
+}
+
+//Clips the triangle if it has to be, then sets up what is left of it as a fan
+static void addTriangle(HostRasterScene* scene, const HostRasterDraw* draw, unsigned int stateIndex, const int* bounds,
+	const ClipPlanes* planes, const ShadedVertex* a, const ShadedVertex* b, const ShadedVertex* c)
+{
+	const ShadedVertex* vertices[3] = { a, b, c };
+	bool inside = true;
+	for (unsigned int plane = 0; plane < CLIP_PLANE_COUNT && inside; plane++)
+	{
+		for (unsigned int i = 0; i < 3; i++)
+			inside = inside && clipDistance(planes, plane, vertices[i]->position) >= 0.0f;
+	}
+	if (inside)
+	{
+		setupTriangle(scene, draw, stateIndex, bounds, vertices);
+		return;
+	}
+
+	scene->stats.clippedTriangles++;
+	ShadedVertex polygon[MAX_CLIPPED_VERTICES];
+	polygon[0] = *a;
+	polygon[1] = *b;
+	polygon[2] = *c;
+	unsigned int count = clipPolygon(planes, scene->_states[stateIndex].varyingCount, polygon, 3);
+	for (unsigned int i = 1; i + 1 < count; i++)
+	{
+		const ShadedVertex* fan[3] = { &polygon[0], &polygon[i], &polygon[i + 1] };
+		setupTriangle(scene, draw, stateIndex, bounds, fan);
+	}
+}
+
+/*----- Scenes -----*/
+
+HostRasterScene* hostRasterCreateScene()
+{
+	HostRasterScene* scene = new HostRasterScene();
+	scene->active = false;
+	return scene;
+}
+
+void hostRasterDestroyScene(HostRasterScene* scene)
+{
+	delete scene;
+}
+
+void hostRasterBeginScene(HostRasterScene* scene, const SceGxmColorSurface* colorSurface, const SceGxmDepthStencilSurface* depthStencil,
+	const SceGxmValidRegion* validRegion)
+{
+	scene->active = _enabled && colorSurface != nullptr && colorSurface->format == SCE_GXM_COLOR_FORMAT_A8B8G8R8
+		&& colorSurface->surfaceType == SCE_GXM_COLOR_SURFACE_LINEAR;
+	if (!scene->active)
+		return;
+
+	scene->colorSurface = *colorSurface;
+	scene->hasDepth = (depthStencil != nullptr);
+	scene->backgroundDepth = (depthStencil != nullptr) ? depthStencil->backgroundDepth : 1.0f;
+	scene->bounds[0] = (validRegion != nullptr) ? (int)validRegion->xMin : 0;
+	scene->bounds[1] = (validRegion != nullptr) ? (int)validRegion->yMin : 0;
+	scene->bounds[2] = (int)colorSurface->width - 1;
+	scene->bounds[3] = (int)colorSurface->height - 1;
+	if (validRegion != nullptr)
+	{
+		scene->bounds[2] = ((int)validRegion->xMax < scene->bounds[2]) ? (int)validRegion->xMax : scene->bounds[2];
+		scene->bounds[3] = ((int)validRegion->yMax < scene->bounds[3]) ? (int)validRegion->yMax : scene->bounds[3];
+	}
+
+	scene->tilesX = (colorSurface->width + TILE_SIZE - 1) / TILE_SIZE;
+	scene->tilesY = (colorSurface->height + TILE_SIZE - 1) / TILE_SIZE;
+	scene->_bins.resize(scene->tilesX * scene->tilesY);
+	for (size_t i = 0; i < scene->_bins.size(); i++)
+		scene->_bins[i].clear();
+	scene->_states.clear();
+	scene->_triangles.clear();
+	scene->_planes.clear();
+	scene->_uniforms.clear();
+	scene->_textures.clear();
+	memset(&scene->stats, 0, sizeof(HostRasterStats));
+	scene->stats.scenes = 1;
+}
+
+void hostRasterDraw(HostRasterScene* scene, const HostRasterDraw* draw)
+{
+	if (!scene->active)
+		return;
+
+	scene->stats.draws++;
+	const HostRasterShader* vertexShader = hostFindRasterShader(draw->vertexProgram);
+	const HostRasterShader* fragmentShader = hostFindRasterShader(draw->fragmentProgram);
+	bool triangles = draw->primitive == SCE_GXM_PRIMITIVE_TRIANGLES || draw->primitive == SCE_GXM_PRIMITIVE_TRIANGLE_STRIP
+		|| draw->primitive == SCE_GXM_PRIMITIVE_TRIANGLE_FAN;
+	if (vertexShader == nullptr || vertexShader->vertexShader == nullptr || fragmentShader == nullptr
+		|| fragmentShader->fragmentShader == nullptr || !triangles)
+	{
+		scene->stats.unshadedDraws++;
+		return;
+	}
+
+	//the pixels the draw may write
+	int bounds[4] = { scene->bounds[0], scene->bounds[1], scene->bounds[2], scene->bounds[3] };
+	if (draw->clipMode == SCE_GXM_REGION_CLIP_ALL)
+		return;
+	if (draw->clipMode == SCE_GXM_REGION_CLIP_OUTSIDE)
+	{
+		bounds[0] = ((int)draw->clip[0] > bounds[0]) ? (int)draw->clip[0] : bounds[0];
+		bounds[1] = ((int)draw->clip[1] > bounds[1]) ? (int)draw->clip[1] : bounds[1];
+		bounds[2] = ((int)draw->clip[2] < bounds[2]) ? (int)draw->clip[2] : bounds[2];
+		bounds[3] = ((int)draw->clip[3] < bounds[3]) ? (int)draw->clip[3] : bounds[3];
+	}
+	if (bounds[0] > bounds[2] || bounds[1] > bounds[3] || draw->viewport[1] == 0.0f || draw->viewport[3] == 0.0f)
+		return;
+
+	//the guard band in clip space, the same distance either side whichever way the viewport points
+	ClipPlanes planes;
+	float xA = (-GUARD_BAND - draw->viewport[0]) / draw->viewport[1];
+	float xB = (GUARD_BAND - draw->viewport[0]) / draw->viewport[1];
+	float yA = (-GUARD_BAND - draw->viewport[2]) / draw->viewport[3];
+	float yB = (GUARD_BAND - draw->viewport[2]) / draw->viewport[3];
+	planes.xMin = (xA < xB) ? xA : xB;
+	planes.xMax = (xA < xB) ? xB : xA;
+	planes.yMin = (yA < yB) ? yA : yB;
+	planes.yMax = (yA < yB) ? yB : yA;
+
+	RasterState state;
+	memset(&state, 0, sizeof(RasterState));
+	state.fragmentProgram = draw->fragmentProgram;
+	state.fragmentShader = fragmentShader->fragmentShader;
+	state.varyingCount = vertexShader->varyingCount;
+	state.blendEnabled = draw->blendEnabled;
+	state.blendInfo = draw->blendInfo;
+	state.depthFunc = draw->depthFunc;
+	state.depthWrite = (draw->depthWrite == SCE_GXM_DEPTH_WRITE_ENABLED);
+	state.clipInside = (draw->clipMode == SCE_GXM_REGION_CLIP_INSIDE);
+	memcpy(state.clip, draw->clip, sizeof(state.clip));
+
+	//the fragment uniforms and textures are read when the scene ends, the caller's can change before then
+	state.uniformOffset = scene->_uniforms.size();
+	unsigned int uniformCount = draw->fragmentProgram->defaultUniformSize;
+	if (draw->fragmentUniforms != nullptr)
+		scene->_uniforms.insert(scene->_uniforms.end(), (const float*)draw->fragmentUniforms, (const float*)draw->fragmentUniforms + uniformCount);
+	else
+		scene->_uniforms.resize(scene->_uniforms.size() + uniformCount, 0.0f);
+	state.textureOffset = scene->_textures.size();
+	for (unsigned int p = 0; p < draw->fragmentProgram->parameterCount && p < HOST_GXM_MAX_PARAMETERS; p++)
+	{
+		const SceGxmProgramParameter* parameter = &draw->fragmentProgram->parameters[p];
+		if (parameter->category != SCE_GXM_PARAMETER_CATEGORY_SAMPLER)
+			continue;
+		SceGxmTexture texture;
+		memset(&texture, 0, sizeof(SceGxmTexture));
+		if (parameter->resourceIndex < SCE_GXM_MAX_TEXTURE_UNITS && draw->textureSet[parameter->resourceIndex])
+			texture = draw->textures[parameter->resourceIndex];
+		scene->_textures.push_back(texture);
+	}
+	unsigned int stateIndex = (unsigned int)scene->_states.size();
+	scene->_states.push_back(state);
+
+	unsigned int vertexCount = shadeVertices(scene, draw, vertexShader);
+
+	//assembled like the GPU does, every other strip triangle is turned around to keep the winding
+	unsigned int triangleCount = (draw->primitive == SCE_GXM_PRIMITIVE_TRIANGLES) ? draw->indexCount / 3
+		: ((draw->indexCount >= 3) ? draw->indexCount - 2 : 0);
+	for (unsigned int t = 0; t < triangleCount; t++)
+	{
+		unsigned int indices[3];
+		if (draw->primitive == SCE_GXM_PRIMITIVE_TRIANGLES)
+		{
+			indices[0] = t * 3;
+			indices[1] = t * 3 + 1;
+			indices[2] = t * 3 + 2;
+		}
+		else if (draw->primitive == SCE_GXM_PRIMITIVE_TRIANGLE_STRIP)
+		{
+			indices[0] = t + (t & 1);
+			indices[1] = t + 1 - (t & 1);
+			indices[2] = t + 2;
+		}
+		else
+		{
+			indices[0] = 0;
+			indices[1] = t + 1;
+			indices[2] = t + 2;
+		}
+
+		const ShadedVertex* vertices[3];
+		for (unsigned int i = 0; i < 3; i++)
+			vertices[i] = &scene->_vertices[scene->_vertexSlots[vertexKey(draw, vertexCount, indices[i])]];
+		addTriangle(scene, draw, stateIndex, bounds, &planes, vertices[0], vertices[1], vertices[2]);
+	}
+}
+
+/*----- Rasterizing -----*/
+
+static bool depthTest(SceGxmDepthFunc func, float depth, float stored)
+{
+	switch (func)
+	{
+	case SCE_GXM_DEPTH_FUNC_NEVER:
+		return false;
+	case SCE_GXM_DEPTH_FUNC_LESS:
+		return depth < stored;
+	case SCE_GXM_DEPTH_FUNC_EQUAL:
+		return depth == stored;
+	case SCE_GXM_DEPTH_FUNC_LESS_EQUAL:
+		return depth <= stored;
+	case SCE_GXM_DEPTH_FUNC_GREATER:
+		return depth > stored;
+	case SCE_GXM_DEPTH_FUNC_NOT_EQUAL:
+		return depth != stored;
+	case SCE_GXM_DEPTH_FUNC_GREATER_EQUAL:
+		return depth >= stored;
+	default:
+		return true;
+	}
+}
+
+static float blendFactor(unsigned int factor, const float* source, const float* destination, unsigned int channel)
+{
+	switch (factor)
+	{
+	case SCE_GXM_BLEND_FACTOR_ZERO:
+		return 0.0f;
+	case SCE_GXM_BLEND_FACTOR_SRC_COLOR:
+		return source[channel];
+	case SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_COLOR:
+		return 1.0f - source[channel];
+	case SCE_GXM_BLEND_FACTOR_SRC_ALPHA:
+		return source[3];
+	case SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA:
+		return 1.0f - source[3];
+	case SCE_GXM_BLEND_FACTOR_DST_COLOR:
+		return destination[channel];
+	case SCE_GXM_BLEND_FACTOR_ONE_MINUS_DST_COLOR:
+		return 1.0f - destination[channel];
+	case SCE_GXM_BLEND_FACTOR_DST_ALPHA:
+		return destination[3];
+	case SCE_GXM_BLEND_FACTOR_ONE_MINUS_DST_ALPHA:
+		return 1.0f - destination[3];
+	default:
+		return 1.0f;
+	}
+}
+
+static float blendChannel(unsigned int func, unsigned int sourceFactor, unsigned int destinationFactor, const float* source,
+	const float* destination, unsigned int channel)
+{
+	float s = source[channel] * blendFactor(sourceFactor, source, destination, channel);
+	float d = destination[channel] * blendFactor(destinationFactor, source, destination, channel);
+	switch (func)
+	{
+	case SCE_GXM_BLEND_FUNC_ADD:
+		return s + d;
+	case SCE_GXM_BLEND_FUNC_SUBTRACT:
+		return s - d;
+	case SCE_GXM_BLEND_FUNC_REVERSE_SUBTRACT:
+		return d - s;
+	case SCE_GXM_BLEND_FUNC_MIN:
+		return (source[channel] < destination[channel]) ? source[channel] : destination[channel];
+	case SCE_GXM_BLEND_FUNC_MAX:
+		return (source[channel] > destination[channel]) ? source[channel] : destination[channel];
+	default:
+		return source[channel];
+	}
+}
+
+//Blends a shaded color into an A8B8G8R8 pixel, red in the low byte
+static uint32_t writeColor(const RasterState* state, const float* color, uint32_t pixel)
+{
+	float source[4];
+	float destination[4];
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		source[c] = (color[c] < 0.0f) ? 0.0f : ((color[c] > 1.0f) ? 1.0f : color[c]);
+		destination[c] = ((pixel >> (c * 8)) & 0xFF) / 255.0f;
+	}
+
+	unsigned int colorMask = SCE_GXM_COLOR_MASK_ALL;
+	float result[4] = { source[0], source[1], source[2], source[3] };
+	if (state->blendEnabled)
+	{
+		const SceGxmBlendInfo* blend = &state->blendInfo;
+		colorMask = blend->colorMask;
+		for (unsigned int c = 0; c < 3; c++)
+			result[c] = blendChannel(blend->colorFunc, blend->colorSrc, blend->colorDst, source, destination, c);
+		result[3] = blendChannel(blend->alphaFunc, blend->alphaSrc, blend->alphaDst, source, destination, 3);
+	}
+
+	//the mask bits are A, R, G, B from the lowest up
+	static const unsigned int channelMasks[4] = { SCE_GXM_COLOR_MASK_R, SCE_GXM_COLOR_MASK_G, SCE_GXM_COLOR_MASK_B, SCE_GXM_COLOR_MASK_A };
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		if ((colorMask & channelMasks[c]) == 0)
+			continue;
+		float value = (result[c] < 0.0f) ? 0.0f : ((result[c] > 1.0f) ? 1.0f : result[c]);
+		uint32_t byte = (uint32_t)(value * 255.0f + 0.5f);
+		pixel = (pixel & ~(0xFFu << (c * 8))) | (byte << (c * 8));
+	}
+	return pixel;
+}
+
+//Works out coverage and interpolated values for the 4 pixels from x, edges are the edge functions at each of them.
+//laneMask says which of the pixels are in the row
+static void interpolateQuad(const RasterTriangle* triangle, const float* planes, unsigned int varyingCount, int x, float pixelY,
+	int32_t edges[3][4], unsigned int laneMask, PixelQuad* quad)
+{
+	float pixelX = ((float)x + 0.5f) - triangle->originX;
+#ifdef __SSE2__
+	//a pixel is outside when any of its edge functions has the sign bit set
+	__m128i outside = _mm_or_si128(_mm_or_si128(_mm_loadu_si128((const __m128i*)edges[0]), _mm_loadu_si128((const __m128i*)edges[1])),
+		_mm_loadu_si128((const __m128i*)edges[2]));
+	quad->mask = ~(unsigned int)_mm_movemask_ps(_mm_castsi128_ps(outside)) & laneMask;
+	if (quad->mask == 0)
+		return;
+
+	__m128 fx = _mm_add_ps(_mm_set1_ps(pixelX), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+	__m128 fy = _mm_set1_ps(pixelY);
+	__m128 invW = _mm_add_ps(_mm_add_ps(_mm_set1_ps(planes[0]), _mm_mul_ps(_mm_set1_ps(planes[1]), fx)), _mm_mul_ps(_mm_set1_ps(planes[2]), fy));
+	_mm_storeu_ps(quad->invW, invW);
+	const float* plane = planes + PLANE_SIZE;
+	__m128 depth = _mm_add_ps(_mm_add_ps(_mm_set1_ps(plane[0]), _mm_mul_ps(_mm_set1_ps(plane[1]), fx)), _mm_mul_ps(_mm_set1_ps(plane[2]), fy));
+	_mm_storeu_ps(quad->depth, depth);
+	for (unsigned int v = 0; v < varyingCount; v++)
+	{
+		plane = planes + (FIXED_PLANES + v) * PLANE_SIZE;
+		__m128 value = _mm_add_ps(_mm_add_ps(_mm_set1_ps(plane[0]), _mm_mul_ps(_mm_set1_ps(plane[1]), fx)), _mm_mul_ps(_mm_set1_ps(plane[2]), fy));
+		_mm_storeu_ps(quad->varyings[v], _mm_div_ps(value, invW));
+	}
+#else
+	quad->mask = 0;
+	for (unsigned int lane = 0; lane < 4; lane++)
+	{
+		if ((edges[0][lane] | edges[1][lane] | edges[2][lane]) >= 0)
+			quad->mask |= 1 << lane;
+	}
+	quad->mask &= laneMask;
+	if (quad->mask == 0)
+		return;
+
+	for (unsigned int lane = 0; lane < 4; lane++)
+	{
+		float fx = pixelX + (float)lane;
+		quad->invW[lane] = planes[0] + planes[1] * fx + planes[2] * pixelY;
+		const float* plane = planes + PLANE_SIZE;
+		quad->depth[lane] = plane[0] + plane[1] * fx + plane[2] * pixelY;
+		for (unsigned int v = 0; v < varyingCount; v++)
+		{
+			plane = planes + (FIXED_PLANES + v) * PLANE_SIZE;
+			quad->varyings[v][lane] = (plane[0] + plane[1] * fx + plane[2] * pixelY) / quad->invW[lane];
+		}
+	}
+#endif
+}
+
+/*	Draws the pixels xStart to xEnd of row y. Each edge function is worked out at both ends in
+64 bits first: an edge that has the whole span on its inside is left out, one with the span
+outside rejects it, so only edges crossing the span are stepped, and those stay in 32 bits
+*/
+static unsigned int rasterizeRow(HostRasterScene* scene, const RasterTriangle* triangle, const RasterState* state, int y, int xStart,
+	int xEnd, float* depthRow, int tileX)
+{
+	int32_t edges[3][4];
+	int32_t steps[3];
+	int64_t pixelY = (int64_t)y * SUBPIXELS + SUBPIXELS / 2;
+	int64_t pixelX = (int64_t)xStart * SUBPIXELS + SUBPIXELS / 2;
+	for (unsigned int e = 0; e < 3; e++)
+	{
+		int64_t start = triangle->edgeA[e] * pixelX + triangle->edgeB[e] * pixelY + triangle->edgeC[e];
+		int64_t step = (int64_t)triangle->edgeA[e] * SUBPIXELS;
+		int64_t end = start + step * (xEnd - xStart);
+		if (start < 0 && end < 0)
+			return 0;
+		bool inside = (start >= 0 && end >= 0);
+		steps[e] = inside ? 0 : (int32_t)step;
+		for (int lane = 0; lane < 4; lane++)
+			edges[e][lane] = inside ? 0 : (int32_t)start + steps[e] * lane;
+	}
+
+	const float* planes = &scene->_planes[triangle->planeOffset];
+	float fy = ((float)y + 0.5f) - triangle->originY;
+	uint32_t* row = (uint32_t*)scene->colorSurface.data + (size_t)y * scene->colorSurface.strideInPixels;
+	unsigned int pixels = 0;
+	for (int x = xStart; x <= xEnd; x += 4)
+	{
+		unsigned int laneMask = (xEnd - x >= 3) ? 0xF : ((1u << (xEnd - x + 1)) - 1);
+		PixelQuad quad;
+		interpolateQuad(triangle, planes, state->varyingCount, x, fy, edges, laneMask, &quad);
+		for (unsigned int e = 0; e < 3; e++)
+		{
+			for (unsigned int lane = 0; lane < 4; lane++)
+				edges[e][lane] += steps[e] * 4;
+		}
+
+		for (unsigned int lane = 0; lane < 4; lane++)
+		{
+			if ((quad.mask & (1 << lane)) == 0)
+				continue;
+			int pixelXLane = x + (int)lane;
+			if (state->clipInside && pixelXLane >= (int)state->clip[0] && pixelXLane <= (int)state->clip[2]
+				&& y >= (int)state->clip[1] && y <= (int)state->clip[3])
+				continue;
+
+			float* depth = &depthRow[pixelXLane - tileX];
+			if (scene->hasDepth)
+			{
+				if (!depthTest(state->depthFunc, quad.depth[lane], *depth))
+					continue;
+				if (state->depthWrite)
+					*depth = quad.depth[lane];
+			}
+
+			float varyings[HOST_RASTER_MAX_VARYINGS];
+			for (unsigned int v = 0; v < state->varyingCount; v++)
+				varyings[v] = quad.varyings[v][lane];
+			float color[4];
+			state->fragmentShader(&state->inputs, varyings, color);
+			row[pixelXLane] = writeColor(state, color, row[pixelXLane]);
+			pixels++;
+		}
+	}
+	return pixels;
+}
+
+static SceUInt64 rasterizeTile(HostRasterScene* scene, unsigned int tile)
+{
+	int tileX = (int)(tile % scene->tilesX) * TILE_SIZE;
+	int tileY = (int)(tile / scene->tilesX) * TILE_SIZE;
+	float depthBuffer[TILE_SIZE * TILE_SIZE];
+	for (unsigned int i = 0; i < TILE_SIZE * TILE_SIZE; i++)
+		depthBuffer[i] = scene->backgroundDepth;
+
+	SceUInt64 pixels = 0;
+	const std::vector<uint32_t>* bin = &scene->_bins[tile];
+	for (size_t i = 0; i < bin->size(); i++)
+	{
+		const RasterTriangle* triangle = &scene->_triangles[(*bin)[i]];
+		const RasterState* state = &scene->_states[triangle->stateIndex];
+		int xStart = (triangle->minX > tileX) ? triangle->minX : tileX;
+		int xEnd = (triangle->maxX < tileX + TILE_SIZE - 1) ? triangle->maxX : tileX + TILE_SIZE - 1;
+		int yStart = (triangle->minY > tileY) ? triangle->minY : tileY;
+		int yEnd = (triangle->maxY < tileY + TILE_SIZE - 1) ? triangle->maxY : tileY + TILE_SIZE - 1;
+		for (int y = yStart; y <= yEnd; y++)
+			pixels += rasterizeRow(scene, triangle, state, y, xStart, xEnd, &depthBuffer[(y - tileY) * TILE_SIZE], tileX);
+	}
+	return pixels;
+}
+
+static void rasterWorker(RasterWorker* worker)
+{
+	for (;;)
+	{
+		unsigned int next = worker->nextTile->fetch_add(1);
+		if (next >= worker->tiles->size())
+			return;
+		worker->pixels += rasterizeTile(worker->scene, (*worker->tiles)[next]);
+	}
+}
+
+//Points every state's shader inputs at its copies, which no longer move once the scene has ended
+static void resolveInputs(HostRasterScene* scene)
+{
+	for (size_t i = 0; i < scene->_states.size(); i++)
+	{
+		RasterState* state = &scene->_states[i];
+		const SceGxmProgram* program = state->fragmentProgram;
+		size_t texture = state->textureOffset;
+		for (unsigned int p = 0; p < HOST_GXM_MAX_PARAMETERS; p++)
+		{
+			state->inputs.parameters[p] = nullptr;
+			if (p >= program->parameterCount)
+				continue;
+
+			const SceGxmProgramParameter* parameter = &program->parameters[p];
+			if (parameter->category == SCE_GXM_PARAMETER_CATEGORY_UNIFORM && state->uniformOffset + parameter->resourceIndex < scene->_uniforms.size())
+				state->inputs.parameters[p] = &scene->_uniforms[state->uniformOffset + parameter->resourceIndex];
+			else if (parameter->category == SCE_GXM_PARAMETER_CATEGORY_SAMPLER)
+			{
+				if (scene->_textures[texture].data != nullptr)
+					state->inputs.parameters[p] = &scene->_textures[texture];
+				texture++;
+			}
+		}
+	}
+}
+
+void hostRasterEndScene(HostRasterScene* scene)
+{
+	if (!scene->active)
+		return;
+	scene->active = false;
+
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+	resolveInputs(scene);
+	std::vector<unsigned int> tiles;
+	for (unsigned int i = 0; i < scene->_bins.size(); i++)
+	{
+		if (!scene->_bins[i].empty())
+			tiles.push_back(i);
+	}
+
+	unsigned int threadCount = _threadCount;
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+	if (threadCount > tiles.size())
+		threadCount = tiles.empty() ? 1 : (unsigned int)tiles.size();
+
+	//the calling thread is one of the workers
+	std::atomic<unsigned int> nextTile(0);
+	std::vector<RasterWorker> workers(threadCount);
+	std::vector<std::thread> threads;
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers[i].scene = scene;
+		workers[i].tiles = &tiles;
+		workers[i].nextTile = &nextTile;
+		workers[i].pixels = 0;
+		if (i > 0)
+			threads.push_back(std::thread(rasterWorker, &workers[i]));
+	}
+	rasterWorker(&workers[0]);
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		scene->stats.pixels += workers[i].pixels;
+	scene->stats.rasterTime = sceKernelGetProcessTimeWide() - start;
+
+	std::lock_guard<std::mutex> lock(_statsMutex);
+	_stats.scenes += scene->stats.scenes;
+	_stats.draws += scene->stats.draws;
+	_stats.unshadedDraws += scene->stats.unshadedDraws;
+	_stats.triangles += scene->stats.triangles;
+	_stats.culledTriangles += scene->stats.culledTriangles;
+	_stats.clippedTriangles += scene->stats.clippedTriangles;
+	_stats.pixels += scene->stats.pixels;
+	_stats.rasterTime += scene->stats.rasterTime;
+}
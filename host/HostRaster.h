@@ -0,0 +1,85 @@
+#pragma once
+
+//----------------------------------------------
+// Host software rasterizer
+// What the gxm stand-in draws with when hostSetRasterizer() turned it on. A scene's draws are
+// vertex shaded and binned into tiles as they are submitted, the tiles are rasterized into the
+// scene's color surface when it ends. Shading is done by C++ versions of the shaders, looked up
+// by the program's name, see HostShaders.cpp. Draws with a program that has none are validated
+// like any other but leave no pixels, HostRasterStats::unshadedDraws counts them
+//-----------------------------------------------
+
+#include <psp2/gxm.h>
+
+//floats a vertex shader can hand to the fragment shader
+#define HOST_RASTER_MAX_VARYINGS	8
+
+//What a C++ shader reads, one entry for each parameter of its program in the program's order:
+//an attribute points at its 4 components as fetched (missing ones are 0, 0, 0, 1), a uniform at
+//its floats in the default uniform buffer or its uniform buffer (vertex shaders only) and a sampler
+//at the bound SceGxmTexture (nullptr if none)
+typedef struct HostShaderInputs
+{
+	const void* parameters[HOST_GXM_MAX_PARAMETERS];
+} HostShaderInputs;
+
+//position is the clip space position, varyings HostRasterShader::varyingCount floats
+typedef void (*HostVertexShader)(const HostShaderInputs* inputs, float* position, float* varyings);
+//varyings are interpolated perspective correct, color is RGBA 0 to 1
+typedef void (*HostFragmentShader)(const HostShaderInputs* inputs, const float* varyings, float* color);
+
+typedef struct HostRasterShader
+{
+	SceGxmProgramType type;
+	const char* name;					//matches SceGxmProgram::name
+	HostVertexShader vertexShader;		//for SCE_GXM_VERTEX_PROGRAM
+	HostFragmentShader fragmentShader;	//for SCE_GXM_FRAGMENT_PROGRAM
+	unsigned int varyingCount;			//written by the vertex shader
+} HostRasterShader;
+
+//The C++ shader for a program, nullptr if there is none
+const HostRasterShader* hostFindRasterShader(const SceGxmProgram* program);
+
+//Everything a draw reads, gathered by sceGxmDraw() from the context
+typedef struct HostRasterDraw
+{
+	const SceGxmProgram* vertexProgram;
+	const SceGxmProgram* fragmentProgram;
+	const SceGxmVertexAttribute* attributes;
+	unsigned int attributeCount;
+	const SceGxmVertexStream* streams;
+	const void* const* streamData;
+	const void* vertexUniforms;				//default uniform buffers, nullptr when not reserved
+	const void* fragmentUniforms;
+	const void* const* vertexUniformBuffers;	//SCE_GXM_MAX_UNIFORM_BUFFERS of them, for BUFFER[n] uniforms
+	const SceGxmTexture* textures;			//SCE_GXM_MAX_TEXTURE_UNITS of them
+	const bool* textureSet;
+	bool blendEnabled;
+	SceGxmBlendInfo blendInfo;
+
+	SceGxmPrimitiveType primitive;
+	SceGxmIndexFormat indexFormat;
+	const void* indexData;
+	unsigned int indexCount;
+	unsigned int indexWrap;					//indices an instance reads, indexCount unless the draw is instanced
+
+	SceGxmCullMode cullMode;
+	SceGxmDepthFunc depthFunc;
+	SceGxmDepthWriteMode depthWrite;
+	SceGxmRegionClipMode clipMode;
+	const unsigned int* clip;				//xMin, yMin, xMax, yMax
+	const float* viewport;					//xOffset, xScale, yOffset, yScale, zOffset, zScale
+} HostRasterDraw;
+
+//One per context, what its current scene has binned
+struct HostRasterScene;
+
+HostRasterScene* hostRasterCreateScene();
+void hostRasterDestroyScene(HostRasterScene* scene);
+
+//Nothing is kept for a scene begun while the rasterizer is off, or without a linear A8B8G8R8 color surface
+void hostRasterBeginScene(HostRasterScene* scene, const SceGxmColorSurface* colorSurface, const SceGxmDepthStencilSurface* depthStencil,
+	const SceGxmValidRegion* validRegion);
+void hostRasterDraw(HostRasterScene* scene, const HostRasterDraw* draw);
+//Rasterizes the scene's tiles, on as many threads as hostSetRasterizer() asked for, and returns once the surface is written
+void hostRasterEndScene(HostRasterScene* scene);
@@ -0,0 +1,282 @@
+//----------------------------------------------
+// Host stand-in programs
+// One for each shader the Makefile links into the Vita build, under the same symbol.
+// Each lists the parameters of its .cg file in src/shaders, the resource indices are the
+// stand-in's own packing: attributes 4 registers apart, uniforms packed on 4 component
+// boundaries in the default uniform buffer or their BUFFER[n], samplers by texture unit.
+// The shaders the software rasterizer can run are at the end, C++ versions of the .cg files
+//-----------------------------------------------
+
+#include <psp2/gxm.h>
+
+#include "HostRaster.h"
+
+#include <string.h>
+
+#define HOST_PROGRAM(type, name, uniformSize, count)	HOST_GXM_PROGRAM_MAGIC, sizeof(SceGxmProgram), type, name, uniformSize, count
+#define ATTRIBUTE(name, components, reg)		{ name, SCE_GXM_PARAMETER_CATEGORY_ATTRIBUTE, components, 1, reg, 0 }
+#define UNIFORM(name, components, index)		{ name, SCE_GXM_PARAMETER_CATEGORY_UNIFORM, components, 1, index, SCE_GXM_DEFAULT_UNIFORM_BUFFER_CONTAINER_INDEX }
+#define BUFFER_UNIFORM(name, components, index, buffer)	{ name, SCE_GXM_PARAMETER_CATEGORY_UNIFORM, components, 1, index, buffer }
+#define BUFFER_UNIFORM_ARRAY(name, components, count, index, buffer)	{ name, SCE_GXM_PARAMETER_CATEGORY_UNIFORM, components, count, index, buffer }
+#define SAMPLER(name, unit)						{ name, SCE_GXM_PARAMETER_CATEGORY_SAMPLER, 4, 1, unit, 0 }
+
+/*----- Prebuilt shaders, src/shaders/compiled -----*/
+
+//clear_vertex.cg
+extern const SceGxmProgram clear_v_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_VERTEX_PROGRAM, "clear", 0, 1),
+	{
+		ATTRIBUTE("aPosition", 2, 0)
+	}
+};
+
+//clear_fragment.cg
+extern const SceGxmProgram clear_f_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_FRAGMENT_PROGRAM, "clear", 0, 0),
+	{}
+};
+
+//basic_vertex.cg
+extern const SceGxmProgram color_v_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_VERTEX_PROGRAM, "color", 16, 3),
+	{
+		ATTRIBUTE("aPosition", 3, 0),
+		ATTRIBUTE("aColor", 4, 4),
+		UNIFORM("wvp", 16, 0)
+	}
+};
+
+//basic_fragment.cg
+extern const SceGxmProgram color_f_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_FRAGMENT_PROGRAM, "color", 0, 0),
+	{}
+};
+
+/*----- Shaders built from source -----*/
+
+extern const SceGxmProgram blit_v_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_VERTEX_PROGRAM, "blit", 4, 2),
+	{
+		ATTRIBUTE("aPosition", 2, 0),
+		UNIFORM("uvScale", 2, 0)
+	}
+};
+
+extern const SceGxmProgram blit_f_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_FRAGMENT_PROGRAM, "blit", 4, 2),
+	{
+		SAMPLER("source", 0),
+		UNIFORM("uvMax", 2, 0)
+	}
+};
+
+extern const SceGxmProgram mesh_v_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_VERTEX_PROGRAM, "mesh", 16, 4),
+	{
+		ATTRIBUTE("aPosition", 3, 0),
+		ATTRIBUTE("aNormal", 2, 4),
+		ATTRIBUTE("aTexcoord", 2, 8),
+		UNIFORM("wvp", 16, 0)
+	}
+};
+
+extern const SceGxmProgram mesh_f_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_FRAGMENT_PROGRAM, "mesh", 8, 2),
+	{
+		UNIFORM("lightDirection", 3, 0),
+		UNIFORM("color", 4, 4)
+	}
+};
+
+extern const SceGxmProgram mesh_fade_f_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_FRAGMENT_PROGRAM, "mesh_fade", 12, 3),
+	{
+		UNIFORM("lightDirection", 3, 0),
+		UNIFORM("color", 4, 4),
+		UNIFORM("lodFade", 1, 8)
+	}
+};
+
+extern const SceGxmProgram mesh_textured_f_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_FRAGMENT_PROGRAM, "mesh_textured", 8, 3),
+	{
+		UNIFORM("lightDirection", 3, 0),
+		UNIFORM("color", 4, 4),
+		SAMPLER("diffuseTexture", 0)
+	}
+};
+
+extern const SceGxmProgram object_v_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_VERTEX_PROGRAM, "object", 0, 3),
+	{
+		ATTRIBUTE("aPosition", 3, 0),
+		ATTRIBUTE("aColor", 4, 4),
+		BUFFER_UNIFORM("wvp", 16, 0, 0)
+	}
+};
+
+extern const SceGxmProgram particle_v_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_VERTEX_PROGRAM, "particle", 4, 4),
+	{
+		ATTRIBUTE("aCorner", 2, 0),
+		ATTRIBUTE("aParticle", 3, 4),
+		ATTRIBUTE("aColor", 4, 8),
+		UNIFORM("screenTransform", 4, 0)
+	}
+};
+
+extern const SceGxmProgram particle_f_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_FRAGMENT_PROGRAM, "particle", 0, 0),
+	{}
+};
+
+//palette is SKIN_MAX_BONES * 3 rows
+extern const SceGxmProgram skinned_v_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_VERTEX_PROGRAM, "skinned", 16, 6),
+	{
+		ATTRIBUTE("aPosition", 3, 0),
+		ATTRIBUTE("aBoneIndices", 4, 4),
+		ATTRIBUTE("aBoneWeights", 4, 8),
+		ATTRIBUTE("aColor", 4, 12),
+		UNIFORM("viewProjection", 16, 0),
+		BUFFER_UNIFORM_ARRAY("palette", 4, 32 * 3, 0, 0)
+	}
+};
+
+extern const SceGxmProgram sprite_v_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_VERTEX_PROGRAM, "sprite", 4, 4),
+	{
+		ATTRIBUTE("aPosition", 2, 0),
+		ATTRIBUTE("aTexcoord", 2, 4),
+		ATTRIBUTE("aColor", 4, 8),
+		UNIFORM("screenTransform", 4, 0)
+	}
+};
+
+extern const SceGxmProgram sprite_f_gxp_start = {
+	HOST_PROGRAM(SCE_GXM_FRAGMENT_PROGRAM, "sprite", 0, 1),
+	{
+		SAMPLER("spriteTexture", 0)
+	}
+};
+
+/*----- C++ shaders for the software rasterizer -----*/
+
+//clear_vertex.cg: the position as it is, on the far plane
+static void clearVertex(const HostShaderInputs* inputs, float* position, float* varyings)
+{
+	const float* aPosition = (const float*)inputs->parameters[0];
+	position[0] = aPosition[0];
+	position[1] = aPosition[1];
+	position[2] = 1.0f;
+	position[3] = 1.0f;
+}
+
+//clear_fragment.cg: transparent black
+static void clearFragment(const HostShaderInputs* inputs, const float* varyings, float* color)
+{
+	color[0] = 0.0f;
+	color[1] = 0.0f;
+	color[2] = 0.0f;
+	color[3] = 0.0f;
+}
+
+//basic_vertex.cg: mul(float4(aPosition, 1), wvp) takes the position as a row vector, the color is passed on.
+//object_vertex.cg does the same with wvp in uniform buffer 0
+static void colorVertex(const HostShaderInputs* inputs, float* position, float* varyings)
+{
+	const float* aPosition = (const float*)inputs->parameters[0];
+	const float* aColor = (const float*)inputs->parameters[1];
+	const float* wvp = (const float*)inputs->parameters[2];
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		position[i] = aPosition[0] * wvp[i] + aPosition[1] * wvp[4 + i] + aPosition[2] * wvp[8 + i] + wvp[12 + i];
+		varyings[i] = aColor[i];
+	}
+}
+
+//basic_fragment.cg: the interpolated color
+static void colorFragment(const HostShaderInputs* inputs, const float* varyings, float* color)
+{
+	for (unsigned int i = 0; i < 4; i++)
+		color[i] = varyings[i];
+}
+
+//particle_vertex.cg: the corner scaled by half the size around the particle, pixels to clip space. The corner and color are passed on
+static void particleVertex(const HostShaderInputs* inputs, float* position, float* varyings)
+{
+	const float* aCorner = (const float*)inputs->parameters[0];
+	const float* aParticle = (const float*)inputs->parameters[1];
+	const float* aColor = (const float*)inputs->parameters[2];
+	const float* screenTransform = (const float*)inputs->parameters[3];
+	float x = aParticle[0] + aCorner[0] * aParticle[2] * 0.5f;
+	float y = aParticle[1] + aCorner[1] * aParticle[2] * 0.5f;
+	position[0] = x * screenTransform[0] + screenTransform[2];
+	position[1] = y * screenTransform[1] + screenTransform[3];
+	position[2] = 0.0f;
+	position[3] = 1.0f;
+	varyings[0] = aCorner[0];
+	varyings[1] = aCorner[1];
+	for (unsigned int i = 0; i < 4; i++)
+		varyings[2 + i] = aColor[i];
+}
+
+//particle_fragment.cg: the color with its alpha falling off towards the edge of the circle
+static void particleFragment(const HostShaderInputs* inputs, const float* varyings, float* color)
+{
+	float falloff = 1.0f - (varyings[0] * varyings[0] + varyings[1] * varyings[1]);
+	falloff = (falloff < 0.0f) ? 0.0f : ((falloff > 1.0f) ? 1.0f : falloff);
+	color[0] = varyings[2];
+	color[1] = varyings[3];
+	color[2] = varyings[4];
+	color[3] = varyings[5] * falloff;
+}
+
+//skinned_vertex.cg: the position moved by each of its bones' 3x4 palette matrix and mixed by the weights, then
+//taken through viewProjection as a row vector. The color is passed on
+static void skinnedVertex(const HostShaderInputs* inputs, float* position, float* varyings)
+{
+	const float* aPosition = (const float*)inputs->parameters[0];
+	const float* aBoneIndices = (const float*)inputs->parameters[1];
+	const float* aBoneWeights = (const float*)inputs->parameters[2];
+	const float* aColor = (const float*)inputs->parameters[3];
+	const float* viewProjection = (const float*)inputs->parameters[4];
+	const float* palette = (const float*)inputs->parameters[5];
+	float skinned[3] = { 0.0f, 0.0f, 0.0f };
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		const float* matrix = palette + (unsigned int)aBoneIndices[i] * 12;
+		for (unsigned int r = 0; r < 3; r++)
+		{
+			const float* row = matrix + r * 4;
+			skinned[r] += aBoneWeights[i] * (row[0] * aPosition[0] + row[1] * aPosition[1] + row[2] * aPosition[2] + row[3]);
+		}
+	}
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		position[i] = skinned[0] * viewProjection[i] + skinned[1] * viewProjection[4 + i] + skinned[2] * viewProjection[8 + i] +
+			viewProjection[12 + i];
+		varyings[i] = aColor[i];
+	}
+}
+
+static const HostRasterShader _rasterShaders[] = {
+	{ SCE_GXM_VERTEX_PROGRAM, "clear", clearVertex, nullptr, 0 },
+	{ SCE_GXM_FRAGMENT_PROGRAM, "clear", nullptr, clearFragment, 0 },
+	{ SCE_GXM_VERTEX_PROGRAM, "color", colorVertex, nullptr, 4 },
+	{ SCE_GXM_VERTEX_PROGRAM, "object", colorVertex, nullptr, 4 },
+	{ SCE_GXM_FRAGMENT_PROGRAM, "color", nullptr, colorFragment, 0 },
+	{ SCE_GXM_VERTEX_PROGRAM, "particle", particleVertex, nullptr, 6 },
+	{ SCE_GXM_FRAGMENT_PROGRAM, "particle", nullptr, particleFragment, 0 },
+	{ SCE_GXM_VERTEX_PROGRAM, "skinned", skinnedVertex, nullptr, 4 }
+};
+
+const HostRasterShader* hostFindRasterShader(const SceGxmProgram* program)
+{
+	for (unsigned int i = 0; i < sizeof(_rasterShaders) / sizeof(_rasterShaders[0]); i++)
+	{
+		if (program->type == (uint32_t)_rasterShaders[i].type && strncmp(program->name, _rasterShaders[i].name, HOST_GXM_NAME_LENGTH) == 0)
+			return &_rasterShaders[i];
+	}
+	return nullptr;
+}
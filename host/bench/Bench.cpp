@@ -0,0 +1,173 @@
+#include "Bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+//warmup stops growing the iteration count here, whatever a repetition takes
+#define MAX_ITERATIONS		(1u << 24)
+
+void getDefaultBenchOptions(BenchOptions* options)
+{
+	options->warmup = 3;
+	options->repetitions = 30;
+	options->minRepetitionTime = 2000000;
+	options->filter = nullptr;
+}
+
+static SceUInt64 nanoseconds()
+{
+	return (SceUInt64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static SceUInt64 timeRepetition(BenchFunction function, void* userData, unsigned int iterations)
+{
+	SceUInt64 start = nanoseconds();
+	function(userData, iterations);
+	return nanoseconds() - start;
+}
+
+//Nearest rank percentile of sorted times
+static double percentile(const std::vector<double>* sorted, double percent)
+{
+	size_t rank = (size_t)((percent / 100.0) * sorted->size() + 0.999999);
+	if (rank < 1)
+		rank = 1;
+	if (rank > sorted->size())
+		rank = sorted->size();
+	return (*sorted)[rank - 1];
+}
+
+Bench::Bench(const BenchOptions* options)
+{
+	this->options = *options;
+	if (this->options.repetitions == 0)
+		this->options.repetitions = 1;
+}
+
+Bench::~Bench()
+{
+
+}
+
+void Bench::run(const char* name, BenchFunction function, void* userData, unsigned int iterations, bool fixedIterations)
+{
+	if (options.filter != nullptr && strstr(name, options.filter) == nullptr)
+		return;
+	if (iterations == 0)
+		iterations = 1;
+
+	//the count only grows while the repetitions are too short to time well
+	for (unsigned int i = 0; i < options.warmup; i++)
+	{
+		SceUInt64 time = timeRepetition(function, userData, iterations);
+		while (!fixedIterations && time < options.minRepetitionTime && iterations < MAX_ITERATIONS)
+		{
+			iterations *= 2;
+			time = timeRepetition(function, userData, iterations);
+		}
+	}
+
+	std::vector<double> times(options.repetitions);
+	double total = 0.0;
+	for (unsigned int i = 0; i < options.repetitions; i++)
+	{
+		times[i] = (double)timeRepetition(function, userData, iterations) / iterations;
+		total += times[i];
+	}
+	std::sort(times.begin(), times.end());
+
+	BenchResult result;
+	memset(&result, 0, sizeof(BenchResult));
+	snprintf(result.name, sizeof(result.name), "%s", name);
+	result.iterations = iterations;
+	result.repetitions = options.repetitions;
+	result.mean = total / options.repetitions;
+	result.min = times.front();
+	result.p50 = percentile(&times, 50.0);
+	result.p90 = percentile(&times, 90.0);
+	result.p99 = percentile(&times, 99.0);
+	result.max = times.back();
+	_results.push_back(result);
+
+	printf("%-32s %12.1f ns median, %12.1f p90, %12.1f p99 (%u x %u)\n", result.name, result.p50, result.p90, result.p99,
+		result.repetitions, result.iterations);
+	fflush(stdout);
+}
+
+void Bench::printResults()
+{
+	printf("\n%-32s %12s %12s %12s %12s %12s %12s\n", "case (ns per iteration)", "min", "median", "p90", "p99", "max", "mean");
+	for (size_t i = 0; i < _results.size(); i++)
+	{
+		const BenchResult* result = &_results[i];
+		printf("%-32s %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f\n", result->name, result->min, result->p50, result->p90, result->p99,
+			result->max, result->mean);
+	}
+}
+
+bool Bench::writeJson(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (file == nullptr)
+		return false;
+
+	fprintf(file, "{\n\t\"unit\": \"ns per iteration\",\n\t\"benchmarks\": [\n");
+	for (size_t i = 0; i < _results.size(); i++)
+	{
+		const BenchResult* result = &_results[i];
+		fprintf(file, "\t\t{ \"name\": \"%s\", \"iterations\": %u, \"repetitions\": %u, \"mean\": %.1f, \"min\": %.1f, "
+			"\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f }%s\n", result->name, result->iterations, result->repetitions,
+			result->mean, result->min, result->p50, result->p90, result->p99, result->max, (i + 1 < _results.size()) ? "," : "");
+	}
+	fprintf(file, "\t]\n}\n");
+	return fclose(file) == 0;
+}
+
+bool Bench::compareBaseline(const char* path, double threshold)
+{
+	FILE* file = fopen(path, "r");
+	if (file == nullptr)
+	{
+		printf("could not read the baseline %s\n", path);
+		return false;
+	}
+	std::string json;
+	char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		json.append(buffer, read);
+	fclose(file);
+
+	//only what writeJson() writes is understood: a case's name, then its median further on in the same object
+	printf("\n%-32s %12s %12s %9s   against %s\n", "case", "baseline", "now", "change", path);
+	unsigned int regressions = 0;
+	for (size_t i = 0; i < _results.size(); i++)
+	{
+		const BenchResult* result = &_results[i];
+		std::string key = std::string("\"name\": \"") + result->name + "\"";
+		size_t found = json.find(key);
+		size_t median = (found != std::string::npos) ? json.find("\"p50\":", found) : std::string::npos;
+		size_t end = (found != std::string::npos) ? json.find('}', found) : std::string::npos;
+		if (median == std::string::npos || median > end)
+		{
+			printf("%-32s %12s %12.1f %9s\n", result->name, "-", result->p50, "new");
+			continue;
+		}
+
+		double baseline = strtod(json.c_str() + median + strlen("\"p50\":"), nullptr);
+		double change = (baseline > 0.0) ? (result->p50 / baseline - 1.0) * 100.0 : 0.0;
+		bool regressed = change > threshold;
+		if (regressed)
+			regressions++;
+		printf("%-32s %12.1f %12.1f %+8.1f%%%s\n", result->name, baseline, result->p50, change, regressed ? "   REGRESSION" : "");
+	}
+
+	if (regressions > 0)
+		printf("%u of %u cases are more than %.1f%% slower than the baseline\n", regressions, (unsigned int)_results.size(), threshold);
+	return regressions == 0;
+}
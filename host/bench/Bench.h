@@ -0,0 +1,69 @@
+#pragma once
+
+//----------------------------------------------
+// Bench Class
+// A small benchmark harness for the host build. A case is a function that does its work a
+// given number of times, timed as a whole. The warmup repetitions aren't recorded and double
+// the iteration count until a repetition takes long enough to time, then every repetition is
+// timed and the results are percentiles of the time one iteration took.
+// Results print as a table, can be written as JSON and compared with an earlier JSON file,
+// where a case whose median got slower than the threshold is a regression
+//-----------------------------------------------
+
+#include <vector>
+
+#include <psp2/types.h>
+
+//Does the case's work iterations times
+typedef void (*BenchFunction)(void* userData, unsigned int iterations);
+
+//Makes the compiler assume what data points at is read, so work whose result is never used isn't optimized away
+inline void benchKeep(const void* data)
+{
+	__asm__ __volatile__("" : : "r"(data) : "memory");
+}
+
+typedef struct BenchOptions
+{
+	unsigned int warmup;			//repetitions that aren't recorded
+	unsigned int repetitions;
+	SceUInt64 minRepetitionTime;	//nanoseconds the warmup grows a repetition to
+	const char* filter;				//only cases with this in their name, nullptr runs all
+} BenchOptions;
+
+//Times are nanoseconds per iteration
+typedef struct BenchResult
+{
+	char name[64];
+	unsigned int iterations;		//per repetition
+	unsigned int repetitions;
+	double mean;
+	double min;
+	double p50;
+	double p90;
+	double p99;
+	double max;
+} BenchResult;
+
+void getDefaultBenchOptions(BenchOptions* options);
+
+class Bench
+{
+public:
+	Bench(const BenchOptions* options);
+	~Bench();
+
+	//Runs a case starting at iterations a repetition. With fixedIterations the count is left as it is,
+	//for cases like a whole frame that are long enough and shouldn't be run twice in a row
+	void run(const char* name, BenchFunction function, void* userData, unsigned int iterations, bool fixedIterations);
+
+	void printResults();
+	bool writeJson(const char* path);
+	//Compares every case's median with the same case in a file from writeJson(). False when any is more than
+	//threshold percent slower, or the file can't be read
+	bool compareBaseline(const char* path, double threshold);
+
+private:
+	BenchOptions options;
+	std::vector<BenchResult> _results;
+};
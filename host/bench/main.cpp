@@ -0,0 +1,577 @@
+//----------------------------------------------
+// bench
+// Microbenchmarks of calls the engine makes all the time, and whole frame scene benchmarks at
+// 1, 1000 and 10000 objects, run on the host against the stand-in SDK. The software rasterizer
+// stays off, a frame costs what submitting it does. The particle cases time the simulation at a
+// few particle counts and with 0 to 3 job system workers. The animation cases time the DemoCrowd's
+// update at 1, 16 and 64 characters the same way, an iteration is one skeleton.
+//	bench [-o results.json] [-b baseline.json] [-t threshold] [-f filter] [-r repetitions] [-w warmup]
+// With a baseline (a results file from an earlier run) the exit code is 1 when any case's median
+// is more than threshold percent (10 by default) slower than it was there.
+// The Logger opens "ux0:/graphicsTestLog.txt" as a plain file, on the host that is inside a
+// "ux0:" directory in the working directory. It is made if it isn't there, so logging costs what
+// it does on the Vita instead of going nowhere
+//-----------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+#include "Graphics.h"
+#include "GraphicsConfig.h"
+#include "Logger.h"
+#include "UniformBuffer.h"
+#include "JobSystem.h"
+#include "ParticleSystem.h"
+#include "DemoCrowd.h"
+
+#include "Bench.h"
+
+extern const SceGxmProgram color_v_gxp_start;
+extern const SceGxmProgram color_f_gxp_start;
+extern const SceGxmProgram object_v_gxp_start;
+
+#define MAX_OBJECTS		10000
+
+//A triangle somewhere on the screen, turning at its own speed
+typedef struct BenchObject
+{
+	float x;
+	float y;
+	float angle;
+	float speed;
+	float wvp[16];
+} BenchObject;
+
+//What the draw and scene cases draw with
+typedef struct BenchScene
+{
+	SceGxmShaderPatcherId vertexProgramID;
+	SceGxmShaderPatcherId fragmentProgramID;
+	GpuVertexProgram vertexProgram;
+	GpuFragmentProgram fragmentProgram;
+	const SceGxmProgramParameter* wvpParam_ptr;
+	//the same shaders with wvp in uniform buffer 0, written into a block of the ring per object
+	SceGxmShaderPatcherId objectProgramID;
+	GpuVertexProgram objectProgram;
+	GpuFragmentProgram objectFragmentProgram;
+	const SceGxmProgramParameter* objectWvpParam_ptr;
+	UniformRing wvpRing;
+	BasicVertex* vertices_ptr;
+	uint16_t* indices_ptr;
+	SceUID verticesUID;
+	SceUID indicesUID;
+	float viewProjection[16];
+	std::vector<BenchObject> _objects;
+} BenchScene;
+
+typedef struct AllocCase
+{
+	SceKernelMemBlockType type;
+	unsigned int size;
+} AllocCase;
+
+typedef struct SceneCase
+{
+	BenchScene* scene;
+	unsigned int objects;
+	bool uniformRing;
+} SceneCase;
+
+typedef struct ParticleCase
+{
+	ParticleSystem* particles;
+	bool draw;				//the whole frame instead of just the update
+} ParticleCase;
+
+/*----- Matrices -----*/
+
+//Row major 4x4 matrices, a row vector times them like the shaders do, so a * b applies a first
+static void multiplyMatrix(const float* a, const float* b, float* result)
+{
+	for (unsigned int row = 0; row < 4; row++)
+	{
+		for (unsigned int column = 0; column < 4; column++)
+		{
+			result[row * 4 + column] = a[row * 4] * b[column] + a[row * 4 + 1] * b[4 + column] + a[row * 4 + 2] * b[8 + column]
+				+ a[row * 4 + 3] * b[12 + column];
+		}
+	}
+}
+
+//Turned by its angle, scaled down and moved to its place, then through the view projection
+static void buildWorldViewProjection(const BenchObject* object, const float* viewProjection, float* wvp)
+{
+	const float scale = 0.02f;
+	float s = sinf(object->angle) * scale;
+	float c = cosf(object->angle) * scale;
+	float world[16] = {
+		c, s, 0.0f, 0.0f,
+		-s, c, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		object->x, object->y, 0.0f, 1.0f
+	};
+	multiplyMatrix(world, viewProjection, wvp);
+}
+
+/*----- Scene -----*/
+
+static void initScene(BenchScene* scene)
+{
+	Graphics* graphics = Graphics::getInstance();
+	scene->vertexProgramID = graphics->patcherRegisterProgram(&color_v_gxp_start);
+	scene->fragmentProgramID = graphics->patcherRegisterProgram(&color_f_gxp_start);
+	scene->wvpParam_ptr = sceGxmProgramFindParameterByName(&color_v_gxp_start, "wvp");
+
+	//the same layout as the Triangle's shaded triangle
+	SceGxmVertexAttribute attributes[2];
+	attributes[0].streamIndex = 0;
+	attributes[0].offset = 0;
+	attributes[0].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	attributes[0].componentCount = 3;
+	attributes[1].streamIndex = 0;
+	attributes[1].offset = 12;
+	attributes[1].format = SCE_GXM_ATTRIBUTE_FORMAT_U8N;
+	attributes[1].componentCount = 4;
+	graphics->patcherSetProgramCreationParams(GXM_BASIC_INDEX_16BIT);
+	scene->vertexProgram = graphics->patcherCreateVertexProgram(scene->vertexProgramID, attributes, 2, "aPosition", "aColor");
+	scene->fragmentProgram = graphics->patcherCreateFragmentProgram(scene->fragmentProgramID, scene->vertexProgramID);
+
+	scene->objectProgramID = graphics->patcherRegisterProgram(&object_v_gxp_start);
+	scene->objectWvpParam_ptr = sceGxmProgramFindParameterByName(&object_v_gxp_start, "wvp");
+	scene->objectProgram = graphics->patcherCreateVertexProgram(scene->objectProgramID, attributes, 2, "aPosition", "aColor");
+	scene->objectFragmentProgram = graphics->patcherCreateFragmentProgram(scene->fragmentProgramID, scene->objectProgramID);
+	scene->wvpRing.init(&object_v_gxp_start, 0, MAX_OBJECTS, "bench_wvp");
+
+	scene->vertices_ptr = (BasicVertex*)graphics->allocGraphicsMem(SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, 3 * sizeof(BasicVertex), 4,
+		SCE_GXM_MEMORY_ATTRIB_READ, &scene->verticesUID, "bench_vertices", MEMORY_CATEGORY_GEOMETRY);
+	scene->indices_ptr = (uint16_t*)graphics->allocGraphicsMem(SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, 3 * sizeof(uint16_t), 2,
+		SCE_GXM_MEMORY_ATTRIB_READ, &scene->indicesUID, "bench_indices", MEMORY_CATEGORY_GEOMETRY);
+	const float positions[3][2] = { { 0.0f, 0.5f }, { 0.5f, -0.5f }, { -0.5f, -0.5f } };
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		scene->vertices_ptr[i].x = positions[i][0];
+		scene->vertices_ptr[i].y = positions[i][1];
+		scene->vertices_ptr[i].z = 0.0f;
+		scene->indices_ptr[i] = (uint16_t)i;
+	}
+	scene->vertices_ptr[0].color = COLOR_RED;
+	scene->vertices_ptr[1].color = COLOR_GREEN;
+	scene->vertices_ptr[2].color = COLOR_BLUE;
+
+	//keeps the objects square on the display
+	const GraphicsConfig* config = graphics->getConfig();
+	memset(scene->viewProjection, 0, sizeof(scene->viewProjection));
+	scene->viewProjection[0] = (float)config->displayHeight / (float)config->displayWidth;
+	scene->viewProjection[5] = 1.0f;
+	scene->viewProjection[10] = 1.0f;
+	scene->viewProjection[15] = 1.0f;
+
+	//a 100 x 100 grid, the smaller scenes draw the first objects of it
+	scene->_objects.resize(MAX_OBJECTS);
+	for (unsigned int i = 0; i < MAX_OBJECTS; i++)
+	{
+		BenchObject* object = &scene->_objects[i];
+		object->x = -0.95f + 1.9f * (i % 100) / 99.0f;
+		object->y = -0.95f + 1.9f * (i / 100) / 99.0f;
+		object->angle = 0.001f * i;
+		object->speed = 0.01f + 0.0001f * (i % 37);
+		buildWorldViewProjection(object, scene->viewProjection, object->wvp);
+	}
+}
+
+static void shutdownScene(BenchScene* scene)
+{
+	Graphics* graphics = Graphics::getInstance();
+	scene->wvpRing.shutdown();
+	graphics->finish();
+	scene->objectFragmentProgram.reset();
+	scene->objectProgram.reset();
+	graphics->deferRelease(GPU_RESOURCE_REGISTERED_PROGRAM, scene->objectProgramID);
+	scene->fragmentProgram.reset();
+	scene->vertexProgram.reset();
+	graphics->deferRelease(GPU_RESOURCE_REGISTERED_PROGRAM, scene->fragmentProgramID);
+	graphics->deferRelease(GPU_RESOURCE_REGISTERED_PROGRAM, scene->vertexProgramID);
+	graphics->freeGraphicsMem(scene->indicesUID);
+	graphics->freeGraphicsMem(scene->verticesUID);
+}
+
+static void drawObjects(BenchScene* scene, unsigned int count)
+{
+	Graphics* graphics = Graphics::getInstance();
+	graphics->patcherSetVertexProgram(scene->vertexProgram.get());
+	graphics->patcherSetFragmentProgram(scene->fragmentProgram.get());
+	for (unsigned int i = 0; i < count; i++)
+	{
+		graphics->patcherSetVertexProgramConstants(NULL, scene->wvpParam_ptr, 0, 16, scene->_objects[i % MAX_OBJECTS].wvp);
+		graphics->patcherSetVertexStream(0, scene->vertices_ptr);
+		graphics->draw(SCE_GXM_PRIMITIVE_TRIANGLES, SCE_GXM_INDEX_FORMAT_U16, scene->indices_ptr, 3);
+	}
+}
+
+//The same draws with every matrix written into the frame's uniform blocks in one pass first, a draw only binds its block
+static void drawObjectsUniformRing(BenchScene* scene, unsigned int count)
+{
+	Graphics* graphics = Graphics::getInstance();
+	UniformRing* ring = &scene->wvpRing;
+	uint8_t* blocks = (uint8_t*)ring->allocate(count);
+	if (blocks == nullptr)
+		return;
+	SceSize blockSize = ring->getBlockSize();
+	for (unsigned int i = 0; i < count; i++)
+		sceGxmSetUniformDataF(blocks + i * blockSize, scene->objectWvpParam_ptr, 0, 16, scene->_objects[i % MAX_OBJECTS].wvp);
+
+	graphics->patcherSetVertexProgram(scene->objectProgram.get());
+	graphics->patcherSetFragmentProgram(scene->objectFragmentProgram.get());
+	for (unsigned int i = 0; i < count; i++)
+	{
+		ring->bind(blocks + i * blockSize);
+		graphics->patcherSetVertexStream(0, scene->vertices_ptr);
+		graphics->draw(SCE_GXM_PRIMITIVE_TRIANGLES, SCE_GXM_INDEX_FORMAT_U16, scene->indices_ptr, 3);
+	}
+}
+
+/*----- Cases -----*/
+
+static void benchAllocGraphicsMem(void* userData, unsigned int iterations)
+{
+	const AllocCase* allocCase = (const AllocCase*)userData;
+	Graphics* graphics = Graphics::getInstance();
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		SceUID uid;
+		void* memory = graphics->allocGraphicsMem(allocCase->type, allocCase->size, 4, SCE_GXM_MEMORY_ATTRIB_READ, &uid, "bench");
+		benchKeep(memory);
+		graphics->freeGraphicsMem(uid);
+	}
+}
+
+static void benchClearScreen(void* userData, unsigned int iterations)
+{
+	for (unsigned int i = 0; i < iterations; i++)
+		Graphics::getInstance()->clearScreen();
+}
+
+static void benchWriteLog(void* userData, unsigned int iterations)
+{
+	for (unsigned int i = 0; i < iterations; i++)
+		Logger::getInstance()->writeLog("frame %u: %.3fms, %u draws\n", i, 16.667f, 1000u);
+}
+
+static void benchWriteLogString(void* userData, unsigned int iterations)
+{
+	const std::string line("frame 0: 16.667ms, 1000 draws\n");
+	for (unsigned int i = 0; i < iterations; i++)
+		Logger::getInstance()->writeLog(line);
+}
+
+static void benchMatrixMultiply(void* userData, unsigned int iterations)
+{
+	const BenchScene* scene = (const BenchScene*)userData;
+	float result[16];
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		multiplyMatrix(scene->_objects[i % MAX_OBJECTS].wvp, scene->viewProjection, result);
+		benchKeep(result);
+	}
+}
+
+static void benchWorldViewProjection(void* userData, unsigned int iterations)
+{
+	const BenchScene* scene = (const BenchScene*)userData;
+	float wvp[16];
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		buildWorldViewProjection(&scene->_objects[i % MAX_OBJECTS], scene->viewProjection, wvp);
+		benchKeep(wvp);
+	}
+}
+
+//iterations draws in one scene, the scene itself is spread over them
+static void benchDrawSubmission(void* userData, unsigned int iterations)
+{
+	BenchScene* scene = (BenchScene*)userData;
+	Graphics* graphics = Graphics::getInstance();
+	graphics->startScene();
+	drawObjects(scene, iterations);
+	graphics->endScene();
+	graphics->swapBuffers();
+}
+
+//The same with the matrices in uniform ring blocks
+static void benchDrawSubmissionUniformRing(void* userData, unsigned int iterations)
+{
+	BenchScene* scene = (BenchScene*)userData;
+	Graphics* graphics = Graphics::getInstance();
+	graphics->startScene();
+	drawObjectsUniformRing(scene, iterations);
+	graphics->endScene();
+	graphics->swapBuffers();
+}
+
+//A whole frame: the objects move, the screen is cleared, every object is drawn and the frame is swapped
+static void benchSceneFrame(void* userData, unsigned int iterations)
+{
+	const SceneCase* sceneCase = (const SceneCase*)userData;
+	BenchScene* scene = sceneCase->scene;
+	Graphics* graphics = Graphics::getInstance();
+	for (unsigned int frame = 0; frame < iterations; frame++)
+	{
+		for (unsigned int i = 0; i < sceneCase->objects; i++)
+		{
+			BenchObject* object = &scene->_objects[i];
+			object->angle += object->speed;
+			buildWorldViewProjection(object, scene->viewProjection, object->wvp);
+		}
+
+		graphics->startScene();
+		graphics->clearScreen();
+		if (sceneCase->uniformRing)
+			drawObjectsUniformRing(scene, sceneCase->objects);
+		else
+			drawObjects(scene, sceneCase->objects);
+		graphics->endScene();
+		graphics->swapBuffers();
+	}
+}
+
+//A frame that makes a 4kB buffer and drops it, the way streamed geometry comes and goes. The release queue
+//frees it once the GPU is done, without waiting
+static void benchReleaseDeferred(void* userData, unsigned int iterations)
+{
+	BenchScene* scene = (BenchScene*)userData;
+	Graphics* graphics = Graphics::getInstance();
+	for (unsigned int frame = 0; frame < iterations; frame++)
+	{
+		SceUID uid;
+		void* memory = graphics->allocGraphicsMem(SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, 4 * 1024, 4, SCE_GXM_MEMORY_ATTRIB_READ,
+			&uid, "bench");
+		GpuBuffer buffer(memory, uid);
+		graphics->startScene();
+		drawObjects(scene, 100);
+		graphics->endScene();
+		graphics->swapBuffers();
+	}
+}
+
+//The same frame freeing the buffer the old way, after waiting for the GPU
+static void benchReleaseFinish(void* userData, unsigned int iterations)
+{
+	BenchScene* scene = (BenchScene*)userData;
+	Graphics* graphics = Graphics::getInstance();
+	for (unsigned int frame = 0; frame < iterations; frame++)
+	{
+		SceUID uid;
+		void* memory = graphics->allocGraphicsMem(SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, 4 * 1024, 4, SCE_GXM_MEMORY_ATTRIB_READ,
+			&uid, "bench");
+		benchKeep(memory);
+		graphics->startScene();
+		drawObjects(scene, 100);
+		graphics->endScene();
+		graphics->swapBuffers();
+		graphics->finish();
+		graphics->freeGraphicsMem(uid);
+	}
+}
+
+//Kills every particle and emits count of them that live for the whole case, the updates move them without emitting more
+static void fillParticles(ParticleSystem* particles, unsigned int count)
+{
+	particles->clear();
+	ParticleEmitter* emitter = particles->getEmitter(0);
+	emitter->rate = count * 60.0f;
+	emitter->active = true;
+	particles->update(1.0f / 60.0f);
+	emitter->active = false;
+}
+
+//Frames of moving every particle, with or without drawing them
+static void benchParticleFrame(void* userData, unsigned int iterations)
+{
+	const ParticleCase* particleCase = (const ParticleCase*)userData;
+	Graphics* graphics = Graphics::getInstance();
+	for (unsigned int frame = 0; frame < iterations; frame++)
+	{
+		particleCase->particles->update(1.0f / 60.0f);
+		if (!particleCase->draw)
+			continue;
+		graphics->startScene();
+		graphics->clearScreen();
+		particleCase->particles->draw();
+		graphics->endScene();
+		graphics->swapBuffers();
+	}
+}
+
+//Samples, blends and builds the palettes of every character, iterations is how many there are
+static void benchAnimationUpdate(void* userData, unsigned int iterations)
+{
+	DemoCrowd* crowd = (DemoCrowd*)userData;
+	crowd->update(1.0f / 60.0f);
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	getDefaultBenchOptions(&options);
+	const char* outputPath = nullptr;
+	const char* baselinePath = nullptr;
+	double threshold = 10.0;
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = (i + 1 < argc) && argv[i][0] == '-' && strlen(argv[i]) == 2;
+		char option = hasValue ? argv[i][1] : 0;
+		if (option == 'o')
+			outputPath = argv[++i];
+		else if (option == 'b')
+			baselinePath = argv[++i];
+		else if (option == 't')
+			threshold = atof(argv[++i]);
+		else if (option == 'f')
+			options.filter = argv[++i];
+		else if (option == 'r')
+			options.repetitions = (unsigned int)atoi(argv[++i]);
+		else if (option == 'w')
+			options.warmup = (unsigned int)atoi(argv[++i]);
+		else
+		{
+			printf("usage: %s [-o results.json] [-b baseline.json] [-t threshold] [-f filter] [-r repetitions] [-w warmup]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	mkdir("ux0:", 0755);
+	Logger::getInstance()->init();
+	GraphicsConfig config;
+	getDefaultGraphicsConfig(&config);
+	config.dynamicResolution = false;
+	if (!Graphics::getInstance()->initGraphics(&config))
+	{
+		printf("Graphics failed to initialize\n");
+		return 1;
+	}
+
+	JobSystem::getInstance()->init();
+
+	BenchScene scene;
+	initScene(&scene);
+	Bench bench(&options);
+
+	AllocCase lpddrSmall = { SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, 4 * 1024 };
+	AllocCase lpddrLarge = { SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, 1024 * 1024 };
+	AllocCase cdram = { SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW, 1024 * 1024 };
+	bench.run("allocGraphicsMem/lpddr_4k", benchAllocGraphicsMem, &lpddrSmall, 16, false);
+	bench.run("allocGraphicsMem/lpddr_1m", benchAllocGraphicsMem, &lpddrLarge, 16, false);
+	bench.run("allocGraphicsMem/cdram_1m", benchAllocGraphicsMem, &cdram, 16, false);
+	bench.run("clearScreen", benchClearScreen, nullptr, 1, false);
+	bench.run("Logger::writeLog/format", benchWriteLog, nullptr, 1024, false);
+	bench.run("Logger::writeLog/string", benchWriteLogString, nullptr, 1024, false);
+	bench.run("matrix/multiply", benchMatrixMultiply, &scene, 1024, false);
+	bench.run("matrix/wvp", benchWorldViewProjection, &scene, 1024, false);
+	bench.run("draw/submit_1000", benchDrawSubmission, &scene, 1000, true);
+	bench.run("draw/submit_1000_uniform_ring", benchDrawSubmissionUniformRing, &scene, 1000, true);
+	bench.run("release/deferred", benchReleaseDeferred, &scene, 1, true);
+	bench.run("release/finish", benchReleaseFinish, &scene, 1, true);
+
+	const unsigned int objectCounts[3] = { 1, 1000, MAX_OBJECTS };
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		char name[48];
+		snprintf(name, sizeof(name), "scene/%u_objects", objectCounts[i]);
+		SceneCase sceneCase = { &scene, objectCounts[i], false };
+		bench.run(name, benchSceneFrame, &sceneCase, 1, true);
+		snprintf(name, sizeof(name), "scene/%u_objects_uniform_ring", objectCounts[i]);
+		sceneCase.uniformRing = true;
+		bench.run(name, benchSceneFrame, &sceneCase, 1, true);
+	}
+
+	//a fountain whose particles outlive the case, so the count stays where fillParticles() put it
+	ParticleSystem particles;
+	particles.init();
+	particles.setGravity(0.0f, 240.0f);
+	particles.setDrag(0.2f);
+	ParticleEmitter emitter;
+	memset(&emitter, 0, sizeof(ParticleEmitter));
+	emitter.x = config.displayWidth * 0.5f;
+	emitter.y = config.displayHeight * 0.9f;
+	emitter.direction = -1.5708f;
+	emitter.spread = 0.5f;
+	emitter.speedMin = 100.0f;
+	emitter.speedMax = 400.0f;
+	emitter.lifetimeMin = 1000000.0f;
+	emitter.lifetimeMax = 1000000.0f;
+	emitter.sizeMin = 2.0f;
+	emitter.sizeMax = 8.0f;
+	emitter.color = RGBA8(255, 200, 120, 255);
+	particles.addEmitter(&emitter);
+
+	const unsigned int particleCounts[3] = { 10000, 50000, PARTICLE_SYSTEM_MAX_PARTICLES };
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		char name[48];
+		fillParticles(&particles, particleCounts[i]);
+		ParticleCase particleCase = { &particles, false };
+		snprintf(name, sizeof(name), "particles/update_%u", particleCounts[i]);
+		bench.run(name, benchParticleFrame, &particleCase, 1, true);
+		particleCase.draw = true;
+		snprintf(name, sizeof(name), "particles/frame_%u", particleCounts[i]);
+		bench.run(name, benchParticleFrame, &particleCase, 1, true);
+	}
+	//how the update scales with the workers, restarting the job system for each count
+	for (unsigned int workers = 0; workers <= 3; workers++)
+	{
+		char name[48];
+		JobSystem::getInstance()->shutdown();
+		JobSystem::getInstance()->init(workers);
+		fillParticles(&particles, 50000);
+		ParticleCase particleCase = { &particles, false };
+		snprintf(name, sizeof(name), "particles/update_50000_workers_%u", workers);
+		bench.run(name, benchParticleFrame, &particleCase, 1, true);
+	}
+	particles.shutdown();
+
+	JobSystem::getInstance()->shutdown();
+	JobSystem::getInstance()->init();
+	const unsigned int characterCounts[3] = { 1, 16, ANIMATION_SYSTEM_MAX_CHARACTERS };
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		char name[48];
+		DemoCrowd crowd;
+		crowd.init(characterCounts[i]);
+		snprintf(name, sizeof(name), "animation/update_%u_skeletons", characterCounts[i]);
+		bench.run(name, benchAnimationUpdate, &crowd, characterCounts[i], true);
+		crowd.cleanup();
+	}
+	DemoCrowd crowd;
+	crowd.init(ANIMATION_SYSTEM_MAX_CHARACTERS);
+	for (unsigned int workers = 0; workers <= 3; workers++)
+	{
+		char name[48];
+		JobSystem::getInstance()->shutdown();
+		JobSystem::getInstance()->init(workers);
+		snprintf(name, sizeof(name), "animation/update_%u_skeletons_workers_%u", ANIMATION_SYSTEM_MAX_CHARACTERS, workers);
+		bench.run(name, benchAnimationUpdate, &crowd, ANIMATION_SYSTEM_MAX_CHARACTERS, true);
+	}
+	crowd.cleanup();
+
+	shutdownScene(&scene);
+	Graphics::getInstance()->shutdownGraphics();
+	JobSystem::getInstance()->shutdown();
+	Logger::getInstance()->shutdown();
+
+	bench.printResults();
+	int result = 0;
+	if (outputPath != nullptr && !bench.writeJson(outputPath))
+	{
+		printf("could not write %s\n", outputPath);
+		result = 1;
+	}
+	if (baselinePath != nullptr && !bench.compareBaseline(baselinePath, threshold))
+		result = 1;
+	return result;
+}
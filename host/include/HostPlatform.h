@@ -0,0 +1,73 @@
+#pragma once
+
+//----------------------------------------------
+// Host platform hooks
+// What a program running on the host stand-in can do that the Vita has no SDK call for:
+// press buttons, look at the frame on the display, see what libgxm was asked to do, have it
+// rasterized and compared against a known good image, and decide where the memory card lives
+//-----------------------------------------------
+
+#include <psp2/types.h>
+#include <psp2/display.h>
+
+//What the gxm stand-in has done since the last hostResetGxmStats()
+typedef struct HostGxmStats
+{
+	unsigned int scenes;
+	unsigned int draws;
+	unsigned int indices;
+	unsigned int drawErrors;		//draws that were rejected, see sceGxmDraw() in HostGxm.cpp for why
+	unsigned int uniformReserves;
+	unsigned int programsCreated;	//vertex and fragment programs, a request for an existing one isn't counted
+	unsigned int programsLive;
+	unsigned int mappedBytes;		//memory mapped for the GPU right now
+} HostGxmStats;
+
+//What the software rasterizer has done since the last hostResetRasterStats()
+typedef struct HostRasterStats
+{
+	unsigned int scenes;			//rasterized, scenes begun while it was off aren't counted
+	unsigned int draws;
+	unsigned int unshadedDraws;		//programs without a C++ shader, or primitives other than triangles
+	unsigned int triangles;			//binned, after clipping
+	unsigned int culledTriangles;	//by the cull mode or for having no area
+	unsigned int clippedTriangles;	//crossed w = 0 or the guard band
+	SceUInt64 pixels;				//fragments shaded
+	SceUInt64 rasterTime;			//microseconds spent rasterizing tiles when scenes ended
+} HostRasterStats;
+
+//Pixel difference between a frame and an image file, see hostCompareImage()
+typedef struct HostImageDiff
+{
+	unsigned int differentPixels;	//further off than the tolerance in any channel
+	unsigned int maxDifference;		//largest channel difference of any pixel
+} HostImageDiff;
+
+//Called from sceDisplaySetFrameBuf() with every frame it is handed
+typedef void (*HostDisplayCallback)(const SceDisplayFrameBuf* frame, void* userData);
+
+//The buttons sceCtrlPeekBufferPositive() reports from now on, SCE_CTRL_* bits
+void hostSetButtons(unsigned int buttons);
+//The frame last handed to sceDisplaySetFrameBuf(), base is null until there is one
+void hostGetDisplayedFrame(SceDisplayFrameBuf* frame);
+//callback can be nullptr
+void hostSetDisplayCallback(HostDisplayCallback callback, void* userData);
+
+void hostGetGxmStats(HostGxmStats* stats);
+void hostResetGxmStats();
+
+//Off by default, scenes are then done without touching their surfaces. threads 0 uses one per core
+void hostSetRasterizer(bool enable, unsigned int threads);
+void hostGetRasterStats(HostRasterStats* stats);
+void hostResetRasterStats();
+
+//Writes width x height pixels of an A8B8G8R8 surface to a binary PPM file, alpha is left out
+bool hostWriteImage(const char* path, const void* pixels, unsigned int width, unsigned int height, unsigned int strideInPixels);
+//Compares the pixels with a PPM file written by hostWriteImage(), true when no channel is more than tolerance off.
+//False as well when the file can't be read or is another size, diff (can be nullptr) is then left zeroed
+bool hostCompareImage(const char* path, const void* pixels, unsigned int width, unsigned int height, unsigned int strideInPixels,
+	unsigned int tolerance, HostImageDiff* diff);
+
+//The host directory a device such as "ux0:" is mapped to. By default app0: is the working directory
+//and ux0: is "ux0" inside it
+void hostSetDeviceRoot(const char* device, const char* directory);
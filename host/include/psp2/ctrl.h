@@ -0,0 +1,49 @@
+#pragma once
+
+#include <psp2/types.h>
+
+enum
+{
+	SCE_CTRL_SELECT = 0x000001,
+	SCE_CTRL_START = 0x000008,
+	SCE_CTRL_UP = 0x000010,
+	SCE_CTRL_RIGHT = 0x000020,
+	SCE_CTRL_DOWN = 0x000040,
+	SCE_CTRL_LEFT = 0x000080,
+	SCE_CTRL_LTRIGGER = 0x000100,
+	SCE_CTRL_RTRIGGER = 0x000200,
+	SCE_CTRL_TRIANGLE = 0x001000,
+	SCE_CTRL_CIRCLE = 0x002000,
+	SCE_CTRL_CROSS = 0x004000,
+	SCE_CTRL_SQUARE = 0x008000
+};
+
+typedef enum SceCtrlPadInputMode
+{
+	SCE_CTRL_MODE_DIGITAL = 0,
+	SCE_CTRL_MODE_ANALOG = 1,
+	SCE_CTRL_MODE_ANALOG_WIDE = 2
+} SceCtrlPadInputMode;
+
+typedef struct SceCtrlData
+{
+	uint64_t timeStamp;
+	unsigned int buttons;
+	unsigned char lx;
+	unsigned char ly;
+	unsigned char rx;
+	unsigned char ry;
+	uint8_t reserved[16];
+} SceCtrlData;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int sceCtrlSetSamplingMode(int mode);
+//Reports the buttons set with hostSetButtons(), sticks centered
+int sceCtrlPeekBufferPositive(int port, SceCtrlData *pad_data, int count);
+
+#ifdef __cplusplus
+}
+#endif
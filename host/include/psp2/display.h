@@ -0,0 +1,37 @@
+#pragma once
+
+#include <psp2/types.h>
+
+typedef enum SceDisplayPixelFormat
+{
+	SCE_DISPLAY_PIXELFORMAT_A8B8G8R8 = 0x00000000U
+} SceDisplayPixelFormat;
+
+typedef enum SceDisplaySetBufSync
+{
+	SCE_DISPLAY_SETBUF_IMMEDIATE = 0,
+	SCE_DISPLAY_SETBUF_NEXTFRAME = 1
+} SceDisplaySetBufSync;
+
+typedef struct SceDisplayFrameBuf
+{
+	SceSize size;
+	void *base;
+	unsigned int pitch;
+	unsigned int pixelformat;
+	unsigned int width;
+	unsigned int height;
+} SceDisplayFrameBuf;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int sceDisplaySetFrameBuf(const SceDisplayFrameBuf *pParam, SceDisplaySetBufSync sync);
+//There is no panel to wait for, vblanks return straight away so host runs measure the CPU alone
+int sceDisplayWaitVblankStart(void);
+int sceDisplayWaitVblankStartMulti(unsigned int vcount);
+
+#ifdef __cplusplus
+}
+#endif
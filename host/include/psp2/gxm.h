@@ -0,0 +1,610 @@
+#pragma once
+
+#include <psp2/types.h>
+
+//libgxm as far as the engine uses it. The stand-in keeps the state a context is given and checks
+//it the way the GPU would need it, a scene is "rendered" the moment it ends. Opaque types are
+//defined in host/HostGxm.cpp, programs are the stand-in's own, see SceGxmProgram below
+
+#define SCE_GXM_DEFAULT_PARAMETER_BUFFER_SIZE			0x01000000
+#define SCE_GXM_DEFAULT_VDM_RING_BUFFER_SIZE			0x00020000
+#define SCE_GXM_DEFAULT_VERTEX_RING_BUFFER_SIZE			0x00200000
+#define SCE_GXM_DEFAULT_FRAGMENT_RING_BUFFER_SIZE		0x00080000
+#define SCE_GXM_DEFAULT_FRAGMENT_USSE_RING_BUFFER_SIZE	0x00004000
+#define SCE_GXM_MINIMUM_CONTEXT_HOST_MEM_SIZE			0x00000800
+#define SCE_GXM_MAX_SCENES_PER_RENDERTARGET				8
+#define SCE_GXM_TILE_SIZEX								32
+#define SCE_GXM_TILE_SIZEY								32
+#define SCE_GXM_COLOR_SURFACE_ALIGNMENT					4
+#define SCE_GXM_DEPTHSTENCIL_SURFACE_ALIGNMENT			16
+#define SCE_GXM_TEXTURE_ALIGNMENT						16
+#define SCE_GXM_MAX_VERTEX_ATTRIBUTES					16
+#define SCE_GXM_MAX_VERTEX_STREAMS						4
+#define SCE_GXM_MAX_UNIFORM_BUFFERS						8
+#define SCE_GXM_DEFAULT_UNIFORM_BUFFER_CONTAINER_INDEX	14
+#define SCE_GXM_MAX_TEXTURE_UNITS						16
+#define SCE_GXM_NOTIFICATION_COUNT						512
+
+#define SCE_GXM_ERROR_UNINITIALIZED						0x805B0000
+#define SCE_GXM_ERROR_ALREADY_INITIALIZED				0x805B0001
+#define SCE_GXM_ERROR_OUT_OF_MEMORY						0x805B0002
+#define SCE_GXM_ERROR_INVALID_VALUE						0x805B0003
+#define SCE_GXM_ERROR_INVALID_POINTER					0x805B0004
+#define SCE_GXM_ERROR_INVALID_ALIGNMENT					0x805B0005
+#define SCE_GXM_ERROR_NOT_WITHIN_SCENE					0x805B0006
+#define SCE_GXM_ERROR_WITHIN_SCENE						0x805B0007
+#define SCE_GXM_ERROR_NULL_PROGRAM						0x805B0008
+#define SCE_GXM_ERROR_UNSUPPORTED						0x805B0009
+#define SCE_GXM_ERROR_PATCHER_INTERNAL					0x805B000A
+#define SCE_GXM_ERROR_RESERVE_FAILED					0x805B000B
+#define SCE_GXM_ERROR_PROGRAM_IN_USE					0x805B000C
+#define SCE_GXM_ERROR_INVALID_INDEX_COUNT				0x805B000D
+#define SCE_GXM_ERROR_INVALID_POLYGON_MODE				0x805B000E
+#define SCE_GXM_ERROR_INVALID_SAMPLER_RESULT_TYPE_PRECISION	0x805B000F
+
+typedef struct SceGxmContext SceGxmContext;
+typedef struct SceGxmRenderTarget SceGxmRenderTarget;
+typedef struct SceGxmSyncObject SceGxmSyncObject;
+typedef struct SceGxmVertexProgram SceGxmVertexProgram;
+typedef struct SceGxmFragmentProgram SceGxmFragmentProgram;
+typedef struct SceGxmShaderPatcher SceGxmShaderPatcher;
+typedef struct SceGxmRegisteredProgram SceGxmRegisteredProgram;
+typedef SceGxmRegisteredProgram *SceGxmShaderPatcherId;
+
+typedef struct SceGxmValidRegion
+{
+	unsigned int xMin;
+	unsigned int yMin;
+	unsigned int xMax;
+	unsigned int yMax;
+} SceGxmValidRegion;
+
+typedef void (SceGxmDisplayQueueCallback)(const void *callbackData);
+
+typedef struct SceGxmInitializeParams
+{
+	unsigned int flags;
+	unsigned int displayQueueMaxPendingCount;
+	SceGxmDisplayQueueCallback *displayQueueCallback;
+	unsigned int displayQueueCallbackDataSize;
+	SceSize parameterBufferSize;
+} SceGxmInitializeParams;
+
+typedef enum SceGxmMemoryAttribFlags
+{
+	SCE_GXM_MEMORY_ATTRIB_READ = 1,
+	SCE_GXM_MEMORY_ATTRIB_WRITE = 2,
+	SCE_GXM_MEMORY_ATTRIB_RW = 3
+} SceGxmMemoryAttribFlags;
+
+typedef struct SceGxmContextParams
+{
+	void *hostMem;
+	SceSize hostMemSize;
+	void *vdmRingBufferMem;
+	SceSize vdmRingBufferMemSize;
+	void *vertexRingBufferMem;
+	SceSize vertexRingBufferMemSize;
+	void *fragmentRingBufferMem;
+	SceSize fragmentRingBufferMemSize;
+	void *fragmentUsseRingBufferMem;
+	SceSize fragmentUsseRingBufferMemSize;
+	unsigned int fragmentUsseRingBufferOffset;
+} SceGxmContextParams;
+
+typedef enum SceGxmMultisampleMode
+{
+	SCE_GXM_MULTISAMPLE_NONE,
+	SCE_GXM_MULTISAMPLE_2X,
+	SCE_GXM_MULTISAMPLE_4X
+} SceGxmMultisampleMode;
+
+typedef struct SceGxmRenderTargetParams
+{
+	unsigned int flags;
+	uint16_t width;
+	uint16_t height;
+	uint16_t scenesPerFrame;
+	uint16_t multisampleMode;
+	uint32_t multisampleLocations;
+	SceUID driverMemBlock;
+} SceGxmRenderTargetParams;
+
+/*----- Surfaces -----*/
+
+typedef enum SceGxmColorFormat
+{
+	SCE_GXM_COLOR_FORMAT_A8B8G8R8 = 0x00000000U,
+	SCE_GXM_COLOR_FORMAT_U8U8U8U8_ABGR = 0x00000000U
+} SceGxmColorFormat;
+
+typedef enum SceGxmColorSurfaceType
+{
+	SCE_GXM_COLOR_SURFACE_LINEAR = 0x00000000U,
+	SCE_GXM_COLOR_SURFACE_TILED = 0x04000000U,
+	SCE_GXM_COLOR_SURFACE_SWIZZLED = 0x08000000U
+} SceGxmColorSurfaceType;
+
+typedef enum SceGxmColorSurfaceScaleMode
+{
+	SCE_GXM_COLOR_SURFACE_SCALE_NONE = 0x00000000U,
+	SCE_GXM_COLOR_SURFACE_SCALE_MSAA_DOWNSCALE = 0x00000001U
+} SceGxmColorSurfaceScaleMode;
+
+typedef enum SceGxmOutputRegisterSize
+{
+	SCE_GXM_OUTPUT_REGISTER_SIZE_32BIT = 0x00000000U,
+	SCE_GXM_OUTPUT_REGISTER_SIZE_64BIT = 0x00000001U
+} SceGxmOutputRegisterSize;
+
+typedef enum SceGxmOutputRegisterFormat
+{
+	SCE_GXM_OUTPUT_REGISTER_FORMAT_DECLARED,
+	SCE_GXM_OUTPUT_REGISTER_FORMAT_UCHAR4,
+	SCE_GXM_OUTPUT_REGISTER_FORMAT_HALF4
+} SceGxmOutputRegisterFormat;
+
+//The stand-in's own layout, the engine only ever passes these to libgxm
+typedef struct SceGxmColorSurface
+{
+	void *data;
+	unsigned int format;
+	unsigned int surfaceType;
+	unsigned int scaleMode;
+	unsigned int outputRegisterSize;
+	unsigned int width;
+	unsigned int height;
+	unsigned int strideInPixels;
+} SceGxmColorSurface;
+
+typedef enum SceGxmDepthStencilFormat
+{
+	SCE_GXM_DEPTH_STENCIL_FORMAT_DF32 = 0x00044000u,
+	SCE_GXM_DEPTH_STENCIL_FORMAT_S8 = 0x00022000u,
+	SCE_GXM_DEPTH_STENCIL_FORMAT_D16 = 0x02444000u,
+	SCE_GXM_DEPTH_STENCIL_FORMAT_S8D24 = 0x01266000u
+} SceGxmDepthStencilFormat;
+
+typedef enum SceGxmDepthStencilSurfaceType
+{
+	SCE_GXM_DEPTH_STENCIL_SURFACE_LINEAR = 0x00000000u,
+	SCE_GXM_DEPTH_STENCIL_SURFACE_TILED = 0x00011000u
+} SceGxmDepthStencilSurfaceType;
+
+typedef enum SceGxmDepthStencilForceLoadMode
+{
+	SCE_GXM_DEPTH_STENCIL_FORCE_LOAD_DISABLED = 0x00000000u,
+	SCE_GXM_DEPTH_STENCIL_FORCE_LOAD_ENABLED = 0x00000002u
+} SceGxmDepthStencilForceLoadMode;
+
+typedef enum SceGxmDepthStencilForceStoreMode
+{
+	SCE_GXM_DEPTH_STENCIL_FORCE_STORE_DISABLED = 0x00000000u,
+	SCE_GXM_DEPTH_STENCIL_FORCE_STORE_ENABLED = 0x00000004u
+} SceGxmDepthStencilForceStoreMode;
+
+typedef struct SceGxmDepthStencilSurface
+{
+	unsigned int format;
+	unsigned int surfaceType;
+	unsigned int strideInSamples;
+	void *depthData;
+	void *stencilData;
+	float backgroundDepth;
+	unsigned int forceLoad;
+	unsigned int forceStore;
+} SceGxmDepthStencilSurface;
+
+typedef struct SceGxmNotification
+{
+	volatile unsigned int *address;
+	unsigned int value;
+} SceGxmNotification;
+
+typedef enum SceGxmSceneFlags
+{
+	SCE_GXM_SCENE_FRAGMENT_SET_DEPENDENCY = 0x00000001U,
+	SCE_GXM_SCENE_VERTEX_WAIT_FOR_DEPENDENCY = 0x00000002U,
+	SCE_GXM_SCENE_FRAGMENT_TRANSFER_SYNC = 0x00000004U,
+	SCE_GXM_SCENE_VERTEX_TRANSFER_SYNC = 0x00000008U
+} SceGxmSceneFlags;
+
+/*----- Drawing state -----*/
+
+typedef enum SceGxmPrimitiveType
+{
+	SCE_GXM_PRIMITIVE_TRIANGLES = 0x00000000U,
+	SCE_GXM_PRIMITIVE_LINES = 0x04000000U,
+	SCE_GXM_PRIMITIVE_POINTS = 0x08000000U,
+	SCE_GXM_PRIMITIVE_TRIANGLE_STRIP = 0x0C000000U,
+	SCE_GXM_PRIMITIVE_TRIANGLE_FAN = 0x10000000U,
+	SCE_GXM_PRIMITIVE_TRIANGLE_EDGES = 0x14000000U
+} SceGxmPrimitiveType;
+
+typedef enum SceGxmIndexFormat
+{
+	SCE_GXM_INDEX_FORMAT_U16 = 0x00000000U,
+	SCE_GXM_INDEX_FORMAT_U32 = 0x01000000U
+} SceGxmIndexFormat;
+
+typedef enum SceGxmIndexSource
+{
+	SCE_GXM_INDEX_SOURCE_INDEX_16BIT = 0x00000000U,
+	SCE_GXM_INDEX_SOURCE_INDEX_32BIT = 0x00000001U,
+	SCE_GXM_INDEX_SOURCE_INSTANCE_16BIT = 0x00000002U,
+	SCE_GXM_INDEX_SOURCE_INSTANCE_32BIT = 0x00000003U
+} SceGxmIndexSource;
+
+typedef enum SceGxmAttributeFormat
+{
+	SCE_GXM_ATTRIBUTE_FORMAT_U8,
+	SCE_GXM_ATTRIBUTE_FORMAT_S8,
+	SCE_GXM_ATTRIBUTE_FORMAT_U16,
+	SCE_GXM_ATTRIBUTE_FORMAT_S16,
+	SCE_GXM_ATTRIBUTE_FORMAT_U8N,
+	SCE_GXM_ATTRIBUTE_FORMAT_S8N,
+	SCE_GXM_ATTRIBUTE_FORMAT_U16N,
+	SCE_GXM_ATTRIBUTE_FORMAT_S16N,
+	SCE_GXM_ATTRIBUTE_FORMAT_F16,
+	SCE_GXM_ATTRIBUTE_FORMAT_F32,
+	SCE_GXM_ATTRIBUTE_FORMAT_UNTYPED
+} SceGxmAttributeFormat;
+
+typedef struct SceGxmVertexAttribute
+{
+	unsigned short streamIndex;
+	unsigned short offset;
+	unsigned char format;
+	unsigned char componentCount;
+	unsigned short regIndex;
+} SceGxmVertexAttribute;
+
+typedef struct SceGxmVertexStream
+{
+	unsigned short stride;
+	unsigned short indexSource;
+} SceGxmVertexStream;
+
+typedef enum SceGxmBlendFunc
+{
+	SCE_GXM_BLEND_FUNC_NONE,
+	SCE_GXM_BLEND_FUNC_ADD,
+	SCE_GXM_BLEND_FUNC_SUBTRACT,
+	SCE_GXM_BLEND_FUNC_REVERSE_SUBTRACT,
+	SCE_GXM_BLEND_FUNC_MIN,
+	SCE_GXM_BLEND_FUNC_MAX
+} SceGxmBlendFunc;
+
+typedef enum SceGxmBlendFactor
+{
+	SCE_GXM_BLEND_FACTOR_ZERO,
+	SCE_GXM_BLEND_FACTOR_ONE,
+	SCE_GXM_BLEND_FACTOR_SRC_COLOR,
+	SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_COLOR,
+	SCE_GXM_BLEND_FACTOR_SRC_ALPHA,
+	SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+	SCE_GXM_BLEND_FACTOR_DST_COLOR,
+	SCE_GXM_BLEND_FACTOR_ONE_MINUS_DST_COLOR,
+	SCE_GXM_BLEND_FACTOR_DST_ALPHA,
+	SCE_GXM_BLEND_FACTOR_ONE_MINUS_DST_ALPHA
+} SceGxmBlendFactor;
+
+typedef enum SceGxmColorMask
+{
+	SCE_GXM_COLOR_MASK_NONE = 0,
+	SCE_GXM_COLOR_MASK_A = (1 << 0),
+	SCE_GXM_COLOR_MASK_R = (1 << 1),
+	SCE_GXM_COLOR_MASK_G = (1 << 2),
+	SCE_GXM_COLOR_MASK_B = (1 << 3),
+	SCE_GXM_COLOR_MASK_ALL = (SCE_GXM_COLOR_MASK_A | SCE_GXM_COLOR_MASK_B | SCE_GXM_COLOR_MASK_G | SCE_GXM_COLOR_MASK_R)
+} SceGxmColorMask;
+
+typedef struct SceGxmBlendInfo
+{
+	uint8_t colorMask;
+	uint8_t colorFunc : 4;
+	uint8_t alphaFunc : 4;
+	uint8_t colorSrc : 4;
+	uint8_t colorDst : 4;
+	uint8_t alphaSrc : 4;
+	uint8_t alphaDst : 4;
+} SceGxmBlendInfo;
+
+typedef enum SceGxmDepthFunc
+{
+	SCE_GXM_DEPTH_FUNC_NEVER = 0x00000000U,
+	SCE_GXM_DEPTH_FUNC_LESS = 0x00400000U,
+	SCE_GXM_DEPTH_FUNC_EQUAL = 0x00800000U,
+	SCE_GXM_DEPTH_FUNC_LESS_EQUAL = 0x00C00000U,
+	SCE_GXM_DEPTH_FUNC_GREATER = 0x01000000U,
+	SCE_GXM_DEPTH_FUNC_NOT_EQUAL = 0x01400000U,
+	SCE_GXM_DEPTH_FUNC_GREATER_EQUAL = 0x01800000U,
+	SCE_GXM_DEPTH_FUNC_ALWAYS = 0x01C00000U
+} SceGxmDepthFunc;
+
+typedef enum SceGxmDepthWriteMode
+{
+	SCE_GXM_DEPTH_WRITE_DISABLED = 0x00100000U,
+	SCE_GXM_DEPTH_WRITE_ENABLED = 0x00000000U
+} SceGxmDepthWriteMode;
+
+typedef enum SceGxmCullMode
+{
+	SCE_GXM_CULL_NONE = 0x00000000U,
+	SCE_GXM_CULL_CW = 0x00000001U,
+	SCE_GXM_CULL_CCW = 0x00000002U
+} SceGxmCullMode;
+
+typedef enum SceGxmRegionClipMode
+{
+	SCE_GXM_REGION_CLIP_NONE = 0x00000000U,
+	SCE_GXM_REGION_CLIP_ALL = 0x40000000U,
+	SCE_GXM_REGION_CLIP_OUTSIDE = 0x80000000U,
+	SCE_GXM_REGION_CLIP_INSIDE = 0xC0000000U
+} SceGxmRegionClipMode;
+
+/*----- Textures -----*/
+
+typedef enum SceGxmTextureFormat
+{
+	SCE_GXM_TEXTURE_FORMAT_U8_000R = 0x00001000U,
+	SCE_GXM_TEXTURE_FORMAT_U8_111R = 0x00002000U,
+	SCE_GXM_TEXTURE_FORMAT_U8_R111 = 0x00000000U,
+	SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR = 0x0C000000U,
+	SCE_GXM_TEXTURE_FORMAT_A8B8G8R8 = 0x0C000000U,
+	SCE_GXM_TEXTURE_FORMAT_U5U6U5_BGR = 0x05001000U,
+	SCE_GXM_TEXTURE_FORMAT_U4U4U4U4_ABGR = 0x01000000U,
+	SCE_GXM_TEXTURE_FORMAT_PVRT2BPP_ABGR = 0x80000000U,
+	SCE_GXM_TEXTURE_FORMAT_PVRT4BPP_ABGR = 0x81000000U,
+	SCE_GXM_TEXTURE_FORMAT_UBC1_ABGR = 0x85000000U,
+	SCE_GXM_TEXTURE_FORMAT_UBC2_ABGR = 0x86000000U,
+	SCE_GXM_TEXTURE_FORMAT_UBC3_ABGR = 0x87000000U
+} SceGxmTextureFormat;
+
+typedef enum SceGxmTextureType
+{
+	SCE_GXM_TEXTURE_SWIZZLED = 0x00000000U,
+	SCE_GXM_TEXTURE_CUBE = 0x40000000U,
+	SCE_GXM_TEXTURE_LINEAR = 0x60000000U,
+	SCE_GXM_TEXTURE_TILED = 0x80000000U,
+	SCE_GXM_TEXTURE_LINEAR_STRIDED = 0xC0000000U
+} SceGxmTextureType;
+
+typedef enum SceGxmTextureFilter
+{
+	SCE_GXM_TEXTURE_FILTER_POINT = 0x00000000U,
+	SCE_GXM_TEXTURE_FILTER_LINEAR = 0x00000001U
+} SceGxmTextureFilter;
+
+typedef enum SceGxmTextureMipFilter
+{
+	SCE_GXM_TEXTURE_MIP_FILTER_DISABLED = 0x00000000U,
+	SCE_GXM_TEXTURE_MIP_FILTER_ENABLED = 0x00000200U
+} SceGxmTextureMipFilter;
+
+typedef enum SceGxmTextureAddrMode
+{
+	SCE_GXM_TEXTURE_ADDR_REPEAT = 0x00000000U,
+	SCE_GXM_TEXTURE_ADDR_MIRROR = 0x00000001U,
+	SCE_GXM_TEXTURE_ADDR_CLAMP = 0x00000002U
+} SceGxmTextureAddrMode;
+
+//The stand-in's own layout, read it through the getters like on the Vita
+typedef struct SceGxmTexture
+{
+	const void *data;
+	unsigned int format;
+	unsigned int type;
+	unsigned short width;
+	unsigned short height;
+	unsigned char mipCount;
+	unsigned char minFilter;
+	unsigned char magFilter;
+	unsigned char uAddrMode;
+	unsigned char vAddrMode;
+	unsigned char lodBias;
+	unsigned short mipFilter;
+} SceGxmTexture;
+
+/*----- Programs -----*/
+
+typedef enum SceGxmProgramType
+{
+	SCE_GXM_VERTEX_PROGRAM,
+	SCE_GXM_FRAGMENT_PROGRAM
+} SceGxmProgramType;
+
+typedef enum SceGxmParameterCategory
+{
+	SCE_GXM_PARAMETER_CATEGORY_ATTRIBUTE,
+	SCE_GXM_PARAMETER_CATEGORY_UNIFORM,
+	SCE_GXM_PARAMETER_CATEGORY_SAMPLER,
+	SCE_GXM_PARAMETER_CATEGORY_AUXILIARY_SURFACE,
+	SCE_GXM_PARAMETER_CATEGORY_UNIFORM_BUFFER
+} SceGxmParameterCategory;
+
+/*	There is no shader compiler on the host, a stand-in program describes what the gxp compiled
+from the same .cg file would: its parameters and how big its default uniform buffer is.
+host/HostShaders.cpp has one for every shader the engine links. It is plain data with no
+pointers, so it can be copied around like a gxp binary.
+Resource indices are in 32 bit registers: uniforms are at that offset in the buffer in
+containerIndex, SCE_GXM_DEFAULT_UNIFORM_BUFFER_CONTAINER_INDEX for the default uniform buffer and
+n for a ": BUFFER[n]" uniform bound with sceGxmSet*UniformBuffer(). Attributes use that input register
+*/
+#define HOST_GXM_PROGRAM_MAGIC			0x50584748	//"HGXP"
+#define HOST_GXM_MAX_PARAMETERS			8
+#define HOST_GXM_NAME_LENGTH			32
+
+struct SceGxmProgramParameter
+{
+	char name[HOST_GXM_NAME_LENGTH];
+	uint32_t category;				//SceGxmParameterCategory
+	uint32_t componentCount;		//per array element
+	uint32_t arraySize;
+	uint32_t resourceIndex;
+	uint32_t containerIndex;
+};
+typedef struct SceGxmProgramParameter SceGxmProgramParameter;
+
+struct SceGxmProgram
+{
+	uint32_t magic;
+	uint32_t size;					//of this struct, sceGxmProgramGetSize()
+	uint32_t type;					//SceGxmProgramType
+	char name[HOST_GXM_NAME_LENGTH];	//the .cg file, without _vertex/_fragment
+	uint32_t defaultUniformSize;	//32 bit registers
+	uint32_t parameterCount;
+	SceGxmProgramParameter parameters[HOST_GXM_MAX_PARAMETERS];
+};
+typedef struct SceGxmProgram SceGxmProgram;
+
+typedef void *(SceGxmShaderPatcherHostAllocCallback)(void *userData, SceSize size);
+typedef void (SceGxmShaderPatcherHostFreeCallback)(void *userData, void *mem);
+typedef void *(SceGxmShaderPatcherBufferAllocCallback)(void *userData, SceSize size);
+typedef void (SceGxmShaderPatcherBufferFreeCallback)(void *userData, void *mem);
+typedef void *(SceGxmShaderPatcherUsseAllocCallback)(void *userData, SceSize size, unsigned int *usseOffset);
+typedef void (SceGxmShaderPatcherUsseFreeCallback)(void *userData, void *mem);
+
+typedef struct SceGxmShaderPatcherParams
+{
+	void *userData;
+	SceGxmShaderPatcherHostAllocCallback *hostAllocCallback;
+	SceGxmShaderPatcherHostFreeCallback *hostFreeCallback;
+	SceGxmShaderPatcherBufferAllocCallback *bufferAllocCallback;
+	SceGxmShaderPatcherBufferFreeCallback *bufferFreeCallback;
+	void *bufferMem;
+	SceSize bufferMemSize;
+	SceGxmShaderPatcherUsseAllocCallback *vertexUsseAllocCallback;
+	SceGxmShaderPatcherUsseFreeCallback *vertexUsseFreeCallback;
+	void *vertexUsseMem;
+	SceSize vertexUsseMemSize;
+	unsigned int vertexUsseOffset;
+	SceGxmShaderPatcherUsseAllocCallback *fragmentUsseAllocCallback;
+	SceGxmShaderPatcherUsseFreeCallback *fragmentUsseFreeCallback;
+	void *fragmentUsseMem;
+	SceSize fragmentUsseMemSize;
+	unsigned int fragmentUsseOffset;
+} SceGxmShaderPatcherParams;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----- Initialization and memory -----*/
+int sceGxmInitialize(const SceGxmInitializeParams *params);
+int sceGxmTerminate(void);
+volatile unsigned int *sceGxmGetNotificationRegion(void);
+int sceGxmMapMemory(void *base, SceSize size, SceGxmMemoryAttribFlags attr);
+int sceGxmUnmapMemory(void *base);
+int sceGxmMapVertexUsseMemory(void *base, SceSize size, unsigned int *offset);
+int sceGxmUnmapVertexUsseMemory(void *base);
+int sceGxmMapFragmentUsseMemory(void *base, SceSize size, unsigned int *offset);
+int sceGxmUnmapFragmentUsseMemory(void *base);
+
+/*----- Display queue -----*/
+//The callback runs on the calling thread, the stand-in's frames are done as soon as they end
+int sceGxmDisplayQueueAddEntry(SceGxmSyncObject *oldBuffer, SceGxmSyncObject *newBuffer, const void *callbackData);
+int sceGxmDisplayQueueFinish(void);
+int sceGxmSyncObjectCreate(SceGxmSyncObject **syncObject);
+int sceGxmSyncObjectDestroy(SceGxmSyncObject *syncObject);
+
+/*----- Contexts and scenes -----*/
+int sceGxmCreateContext(const SceGxmContextParams *params, SceGxmContext **context);
+int sceGxmDestroyContext(SceGxmContext *context);
+int sceGxmCreateRenderTarget(const SceGxmRenderTargetParams *params, SceGxmRenderTarget **renderTarget);
+int sceGxmDestroyRenderTarget(SceGxmRenderTarget *renderTarget);
+int sceGxmGetRenderTargetMemSize(const SceGxmRenderTargetParams *params, unsigned int *driverMemSize);
+int sceGxmBeginScene(SceGxmContext *context, unsigned int flags, const SceGxmRenderTarget *renderTarget, const SceGxmValidRegion *validRegion,
+	SceGxmSyncObject *vertexSyncObject, SceGxmSyncObject *fragmentSyncObject, const SceGxmColorSurface *colorSurface,
+	const SceGxmDepthStencilSurface *depthStencil);
+int sceGxmEndScene(SceGxmContext *context, const SceGxmNotification *vertexNotification, const SceGxmNotification *fragmentNotification);
+int sceGxmFinish(SceGxmContext *context);
+int sceGxmPadHeartbeat(const SceGxmColorSurface *displaySurface, SceGxmSyncObject *displaySyncObject);
+
+/*----- State -----*/
+void sceGxmSetVertexProgram(SceGxmContext *context, const SceGxmVertexProgram *vertexProgram);
+void sceGxmSetFragmentProgram(SceGxmContext *context, const SceGxmFragmentProgram *fragmentProgram);
+int sceGxmReserveVertexDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer);
+int sceGxmReserveFragmentDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer);
+int sceGxmSetVertexUniformBuffer(SceGxmContext *context, unsigned int bufferIndex, const void *bufferData);
+int sceGxmSetFragmentUniformBuffer(SceGxmContext *context, unsigned int bufferIndex, const void *bufferData);
+int sceGxmSetVertexStream(SceGxmContext *context, unsigned int streamIndex, const void *streamData);
+int sceGxmSetFragmentTexture(SceGxmContext *context, unsigned int textureIndex, const SceGxmTexture *texture);
+void sceGxmSetFrontDepthFunc(SceGxmContext *context, SceGxmDepthFunc depthFunc);
+void sceGxmSetFrontDepthWriteEnable(SceGxmContext *context, SceGxmDepthWriteMode enable);
+void sceGxmSetCullMode(SceGxmContext *context, SceGxmCullMode mode);
+void sceGxmSetRegionClip(SceGxmContext *context, SceGxmRegionClipMode mode, unsigned int xMin, unsigned int yMin, unsigned int xMax, unsigned int yMax);
+void sceGxmSetViewport(SceGxmContext *context, float xOffset, float xScale, float yOffset, float yScale, float zOffset, float zScale);
+int sceGxmDraw(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, const void *indexData, unsigned int indexCount);
+int sceGxmDrawInstanced(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, const void *indexData,
+	unsigned int indexCount, unsigned int indexWrap);
+
+/*----- Surfaces -----*/
+int sceGxmColorSurfaceInit(SceGxmColorSurface *surface, SceGxmColorFormat colorFormat, SceGxmColorSurfaceType surfaceType,
+	SceGxmColorSurfaceScaleMode scaleMode, SceGxmOutputRegisterSize outputRegisterSize, unsigned int width, unsigned int height,
+	unsigned int strideInPixels, void *data);
+int sceGxmDepthStencilSurfaceInit(SceGxmDepthStencilSurface *surface, SceGxmDepthStencilFormat depthStencilFormat,
+	SceGxmDepthStencilSurfaceType surfaceType, unsigned int strideInSamples, void *depthData, void *stencilData);
+int sceGxmDepthStencilSurfaceSetForceLoadMode(SceGxmDepthStencilSurface *surface, SceGxmDepthStencilForceLoadMode forceLoad);
+int sceGxmDepthStencilSurfaceSetForceStoreMode(SceGxmDepthStencilSurface *surface, SceGxmDepthStencilForceStoreMode forceStore);
+void sceGxmDepthStencilSurfaceSetBackgroundDepth(SceGxmDepthStencilSurface *surface, float backgroundDepth);
+
+/*----- Textures -----*/
+int sceGxmTextureInitLinear(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat, unsigned int width, unsigned int height, unsigned int mipCount);
+int sceGxmTextureInitSwizzled(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat, unsigned int width, unsigned int height, unsigned int mipCount);
+int sceGxmTextureSetMinFilter(SceGxmTexture *texture, SceGxmTextureFilter minFilter);
+int sceGxmTextureSetMagFilter(SceGxmTexture *texture, SceGxmTextureFilter magFilter);
+int sceGxmTextureSetMipFilter(SceGxmTexture *texture, SceGxmTextureMipFilter mipFilter);
+int sceGxmTextureSetUAddrMode(SceGxmTexture *texture, SceGxmTextureAddrMode mode);
+int sceGxmTextureSetVAddrMode(SceGxmTexture *texture, SceGxmTextureAddrMode mode);
+int sceGxmTextureSetLodBias(SceGxmTexture *texture, unsigned int bias);
+const void *sceGxmTextureGetData(const SceGxmTexture *texture);
+SceGxmTextureFormat sceGxmTextureGetFormat(const SceGxmTexture *texture);
+SceGxmTextureType sceGxmTextureGetType(const SceGxmTexture *texture);
+unsigned int sceGxmTextureGetWidth(const SceGxmTexture *texture);
+unsigned int sceGxmTextureGetHeight(const SceGxmTexture *texture);
+unsigned int sceGxmTextureGetMipmapCount(const SceGxmTexture *texture);
+SceGxmTextureFilter sceGxmTextureGetMinFilter(const SceGxmTexture *texture);
+SceGxmTextureFilter sceGxmTextureGetMagFilter(const SceGxmTexture *texture);
+SceGxmTextureMipFilter sceGxmTextureGetMipFilter(const SceGxmTexture *texture);
+SceGxmTextureAddrMode sceGxmTextureGetUAddrMode(const SceGxmTexture *texture);
+SceGxmTextureAddrMode sceGxmTextureGetVAddrMode(const SceGxmTexture *texture);
+unsigned int sceGxmTextureGetLodBias(const SceGxmTexture *texture);
+
+/*----- Programs -----*/
+int sceGxmProgramCheck(const SceGxmProgram *program);
+unsigned int sceGxmProgramGetSize(const SceGxmProgram *program);
+SceGxmProgramType sceGxmProgramGetType(const SceGxmProgram *program);
+unsigned int sceGxmProgramGetDefaultUniformBufferSize(const SceGxmProgram *program);
+unsigned int sceGxmProgramGetParameterCount(const SceGxmProgram *program);
+const SceGxmProgramParameter *sceGxmProgramGetParameter(const SceGxmProgram *program, unsigned int index);
+const SceGxmProgramParameter *sceGxmProgramFindParameterByName(const SceGxmProgram *program, const char *name);
+const char *sceGxmProgramParameterGetName(const SceGxmProgramParameter *parameter);
+SceGxmParameterCategory sceGxmProgramParameterGetCategory(const SceGxmProgramParameter *parameter);
+unsigned int sceGxmProgramParameterGetComponentCount(const SceGxmProgramParameter *parameter);
+unsigned int sceGxmProgramParameterGetArraySize(const SceGxmProgramParameter *parameter);
+unsigned int sceGxmProgramParameterGetResourceIndex(const SceGxmProgramParameter *parameter);
+unsigned int sceGxmProgramParameterGetContainerIndex(const SceGxmProgramParameter *parameter);
+int sceGxmSetUniformDataF(void *uniformBuffer, const SceGxmProgramParameter *parameter, unsigned int componentOffset,
+	unsigned int componentCount, const float *sourceData);
+
+/*----- Shader patcher -----*/
+//Its internal objects come from hostAllocCallback, the buffer and USSE memory aren't used
+int sceGxmShaderPatcherCreate(const SceGxmShaderPatcherParams *params, SceGxmShaderPatcher **shaderPatcher);
+int sceGxmShaderPatcherDestroy(SceGxmShaderPatcher *shaderPatcher);
+int sceGxmShaderPatcherRegisterProgram(SceGxmShaderPatcher *shaderPatcher, const SceGxmProgram *programHeader, SceGxmShaderPatcherId *programId);
+int sceGxmShaderPatcherUnregisterProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId);
+const SceGxmProgram *sceGxmShaderPatcherGetProgramFromId(SceGxmShaderPatcherId programId);
+//Identical requests share one program, reference counted, like the real patcher
+int sceGxmShaderPatcherCreateVertexProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId,
+	const SceGxmVertexAttribute *attributes, unsigned int attributeCount, const SceGxmVertexStream *streams, unsigned int streamCount,
+	SceGxmVertexProgram **vertexProgram);
+int sceGxmShaderPatcherCreateFragmentProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId,
+	SceGxmOutputRegisterFormat outputFormat, SceGxmMultisampleMode multisampleMode, const SceGxmBlendInfo *blendInfo,
+	const SceGxmProgram *vertexProgram, SceGxmFragmentProgram **fragmentProgram);
+int sceGxmShaderPatcherReleaseVertexProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmVertexProgram *vertexProgram);
+int sceGxmShaderPatcherReleaseFragmentProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmFragmentProgram *fragmentProgram);
+
+#ifdef __cplusplus
+}
+#endif
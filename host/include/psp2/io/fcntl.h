@@ -0,0 +1,32 @@
+#pragma once
+
+#include <psp2/types.h>
+
+#define SCE_O_RDONLY	0x0001
+#define SCE_O_WRONLY	0x0002
+#define SCE_O_RDWR		(SCE_O_RDONLY | SCE_O_WRONLY)
+#define SCE_O_APPEND	0x0100
+#define SCE_O_CREAT		0x0200
+#define SCE_O_TRUNC		0x0400
+
+typedef enum SceIoSeekMode
+{
+	SCE_SEEK_SET,
+	SCE_SEEK_CUR,
+	SCE_SEEK_END
+} SceIoSeekMode;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Device paths are mapped onto host directories, see HostPlatform.h
+SceUID sceIoOpen(const char *file, int flags, SceMode mode);
+int sceIoClose(SceUID fd);
+int sceIoRead(SceUID fd, void *data, SceSize size);
+int sceIoWrite(SceUID fd, const void *data, SceSize size);
+SceOff sceIoLseek(SceUID fd, SceOff offset, int whence);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int sceKernelExitProcess(int res);
+//Microseconds since the process started
+SceUInt64 sceKernelGetProcessTimeWide(void);
+SceUInt32 sceKernelGetProcessTimeLow(void);
+
+#ifdef __cplusplus
+}
+#endif
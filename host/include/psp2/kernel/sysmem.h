@@ -0,0 +1,40 @@
+#pragma once
+
+#include <psp2/types.h>
+
+typedef enum SceKernelMemBlockType
+{
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW = 0x09408060,
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE = 0x0C208060,
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_RW = 0x0C20D060
+} SceKernelMemBlockType;
+
+typedef struct SceKernelAllocMemBlockOpt
+{
+	SceSize size;
+	SceUInt32 attr;
+	SceSize alignment;
+} SceKernelAllocMemBlockOpt;
+
+typedef struct SceKernelFreeMemorySizeInfo
+{
+	int size;
+	int size_user;
+	int size_cdram;
+	int size_phycont;
+} SceKernelFreeMemorySizeInfo;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//CDRAM blocks are multiples of 256kB, the others of 4kB, like on the Vita
+SceUID sceKernelAllocMemBlock(const char *name, SceKernelMemBlockType type, SceSize size, SceKernelAllocMemBlockOpt *optp);
+int sceKernelFreeMemBlock(SceUID uid);
+int sceKernelGetMemBlockBase(SceUID uid, void **basep);
+//What is left of the Vita's memory, the stand-in counts its blocks against the same totals
+int sceKernelGetFreeMemorySize(SceKernelFreeMemorySizeInfo *info);
+
+#ifdef __cplusplus
+}
+#endif
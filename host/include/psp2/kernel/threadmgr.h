@@ -0,0 +1,62 @@
+#pragma once
+
+#include <psp2/types.h>
+
+typedef int (*SceKernelThreadEntry)(SceSize args, void *argp);
+
+typedef struct SceKernelThreadOptParam
+{
+	SceSize size;
+	SceUInt32 attr;
+} SceKernelThreadOptParam;
+
+//Priorities and affinities are accepted and ignored, the host schedules its threads itself
+#define SCE_KERNEL_THREAD_CPU_AFFINITY_MASK_DEFAULT	0
+#define SCE_KERNEL_CPU_MASK_USER_0					0x00010000
+#define SCE_KERNEL_CPU_MASK_USER_1					0x00020000
+#define SCE_KERNEL_CPU_MASK_USER_2					0x00040000
+#define SCE_KERNEL_HIGHEST_PRIORITY_USER			64
+#define SCE_KERNEL_LOWEST_PRIORITY_USER				191
+#define SCE_KERNEL_DEFAULT_PRIORITY_USER			0x10000100
+
+//Lightweight mutexes live in memory the caller owns, the stand-in keeps a host mutex in it
+typedef struct SceKernelLwMutexWork
+{
+	SceInt64 data[4];
+} SceKernelLwMutexWork;
+
+typedef struct SceKernelLwMutexOptParam
+{
+	SceSize size;
+} SceKernelLwMutexOptParam;
+
+#define SCE_KERNEL_MUTEX_ATTR_RECURSIVE				0x02
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//argp is copied when the thread starts, like the Vita copies it onto the new thread's stack
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int initPriority, SceSize stackSize, SceUInt attr, int cpuAffinityMask, const SceKernelThreadOptParam *option);
+int sceKernelStartThread(SceUID thid, SceSize arglen, void *argp);
+int sceKernelWaitThreadEnd(SceUID thid, int *stat, SceUInt *timeout);
+int sceKernelDeleteThread(SceUID thid);
+int sceKernelDelayThread(SceUInt delay);
+
+SceUID sceKernelCreateSema(const char *name, SceUInt attr, int initVal, int maxVal, void *option);
+int sceKernelDeleteSema(SceUID semaid);
+int sceKernelSignalSema(SceUID semaid, int signal);
+//The timeout isn't supported, a wait always waits until it gets the count
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt *timeout);
+int sceKernelPollSema(SceUID semaid, int signal);
+
+//Recursive or not, the stand-in's are always recursive. The timeout isn't supported
+int sceKernelCreateLwMutex(SceKernelLwMutexWork *pWork, const char *pName, unsigned int attr, int initCount, const SceKernelLwMutexOptParam *pOptParam);
+int sceKernelDeleteLwMutex(SceKernelLwMutexWork *pWork);
+int sceKernelLockLwMutex(SceKernelLwMutexWork *pWork, int lockCount, unsigned int *pTimeout);
+int sceKernelTryLockLwMutex(SceKernelLwMutexWork *pWork, int lockCount);
+int sceKernelUnlockLwMutex(SceKernelLwMutexWork *pWork, int unlockCount);
+
+#ifdef __cplusplus
+}
+#endif
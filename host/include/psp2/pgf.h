@@ -0,0 +1,162 @@
+#pragma once
+
+#include <psp2/types.h>
+
+//The stand-in has one font of plain box glyphs for printable ASCII, so text lays out and renders
+//the same on every host. Everything else is reported as missing from the font
+
+typedef void* SceFontLibHandle;
+typedef void* SceFontHandle;
+
+typedef enum SceFontPixelFormatCode
+{
+	SCE_FONT_PIXELFORMAT_4 = 0,
+	SCE_FONT_PIXELFORMAT_4_REV = 1,
+	SCE_FONT_PIXELFORMAT_8 = 2,
+	SCE_FONT_PIXELFORMAT_24 = 3,
+	SCE_FONT_PIXELFORMAT_32 = 4
+} SceFontPixelFormatCode;
+
+typedef enum SceFontFamilyCode
+{
+	SCE_FONT_FAMILY_DEFAULT = 0,
+	SCE_FONT_FAMILY_SANS_SERIF = 1,
+	SCE_FONT_FAMILY_SERIF = 2,
+	SCE_FONT_FAMILY_ROUNDED = 3
+} SceFontFamilyCode;
+
+typedef enum SceFontLanguageCode
+{
+	SCE_FONT_LANGUAGE_DEFAULT = 0,
+	SCE_FONT_LANGUAGE_JAPANESE = 1,
+	SCE_FONT_LANGUAGE_LATIN = 2,
+	SCE_FONT_LANGUAGE_KOREAN = 3,
+	SCE_FONT_LANGUAGE_CHINESE = 4
+} SceFontLanguageCode;
+
+typedef enum SceFontStyleCode
+{
+	SCE_FONT_STYLE_DEFAULT = 0,
+	SCE_FONT_STYLE_REGULAR = 1
+} SceFontStyleCode;
+
+typedef struct SceFontNewLibParams
+{
+	void* userData;
+	unsigned int numFonts;
+	void* cacheData;
+	void* (*allocFunc)(void*, unsigned int);
+	void (*freeFunc)(void*, void*);
+	void* openFunc;
+	void* closeFunc;
+	void* readFunc;
+	void* seekFunc;
+	void* errorFunc;
+	void* ioFinishFunc;
+} SceFontNewLibParams;
+
+typedef struct SceFontStyle
+{
+	float fontH;
+	float fontV;
+	float fontHRes;
+	float fontVRes;
+	float fontWeight;
+	unsigned short fontFamily;
+	unsigned short fontStyle;
+	unsigned short fontStyleSub;
+	unsigned short fontLanguage;
+	unsigned short fontRegion;
+	unsigned short fontCountry;
+	char fontName[64];
+	char fontFileName[64];
+	unsigned int fontAttributes;
+	unsigned int fontExpire;
+} SceFontStyle;
+
+typedef struct SceFontInfo
+{
+	//26.6 fixed point
+	unsigned int maxGlyphWidthI;
+	unsigned int maxGlyphHeightI;
+	unsigned int maxGlyphAscenderI;
+	unsigned int maxGlyphDescenderI;
+	unsigned int maxGlyphLeftXI;
+	unsigned int maxGlyphBaseYI;
+	unsigned int minGlyphCenterXI;
+	unsigned int maxGlyphTopYI;
+	unsigned int maxGlyphAdvanceXI;
+	unsigned int maxGlyphAdvanceYI;
+	float maxGlyphWidthF;
+	float maxGlyphHeightF;
+	float maxGlyphAscenderF;
+	float maxGlyphDescenderF;
+	float maxGlyphLeftXF;
+	float maxGlyphBaseYF;
+	float minGlyphCenterXF;
+	float maxGlyphTopYF;
+	float maxGlyphAdvanceXF;
+	float maxGlyphAdvanceYF;
+	unsigned short maxGlyphWidth;
+	unsigned short maxGlyphHeight;
+	unsigned int charMapLength;
+	unsigned int shadowMapLength;
+	SceFontStyle fontStyle;
+	unsigned char BPP;
+	unsigned char pad[3];
+} SceFontInfo;
+
+typedef struct SceFontCharInfo
+{
+	unsigned int bitmapWidth;
+	unsigned int bitmapHeight;
+	unsigned int bitmapLeft;
+	unsigned int bitmapTop;
+	//26.6 fixed point
+	unsigned int sfp26Width;
+	unsigned int sfp26Height;
+	int sfp26Ascender;
+	int sfp26Descender;
+	int sfp26BearingHX;
+	int sfp26BearingHY;
+	int sfp26BearingVX;
+	int sfp26BearingVY;
+	int sfp26AdvanceH;
+	int sfp26AdvanceV;
+	short shadowFlags;
+	short shadowId;
+} SceFontCharInfo;
+
+typedef struct SceFontGlyphImage
+{
+	unsigned int pixelFormat;
+	int xPos64;
+	int yPos64;
+	unsigned short bufWidth;
+	unsigned short bufHeight;
+	unsigned short bytesPerLine;
+	unsigned short pad;
+	void* bufferPtr;
+} SceFontGlyphImage;
+
+#define SCE_FONT_ERROR_INVALID_PARAMETER	0x80460003
+#define SCE_FONT_ERROR_NO_SUPPORT_GLYPH		0x80460008
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+SceFontLibHandle sceFontNewLib(SceFontNewLibParams* params, unsigned int* errorCode);
+int sceFontDoneLib(SceFontLibHandle libHandle);
+int sceFontSetResolution(SceFontLibHandle libHandle, float hResolution, float vResolution);
+int sceFontFindOptimumFont(SceFontLibHandle libHandle, SceFontStyle* fontStyle, unsigned int* errorCode);
+SceFontHandle sceFontOpen(SceFontLibHandle libHandle, unsigned int index, unsigned int mode, unsigned int* errorCode);
+int sceFontClose(SceFontHandle fontHandle);
+int sceFontGetFontInfo(SceFontHandle fontHandle, SceFontInfo* fontInfo);
+int sceFontGetCharInfo(SceFontHandle fontHandle, unsigned int charCode, SceFontCharInfo* charInfo);
+//Only SCE_FONT_PIXELFORMAT_8
+int sceFontGetCharGlyphImage(SceFontHandle fontHandle, unsigned int charCode, SceFontGlyphImage* glyphImage);
+
+#ifdef __cplusplus
+}
+#endif
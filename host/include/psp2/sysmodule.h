@@ -0,0 +1,16 @@
+#pragma once
+
+#include <psp2/types.h>
+
+#define SCE_SYSMODULE_PGF	0x0010
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int sceSysmoduleLoadModule(SceUInt16 id);
+int sceSysmoduleUnloadModule(SceUInt16 id);
+
+#ifdef __cplusplus
+}
+#endif
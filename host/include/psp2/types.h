@@ -0,0 +1,38 @@
+#pragma once
+
+//----------------------------------------------
+// Host stand-in for the Vita SDK
+// Declares the part of the SDK the engine uses so src/ builds for the host machine,
+// host/*.cpp implement it on top of the host OS. Only what the engine calls is here,
+// with the SDK's names and values wherever the engine depends on them
+//-----------------------------------------------
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int SceUID;
+typedef unsigned int SceSize;
+typedef int SceSSize;
+typedef unsigned int SceUInt;
+typedef int SceInt;
+typedef uint8_t SceUInt8;
+typedef uint16_t SceUInt16;
+typedef uint32_t SceUInt32;
+typedef int32_t SceInt32;
+typedef uint64_t SceUInt64;
+typedef int64_t SceInt64;
+typedef int64_t SceOff;
+typedef int SceMode;
+typedef char SceChar8;
+typedef int SceBool;
+
+#define SCE_UID_INVALID_UID		(-1)
+
+//Kernel errors the stand-in returns
+#define SCE_KERNEL_ERROR_ILLEGAL_MEMBLOCK_SIZE	0x80020000
+#define SCE_KERNEL_ERROR_NO_MEMORY				0x80020190
+#define SCE_KERNEL_ERROR_UNKNOWN_UID			0x800201DF
+#define SCE_KERNEL_ERROR_ILLEGAL_COUNT			0x8002001D
+#define SCE_KERNEL_ERROR_SEMA_ZERO				0x8002814A
+#define SCE_KERNEL_ERROR_SEMA_OVF				0x8002814B
+#define SCE_KERNEL_ERROR_LW_MUTEX_FAILED_TO_OWN	0x800201CA
@@ -0,0 +1,249 @@
+//----------------------------------------------
+// render
+// Draws frames through the engine's Graphics with the host stand-in's software rasterizer on,
+// writes every displayed frame to an image and, given a directory of known good images, checks
+// each frame against the one of the same name. What the frames look like can then be checked
+// after a change the same way replay checks what they cost.
+//	render [-c capture.gcap] [-s scene] [-f frames] [-o directory] [-g golden directory] [-t tolerance] [-j threads]
+// Without a capture it draws scene for frames frames (1 by default), the demo triangle,
+// "particles", a fountain from the ParticleSystem, or "crowd", the skinned DemoCrowd, both
+// stepped 1/60s a frame. Images are
+// frame_000.ppm, frame_001.ppm... in the output directory (the working directory by default).
+// tolerance is how far off a color channel may be, 0 by default. The exit code is 1 when a frame
+// doesn't match or is missing from the golden directory, or when a draw was rejected.
+// Only the clear, basic, particle and skinned shaders have C++ versions so far, see host/HostShaders.cpp
+// make check draws the built-in scenes and compares them with host/render/golden, make golden redraws those
+//-----------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Graphics.h"
+#include "GraphicsConfig.h"
+#include "CaptureReplay.h"
+#include "ProgramCache.h"
+#include "JobSystem.h"
+#include "ParticleSystem.h"
+#include "DemoCrowd.h"
+#include "Triangle.h"
+
+#include <HostPlatform.h>
+
+//What happens to every displayed frame
+typedef struct RenderOutput
+{
+	const char* directory;
+	const char* goldenDirectory;		//nullptr when not comparing
+	unsigned int tolerance;
+	unsigned int frames;
+	unsigned int mismatches;
+	bool failed;
+} RenderOutput;
+
+static void frameDisplayed(const SceDisplayFrameBuf* frame, void* userData)
+{
+	RenderOutput* output = (RenderOutput*)userData;
+	char name[32];
+	snprintf(name, sizeof(name), "frame_%03u.ppm", output->frames++);
+
+	char path[512];
+	snprintf(path, sizeof(path), "%s/%s", output->directory, name);
+	if (!hostWriteImage(path, frame->base, frame->width, frame->height, frame->pitch))
+	{
+		printf("could not write %s\n", path);
+		output->failed = true;
+	}
+	if (output->goldenDirectory == nullptr)
+		return;
+
+	snprintf(path, sizeof(path), "%s/%s", output->goldenDirectory, name);
+	HostImageDiff diff;
+	if (!hostCompareImage(path, frame->base, frame->width, frame->height, frame->pitch, output->tolerance, &diff))
+	{
+		if (diff.differentPixels > 0)
+			printf("%s: %u pixels differ, by up to %u\n", name, diff.differentPixels, diff.maxDifference);
+		else
+			printf("%s: no golden image of the same size in %s\n", name, output->goldenDirectory);
+		output->mismatches++;
+	}
+}
+
+static void drawTriangle(unsigned int frames)
+{
+	Graphics* graphics = Graphics::getInstance();
+	//patched up front, a golden image shouldn't depend on which thread got to a program first
+	ProgramCache programCache;
+	unsigned int variantCount = 0;
+	const ProgramVariant* variants = Triangle::getProgramVariants(&variantCount);
+	programCache.add(variants, variantCount);
+	programCache.start();
+	programCache.finish();
+	Triangle triangle;
+	triangle.init(&programCache);
+	for (unsigned int i = 0; i < frames; i++)
+	{
+		triangle.update();
+		graphics->startScene();
+		graphics->clearScreen();
+		triangle.draw();
+		graphics->endScene();
+		graphics->swapBuffers();
+	}
+	//both go through the release queue, nothing has to wait for the last frame
+	triangle.cleanup();
+	programCache.shutdown();
+}
+
+static void drawParticles(unsigned int frames)
+{
+	Graphics* graphics = Graphics::getInstance();
+	JobSystem::getInstance()->init();
+	ParticleSystem particles;
+	particles.init();
+	particles.setGravity(0.0f, 240.0f);
+	particles.setDrag(0.2f);
+
+	//two fountains going up either side of the screen, warm on the left and cool on the right
+	const GraphicsConfig* config = graphics->getConfig();
+	ParticleEmitter emitter;
+	memset(&emitter, 0, sizeof(ParticleEmitter));
+	emitter.x = config->displayWidth * 0.3f;
+	emitter.y = config->displayHeight * 0.9f;
+	emitter.rate = 3000.0f;
+	emitter.direction = -1.5708f;
+	emitter.spread = 0.35f;
+	emitter.speedMin = 200.0f;
+	emitter.speedMax = 420.0f;
+	emitter.lifetimeMin = 1.0f;
+	emitter.lifetimeMax = 2.0f;
+	emitter.sizeMin = 4.0f;
+	emitter.sizeMax = 12.0f;
+	emitter.color = RGBA8(255, 140, 40, 160);
+	emitter.active = true;
+	particles.addEmitter(&emitter);
+	emitter.x = config->displayWidth * 0.7f;
+	emitter.color = RGBA8(60, 140, 255, 160);
+	particles.addEmitter(&emitter);
+
+	for (unsigned int i = 0; i < frames; i++)
+	{
+		particles.update(1.0f / 60.0f);
+		graphics->startScene();
+		graphics->clearScreen();
+		particles.draw();
+		graphics->endScene();
+		graphics->swapBuffers();
+	}
+	particles.shutdown();
+	JobSystem::getInstance()->shutdown();
+}
+
+static void drawCrowd(unsigned int frames)
+{
+	Graphics* graphics = Graphics::getInstance();
+	JobSystem::getInstance()->init();
+	DemoCrowd crowd;
+	if (crowd.init())
+	{
+		for (unsigned int i = 0; i < frames; i++)
+		{
+			crowd.update(1.0f / 60.0f);
+			graphics->startScene();
+			graphics->clearScreen();
+			crowd.draw();
+			graphics->endScene();
+			graphics->swapBuffers();
+		}
+	}
+	crowd.cleanup();
+	JobSystem::getInstance()->shutdown();
+}
+
+int main(int argc, char** argv)
+{
+	const char* capturePath = nullptr;
+	const char* scene = "triangle";
+	unsigned int frames = 1;
+	unsigned int threads = 0;
+	RenderOutput output;
+	memset(&output, 0, sizeof(RenderOutput));
+	output.directory = ".";
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = (i + 1 < argc) && argv[i][0] == '-' && strlen(argv[i]) == 2;
+		char option = hasValue ? argv[i][1] : 0;
+		if (option == 'c')
+			capturePath = argv[++i];
+		else if (option == 's')
+			scene = argv[++i];
+		else if (option == 'f')
+			frames = (unsigned int)atoi(argv[++i]);
+		else if (option == 'o')
+			output.directory = argv[++i];
+		else if (option == 'g')
+			output.goldenDirectory = argv[++i];
+		else if (option == 't')
+			output.tolerance = (unsigned int)atoi(argv[++i]);
+		else if (option == 'j')
+			threads = (unsigned int)atoi(argv[++i]);
+		else
+		{
+			printf("usage: %s [-c capture.gcap] [-s scene] [-f frames] [-o directory] [-g golden directory] [-t tolerance] [-j threads]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (frames == 0)
+		frames = 1;
+
+	//the frame goes straight to the display, a scaled one would be blitted with a shader the rasterizer doesn't have
+	GraphicsConfig config;
+	getDefaultGraphicsConfig(&config);
+	config.dynamicResolution = false;
+	if (!Graphics::getInstance()->initGraphics(&config))
+	{
+		printf("Graphics failed to initialize\n");
+		return 1;
+	}
+	hostSetRasterizer(true, threads);
+	hostSetDisplayCallback(frameDisplayed, &output);
+
+	int result = 0;
+	if (capturePath != nullptr)
+	{
+		CaptureReplay captureReplay;
+		if (captureReplay.load(capturePath))
+		{
+			captureReplay.replay(1, nullptr);
+			captureReplay.unload();
+		}
+		else
+		{
+			printf("could not load %s\n", capturePath);
+			result = 1;
+		}
+	}
+	else if (strcmp(scene, "particles") == 0)
+		drawParticles(frames);
+	else if (strcmp(scene, "crowd") == 0)
+		drawCrowd(frames);
+	else
+		drawTriangle(frames);
+
+	hostSetDisplayCallback(nullptr, nullptr);
+	Graphics::getInstance()->shutdownGraphics();
+
+	HostGxmStats gxmStats;
+	hostGetGxmStats(&gxmStats);
+	HostRasterStats rasterStats;
+	hostGetRasterStats(&rasterStats);
+	printf("%u frames, %u draws (%u not shaded, %u rejected), %u triangles (%u culled, %u clipped), %llu pixels in %.2fms\n",
+		output.frames, rasterStats.draws, rasterStats.unshadedDraws, gxmStats.drawErrors, rasterStats.triangles,
+		rasterStats.culledTriangles, rasterStats.clippedTriangles, (unsigned long long)rasterStats.pixels, rasterStats.rasterTime / 1000.0);
+	if (output.goldenDirectory != nullptr)
+		printf("%u of %u frames match %s\n", output.frames - output.mismatches, output.frames, output.goldenDirectory);
+	if (output.failed || output.mismatches > 0 || gxmStats.drawErrors > 0)
+		result = 1;
+	return result;
+}
@@ -0,0 +1,67 @@
+//----------------------------------------------
+// replay
+// Submits a capture written by Graphics::startCapture() (see src/CaptureReplay.h) through the
+// engine's Graphics built against the host stand-in, and prints what each frame cost the CPU.
+// The same frames every run, so the numbers can be compared between changes.
+//	replay <capture.gcap> [loops]
+// Captures replay on the platform that recorded them, for this tool one made on the host
+//-----------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Graphics.h"
+#include "GraphicsConfig.h"
+#include "CaptureReplay.h"
+
+#include <HostPlatform.h>
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("usage: %s <capture.gcap> [loops]\n", argv[0]);
+		return 1;
+	}
+	unsigned int loops = (argc > 2) ? (unsigned int)atoi(argv[2]) : 1;
+	if (loops == 0)
+		loops = 1;
+
+	GraphicsConfig config;
+	getDefaultGraphicsConfig(&config);
+	if (!Graphics::getInstance()->initGraphics(&config))
+	{
+		printf("Graphics failed to initialize\n");
+		return 1;
+	}
+
+	int result = 0;
+	CaptureReplay captureReplay;
+	if (captureReplay.load(argv[1]))
+	{
+		hostResetGxmStats();
+		CaptureReplayStats stats;
+		captureReplay.replay(loops, &stats);
+		HostGxmStats gxmStats;
+		hostGetGxmStats(&gxmStats);
+
+		printf("%s: %u frames x %u loops, %u draws\n", argv[1], captureReplay.getFrameCount(), loops, stats.draws);
+		if (stats.frames > 0)
+			printf("submission per frame: %.3fms average, %.3fms min, %.3fms max, %.2fms total\n",
+				(stats.frameTimeTotal / (double)stats.frames) / 1000.0, stats.frameTimeMin / 1000.0,
+				stats.frameTimeMax / 1000.0, stats.frameTimeTotal / 1000.0);
+		printf("gxm: %u scenes, %u draws, %u indices, %u uniform reserves, %u rejected draws\n", gxmStats.scenes,
+			gxmStats.draws, gxmStats.indices, gxmStats.uniformReserves, gxmStats.drawErrors);
+		if (gxmStats.drawErrors > 0)
+			result = 1;
+		captureReplay.unload();
+	}
+	else
+	{
+		printf("could not load %s\n", argv[1]);
+		result = 1;
+	}
+
+	Graphics::getInstance()->shutdownGraphics();
+	return result;
+}
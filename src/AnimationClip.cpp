@@ -0,0 +1,305 @@
+#include "AnimationClip.h"
+#include "commonUtils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define ROTATION_QUANTIZE		32767.0f
+#define TRANSLATION_QUANTIZE	65535.0f
+
+static int16_t quantizeRotation(float value)
+{
+	float scaled = value * ROTATION_QUANTIZE;
+	scaled = (scaled > ROTATION_QUANTIZE) ? ROTATION_QUANTIZE : ((scaled < -ROTATION_QUANTIZE) ? -ROTATION_QUANTIZE : scaled);
+	return (int16_t)lrintf(scaled);
+}
+
+//Mixes SIMD_WIDTH bones of a and b into result. Each holds 4 rotation components then 3 translation ones, stride
+//floats apart. Both quaternions are put in the same hemisphere before they are mixed and the result is normalized
+//again (nlerp), so they only have to be scaled alike, not unit length
+static void blendGroup(const float* a, const float* b, unsigned int stride, SimdFloat4 weight, float* result, unsigned int resultStride)
+{
+	SimdFloat4 zero = simdSplat(0.0f);
+	SimdFloat4 qa[4];
+	SimdFloat4 qb[4];
+	SimdFloat4 dot = zero;
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		qa[c] = simdLoad(a + c * stride);
+		qb[c] = simdLoad(b + c * stride);
+		dot = simdMulAdd(dot, qa[c], qb[c]);
+	}
+	SimdUint4 flip = simdLess(dot, zero);
+
+	SimdFloat4 q[4];
+	SimdFloat4 length = zero;
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		qb[c] = simdSelect(flip, simdSub(zero, qb[c]), qb[c]);
+		q[c] = simdMulAdd(qa[c], simdSub(qb[c], qa[c]), weight);
+		length = simdMulAdd(length, q[c], q[c]);
+	}
+	SimdFloat4 inverseLength = simdReciprocalSqrt(length);
+	for (unsigned int c = 0; c < 4; c++)
+		simdStore(result + c * resultStride, simdMul(q[c], inverseLength));
+
+	for (unsigned int c = 4; c < 7; c++)
+	{
+		SimdFloat4 ta = simdLoad(a + c * stride);
+		SimdFloat4 tb = simdLoad(b + c * stride);
+		simdStore(result + c * resultStride, simdMulAdd(ta, simdSub(tb, ta), weight));
+	}
+}
+
+//result = a * b, both 3x4. Each row of the result is a sum of b's rows, with a's translation added on
+static inline void multiplyBoneMatrices(const float* a, const float* b, float* result)
+{
+	SimdFloat4 row0 = simdLoad(b);
+	SimdFloat4 row1 = simdLoad(b + 4);
+	SimdFloat4 row2 = simdLoad(b + 8);
+	for (unsigned int r = 0; r < 3; r++)
+	{
+		const float* aRow = a + r * 4;
+		float translation[4] = { 0.0f, 0.0f, 0.0f, aRow[3] };
+		SimdFloat4 row = simdMulAdd(simdLoad(translation), simdSplat(aRow[0]), row0);
+		row = simdMulAdd(row, simdSplat(aRow[1]), row1);
+		row = simdMulAdd(row, simdSplat(aRow[2]), row2);
+		simdStore(result + r * 4, row);
+	}
+}
+
+AnimationClip::AnimationClip()
+{
+	keys_ptr = nullptr;
+	keyCount = 0;
+	boneCount = 0;
+	groupCount = 0;
+	frameRate = 0.0f;
+	looping = false;
+	memset(translationBias, 0, sizeof(translationBias));
+	memset(translationScale, 0, sizeof(translationScale));
+}
+
+AnimationClip::~AnimationClip()
+{
+	unload();
+}
+
+bool AnimationClip::build(const BoneTransform* keys, unsigned int keyCount, unsigned int boneCount, float frameRate, bool looping,
+	const char* name)
+{
+	unload();
+	if (keyCount == 0 || boneCount == 0 || boneCount > SKELETON_MAX_BONES || frameRate <= 0.0f)
+	{
+		vitaPrintf("ERROR: %s: %u keys of %u bones at %.1f a second, clips need keys, 1 to %d bones and a frame rate\n", name, keyCount,
+			boneCount, frameRate, SKELETON_MAX_BONES);
+		return false;
+	}
+	this->keyCount = keyCount;
+	this->boneCount = boneCount;
+	this->frameRate = frameRate;
+	this->looping = looping;
+	groupCount = (boneCount + SIMD_WIDTH - 1) / SIMD_WIDTH;
+
+	//translations are quantized inside the bounds of every translation in the clip
+	float low[3];
+	float high[3];
+	for (unsigned int c = 0; c < 3; c++)
+	{
+		low[c] = keys[0].translation[c];
+		high[c] = keys[0].translation[c];
+	}
+	for (unsigned int i = 1; i < keyCount * boneCount; i++)
+	{
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			if (keys[i].translation[c] < low[c])
+				low[c] = keys[i].translation[c];
+			if (keys[i].translation[c] > high[c])
+				high[c] = keys[i].translation[c];
+		}
+	}
+	for (unsigned int c = 0; c < 3; c++)
+	{
+		translationBias[c] = low[c];
+		translationScale[c] = (high[c] - low[c]) / TRANSLATION_QUANTIZE;
+	}
+
+	//the lanes past the last bone hold identities, they are sampled with the rest of their group
+	keys_ptr = (AnimationKeyGroup*)malloc(keyCount * groupCount * sizeof(AnimationKeyGroup));
+	memset(keys_ptr, 0, keyCount * groupCount * sizeof(AnimationKeyGroup));
+	for (unsigned int key = 0; key < keyCount; key++)
+	{
+		for (unsigned int bone = 0; bone < groupCount * SIMD_WIDTH; bone++)
+		{
+			AnimationKeyGroup* group = &keys_ptr[key * groupCount + bone / SIMD_WIDTH];
+			unsigned int lane = bone % SIMD_WIDTH;
+			if (bone >= boneCount)
+			{
+				group->rotation[3][lane] = (int16_t)ROTATION_QUANTIZE;
+				continue;
+			}
+			const BoneTransform* transform = &keys[key * boneCount + bone];
+			for (unsigned int c = 0; c < 4; c++)
+				group->rotation[c][lane] = quantizeRotation(transform->rotation[c]);
+			for (unsigned int c = 0; c < 3; c++)
+			{
+				float value = (translationScale[c] > 0.0f) ? (transform->translation[c] - translationBias[c]) / translationScale[c] : 0.0f;
+				group->translation[c][lane] = (uint16_t)lrintf(value);
+			}
+		}
+	}
+
+	unsigned int floatSize = keyCount * boneCount * sizeof(BoneTransform);
+	vitaPrintf("%s: %u keys of %u bones, %.2fs, %u bytes quantized (%u as floats)\n", name, keyCount, boneCount, getDuration(),
+		getSize(), floatSize);
+	return true;
+}
+
+void AnimationClip::unload()
+{
+	free(keys_ptr);
+	keys_ptr = nullptr;
+	keyCount = 0;
+	boneCount = 0;
+	groupCount = 0;
+}
+
+bool AnimationClip::isLoaded()
+{
+	return keys_ptr != nullptr;
+}
+
+void AnimationClip::sample(float time, AnimationPose* pose) const
+{
+	//the two keys around time and how far it is between them
+	float position = time * frameRate;
+	unsigned int key0 = 0;
+	unsigned int key1 = 0;
+	if (looping)
+	{
+		position = fmodf(position, (float)keyCount);
+		if (position < 0.0f)
+			position += (float)keyCount;
+		key0 = (unsigned int)position;
+		if (key0 >= keyCount)
+			key0 = keyCount - 1;
+		key1 = (key0 + 1) % keyCount;
+	}
+	else
+	{
+		float last = (float)(keyCount - 1);
+		position = (position < 0.0f) ? 0.0f : ((position > last) ? last : position);
+		key0 = (unsigned int)position;
+		key1 = (key0 + 1 < keyCount) ? key0 + 1 : key0;
+	}
+	SimdFloat4 weight = simdSplat(position - (float)key0);
+
+	SimdFloat4 bias[3];
+	SimdFloat4 scale[3];
+	for (unsigned int c = 0; c < 3; c++)
+	{
+		bias[c] = simdSplat(translationBias[c]);
+		scale[c] = simdSplat(translationScale[c]);
+	}
+
+	//both keys are widened into a pose's layout and mixed like any two poses. The rotations stay scaled by 32767,
+	//normalizing the result takes it out again
+	float keyPoses[2][7][SIMD_WIDTH];
+	for (unsigned int group = 0; group < groupCount; group++)
+	{
+		const AnimationKeyGroup* keys[2] = { &keys_ptr[key0 * groupCount + group], &keys_ptr[key1 * groupCount + group] };
+		for (unsigned int k = 0; k < 2; k++)
+		{
+			for (unsigned int c = 0; c < 4; c++)
+				simdStore(keyPoses[k][c], simdLoadInt16(keys[k]->rotation[c]));
+			for (unsigned int c = 0; c < 3; c++)
+				simdStore(keyPoses[k][4 + c], simdMulAdd(bias[c], simdLoadUint16(keys[k]->translation[c]), scale[c]));
+		}
+
+		blendGroup(keyPoses[0][0], keyPoses[1][0], SIMD_WIDTH, weight, &pose->rotation[0][group * SIMD_WIDTH], SKELETON_MAX_BONES);
+	}
+}
+
+float AnimationClip::getDuration() const
+{
+	if (keyCount == 0)
+		return 0.0f;
+	return (looping ? keyCount : keyCount - 1) / frameRate;
+}
+
+unsigned int AnimationClip::getBoneCount() const
+{
+	return boneCount;
+}
+
+unsigned int AnimationClip::getSize() const
+{
+	return keyCount * groupCount * sizeof(AnimationKeyGroup);
+}
+
+void blendAnimationPoses(const AnimationPose* a, const AnimationPose* b, float weight, unsigned int boneCount, AnimationPose* result)
+{
+	//the translations follow the rotations, a pose is 7 components of SKELETON_MAX_BONES floats
+	SimdFloat4 weights = simdSplat(weight);
+	for (unsigned int bone = 0; bone < boneCount; bone += SIMD_WIDTH)
+		blendGroup(&a->rotation[0][bone], &b->rotation[0][bone], SKELETON_MAX_BONES, weights, &result->rotation[0][bone], SKELETON_MAX_BONES);
+}
+
+void buildSkinningPalette(const Skeleton* skeleton, const AnimationPose* pose, const float* root, float* palette)
+{
+	//every bone's matrix relative to its parent, four bones at a time. Transposing a row of four bones' matrices
+	//gives that row of each bone
+	float local[SKELETON_MAX_BONES][BONE_MATRIX_SIZE];
+	for (unsigned int bone = 0; bone < skeleton->boneCount; bone += SIMD_WIDTH)
+	{
+		SimdFloat4 x = simdLoad(&pose->rotation[0][bone]);
+		SimdFloat4 y = simdLoad(&pose->rotation[1][bone]);
+		SimdFloat4 z = simdLoad(&pose->rotation[2][bone]);
+		SimdFloat4 w = simdLoad(&pose->rotation[3][bone]);
+		SimdFloat4 one = simdSplat(1.0f);
+		SimdFloat4 two = simdSplat(2.0f);
+		SimdFloat4 x2 = simdMul(x, two);
+		SimdFloat4 y2 = simdMul(y, two);
+		SimdFloat4 z2 = simdMul(z, two);
+		SimdFloat4 xx = simdMul(x, x2);
+		SimdFloat4 yy = simdMul(y, y2);
+		SimdFloat4 zz = simdMul(z, z2);
+		SimdFloat4 xy = simdMul(x, y2);
+		SimdFloat4 xz = simdMul(x, z2);
+		SimdFloat4 yz = simdMul(y, z2);
+		SimdFloat4 wx = simdMul(w, x2);
+		SimdFloat4 wy = simdMul(w, y2);
+		SimdFloat4 wz = simdMul(w, z2);
+
+		SimdFloat4 rows[3][4];
+		rows[0][0] = simdSub(one, simdAdd(yy, zz));
+		rows[0][1] = simdSub(xy, wz);
+		rows[0][2] = simdAdd(xz, wy);
+		rows[0][3] = simdLoad(&pose->translation[0][bone]);
+		rows[1][0] = simdAdd(xy, wz);
+		rows[1][1] = simdSub(one, simdAdd(xx, zz));
+		rows[1][2] = simdSub(yz, wx);
+		rows[1][3] = simdLoad(&pose->translation[1][bone]);
+		rows[2][0] = simdSub(xz, wy);
+		rows[2][1] = simdAdd(yz, wx);
+		rows[2][2] = simdSub(one, simdAdd(xx, yy));
+		rows[2][3] = simdLoad(&pose->translation[2][bone]);
+		for (unsigned int r = 0; r < 3; r++)
+		{
+			simdTranspose(&rows[r][0], &rows[r][1], &rows[r][2], &rows[r][3]);
+			for (unsigned int lane = 0; lane < SIMD_WIDTH; lane++)
+				simdStore(&local[bone + lane][r * 4], rows[r][lane]);
+		}
+	}
+
+	//parents come first, their model matrices are always ready for their children
+	float model[SKELETON_MAX_BONES][BONE_MATRIX_SIZE];
+	for (unsigned int bone = 0; bone < skeleton->boneCount; bone++)
+	{
+		int parent = skeleton->_parents[bone];
+		multiplyBoneMatrices((parent == SKELETON_NO_PARENT) ? root : model[parent], local[bone], model[bone]);
+		multiplyBoneMatrices(model[bone], skeleton->_inverseBind[bone], palette + bone * BONE_MATRIX_SIZE);
+	}
+}
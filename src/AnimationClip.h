@@ -0,0 +1,88 @@
+#pragma once
+
+//----------------------------------------------
+// AnimationClip Class
+// Keyframes of a skeleton sampled at a fixed rate, quantized to 16 bits a component: rotations
+// as normalized quaternions and translations inside the clip's bounds. Scale isn't animated.
+// The keys are stored in groups of SIMD_WIDTH bones, component by component, so sample() loads,
+// interpolates and normalizes four bones at a time straight from the quantized data.
+// Poses are structures of arrays as well, blendAnimationPoses() mixes two of them the same way
+// and buildSkinningPalette() turns one into the matrices a skinned vertex program reads.
+// Matrices are 3x4, three rows of (rotation, translation) applied to column vectors
+//-----------------------------------------------
+
+#include <stdint.h>
+
+#include "Simd.h"
+
+//Bones a skeleton has at most, also the size of the palette in skinned_vertex.cg
+#define SKELETON_MAX_BONES			32
+#define SKELETON_NO_PARENT			-1
+//Floats in a bone matrix
+#define BONE_MATRIX_SIZE			12
+
+//Parents come before their children, so the hierarchy is evaluated in a single pass in bone order
+typedef struct Skeleton
+{
+	unsigned int boneCount;
+	int _parents[SKELETON_MAX_BONES];							//SKELETON_NO_PARENT for a root
+	float _inverseBind[SKELETON_MAX_BONES][BONE_MATRIX_SIZE];	//model space to the bone's space in the bind pose
+} Skeleton;
+
+//A bone relative to its parent, what clips are built from
+typedef struct BoneTransform
+{
+	float rotation[4];			//unit quaternion x, y, z, w
+	float translation[3];
+} BoneTransform;
+
+//Every bone of a skeleton relative to its parent, component by component. Room for whole groups of SIMD_WIDTH bones
+typedef struct AnimationPose
+{
+	float rotation[4][SKELETON_MAX_BONES];
+	float translation[3][SKELETON_MAX_BONES];
+} AnimationPose;
+
+//One key of SIMD_WIDTH bones, lane i of every component is the same bone
+typedef struct AnimationKeyGroup
+{
+	int16_t rotation[4][SIMD_WIDTH];		//times 32767
+	uint16_t translation[3][SIMD_WIDTH];	//translationBias + value * translationScale
+} AnimationKeyGroup;
+
+class AnimationClip
+{
+public:
+	AnimationClip();
+	~AnimationClip();
+
+	//Quantizes keyCount keys of boneCount transforms each, key after key, taken frameRate times a second.
+	//A looping clip runs from its last key back into its first
+	bool build(const BoneTransform* keys, unsigned int keyCount, unsigned int boneCount, float frameRate, bool looping,
+		const char* name = "clip");
+	void unload();
+	bool isLoaded();
+
+	//The pose time seconds in, wrapped around for a looping clip and held at the ends otherwise
+	void sample(float time, AnimationPose* pose) const;
+	float getDuration() const;
+	unsigned int getBoneCount() const;
+	//Bytes the quantized keys take
+	unsigned int getSize() const;
+
+private:
+	AnimationKeyGroup* keys_ptr;
+	unsigned int keyCount;
+	unsigned int boneCount;
+	unsigned int groupCount;		//per key
+	float frameRate;
+	bool looping;
+	float translationBias[3];
+	float translationScale[3];
+};
+
+//result = a blended towards b by weight, 0 is all a. result may be a or b
+void blendAnimationPoses(const AnimationPose* a, const AnimationPose* b, float weight, unsigned int boneCount, AnimationPose* result);
+//Model matrices of every bone of pose placed by root (3x4), times the skeleton's inverse bind matrices.
+//palette gets BONE_MATRIX_SIZE floats a bone
+void buildSkinningPalette(const Skeleton* skeleton, const AnimationPose* pose, const float* root, float* palette);
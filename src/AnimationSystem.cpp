@@ -0,0 +1,302 @@
+#include "AnimationSystem.h"
+#include "JobSystem.h"
+#include "commonUtils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <psp2/kernel/processmgr.h>
+
+//built from src/shaders/vertexShaders/skinned_vertex.cg by the Makefile, the fragment program is basic_fragment.cg
+extern const SceGxmProgram skinned_v_gxp_start;
+extern const SceGxmProgram color_f_gxp_start;
+
+AnimationSystem::AnimationSystem()
+{
+	memset(&stats, 0, sizeof(stats));
+	initialized = false;
+	memset(&skeleton, 0, sizeof(skeleton));
+
+	_characters = nullptr;
+	characterCount = 0;
+	maxCharacters = 0;
+
+	vertices_ptr = nullptr;
+	indices_ptr = nullptr;
+	indexCount = 0;
+
+	paletteParam_ptr = nullptr;
+	palettes_ptr = nullptr;
+	paletteCount = 0;
+	paletteFrame = 0;
+
+	vertexProgramID = nullptr;
+	fragmentProgramID = nullptr;
+	viewProjectionParam_ptr = nullptr;
+}
+
+AnimationSystem::~AnimationSystem()
+{
+	free(_characters);
+}
+
+bool AnimationSystem::init(const Skeleton* skeleton, const SkinnedVertex* vertices, unsigned int vertexCount, const uint16_t* indices,
+	unsigned int indexCount, unsigned int maxCharacters)
+{
+	vitaPrintf("\nInitializing animation system for %u characters of %u bones\n", maxCharacters, skeleton->boneCount);
+	if (skeleton->boneCount == 0 || skeleton->boneCount > SKELETON_MAX_BONES)
+	{
+		vitaPrintf("ERROR: skeletons have 1 to %d bones, not %u\n", SKELETON_MAX_BONES, skeleton->boneCount);
+		return false;
+	}
+	//the hierarchy is evaluated in one pass, every parent has to be done before its children
+	for (unsigned int bone = 0; bone < skeleton->boneCount; bone++)
+	{
+		int parent = skeleton->_parents[bone];
+		if (parent != SKELETON_NO_PARENT && (parent < 0 || parent >= (int)bone))
+		{
+			vitaPrintf("ERROR: bone %u has parent %d, parents have to come before their children\n", bone, parent);
+			return false;
+		}
+	}
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		for (unsigned int j = 0; j < 4; j++)
+		{
+			if (vertices[i].weights[j] != 0 && vertices[i].bones[j] >= skeleton->boneCount)
+			{
+				vitaPrintf("ERROR: vertex %u is skinned to bone %u, the skeleton has %u\n", i, vertices[i].bones[j], skeleton->boneCount);
+				return false;
+			}
+		}
+	}
+	if (maxCharacters == 0)
+		maxCharacters = 1;
+	this->skeleton = *skeleton;
+	this->maxCharacters = maxCharacters;
+	this->indexCount = indexCount;
+	Graphics* graphics = Graphics::getInstance();
+
+	_characters = (AnimationCharacter*)malloc(maxCharacters * sizeof(AnimationCharacter));
+	memset(_characters, 0, maxCharacters * sizeof(AnimationCharacter));
+	characterCount = 0;
+
+	SceUID uid = -1;
+	SceSize verticesSize = ALIGN_MEM(vertexCount * sizeof(SkinnedVertex), 16);
+	void* memory_ptr = graphics->allocGraphicsMem(
+		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
+		verticesSize + indexCount * sizeof(uint16_t),
+		16,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		&uid,
+		"animation_system",
+		MEMORY_CATEGORY_GEOMETRY
+	);
+	memory = GpuBuffer(memory_ptr, uid);
+	vertices_ptr = (SkinnedVertex*)memory_ptr;
+	indices_ptr = (uint16_t*)((uint8_t*)memory_ptr + verticesSize);
+	memcpy(vertices_ptr, vertices, vertexCount * sizeof(SkinnedVertex));
+	memcpy(indices_ptr, indices, indexCount * sizeof(uint16_t));
+
+	vertexProgramID = graphics->patcherRegisterProgram(&skinned_v_gxp_start);
+	fragmentProgramID = graphics->patcherRegisterProgram(&color_f_gxp_start);
+
+	SceGxmVertexAttribute attributes[4];
+	attributes[0].streamIndex = 0;
+	attributes[0].offset = 0;
+	attributes[0].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	attributes[0].componentCount = 3;
+	attributes[1].streamIndex = 0;
+	attributes[1].offset = 12; //(x, y, z) * 4
+	attributes[1].format = SCE_GXM_ATTRIBUTE_FORMAT_U8;
+	attributes[1].componentCount = 4;
+	attributes[2].streamIndex = 0;
+	attributes[2].offset = 16;
+	attributes[2].format = SCE_GXM_ATTRIBUTE_FORMAT_U8N;
+	attributes[2].componentCount = 4;
+	attributes[3].streamIndex = 0;
+	attributes[3].offset = 20;
+	attributes[3].format = SCE_GXM_ATTRIBUTE_FORMAT_U8N;
+	attributes[3].componentCount = 4;
+	const char* const names[4] = { "aPosition", "aBoneIndices", "aBoneWeights", "aColor" };
+
+	SceGxmVertexStream stream;
+	stream.stride = sizeof(SkinnedVertex);
+	stream.indexSource = SCE_GXM_INDEX_SOURCE_INDEX_16BIT;
+	vertexProgram = graphics->patcherCreateVertexProgram(vertexProgramID, attributes, 4, &stream, names);
+	fragmentProgram = graphics->patcherCreateFragmentProgram(fragmentProgramID, vertexProgramID);
+
+	viewProjectionParam_ptr = sceGxmProgramFindParameterByName(&skinned_v_gxp_start, "viewProjection");
+	assert(viewProjectionParam_ptr && (sceGxmProgramParameterGetCategory(viewProjectionParam_ptr) == SCE_GXM_PARAMETER_CATEGORY_UNIFORM));
+	paletteParam_ptr = sceGxmProgramFindParameterByName(&skinned_v_gxp_start, "palette");
+	assert(paletteParam_ptr && (sceGxmProgramParameterGetCategory(paletteParam_ptr) == SCE_GXM_PARAMETER_CATEGORY_UNIFORM));
+
+	//a block of palette for every character, every frame
+	if (!paletteRing.init(&skinned_v_gxp_start, 0, maxCharacters, "animation_palettes"))
+	{
+		memory.reset();
+		free(_characters);
+		_characters = nullptr;
+		return false;
+	}
+	palettes_ptr = nullptr;
+	paletteCount = 0;
+	paletteFrame = 0;
+	memset(&stats, 0, sizeof(stats));
+	initialized = true;
+	return true;
+}
+
+void AnimationSystem::shutdown()
+{
+	if (!initialized)
+		return;
+	vitaPrintf("\nShutting down animation system\n");
+	logStats();
+
+	//queued behind the frames that may still draw with them, the programs before the GXPs they were patched from
+	Graphics* graphics = Graphics::getInstance();
+	fragmentProgram.reset();
+	vertexProgram.reset();
+	graphics->deferRelease(GPU_RESOURCE_REGISTERED_PROGRAM, fragmentProgramID);
+	graphics->deferRelease(GPU_RESOURCE_REGISTERED_PROGRAM, vertexProgramID);
+	fragmentProgramID = nullptr;
+	vertexProgramID = nullptr;
+	paletteRing.logStats();
+	paletteRing.shutdown();
+	memory.reset();
+	vertices_ptr = nullptr;
+	indices_ptr = nullptr;
+	palettes_ptr = nullptr;
+	paletteCount = 0;
+	free(_characters);
+	_characters = nullptr;
+	characterCount = 0;
+	initialized = false;
+}
+
+bool AnimationSystem::isInitialized()
+{
+	return initialized;
+}
+
+int AnimationSystem::addCharacter(const AnimationCharacter* character)
+{
+	if (!initialized || characterCount >= maxCharacters)
+		return -1;
+	//a clip with fewer bones would leave the rest of the pose unwritten
+	if (character->clip == nullptr || character->clip->getBoneCount() != skeleton.boneCount ||
+		(character->blendClip != nullptr && character->blendClip->getBoneCount() != skeleton.boneCount))
+	{
+		vitaPrintf("ERROR: a character's clips have to animate the %u bones of the skeleton\n", skeleton.boneCount);
+		return -1;
+	}
+	_characters[characterCount] = *character;
+	return (int)characterCount++;
+}
+
+AnimationCharacter* AnimationSystem::getCharacter(int index)
+{
+	if (index < 0 || (unsigned int)index >= characterCount)
+		return nullptr;
+	return &_characters[index];
+}
+
+unsigned int AnimationSystem::getCharacterCount()
+{
+	return characterCount;
+}
+
+void AnimationSystem::animateJob(void* userData, unsigned int job)
+{
+	AnimationSystem* system = (AnimationSystem*)userData;
+	unsigned int first = job * ANIMATION_JOB_SIZE;
+	unsigned int end = first + ANIMATION_JOB_SIZE;
+	if (end > system->paletteCount)
+		end = system->paletteCount;
+	system->animate(first, end);
+}
+
+void AnimationSystem::animate(unsigned int first, unsigned int end)
+{
+	SceSize blockSize = paletteRing.getBlockSize();
+	AnimationPose pose;
+	AnimationPose blendPose;
+	float palette[SKELETON_MAX_BONES * BONE_MATRIX_SIZE];
+	for (unsigned int i = first; i < end; i++)
+	{
+		const AnimationCharacter* character = &_characters[i];
+		character->clip->sample(character->time, &pose);
+		if (character->blendClip != nullptr && character->blendWeight > 0.0f)
+		{
+			character->blendClip->sample(character->time, &blendPose);
+			blendAnimationPoses(&pose, &blendPose, character->blendWeight, skeleton.boneCount, &pose);
+		}
+		buildSkinningPalette(&skeleton, &pose, character->transform, palette);
+		sceGxmSetUniformDataF(palettes_ptr + i * blockSize, paletteParam_ptr, 0, skeleton.boneCount * BONE_MATRIX_SIZE, palette);
+	}
+}
+
+void AnimationSystem::update(float dt)
+{
+	if (!initialized)
+		return;
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+
+	for (unsigned int i = 0; i < characterCount; i++)
+		_characters[i].time += dt * _characters[i].speed;
+
+	//the palettes taken earlier this frame are written again, the ring would run out otherwise
+	unsigned int frame = Graphics::getInstance()->getFrameIndex();
+	if (palettes_ptr == nullptr || frame != paletteFrame || paletteCount != characterCount)
+	{
+		palettes_ptr = (uint8_t*)paletteRing.allocate(characterCount);
+		paletteFrame = frame;
+		paletteCount = (palettes_ptr != nullptr) ? characterCount : 0;
+	}
+	stats.droppedLastFrame = characterCount - paletteCount;
+
+	SceUInt64 animateStart = sceKernelGetProcessTimeWide();
+	JobSystem::getInstance()->run(&AnimationSystem::animateJob, this, (paletteCount + ANIMATION_JOB_SIZE - 1) / ANIMATION_JOB_SIZE);
+	stats.animateTime = sceKernelGetProcessTimeWide() - animateStart;
+	stats.animateTimeTotal += stats.animateTime;
+	stats.charactersAnimated += paletteCount;
+	stats.updates++;
+
+	stats.characters = characterCount;
+	stats.updateTime = sceKernelGetProcessTimeWide() - start;
+}
+
+void AnimationSystem::draw(const float* viewProjection)
+{
+	//nothing was written for a frame update() didn't run in
+	Graphics* graphics = Graphics::getInstance();
+	if (!initialized || paletteCount == 0 || paletteFrame != graphics->getFrameIndex())
+		return;
+
+	graphics->patcherSetVertexProgram(vertexProgram.get());
+	graphics->patcherSetFragmentProgram(fragmentProgram.get());
+	graphics->patcherSetVertexProgramConstants(NULL, viewProjectionParam_ptr, 0, 16, viewProjection);
+	graphics->patcherSetVertexStream(0, vertices_ptr);
+	SceSize blockSize = paletteRing.getBlockSize();
+	for (unsigned int i = 0; i < paletteCount; i++)
+	{
+		paletteRing.bind(palettes_ptr + i * blockSize);
+		graphics->draw(SCE_GXM_PRIMITIVE_TRIANGLES, SCE_GXM_INDEX_FORMAT_U16, indices_ptr, indexCount);
+	}
+}
+
+const AnimationSystemStats* AnimationSystem::getStats()
+{
+	return &stats;
+}
+
+void AnimationSystem::logStats()
+{
+	vitaPrintf("\nAnimation system: %u of %u characters, %u bones each\n", stats.characters, maxCharacters, skeleton.boneCount);
+	vitaPrintf("\tLast frame: %u dropped, update %.3fms of which jobs %.3fms\n", stats.droppedLastFrame, stats.updateTime / 1000.0,
+		stats.animateTime / 1000.0);
+	if (stats.charactersAnimated > 0)
+		vitaPrintf("\tJobs: %.2fus a character over %u updates\n", (double)stats.animateTimeTotal / stats.charactersAnimated, stats.updates);
+}
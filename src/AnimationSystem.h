@@ -0,0 +1,113 @@
+#pragma once
+
+//----------------------------------------------
+// AnimationSystem Class
+// Skinned characters sharing a skeleton and a mesh. update() moves every character's clock on
+// the render thread, then splits sampling, blending and evaluating the hierarchy over the
+// JobSystem, a few characters to a job. Each job writes its characters' matrix palettes
+// straight into their blocks of the frame's UniformRing, so draw() only binds a block and
+// draws for each character, the vertices are skinned by skinned_vertex.cg.
+// The palette is the full SKELETON_MAX_BONES, the program reads whichever bones the mesh uses
+//-----------------------------------------------
+
+#include "Graphics.h"
+#include "UniformBuffer.h"
+#include "AnimationClip.h"
+
+#define ANIMATION_SYSTEM_MAX_CHARACTERS		64
+//Characters one job animates
+#define ANIMATION_JOB_SIZE					4
+
+//What skinned_vertex.cg reads
+typedef struct SkinnedVertex
+{
+	float x;
+	float y;
+	float z;
+	uint8_t bones[4];			//palette entries
+	uint8_t weights[4];			//adding up to 255
+	unsigned int color;			//RGBA8()
+} SkinnedVertex;
+
+typedef struct AnimationCharacter
+{
+	const AnimationClip* clip;
+	const AnimationClip* blendClip;		//mixed in by blendWeight, nullptr for none
+	float blendWeight;					//0 to 1
+	float time;							//seconds into the clips
+	float speed;						//1 plays the clips as they are
+	float transform[BONE_MATRIX_SIZE];	//3x4, where the skeleton's roots are placed in the world
+} AnimationCharacter;
+
+typedef struct AnimationSystemStats
+{
+	unsigned int characters;
+	unsigned int droppedLastFrame;		//characters without a palette block, they aren't drawn
+	SceUInt64 updateTime;				//microseconds the last update() took
+	SceUInt64 animateTime;				//of that, the jobs
+	SceUInt64 animateTimeTotal;			//over every update(), with updates for the average per character
+	unsigned int updates;
+	unsigned int charactersAnimated;
+} AnimationSystemStats;
+
+class AnimationSystem
+{
+public:
+	AnimationSystem();
+	~AnimationSystem();
+
+	//Graphics must be initialized. The skeleton is copied, the mesh copied into GPU memory. false if either is unusable
+	bool init(const Skeleton* skeleton, const SkinnedVertex* vertices, unsigned int vertexCount, const uint16_t* indices,
+		unsigned int indexCount, unsigned int maxCharacters = ANIMATION_SYSTEM_MAX_CHARACTERS);
+	//Hands the mesh, the palettes and the programs to Graphics' release queue, frames already submitted can still draw with them
+	void shutdown();
+	bool isInitialized();
+
+	//The index of the character's copy, -1 once there are maxCharacters
+	int addCharacter(const AnimationCharacter* character);
+	//Change it freely between updates, nullptr for an index addCharacter() never returned
+	AnimationCharacter* getCharacter(int index);
+	unsigned int getCharacterCount();
+
+	//Moves every character's clock on by dt seconds and writes this frame's palettes. Once a frame before draw(),
+	//another update() in the same frame writes the same blocks again
+	void update(float dt);
+	//Between Graphics::startScene() and endScene(), every character update() wrote this frame.
+	//viewProjection is 16 floats, row major for row vectors like the other vertex programs
+	void draw(const float* viewProjection);
+
+	const AnimationSystemStats* getStats();
+	void logStats();
+
+private:
+	static void animateJob(void* userData, unsigned int job);
+	//Samples, blends and writes the palettes of characters first to end - 1
+	void animate(unsigned int first, unsigned int end);
+
+	AnimationSystemStats stats;
+	bool initialized;
+	Skeleton skeleton;
+
+	AnimationCharacter* _characters;
+	unsigned int characterCount;
+	unsigned int maxCharacters;
+
+	//vertices then indices in one memblock
+	GpuBuffer memory;
+	SkinnedVertex* vertices_ptr;
+	uint16_t* indices_ptr;
+	unsigned int indexCount;
+
+	//the palettes, uniform buffer 0 of the vertex program. This frame's are paletteCount blocks from palettes_ptr
+	UniformRing paletteRing;
+	const SceGxmProgramParameter* paletteParam_ptr;
+	uint8_t* palettes_ptr;
+	unsigned int paletteCount;
+	unsigned int paletteFrame;
+
+	SceGxmShaderPatcherId vertexProgramID;
+	SceGxmShaderPatcherId fragmentProgramID;
+	GpuVertexProgram vertexProgram;
+	GpuFragmentProgram fragmentProgram;
+	const SceGxmProgramParameter* viewProjectionParam_ptr;
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+//----------------------------------------------
+// Graphics command capture file format (.gcap)
+// Written by the CommandCapture inside Graphics, read back by the CaptureReplay. Holds
+// everything needed to submit the captured frames again without the code that made them:
+// the shader programs and how they were patched, every state change, uniform write and draw,
+// and the vertex, index and texture data those read. Everything is little endian like the Vita.
+//
+// Layout, every offset is from the start of the file:
+//	CaptureHeader
+//	CaptureProgram[programCount]
+//	CaptureVertexProgram[vertexProgramCount]
+//	CaptureFragmentProgram[fragmentProgramCount]
+//	CaptureParameter[parameterCount]
+//	CaptureBlob[blobCount]
+//	the command stream, commandSize bytes
+//	padding to CAPTURE_BLOB_ALIGNMENT
+//	blob data, blobDataSize bytes
+//
+// Blobs are the captured memory: program binaries, vertex, index and uniform buffers, texture levels.
+// Identical contents are stored once, so a buffer drawn every frame costs one blob until it changes.
+// The blob data is loaded into one GPU mapped block and used in place
+//
+// Commands start with a CaptureCommand and are a multiple of 4 bytes, size includes the
+// CaptureCommand. Indices into the tables are CAPTURE_NONE when there is nothing to refer to
+//-----------------------------------------------
+
+#include <stdint.h>
+
+#define CAPTURE_MAGIC				0x31504347	//"GCP1"
+//Version 2 added CAPTURE_CMD_SET_VERTEX_UNIFORM_BUFFER, version 1 files are still read
+#define CAPTURE_VERSION				2
+#define CAPTURE_BLOB_ALIGNMENT		16
+#define CAPTURE_NAME_LENGTH			32
+#define CAPTURE_MAX_ATTRIBUTES		16
+#define CAPTURE_NONE				0xFFFFFFFF
+
+typedef struct CaptureHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t frameCount;
+	uint16_t displayWidth;		//of the capturing configuration, for reference
+	uint16_t displayHeight;
+	uint32_t programCount;
+	uint32_t vertexProgramCount;
+	uint32_t fragmentProgramCount;
+	uint32_t parameterCount;
+	uint32_t blobCount;
+	uint32_t commandOffset;
+	uint32_t commandSize;
+	uint32_t blobDataOffset;
+	uint32_t blobDataSize;
+} CaptureHeader;
+
+//A program registered with the shader patcher
+typedef struct CaptureProgram
+{
+	uint32_t blob;				//the program binary, CAPTURE_NONE if it was unregistered before the capture started
+} CaptureProgram;
+
+typedef struct CaptureAttribute
+{
+	uint16_t streamIndex;
+	uint16_t offset;
+	uint8_t format;				//SceGxmAttributeFormat
+	uint8_t componentCount;
+	uint16_t reserved;
+	char name[CAPTURE_NAME_LENGTH];	//the shader input, its register is looked up again on replay
+} CaptureAttribute;
+
+//A vertex program made by the patcher, one vertex stream like Graphics supports
+typedef struct CaptureVertexProgram
+{
+	uint32_t program;			//CaptureProgram index
+	uint32_t attributeCount;
+	uint16_t stride;
+	uint16_t indexSource;		//SceGxmIndexSource
+	CaptureAttribute _attributes[CAPTURE_MAX_ATTRIBUTES];
+} CaptureVertexProgram;
+
+typedef struct CaptureFragmentProgram
+{
+	uint32_t program;			//CaptureProgram index
+	uint32_t vertexProgram;		//CaptureProgram index of the vertex program it was made for, or CAPTURE_NONE
+	uint8_t blendEnabled;		//0 when no SceGxmBlendInfo was given
+	uint8_t colorMask;
+	uint8_t colorFunc;
+	uint8_t alphaFunc;
+	uint8_t colorSrc;
+	uint8_t colorDst;
+	uint8_t alphaSrc;
+	uint8_t alphaDst;
+} CaptureFragmentProgram;
+
+//A uniform parameter, found by name in its program again on replay
+typedef struct CaptureParameter
+{
+	uint32_t program;			//CaptureProgram index
+	char name[CAPTURE_NAME_LENGTH];
+} CaptureParameter;
+
+typedef struct CaptureBlob
+{
+	uint32_t offset;			//from blobDataOffset, a multiple of CAPTURE_BLOB_ALIGNMENT
+	uint32_t size;
+} CaptureBlob;
+
+/*----- Commands -----*/
+
+typedef enum CaptureCommandType
+{
+	CAPTURE_CMD_BEGIN_SCENE = 1,
+	CAPTURE_CMD_END_SCENE,
+	CAPTURE_CMD_CLEAR,
+	CAPTURE_CMD_SET_VERTEX_PROGRAM,
+	CAPTURE_CMD_SET_FRAGMENT_PROGRAM,
+	CAPTURE_CMD_SET_VERTEX_STREAM,
+	CAPTURE_CMD_VERTEX_UNIFORM,
+	CAPTURE_CMD_FRAGMENT_UNIFORM,
+	CAPTURE_CMD_SET_FRAGMENT_TEXTURE,
+	CAPTURE_CMD_DRAW,
+	CAPTURE_CMD_END_FRAME,
+	CAPTURE_CMD_SET_VERTEX_UNIFORM_BUFFER
+} CaptureCommandType;
+
+typedef struct CaptureCommand
+{
+	uint16_t type;				//CaptureCommandType
+	uint16_t size;
+} CaptureCommand;
+
+//A scene into the back buffer (Graphics::startScene) or, when offscreen, into a width x height target
+typedef struct CaptureBeginScene
+{
+	CaptureCommand command;
+	uint32_t offscreen;
+	uint16_t width;
+	uint16_t height;
+} CaptureBeginScene;
+
+typedef struct CaptureEndScene
+{
+	CaptureCommand command;
+	uint32_t offscreen;
+} CaptureEndScene;
+
+//Graphics::clearScreen()
+typedef struct CaptureClear
+{
+	CaptureCommand command;
+	uint32_t color;
+} CaptureClear;
+
+//Vertex or fragment program, depending on the command
+typedef struct CaptureSetProgram
+{
+	CaptureCommand command;
+	uint32_t index;				//CaptureVertexProgram or CaptureFragmentProgram index
+} CaptureSetProgram;
+
+//The vertices a draw read, from the start of the stream up to the highest index
+typedef struct CaptureSetVertexStream
+{
+	CaptureCommand command;
+	uint32_t streamIndex;
+	uint32_t blob;
+} CaptureSetVertexStream;
+
+//A write into the vertex or fragment default uniform buffer, followed by count floats
+typedef struct CaptureUniform
+{
+	CaptureCommand command;
+	uint32_t parameter;			//CaptureParameter index
+	uint16_t componentOffset;
+	uint16_t componentCount;
+} CaptureUniform;
+
+//A vertex uniform buffer as a draw read it, as much of it as the vertex program's uniforms cover
+typedef struct CaptureSetUniformBuffer
+{
+	CaptureCommand command;
+	uint32_t bufferIndex;
+	uint32_t blob;
+} CaptureSetUniformBuffer;
+
+//The texture as it was when it was bound, every mip level in one blob
+typedef struct CaptureSetTexture
+{
+	CaptureCommand command;
+	uint32_t unit;
+	uint32_t format;			//SceGxmTextureFormat
+	uint32_t type;				//SceGxmTextureType
+	uint16_t width;
+	uint16_t height;
+	uint8_t mipCount;
+	uint8_t minFilter;
+	uint8_t magFilter;
+	uint8_t mipFilter;			//0 or 1
+	uint8_t uAddrMode;
+	uint8_t vAddrMode;
+	uint8_t lodBias;
+	uint8_t reserved;
+	uint32_t blob;
+} CaptureSetTexture;
+
+typedef struct CaptureDraw
+{
+	CaptureCommand command;
+	uint32_t primitive;			//SceGxmPrimitiveType
+	uint32_t indexFormat;		//SceGxmIndexFormat
+	uint32_t indexCount;
+	uint32_t indexBlob;
+} CaptureDraw;
@@ -0,0 +1,646 @@
+#include "CaptureReplay.h"
+#include "Graphics.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <assert.h>
+
+#include <psp2/kernel/processmgr.h>
+
+CaptureReplay::CaptureReplay()
+{
+	loaded = false;
+	memset(&header, 0, sizeof(header));
+	blobData_ptr = nullptr;
+	surfaceMemory_ptr = nullptr;
+}
+
+CaptureReplay::~CaptureReplay()
+{
+	unload();
+}
+
+bool CaptureReplay::load(const char* path)
+{
+	vitaPrintf("\nLoading capture: %s\n", path);
+	unload();
+	SceUInt64 startTime = sceKernelGetProcessTimeWide();
+
+	SceUID fd = sceIoOpen(path, SCE_O_RDONLY, 0);
+	if (fd < 0)
+	{
+		vitaPrintf("sceIoOpen() result: 0x%08X\n", fd);
+		return false;
+	}
+	SceSize fileSize = (SceSize)sceIoLseek(fd, 0, SCE_SEEK_END);
+	sceIoLseek(fd, 0, SCE_SEEK_SET);
+
+	if (!readFully(fd, &header, sizeof(header)) || !validate(fileSize))
+	{
+		sceIoClose(fd);
+		return false;
+	}
+
+	//the tables and commands follow the header back to back
+	_programs.resize(header.programCount);
+	_vertexProgramEntries.resize(header.vertexProgramCount);
+	_fragmentProgramEntries.resize(header.fragmentProgramCount);
+	_parameterEntries.resize(header.parameterCount);
+	_blobs.resize(header.blobCount);
+	_commands.resize(header.commandSize);
+	bool read = (_programs.empty() || readFully(fd, &_programs[0], header.programCount * sizeof(CaptureProgram))) &&
+		(_vertexProgramEntries.empty() || readFully(fd, &_vertexProgramEntries[0], header.vertexProgramCount * sizeof(CaptureVertexProgram))) &&
+		(_fragmentProgramEntries.empty() || readFully(fd, &_fragmentProgramEntries[0], header.fragmentProgramCount * sizeof(CaptureFragmentProgram))) &&
+		(_parameterEntries.empty() || readFully(fd, &_parameterEntries[0], header.parameterCount * sizeof(CaptureParameter))) &&
+		(_blobs.empty() || readFully(fd, &_blobs[0], header.blobCount * sizeof(CaptureBlob))) &&
+		(_commands.empty() || readFully(fd, &_commands[0], header.commandSize));
+	if (!read)
+	{
+		vitaPrintf("ERROR: could not read the capture tables\n");
+		sceIoClose(fd);
+		unload();
+		return false;
+	}
+
+	std::vector<bool> usedPrograms, usedVertexPrograms, usedFragmentPrograms;
+	if (!validateCommands(&usedPrograms, &usedVertexPrograms, &usedFragmentPrograms))
+	{
+		sceIoClose(fd);
+		unload();
+		return false;
+	}
+
+	//every blob goes into GPU memory untouched, vertices, indices and textures are used where they land
+	if (header.blobDataSize > 0)
+	{
+		SceUID blobDataUID = -1;
+		blobData_ptr = (uint8_t*)Graphics::getInstance()->allocGraphicsMem(
+			SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
+			header.blobDataSize,
+			CAPTURE_BLOB_ALIGNMENT,
+			SCE_GXM_MEMORY_ATTRIB_READ,
+			&blobDataUID,
+			"capture_replay",
+			MEMORY_CATEGORY_OTHER
+		);
+		blobData = GpuBuffer(blobData_ptr, blobDataUID);
+		sceIoLseek(fd, header.blobDataOffset, SCE_SEEK_SET);
+		if (!readFully(fd, blobData_ptr, header.blobDataSize))
+		{
+			vitaPrintf("ERROR: could not read the capture blob data\n");
+			sceIoClose(fd);
+			unload();
+			return false;
+		}
+	}
+	sceIoClose(fd);
+	loaded = true;
+
+	if (!createPrograms(&usedPrograms, &usedVertexPrograms, &usedFragmentPrograms) || !createTextures())
+	{
+		unload();
+		return false;
+	}
+	createTargets();
+
+	SceUInt64 loadTime = sceKernelGetProcessTimeWide() - startTime;
+	vitaPrintf("Loaded %u frames, %u command bytes, %u blobs, %u bytes of data, %u textures, %u offscreen targets in %.2fms\n",
+		header.frameCount, header.commandSize, header.blobCount, header.blobDataSize, (unsigned int)_textures.size(),
+		(unsigned int)_targets.size(), loadTime / 1000.0);
+	return true;
+}
+
+void CaptureReplay::unload()
+{
+	//the last replayed frames may still be on the GPU, the handles queue everything for the release queue to free
+	//once it is done with them. Programs made from a registered program have to go before it, the queue keeps the order
+	Graphics* graphics = Graphics::getInstance();
+	_vertexPrograms.clear();
+	_fragmentPrograms.clear();
+	for (size_t i = 0; i < _programIDs.size(); i++)
+		if (_programIDs[i] != nullptr)
+			graphics->deferRelease(GPU_RESOURCE_REGISTERED_PROGRAM, _programIDs[i]);
+
+	_targets.clear();
+	surfaceMemory.reset();
+	blobData.reset();
+	surfaceMemory_ptr = nullptr;
+	blobData_ptr = nullptr;
+
+	_programs.clear();
+	_vertexProgramEntries.clear();
+	_fragmentProgramEntries.clear();
+	_parameterEntries.clear();
+	_blobs.clear();
+	_commands.clear();
+	_programIDs.clear();
+	_parameters.clear();
+	_textures.clear();
+	memset(&header, 0, sizeof(header));
+	loaded = false;
+}
+
+bool CaptureReplay::isLoaded()
+{
+	return loaded;
+}
+
+unsigned int CaptureReplay::getFrameCount()
+{
+	return header.frameCount;
+}
+
+/*----- Replay -----*/
+
+void CaptureReplay::replay(unsigned int loops, CaptureReplayStats* stats)
+{
+	CaptureReplayStats replayStats;
+	memset(&replayStats, 0, sizeof(replayStats));
+	if (!loaded)
+	{
+		vitaPrintf("ERROR: no capture loaded to replay\n");
+		if (stats != nullptr)
+			*stats = replayStats;
+		return;
+	}
+
+	Graphics* graphics = Graphics::getInstance();
+	const uint8_t* commandsEnd = &_commands[0] + _commands.size();
+	for (unsigned int loop = 0; loop < loops; loop++)
+	{
+		const uint8_t* position = &_commands[0];
+		unsigned int textureIndex = 0;
+
+		while (position < commandsEnd)
+		{
+			SceUInt64 frameStart = sceKernelGetProcessTimeWide();
+			bool frameEnded = false;
+			while (!frameEnded)
+			{
+				const CaptureCommand* command = (const CaptureCommand*)position;
+				position += command->size;
+
+				switch (command->type)
+				{
+				case CAPTURE_CMD_BEGIN_SCENE:
+				{
+					const CaptureBeginScene* scene = (const CaptureBeginScene*)command;
+					if (scene->offscreen)
+					{
+						ReplayTarget* target = findTarget(scene->width, scene->height);
+						graphics->beginOffscreenScene(target->renderTarget.get(), &target->colorSurface, NULL, scene->width, scene->height);
+					}
+					else
+					{
+						graphics->startScene();
+					}
+					break;
+				}
+				case CAPTURE_CMD_END_SCENE:
+					if (((const CaptureEndScene*)command)->offscreen)
+						graphics->endOffscreenScene();
+					else
+						graphics->endScene();
+					break;
+				case CAPTURE_CMD_CLEAR:
+					graphics->clearScreen(((const CaptureClear*)command)->color);
+					break;
+				case CAPTURE_CMD_SET_VERTEX_PROGRAM:
+				{
+					uint32_t index = ((const CaptureSetProgram*)command)->index;
+					if (index != CAPTURE_NONE && _vertexPrograms[index].isValid())
+						graphics->patcherSetVertexProgram(_vertexPrograms[index].get());
+					break;
+				}
+				case CAPTURE_CMD_SET_FRAGMENT_PROGRAM:
+				{
+					uint32_t index = ((const CaptureSetProgram*)command)->index;
+					if (index != CAPTURE_NONE && _fragmentPrograms[index].isValid())
+						graphics->patcherSetFragmentProgram(_fragmentPrograms[index].get());
+					break;
+				}
+				case CAPTURE_CMD_SET_VERTEX_STREAM:
+				{
+					const CaptureSetVertexStream* stream = (const CaptureSetVertexStream*)command;
+					graphics->patcherSetVertexStream(stream->streamIndex, getBlob(stream->blob));
+					break;
+				}
+				case CAPTURE_CMD_SET_VERTEX_UNIFORM_BUFFER:
+				{
+					const CaptureSetUniformBuffer* buffer = (const CaptureSetUniformBuffer*)command;
+					graphics->patcherSetVertexUniformBuffer(buffer->bufferIndex, getBlob(buffer->blob));
+					break;
+				}
+				case CAPTURE_CMD_VERTEX_UNIFORM:
+				case CAPTURE_CMD_FRAGMENT_UNIFORM:
+				{
+					const CaptureUniform* uniform = (const CaptureUniform*)command;
+					const SceGxmProgramParameter* parameter = _parameters[uniform->parameter];
+					if (parameter == nullptr)
+						break;
+					if (command->type == CAPTURE_CMD_VERTEX_UNIFORM)
+						graphics->patcherSetVertexProgramConstants(NULL, parameter, uniform->componentOffset, uniform->componentCount, (const float*)(uniform + 1));
+					else
+						graphics->patcherSetFragmentProgramConstants(parameter, uniform->componentOffset, uniform->componentCount, (const float*)(uniform + 1));
+					break;
+				}
+				case CAPTURE_CMD_SET_FRAGMENT_TEXTURE:
+					graphics->setFragmentTexture(((const CaptureSetTexture*)command)->unit, &_textures[textureIndex++]);
+					break;
+				case CAPTURE_CMD_DRAW:
+				{
+					const CaptureDraw* draw = (const CaptureDraw*)command;
+					graphics->draw((SceGxmPrimitiveType)draw->primitive, (SceGxmIndexFormat)draw->indexFormat, getBlob(draw->indexBlob), draw->indexCount);
+					replayStats.draws++;
+					break;
+				}
+				case CAPTURE_CMD_END_FRAME:
+					frameEnded = true;
+					break;
+				}
+			}
+
+			//the swap can wait on the display, it isn't part of what the frame costs to submit
+			SceUInt64 frameTime = sceKernelGetProcessTimeWide() - frameStart;
+			replayStats.frames++;
+			replayStats.frameTimeTotal += frameTime;
+			if (replayStats.frameTimeMin == 0 || frameTime < replayStats.frameTimeMin)
+				replayStats.frameTimeMin = frameTime;
+			if (frameTime > replayStats.frameTimeMax)
+				replayStats.frameTimeMax = frameTime;
+			graphics->swapBuffers();
+		}
+	}
+	if (stats != nullptr)
+		*stats = replayStats;
+}
+
+void CaptureReplay::logStats(const CaptureReplayStats* stats)
+{
+	vitaPrintf("\nCapture replay: %u frames, %u draws\n", stats->frames, stats->draws);
+	if (stats->frames == 0)
+		return;
+	vitaPrintf("\tSubmission time per frame: %.3fms average, %.3fms min, %.3fms max\n",
+		(stats->frameTimeTotal / (double)stats->frames) / 1000.0, stats->frameTimeMin / 1000.0, stats->frameTimeMax / 1000.0);
+	vitaPrintf("\tTotal: %.2fms, %.2fus per draw\n", stats->frameTimeTotal / 1000.0,
+		(stats->draws > 0) ? (double)stats->frameTimeTotal / stats->draws : 0.0);
+}
+
+/*----- Loading -----*/
+
+bool CaptureReplay::validate(SceSize fileSize)
+{
+	if (header.magic != CAPTURE_MAGIC || header.version == 0 || header.version > CAPTURE_VERSION)
+	{
+		vitaPrintf("ERROR: not a version 1 to %u capture file (magic 0x%08X, version %u)\n", CAPTURE_VERSION, header.magic, header.version);
+		return false;
+	}
+
+	//the tables sit between the header and the commands, the blob data comes last
+	SceSize tablesEnd = sizeof(CaptureHeader) + header.programCount * sizeof(CaptureProgram) +
+		header.vertexProgramCount * sizeof(CaptureVertexProgram) + header.fragmentProgramCount * sizeof(CaptureFragmentProgram) +
+		header.parameterCount * sizeof(CaptureParameter) + header.blobCount * sizeof(CaptureBlob);
+	if (header.frameCount == 0 || header.commandOffset != tablesEnd ||
+		header.blobDataOffset % CAPTURE_BLOB_ALIGNMENT != 0 || header.blobDataOffset < header.commandOffset + header.commandSize ||
+		header.blobDataOffset + header.blobDataSize > fileSize)
+	{
+		vitaPrintf("ERROR: capture of %u frames is malformed, file is %u bytes\n", header.frameCount, fileSize);
+		return false;
+	}
+	return true;
+}
+
+bool CaptureReplay::validateCommands(std::vector<bool>* usedPrograms, std::vector<bool>* usedVertexPrograms, std::vector<bool>* usedFragmentPrograms)
+{
+	for (size_t i = 0; i < _blobs.size(); i++)
+	{
+		if (_blobs[i].offset % CAPTURE_BLOB_ALIGNMENT != 0 || _blobs[i].offset + _blobs[i].size > header.blobDataSize)
+		{
+			vitaPrintf("ERROR: capture blob %u is outside the blob data\n", (unsigned int)i);
+			return false;
+		}
+	}
+
+	usedPrograms->assign(header.programCount, false);
+	usedVertexPrograms->assign(header.vertexProgramCount, false);
+	usedFragmentPrograms->assign(header.fragmentProgramCount, false);
+
+	//a program only has to exist if something set on replay needs it
+	unsigned int frames = 0;
+	size_t offset = 0;
+	while (offset < _commands.size())
+	{
+		const CaptureCommand* command = (const CaptureCommand*)&_commands[offset];
+		bool valid = (offset + sizeof(CaptureCommand) <= _commands.size()) && command->size >= sizeof(CaptureCommand) &&
+			command->size % 4 == 0 && offset + command->size <= _commands.size();
+		SceSize expectedSize = 0;
+		uint32_t blob = CAPTURE_NONE;
+		if (valid)
+		{
+			switch (command->type)
+			{
+			case CAPTURE_CMD_BEGIN_SCENE:
+				expectedSize = sizeof(CaptureBeginScene);
+				break;
+			case CAPTURE_CMD_END_SCENE:
+				expectedSize = sizeof(CaptureEndScene);
+				break;
+			case CAPTURE_CMD_CLEAR:
+				expectedSize = sizeof(CaptureClear);
+				break;
+			case CAPTURE_CMD_SET_VERTEX_PROGRAM:
+			{
+				expectedSize = sizeof(CaptureSetProgram);
+				uint32_t index = ((const CaptureSetProgram*)command)->index;
+				if (index == CAPTURE_NONE)
+					break;
+				valid = index < header.vertexProgramCount && _vertexProgramEntries[index].program < header.programCount &&
+					_vertexProgramEntries[index].attributeCount <= CAPTURE_MAX_ATTRIBUTES;
+				if (valid)
+				{
+					(*usedVertexPrograms)[index] = true;
+					(*usedPrograms)[_vertexProgramEntries[index].program] = true;
+				}
+				break;
+			}
+			case CAPTURE_CMD_SET_FRAGMENT_PROGRAM:
+			{
+				expectedSize = sizeof(CaptureSetProgram);
+				uint32_t index = ((const CaptureSetProgram*)command)->index;
+				if (index == CAPTURE_NONE)
+					break;
+				valid = index < header.fragmentProgramCount && _fragmentProgramEntries[index].program < header.programCount &&
+					(_fragmentProgramEntries[index].vertexProgram == CAPTURE_NONE || _fragmentProgramEntries[index].vertexProgram < header.programCount);
+				if (valid)
+				{
+					(*usedFragmentPrograms)[index] = true;
+					(*usedPrograms)[_fragmentProgramEntries[index].program] = true;
+					if (_fragmentProgramEntries[index].vertexProgram != CAPTURE_NONE)
+						(*usedPrograms)[_fragmentProgramEntries[index].vertexProgram] = true;
+				}
+				break;
+			}
+			case CAPTURE_CMD_SET_VERTEX_STREAM:
+				expectedSize = sizeof(CaptureSetVertexStream);
+				blob = ((const CaptureSetVertexStream*)command)->blob;
+				valid = ((const CaptureSetVertexStream*)command)->streamIndex < SCE_GXM_MAX_VERTEX_STREAMS && blob < header.blobCount;
+				break;
+			case CAPTURE_CMD_SET_VERTEX_UNIFORM_BUFFER:
+				expectedSize = sizeof(CaptureSetUniformBuffer);
+				blob = ((const CaptureSetUniformBuffer*)command)->blob;
+				valid = ((const CaptureSetUniformBuffer*)command)->bufferIndex < SCE_GXM_MAX_UNIFORM_BUFFERS && blob < header.blobCount;
+				break;
+			case CAPTURE_CMD_VERTEX_UNIFORM:
+			case CAPTURE_CMD_FRAGMENT_UNIFORM:
+			{
+				const CaptureUniform* uniform = (const CaptureUniform*)command;
+				expectedSize = sizeof(CaptureUniform) + uniform->componentCount * sizeof(float);
+				valid = uniform->parameter < header.parameterCount && _parameterEntries[uniform->parameter].program < header.programCount;
+				if (valid)
+					(*usedPrograms)[_parameterEntries[uniform->parameter].program] = true;
+				break;
+			}
+			case CAPTURE_CMD_SET_FRAGMENT_TEXTURE:
+				expectedSize = sizeof(CaptureSetTexture);
+				blob = ((const CaptureSetTexture*)command)->blob;
+				valid = ((const CaptureSetTexture*)command)->unit < SCE_GXM_MAX_TEXTURE_UNITS && blob < header.blobCount;
+				break;
+			case CAPTURE_CMD_DRAW:
+			{
+				const CaptureDraw* draw = (const CaptureDraw*)command;
+				expectedSize = sizeof(CaptureDraw);
+				blob = draw->indexBlob;
+				valid = blob < header.blobCount &&
+					draw->indexCount * ((draw->indexFormat == SCE_GXM_INDEX_FORMAT_U16) ? sizeof(uint16_t) : sizeof(uint32_t)) <= _blobs[blob].size;
+				break;
+			}
+			case CAPTURE_CMD_END_FRAME:
+				expectedSize = sizeof(CaptureCommand);
+				frames++;
+				break;
+			default:
+				valid = false;
+				break;
+			}
+		}
+		if (!valid || command->size != expectedSize || (blob != CAPTURE_NONE && blob >= header.blobCount))
+		{
+			vitaPrintf("ERROR: capture command at offset %u is malformed\n", (unsigned int)offset);
+			return false;
+		}
+		offset += command->size;
+	}
+
+	//replay() runs frame by frame, the stream has to end on one
+	if (frames != header.frameCount || _commands.size() < sizeof(CaptureCommand) ||
+		((const CaptureCommand*)&_commands[_commands.size() - sizeof(CaptureCommand)])->type != CAPTURE_CMD_END_FRAME)
+	{
+		vitaPrintf("ERROR: capture has %u frames in its commands, the header says %u\n", frames, header.frameCount);
+		return false;
+	}
+	return true;
+}
+
+bool CaptureReplay::createPrograms(const std::vector<bool>* usedPrograms, const std::vector<bool>* usedVertexPrograms,
+	const std::vector<bool>* usedFragmentPrograms)
+{
+	Graphics* graphics = Graphics::getInstance();
+
+	_programIDs.assign(header.programCount, nullptr);
+	for (unsigned int i = 0; i < header.programCount; i++)
+	{
+		if (!(*usedPrograms)[i])
+			continue;
+		if (_programs[i].blob >= header.blobCount)
+		{
+			vitaPrintf("ERROR: capture program %u is used but wasn't captured\n", i);
+			return false;
+		}
+		//the binaries are whatever the capturing platform ran, a Vita capture can't replay on the host or the other way round
+		const SceGxmProgram* program = (const SceGxmProgram*)getBlob(_programs[i].blob);
+		if (_blobs[_programs[i].blob].size < sizeof(uint32_t) || sceGxmProgramCheck(program) != 0)
+		{
+			vitaPrintf("ERROR: capture program %u isn't a program for this platform, captures only replay where they were recorded\n", i);
+			return false;
+		}
+		_programIDs[i] = graphics->patcherRegisterProgram(program);
+	}
+
+	_vertexPrograms.clear();
+	_vertexPrograms.resize(header.vertexProgramCount);
+	for (unsigned int i = 0; i < header.vertexProgramCount; i++)
+	{
+		if (!(*usedVertexPrograms)[i])
+			continue;
+		const CaptureVertexProgram* entry = &_vertexProgramEntries[i];
+		SceGxmVertexAttribute attributes[CAPTURE_MAX_ATTRIBUTES];
+		const char* names[CAPTURE_MAX_ATTRIBUTES];
+		for (unsigned int a = 0; a < entry->attributeCount; a++)
+		{
+			attributes[a].streamIndex = entry->_attributes[a].streamIndex;
+			attributes[a].offset = entry->_attributes[a].offset;
+			attributes[a].format = entry->_attributes[a].format;
+			attributes[a].componentCount = entry->_attributes[a].componentCount;
+			attributes[a].regIndex = 0;
+			names[a] = entry->_attributes[a].name;
+		}
+		SceGxmVertexStream stream;
+		stream.stride = entry->stride;
+		stream.indexSource = entry->indexSource;
+		_vertexPrograms[i] = graphics->patcherCreateVertexProgram(_programIDs[entry->program], attributes, entry->attributeCount, &stream, names);
+	}
+
+	_fragmentPrograms.clear();
+	_fragmentPrograms.resize(header.fragmentProgramCount);
+	for (unsigned int i = 0; i < header.fragmentProgramCount; i++)
+	{
+		if (!(*usedFragmentPrograms)[i])
+			continue;
+		const CaptureFragmentProgram* entry = &_fragmentProgramEntries[i];
+		if (entry->vertexProgram == CAPTURE_NONE)
+		{
+			vitaPrintf("ERROR: capture fragment program %u has no vertex program to be made for, it isn't replayed\n", i);
+			continue;
+		}
+		SceGxmBlendInfo blendInfo;
+		memset(&blendInfo, 0, sizeof(blendInfo));
+		blendInfo.colorMask = entry->colorMask;
+		blendInfo.colorFunc = entry->colorFunc;
+		blendInfo.alphaFunc = entry->alphaFunc;
+		blendInfo.colorSrc = entry->colorSrc;
+		blendInfo.colorDst = entry->colorDst;
+		blendInfo.alphaSrc = entry->alphaSrc;
+		blendInfo.alphaDst = entry->alphaDst;
+		_fragmentPrograms[i] = graphics->patcherCreateFragmentProgram(_programIDs[entry->program], _programIDs[entry->vertexProgram],
+			entry->blendEnabled ? &blendInfo : NULL);
+	}
+
+	//parameters are looked up by name, their addresses belong to the binaries loaded above
+	_parameters.assign(header.parameterCount, nullptr);
+	for (unsigned int i = 0; i < header.parameterCount; i++)
+	{
+		const CaptureParameter* entry = &_parameterEntries[i];
+		if (entry->program >= header.programCount || _programIDs[entry->program] == nullptr)
+			continue;
+		char name[CAPTURE_NAME_LENGTH];
+		memcpy(name, entry->name, CAPTURE_NAME_LENGTH);
+		name[CAPTURE_NAME_LENGTH - 1] = '\0';
+		_parameters[i] = sceGxmProgramFindParameterByName((const SceGxmProgram*)getBlob(_programs[entry->program].blob), name);
+		if (_parameters[i] == nullptr)
+			vitaPrintf("ERROR: capture program %u has no parameter %s, its writes aren't replayed\n", entry->program, name);
+	}
+	return true;
+}
+
+bool CaptureReplay::createTextures()
+{
+	_textures.clear();
+	for (size_t offset = 0; offset < _commands.size(); offset += ((const CaptureCommand*)&_commands[offset])->size)
+	{
+		const CaptureSetTexture* command = (const CaptureSetTexture*)&_commands[offset];
+		if (command->command.type != CAPTURE_CMD_SET_FRAGMENT_TEXTURE)
+			continue;
+
+		SceGxmTexture texture;
+		int error = 0;
+		if (command->type == SCE_GXM_TEXTURE_LINEAR)
+			error = sceGxmTextureInitLinear(&texture, getBlob(command->blob), (SceGxmTextureFormat)command->format, command->width, command->height, command->mipCount);
+		else if (command->type == SCE_GXM_TEXTURE_SWIZZLED)
+			error = sceGxmTextureInitSwizzled(&texture, getBlob(command->blob), (SceGxmTextureFormat)command->format, command->width, command->height, command->mipCount);
+		else
+			error = SCE_GXM_ERROR_INVALID_VALUE;
+		if (error != 0)
+		{
+			vitaPrintf("sceGxmTextureInit() result: 0x%08X (type 0x%08X, format 0x%08X, %ux%u)\n", error, command->type, command->format,
+				command->width, command->height);
+			return false;
+		}
+		sceGxmTextureSetMinFilter(&texture, (SceGxmTextureFilter)command->minFilter);
+		sceGxmTextureSetMagFilter(&texture, (SceGxmTextureFilter)command->magFilter);
+		sceGxmTextureSetMipFilter(&texture, command->mipFilter ? SCE_GXM_TEXTURE_MIP_FILTER_ENABLED : SCE_GXM_TEXTURE_MIP_FILTER_DISABLED);
+		sceGxmTextureSetUAddrMode(&texture, (SceGxmTextureAddrMode)command->uAddrMode);
+		sceGxmTextureSetVAddrMode(&texture, (SceGxmTextureAddrMode)command->vAddrMode);
+		sceGxmTextureSetLodBias(&texture, command->lodBias);
+		_textures.push_back(texture);
+	}
+	return true;
+}
+
+void CaptureReplay::createTargets()
+{
+	//one target per offscreen size, for as many of its scenes as the busiest frame has
+	std::vector<unsigned int> frameScenes;
+	for (size_t offset = 0; offset < _commands.size(); offset += ((const CaptureCommand*)&_commands[offset])->size)
+	{
+		const CaptureCommand* command = (const CaptureCommand*)&_commands[offset];
+		if (command->type == CAPTURE_CMD_END_FRAME)
+		{
+			frameScenes.assign(_targets.size(), 0);
+			continue;
+		}
+		const CaptureBeginScene* scene = (const CaptureBeginScene*)command;
+		if (command->type != CAPTURE_CMD_BEGIN_SCENE || !scene->offscreen)
+			continue;
+
+		ReplayTarget* target = findTarget(scene->width, scene->height);
+		if (target == nullptr)
+		{
+			ReplayTarget newTarget;
+			newTarget.width = scene->width;
+			newTarget.height = scene->height;
+			newTarget.scenesPerFrame = 0;
+			memset(&newTarget.colorSurface, 0, sizeof(newTarget.colorSurface));
+			_targets.push_back(std::move(newTarget));
+			target = &_targets.back();
+		}
+		size_t index = target - &_targets[0];
+		frameScenes.resize(_targets.size(), 0);
+		if (++frameScenes[index] > target->scenesPerFrame)
+			target->scenesPerFrame = frameScenes[index];
+	}
+	if (_targets.empty())
+		return;
+
+	//nothing reads what the scenes render, every target's surface can be the same memory
+	SceSize surfaceSize = 0;
+	for (size_t i = 0; i < _targets.size(); i++)
+	{
+		SceSize size = ALIGN_MEM(_targets[i].width, 8) * _targets[i].height * 4;
+		if (size > surfaceSize)
+			surfaceSize = size;
+	}
+	SceUID surfaceMemoryUID = -1;
+	surfaceMemory_ptr = Graphics::getInstance()->allocGraphicsMem(
+		SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW,
+		surfaceSize,
+		SCE_GXM_COLOR_SURFACE_ALIGNMENT,
+		SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
+		&surfaceMemoryUID,
+		"capture_replay_surface",
+		MEMORY_CATEGORY_DISPLAY
+	);
+	surfaceMemory = GpuBuffer(surfaceMemory_ptr, surfaceMemoryUID);
+
+	for (size_t i = 0; i < _targets.size(); i++)
+	{
+		ReplayTarget* target = &_targets[i];
+		target->renderTarget = Graphics::getInstance()->createRenderTarget(target->width, target->height, target->scenesPerFrame,
+			SCE_GXM_MULTISAMPLE_NONE, "capture_replay_target");
+		sceGxmColorSurfaceInit(&target->colorSurface, SCE_GXM_COLOR_FORMAT_A8B8G8R8, SCE_GXM_COLOR_SURFACE_LINEAR,
+			SCE_GXM_COLOR_SURFACE_SCALE_NONE, SCE_GXM_OUTPUT_REGISTER_SIZE_32BIT, target->width, target->height,
+			ALIGN_MEM(target->width, 8), surfaceMemory_ptr);
+	}
+}
+
+CaptureReplay::ReplayTarget* CaptureReplay::findTarget(unsigned int width, unsigned int height)
+{
+	for (size_t i = 0; i < _targets.size(); i++)
+		if (_targets[i].width == width && _targets[i].height == height)
+			return &_targets[i];
+	return nullptr;
+}
+
+const void* CaptureReplay::getBlob(uint32_t blob)
+{
+	return blobData_ptr + _blobs[blob].offset;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+//----------------------------------------------
+// CaptureReplay Class
+// Loads a capture written by Graphics::startCapture() (see CaptureFormat.h) and submits its
+// frames again through Graphics, as often as asked. Nothing of what made the frames runs, so
+// the time a replayed frame takes is the CPU cost of submitting it: Graphics, libgxm and the
+// driver underneath. On the host the same replay runs against the stand-in in host/.
+// Everything is set up by load(): the blob data goes into one GPU mapped block and is used in
+// place, the programs are registered and patched again, textures and offscreen targets are
+// made up front, so replay() itself allocates nothing.
+// Program binaries are replayed as they were captured, a capture only replays on the platform
+// (Vita or host stand-in) that recorded it
+//-----------------------------------------------
+
+#include <vector>
+
+#include <psp2/gxm.h>
+
+#include "CaptureFormat.h"
+#include "GpuHandle.h"
+
+//All times are in microseconds
+typedef struct CaptureReplayStats
+{
+	unsigned int frames;			//replayed, loops times the frames in the capture
+	unsigned int draws;
+	SceUInt64 frameTimeTotal;		//from the first command of a frame to its last, swapBuffers() isn't counted
+	SceUInt64 frameTimeMin;
+	SceUInt64 frameTimeMax;
+} CaptureReplayStats;
+
+class CaptureReplay
+{
+public:
+	CaptureReplay();
+	~CaptureReplay();
+
+	bool load(const char* path);
+	//Queues everything load() made for release, without waiting for the GPU. Call it before Graphics shuts down
+	void unload();
+	bool isLoaded();
+	unsigned int getFrameCount();
+
+	//Submits every captured frame loops times, swapping buffers after each. stats may be nullptr
+	void replay(unsigned int loops, CaptureReplayStats* stats);
+	static void logStats(const CaptureReplayStats* stats);
+
+private:
+	//An offscreen render target for every scene size, with a color surface in the shared surface memory
+	typedef struct ReplayTarget
+	{
+		unsigned int width;
+		unsigned int height;
+		unsigned int scenesPerFrame;
+		GpuRenderTarget renderTarget;
+		SceGxmColorSurface colorSurface;
+	} ReplayTarget;
+
+	bool loaded;
+	CaptureHeader header;
+	std::vector<CaptureProgram> _programs;
+	std::vector<CaptureVertexProgram> _vertexProgramEntries;
+	std::vector<CaptureFragmentProgram> _fragmentProgramEntries;
+	std::vector<CaptureParameter> _parameterEntries;
+	std::vector<CaptureBlob> _blobs;
+	std::vector<uint8_t> _commands;
+
+	//the blob data, in GPU mapped memory
+	GpuBuffer blobData;
+	uint8_t* blobData_ptr;
+
+	/* What load() made, indexed like the capture's tables */
+	std::vector<SceGxmShaderPatcherId> _programIDs;
+	std::vector<GpuVertexProgram> _vertexPrograms;
+	std::vector<GpuFragmentProgram> _fragmentPrograms;
+	std::vector<const SceGxmProgramParameter*> _parameters;
+	//one per SET_FRAGMENT_TEXTURE command, in command order
+	std::vector<SceGxmTexture> _textures;
+	std::vector<ReplayTarget> _targets;
+	GpuBuffer surfaceMemory;
+	void* surfaceMemory_ptr;
+
+	bool validate(SceSize fileSize);
+	//Walks the command stream checking every command and index in it, works out which programs are used
+	bool validateCommands(std::vector<bool>* usedPrograms, std::vector<bool>* usedVertexPrograms, std::vector<bool>* usedFragmentPrograms);
+	bool createPrograms(const std::vector<bool>* usedPrograms, const std::vector<bool>* usedVertexPrograms,
+		const std::vector<bool>* usedFragmentPrograms);
+	bool createTextures();
+	void createTargets();
+	ReplayTarget* findTarget(unsigned int width, unsigned int height);
+	const void* getBlob(uint32_t blob);
+};
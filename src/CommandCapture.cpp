@@ -0,0 +1,601 @@
+#include "CommandCapture.h"
+#include "Graphics.h"
+#include "TextureFormat.h"
+#include "UniformBuffer.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <assert.h>
+
+#include <psp2/kernel/processmgr.h>
+
+//Bits of SceGxmTextureFormat that pick the texel layout, the rest is the swizzle of the components
+#define GXM_TEXTURE_BASE_FORMAT_MASK	0x9F000000U
+
+//FNV-1a, blobs are only shared when the bytes compare equal as well
+static uint64_t hashData(const void* data, unsigned int size)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (unsigned int i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+//Bytes of every mip level of a texture, 0 for formats the engine doesn't make
+static unsigned int textureDataSize(const SceGxmTexture* texture)
+{
+	unsigned int unitSize = 0;
+	bool compressed = false;
+	switch (sceGxmTextureGetFormat(texture) & GXM_TEXTURE_BASE_FORMAT_MASK)
+	{
+	case SCE_GXM_TEXTURE_FORMAT_U8_R111:
+		unitSize = 1;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U4U4U4U4_ABGR:
+	case (SCE_GXM_TEXTURE_FORMAT_U5U6U5_BGR & GXM_TEXTURE_BASE_FORMAT_MASK):
+		unitSize = 2;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR:
+		unitSize = 4;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_UBC1_ABGR:
+		unitSize = 8;
+		compressed = true;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_UBC2_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_UBC3_ABGR:
+		unitSize = 16;
+		compressed = true;
+		break;
+	default:
+		return 0;
+	}
+
+	bool linear = (sceGxmTextureGetType(texture) == SCE_GXM_TEXTURE_LINEAR);
+	unsigned int width = sceGxmTextureGetWidth(texture);
+	unsigned int height = sceGxmTextureGetHeight(texture);
+	unsigned int mipCount = sceGxmTextureGetMipmapCount(texture);
+	if (mipCount == 0)
+		mipCount = 1;
+
+	//the same sizes the texture converter lays levels out with, see TextureFormat.h
+	unsigned int size = 0;
+	for (unsigned int level = 0; level < mipCount; level++)
+	{
+		if (compressed)
+			size += ((width + 3) / 4) * ((height + 3) / 4) * unitSize;
+		else if (linear)
+			size += ALIGN_MEM(width, TEXTURE_LINEAR_STRIDE_ALIGN) * height * unitSize;
+		else
+			size += width * height * unitSize;
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+	}
+	return size;
+}
+
+CommandCapture::CommandCapture()
+{
+	vertexProgramIndex = CAPTURE_NONE;
+	fragmentProgramIndex = CAPTURE_NONE;
+	memset(_textures, 0, sizeof(_textures));
+	memset(_textureBound, 0, sizeof(_textureBound));
+
+	pending = false;
+	recording = false;
+	suspended = false;
+	path[0] = '\0';
+	framesLeft = 0;
+	framesRecorded = 0;
+	displayWidth = 0;
+	displayHeight = 0;
+
+	for (int i = 0; i < SCE_GXM_MAX_VERTEX_STREAMS; i++)
+	{
+		_streamData[i] = nullptr;
+		_streamBlobs[i] = CAPTURE_NONE;
+	}
+	for (int i = 0; i < SCE_GXM_MAX_UNIFORM_BUFFERS; i++)
+	{
+		_uniformBufferData[i] = nullptr;
+		_uniformBufferBlobs[i] = CAPTURE_NONE;
+	}
+}
+
+CommandCapture::~CommandCapture()
+{
+
+}
+
+bool CommandCapture::start(const char* capturePath, unsigned int frames, unsigned int width, unsigned int height)
+{
+	if (pending || recording)
+	{
+		vitaPrintf("ERROR: a capture into %s is already going\n", path);
+		return false;
+	}
+	if (frames == 0 || strlen(capturePath) >= sizeof(path))
+	{
+		vitaPrintf("ERROR: can't capture %u frames into %s\n", frames, capturePath);
+		return false;
+	}
+
+	vitaPrintf("\nCapturing the next %u frames into %s\n", frames, capturePath);
+	strcpy(path, capturePath);
+	framesLeft = frames;
+	displayWidth = width;
+	displayHeight = height;
+	pending = true;
+	return true;
+}
+
+bool CommandCapture::isCapturing()
+{
+	return pending || recording;
+}
+
+bool CommandCapture::isRecording()
+{
+	return recording && !suspended;
+}
+
+void CommandCapture::setSuspended(bool suspend)
+{
+	suspended = suspend;
+}
+
+/*----- Always tracked -----*/
+
+void CommandCapture::programRegistered(SceGxmShaderPatcherId id, const SceGxmProgram* program)
+{
+	uint32_t index = (uint32_t)_programs.size();
+	_programs.push_back(program);
+	_programIndices[id] = index;
+
+	//programs registered while recording are captured now, the rest when recording starts
+	if (recording)
+		_programBlobs.push_back(addBlob(program, sceGxmProgramGetSize(program)));
+}
+
+void CommandCapture::programUnregistered(SceGxmShaderPatcherId id)
+{
+	std::map<SceGxmShaderPatcherId, uint32_t>::iterator iter = _programIndices.find(id);
+	if (iter == _programIndices.end())
+		return;
+	//the binary may be freed from here on, a blob taken while recording stays valid
+	_programs[iter->second] = nullptr;
+	_programIndices.erase(iter);
+}
+
+void CommandCapture::vertexProgramCreated(const SceGxmVertexProgram* program, SceGxmShaderPatcherId id, const SceGxmVertexAttribute* attributes,
+	unsigned int attributeCount, const char* const* names, const SceGxmVertexStream* stream, unsigned int streamCount)
+{
+	std::map<SceGxmShaderPatcherId, uint32_t>::iterator iter = _programIndices.find(id);
+	if (program == nullptr || iter == _programIndices.end())
+		return;
+	//the capture format has one stride and index source per program, draws with the program are reported as not captured
+	if (streamCount > 1)
+		return;
+	if (attributeCount > CAPTURE_MAX_ATTRIBUTES)
+	{
+		vitaPrintf("ERROR: vertex program has %u attributes, captures keep %u\n", attributeCount, CAPTURE_MAX_ATTRIBUTES);
+		attributeCount = CAPTURE_MAX_ATTRIBUTES;
+	}
+
+	CaptureVertexProgram entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.program = iter->second;
+	entry.attributeCount = attributeCount;
+	entry.stride = stream->stride;
+	entry.indexSource = stream->indexSource;
+	for (unsigned int i = 0; i < attributeCount; i++)
+	{
+		entry._attributes[i].streamIndex = attributes[i].streamIndex;
+		entry._attributes[i].offset = attributes[i].offset;
+		entry._attributes[i].format = attributes[i].format;
+		entry._attributes[i].componentCount = attributes[i].componentCount;
+		strncpy(entry._attributes[i].name, names[i], CAPTURE_NAME_LENGTH - 1);
+	}
+
+	_vertexProgramIndices[program] = (uint32_t)_vertexPrograms.size();
+	_vertexPrograms.push_back(entry);
+}
+
+void CommandCapture::fragmentProgramCreated(const SceGxmFragmentProgram* program, SceGxmShaderPatcherId id, SceGxmShaderPatcherId vertexId,
+	const SceGxmBlendInfo* blendInfo)
+{
+	std::map<SceGxmShaderPatcherId, uint32_t>::iterator iter = _programIndices.find(id);
+	if (program == nullptr || iter == _programIndices.end())
+		return;
+
+	CaptureFragmentProgram entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.program = iter->second;
+	std::map<SceGxmShaderPatcherId, uint32_t>::iterator vertexIter = _programIndices.find(vertexId);
+	entry.vertexProgram = (vertexIter != _programIndices.end()) ? vertexIter->second : CAPTURE_NONE;
+	if (blendInfo != NULL)
+	{
+		entry.blendEnabled = 1;
+		entry.colorMask = blendInfo->colorMask;
+		entry.colorFunc = blendInfo->colorFunc;
+		entry.alphaFunc = blendInfo->alphaFunc;
+		entry.colorSrc = blendInfo->colorSrc;
+		entry.colorDst = blendInfo->colorDst;
+		entry.alphaSrc = blendInfo->alphaSrc;
+		entry.alphaDst = blendInfo->alphaDst;
+	}
+
+	_fragmentProgramIndices[program] = (uint32_t)_fragmentPrograms.size();
+	_fragmentPrograms.push_back(entry);
+}
+
+void CommandCapture::setVertexProgram(const SceGxmVertexProgram* program)
+{
+	std::map<const SceGxmVertexProgram*, uint32_t>::iterator iter = _vertexProgramIndices.find(program);
+	vertexProgramIndex = (iter != _vertexProgramIndices.end()) ? iter->second : CAPTURE_NONE;
+	if (!isRecording())
+		return;
+
+	CaptureSetProgram* command = (CaptureSetProgram*)addCommand(CAPTURE_CMD_SET_VERTEX_PROGRAM, sizeof(CaptureSetProgram));
+	command->index = vertexProgramIndex;
+}
+
+void CommandCapture::setFragmentProgram(const SceGxmFragmentProgram* program)
+{
+	std::map<const SceGxmFragmentProgram*, uint32_t>::iterator iter = _fragmentProgramIndices.find(program);
+	fragmentProgramIndex = (iter != _fragmentProgramIndices.end()) ? iter->second : CAPTURE_NONE;
+	if (!isRecording())
+		return;
+
+	CaptureSetProgram* command = (CaptureSetProgram*)addCommand(CAPTURE_CMD_SET_FRAGMENT_PROGRAM, sizeof(CaptureSetProgram));
+	command->index = fragmentProgramIndex;
+}
+
+void CommandCapture::setFragmentTexture(unsigned int unit, const SceGxmTexture* texture)
+{
+	if (unit >= SCE_GXM_MAX_TEXTURE_UNITS)
+		return;
+	_textureBound[unit] = (texture != nullptr);
+	if (texture != nullptr)
+		_textures[unit] = *texture;
+	if (isRecording() && _textureBound[unit])
+		recordTexture(unit);
+}
+
+/*----- Recorded -----*/
+
+void CommandCapture::beginFrame()
+{
+	_frameTextureBlobs.clear();
+	if (pending)
+		startRecording();
+}
+
+void CommandCapture::beginScene(bool offscreen, unsigned int width, unsigned int height)
+{
+	CaptureBeginScene* command = (CaptureBeginScene*)addCommand(CAPTURE_CMD_BEGIN_SCENE, sizeof(CaptureBeginScene));
+	command->offscreen = offscreen ? 1 : 0;
+	command->width = (uint16_t)width;
+	command->height = (uint16_t)height;
+}
+
+void CommandCapture::endScene(bool offscreen)
+{
+	CaptureEndScene* command = (CaptureEndScene*)addCommand(CAPTURE_CMD_END_SCENE, sizeof(CaptureEndScene));
+	command->offscreen = offscreen ? 1 : 0;
+}
+
+void CommandCapture::clear(uint32_t color)
+{
+	CaptureClear* command = (CaptureClear*)addCommand(CAPTURE_CMD_CLEAR, sizeof(CaptureClear));
+	command->color = color;
+}
+
+void CommandCapture::setVertexStream(unsigned int streamIndex, const void* data)
+{
+	if (streamIndex < SCE_GXM_MAX_VERTEX_STREAMS)
+		_streamData[streamIndex] = data;
+}
+
+void CommandCapture::setVertexUniformBuffer(unsigned int bufferIndex, const void* data)
+{
+	if (bufferIndex < SCE_GXM_MAX_UNIFORM_BUFFERS)
+		_uniformBufferData[bufferIndex] = data;
+}
+
+void CommandCapture::setUniforms(bool fragment, const SceGxmProgramParameter* parameter, unsigned int componentOffset,
+	unsigned int componentCount, const float* data)
+{
+	uint32_t parameterIndex = findParameter(parameter);
+	if (parameterIndex == CAPTURE_NONE)
+	{
+		vitaPrintf("ERROR: uniform parameter %p isn't in a registered program, not captured\n", parameter);
+		return;
+	}
+
+	unsigned int dataSize = componentCount * sizeof(float);
+	CaptureUniform* command = (CaptureUniform*)addCommand(fragment ? CAPTURE_CMD_FRAGMENT_UNIFORM : CAPTURE_CMD_VERTEX_UNIFORM,
+		sizeof(CaptureUniform) + dataSize);
+	command->parameter = parameterIndex;
+	command->componentOffset = (uint16_t)componentOffset;
+	command->componentCount = (uint16_t)componentCount;
+	memcpy(command + 1, data, dataSize);
+}
+
+void CommandCapture::draw(SceGxmPrimitiveType primitive, SceGxmIndexFormat format, const void* indexData, unsigned int indexCount)
+{
+	if (vertexProgramIndex == CAPTURE_NONE || _streamData[0] == nullptr || indexCount == 0)
+	{
+		vitaPrintf("ERROR: draw without a vertex program or stream the capture knows, not captured\n");
+		return;
+	}
+
+	//the stream is captured up to the highest vertex this draw reads
+	unsigned int maxIndex = 0;
+	if (format == SCE_GXM_INDEX_FORMAT_U16)
+	{
+		const uint16_t* indices = (const uint16_t*)indexData;
+		for (unsigned int i = 0; i < indexCount; i++)
+			if (indices[i] > maxIndex)
+				maxIndex = indices[i];
+	}
+	else
+	{
+		const uint32_t* indices = (const uint32_t*)indexData;
+		for (unsigned int i = 0; i < indexCount; i++)
+			if (indices[i] > maxIndex)
+				maxIndex = indices[i];
+	}
+
+	//Graphics only ever feeds stream 0
+	const CaptureVertexProgram* vertexProgram = &_vertexPrograms[vertexProgramIndex];
+	uint32_t streamBlob = addBlob(_streamData[0], (maxIndex + 1) * vertexProgram->stride);
+	if (streamBlob != _streamBlobs[0])
+	{
+		CaptureSetVertexStream* stream = (CaptureSetVertexStream*)addCommand(CAPTURE_CMD_SET_VERTEX_STREAM, sizeof(CaptureSetVertexStream));
+		stream->streamIndex = 0;
+		stream->blob = streamBlob;
+		_streamBlobs[0] = streamBlob;
+	}
+
+	//the uniform buffers the vertex program reads, as they are now. Their memory is rewritten every frame
+	const SceGxmProgram* program = _programs[vertexProgram->program];
+	for (unsigned int i = 0; program != nullptr && i < SCE_GXM_MAX_UNIFORM_BUFFERS; i++)
+	{
+		SceSize size = getUniformBufferSize(program, i);
+		if (size == 0 || _uniformBufferData[i] == nullptr)
+			continue;
+		uint32_t bufferBlob = addBlob(_uniformBufferData[i], size);
+		if (bufferBlob == _uniformBufferBlobs[i])
+			continue;
+		CaptureSetUniformBuffer* buffer = (CaptureSetUniformBuffer*)addCommand(CAPTURE_CMD_SET_VERTEX_UNIFORM_BUFFER,
+			sizeof(CaptureSetUniformBuffer));
+		buffer->bufferIndex = i;
+		buffer->blob = bufferBlob;
+		_uniformBufferBlobs[i] = bufferBlob;
+	}
+
+	unsigned int indexSize = (format == SCE_GXM_INDEX_FORMAT_U16) ? sizeof(uint16_t) : sizeof(uint32_t);
+	uint32_t indexBlob = addBlob(indexData, indexCount * indexSize);
+	CaptureDraw* command = (CaptureDraw*)addCommand(CAPTURE_CMD_DRAW, sizeof(CaptureDraw));
+	command->primitive = primitive;
+	command->indexFormat = format;
+	command->indexCount = indexCount;
+	command->indexBlob = indexBlob;
+}
+
+void CommandCapture::endFrame()
+{
+	_frameTextureBlobs.clear();
+	if (!recording)
+		return;
+
+	addCommand(CAPTURE_CMD_END_FRAME, sizeof(CaptureCommand));
+	framesRecorded++;
+	if (--framesLeft > 0)
+		return;
+
+	SceUInt64 startTime = sceKernelGetProcessTimeWide();
+	bool written = writeFile();
+	SceUInt64 writeTime = sceKernelGetProcessTimeWide() - startTime;
+	if (written)
+		vitaPrintf("\nCaptured %u frames into %s: %u commands bytes, %u blobs, %u bytes of data, written in %.2fms\n", framesRecorded,
+			path, (unsigned int)_commands.size(), (unsigned int)_blobs.size(), (unsigned int)_blobData.size(), writeTime / 1000.0);
+	stopRecording();
+}
+
+/*----- Internal -----*/
+
+void CommandCapture::startRecording()
+{
+	pending = false;
+	recording = true;
+	framesRecorded = 0;
+
+	//what the frame inherits from before the capture is written first, so replay starts from the same state
+	_programBlobs.clear();
+	for (size_t i = 0; i < _programs.size(); i++)
+		_programBlobs.push_back((_programs[i] != nullptr) ? addBlob(_programs[i], sceGxmProgramGetSize(_programs[i])) : CAPTURE_NONE);
+	for (int i = 0; i < SCE_GXM_MAX_VERTEX_STREAMS; i++)
+		_streamBlobs[i] = CAPTURE_NONE;
+	for (int i = 0; i < SCE_GXM_MAX_UNIFORM_BUFFERS; i++)
+		_uniformBufferBlobs[i] = CAPTURE_NONE;
+
+	bool wasSuspended = suspended;
+	suspended = false;
+	if (vertexProgramIndex != CAPTURE_NONE)
+		((CaptureSetProgram*)addCommand(CAPTURE_CMD_SET_VERTEX_PROGRAM, sizeof(CaptureSetProgram)))->index = vertexProgramIndex;
+	if (fragmentProgramIndex != CAPTURE_NONE)
+		((CaptureSetProgram*)addCommand(CAPTURE_CMD_SET_FRAGMENT_PROGRAM, sizeof(CaptureSetProgram)))->index = fragmentProgramIndex;
+	for (unsigned int unit = 0; unit < SCE_GXM_MAX_TEXTURE_UNITS; unit++)
+		if (_textureBound[unit])
+			recordTexture(unit);
+	suspended = wasSuspended;
+}
+
+void CommandCapture::stopRecording()
+{
+	recording = false;
+	framesLeft = 0;
+	//the tables are kept, the programs they describe are still alive
+	std::vector<uint8_t>().swap(_commands);
+	std::vector<uint32_t>().swap(_programBlobs);
+	std::vector<CaptureParameter>().swap(_parameters);
+	_parameterIndices.clear();
+	std::vector<CaptureBlob>().swap(_blobs);
+	std::vector<uint8_t>().swap(_blobData);
+	_blobHashes.clear();
+	_frameTextureBlobs.clear();
+}
+
+bool CommandCapture::writeFile()
+{
+	CaptureHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = CAPTURE_MAGIC;
+	header.version = CAPTURE_VERSION;
+	header.frameCount = framesRecorded;
+	header.displayWidth = (uint16_t)displayWidth;
+	header.displayHeight = (uint16_t)displayHeight;
+	header.programCount = (uint32_t)_programBlobs.size();
+	header.vertexProgramCount = (uint32_t)_vertexPrograms.size();
+	header.fragmentProgramCount = (uint32_t)_fragmentPrograms.size();
+	header.parameterCount = (uint32_t)_parameters.size();
+	header.blobCount = (uint32_t)_blobs.size();
+	header.commandOffset = sizeof(CaptureHeader) + header.programCount * sizeof(CaptureProgram) +
+		header.vertexProgramCount * sizeof(CaptureVertexProgram) + header.fragmentProgramCount * sizeof(CaptureFragmentProgram) +
+		header.parameterCount * sizeof(CaptureParameter) + header.blobCount * sizeof(CaptureBlob);
+	header.commandSize = (uint32_t)_commands.size();
+	header.blobDataOffset = ALIGN_MEM(header.commandOffset + header.commandSize, CAPTURE_BLOB_ALIGNMENT);
+	header.blobDataSize = (uint32_t)_blobData.size();
+
+	SceUID fd = sceIoOpen(path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+	if (fd < 0)
+	{
+		vitaPrintf("sceIoOpen() result: 0x%08X (%s)\n", fd, path);
+		return false;
+	}
+
+	//CaptureProgram is only the blob index
+	static const uint8_t padding[CAPTURE_BLOB_ALIGNMENT] = { 0 };
+	bool written = writeFully(fd, &header, sizeof(header)) &&
+		(_programBlobs.empty() || writeFully(fd, &_programBlobs[0], _programBlobs.size() * sizeof(CaptureProgram))) &&
+		(_vertexPrograms.empty() || writeFully(fd, &_vertexPrograms[0], _vertexPrograms.size() * sizeof(CaptureVertexProgram))) &&
+		(_fragmentPrograms.empty() || writeFully(fd, &_fragmentPrograms[0], _fragmentPrograms.size() * sizeof(CaptureFragmentProgram))) &&
+		(_parameters.empty() || writeFully(fd, &_parameters[0], _parameters.size() * sizeof(CaptureParameter))) &&
+		(_blobs.empty() || writeFully(fd, &_blobs[0], _blobs.size() * sizeof(CaptureBlob))) &&
+		(_commands.empty() || writeFully(fd, &_commands[0], _commands.size())) &&
+		writeFully(fd, padding, header.blobDataOffset - (header.commandOffset + header.commandSize)) &&
+		(_blobData.empty() || writeFully(fd, &_blobData[0], _blobData.size()));
+	sceIoClose(fd);
+
+	if (!written)
+		vitaPrintf("ERROR: could not write the capture to %s\n", path);
+	return written;
+}
+
+void* CommandCapture::addCommand(CaptureCommandType type, unsigned int size)
+{
+	assert((size % 4) == 0 && size <= 0xFFFF);
+	size_t offset = _commands.size();
+	_commands.resize(offset + size);
+	CaptureCommand* command = (CaptureCommand*)&_commands[offset];
+	command->type = (uint16_t)type;
+	command->size = (uint16_t)size;
+	return command;
+}
+
+uint32_t CommandCapture::addBlob(const void* data, unsigned int size)
+{
+	uint64_t hash = hashData(data, size);
+	std::pair<std::multimap<uint64_t, uint32_t>::iterator, std::multimap<uint64_t, uint32_t>::iterator> range = _blobHashes.equal_range(hash);
+	for (std::multimap<uint64_t, uint32_t>::iterator iter = range.first; iter != range.second; iter++)
+	{
+		const CaptureBlob* blob = &_blobs[iter->second];
+		if (blob->size == size && memcmp(&_blobData[blob->offset], data, size) == 0)
+			return iter->second;
+	}
+
+	CaptureBlob blob;
+	blob.offset = (uint32_t)_blobData.size();
+	blob.size = size;
+	_blobData.resize(ALIGN_MEM(blob.offset + size, CAPTURE_BLOB_ALIGNMENT));
+	memcpy(&_blobData[blob.offset], data, size);
+
+	uint32_t index = (uint32_t)_blobs.size();
+	_blobs.push_back(blob);
+	_blobHashes.insert(std::make_pair(hash, index));
+	return index;
+}
+
+uint32_t CommandCapture::findParameter(const SceGxmProgramParameter* parameter)
+{
+	std::map<const SceGxmProgramParameter*, uint32_t>::iterator iter = _parameterIndices.find(parameter);
+	if (iter != _parameterIndices.end())
+		return iter->second;
+
+	//parameters live inside their program's binary
+	std::map<SceGxmShaderPatcherId, uint32_t>::iterator program;
+	for (program = _programIndices.begin(); program != _programIndices.end(); program++)
+	{
+		const uint8_t* binary = (const uint8_t*)_programs[program->second];
+		const uint8_t* address = (const uint8_t*)parameter;
+		if (address < binary || address >= binary + sceGxmProgramGetSize(_programs[program->second]))
+			continue;
+
+		CaptureParameter entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.program = program->second;
+		strncpy(entry.name, sceGxmProgramParameterGetName(parameter), CAPTURE_NAME_LENGTH - 1);
+		uint32_t index = (uint32_t)_parameters.size();
+		_parameters.push_back(entry);
+		_parameterIndices[parameter] = index;
+		return index;
+	}
+	return CAPTURE_NONE;
+}
+
+void CommandCapture::recordTexture(unsigned int unit)
+{
+	const SceGxmTexture* texture = &_textures[unit];
+	const void* data = sceGxmTextureGetData(texture);
+	unsigned int size = textureDataSize(texture);
+	if (size == 0)
+	{
+		vitaPrintf("ERROR: texture format 0x%08X can't be captured\n", sceGxmTextureGetFormat(texture));
+		return;
+	}
+
+	//a texture is only captured once a frame, the CPU doesn't write into one it has already bound
+	uint32_t blob;
+	std::map<const void*, uint32_t>::iterator iter = _frameTextureBlobs.find(data);
+	if (iter != _frameTextureBlobs.end() && _blobs[iter->second].size == size)
+	{
+		blob = iter->second;
+	}
+	else
+	{
+		blob = addBlob(data, size);
+		_frameTextureBlobs[data] = blob;
+	}
+
+	CaptureSetTexture* command = (CaptureSetTexture*)addCommand(CAPTURE_CMD_SET_FRAGMENT_TEXTURE, sizeof(CaptureSetTexture));
+	command->unit = unit;
+	command->format = sceGxmTextureGetFormat(texture);
+	command->type = sceGxmTextureGetType(texture);
+	command->width = (uint16_t)sceGxmTextureGetWidth(texture);
+	command->height = (uint16_t)sceGxmTextureGetHeight(texture);
+	command->mipCount = (uint8_t)sceGxmTextureGetMipmapCount(texture);
+	command->minFilter = (uint8_t)sceGxmTextureGetMinFilter(texture);
+	command->magFilter = (uint8_t)sceGxmTextureGetMagFilter(texture);
+	command->mipFilter = (sceGxmTextureGetMipFilter(texture) == SCE_GXM_TEXTURE_MIP_FILTER_ENABLED) ? 1 : 0;
+	command->uAddrMode = (uint8_t)sceGxmTextureGetUAddrMode(texture);
+	command->vAddrMode = (uint8_t)sceGxmTextureGetVAddrMode(texture);
+	command->lodBias = (uint8_t)sceGxmTextureGetLodBias(texture);
+	command->reserved = 0;
+	command->blob = blob;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+//----------------------------------------------
+// CommandCapture Class
+// Records what Graphics submits for a number of frames into a capture file (see
+// CaptureFormat.h) that the CaptureReplay can submit again on its own, as a repeatable
+// benchmark of the CPU side of a scene without the game logic that produced it.
+// Graphics owns one and calls it from the functions that talk to libgxm, so only what goes
+// through Graphics is seen. Program creation is always tracked because a capture can start
+// long after the programs it draws with were made, everything else is only looked at while
+// recording: state changes and uniform writes as they happen, the vertex and index data a
+// draw reads at the draw, a texture's data when it is bound. Anything the GPU renders into
+// during the capture is captured as it was when bound, not as it would be on replay.
+// The dynamic resolution blit isn't recorded, the replaying Graphics does its own.
+// Recording starts at the next frame and the file is written when the last frame is swapped,
+// on the render thread
+//-----------------------------------------------
+
+#include <vector>
+#include <map>
+
+#include <psp2/gxm.h>
+
+#include "CaptureFormat.h"
+
+class CommandCapture
+{
+public:
+	CommandCapture();
+	~CommandCapture();
+
+	//Captures the next frames frames into path, false if a capture is already going
+	bool start(const char* path, unsigned int frames, unsigned int displayWidth, unsigned int displayHeight);
+	//A capture has been asked for and hasn't been written yet
+	bool isCapturing();
+	//Graphics checks this before passing anything per draw on
+	bool isRecording();
+	//While suspended nothing is recorded, for what Graphics draws on its own behalf
+	void setSuspended(bool suspend);
+
+	/*----- Always tracked -----*/
+	void programRegistered(SceGxmShaderPatcherId id, const SceGxmProgram* program);
+	void programUnregistered(SceGxmShaderPatcherId id);
+	//the attributes the program was created with and the shader input each one feeds. Programs reading more than one stream aren't kept
+	void vertexProgramCreated(const SceGxmVertexProgram* program, SceGxmShaderPatcherId id, const SceGxmVertexAttribute* attributes,
+		unsigned int attributeCount, const char* const* names, const SceGxmVertexStream* stream, unsigned int streamCount);
+	void fragmentProgramCreated(const SceGxmFragmentProgram* program, SceGxmShaderPatcherId id, SceGxmShaderPatcherId vertexId,
+		const SceGxmBlendInfo* blendInfo);
+	void setVertexProgram(const SceGxmVertexProgram* program);
+	void setFragmentProgram(const SceGxmFragmentProgram* program);
+	void setFragmentTexture(unsigned int unit, const SceGxmTexture* texture);
+
+	/*----- Recorded -----*/
+	//Starts recording if a capture is pending
+	void beginFrame();
+	void beginScene(bool offscreen, unsigned int width, unsigned int height);
+	void endScene(bool offscreen);
+	void clear(uint32_t color);
+	void setVertexStream(unsigned int streamIndex, const void* data);
+	void setVertexUniformBuffer(unsigned int bufferIndex, const void* data);
+	void setUniforms(bool fragment, const SceGxmProgramParameter* parameter, unsigned int componentOffset,
+		unsigned int componentCount, const float* data);
+	void draw(SceGxmPrimitiveType primitive, SceGxmIndexFormat format, const void* indexData, unsigned int indexCount);
+	//Writes the file once the last frame is recorded
+	void endFrame();
+
+private:
+	//The tables keep every program ever made so indices stay valid, a program is nullptr once unregistered.
+	//The patcher hands out the same vertex or fragment program for identical requests, the maps point at the latest entry
+	std::vector<const SceGxmProgram*> _programs;
+	std::map<SceGxmShaderPatcherId, uint32_t> _programIndices;
+	std::vector<CaptureVertexProgram> _vertexPrograms;
+	std::map<const SceGxmVertexProgram*, uint32_t> _vertexProgramIndices;
+	std::vector<CaptureFragmentProgram> _fragmentPrograms;
+	std::map<const SceGxmFragmentProgram*, uint32_t> _fragmentProgramIndices;
+
+	//What is bound right now, written out when recording starts
+	uint32_t vertexProgramIndex;
+	uint32_t fragmentProgramIndex;
+	SceGxmTexture _textures[SCE_GXM_MAX_TEXTURE_UNITS];
+	bool _textureBound[SCE_GXM_MAX_TEXTURE_UNITS];
+
+	/* Recording */
+	bool pending;
+	bool recording;
+	bool suspended;
+	char path[256];
+	unsigned int framesLeft;
+	unsigned int framesRecorded;
+	unsigned int displayWidth;
+	unsigned int displayHeight;
+
+	std::vector<uint8_t> _commands;
+	std::vector<uint32_t> _programBlobs;
+	std::vector<CaptureParameter> _parameters;
+	std::map<const SceGxmProgramParameter*, uint32_t> _parameterIndices;
+	std::vector<CaptureBlob> _blobs;
+	std::vector<uint8_t> _blobData;
+	//content hash to the blobs holding it
+	std::multimap<uint64_t, uint32_t> _blobHashes;
+	//vertex data bound per stream, and the blob last written for it. A stream is only written again when what a draw reads changes
+	const void* _streamData[SCE_GXM_MAX_VERTEX_STREAMS];
+	uint32_t _streamBlobs[SCE_GXM_MAX_VERTEX_STREAMS];
+	//the same for the vertex uniform buffers, written when a draw reads different contents
+	const void* _uniformBufferData[SCE_GXM_MAX_UNIFORM_BUFFERS];
+	uint32_t _uniformBufferBlobs[SCE_GXM_MAX_UNIFORM_BUFFERS];
+	//texture data already captured this frame, a texture bound again in the same frame isn't hashed again
+	std::map<const void*, uint32_t> _frameTextureBlobs;
+
+	void startRecording();
+	void stopRecording();
+	bool writeFile();
+	void* addCommand(CaptureCommandType type, unsigned int size);
+	//Stores size bytes of data as a blob, or finds the blob that already holds them
+	uint32_t addBlob(const void* data, unsigned int size);
+	uint32_t findParameter(const SceGxmProgramParameter* parameter);
+	void recordTexture(unsigned int unit);
+};
@@ -0,0 +1,266 @@
+#include "DemoCrowd.h"
+#include "commonUtils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define PI 3.14159265358979323846f
+
+#define DEMO_BONES				14
+#define DEMO_FRAME_RATE			30.0f
+#define DEMO_WALK_KEYS			30		//a stride a second
+#define DEMO_WAVE_KEYS			60
+#define DEMO_COLUMNS			8
+//world units a figure gets in the grid, the figures are 2 high
+#define DEMO_CELL_WIDTH			2.0f
+#define DEMO_CELL_HEIGHT		2.3f
+
+enum DemoBoneIndex
+{
+	HIPS = 0, SPINE, CHEST, HEAD,
+	UPPER_ARM_BACK, FOREARM_BACK, UPPER_ARM_FRONT, FOREARM_FRONT,
+	THIGH_BACK, SHIN_BACK, FOOT_BACK, THIGH_FRONT, SHIN_FRONT, FOOT_FRONT
+};
+
+//The bind pose in model space, the figure faces +x with y up. Every bone is a quad from its joint to its tip
+typedef struct DemoBone
+{
+	int parent;
+	float joint[2];
+	float tip[2];
+	float width;
+	unsigned int color;
+} DemoBone;
+
+#define BACK_COLOR		((unsigned int)RGBA8(90, 110, 150, 255))
+#define BODY_COLOR		((unsigned int)RGBA8(200, 170, 120, 255))
+#define FRONT_COLOR		((unsigned int)RGBA8(150, 190, 255, 255))
+
+static const DemoBone _bones[DEMO_BONES] = {
+	{ SKELETON_NO_PARENT, { 0.0f, 1.0f }, { 0.0f, 1.15f }, 0.14f, BODY_COLOR },		//HIPS
+	{ HIPS, { 0.0f, 1.15f }, { 0.0f, 1.4f }, 0.12f, BODY_COLOR },					//SPINE
+	{ SPINE, { 0.0f, 1.4f }, { 0.0f, 1.68f }, 0.15f, BODY_COLOR },					//CHEST
+	{ CHEST, { 0.0f, 1.68f }, { 0.0f, 1.95f }, 0.11f, BODY_COLOR },					//HEAD
+	{ CHEST, { 0.0f, 1.62f }, { 0.0f, 1.34f }, 0.06f, BACK_COLOR },					//UPPER_ARM_BACK
+	{ UPPER_ARM_BACK, { 0.0f, 1.34f }, { 0.0f, 1.06f }, 0.05f, BACK_COLOR },		//FOREARM_BACK
+	{ CHEST, { 0.0f, 1.62f }, { 0.0f, 1.34f }, 0.06f, FRONT_COLOR },				//UPPER_ARM_FRONT
+	{ UPPER_ARM_FRONT, { 0.0f, 1.34f }, { 0.0f, 1.06f }, 0.05f, FRONT_COLOR },		//FOREARM_FRONT
+	{ HIPS, { 0.0f, 1.0f }, { 0.0f, 0.52f }, 0.08f, BACK_COLOR },					//THIGH_BACK
+	{ THIGH_BACK, { 0.0f, 0.52f }, { 0.0f, 0.06f }, 0.065f, BACK_COLOR },			//SHIN_BACK
+	{ SHIN_BACK, { 0.0f, 0.06f }, { 0.18f, 0.02f }, 0.04f, BACK_COLOR },			//FOOT_BACK
+	{ HIPS, { 0.0f, 1.0f }, { 0.0f, 0.52f }, 0.08f, FRONT_COLOR },					//THIGH_FRONT
+	{ THIGH_FRONT, { 0.0f, 0.52f }, { 0.0f, 0.06f }, 0.065f, FRONT_COLOR },			//SHIN_FRONT
+	{ SHIN_FRONT, { 0.0f, 0.06f }, { 0.18f, 0.02f }, 0.04f, FRONT_COLOR }			//FOOT_FRONT
+};
+
+//the far limbs first, the near ones last, there is no depth test
+static const unsigned int _drawOrder[DEMO_BONES] = {
+	UPPER_ARM_BACK, FOREARM_BACK, THIGH_BACK, SHIN_BACK, FOOT_BACK,
+	HIPS, SPINE, CHEST, HEAD,
+	THIGH_FRONT, SHIN_FRONT, FOOT_FRONT, UPPER_ARM_FRONT, FOREARM_FRONT
+};
+
+//The bind pose relative to the parents, rotated about z (towards the viewer) by angles
+static void setPose(const float* angles, float rootHeight, BoneTransform* transforms)
+{
+	for (unsigned int bone = 0; bone < DEMO_BONES; bone++)
+	{
+		int parent = _bones[bone].parent;
+		BoneTransform* transform = &transforms[bone];
+		transform->rotation[0] = 0.0f;
+		transform->rotation[1] = 0.0f;
+		transform->rotation[2] = sinf(angles[bone] * 0.5f);
+		transform->rotation[3] = cosf(angles[bone] * 0.5f);
+		transform->translation[0] = _bones[bone].joint[0] - ((parent == SKELETON_NO_PARENT) ? 0.0f : _bones[parent].joint[0]);
+		transform->translation[1] = _bones[bone].joint[1] - ((parent == SKELETON_NO_PARENT) ? 0.0f : _bones[parent].joint[1]);
+		transform->translation[2] = 0.0f;
+	}
+	transforms[HIPS].translation[1] += rootHeight;
+}
+
+DemoCrowd::DemoCrowd()
+{
+	memset(viewProjection, 0, sizeof(viewProjection));
+}
+
+DemoCrowd::~DemoCrowd()
+{
+}
+
+bool DemoCrowd::init(unsigned int characters)
+{
+	vitaPrintf("\nInitializing a crowd of %u characters\n", characters);
+
+	//no bone is rotated in the bind pose, the inverse bind matrices only move the joint to the origin
+	Skeleton skeleton;
+	memset(&skeleton, 0, sizeof(skeleton));
+	skeleton.boneCount = DEMO_BONES;
+	for (unsigned int bone = 0; bone < DEMO_BONES; bone++)
+	{
+		skeleton._parents[bone] = _bones[bone].parent;
+		float* inverseBind = skeleton._inverseBind[bone];
+		inverseBind[0] = 1.0f;
+		inverseBind[5] = 1.0f;
+		inverseBind[10] = 1.0f;
+		inverseBind[3] = -_bones[bone].joint[0];
+		inverseBind[7] = -_bones[bone].joint[1];
+	}
+
+	//a quad along every bone, the joint end shared with the parent so the joints bend instead of coming apart
+	SkinnedVertex vertices[DEMO_BONES * 4];
+	uint16_t indices[DEMO_BONES * 6];
+	memset(vertices, 0, sizeof(vertices));
+	for (unsigned int i = 0; i < DEMO_BONES; i++)
+	{
+		unsigned int bone = _drawOrder[i];
+		const DemoBone* demoBone = &_bones[bone];
+		float dx = demoBone->tip[0] - demoBone->joint[0];
+		float dy = demoBone->tip[1] - demoBone->joint[1];
+		float scale = demoBone->width * 0.5f / sqrtf(dx * dx + dy * dy);
+		float nx = -dy * scale;
+		float ny = dx * scale;
+		for (unsigned int corner = 0; corner < 4; corner++)
+		{
+			SkinnedVertex* vertex = &vertices[i * 4 + corner];
+			const float* end = (corner < 2) ? demoBone->joint : demoBone->tip;
+			float side = (corner & 1) ? 1.0f : -1.0f;
+			vertex->x = end[0] + nx * side;
+			vertex->y = end[1] + ny * side;
+			vertex->z = 0.0f;
+			vertex->bones[0] = (uint8_t)bone;
+			vertex->weights[0] = 255;
+			if (corner < 2 && demoBone->parent != SKELETON_NO_PARENT)
+			{
+				vertex->bones[1] = (uint8_t)demoBone->parent;
+				vertex->weights[0] = 128;
+				vertex->weights[1] = 127;
+			}
+			vertex->color = demoBone->color;
+		}
+		uint16_t first = (uint16_t)(i * 4);
+		uint16_t quad[6] = { first, (uint16_t)(first + 1), (uint16_t)(first + 2), (uint16_t)(first + 2), (uint16_t)(first + 1),
+			(uint16_t)(first + 3) };
+		memcpy(&indices[i * 6], quad, sizeof(quad));
+	}
+
+	if (!buildClips() || !animationSystem.init(&skeleton, vertices, DEMO_BONES * 4, indices, DEMO_BONES * 6, characters))
+		return false;
+
+	//rows from the back, the figures in the rows further down are drawn over them
+	const GraphicsConfig* config = Graphics::getInstance()->getConfig();
+	unsigned int rows = (characters + DEMO_COLUMNS - 1) / DEMO_COLUMNS;
+	float height = rows * DEMO_CELL_HEIGHT;
+	float width = height * (float)config->displayWidth / (float)config->displayHeight;
+	if (width < DEMO_COLUMNS * DEMO_CELL_WIDTH)
+	{
+		width = DEMO_COLUMNS * DEMO_CELL_WIDTH;
+		height = width * (float)config->displayHeight / (float)config->displayWidth;
+	}
+	float left = (width - DEMO_COLUMNS * DEMO_CELL_WIDTH) * 0.5f;
+	for (unsigned int i = 0; i < characters; i++)
+	{
+		unsigned int column = i % DEMO_COLUMNS;
+		unsigned int row = i / DEMO_COLUMNS;
+		AnimationCharacter character;
+		memset(&character, 0, sizeof(character));
+		character.clip = &walkClip;
+		character.blendClip = &waveClip;
+		character.blendWeight = (i % 4) / 3.0f;
+		character.time = i * 0.37f;
+		character.speed = 0.8f + 0.05f * (i % 8);
+		//every other column faces the other way, mirrored in x
+		character.transform[0] = (column & 1) ? -1.0f : 1.0f;
+		character.transform[5] = 1.0f;
+		character.transform[10] = 1.0f;
+		character.transform[3] = left + (column + 0.5f) * DEMO_CELL_WIDTH;
+		character.transform[7] = height - (row + 1) * DEMO_CELL_HEIGHT + 0.1f;
+		animationSystem.addCharacter(&character);
+	}
+
+	//world units to clip space, the origin at the bottom left
+	memset(viewProjection, 0, sizeof(viewProjection));
+	viewProjection[0] = 2.0f / width;
+	viewProjection[5] = 2.0f / height;
+	viewProjection[10] = 1.0f;
+	viewProjection[12] = -1.0f;
+	viewProjection[13] = -1.0f;
+	viewProjection[15] = 1.0f;
+	return true;
+}
+
+bool DemoCrowd::buildClips()
+{
+	//the keys are only needed until they are quantized
+	float angles[DEMO_BONES];
+	BoneTransform* walkKeys = (BoneTransform*)malloc((DEMO_WALK_KEYS + DEMO_WAVE_KEYS) * DEMO_BONES * sizeof(BoneTransform));
+	BoneTransform* waveKeys = walkKeys + DEMO_WALK_KEYS * DEMO_BONES;
+	for (unsigned int key = 0; key < DEMO_WALK_KEYS; key++)
+	{
+		//the legs swing half a stride apart and the arms against them, the knees bend as the legs come forward
+		float phase = 2.0f * PI * key / DEMO_WALK_KEYS;
+		memset(angles, 0, sizeof(angles));
+		angles[SPINE] = -0.05f;
+		angles[CHEST] = 0.04f * sinf(2.0f * phase);
+		angles[HEAD] = 0.05f * sinf(2.0f * phase);
+		const unsigned int thighs[2] = { THIGH_FRONT, THIGH_BACK };
+		const unsigned int arms[2] = { UPPER_ARM_FRONT, UPPER_ARM_BACK };
+		for (unsigned int side = 0; side < 2; side++)
+		{
+			float legPhase = phase + side * PI;
+			float thigh = 0.45f * sinf(legPhase);
+			float knee = cosf(legPhase);
+			float shin = -0.15f - 0.5f * ((knee > 0.0f) ? knee : 0.0f);
+			angles[thighs[side]] = thigh;
+			angles[thighs[side] + 1] = shin;
+			angles[thighs[side] + 2] = -(thigh + shin);
+			angles[arms[side]] = -0.35f * sinf(legPhase);
+			angles[arms[side] + 1] = 0.3f + 0.15f * sinf(legPhase);
+		}
+		setPose(angles, 0.03f * cosf(2.0f * phase), &walkKeys[key * DEMO_BONES]);
+	}
+
+	for (unsigned int key = 0; key < DEMO_WAVE_KEYS; key++)
+	{
+		//the near arm up and waving twice a loop, the rest of the figure breathing
+		float phase = 2.0f * PI * key / DEMO_WAVE_KEYS;
+		memset(angles, 0, sizeof(angles));
+		angles[HEAD] = 0.1f * sinf(phase);
+		angles[UPPER_ARM_FRONT] = 2.7f;
+		angles[FOREARM_FRONT] = 0.2f + 0.5f * sinf(4.0f * phase);
+		angles[UPPER_ARM_BACK] = 0.1f;
+		angles[FOREARM_BACK] = 0.2f;
+		angles[THIGH_FRONT] = 0.05f;
+		angles[THIGH_BACK] = -0.05f;
+		setPose(angles, 0.01f * cosf(phase), &waveKeys[key * DEMO_BONES]);
+	}
+
+	bool built = walkClip.build(walkKeys, DEMO_WALK_KEYS, DEMO_BONES, DEMO_FRAME_RATE, true, "walk") &&
+		waveClip.build(waveKeys, DEMO_WAVE_KEYS, DEMO_BONES, DEMO_FRAME_RATE, true, "wave");
+	free(walkKeys);
+	return built;
+}
+
+void DemoCrowd::cleanup()
+{
+	vitaPrintf("\nCleaning up after a crowd\n");
+	//the animation system hands its memory to the release queue, the GPU can still be drawing the crowd
+	animationSystem.shutdown();
+	walkClip.unload();
+	waveClip.unload();
+}
+
+void DemoCrowd::update(float dt)
+{
+	animationSystem.update(dt);
+}
+
+void DemoCrowd::draw()
+{
+	animationSystem.draw(viewProjection);
+}
+
+AnimationSystem* DemoCrowd::getAnimationSystem()
+{
+	return &animationSystem;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+//----------------------------------------------
+// DemoCrowd Class
+// Just a demo like the Triangle, to get some skinned characters on the screen until there are
+// assets to load. A stick figure skeleton, its mesh (a flat quad along every bone, seen from
+// the side) and two clips, walking and waving, are all built in code. The figures stand in a
+// grid, each blending the wave over the walk by a different amount
+//-----------------------------------------------
+
+#include "AnimationSystem.h"
+
+#define DEMO_CROWD_CHARACTERS		48
+
+class DemoCrowd
+{
+public:
+	DemoCrowd();
+	~DemoCrowd();
+
+	//Graphics and the JobSystem must be initialized
+	bool init(unsigned int characters = DEMO_CROWD_CHARACTERS);
+	void cleanup();
+	void update(float dt);
+	void draw();
+
+	AnimationSystem* getAnimationSystem();
+
+private:
+	bool buildClips();
+
+	AnimationClip walkClip;
+	AnimationClip waveClip;
+	AnimationSystem animationSystem;
+	//an orthographic view of the whole grid
+	float viewProjection[16];
+};
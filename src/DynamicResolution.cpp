@@ -0,0 +1,279 @@
+#include "DynamicResolution.h"
+#include "Graphics.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+
+//How often the timer thread looks at the notification, in microseconds. Sets the timing resolution
+#define DRS_POLL_INTERVAL			250
+#define DRS_THREAD_STACK_SIZE		(16 * 1024)
+
+//Frames measured at one size before it is reconsidered, frames in flight make anything shorter jittery
+#define DRS_SAMPLES_PER_ADJUST		4
+//Per mille of the target frame time. Over the high mark the size drops, under the low mark it grows,
+//and either way it aims for the middle so it settles instead of bouncing between two sizes
+#define DRS_BUDGET_HIGH				950
+#define DRS_BUDGET_LOW				800
+#define DRS_BUDGET_AIM				875
+//Largest change in one step, per mille of the current scale. Dropping fast avoids missed frames, growing slowly avoids overshoot
+#define DRS_MAX_STEP_DOWN			850
+#define DRS_MAX_STEP_UP				1100
+//Render sizes are kept to a multiple of this many pixels
+#define DRS_SIZE_ALIGN				8
+
+DynamicResolution::DynamicResolution()
+{
+	memset(&stats, 0, sizeof(stats));
+	displayWidth = 0;
+	displayHeight = 0;
+	minScale = 1000;
+	maxScale = 1000;
+	scale = 1000;
+
+	sceneDoneNotification_ptr = nullptr;
+	for (int i = 0; i < DRS_FRAME_HISTORY; i++)
+	{
+		_submitTimes[i] = 0;
+		_gpuTimes[i] = 0;
+	}
+	completedFrame = 0;
+	running = false;
+	timerThreadUID = -1;
+
+	lastSeenFrame = 0;
+	lastDoneTime = 0;
+
+	lastConsumedFrame = 0;
+	sizeChangeFrame = 0;
+	gpuTimeTotal = 0;
+	samplesAtSize = 0;
+}
+
+DynamicResolution::~DynamicResolution()
+{
+
+}
+
+void DynamicResolution::init(unsigned int width, unsigned int height, unsigned int minScalePercent, unsigned int maxScalePercent,
+	SceUInt64 targetFrameTime, volatile unsigned int* sceneDoneNotification)
+{
+	vitaPrintf("\nStarting dynamic resolution, %u%% to %u%% of %ux%u\n", minScalePercent, maxScalePercent, width, height);
+
+	displayWidth = width;
+	displayHeight = height;
+	minScale = minScalePercent * 10;
+	maxScale = maxScalePercent * 10;
+	stats.targetFrameTime = targetFrameTime;
+
+	sceneDoneNotification_ptr = sceneDoneNotification;
+	*sceneDoneNotification_ptr = 0;
+	completedFrame = 0;
+	lastSeenFrame = 0;
+	lastDoneTime = 0;
+	lastConsumedFrame = 0;
+
+	//start at full quality, the controller drops it as soon as the GPU falls behind
+	scale = 0;
+	resize(maxScale, 1);
+	stats.sizeChanges = 0;
+
+	//the timer thread only sleeps and reads one word, a high priority keeps its timestamps close to the GPU's
+	running = true;
+	timerThreadUID = sceKernelCreateThread("drs_gpu_timer", &DynamicResolution::timerThread, SCE_KERNEL_HIGHEST_PRIORITY_USER,
+		DRS_THREAD_STACK_SIZE, 0, SCE_KERNEL_CPU_MASK_USER_2, NULL);
+	vitaPrintf("sceKernelCreateThread() result: 0x%08X\n", timerThreadUID);
+	assert(timerThreadUID >= 0);
+
+	DynamicResolution* self = this;
+	int error = sceKernelStartThread(timerThreadUID, sizeof(self), &self);
+	vitaPrintf("sceKernelStartThread() result: 0x%08X\n", error);
+	assert(error == 0);
+}
+
+void DynamicResolution::shutdown()
+{
+	if (timerThreadUID < 0)
+		return;
+
+	running = false;
+	sceKernelWaitThreadEnd(timerThreadUID, NULL, NULL);
+	sceKernelDeleteThread(timerThreadUID);
+	timerThreadUID = -1;
+
+	logStats();
+}
+
+/*----- GPU timer thread -----*/
+
+int DynamicResolution::timerThread(SceSize args, void* argp)
+{
+	UNUSED(args);
+	//argp points at a copy of the pointer passed to sceKernelStartThread()
+	DynamicResolution* self = *(DynamicResolution**)argp;
+
+	while (self->running)
+	{
+		self->pollGpu();
+		sceKernelDelayThread(DRS_POLL_INTERVAL);
+	}
+
+	return 0;
+}
+
+void DynamicResolution::pollGpu()
+{
+	unsigned int doneFrame = *sceneDoneNotification_ptr;
+	if (doneFrame == lastSeenFrame)
+		return;
+	//read the frame before the submit time the render thread wrote ahead of it
+	__sync_synchronize();
+
+	SceUInt64 now = sceKernelGetProcessTimeWide();
+
+	//frames that finished between two polls can't be told apart, only the newest one gets a time
+	for (unsigned int frame = lastSeenFrame + 1; frame != doneFrame; frame++)
+		_gpuTimes[frame % DRS_FRAME_HISTORY] = 0;
+
+	//the GPU starts a scene once it is submitted and the one before it is done
+	SceUInt64 start = _submitTimes[doneFrame % DRS_FRAME_HISTORY];
+	if (lastDoneTime > start)
+		start = lastDoneTime;
+	_gpuTimes[doneFrame % DRS_FRAME_HISTORY] = (now > start) ? now - start : 0;
+
+	lastDoneTime = now;
+	lastSeenFrame = doneFrame;
+	//publish last, the render thread reads the times up to this frame
+	__sync_synchronize();
+	completedFrame = doneFrame;
+}
+
+/*----- Render thread -----*/
+
+void DynamicResolution::sceneSubmitted(unsigned int frameIndex)
+{
+	//the slot is reused every DRS_FRAME_HISTORY frames, and has to be written before the GPU can finish the frame
+	__sync_synchronize();
+	_submitTimes[frameIndex % DRS_FRAME_HISTORY] = sceKernelGetProcessTimeWide();
+	__sync_synchronize();
+}
+
+void DynamicResolution::update(unsigned int nextFrameIndex)
+{
+	unsigned int doneFrame = completedFrame;
+	if (doneFrame == lastConsumedFrame)
+		return;
+	//read the index before the times it publishes
+	__sync_synchronize();
+
+	//anything older than the history has already been overwritten
+	if (doneFrame - lastConsumedFrame > DRS_FRAME_HISTORY)
+		lastConsumedFrame = doneFrame - DRS_FRAME_HISTORY;
+
+	for (unsigned int frame = lastConsumedFrame + 1; frame != doneFrame + 1; frame++)
+	{
+		SceUInt64 gpuTime = _gpuTimes[frame % DRS_FRAME_HISTORY];
+		//frames rendered before the last size change say nothing about the current size
+		if (gpuTime == 0 || (int)(frame - sizeChangeFrame) < 0)
+			continue;
+
+		stats.gpuTimeLast = gpuTime;
+		stats.framesMeasured++;
+		if (gpuTime > stats.targetFrameTime)
+			stats.framesOverTarget++;
+		gpuTimeTotal += gpuTime;
+		samplesAtSize++;
+	}
+	lastConsumedFrame = doneFrame;
+
+	if (samplesAtSize < DRS_SAMPLES_PER_ADJUST)
+		return;
+
+	SceUInt64 average = gpuTimeTotal / samplesAtSize;
+	stats.gpuTimeAverage = average;
+	gpuTimeTotal = 0;
+	samplesAtSize = 0;
+
+	bool overBudget = average * 1000 > stats.targetFrameTime * DRS_BUDGET_HIGH;
+	bool underBudget = average * 1000 < stats.targetFrameTime * DRS_BUDGET_LOW;
+	if (overBudget && scale <= minScale)
+		stats.framesAtMinimum += DRS_SAMPLES_PER_ADJUST;
+	if (!(overBudget && scale > minScale) && !(underBudget && scale < maxScale))
+		return;
+
+	//GPU time follows the pixel count, which goes with the square of the scale
+	double ratio = (double)(stats.targetFrameTime * DRS_BUDGET_AIM / 1000) / (double)average;
+	unsigned int newScale = (unsigned int)(scale * sqrt(ratio));
+	if (newScale < scale * DRS_MAX_STEP_DOWN / 1000)
+		newScale = scale * DRS_MAX_STEP_DOWN / 1000;
+	if (newScale > scale * DRS_MAX_STEP_UP / 1000)
+		newScale = scale * DRS_MAX_STEP_UP / 1000;
+
+	resize(newScale, nextFrameIndex);
+}
+
+void DynamicResolution::resize(unsigned int scalePermille, unsigned int nextFrameIndex)
+{
+	if (scalePermille < minScale)
+		scalePermille = minScale;
+	if (scalePermille > maxScale)
+		scalePermille = maxScale;
+
+	unsigned int width = ALIGN_MEM(displayWidth * scalePermille / 1000, DRS_SIZE_ALIGN);
+	unsigned int height = ALIGN_MEM(displayHeight * scalePermille / 1000, DRS_SIZE_ALIGN);
+	if (width > displayWidth)
+		width = displayWidth;
+	if (height > displayHeight)
+		height = displayHeight;
+
+	scale = scalePermille;
+	if (width == stats.width && height == stats.height)
+		return;
+
+	if (stats.width != 0)
+		vitaPrintf("Dynamic resolution: %ux%u -> %ux%u (GPU %.2fms, target %.2fms)\n", stats.width, stats.height, width, height,
+			stats.gpuTimeAverage / 1000.0, stats.targetFrameTime / 1000.0);
+
+	stats.width = width;
+	stats.height = height;
+	stats.scalePercent = width * 100 / displayWidth;
+	stats.sizeChanges++;
+	sizeChangeFrame = nextFrameIndex;
+	gpuTimeTotal = 0;
+	samplesAtSize = 0;
+}
+
+void DynamicResolution::setTargetFrameTime(SceUInt64 targetFrameTime)
+{
+	stats.targetFrameTime = targetFrameTime;
+}
+
+unsigned int DynamicResolution::getWidth()
+{
+	return stats.width;
+}
+
+unsigned int DynamicResolution::getHeight()
+{
+	return stats.height;
+}
+
+/*----- Stats -----*/
+
+const DynamicResolutionStats* DynamicResolution::getStats()
+{
+	return &stats;
+}
+
+void DynamicResolution::logStats()
+{
+	vitaPrintf("\nDynamic resolution: rendering at %ux%u (%u%%), target %.2fms\n", stats.width, stats.height, stats.scalePercent,
+		stats.targetFrameTime / 1000.0);
+	vitaPrintf("GPU time last: %.2fms, average: %.2fms, %u of %u frames over target\n", stats.gpuTimeLast / 1000.0,
+		stats.gpuTimeAverage / 1000.0, stats.framesOverTarget, stats.framesMeasured);
+	vitaPrintf("%u size changes, %u frames over budget at the minimum size\n", stats.sizeChanges, stats.framesAtMinimum);
+}
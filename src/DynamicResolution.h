@@ -0,0 +1,86 @@
+#pragma once
+
+//----------------------------------------------
+// DynamicResolution Class
+// Picks the size the scene is rendered at each frame so the GPU keeps up with the
+// target frame time. A small thread watches the notification the GPU writes
+// at the end of every offscreen scene and timestamps it, the GPU time of a frame is
+// measured from when its scene could start (submitted, and the previous one done)
+// to when the GPU reported it finished. The render size follows the average GPU time,
+// scaling the pixel count by how far over or under budget the GPU is
+//-----------------------------------------------
+
+#include <psp2/types.h>
+
+//How many recent frames the timer keeps, must cover every frame that can be in flight
+#define DRS_FRAME_HISTORY			16
+
+typedef struct DynamicResolutionStats
+{
+	unsigned int width;				//current render size
+	unsigned int height;
+	unsigned int scalePercent;		//current width as a percentage of the display width
+	SceUInt64 targetFrameTime;		//microseconds the GPU has for each frame
+	SceUInt64 gpuTimeLast;			//microseconds, last frame the timer saw finish
+	SceUInt64 gpuTimeAverage;		//microseconds, frames rendered at the current size
+	unsigned int framesMeasured;
+	unsigned int framesOverTarget;
+	unsigned int sizeChanges;
+	unsigned int framesAtMinimum;
+} DynamicResolutionStats;
+
+class DynamicResolution
+{
+public:
+	DynamicResolution();
+	~DynamicResolution();
+
+	//Starts the GPU timer thread, the render size starts at the maximum scale
+	void init(unsigned int displayWidth, unsigned int displayHeight, unsigned int minScalePercent, unsigned int maxScalePercent,
+		SceUInt64 targetFrameTime, volatile unsigned int* sceneDoneNotification);
+	void shutdown();
+
+	//Render thread, call before ending the scene for frameIndex so the GPU can't finish it first
+	void sceneSubmitted(unsigned int frameIndex);
+	//Render thread, once per frame before the scene for nextFrameIndex starts. Adjusts the render size
+	void update(unsigned int nextFrameIndex);
+
+	void setTargetFrameTime(SceUInt64 targetFrameTime);
+	unsigned int getWidth();
+	unsigned int getHeight();
+
+	const DynamicResolutionStats* getStats();
+	void logStats();
+
+private:
+	static int timerThread(SceSize args, void* argp);
+	void pollGpu();
+	void resize(unsigned int scalePermille, unsigned int nextFrameIndex);
+
+	DynamicResolutionStats stats;
+	unsigned int displayWidth;
+	unsigned int displayHeight;
+	unsigned int minScale;			//per mille of the display size
+	unsigned int maxScale;
+	unsigned int scale;
+
+	/* Shared with the timer thread */
+	volatile unsigned int* sceneDoneNotification_ptr;
+	//written by the render thread before the GPU can finish the frame
+	volatile SceUInt64 _submitTimes[DRS_FRAME_HISTORY];
+	//written by the timer thread before it publishes completedFrame
+	volatile SceUInt64 _gpuTimes[DRS_FRAME_HISTORY];
+	volatile unsigned int completedFrame;
+	volatile bool running;
+	SceUID timerThreadUID;
+
+	/* Timer thread only */
+	unsigned int lastSeenFrame;
+	SceUInt64 lastDoneTime;
+
+	/* Render thread only */
+	unsigned int lastConsumedFrame;
+	unsigned int sizeChangeFrame;	//first frame rendered at the current size
+	SceUInt64 gpuTimeTotal;			//over frames rendered at the current size
+	unsigned int samplesAtSize;
+};
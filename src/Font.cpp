@@ -0,0 +1,459 @@
+#include "Font.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <psp2/sysmodule.h>
+#include <psp2/kernel/processmgr.h>
+
+//longest string drawTextf() formats
+#define FONT_FORMAT_BUFFER			512
+
+//libpgf allocates its glyph caches through these
+static void* pgfAlloc(void* userData, unsigned int size)
+{
+	UNUSED(userData);
+	return malloc(size);
+}
+
+static void pgfFree(void* userData, void* memory)
+{
+	UNUSED(userData);
+	free(memory);
+}
+
+//Reads one code point and advances text past it, malformed bytes come out as '?'
+static unsigned int decodeUtf8(const unsigned char** text)
+{
+	const unsigned char* c = *text;
+	unsigned int codePoint;
+	int length;
+	if (c[0] < 0x80)
+	{
+		codePoint = c[0];
+		length = 1;
+	}
+	else if ((c[0] & 0xE0) == 0xC0)
+	{
+		codePoint = c[0] & 0x1F;
+		length = 2;
+	}
+	else if ((c[0] & 0xF0) == 0xE0)
+	{
+		codePoint = c[0] & 0x0F;
+		length = 3;
+	}
+	else if ((c[0] & 0xF8) == 0xF0)
+	{
+		codePoint = c[0] & 0x07;
+		length = 4;
+	}
+	else
+	{
+		*text = c + 1;
+		return '?';
+	}
+
+	for (int i = 1; i < length; i++)
+	{
+		//stops at the terminator too, it is never a continuation byte
+		if ((c[i] & 0xC0) != 0x80)
+		{
+			*text = c + i;
+			return '?';
+		}
+		codePoint = (codePoint << 6) | (c[i] & 0x3F);
+	}
+	*text = c + length;
+	return codePoint;
+}
+
+Font::Font()
+{
+	memset(&stats, 0, sizeof(stats));
+	memset(&atlasTexture, 0, sizeof(atlasTexture));
+	initialized = false;
+	loaded = false;
+	loadedSize = 0.0f;
+	loadFailure = nullptr;
+	loadError = 0;
+	lineHeight = 0.0f;
+	baseline = 0.0f;
+	fontLib = nullptr;
+	fontHandle = nullptr;
+	atlas_ptr = nullptr;
+	rowX = 0;
+	rowY = 0;
+	rowHeight = 0;
+	resetPending = false;
+	lastUsedFrame = 0;
+}
+
+Font::~Font()
+{
+}
+
+bool Font::load(float size)
+{
+	if (loaded)
+		return true;
+	loadFailure = nullptr;
+	loadError = 0;
+
+	int error = sceSysmoduleLoadModule(SCE_SYSMODULE_PGF);
+	if (error != 0)
+	{
+		loadFailure = "sceSysmoduleLoadModule(SCE_SYSMODULE_PGF)";
+		loadError = error;
+		return false;
+	}
+
+	SceFontNewLibParams libParams;
+	memset(&libParams, 0, sizeof(libParams));
+	libParams.numFonts = 1;
+	libParams.allocFunc = pgfAlloc;
+	libParams.freeFunc = pgfFree;
+	unsigned int errorCode = 0;
+	fontLib = sceFontNewLib(&libParams, &errorCode);
+	if (fontLib == nullptr)
+	{
+		loadFailure = "sceFontNewLib()";
+		loadError = errorCode;
+		sceSysmoduleUnloadModule(SCE_SYSMODULE_PGF);
+		return false;
+	}
+
+	SceFontStyle style;
+	memset(&style, 0, sizeof(style));
+	style.fontFamily = SCE_FONT_FAMILY_SANS_SERIF;
+	style.fontStyle = SCE_FONT_STYLE_REGULAR;
+	style.fontLanguage = SCE_FONT_LANGUAGE_LATIN;
+	int fontIndex = sceFontFindOptimumFont(fontLib, &style, &errorCode);
+	if (fontIndex < 0)
+		fontIndex = 0;
+	fontHandle = sceFontOpen(fontLib, fontIndex, 0, &errorCode);
+	if (fontHandle == nullptr)
+	{
+		loadFailure = "sceFontOpen()";
+		loadError = errorCode;
+		sceFontDoneLib(fontLib);
+		fontLib = nullptr;
+		sceSysmoduleUnloadModule(SCE_SYSMODULE_PGF);
+		return false;
+	}
+
+	//the font is designed at fontV points, pick the resolution that makes that size pixels
+	SceFontInfo fontInfo;
+	memset(&fontInfo, 0, sizeof(fontInfo));
+	sceFontGetFontInfo(fontHandle, &fontInfo);
+	if (fontInfo.fontStyle.fontV > 0.0f)
+	{
+		float resolution = size * 72.0f / fontInfo.fontStyle.fontV;
+		sceFontSetResolution(fontLib, resolution, resolution);
+		sceFontGetFontInfo(fontHandle, &fontInfo);
+	}
+	//metrics are 26.6 fixed point
+	lineHeight = (fontInfo.maxGlyphHeightI > 0) ? fontInfo.maxGlyphHeightI / 64.0f : size;
+	baseline = (fontInfo.maxGlyphBaseYI > 0) ? fontInfo.maxGlyphBaseYI / 64.0f : size * 0.8f;
+	loadedSize = size;
+	loaded = true;
+	return true;
+}
+
+bool Font::init(float size)
+{
+	vitaPrintf("\nInitializing font, %.1f pixels high\n", size);
+	if (!load(size))
+	{
+		vitaPrintf("ERROR: %s result: 0x%08X, no text will be drawn\n", loadFailure, loadError);
+		return false;
+	}
+	if (loadedSize != size)
+		vitaPrintf("Note: the font was loaded %.1f pixels high, keeping that\n", loadedSize);
+	vitaPrintf("Font line height %.1f, baseline %.1f\n", lineHeight, baseline);
+
+	SceUID uid = -1;
+	atlas_ptr = (uint8_t*)Graphics::getInstance()->allocGraphicsMem(
+		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
+		FONT_ATLAS_SIZE * FONT_ATLAS_SIZE,
+		SCE_GXM_TEXTURE_ALIGNMENT,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		&uid,
+		"font_atlas",
+		MEMORY_CATEGORY_UI
+	);
+	atlas = GpuBuffer(atlas_ptr, uid);
+	//one channel, read as white with the texel as alpha so the batch color tints it
+	int error = sceGxmTextureInitLinear(&atlasTexture, atlas_ptr, SCE_GXM_TEXTURE_FORMAT_U8_R111, FONT_ATLAS_SIZE, FONT_ATLAS_SIZE, 0);
+	if (error != 0)
+		vitaPrintf("sceGxmTextureInitLinear() result: 0x%08X\n", error);
+	sceGxmTextureSetMinFilter(&atlasTexture, SCE_GXM_TEXTURE_FILTER_LINEAR);
+	sceGxmTextureSetMagFilter(&atlasTexture, SCE_GXM_TEXTURE_FILTER_LINEAR);
+
+	resetAtlas();
+	initialized = true;
+	return true;
+}
+
+void Font::shutdown()
+{
+	if (!initialized)
+	{
+		unload();
+		return;
+	}
+	vitaPrintf("\nShutting down font\n");
+	logStats();
+
+	_glyphs.clear();
+	atlas.reset();
+	atlas_ptr = nullptr;
+	unload();
+	initialized = false;
+}
+
+void Font::unload()
+{
+	if (!loaded)
+		return;
+
+	sceFontClose(fontHandle);
+	sceFontDoneLib(fontLib);
+	fontHandle = nullptr;
+	fontLib = nullptr;
+	sceSysmoduleUnloadModule(SCE_SYSMODULE_PGF);
+	loaded = false;
+}
+
+bool Font::isInitialized()
+{
+	return initialized;
+}
+
+void Font::resetAtlas()
+{
+	_glyphs.clear();
+	memset(atlas_ptr, 0, FONT_ATLAS_SIZE * FONT_ATLAS_SIZE);
+	for (unsigned int y = 0; y < FONT_ATLAS_WHITE_SIZE; y++)
+		memset(atlas_ptr + y * FONT_ATLAS_SIZE, 0xFF, FONT_ATLAS_WHITE_SIZE);
+
+	//the first row starts beside the white block
+	rowX = FONT_ATLAS_WHITE_SIZE + FONT_ATLAS_PADDING;
+	rowY = 0;
+	rowHeight = FONT_ATLAS_WHITE_SIZE;
+	resetPending = false;
+	stats.glyphs = 0;
+	stats.atlasRowsUsed = FONT_ATLAS_WHITE_SIZE;
+}
+
+void Font::checkReset()
+{
+	unsigned int frame = Graphics::getInstance()->getFrameIndex();
+	//never in the frame that filled it, the glyphs already drawn this frame still point at the old layout
+	if (resetPending && frame != lastUsedFrame)
+	{
+		if (FrameRing::waitForFrame(lastUsedFrame))
+			stats.atlasStalls++;
+		resetAtlas();
+		stats.atlasResets++;
+	}
+	lastUsedFrame = frame;
+}
+
+bool Font::allocate(unsigned int width, unsigned int height, unsigned int* x, unsigned int* y)
+{
+	if (width + FONT_ATLAS_PADDING > FONT_ATLAS_SIZE || height + FONT_ATLAS_PADDING > FONT_ATLAS_SIZE)
+		return false;
+
+	if (rowX + width + FONT_ATLAS_PADDING > FONT_ATLAS_SIZE)
+	{
+		rowY += rowHeight + FONT_ATLAS_PADDING;
+		rowX = 0;
+		rowHeight = 0;
+	}
+	if (rowY + height + FONT_ATLAS_PADDING > FONT_ATLAS_SIZE)
+		return false;
+
+	*x = rowX;
+	*y = rowY;
+	rowX += width + FONT_ATLAS_PADDING;
+	if (height > rowHeight)
+		rowHeight = height;
+	stats.atlasRowsUsed = rowY + rowHeight;
+	return true;
+}
+
+const FontGlyph* Font::getGlyph(unsigned int codePoint)
+{
+	std::map<unsigned int, FontGlyph>::iterator iter = _glyphs.find(codePoint);
+	if (iter != _glyphs.end())
+		return &iter->second;
+
+	SceUInt64 startTime = sceKernelGetProcessTimeWide();
+	FontGlyph glyph;
+	memset(&glyph, 0, sizeof(glyph));
+
+	SceFontCharInfo charInfo;
+	memset(&charInfo, 0, sizeof(charInfo));
+	if (sceFontGetCharInfo(fontHandle, codePoint, &charInfo) != 0)
+	{
+		//not in the font, leave a gap
+		glyph.advance = lineHeight * 0.5f;
+	}
+	else
+	{
+		glyph.width = (unsigned short)charInfo.bitmapWidth;
+		glyph.height = (unsigned short)charInfo.bitmapHeight;
+		glyph.left = (short)(int)charInfo.bitmapLeft;
+		glyph.top = (short)(int)charInfo.bitmapTop;
+		glyph.advance = charInfo.sfp26AdvanceH / 64.0f;
+
+		unsigned int x;
+		unsigned int y;
+		if (glyph.width == 0 || glyph.height == 0)
+			glyph.inAtlas = true;
+		else if (allocate(glyph.width, glyph.height, &x, &y))
+		{
+			//libpgf draws straight into the atlas
+			SceFontGlyphImage image;
+			image.pixelFormat = SCE_FONT_PIXELFORMAT_8;
+			image.xPos64 = x << 6;
+			image.yPos64 = y << 6;
+			image.bufWidth = FONT_ATLAS_SIZE;
+			image.bufHeight = FONT_ATLAS_SIZE;
+			image.bytesPerLine = FONT_ATLAS_SIZE;
+			image.pad = 0;
+			image.bufferPtr = atlas_ptr;
+			int error = sceFontGetCharGlyphImage(fontHandle, codePoint, &image);
+			if (error != 0)
+				vitaPrintf("sceFontGetCharGlyphImage() U+%04X result: 0x%08X\n", codePoint, error);
+
+			glyph.u0 = (float)x / FONT_ATLAS_SIZE;
+			glyph.v0 = (float)y / FONT_ATLAS_SIZE;
+			glyph.u1 = (float)(x + glyph.width) / FONT_ATLAS_SIZE;
+			glyph.v1 = (float)(y + glyph.height) / FONT_ATLAS_SIZE;
+			glyph.inAtlas = true;
+		}
+		else
+			resetPending = true;
+	}
+	stats.rasterizeTime += sceKernelGetProcessTimeWide() - startTime;
+	stats.glyphs++;
+
+	return &_glyphs.insert(std::make_pair(codePoint, glyph)).first->second;
+}
+
+float Font::drawText(SpriteBatch* batch, float x, float y, unsigned int color, const char* text, float scale)
+{
+	if (!initialized)
+		return 0.0f;
+	checkReset();
+
+	float penX = x;
+	float penY = y + baseline * scale;
+	float widest = 0.0f;
+	const unsigned char* c = (const unsigned char*)text;
+	while (*c != '\0')
+	{
+		unsigned int codePoint = decodeUtf8(&c);
+		if (codePoint == '\n')
+		{
+			widest = fmaxf(widest, penX - x);
+			penX = x;
+			penY += lineHeight * scale;
+			continue;
+		}
+
+		const FontGlyph* glyph = getGlyph(codePoint);
+		if (glyph->width != 0 && glyph->height != 0)
+		{
+			if (glyph->inAtlas)
+			{
+				//whole pixels keep unscaled text sharp
+				float glyphX = floorf(penX + glyph->left * scale + 0.5f);
+				float glyphY = floorf(penY - glyph->top * scale + 0.5f);
+				batch->drawSprite(&atlasTexture, glyphX, glyphY, glyph->width * scale, glyph->height * scale,
+					glyph->u0, glyph->v0, glyph->u1, glyph->v1, color);
+			}
+			else
+				stats.missingGlyphs++;
+		}
+		penX += glyph->advance * scale;
+	}
+	return fmaxf(widest, penX - x);
+}
+
+float Font::drawTextf(SpriteBatch* batch, float x, float y, unsigned int color, const char* format, ...)
+{
+	char buffer[FONT_FORMAT_BUFFER];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	return drawText(batch, x, y, color, buffer);
+}
+
+void Font::drawRect(SpriteBatch* batch, float x, float y, float width, float height, unsigned int color)
+{
+	if (!initialized)
+		return;
+	checkReset();
+
+	//the middle of the white block, filtering there only ever sees white texels
+	float white = (FONT_ATLAS_WHITE_SIZE * 0.5f) / FONT_ATLAS_SIZE;
+	batch->drawSprite(&atlasTexture, x, y, width, height, white, white, white, white, color);
+}
+
+float Font::measureText(const char* text, float scale, float* height)
+{
+	float width = 0.0f;
+	float widest = 0.0f;
+	unsigned int lines = 1;
+	if (initialized)
+	{
+		const unsigned char* c = (const unsigned char*)text;
+		while (*c != '\0')
+		{
+			unsigned int codePoint = decodeUtf8(&c);
+			if (codePoint == '\n')
+			{
+				widest = fmaxf(widest, width);
+				width = 0.0f;
+				lines++;
+				continue;
+			}
+			width += getGlyph(codePoint)->advance * scale;
+		}
+	}
+	if (height != nullptr)
+		*height = lines * lineHeight * scale;
+	return fmaxf(widest, width);
+}
+
+float Font::getLineHeight()
+{
+	return lineHeight;
+}
+
+const SceGxmTexture* Font::getTexture()
+{
+	return &atlasTexture;
+}
+
+const FontStats* Font::getStats()
+{
+	return &stats;
+}
+
+void Font::logStats()
+{
+	vitaPrintf("\nFont stats:\n");
+	vitaPrintf("\t%u glyphs cached, atlas rows reach %u of %u texels\n", stats.glyphs, stats.atlasRowsUsed, FONT_ATLAS_SIZE);
+	vitaPrintf("\t%u atlas resets (%u waited on the GPU), %u glyphs missing while it was full\n",
+		stats.atlasResets, stats.atlasStalls, stats.missingGlyphs);
+	vitaPrintf("\t%.2fms rasterizing glyphs\n", stats.rasterizeTime / 1000.0);
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+//----------------------------------------------
+// Font Class
+// Text drawn through a SpriteBatch. Glyphs are rasterized by the system fonts (libpgf)
+// the first time they are drawn and packed into rows of one 8 bit atlas texture, so
+// a string is one quad per glyph and every string in a font batches into the same draw.
+// The atlas also keeps a block of white texels, drawRect() uses it so backgrounds
+// behind text don't break the batch either.
+// When the atlas fills up it is cleared at the start of the next frame that draws,
+// once the GPU is done with the frames that sampled the old layout
+//-----------------------------------------------
+
+#include <map>
+
+#include <psp2/pgf.h>
+
+#include "SpriteBatch.h"
+
+//Default glyph height in pixels
+#define FONT_SIZE					16.0f
+//Width and height of the atlas texture in texels, 8 bits each
+#define FONT_ATLAS_SIZE				512
+//Empty texels around each glyph so filtering never picks up a neighbour
+#define FONT_ATLAS_PADDING			1
+//The white block in the top left corner of the atlas
+#define FONT_ATLAS_WHITE_SIZE		4
+
+typedef struct FontGlyph
+{
+	//atlas texture coordinates, all 0 for glyphs with no pixels (spaces)
+	float u0;
+	float v0;
+	float u1;
+	float v1;
+	unsigned short width;
+	unsigned short height;
+	short left;				//from the pen position to the bitmap's left edge
+	short top;				//from the baseline up to the bitmap's top edge
+	float advance;			//pen movement after the glyph
+	bool inAtlas;			//false when it didn't fit, it is retried after the atlas is cleared
+} FontGlyph;
+
+typedef struct FontStats
+{
+	unsigned int glyphs;					//cached, in the atlas or not
+	unsigned int atlasRowsUsed;				//texels down the atlas the rows reach
+	unsigned int atlasResets;
+	unsigned int atlasStalls;				//resets that waited on the GPU
+	unsigned int missingGlyphs;				//drawn as nothing because the atlas was full
+	SceUInt64 rasterizeTime;				//microseconds spent in libpgf
+} FontStats;
+
+class Font
+{
+public:
+	Font();
+	~Font();
+
+	//Opens the system font closest to a sans serif latin one, glyphs come out size pixels high.
+	//Doesn't touch Graphics or log, so it can run on a StartupTask while the GPU is being set up.
+	//Returns false if libpgf or the font couldn't be loaded
+	bool load(float size = FONT_SIZE);
+	//Loads the font if load() hasn't, then makes the atlas. Graphics must be initialized.
+	//Returns false if the font couldn't be loaded
+	bool init(float size = FONT_SIZE);
+	//Hands the atlas to Graphics' release queue, frames already submitted can still draw text. Also closes a font that was only loaded
+	void shutdown();
+	bool isInitialized();
+
+	/*----- Drawing, between SpriteBatch::begin() and end() -----*/
+	//UTF-8 text with its top left at x, y, '\n' starts a new line. Returns the width of the widest line
+	float drawText(SpriteBatch* batch, float x, float y, unsigned int color, const char* text, float scale = 1.0f);
+	float drawTextf(SpriteBatch* batch, float x, float y, unsigned int color, const char* format, ...);
+	//A solid rectangle out of the atlas' white block, it batches with the text
+	void drawRect(SpriteBatch* batch, float x, float y, float width, float height, unsigned int color);
+
+	//Width text would be drawn at, height gets the height of all of its lines
+	float measureText(const char* text, float scale = 1.0f, float* height = nullptr);
+	float getLineHeight();
+	const SceGxmTexture* getTexture();
+
+	const FontStats* getStats();
+	void logStats();
+
+private:
+	//Cached glyph for a code point, rasterizing it on a miss
+	const FontGlyph* getGlyph(unsigned int codePoint);
+	//Packs width x height texels into the current row or a new one, false if the atlas is full
+	bool allocate(unsigned int width, unsigned int height, unsigned int* x, unsigned int* y);
+	//Clears the atlas if it filled up in an earlier frame, and marks it used by the frame being recorded
+	void checkReset();
+	void resetAtlas();
+
+	//Closes the font and libpgf
+	void unload();
+
+	FontStats stats;
+	bool initialized;
+	bool loaded;
+	float loadedSize;
+	//what failed in load(), logged by init() as load() may not be on the render thread
+	const char* loadFailure;
+	unsigned int loadError;
+	float lineHeight;
+	float baseline;					//from the top of a line down to the baseline
+
+	SceFontLibHandle fontLib;
+	SceFontHandle fontHandle;
+
+	//the atlas texels, linear and in memory the GPU can read
+	uint8_t* atlas_ptr;
+	GpuBuffer atlas;
+	SceGxmTexture atlasTexture;
+	//shelf packer, glyphs go left to right along rows of the tallest glyph in them
+	unsigned int rowX;
+	unsigned int rowY;
+	unsigned int rowHeight;
+	bool resetPending;				//a glyph didn't fit
+	unsigned int lastUsedFrame;		//the atlas can't be rewritten until the GPU finishes this frame
+
+	std::map<unsigned int, FontGlyph> _glyphs;
+};
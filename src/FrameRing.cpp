@@ -0,0 +1,93 @@
+#include "FrameRing.h"
+#include "commonUtils.h"
+
+#include <string.h>
+
+#include <psp2/kernel/threadmgr.h>
+
+FrameRing::FrameRing()
+{
+	regionSize = 0;
+	memset(_regionFrames, 0, sizeof(_regionFrames));
+	currentFrame = 0;
+	region_ptr = nullptr;
+	stalls = 0;
+}
+
+FrameRing::~FrameRing()
+{
+}
+
+void FrameRing::init(SceSize regionSize, unsigned int alignment, const char* name, MemoryCategory category)
+{
+	this->regionSize = ALIGN_MEM(regionSize, alignment);
+
+	SceUID uid = -1;
+	void* memory = Graphics::getInstance()->allocGraphicsMem(
+		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
+		FRAME_RING_FRAMES * this->regionSize,
+		alignment,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		&uid,
+		name,
+		category
+	);
+	buffer = GpuBuffer(memory, uid);
+
+	memset(_regionFrames, 0, sizeof(_regionFrames));
+	currentFrame = 0;
+	region_ptr = (uint8_t*)memory;
+	stalls = 0;
+}
+
+void FrameRing::shutdown()
+{
+	buffer.reset();
+	region_ptr = nullptr;
+}
+
+bool FrameRing::isInitialized()
+{
+	return buffer.isValid();
+}
+
+void* FrameRing::beginFrame(unsigned int frame)
+{
+	unsigned int region = frame % FRAME_RING_FRAMES;
+	if (waitForFrame(_regionFrames[region]))
+		stalls++;
+
+	_regionFrames[region] = frame;
+	region_ptr = (uint8_t*)buffer.get() + region * regionSize;
+	currentFrame = frame;
+	return region_ptr;
+}
+
+unsigned int FrameRing::getFrame()
+{
+	return currentFrame;
+}
+
+void* FrameRing::getRegion()
+{
+	return region_ptr;
+}
+
+SceSize FrameRing::getRegionSize()
+{
+	return regionSize;
+}
+
+unsigned int FrameRing::getStalls()
+{
+	return stalls;
+}
+
+bool FrameRing::waitForFrame(unsigned int frame)
+{
+	if ((int)(Graphics::getInstance()->getCompletedFrameIndex() - frame) >= 0)
+		return false;
+	while ((int)(Graphics::getInstance()->getCompletedFrameIndex() - frame) < 0)
+		sceKernelDelayThread(FRAME_RING_STALL_WAIT);
+	return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+//----------------------------------------------
+// FrameRing Class
+// GPU memory the CPU writes again every frame, like the SpriteBatch's vertices, the particle
+// instances and UniformRing blocks. The GPU reads a frame's data while the CPU is already
+// recording the next ones, so the memory is split into one region per frame the GPU can be
+// behind: the frame being recorded plus every frame the display queue can hold. Each frame
+// writes the next region in turn, and a region is only written again once the frame done
+// notification says the GPU finished the frame that last used it. The display queue keeps
+// the CPU at most FRAME_RING_FRAMES - 1 frames ahead, so that almost never waits.
+// Render thread only, like the rest of Graphics
+//-----------------------------------------------
+
+#include "Graphics.h"
+
+//Regions, the frame being recorded plus every frame the display queue can hold
+#define FRAME_RING_FRAMES			(DISPLAY_MAX_PENDING_SWAPS + 1)
+//How long to sleep between checks while the GPU still uses a frame's memory, microseconds
+#define FRAME_RING_STALL_WAIT		100
+
+class FrameRing
+{
+public:
+	FrameRing();
+	~FrameRing();
+
+	//Allocates FRAME_RING_FRAMES regions of regionSize bytes, each starting on alignment
+	void init(SceSize regionSize, unsigned int alignment, const char* name, MemoryCategory category);
+	//Hands the memory to Graphics' release queue, frames already submitted can still read it
+	void shutdown();
+	bool isInitialized();
+
+	//Moves to frame's region and returns it, waiting if the GPU still reads it. Once a frame, when getFrame() isn't frame
+	void* beginFrame(unsigned int frame);
+	//The frame beginFrame() last moved to and its region
+	unsigned int getFrame();
+	void* getRegion();
+	SceSize getRegionSize();
+	//Frames beginFrame() had to wait for the GPU
+	unsigned int getStalls();
+
+	//Waits until the GPU has finished frame, returns whether it had to
+	static bool waitForFrame(unsigned int frame);
+
+private:
+	GpuBuffer buffer;
+	SceSize regionSize;
+	//the frame each region was last written for
+	unsigned int _regionFrames[FRAME_RING_FRAMES];
+	unsigned int currentFrame;
+	uint8_t* region_ptr;
+	unsigned int stalls;
+};
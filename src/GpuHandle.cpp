@@ -0,0 +1,7 @@
+#include "GpuHandle.h"
+#include "Graphics.h"
+
+void deferGpuRelease(GpuResourceType type, void* resource, SceUID uid)
+{
+	Graphics::getInstance()->deferRelease(type, resource, uid);
+}
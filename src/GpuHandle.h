@@ -0,0 +1,113 @@
+#pragma once
+
+//----------------------------------------------
+// GpuHandle Class
+// Owns one GPU resource: a memblock, a patched program or a render target. Handles move but
+// don't copy, so there is always exactly one owner, and when the owner lets go (destructor,
+// reset() or being moved over) the resource goes to Graphics' release queue rather than being
+// freed on the spot. The queue frees it once the GPU has finished the frame being recorded, so
+// resources can be dropped mid-game without a sceGxmFinish() and without leaking.
+// Render thread only, like the rest of Graphics
+//-----------------------------------------------
+
+#include <psp2/types.h>
+#include <psp2/gxm.h>
+
+//What a queued release frees and how, see Graphics::deferRelease()
+typedef enum GpuResourceType
+{
+	GPU_RESOURCE_MEMBLOCK = 0,			//uid, from allocGraphicsMem() or allocGraphicsMemBatch()
+	GPU_RESOURCE_VERTEX_PROGRAM,		//resource, a SceGxmVertexProgram
+	GPU_RESOURCE_FRAGMENT_PROGRAM,		//resource, a SceGxmFragmentProgram
+	GPU_RESOURCE_REGISTERED_PROGRAM,	//resource, a SceGxmShaderPatcherId. Queue the programs patched from it first
+	GPU_RESOURCE_RENDER_TARGET,			//resource, a SceGxmRenderTarget, and uid, its driver memory
+	NUMBER_OF_GPU_RESOURCE_TYPES
+} GpuResourceType;
+
+//Forwards to Graphics::deferRelease(), the handles can't include Graphics.h as it includes them
+void deferGpuRelease(GpuResourceType type, void* resource, SceUID uid);
+
+template<GpuResourceType Type, typename Resource>
+class GpuHandle
+{
+public:
+	GpuHandle()
+	{
+		resource = nullptr;
+		uid = -1;
+	}
+	//Takes ownership, uid is only used by the types that have one
+	explicit GpuHandle(Resource* resource, SceUID uid = -1)
+	{
+		this->resource = resource;
+		this->uid = uid;
+	}
+	~GpuHandle()
+	{
+		reset();
+	}
+
+	GpuHandle(GpuHandle&& other)
+	{
+		resource = other.resource;
+		uid = other.uid;
+		other.resource = nullptr;
+		other.uid = -1;
+	}
+	GpuHandle& operator=(GpuHandle&& other)
+	{
+		if (this != &other)
+		{
+			reset();
+			resource = other.resource;
+			uid = other.uid;
+			other.resource = nullptr;
+			other.uid = -1;
+		}
+		return *this;
+	}
+
+	//Queues the resource for release, the handle is empty afterwards
+	void reset()
+	{
+		if (resource != nullptr || uid >= 0)
+			deferGpuRelease(Type, (void*)resource, uid);
+		resource = nullptr;
+		uid = -1;
+	}
+	//Gives up ownership without releasing anything
+	Resource* detach()
+	{
+		Resource* detached = resource;
+		resource = nullptr;
+		uid = -1;
+		return detached;
+	}
+
+	Resource* get() const
+	{
+		return resource;
+	}
+	SceUID getUID() const
+	{
+		return uid;
+	}
+	bool isValid() const
+	{
+		return resource != nullptr || uid >= 0;
+	}
+
+private:
+	GpuHandle(const GpuHandle&) = delete;
+	GpuHandle& operator=(const GpuHandle&) = delete;
+
+	Resource* resource;
+	SceUID uid;
+};
+
+//Mapped memory from allocGraphicsMem(), get() is its base address
+typedef GpuHandle<GPU_RESOURCE_MEMBLOCK, void> GpuBuffer;
+typedef GpuHandle<GPU_RESOURCE_VERTEX_PROGRAM, SceGxmVertexProgram> GpuVertexProgram;
+typedef GpuHandle<GPU_RESOURCE_FRAGMENT_PROGRAM, SceGxmFragmentProgram> GpuFragmentProgram;
+//From createRenderTarget(), getUID() is its driver memory
+typedef GpuHandle<GPU_RESOURCE_RENDER_TARGET, SceGxmRenderTarget> GpuRenderTarget;
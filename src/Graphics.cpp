@@ -1,4 +1,6 @@
 #include "Graphics.h"
+#include "GraphicsConfig.h"
+#include "StartupTimer.h"
 #include "commonUtils.h"
 
 #include <string.h>
@@ -16,6 +18,40 @@ static void *allocPatcherMem(void *userData, SceSize size);
 //Callback which frees shader patcher memory
 static void freePatcherMem(void *userData, void *memory);
 
+//State shared with the display callback. The callback runs on an internal libgxm thread, the render
+//thread fills in a frame's entry before the GPU can finish it so the callback only ever reads settled data
+#define QUEUED_FRAME_HISTORY 8
+typedef struct QueuedFrame
+{
+	void *addr;
+	SceUInt64 inputSampleTime;
+	SceUInt64 inputEventTime;
+} QueuedFrame;
+static QueuedFrame _queuedFrames[QUEUED_FRAME_HISTORY];
+static volatile unsigned int* _frameDoneNotification = nullptr;
+//only touched by the display callback
+static unsigned int _lastFlippedFrame = 0;
+//frame counters and latency are written by the display callback, frame times by the render thread.
+//They are read without locking, the values are for reporting only
+static PresentStats _presentStats[NUMBER_OF_PRESENT_MODES];
+//display geometry the callback hands to sceDisplaySetFrameBuf(), set once at init
+static unsigned int _displayWidth = DISPLAY_WIDTH;
+static unsigned int _displayHeight = DISPLAY_HEIGHT;
+static unsigned int _displayStrideInPixels = DISPLAY_STRIDE_IN_PIXELS;
+static const char* _presentModeNames[NUMBER_OF_PRESENT_MODES] = { "vsync", "vsync half rate", "immediate", "latest frame" };
+
+//Dynamic resolution blit programs, built from src/shaders/*/blit_*.cg by the Makefile
+extern const SceGxmProgram blit_v_gxp_start;
+extern const SceGxmProgram blit_f_gxp_start;
+
+//GPU time each frame has under the configured present mode, in microseconds
+static SceUInt64 drsTargetFrameTime(const GraphicsConfig* config)
+{
+	if (config->drsTargetFrameTime != 0)
+		return config->drsTargetFrameTime;
+	return (config->present.mode == PRESENT_MODE_VSYNC_HALF) ? 33333 : 16667;
+}
+
 /*----- Initialization related functions start here -----*/
 
 Graphics::Graphics()
@@ -30,19 +66,34 @@ Graphics::Graphics()
 	//gxmRenderTargetParams = NULL;
 
 	/* Display buffers, color surfaces and sync objects */
-	for (int i = 0; i < DISPLAY_BUFFER_COUNT; i++)
+	for (int i = 0; i < DISPLAY_MAX_BUFFER_COUNT; i++)
 	{
 		_displayBuffers[i] = nullptr;
-		_displayBufferUIDs[i] = -1;
 		//GXM color surfaces and sync objects for much faster rendering
 		//_colorSurfaces[i] = NULL;
 		_displaySyncObjects[i] = nullptr;
 	}
 	
+	displayBuffersUID = -1;
+
 	/* frame buffer indexes */
 	backBufIndex = 0;
 	frontBufIndex = 0;
 
+	//all settings start at the compile time defaults
+	getDefaultGraphicsConfig(&config);
+
+	/* Presentation */
+	frameIndex = 0;
+	lastSwapTime = 0;
+	inputSampleTime = 0;
+	inputEventTime = 0;
+	frameBegun = false;
+	frameDoneNotification_ptr = nullptr;
+
+	/* Deferred release */
+	memset(releasedCounts, 0, sizeof(releasedCounts));
+
 	/* Ring buffers */
 	//TO DO: further comment the purpose/function of each of these
 	//ring buffers
@@ -51,13 +102,12 @@ Graphics::Graphics()
 	fragmentRingBuf_ptr = nullptr;
 	fragmentUsseRingBuf_ptr = nullptr;
 	vertexUsseRingBuf_ptr = nullptr;
-	vdmRingBufUID = -1;
-	vertexRingBufUID = -1;
-	fragmentRingBufUID = -1;
+	ringBufUID = -1;
 	fragmentUsseRingBufUID = -1;
 	vertexUsseRingBufUID = -1;
 	fragmentUsseRingBufOffset = 0;
 	vertexUsseRingBufOffset = 0;
+	renderTargetDriverUID = -1;
 	//depth buffer
 	depthBuf_ptr = nullptr;
 	depthBufUID = -1;
@@ -84,6 +134,19 @@ Graphics::Graphics()
 
 	_vertexPrograms.clear();
 	_fragmentPrograms.clear();
+
+	/* Dynamic resolution */
+	sceneDoneNotification_ptr = nullptr;
+	offscreenBuf_ptr = nullptr;
+	offscreenBufUID = -1;
+	blitVertexProgramID = nullptr;
+	blitFragmentProgramID = nullptr;
+	blitUvScaleParam_ptr = nullptr;
+	blitUvMaxParam_ptr = nullptr;
+	blitVertices_ptr = nullptr;
+	blitIndices_ptr = nullptr;
+	blitVerticesUID = -1;
+	blitIndicesUID = -1;
 }
 
 Graphics::~Graphics()
@@ -97,7 +160,32 @@ Graphics* Graphics::getInstance()
 	return &instance;
 }
 
-void Graphics::initGraphics()
+bool Graphics::initGraphics()
+{
+	//the defaults, with any present settings made through setPresentParams()
+	GraphicsConfig defaults;
+	getDefaultGraphicsConfig(&defaults);
+	defaults.present = config.present;
+	return initGraphics(&defaults);
+}
+
+bool Graphics::initGraphics(SceGxmInitializeParams* parameters)
+{
+	GraphicsConfig defaults;
+	getDefaultGraphicsConfig(&defaults);
+	defaults.present = config.present;
+
+	//take over what the caller set, the display queue callback has to stay ours to present frames
+	defaults.gxmInitFlags = parameters->flags;
+	defaults.parameterBufferSize = parameters->parameterBufferSize;
+	defaults.present.maxPendingSwaps = parameters->displayQueueMaxPendingCount;
+	if (parameters->displayQueueCallback != NULL && parameters->displayQueueCallback != displayBufferCallback)
+		vitaPrintf("Note: ignoring the display queue callback in SceGxmInitializeParams, Graphics presents the frames\n");
+
+	return initGraphics(&defaults);
+}
+
+bool Graphics::initGraphics(const GraphicsConfig* configuration)
 {
 	//this is set by the return values of many functions to check for success
 	int error = 0;
@@ -105,113 +193,165 @@ void Graphics::initGraphics()
 	if (initialized)
 	{
 		vitaPrintf("Graphics System is already initialized!\n");
-		return;
+		return true;
+	}
+
+	//every step below is timed, the phases are logged with the time to the first frame
+	StartupTimer* startup = StartupTimer::getInstance();
+	startup->beginPhase("initGraphics");
+
+	//Make sure everything in the configuration is usable before touching libgxm
+	startup->beginPhase("config");
+	Logger::getInstance()->setVerbose(configuration->verboseLog);
+	logGraphicsConfig(configuration);
+	if (!validateGraphicsConfig(configuration))
+	{
+		vitaPrintf("ERROR: Invalid graphics configuration, not initializing\n");
+		startup->endPhase();
+		startup->endPhase();
+		return false;
 	}
+	config = *configuration;
+	memoryTracker.init(config.memoryBudgets, config.memoryBudgetStrict);
+	_displayWidth = config.displayWidth;
+	_displayHeight = config.displayHeight;
+	_displayStrideInPixels = config.displayStrideInPixels;
+	startup->endPhase();
 
 	//Start by initializing libgxm
 	vitaPrintf("Initializing graphics system\n");
+	startup->beginPhase("sceGxmInitialize");
 	//set up the parameters
 	SceGxmInitializeParams gxmInitParams;
 	memset(&gxmInitParams, 0, sizeof(SceGxmInitializeParams));
-	gxmInitParams.flags							= 0;
-	gxmInitParams.displayQueueMaxPendingCount	= DISPLAY_MAX_PENDING_SWAPS;
+	gxmInitParams.flags							= config.gxmInitFlags;
+	gxmInitParams.displayQueueMaxPendingCount	= config.present.maxPendingSwaps;
 	gxmInitParams.displayQueueCallback			= displayBufferCallback;
 	gxmInitParams.displayQueueCallbackDataSize	= sizeof(DisplayData);
-	gxmInitParams.parameterBufferSize			= SCE_GXM_DEFAULT_PARAMETER_BUFFER_SIZE; //use default parameter buffer size (16MB)
+	gxmInitParams.parameterBufferSize			= config.parameterBufferSize; //the default is 16MB
 
 	//now try initializing with those parameters
-	vitaPrintf("Initializing SCE GXM\n");
+	vitaVerbosePrintf("Initializing SCE GXM\n");
 	error = sceGxmInitialize(&gxmInitParams);
-	vitaPrintf("sceGxmInitialize() result: 0x%08X\n", error);
+	vitaVerbosePrintf("sceGxmInitialize() result: 0x%08X\n", error);
 	assert(error == 0);
 	//{
 		//TO DO: use Logger to log the error and then close its output stream
 		//TO DO: use sceImeDialog to display the error
 	//}
 
+	//the GPU reports finished frames through the notification region, the display callback reads it
+	frameDoneNotification_ptr = sceGxmGetNotificationRegion() + NOTIFICATION_FRAME_DONE;
+	*frameDoneNotification_ptr = 0;
+	_frameDoneNotification = frameDoneNotification_ptr;
+	frameIndex = 0;
+	_lastFlippedFrame = 0;
+	resetPresentStats();
+	vitaPrintf("Present mode: %s, %u display buffers, %u max pending swaps\n",
+		_presentModeNames[config.present.mode], config.present.bufferCount, config.present.maxPendingSwaps);
+	startup->endPhase();
+
 	//----------------------------------------------------------------------------------
 	//Assuming the above was successful, now we create a libgxm context
 	//This rendering context is what allows us to render scenes on the GPU
-	//start by allocating default ringBuf memory sizes
+	//start by allocating the configured ringBuf memory sizes
 	//----------------------------------------------------------------------------------
-	vitaPrintf("Setting up ring buffers...\n");
-	//vdm
-	vitaPrintf("\nAllocating memory for the VDM ring buffer...\n");
-	vdmRingBuf_ptr = allocGraphicsMem(
+	startup->beginPhase("context");
+	vitaVerbosePrintf("Setting up ring buffers...\n");
+	//the VDM, vertex and fragment rings are mapped the same way and freed together, so they are one memblock
+	vitaVerbosePrintf("\nAllocating memory for the VDM, vertex and fragment ring buffers...\n");
+	GraphicsMemRequest ringRequests[3] = {
+		{ config.vdmRingBufferSize, 4, nullptr },
+		{ config.vertexRingBufferSize, 4, nullptr },
+		{ config.fragmentRingBufferSize, 4, nullptr }
+	};
+	allocGraphicsMemBatch(
 		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
-		SCE_GXM_DEFAULT_VDM_RING_BUFFER_SIZE,
-		4,
+		ringRequests,
+		3,
 		SCE_GXM_MEMORY_ATTRIB_READ,
-		&vdmRingBufUID
-	);
-	//vertex
-	vitaPrintf("\nAllocating memory for the vertex ring buffer...\n");
-	vertexRingBuf_ptr = allocGraphicsMem(
-		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
-		SCE_GXM_DEFAULT_VERTEX_RING_BUFFER_SIZE,
-		4,
-		SCE_GXM_MEMORY_ATTRIB_READ,
-		&vertexRingBufUID
-	);
-	//fragment
-	vitaPrintf("\nAllocating memory for the fragment ring buffer...\n");
-	fragmentRingBuf_ptr = allocGraphicsMem(
-		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
-		SCE_GXM_DEFAULT_FRAGMENT_RING_BUFFER_SIZE,
-		4,
-		SCE_GXM_MEMORY_ATTRIB_READ,
-		&fragmentRingBufUID
+		&ringBufUID,
+		"context_rings",
+		MEMORY_CATEGORY_CONTEXT
 	);
+	vdmRingBuf_ptr = ringRequests[0].memory;
+	vertexRingBuf_ptr = ringRequests[1].memory;
+	fragmentRingBuf_ptr = ringRequests[2].memory;
 	//fragment USSE
-	vitaPrintf("\nAllocating memory for the fragment USSE ring buffer...\n");
+	vitaVerbosePrintf("\nAllocating memory for the fragment USSE ring buffer...\n");
 	fragmentUsseRingBuf_ptr = allocFragmentUsseMem(
-		SCE_GXM_DEFAULT_FRAGMENT_USSE_RING_BUFFER_SIZE,
+		config.fragmentUsseRingBufferSize,
 		&fragmentUsseRingBufUID,
-		&fragmentUsseRingBufOffset
+		&fragmentUsseRingBufOffset,
+		"fragment_usse_ring",
+		MEMORY_CATEGORY_CONTEXT
 	);
 
-	vitaPrintf("\nSetting libgmx render context parameters - Using defaults\n");
+	vitaVerbosePrintf("\nSetting libgmx render context parameters\n");
 	//now we set the libgxm render context parameters
 	memset(&gxmContextParams, 0, sizeof(SceGxmContextParams));
-	gxmContextParams.hostMem						= malloc(SCE_GXM_MINIMUM_CONTEXT_HOST_MEM_SIZE);
-	gxmContextParams.hostMemSize					= SCE_GXM_MINIMUM_CONTEXT_HOST_MEM_SIZE;
+	gxmContextParams.hostMem						= malloc(config.contextHostMemSize);
+	gxmContextParams.hostMemSize					= config.contextHostMemSize;
 	gxmContextParams.vdmRingBufferMem				= vdmRingBuf_ptr;
-	gxmContextParams.vdmRingBufferMemSize			= SCE_GXM_DEFAULT_VDM_RING_BUFFER_SIZE;
+	gxmContextParams.vdmRingBufferMemSize			= config.vdmRingBufferSize;
 	gxmContextParams.vertexRingBufferMem			= vertexRingBuf_ptr;
-	gxmContextParams.vertexRingBufferMemSize		= SCE_GXM_DEFAULT_VERTEX_RING_BUFFER_SIZE;
+	gxmContextParams.vertexRingBufferMemSize		= config.vertexRingBufferSize;
 	gxmContextParams.fragmentRingBufferMem			= fragmentRingBuf_ptr;
-	gxmContextParams.fragmentRingBufferMemSize		= SCE_GXM_DEFAULT_FRAGMENT_RING_BUFFER_SIZE;
+	gxmContextParams.fragmentRingBufferMemSize		= config.fragmentRingBufferSize;
 	gxmContextParams.fragmentUsseRingBufferMem		= fragmentUsseRingBuf_ptr;
-	gxmContextParams.fragmentUsseRingBufferMemSize	= SCE_GXM_DEFAULT_FRAGMENT_USSE_RING_BUFFER_SIZE;
+	gxmContextParams.fragmentUsseRingBufferMemSize	= config.fragmentUsseRingBufferSize;
 	gxmContextParams.fragmentUsseRingBufferOffset	= fragmentUsseRingBufOffset;
+	memoryTracker.record("context_host_mem", MEMORY_CATEGORY_CONTEXT, MEMORY_POOL_HOST, -1, gxmContextParams.hostMem,
+		config.contextHostMemSize, config.contextHostMemSize, __builtin_return_address(0));
 
 	//and now we FINALLY create the gxm render context we were talking about around 50 lines up
-	vitaPrintf("Creating GXM context\n");
+	vitaVerbosePrintf("Creating GXM context\n");
 	error = sceGxmCreateContext(&gxmContextParams, &gxmContext_ptr);
-	vitaPrintf("sceGxmCreateContext() result: 0x%08X\n", error);
+	vitaVerbosePrintf("sceGxmCreateContext() result: 0x%08X\n", error);
 	assert(error == 0);
 
+	//every frame the display queue can hold, plus the one being built, keeps its slice of the rings busy
+	telemetry.init(config.vdmRingBufferSize, config.vertexRingBufferSize, config.fragmentRingBufferSize, config.parameterBufferSize,
+		config.present.maxPendingSwaps + 1, vertexRingBuf_ptr, fragmentRingBuf_ptr);
+	if (config.calibrationFrames > 0)
+		telemetry.startCalibration(config.calibrationFrames);
+	startup->endPhase();
+
 	//---------------------------------------------------------------------------------------------------
 	//Now we have to create the render target which describes the geometry of the back buffers we will 
 	//be rendering to. The render target is used purely for scheduling render jobs for given dimensions.
 	//The color surface, as well as the depth and stencil surface must be allocated seperately
 	//--------------------------------------------------------------------------------------------------
-	vitaPrintf("\nSetting render target parameters\n");
+	startup->beginPhase("render target");
+	vitaVerbosePrintf("\nSetting render target parameters\n");
 	//set up parameters
 	memset(&gxmRenderTargetParams, 0, sizeof(SceGxmRenderTargetParams));
 	gxmRenderTargetParams.flags				= 0;				//Bitwise combined flags from #SceGxmRenderTargetFlags.
-	gxmRenderTargetParams.width				= DISPLAY_WIDTH;
-	gxmRenderTargetParams.height				= DISPLAY_HEIGHT;
-	gxmRenderTargetParams.scenesPerFrame		= 1;				//The expected number of scenes per frame, in the range [1,#SCE_GXM_MAX_SCENES_PER_RENDERTARGET]
-	gxmRenderTargetParams.multisampleMode		= MSAA_MODE;		//A value from the #SceGxmMultisampleMode enum.
+	gxmRenderTargetParams.width				= config.displayWidth;
+	gxmRenderTargetParams.height				= config.displayHeight;
+	gxmRenderTargetParams.scenesPerFrame		= config.dynamicResolution ? 2 : 1;	//The expected number of scenes per frame, in the range [1,#SCE_GXM_MAX_SCENES_PER_RENDERTARGET]
+	gxmRenderTargetParams.multisampleMode		= config.msaaMode;	//A value from the #SceGxmMultisampleMode enum.
 	gxmRenderTargetParams.multisampleLocations = 0;				//If enabled in the flags, the multisample locations to use.
 	gxmRenderTargetParams.driverMemBlock		= -1;				//The uncached LPDDR memblock for the render target GPU data structures or SCE_UID_INVALID_UID to specify memory should be allocated in libgxm.
 
+	//Allocate the driver memory ourselves rather than letting libgxm do it, so it is accounted for in the budget.
+	//libgxm maps this memblock itself, so it is not mapped with sceGxmMapMemory()
+	unsigned int driverMemSize = 0;
+	error = sceGxmGetRenderTargetMemSize(&gxmRenderTargetParams, &driverMemSize);
+	vitaVerbosePrintf("sceGxmGetRenderTargetMemSize() result: 0x%08X, size: %u\n", error, driverMemSize);
+	assert(error == 0);
+	renderTargetDriverUID = sceKernelAllocMemBlock("render_target", SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, ALIGN_MEM(driverMemSize, 4 * 1024), NULL);
+	assert(renderTargetDriverUID >= 0);
+	memoryTracker.record("render_target_driver", MEMORY_CATEGORY_DISPLAY, MEMORY_POOL_LPDDR, renderTargetDriverUID, nullptr,
+		driverMemSize, ALIGN_MEM(driverMemSize, 4 * 1024), __builtin_return_address(0));
+	gxmRenderTargetParams.driverMemBlock		= renderTargetDriverUID;
+
 	//And actually create the render target
-	vitaPrintf("Creating the render target\n");
+	vitaVerbosePrintf("Creating the render target\n");
 	error = sceGxmCreateRenderTarget(&gxmRenderTargetParams, &gxmRenderTarget_ptr);
-	vitaPrintf("sceGxmCreateRenderTarget() result: 0x%08X\n", error);
+	vitaVerbosePrintf("sceGxmCreateRenderTarget() result: 0x%08X\n", error);
 	assert(error == 0);
+	startup->endPhase();
 
 	//---------------------------------------------------------------------------------------------
 	//Allocate display buffers and sync objects. Allocate back buffers in CDRAM and create a color
@@ -219,53 +359,69 @@ void Graphics::initGraphics()
 	//rendering done by the GPU, we also use SceGxmSyncObjects for each display buffer. This object
 	//is used by each scene that renders to that buffer and that buffer is queued for display flips (whether to or from)
 	//---------------------------------------------------------------------------------------------
-	vitaPrintf("\nAllocating display buffers and sync objects...\n");
+	startup->beginPhase("display buffers");
+	vitaVerbosePrintf("\nAllocating display buffers and sync objects...\n");
+	//all of the buffers come out of one CDRAM memblock, the block's 256kB alignment keeps it physically continuous
+	GraphicsMemRequest bufferRequests[DISPLAY_MAX_BUFFER_COUNT];
+	for (uint32_t i = 0; i < config.present.bufferCount; i++)
+	{
+		bufferRequests[i].size = 4 * config.displayStrideInPixels * config.displayHeight;
+		bufferRequests[i].alignment = SCE_GXM_COLOR_SURFACE_ALIGNMENT;
+		bufferRequests[i].memory = nullptr;
+	}
+	allocGraphicsMemBatch(
+		SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW,
+		bufferRequests,
+		config.present.bufferCount,
+		SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
+		&displayBuffersUID,
+		"display_buffers",
+		MEMORY_CATEGORY_DISPLAY
+	);
+
 	//allocate memory/sync objects for frame buffers
-	for (uint32_t i = 0; i < DISPLAY_BUFFER_COUNT; i++)
+	for (uint32_t i = 0; i < config.present.bufferCount; i++)
 	{
-		vitaPrintf("\nWorking on display buffer: %d\n", i);
-		//allocate large alignment (1MB) memory to ensure it's physically continuous/not broken
-		_displayBuffers[i] = allocGraphicsMem(
-			SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW,
-			//ALIGN_MEM(4 * DISPLAY_STRIDE_IN_PIXELS * DISPLAY_HEIGHT, 1 * 1024 * 1024),
-			4 * DISPLAY_STRIDE_IN_PIXELS * DISPLAY_HEIGHT,
-			SCE_GXM_COLOR_SURFACE_ALIGNMENT,
-			SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
-			&_displayBufferUIDs[i]
-		);
+		vitaVerbosePrintf("\nWorking on display buffer: %d\n", i);
+		_displayBuffers[i] = bufferRequests[i].memory;
 
-		vitaPrintf("Setting the buffer to a noticeable color\n");
-		//set the buffer to a noticeable debug color
-		for (uint32_t j = 0; j < DISPLAY_HEIGHT; j++)
+		//nothing is shown before the first frame is drawn over it, so the buffer is only filled when asked
+		if (config.debugFill)
 		{
-			uint32_t *row = (uint32_t *)_displayBuffers[i] + j * DISPLAY_STRIDE_IN_PIXELS;
-
-			for (uint32_t y = 0; y < DISPLAY_WIDTH; y++)
-				row[y] = COLOR_RED;
+			vitaVerbosePrintf("Setting the buffer to a noticeable color\n");
+			//set the buffer to a noticeable debug color
+			for (uint32_t j = 0; j < config.displayHeight; j++)
+			{
+				uint32_t *row = (uint32_t *)_displayBuffers[i] + j * config.displayStrideInPixels;
+
+				for (uint32_t y = 0; y < config.displayWidth; y++)
+					row[y] = COLOR_RED;
+			}
 		}
 
-		vitaPrintf("Initializing gxm color surface for this buffer\n");
+		vitaVerbosePrintf("Initializing gxm color surface for this buffer\n");
 		//color surface for this display buffer
 		error = sceGxmColorSurfaceInit(
 			&_colorSurfaces[i],
 			DISPLAY_COLOR_FORMAT,
 			SCE_GXM_COLOR_SURFACE_LINEAR,
-			(MSAA_MODE == SCE_GXM_MULTISAMPLE_NONE) ? SCE_GXM_COLOR_SURFACE_SCALE_NONE : SCE_GXM_COLOR_SURFACE_SCALE_MSAA_DOWNSCALE,
+			(config.msaaMode == SCE_GXM_MULTISAMPLE_NONE) ? SCE_GXM_COLOR_SURFACE_SCALE_NONE : SCE_GXM_COLOR_SURFACE_SCALE_MSAA_DOWNSCALE,
 			SCE_GXM_OUTPUT_REGISTER_SIZE_32BIT,
-			DISPLAY_WIDTH,
-			DISPLAY_HEIGHT,
-			DISPLAY_STRIDE_IN_PIXELS,
+			config.displayWidth,
+			config.displayHeight,
+			config.displayStrideInPixels,
 			_displayBuffers[i]
 		);
-		vitaPrintf("sceGxmColorSurfaceInit() result: 0x%08X\n", error);
+		vitaVerbosePrintf("sceGxmColorSurfaceInit() result: 0x%08X\n", error);
 		assert(error == 0);
 
 		//create a sync object to be associated with this buffer
-		vitaPrintf("Creating a sync object for this buffer\n");
+		vitaVerbosePrintf("Creating a sync object for this buffer\n");
 		error = sceGxmSyncObjectCreate(&_displaySyncObjects[i]);
-		vitaPrintf("sceGxmSyncObjectCreate() result: 0x%08X\n", error);
+		vitaVerbosePrintf("sceGxmSyncObjectCreate() result: 0x%08X\n", error);
 		assert(error == 0);
 	}
+	startup->endPhase();
 
 	//---------------------------------------------------------------------------------------------
 	//Next step is allocating a depth buffer. This application renders strictly in a back-to-front
@@ -273,40 +429,43 @@ void Graphics::initGraphics()
 	//required to handle partial renders. This depth buffer will be created without enabling force load
 	//or store, so it will not actually be read or written by the GPU and will have zero impact on perfomance
 	//----------------------------------------------------------------------------------------------
+	startup->beginPhase("depth buffer");
 
 	//for antialiasing
-	const uint32_t alignedWidth = ALIGN_MEM(DISPLAY_WIDTH, SCE_GXM_TILE_SIZEX);
-	const uint32_t alignedHeight = ALIGN_MEM(DISPLAY_HEIGHT, SCE_GXM_TILE_SIZEY);
+	const uint32_t alignedWidth = ALIGN_MEM(config.displayWidth, SCE_GXM_TILE_SIZEX);
+	const uint32_t alignedHeight = ALIGN_MEM(config.displayHeight, SCE_GXM_TILE_SIZEY);
 	uint32_t sampleCount = alignedWidth * alignedHeight;
 	uint32_t depthStrideInSamples = alignedWidth;
-	if (MSAA_MODE == SCE_GXM_MULTISAMPLE_4X)
+	if (config.msaaMode == SCE_GXM_MULTISAMPLE_4X)
 	{
-		vitaPrintf("\nSetting up 4x antialiasing\n");
+		vitaVerbosePrintf("\nSetting up 4x antialiasing\n");
 		//increase samples across x and y
 		sampleCount *= 4;
 		depthStrideInSamples *= 2;
 	}
-	else if (MSAA_MODE == SCE_GXM_MULTISAMPLE_2X)
+	else if (config.msaaMode == SCE_GXM_MULTISAMPLE_2X)
 	{
-		vitaPrintf("\nSetting up 2x antialiasing\n");
+		vitaVerbosePrintf("\nSetting up 2x antialiasing\n");
 		//increase samples across Y only
 		sampleCount *= 2;
 	}
 	else
-		vitaPrintf("\nNot using antialiasing\n");
+		vitaVerbosePrintf("\nNot using antialiasing\n");
 
 	//allocate depth buffer memory
-	vitaPrintf("\nCreating the depth-buffer\n");
+	vitaVerbosePrintf("\nCreating the depth-buffer\n");
 	depthBuf_ptr = allocGraphicsMem(
 		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
 		sampleCount * 4,
 		SCE_GXM_DEPTHSTENCIL_SURFACE_ALIGNMENT,
 		SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
-		&depthBufUID
+		&depthBufUID,
+		"depth_buffer",
+		MEMORY_CATEGORY_DISPLAY
 	);
 
 	//set the depth stencil structure
-	vitaPrintf("Initializing depth stencil surface\n");
+	vitaVerbosePrintf("Initializing depth stencil surface\n");
 	error = sceGxmDepthStencilSurfaceInit(
 		&depthStencilSurface,
 		SCE_GXM_DEPTH_STENCIL_FORMAT_S8D24,
@@ -315,23 +474,41 @@ void Graphics::initGraphics()
 		depthBuf_ptr,
 		NULL
 	);
-	vitaPrintf("sceGxmDepthStencilSurfaceInit() result: 0x%08X\n", error);
+	vitaVerbosePrintf("sceGxmDepthStencilSurfaceInit() result: 0x%08X\n", error);
 	assert(error == 0);
+	startup->endPhase();
 
 	//Initialize the shader patcher in its own function
 	//This keeps the code cleaner/easier to read and it also allows the seperate
 	//initialization of the patcher using different patcher sizes without clogging up the
 	//Graphics::init() parameters
 	//we want to use shaders, so init the patcher
-	initShaderPatcher(&defaultPatcher);
+	startup->beginPhase("shader patcher");
+	initShaderPatcher(&config.patcher);
+	startup->endPhase();
 
-	initialized = true;
-}
+	//the offscreen target and its blit need the patcher
+	if (config.dynamicResolution)
+	{
+		startup->beginPhase("dynamic resolution");
+		initDynamicResolution();
+		startup->endPhase();
+	}
 
-//TO DO:
-void Graphics::initGraphics(SceGxmInitializeParams* parameters)
-{
+	//textures sampled by a frame stay resident until the GPU reports that frame done
+	if (config.textureCacheSize > 0)
+	{
+		startup->beginPhase("texture cache");
+		textureCache.init(config.textureCacheSize, frameDoneNotification_ptr);
+		startup->endPhase();
+	}
 
+	initialized = true;
+
+	//show where all of the memory went
+	logMemoryBudget();
+	startup->endPhase();
+	return true;
 }
 
 void Graphics::initShaderPatcher(PatcherSizes* sizes)
@@ -349,35 +526,41 @@ void Graphics::initShaderPatcher(PatcherSizes* sizes)
 	//programs should only be registered with the shader patcher once if possible. This is where
 	//we do that
 	//------------------------------------------------------------------------------------------
-	vitaPrintf("\nSetting up shader patcher\n");
+	vitaVerbosePrintf("\nSetting up shader patcher\n");
 	//allocate memory for buffers and USSE code
-	vitaPrintf("\nAllocating memory for the shader patcher buffer\n");
+	vitaVerbosePrintf("\nAllocating memory for the shader patcher buffer\n");
 	patcherBuf_ptr = allocGraphicsMem(
 		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
 		sizes->patchBufferSize,
 		4,
 		SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
-		&patcherBufUID
+		&patcherBufUID,
+		"patcher_buffer",
+		MEMORY_CATEGORY_SHADERS
 	);
 
-	vitaPrintf("\nAllocating memory for patcher's vertex USSE programs\n");
+	vitaVerbosePrintf("\nAllocating memory for patcher's vertex USSE programs\n");
 	patcherVertexUsse_ptr = allocVertexUsseMem(
 		sizes->patchVertexUsseSize,
 		&patcherVertexUsseUID,
-		&patcherVertexUsseOffset
+		&patcherVertexUsseOffset,
+		"patcher_vertex_usse"
 	);
 
-	vitaPrintf("\nAllocating memory for patcher's fragment USSE programs\n");
+	vitaVerbosePrintf("\nAllocating memory for patcher's fragment USSE programs\n");
 	patcherFragmentUsse_ptr = allocFragmentUsseMem(
 		sizes->patchFragmentUsseSize,
 		&patcherFragmentUsseUID,
-		&patcherFragmentUsseOffset
+		&patcherFragmentUsseOffset,
+		"patcher_fragment_usse"
 	);
 
-	vitaPrintf("\nSetting shader patcher parameters\n");
+	vitaVerbosePrintf("\nSetting shader patcher parameters\n");
 	//create a shader patcher
 	memset(&patcherParams, 0, sizeof(SceGxmShaderPatcherParams));
-	patcherParams.userData = NULL;
+	//the patcher's internal allocations come out of size class pools rather than the heap
+	patcherHostPool.init("patcher_host_pool", MEMORY_CATEGORY_SHADERS, &memoryTracker);
+	patcherParams.userData = &patcherHostPool;
 	patcherParams.hostAllocCallback = &allocPatcherMem;
 	patcherParams.hostFreeCallback = &freePatcherMem;
 	patcherParams.bufferAllocCallback = NULL;
@@ -395,10 +578,138 @@ void Graphics::initShaderPatcher(PatcherSizes* sizes)
 	patcherParams.fragmentUsseMemSize = sizes->patchFragmentUsseSize;
 	patcherParams.fragmentUsseOffset = patcherFragmentUsseOffset;
 
-	vitaPrintf("\nCreating the shader patcher\n");
+	//programs can be patched on the ProgramCache's thread as well, see patcherPatchVertexProgram()
+	sceKernelCreateLwMutex(&patcherLock, "shader_patcher", SCE_KERNEL_MUTEX_ATTR_RECURSIVE, 0, NULL);
+
+	vitaVerbosePrintf("\nCreating the shader patcher\n");
 	int error = sceGxmShaderPatcherCreate(&patcherParams, &patcher_ptr);
-	vitaPrintf("sceGxmShaderPatcherCreate() result: 0x%08X\n", error);
+	vitaVerbosePrintf("sceGxmShaderPatcherCreate() result: 0x%08X\n", error);
+	assert(error == 0);
+}
+
+void Graphics::initDynamicResolution()
+{
+	int error = 0;
+	//--------------------------------------------------------------------------------------------
+	//With dynamic resolution the scene is rendered into the top left corner of a display sized
+	//offscreen buffer, the rest of the buffer is left alone. Only the tiles covering the current
+	//size are processed, which is where the GPU time is saved. A second scene then samples that
+	//corner as a texture and stretches it over the whole back buffer
+	//--------------------------------------------------------------------------------------------
+	vitaPrintf("\nSetting up dynamic resolution\n");
+
+	//linear textures have a stride of the width rounded up to 8 texels, the color surface has to match it
+	const unsigned int offscreenStride = ALIGN_MEM(config.displayWidth, 8);
+	offscreenBuf_ptr = allocGraphicsMem(
+		SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW,
+		4 * offscreenStride * config.displayHeight,
+		SCE_GXM_TEXTURE_ALIGNMENT,
+		SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
+		&offscreenBufUID,
+		"drs_offscreen",
+		MEMORY_CATEGORY_DISPLAY
+	);
+
+	error = sceGxmColorSurfaceInit(
+		&offscreenSurface,
+		DISPLAY_COLOR_FORMAT,
+		SCE_GXM_COLOR_SURFACE_LINEAR,
+		(config.msaaMode == SCE_GXM_MULTISAMPLE_NONE) ? SCE_GXM_COLOR_SURFACE_SCALE_NONE : SCE_GXM_COLOR_SURFACE_SCALE_MSAA_DOWNSCALE,
+		SCE_GXM_OUTPUT_REGISTER_SIZE_32BIT,
+		config.displayWidth,
+		config.displayHeight,
+		offscreenStride,
+		offscreenBuf_ptr
+	);
+	vitaVerbosePrintf("sceGxmColorSurfaceInit() result: 0x%08X\n", error);
 	assert(error == 0);
+
+	error = sceGxmTextureInitLinear(&offscreenTexture, offscreenBuf_ptr, SCE_GXM_TEXTURE_FORMAT_A8B8G8R8, config.displayWidth, config.displayHeight, 0);
+	vitaVerbosePrintf("sceGxmTextureInitLinear() result: 0x%08X\n", error);
+	assert(error == 0);
+	sceGxmTextureSetMinFilter(&offscreenTexture, SCE_GXM_TEXTURE_FILTER_LINEAR);
+	sceGxmTextureSetMagFilter(&offscreenTexture, SCE_GXM_TEXTURE_FILTER_LINEAR);
+	sceGxmTextureSetUAddrMode(&offscreenTexture, SCE_GXM_TEXTURE_ADDR_CLAMP);
+	sceGxmTextureSetVAddrMode(&offscreenTexture, SCE_GXM_TEXTURE_ADDR_CLAMP);
+
+	//the blit is a single triangle covering the screen, the same shape the clear shaders use
+	blitVertices_ptr = (ClearVertex*)allocGraphicsMem(
+		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
+		3 * sizeof(ClearVertex),
+		4,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		&blitVerticesUID,
+		"blit_vertices",
+		MEMORY_CATEGORY_DISPLAY
+	);
+	blitIndices_ptr = (uint16_t*)allocGraphicsMem(
+		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
+		3 * sizeof(uint16_t),
+		2,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		&blitIndicesUID,
+		"blit_indices",
+		MEMORY_CATEGORY_DISPLAY
+	);
+	memset(blitVertices_ptr, 0, 3 * sizeof(ClearVertex));
+	blitVertices_ptr[0].x = -1.0f;
+	blitVertices_ptr[0].y = -1.0f;
+	blitVertices_ptr[1].x = 3.0f;
+	blitVertices_ptr[1].y = -1.0f;
+	blitVertices_ptr[2].x = -1.0f;
+	blitVertices_ptr[2].y = 3.0f;
+	blitIndices_ptr[0] = 0;
+	blitIndices_ptr[1] = 1;
+	blitIndices_ptr[2] = 2;
+
+	//blit programs
+	blitVertexProgramID = patcherRegisterProgram(&blit_v_gxp_start);
+	blitFragmentProgramID = patcherRegisterProgram(&blit_f_gxp_start);
+
+	SceGxmVertexAttribute blitVertexAttribs[1];
+	blitVertexAttribs[0].streamIndex = 0;
+	blitVertexAttribs[0].offset = 0;
+	blitVertexAttribs[0].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	blitVertexAttribs[0].componentCount = 2;
+
+	patcherSetProgramCreationParams(GXM_CLEAR_INDEX_16BIT);
+	blitVertexProgram = patcherCreateVertexProgram(blitVertexProgramID, blitVertexAttribs, 1, "aPosition");
+	blitFragmentProgram = patcherCreateFragmentProgram(blitFragmentProgramID, blitVertexProgramID);
+
+	blitUvScaleParam_ptr = sceGxmProgramFindParameterByName(&blit_v_gxp_start, "uvScale");
+	assert(blitUvScaleParam_ptr && (sceGxmProgramParameterGetCategory(blitUvScaleParam_ptr) == SCE_GXM_PARAMETER_CATEGORY_UNIFORM));
+	blitUvMaxParam_ptr = sceGxmProgramFindParameterByName(&blit_f_gxp_start, "uvMax");
+	assert(blitUvMaxParam_ptr && (sceGxmProgramParameterGetCategory(blitUvMaxParam_ptr) == SCE_GXM_PARAMETER_CATEGORY_UNIFORM));
+
+	//the GPU reports each finished offscreen scene here, the timer thread measures it
+	sceneDoneNotification_ptr = sceGxmGetNotificationRegion() + NOTIFICATION_SCENE_DONE;
+	dynamicResolution.init(config.displayWidth, config.displayHeight, config.drsMinScale, config.drsMaxScale,
+		drsTargetFrameTime(&config), sceneDoneNotification_ptr);
+}
+
+void Graphics::shutdownDynamicResolution()
+{
+	vitaPrintf("\nShutting down dynamic resolution\n");
+	dynamicResolution.shutdown();
+
+	//queued, shutdownGraphics() releases everything queued straight after
+	blitFragmentProgram.reset();
+	blitVertexProgram.reset();
+	deferRelease(GPU_RESOURCE_REGISTERED_PROGRAM, blitFragmentProgramID);
+	deferRelease(GPU_RESOURCE_REGISTERED_PROGRAM, blitVertexProgramID);
+	blitFragmentProgramID = nullptr;
+	blitVertexProgramID = nullptr;
+	freeGraphicsMem(blitIndicesUID);
+	freeGraphicsMem(blitVerticesUID);
+	freeGraphicsMem(offscreenBufUID);
+	blitIndices_ptr = nullptr;
+	blitVertices_ptr = nullptr;
+	offscreenBuf_ptr = nullptr;
+}
+
+const GraphicsConfig* Graphics::getConfig()
+{
+	return &config;
 }
 
 /*----- Initialization functions end here -----*/
@@ -419,50 +730,128 @@ void Graphics::shutdownGraphics()
 	error = sceGxmDisplayQueueFinish();
 	assert(error == 0);
 
+	textureCache.shutdown();
+	if (config.dynamicResolution)
+		shutdownDynamicResolution();
+	//the GPU is idle, whatever is still queued for release can go. Programs go before the patcher does
+	processReleases(true);
+	vitaPrintf("Deferred releases: %u memblocks, %u vertex programs, %u fragment programs, %u registered programs, %u render targets\n",
+		releasedCounts[GPU_RESOURCE_MEMBLOCK], releasedCounts[GPU_RESOURCE_VERTEX_PROGRAM], releasedCounts[GPU_RESOURCE_FRAGMENT_PROGRAM],
+		releasedCounts[GPU_RESOURCE_REGISTERED_PROGRAM], releasedCounts[GPU_RESOURCE_RENDER_TARGET]);
+
 	//clean up display queue
 	freeGraphicsMem(depthBufUID);
-	for (uint32_t i = 0; i < DISPLAY_BUFFER_COUNT; i++)
+	for (uint32_t i = 0; i < config.present.bufferCount; i++)
 	{
-		//clear buffer and deallocate
-		memset(_displayBuffers[i], 0, DISPLAY_HEIGHT * DISPLAY_STRIDE_IN_PIXELS * 4);
-		freeGraphicsMem(_displayBufferUIDs[i]);
+		//clear buffer
+		memset(_displayBuffers[i], 0, config.displayHeight * config.displayStrideInPixels * 4);
+		_displayBuffers[i] = nullptr;
 
 		//destroy sync object
 		sceGxmSyncObjectDestroy(_displaySyncObjects[i]);
 	}
+	freeGraphicsMem(displayBuffersUID);
+	displayBuffersUID = -1;
 
 	//destroy shader patcher
 	vitaPrintf("\nCleaning up shader patcher\n");
 	//PROGRAMS MUST BE UNREGISTERED FIRST
 	patcherUnregisterPrograms();
 	sceGxmShaderPatcherDestroy(patcher_ptr);
-	freeFragmentUsseMem(patcherFragmentUsseUID);
-	freeVertexUsseMem(patcherVertexUsseUID);    //TO DO: This needs done, there's something wrong with it which makes the app crash on exit
-	freeGraphicsMem(patcherBufUID);
+	patcher_ptr = nullptr;
+	sceKernelDeleteLwMutex(&patcherLock);
+	patcherHostPool.logStats();
+	patcherHostPool.shutdown();
 
 	// destroy the render target
 	vitaPrintf("Destroying the render target\n");
 	sceGxmDestroyRenderTarget(gxmRenderTarget_ptr);
+	sceKernelFreeMemBlock(renderTargetDriverUID);
+	memoryTracker.remove(renderTargetDriverUID);
+	renderTargetDriverUID = -1;
 
 	// destroy the context and ring buffers
 	vitaPrintf("Destroying the gxm context\n");
 	sceGxmDestroyContext(gxmContext_ptr);
 	freeFragmentUsseMem(fragmentUsseRingBufUID);
-	freeGraphicsMem(fragmentRingBufUID);
-	freeGraphicsMem(vertexRingBufUID);
-	freeGraphicsMem(vdmRingBufUID);
+	freeGraphicsMem(ringBufUID);
+	ringBufUID = -1;
+	memoryTracker.removeHost(gxmContextParams.hostMem);
 	free(gxmContextParams.hostMem);
 
+	//The context points at the USSE code of the last programs it had bound until it is destroyed,
+	//unmapping the patcher's USSE memory before that is what crashed on exit
+	freeFragmentUsseMem(patcherFragmentUsseUID);
+	freeVertexUsseMem(patcherVertexUsseUID);
+	freeGraphicsMem(patcherBufUID);
+
 	// terminate libgxm
 	vitaPrintf("Terminating the GXM\n");
 	sceGxmTerminate();
+
+	logPresentStats();
+	telemetry.logStats();
+	//everything Graphics allocated is gone by now, anything left belongs to something that wasn't cleaned up
+	memoryTracker.logLeaks();
+	initialized = false;
 }
 
 /*----- The shutdown function ends here -----*/
  /*----- Drawing functions start here -----*/
 
+void Graphics::finish()
+{
+	sceGxmFinish(gxmContext_ptr);
+}
+
+void Graphics::beginFrame()
+{
+	if (frameBegun)
+		return;
+	frameBegun = true;
+
+	if (textureCache.isInitialized())
+		textureCache.beginFrame(frameIndex + 1);
+	commandCapture.beginFrame();
+	processReleases(false);
+}
+
 void Graphics::startScene()
 {
+	beginFrame();
+
+	if (config.dynamicResolution)
+	{
+		//pick this frame's size from the GPU times measured so far
+		dynamicResolution.update(frameIndex + 1);
+		unsigned int width = dynamicResolution.getWidth();
+		unsigned int height = dynamicResolution.getHeight();
+
+		//tiles outside the valid region are never processed
+		SceGxmValidRegion validRegion;
+		validRegion.xMin = 0;
+		validRegion.yMin = 0;
+		validRegion.xMax = width - 1;
+		validRegion.yMax = height - 1;
+
+		//the offscreen buffer is only read by this frame's blit, which the GPU orders after it
+		sceGxmBeginScene(
+			gxmContext_ptr,
+			0,
+			gxmRenderTarget_ptr,
+			&validRegion,
+			NULL,
+			NULL,
+			&offscreenSurface,
+			&depthStencilSurface
+		);
+		setRenderRegion(width, height);
+		telemetry.beginScene();
+		if (commandCapture.isRecording())
+			commandCapture.beginScene(false, config.displayWidth, config.displayHeight);
+		return;
+	}
+
 	sceGxmBeginScene(
 		gxmContext_ptr,
 		0,
@@ -473,62 +862,473 @@ void Graphics::startScene()
 		&_colorSurfaces[backBufIndex],
 		&depthStencilSurface
 	);
+	telemetry.beginScene();
+	if (commandCapture.isRecording())
+		commandCapture.beginScene(false, config.displayWidth, config.displayHeight);
 }
 
 void Graphics::endScene()
 {
-	sceGxmEndScene(gxmContext_ptr, NULL, NULL);
+	if (commandCapture.isRecording())
+		commandCapture.endScene(false);
+
+	//record where this frame lives before the GPU can possibly finish it, the display callback
+	//looks it up by index when it skips ahead to the newest finished frame
+	frameIndex++;
+	frameBegun = false;
+	_queuedFrames[frameIndex % QUEUED_FRAME_HISTORY].addr = _displayBuffers[backBufIndex];
+	_queuedFrames[frameIndex % QUEUED_FRAME_HISTORY].inputSampleTime = inputSampleTime;
+	_queuedFrames[frameIndex % QUEUED_FRAME_HISTORY].inputEventTime = inputEventTime;
+
+	if (config.dynamicResolution)
+	{
+		//the timer thread measures the offscreen scene from here to the GPU writing its notification
+		SceGxmNotification sceneDone;
+		sceneDone.address = sceneDoneNotification_ptr;
+		sceneDone.value = frameIndex;
+		dynamicResolution.sceneSubmitted(frameIndex);
+		sceGxmEndScene(gxmContext_ptr, NULL, &sceneDone);
+		telemetry.endScene();
+
+		blitScaledScene();
+	}
+
+	//have the GPU write the frame index to the notification region once fragment processing is done
+	SceGxmNotification frameDone;
+	frameDone.address = frameDoneNotification_ptr;
+	frameDone.value = frameIndex;
+	sceGxmEndScene(gxmContext_ptr, NULL, &frameDone);
+	telemetry.endScene();
 
 	//PA heartbeat to notify end of frame
 	sceGxmPadHeartbeat(&_colorSurfaces[backBufIndex], _displaySyncObjects[backBufIndex]);
+}
+
+void Graphics::blitScaledScene()
+{
+	//a replay does its own blit at its own resolution
+	commandCapture.setSuspended(true);
+	sceGxmBeginScene(
+		gxmContext_ptr,
+		0,
+		gxmRenderTarget_ptr,
+		NULL,
+		NULL,
+		_displaySyncObjects[backBufIndex],
+		&_colorSurfaces[backBufIndex],
+		&depthStencilSurface
+	);
+	telemetry.beginScene();
+	setRenderRegion(config.displayWidth, config.displayHeight);
+
+	//the rendered corner is width x height texels of the display sized texture. Filtering at its far
+	//edges would pull in texels outside it, so the fragment shader clamps to the last texel centers
+	float width = (float)dynamicResolution.getWidth();
+	float height = (float)dynamicResolution.getHeight();
+	float uvScale[2] = { width / config.displayWidth, height / config.displayHeight };
+	float uvMax[2] = { (width - 0.5f) / config.displayWidth, (height - 0.5f) / config.displayHeight };
+
+	patcherSetVertexProgram(blitVertexProgram.get());
+	patcherSetFragmentProgram(blitFragmentProgram.get());
+	sceGxmSetFragmentTexture(gxmContext_ptr, 0, &offscreenTexture);
+	patcherSetVertexProgramConstants(NULL, blitUvScaleParam_ptr, 0, 2, uvScale);
+	patcherSetFragmentProgramConstants(blitUvMaxParam_ptr, 0, 2, uvMax);
+
+	patcherSetVertexStream(0, blitVertices_ptr);
+	draw(SCE_GXM_PRIMITIVE_TRIANGLES, SCE_GXM_INDEX_FORMAT_U16, blitIndices_ptr, 3);
+	commandCapture.setSuspended(false);
+}
+
+/*----- Offscreen scenes -----*/
+
+GpuRenderTarget Graphics::createRenderTarget(unsigned int width, unsigned int height, unsigned int scenesPerFrame,
+	SceGxmMultisampleMode msaaMode, const char* name)
+{
+	int error = 0;
+	UNUSED(error);
+
+	vitaPrintf("\nCreating a %ux%u render target for %u scenes a frame\n", width, height, scenesPerFrame);
+	SceGxmRenderTargetParams params;
+	memset(&params, 0, sizeof(SceGxmRenderTargetParams));
+	params.flags = 0;
+	params.width = width;
+	params.height = height;
+	params.scenesPerFrame = scenesPerFrame;
+	params.multisampleMode = msaaMode;
+	params.multisampleLocations = 0;
+
+	//the driver memory is ours for the same reason the display render target's is, see initGraphics()
+	unsigned int driverMemSize = 0;
+	error = sceGxmGetRenderTargetMemSize(&params, &driverMemSize);
+	vitaVerbosePrintf("sceGxmGetRenderTargetMemSize() result: 0x%08X, size: %u\n", error, driverMemSize);
+	assert(error == 0);
+	SceUID driverUID = sceKernelAllocMemBlock(name, SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, ALIGN_MEM(driverMemSize, 4 * 1024), NULL);
+	assert(driverUID >= 0);
+	memoryTracker.record(name, MEMORY_CATEGORY_DISPLAY, MEMORY_POOL_LPDDR, driverUID, nullptr,
+		driverMemSize, ALIGN_MEM(driverMemSize, 4 * 1024), __builtin_return_address(0));
+	params.driverMemBlock = driverUID;
+
+	SceGxmRenderTarget* renderTarget = nullptr;
+	error = sceGxmCreateRenderTarget(&params, &renderTarget);
+	vitaVerbosePrintf("sceGxmCreateRenderTarget() result: 0x%08X\n", error);
+	assert(error == 0);
+	return GpuRenderTarget(renderTarget, driverUID);
+}
+
+void Graphics::destroyRenderTarget(SceGxmRenderTarget* renderTarget, SceUID driverUID)
+{
+	sceGxmDestroyRenderTarget(renderTarget);
+	if (memoryTracker.remove(driverUID))
+		sceKernelFreeMemBlock(driverUID);
+}
+
+/*----- Deferred release -----*/
+
+void Graphics::deferRelease(GpuResourceType type, void* resource, SceUID uid)
+{
+	assert(type < NUMBER_OF_GPU_RESOURCE_TYPES);
+	//the frame being recorded is the last one that can have drawn with it, the GPU finishes frames in order
+	PendingRelease pending = { type, resource, uid, frameIndex + 1 };
+	_pendingReleases.push_back(pending);
+}
+
+unsigned int Graphics::getPendingReleaseCount()
+{
+	return (unsigned int)_pendingReleases.size();
+}
+
+void Graphics::processReleases(bool all)
+{
+	unsigned int completed = getCompletedFrameIndex();
+	size_t released = 0;
+	while (released < _pendingReleases.size() && (all || (int)(completed - _pendingReleases[released].frame) >= 0))
+		release(&_pendingReleases[released++]);
+	if (released > 0)
+		_pendingReleases.erase(_pendingReleases.begin(), _pendingReleases.begin() + released);
+}
+
+void Graphics::release(const PendingRelease* pending)
+{
+	vitaVerbosePrintf("Releasing a deferred resource, type %d, %p, SceUID %d, frame %u\n",
+		pending->type, pending->resource, pending->uid, pending->frame);
+	switch (pending->type)
+	{
+		case GPU_RESOURCE_MEMBLOCK:
+			freeGraphicsMem(pending->uid);
+			break;
+		case GPU_RESOURCE_VERTEX_PROGRAM:
+			patcherReleaseVertexProgram((SceGxmVertexProgram*)pending->resource);
+			break;
+		case GPU_RESOURCE_FRAGMENT_PROGRAM:
+			patcherReleaseFragmentProgram((SceGxmFragmentProgram*)pending->resource);
+			break;
+		case GPU_RESOURCE_REGISTERED_PROGRAM:
+			patcherUnregisterProgram((SceGxmShaderPatcherId)pending->resource);
+			break;
+		case GPU_RESOURCE_RENDER_TARGET:
+			destroyRenderTarget((SceGxmRenderTarget*)pending->resource, pending->uid);
+			break;
+		default:
+			break;
+	}
+	releasedCounts[pending->type]++;
+}
+
+void Graphics::beginOffscreenScene(const SceGxmRenderTarget* renderTarget, const SceGxmColorSurface* color,
+	const SceGxmDepthStencilSurface* depthStencil, unsigned int width, unsigned int height)
+{
+	beginFrame();
+
+	//nothing is displayed from these, so there are no sync objects to wait on or signal
+	sceGxmBeginScene(
+		gxmContext_ptr,
+		0,
+		renderTarget,
+		NULL,
+		NULL,
+		NULL,
+		color,
+		depthStencil
+	);
+	telemetry.beginScene();
+	setRenderRegion(width, height);
+	if (commandCapture.isRecording())
+		commandCapture.beginScene(true, width, height);
+}
 
-	swapBuffers();
+void Graphics::endOffscreenScene()
+{
+	if (commandCapture.isRecording())
+		commandCapture.endScene(true);
+	sceGxmEndScene(gxmContext_ptr, NULL, NULL);
+	telemetry.endScene();
+}
+
+void Graphics::setRenderRegion(unsigned int width, unsigned int height)
+{
+	//maps clip space onto the top left width x height pixels, y up
+	float halfWidth = 0.5f * width;
+	float halfHeight = 0.5f * height;
+	sceGxmSetViewport(gxmContext_ptr, halfWidth, halfWidth, halfHeight, -halfHeight, 0.5f, 0.5f);
+	//and throws away anything drawn outside of them, like the oversized clear triangle
+	sceGxmSetRegionClip(gxmContext_ptr, SCE_GXM_REGION_CLIP_OUTSIDE, 0, 0, width - 1, height - 1);
 }
 
 void Graphics::swapBuffers()
 {
 	DisplayData displayData;
 	displayData.addr = _displayBuffers[backBufIndex];
+	displayData.mode = config.present.mode;
+	displayData.frameIndex = frameIndex;
+	displayData.inputSampleTime = inputSampleTime;
+	displayData.inputEventTime = inputEventTime;
 	sceGxmDisplayQueueAddEntry(
 		_displaySyncObjects[frontBufIndex],	//OLD buffer
 		_displaySyncObjects[backBufIndex],	//NEW buffer
 		&displayData
 	);
+	//a press is only responded to by the frame it was handed to
+	inputEventTime = 0;
+
+	//frame time is measured from one swap to the next and accounted to the mode the frame was queued with
+	SceUInt64 now = sceKernelGetProcessTimeWide();
+	PresentStats* stats = &_presentStats[config.present.mode];
+	stats->framesQueued++;
+	if (lastSwapTime != 0)
+	{
+		SceUInt64 frameTime = now - lastSwapTime;
+		stats->frameTimeTotal += frameTime;
+		if (stats->frameTimeMin == 0 || frameTime < stats->frameTimeMin)
+			stats->frameTimeMin = frameTime;
+		if (frameTime > stats->frameTimeMax)
+			stats->frameTimeMax = frameTime;
+	}
+	lastSwapTime = now;
+	telemetry.endFrame();
+	commandCapture.endFrame();
+	//the launch's first frame logs how long it took to get here, later ones return straight away
+	StartupTimer::getInstance()->frameSubmitted();
 
 	//update index
 	frontBufIndex = backBufIndex;
-	backBufIndex = (backBufIndex + 1) % DISPLAY_BUFFER_COUNT;
+	backBufIndex = (backBufIndex + 1) % config.present.bufferCount;
 }
 
 //TO DO: These should be updated to use built in clear vertex/fragment shaders to do this correctly
 void Graphics::clearScreen()
 {
+	if (commandCapture.isRecording())
+		commandCapture.clear(COLOR_BLACK);
+	//the blit covers every pixel of the back buffer, clearing it is wasted time
+	if (config.dynamicResolution)
+		return;
 
-	for (uint32_t i = 0; i < DISPLAY_HEIGHT; i++)
+	for (uint32_t i = 0; i < config.displayHeight; i++)
 	{
-		uint32_t *row = (uint32_t *)_displayBuffers[backBufIndex] + i * DISPLAY_STRIDE_IN_PIXELS;
+		uint32_t *row = (uint32_t *)_displayBuffers[backBufIndex] + i * config.displayStrideInPixels;
 
-		for (uint32_t j = 0; j < DISPLAY_WIDTH; j++)
+		for (uint32_t j = 0; j < config.displayWidth; j++)
 			row[j] = COLOR_BLACK;
 	}
 }
 void Graphics::clearScreen(uint32_t color)
 {
-	for (uint32_t i = 0; i < DISPLAY_HEIGHT; i++)
+	if (commandCapture.isRecording())
+		commandCapture.clear(color);
+	if (config.dynamicResolution)
+		return;
+	for (uint32_t i = 0; i < config.displayHeight; i++)
 	{
-		uint32_t *row = (uint32_t *)_displayBuffers[backBufIndex] + i * DISPLAY_STRIDE_IN_PIXELS;
+		uint32_t *row = (uint32_t *)_displayBuffers[backBufIndex] + i * config.displayStrideInPixels;
 
-		for (uint32_t j = 0; j < DISPLAY_WIDTH; j++)
+		for (uint32_t j = 0; j < config.displayWidth; j++)
 			row[j] = color;
 	}
 }
 
 void Graphics::draw(SceGxmPrimitiveType primitive, SceGxmIndexFormat format, const void *indexData, unsigned int indexCount)
 {
+	if (commandCapture.isRecording())
+		commandCapture.draw(primitive, format, indexData, indexCount);
 	sceGxmDraw(gxmContext_ptr, primitive, format, indexData, indexCount);
+	telemetry.recordDraw(primitive, indexCount);
+}
+
+void Graphics::drawInstanced(SceGxmPrimitiveType primitive, SceGxmIndexFormat format, const void *indexData, unsigned int indexCount,
+	unsigned int indexWrap)
+{
+	if (commandCapture.isRecording())
+		vitaPrintf("ERROR: instanced draw, captures keep one vertex stream, not captured\n");
+	sceGxmDrawInstanced(gxmContext_ptr, primitive, format, indexData, indexCount, indexWrap);
+	telemetry.recordDraw(primitive, indexCount);
 }
 
      /*----- Drawing functions end here -----*/
+/*----- Presentation functions start here -----*/
+
+void Graphics::setPresentParams(const PresentParams* params)
+{
+	if (initialized)
+	{
+		//the buffers and display queue already exist, only the mode can change now
+		vitaPrintf("Graphics System is already initialized! Only changing the present mode\n");
+		setPresentMode(params->mode);
+		return;
+	}
+
+	config.present = *params;
+	if (config.present.bufferCount < 1 || config.present.bufferCount > DISPLAY_MAX_BUFFER_COUNT)
+	{
+		vitaPrintf("Display buffer count %u is out of range, using %u\n", config.present.bufferCount, DISPLAY_BUFFER_COUNT);
+		config.present.bufferCount = DISPLAY_BUFFER_COUNT;
+	}
+
+	//the CPU can't queue more swaps than there are buffers to render into behind the front one
+	unsigned int maxPending = (config.present.bufferCount > 1) ? config.present.bufferCount - 1 : 1;
+	if (config.present.maxPendingSwaps < 1 || config.present.maxPendingSwaps > maxPending)
+	{
+		vitaPrintf("Max pending swaps %u is out of range, using %u\n", config.present.maxPendingSwaps, maxPending);
+		config.present.maxPendingSwaps = maxPending;
+	}
+
+	if (config.present.mode >= NUMBER_OF_PRESENT_MODES)
+		config.present.mode = PRESENT_MODE_VSYNC;
+}
+
+void Graphics::setPresentMode(PresentMode mode)
+{
+	if (mode >= NUMBER_OF_PRESENT_MODES)
+	{
+		vitaPrintf("ERROR: Unknown present mode: %u\n", mode);
+		return;
+	}
+
+	vitaPrintf("Changing present mode from %s to %s\n", _presentModeNames[config.present.mode], _presentModeNames[mode]);
+	config.present.mode = mode;
+	//half rate gives the GPU twice as long per frame
+	if (config.dynamicResolution)
+		dynamicResolution.setTargetFrameTime(drsTargetFrameTime(&config));
+	//don't count the time spent switching towards the new mode
+	lastSwapTime = 0;
+}
+
+PresentMode Graphics::getPresentMode()
+{
+	return config.present.mode;
+}
+
+unsigned int Graphics::getFrameIndex()
+{
+	return frameIndex + 1;
+}
+
+unsigned int Graphics::getCompletedFrameIndex()
+{
+	return *frameDoneNotification_ptr;
+}
+
+void Graphics::setInputSampleTime(SceUInt64 sampleTime)
+{
+	inputSampleTime = sampleTime;
+}
+
+void Graphics::setInputEventTime(SceUInt64 eventTime)
+{
+	inputEventTime = eventTime;
+}
+
+void Graphics::getPresentStats(PresentMode mode, PresentStats* stats)
+{
+	*stats = _presentStats[mode];
+}
+
+void Graphics::resetPresentStats()
+{
+	memset(_presentStats, 0, sizeof(_presentStats));
+	lastSwapTime = 0;
+}
+
+void Graphics::logPresentStats()
+{
+	vitaPrintf("\nPresent statistics (buffers: %u, max pending swaps: %u)\n", config.present.bufferCount, config.present.maxPendingSwaps);
+	for (int i = 0; i < NUMBER_OF_PRESENT_MODES; i++)
+	{
+		const PresentStats* stats = &_presentStats[i];
+		if (stats->framesQueued == 0)
+			continue;
+
+		vitaPrintf("Mode %s: %u queued, %u displayed, %u dropped\n", _presentModeNames[i],
+			stats->framesQueued, stats->framesDisplayed, stats->framesDropped);
+		if (stats->framesQueued > 1)
+			vitaPrintf("\tFrame time avg: %.2fms min: %.2fms max: %.2fms\n",
+				(double)stats->frameTimeTotal / (stats->framesQueued - 1) / 1000.0,
+				stats->frameTimeMin / 1000.0, stats->frameTimeMax / 1000.0);
+		if (stats->latencySamples > 0)
+			vitaPrintf("\tInput to display latency avg: %.2fms min: %.2fms max: %.2fms\n",
+				(double)stats->latencyTotal / stats->latencySamples / 1000.0,
+				stats->latencyMin / 1000.0, stats->latencyMax / 1000.0);
+		if (stats->eventLatencySamples > 0)
+			vitaPrintf("\tButton press to display latency avg: %.2fms min: %.2fms max: %.2fms (%u presses)\n",
+				(double)stats->eventLatencyTotal / stats->eventLatencySamples / 1000.0,
+				stats->eventLatencyMin / 1000.0, stats->eventLatencyMax / 1000.0, stats->eventLatencySamples);
+	}
+}
+
+/*----- Presentation functions end here -----*/
+/*----- Telemetry functions start here -----*/
+
+const GraphicsStats* Graphics::getStats()
+{
+	return telemetry.getStats();
+}
+
+void Graphics::startCalibration(unsigned int frames)
+{
+	telemetry.startCalibration(frames);
+}
+
+void Graphics::logStats()
+{
+	telemetry.logStats();
+}
+
+void Graphics::recordLodDraw(unsigned int lod, unsigned int triangles)
+{
+	telemetry.recordLodDraw(lod, triangles);
+}
+
+const DynamicResolutionStats* Graphics::getDynamicResolutionStats()
+{
+	return config.dynamicResolution ? dynamicResolution.getStats() : nullptr;
+}
+
+TextureCache* Graphics::getTextureCache()
+{
+	return textureCache.isInitialized() ? &textureCache : nullptr;
+}
+
+void Graphics::setFragmentTexture(unsigned int unit, const SceGxmTexture* texture)
+{
+	int error = sceGxmSetFragmentTexture(gxmContext_ptr, unit, texture);
+	if (error != 0)
+		vitaPrintf("sceGxmSetFragmentTexture() result: 0x%08X\n", error);
+	telemetry.recordStateChange();
+	commandCapture.setFragmentTexture(unit, texture);
+}
+
+/*----- Capture -----*/
+
+bool Graphics::startCapture(const char* path, unsigned int frames)
+{
+	return commandCapture.start(path, frames, config.displayWidth, config.displayHeight);
+}
+
+bool Graphics::isCapturing()
+{
+	return commandCapture.isCapturing();
+}
+
+/*----- Telemetry functions end here -----*/
 /*----- Shader related functions start here -----*/
 
 SceGxmShaderPatcherId Graphics::patcherRegisterProgram(const SceGxmProgram *const programHeader)
@@ -536,53 +1336,136 @@ SceGxmShaderPatcherId Graphics::patcherRegisterProgram(const SceGxmProgram *cons
 	int error = 0;
 
 	//check the program
-	vitaPrintf("\nChecking shader program\nProgram address: %p\n", programHeader);
+	vitaVerbosePrintf("\nChecking shader program\nProgram address: %p\n", programHeader);
 	error = sceGxmProgramCheck(programHeader);
-	vitaPrintf("sceGxmProgramCheck() result: 0x%08X\n", error);
+	vitaVerbosePrintf("sceGxmProgramCheck() result: 0x%08X\n", error);
+	if (error != 0)
+		vitaPrintf("ERROR: sceGxmProgramCheck() of program %p result: 0x%08X\n", programHeader, error);
 
 	SceGxmShaderPatcherId programID;
-	vitaPrintf("Registering shader program with the patcher\n");
+	vitaVerbosePrintf("Registering shader program with the patcher\n");
+	sceKernelLockLwMutex(&patcherLock, 1, NULL);
 	error = sceGxmShaderPatcherRegisterProgram(patcher_ptr, programHeader, &programID);
-	vitaPrintf("sceGxmShaderPatcherRegisterProgram() result: 0x%08X\n", error);
+	sceKernelUnlockLwMutex(&patcherLock, 1);
+	vitaVerbosePrintf("sceGxmShaderPatcherRegisterProgram() result: 0x%08X\n", error);
 	//assert(error == 0);
+	if (error != 0)
+		vitaPrintf("ERROR: sceGxmShaderPatcherRegisterProgram() of program %p result: 0x%08X\n", programHeader, error);
 
 	_registeredProgramIDs.push_back(programID);
+	if (error == 0)
+		commandCapture.programRegistered(programID, programHeader);
 
 	//return the last element in the vector (what we just added)
 	return _registeredProgramIDs.back();
 }
 
+int Graphics::patcherUnregisterProgram(SceGxmShaderPatcherId programID)
+{
+	std::vector<SceGxmShaderPatcherId>::iterator iter;
+	for (iter = _registeredProgramIDs.begin(); iter != _registeredProgramIDs.end(); iter++)
+		if (*iter == programID)
+			break;
+	if (iter == _registeredProgramIDs.end())
+	{
+		vitaPrintf("ERROR: shader program %p isn't registered\n", programID);
+		return SCE_GXM_ERROR_INVALID_VALUE;
+	}
+
+	vitaVerbosePrintf("Unregistering shader program from the patcher\nProgram ID: %p\n", programID);
+	sceKernelLockLwMutex(&patcherLock, 1, NULL);
+	int error = sceGxmShaderPatcherUnregisterProgram(patcher_ptr, programID);
+	sceKernelUnlockLwMutex(&patcherLock, 1);
+	vitaVerbosePrintf("sceGxmShaderPatcherUnregisterProgram() result: 0x%08X\n", error);
+	if (error == 0)
+	{
+		_registeredProgramIDs.erase(iter);
+		commandCapture.programUnregistered(programID);
+	}
+	else
+		vitaPrintf("ERROR: sceGxmShaderPatcherUnregisterProgram() result: 0x%08X\n", error);
+	return error;
+}
+
+void Graphics::patcherReleaseVertexProgram(SceGxmVertexProgram* program)
+{
+	std::vector<SceGxmVertexProgram*>::iterator iter;
+	for (iter = _vertexPrograms.begin(); iter != _vertexPrograms.end(); iter++)
+	{
+		if (*iter == program)
+		{
+			_vertexPrograms.erase(iter);
+			break;
+		}
+	}
+	sceKernelLockLwMutex(&patcherLock, 1, NULL);
+	int error = sceGxmShaderPatcherReleaseVertexProgram(patcher_ptr, program);
+	sceKernelUnlockLwMutex(&patcherLock, 1);
+	if (error != 0)
+		vitaPrintf("sceGxmShaderPatcherReleaseVertexProgram() result: 0x%08X\n", error);
+}
+
+void Graphics::patcherReleaseFragmentProgram(SceGxmFragmentProgram* program)
+{
+	std::vector<SceGxmFragmentProgram*>::iterator iter;
+	for (iter = _fragmentPrograms.begin(); iter != _fragmentPrograms.end(); iter++)
+	{
+		if (*iter == program)
+		{
+			_fragmentPrograms.erase(iter);
+			break;
+		}
+	}
+	sceKernelLockLwMutex(&patcherLock, 1, NULL);
+	int error = sceGxmShaderPatcherReleaseFragmentProgram(patcher_ptr, program);
+	sceKernelUnlockLwMutex(&patcherLock, 1);
+	if (error != 0)
+		vitaPrintf("sceGxmShaderPatcherReleaseFragmentProgram() result: 0x%08X\n", error);
+}
+
 void Graphics::patcherUnregisterPrograms()
 {
 	int error = 0;
+	sceKernelLockLwMutex(&patcherLock, 1, NULL);
+	//a program can't be unregistered while anything made from it is alive
+	for (size_t i = 0; i < _vertexPrograms.size(); i++)
+		sceGxmShaderPatcherReleaseVertexProgram(patcher_ptr, _vertexPrograms[i]);
+	for (size_t i = 0; i < _fragmentPrograms.size(); i++)
+		sceGxmShaderPatcherReleaseFragmentProgram(patcher_ptr, _fragmentPrograms[i]);
+	_vertexPrograms.clear();
+	_fragmentPrograms.clear();
+
 	std::vector<SceGxmShaderPatcherId>::iterator iter;
 	for (iter = _registeredProgramIDs.begin(); iter != _registeredProgramIDs.end(); iter++)
 	{
-		vitaPrintf("Unregistering shader program from the patcher\nProgram ID: %d\n", *iter);
+		vitaVerbosePrintf("Unregistering shader program from the patcher\nProgram ID: %d\n", *iter);
 		error = sceGxmShaderPatcherUnregisterProgram(patcher_ptr, *iter);
-		vitaPrintf("sceGxmShaderPatcherRegisterProgram() result: 0x%08X\n", error);
+		vitaVerbosePrintf("sceGxmShaderPatcherRegisterProgram() result: 0x%08X\n", error);
 		//assert(error == 0);
+		commandCapture.programUnregistered(*iter);
 	}
+	_registeredProgramIDs.clear();
+	sceKernelUnlockLwMutex(&patcherLock, 1);
 }
 
 //TO DO: make this a template function able to change many "program creation params" by taking two parameters; First - const char* of the parameter to change, Second - it's value
 //Future usage: patcherSetProgramCreationParams("VertexStreamType", GXM_BASIC_INDEX_16BIT); patcherSetProgramCreationParams("OutputRegFormat", SCE_GXM_OUTPUT_REGISTER_FORMAT_UCHAR4); ect etc
 void Graphics::patcherSetProgramCreationParams(VertexStreamType streamType)
 {
-	vitaPrintf("\nProgram creation parameter requested change!\n");
-	vitaPrintf("Changing vertex stream type...\n");
+	vitaVerbosePrintf("\nProgram creation parameter requested change!\n");
+	vitaVerbosePrintf("Changing vertex stream type...\n");
 	//check if a compatible stream already exists
 	std::map<VertexStreamType, const SceGxmVertexStream*>::iterator iter;
 	iter = _vertexStreamMap.find(streamType);
 	if (iter != _vertexStreamMap.end())
 	{
-		vitaPrintf("Setting vertex stream to type: %u\n", streamType);
+		vitaVerbosePrintf("Setting vertex stream to type: %u\n", streamType);
 		currentStreamType = streamType;
 	}
 	else
 	{
-		vitaPrintf("A vertex program requests a vertex stream that doesn't exist yet! Creating one\n");
-		vitaPrintf("Vertex stream type: %u\n", streamType);
+		vitaVerbosePrintf("A vertex program requests a vertex stream that doesn't exist yet! Creating one\n");
+		vitaVerbosePrintf("Vertex stream type: %u\n", streamType);
 		createdStreams++;
 		switch (currentStreamType)
 		{
@@ -623,33 +1506,36 @@ void Graphics::patcherSetProgramCreationParams(VertexStreamType streamType)
 			return;
 		}
 
-		vitaPrintf("New stream parameters...\nStride: %u\nIndex source: %u\n", _vertexStreams[createdStreams - 1].stride, _vertexStreams[createdStreams -1].indexSource);
+		vitaVerbosePrintf("New stream parameters...\nStride: %u\nIndex source: %u\n", _vertexStreams[createdStreams - 1].stride, _vertexStreams[createdStreams -1].indexSource);
 		currentStreamType = streamType;
 		_vertexStreamMap.insert(iter, std::make_pair(streamType, _vertexStreams));
 	}
 }
 
-SceGxmVertexProgram* Graphics::patcherCreateVertexProgram(SceGxmShaderPatcherId programID, SceGxmVertexAttribute* attributes, int attributeCount, ...)
+GpuVertexProgram Graphics::patcherCreateVertexProgram(SceGxmShaderPatcherId programID, SceGxmVertexAttribute* attributes, int attributeCount, ...)
 {
 	int error = 0;
 
-	vitaPrintf("\nCreating shader patcher vertex program from program with ID: %u\n", programID);
+	vitaVerbosePrintf("\nCreating shader patcher vertex program from program with ID: %u\n", programID);
 	//first get the linked to / registered program
 	const SceGxmProgram *binaryProgram_ptr = sceGxmShaderPatcherGetProgramFromId(programID);
 	assert(binaryProgram_ptr);
 
 	//go through the argument list to get the shader program's attribute names
+	const char* attributeNames[CAPTURE_MAX_ATTRIBUTES];
 	va_list vl;
 	va_start(vl, attributeCount);
 	for (int i = 0; i < attributeCount; i++)
 	{
 		const char* attributeName = va_arg(vl, const char*);
-		vitaPrintf("Adding vertex program attribute: %s\n", attributeName);
+		if (i < CAPTURE_MAX_ATTRIBUTES)
+			attributeNames[i] = attributeName;
+		vitaVerbosePrintf("Adding vertex program attribute: %s\n", attributeName);
 		const SceGxmProgramParameter *vertexProgramAttribute_ptr = sceGxmProgramFindParameterByName(binaryProgram_ptr, attributeName);
 		assert(vertexProgramAttribute_ptr && (sceGxmProgramParameterGetCategory(vertexProgramAttribute_ptr) == SCE_GXM_PARAMETER_CATEGORY_ATTRIBUTE));
-		vitaPrintf("Setting vertex attribute.regIndex: ");
+		vitaVerbosePrintf("Setting vertex attribute.regIndex: ");
 		attributes[i].regIndex = sceGxmProgramParameterGetResourceIndex(vertexProgramAttribute_ptr);
-		vitaPrintf("%d\n", attributes[i].regIndex);
+		vitaVerbosePrintf("%d\n", attributes[i].regIndex);
 	}
 	va_end(vl);
 
@@ -660,89 +1546,164 @@ SceGxmVertexProgram* Graphics::patcherCreateVertexProgram(SceGxmShaderPatcherId
 	if (currentStream == _vertexStreamMap.end())
 	{
 		vitaPrintf("ERROR: Could not find correct vertex stream in _vertexStreams<>!!!\n");
-		return nullptr;
+		return GpuVertexProgram();
 	}
 
-	vitaPrintf("\nVertex Program and Stream Attributes...\n");
-	vitaPrintf("Pointer the the patcher at address: %p\n", patcher_ptr);
-	vitaPrintf("ProgramID: %u\n", programID);
-	vitaPrintf("Program attributes at address: %p\n", attributes);
-	vitaPrintf("\tAttribute count: %d\n", attributeCount);
+	vitaVerbosePrintf("\nVertex Program and Stream Attributes...\n");
+	vitaVerbosePrintf("Pointer the the patcher at address: %p\n", patcher_ptr);
+	vitaVerbosePrintf("ProgramID: %u\n", programID);
+	vitaVerbosePrintf("Program attributes at address: %p\n", attributes);
+	vitaVerbosePrintf("\tAttribute count: %d\n", attributeCount);
 	for (int j = 0; j < attributeCount; j++)
 	{
-		vitaPrintf("\tAttribute %u - stream index: %u\n", j, attributes[j].streamIndex);
-		vitaPrintf("\tAttribute %u - offset: %u\n", j, attributes[j].offset);
-		vitaPrintf("\tAttribute %u - format: 0x%08\n", j, attributes[j].format);
-		vitaPrintf("\tAttribute %u - component count: %u\n", j, attributes[j].componentCount);
-		vitaPrintf("\tAttribute %u - reg index: %d\n", j, attributes[j].regIndex);
+		vitaVerbosePrintf("\tAttribute %u - stream index: %u\n", j, attributes[j].streamIndex);
+		vitaVerbosePrintf("\tAttribute %u - offset: %u\n", j, attributes[j].offset);
+		vitaVerbosePrintf("\tAttribute %u - format: 0x%08\n", j, attributes[j].format);
+		vitaVerbosePrintf("\tAttribute %u - component count: %u\n", j, attributes[j].componentCount);
+		vitaVerbosePrintf("\tAttribute %u - reg index: %d\n", j, attributes[j].regIndex);
 	}
-	vitaPrintf("Current vertex stream at address: %p\n", currentStream->second);
-	vitaPrintf("Stream count: %d\n", 1);
-	vitaPrintf("\tStream Type: %u\n", currentStreamType);
-	vitaPrintf("\tStream Attribute - stride: %d\n", currentStream->second[createdStreams - 1].stride);
-	vitaPrintf("\tStream Attribute - index source: 0x%08\n", currentStream->second[createdStreams - 1].indexSource);
+	vitaVerbosePrintf("Current vertex stream at address: %p\n", currentStream->second);
+	vitaVerbosePrintf("Stream count: %d\n", 1);
+	vitaVerbosePrintf("\tStream Type: %u\n", currentStreamType);
+	vitaVerbosePrintf("\tStream Attribute - stride: %d\n", currentStream->second[createdStreams - 1].stride);
+	vitaVerbosePrintf("\tStream Attribute - index source: 0x%08\n", currentStream->second[createdStreams - 1].indexSource);
 
 	SceGxmVertexProgram* vertexProgram_ptr = nullptr;
-	error = sceGxmShaderPatcherCreateVertexProgram(
-		patcher_ptr,
-		programID,
-		attributes,
-		attributeCount,
-		currentStream->second,
-		1,						//TO DO: add support for multiple vertex streams
-		&vertexProgram_ptr
-	);
-	vitaPrintf("sceGxmShaderPatcherCreateVertexProgram() result: 0x%08\n", error);
+	error = patcherPatchVertexProgram(programID, attributes, attributeCount, currentStream->second, &vertexProgram_ptr); //TO DO: add support for multiple vertex streams
+	vitaVerbosePrintf("sceGxmShaderPatcherCreateVertexProgram() result: 0x%08\n", error);
 	assert(error == 0);
 
 	//pushback to vector or map containing loaded programs
-	_vertexPrograms.push_back(vertexProgram_ptr);
+	patcherAdoptVertexProgram(vertexProgram_ptr, programID, attributes, attributeCount, attributeNames, currentStream->second);
+
+	return GpuVertexProgram(vertexProgram_ptr);
+}
+
+GpuVertexProgram Graphics::patcherCreateVertexProgram(SceGxmShaderPatcherId programID, SceGxmVertexAttribute* attributes, int attributeCount, const SceGxmVertexStream* stream, const char* const* names,
+	unsigned int streamCount)
+{
+	vitaVerbosePrintf("\nCreating shader patcher vertex program from program with ID: %u, stride: %u, streams: %u\n", programID, stream->stride, streamCount);
+	const SceGxmProgram *binaryProgram_ptr = sceGxmShaderPatcherGetProgramFromId(programID);
+	assert(binaryProgram_ptr);
+
+	//attributes the shader doesn't use are dropped rather than failing, the same mesh can feed simpler shaders
+	const char* usedNames[CAPTURE_MAX_ATTRIBUTES];
+	int usedCount = 0;
+	for (int i = 0; i < attributeCount; i++)
+	{
+		const SceGxmProgramParameter *vertexProgramAttribute_ptr = sceGxmProgramFindParameterByName(binaryProgram_ptr, names[i]);
+		if (vertexProgramAttribute_ptr == NULL || sceGxmProgramParameterGetCategory(vertexProgramAttribute_ptr) != SCE_GXM_PARAMETER_CATEGORY_ATTRIBUTE)
+		{
+			vitaVerbosePrintf("Vertex program doesn't use attribute %s, skipping it\n", names[i]);
+			continue;
+		}
+		attributes[usedCount] = attributes[i];
+		attributes[usedCount].regIndex = sceGxmProgramParameterGetResourceIndex(vertexProgramAttribute_ptr);
+		if (usedCount < CAPTURE_MAX_ATTRIBUTES)
+			usedNames[usedCount] = names[i];
+		vitaVerbosePrintf("Adding vertex program attribute: %s, reg index: %d\n", names[i], attributes[usedCount].regIndex);
+		usedCount++;
+	}
+
+	SceGxmVertexProgram* vertexProgram_ptr = nullptr;
+	int error = patcherPatchVertexProgram(programID, attributes, usedCount, stream, &vertexProgram_ptr, streamCount);
+	vitaVerbosePrintf("sceGxmShaderPatcherCreateVertexProgram() result: 0x%08X\n", error);
+	assert(error == 0);
 
-	return vertexProgram_ptr;
+	patcherAdoptVertexProgram(vertexProgram_ptr, programID, attributes, usedCount, usedNames, stream, streamCount);
+	return GpuVertexProgram(vertexProgram_ptr);
 }
 
-SceGxmFragmentProgram* Graphics::patcherCreateFragmentProgram(SceGxmShaderPatcherId programID, SceGxmShaderPatcherId vertexProgramID)
+GpuFragmentProgram Graphics::patcherCreateFragmentProgram(SceGxmShaderPatcherId programID, SceGxmShaderPatcherId vertexProgramID, const SceGxmBlendInfo* blendInfo)
 {
-	vitaPrintf("\nCreating shader patcher fragment program from program with ID: %u\n", programID);
+	vitaVerbosePrintf("\nCreating shader patcher fragment program from program with ID: %u\n", programID);
 	
-	vitaPrintf("\nFragment Program Attributes...\n");
-	vitaPrintf("Pointer the the patcher at address: %p\n", patcher_ptr);
-	vitaPrintf("ProgramID: %u\n", programID);
-	vitaPrintf("Settings used for program creation:\n");
-	vitaPrintf("\tOutput Register Format: 0x%08\n", outputRegisterFormat);
-	vitaPrintf("\tAnti-aliasing mode: 0x%08\n", MSAA_MODE);
-	vitaPrintf("\tBlend info at address: NOT USED\n");
-	vitaPrintf("Using vertex program with ID: %u\n", vertexProgramID);
-
-	SceGxmFragmentProgram* fragmentProgram_ptr;
+	vitaVerbosePrintf("\nFragment Program Attributes...\n");
+	vitaVerbosePrintf("Pointer the the patcher at address: %p\n", patcher_ptr);
+	vitaVerbosePrintf("ProgramID: %u\n", programID);
+	vitaVerbosePrintf("Settings used for program creation:\n");
+	vitaVerbosePrintf("\tOutput Register Format: 0x%08\n", outputRegisterFormat);
+	vitaVerbosePrintf("\tAnti-aliasing mode: 0x%08\n", config.msaaMode);
+	if (blendInfo == NULL)
+		vitaVerbosePrintf("\tBlend info at address: NOT USED\n");
+	else
+		vitaVerbosePrintf("\tBlend info at address: %p\n", blendInfo);
+	vitaVerbosePrintf("Using vertex program with ID: %u\n", vertexProgramID);
+
+	SceGxmFragmentProgram* fragmentProgram_ptr = nullptr;
+	int error = patcherPatchFragmentProgram(programID, vertexProgramID, blendInfo, &fragmentProgram_ptr);
+	vitaVerbosePrintf("sceGxmShaderPatcherCreateFragmentProgram() result: 0x%08\n", error);
+	assert(error == 0);
+
+	//pushback to vector containing loaded programs
+	patcherAdoptFragmentProgram(fragmentProgram_ptr, programID, vertexProgramID, blendInfo);
+
+	return GpuFragmentProgram(fragmentProgram_ptr);
+}
+
+int Graphics::patcherPatchVertexProgram(SceGxmShaderPatcherId programID, const SceGxmVertexAttribute* attributes, int attributeCount,
+	const SceGxmVertexStream* stream, SceGxmVertexProgram** program, unsigned int streamCount)
+{
+	//the patcher and the HostPool behind it are shared with whichever thread patches next
+	sceKernelLockLwMutex(&patcherLock, 1, NULL);
+	int error = sceGxmShaderPatcherCreateVertexProgram(
+		patcher_ptr,
+		programID,
+		attributes,
+		attributeCount,
+		stream,
+		streamCount,
+		program
+	);
+	sceKernelUnlockLwMutex(&patcherLock, 1);
+	return error;
+}
+
+int Graphics::patcherPatchFragmentProgram(SceGxmShaderPatcherId programID, SceGxmShaderPatcherId vertexProgramID,
+	const SceGxmBlendInfo* blendInfo, SceGxmFragmentProgram** program)
+{
+	sceKernelLockLwMutex(&patcherLock, 1, NULL);
 	int error = sceGxmShaderPatcherCreateFragmentProgram(
 		patcher_ptr,
 		programID,
 		outputRegisterFormat,							//Output format for the fragment program <c>COLOR0</c>
-		MSAA_MODE,														//Multisample mode
-		NULL,															//Pointer to the blend info structure, or null
+		config.msaaMode,												//Multisample mode
+		blendInfo,														//Pointer to the blend info structure, or null
 		sceGxmShaderPatcherGetProgramFromId(vertexProgramID),		//Pointer to the vertex program (The GXP), or null
-		&fragmentProgram_ptr										//Double pointer to storage for fragment program
+		program														//Double pointer to storage for fragment program
 	);
-	vitaPrintf("sceGxmShaderPatcherCreateFragmentProgram() result: 0x%08\n", error);
-	assert(error == 0);
+	sceKernelUnlockLwMutex(&patcherLock, 1);
+	return error;
+}
 
-	//pushback to vector containing loaded programs
-	_fragmentPrograms.push_back(fragmentProgram_ptr);
+void Graphics::patcherAdoptVertexProgram(SceGxmVertexProgram* program, SceGxmShaderPatcherId programID, const SceGxmVertexAttribute* attributes,
+	int attributeCount, const char* const* names, const SceGxmVertexStream* stream, unsigned int streamCount)
+{
+	_vertexPrograms.push_back(program);
+	commandCapture.vertexProgramCreated(program, programID, attributes, attributeCount, names, stream, streamCount);
+}
 
-	return fragmentProgram_ptr;
+void Graphics::patcherAdoptFragmentProgram(SceGxmFragmentProgram* program, SceGxmShaderPatcherId programID, SceGxmShaderPatcherId vertexProgramID,
+	const SceGxmBlendInfo* blendInfo)
+{
+	_fragmentPrograms.push_back(program);
+	commandCapture.fragmentProgramCreated(program, programID, vertexProgramID, blendInfo);
 }
 
 void Graphics::patcherSetVertexProgram(const SceGxmVertexProgram* program)
 {
 	//vitaPrintf("\nSetting vertex program to program at address: %p\n", program);
 	sceGxmSetVertexProgram(gxmContext_ptr, program);
+	telemetry.recordStateChange();
+	commandCapture.setVertexProgram(program);
 }
 
 void Graphics::patcherSetFragmentProgram(const SceGxmFragmentProgram* program)
 {
 	//vitaPrintf("\nSetting fragment program to program at address: %p\n", program);
 	sceGxmSetFragmentProgram(gxmContext_ptr, program);
+	telemetry.recordStateChange();
+	commandCapture.setFragmentProgram(program);
 }
 
 void Graphics::patcherSetVertexStream(unsigned int streamIndex, const void* vertices)
@@ -771,6 +1732,8 @@ void Graphics::patcherSetVertexStream(unsigned int streamIndex, const void* vert
 	*/
 
 	sceGxmSetVertexStream(gxmContext_ptr, streamIndex, vertices);
+	telemetry.recordStateChange();
+	commandCapture.setVertexStream(streamIndex, vertices);
 }
 
 void Graphics::patcherSetVertexProgramConstants(void* uniformBuffer, const SceGxmProgramParameter* worldViewProjection, unsigned int componentOffset, unsigned int componentCount, const float *sourceData)
@@ -794,6 +1757,28 @@ void Graphics::patcherSetVertexProgramConstants(void* uniformBuffer, const SceGx
 	*/
 	sceGxmReserveVertexDefaultUniformBuffer(gxmContext_ptr, &uniformBuffer);
 	sceGxmSetUniformDataF(uniformBuffer, worldViewProjection, componentOffset, componentCount, sourceData);
+	telemetry.recordUniformReserve(TELEMETRY_RING_VERTEX, uniformBuffer, (componentOffset + componentCount) * sizeof(float));
+	if (commandCapture.isRecording())
+		commandCapture.setUniforms(false, worldViewProjection, componentOffset, componentCount, sourceData);
+}
+
+void Graphics::patcherSetFragmentProgramConstants(const SceGxmProgramParameter* parameter, unsigned int componentOffset, unsigned int componentCount, const float *sourceData)
+{
+	void* uniformBuffer = NULL;
+	sceGxmReserveFragmentDefaultUniformBuffer(gxmContext_ptr, &uniformBuffer);
+	sceGxmSetUniformDataF(uniformBuffer, parameter, componentOffset, componentCount, sourceData);
+	telemetry.recordUniformReserve(TELEMETRY_RING_FRAGMENT, uniformBuffer, (componentOffset + componentCount) * sizeof(float));
+	if (commandCapture.isRecording())
+		commandCapture.setUniforms(true, parameter, componentOffset, componentCount, sourceData);
+}
+
+void Graphics::patcherSetVertexUniformBuffer(unsigned int bufferIndex, const void* buffer)
+{
+	int error = sceGxmSetVertexUniformBuffer(gxmContext_ptr, bufferIndex, buffer);
+	if (error != 0)
+		vitaPrintf("ERROR: sceGxmSetVertexUniformBuffer(%u) result: 0x%08X\n", bufferIndex, error);
+	telemetry.recordStateChange();
+	commandCapture.setVertexUniformBuffer(bufferIndex, buffer);
 }
 
 /*----- Shader functions end here -----*/
@@ -841,14 +1826,16 @@ SceGxmShaderPatcher* Graphics::getShaderPatcher()
 /*----- Memory Functions start here -----*/
 
  //Allocates memory and maps it to the GPU
-void *Graphics::allocGraphicsMem(SceKernelMemBlockType type, unsigned int size, unsigned int alignment, unsigned int attributes, SceUID *uid)
+void *Graphics::allocGraphicsMem(SceKernelMemBlockType type, unsigned int size, unsigned int alignment, unsigned int attributes, SceUID *uid,
+	const char* name, MemoryCategory category)
 {
 	int error = 0;
+	unsigned int requestedSize = size;
 
-	vitaPrintf("Allocating GPU memory...\n");
-	vitaPrintf("SceKernelMemBlockType: %d\n", type);
-	vitaPrintf("SceSize: %u\n", size);
-	vitaPrintf("SceGxmMemoryAttribFlags: %u\n", attributes);
+	vitaVerbosePrintf("Allocating GPU memory...\n");
+	vitaVerbosePrintf("SceKernelMemBlockType: %d\n", type);
+	vitaVerbosePrintf("SceSize: %u\n", size);
+	vitaVerbosePrintf("SceGxmMemoryAttribFlags: %u\n", attributes);
 
 	/*	Here we use sceKernelAllocMemBlock directly, this means we cannot directly
 	use the alignment parameter.  Instead, allocate the minimum size for this memblock
@@ -857,35 +1844,37 @@ void *Graphics::allocGraphicsMem(SceKernelMemBlockType type, unsigned int size,
 	Applications using it's own heap should be able to use the alignment
 	parameter directly for more minimal padding.
 	*/
-	vitaPrintf("\nAligning memory... ");
+	vitaVerbosePrintf("\nAligning memory... ");
 	if (type == SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW)
 	{
 		// CDRAM memblocks must be 256kB aligned
-		vitaPrintf("Doing a 256kb alignment\n");
+		vitaVerbosePrintf("Doing a 256kb alignment\n");
 		assert(alignment <= 256 * 1024);
 		size = ALIGN_MEM(size, 256 * 1024);
 	}
 	else
 	{
 		//LPDDR memblocks must be 4kB aligned
-		vitaPrintf("Doing a 4kb alignment\n");
+		vitaVerbosePrintf("Doing a 4kb alignment\n");
 		assert(alignment <= 4 * 1024);
 		size = ALIGN_MEM(size, 4 * 1024);
 	}
 	UNUSED(alignment);
 
 	//allocate memory
-	*uid = sceKernelAllocMemBlock("gpu_mem", type, size, NULL);
-	vitaPrintf("SceUID created: %d\n", *uid);
+	*uid = sceKernelAllocMemBlock(name, type, size, NULL);
+	vitaVerbosePrintf("SceUID created: %d\n", *uid);
 	assert(*uid >= 0);
 
 	//get the base address
 	void* memory = NULL;
 	error = sceKernelGetMemBlockBase(*uid, &memory);
 	assert(error == 0);
+	memoryTracker.record(name, category, (type == SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW) ? MEMORY_POOL_CDRAM : MEMORY_POOL_LPDDR,
+		*uid, memory, requestedSize, size, __builtin_return_address(0));
 
 	//map memory for the GPU
-	vitaPrintf("Mapping graphics memory\n");
+	vitaVerbosePrintf("Mapping graphics memory\n");
 	error = sceGxmMapMemory(memory, size, (SceGxmMemoryAttribFlags)attributes);
 	assert(error == 0);
 
@@ -898,7 +1887,10 @@ void Graphics::freeGraphicsMem(SceUID uid)
 	int error = 0;
 	UNUSED(error);
 
-	vitaPrintf("Freeing allocated gpu memory for SceUID: %d\n", uid);
+	vitaVerbosePrintf("Freeing allocated gpu memory for SceUID: %d\n", uid);
+	//a uid the tracker doesn't know was never allocated here or is already freed, it may belong to something else by now
+	if (!memoryTracker.remove(uid))
+		return;
 
 	//get the base address
 	void* memory = NULL;
@@ -909,46 +1901,72 @@ void Graphics::freeGraphicsMem(SceUID uid)
 
 	//unmap the memory
 	error = sceGxmUnmapMemory(memory);
-	vitaPrintf("sceGxmUnmapMemory(%d) result: 0x%08X\n", uid, error);
+	vitaVerbosePrintf("sceGxmUnmapMemory(%d) result: 0x%08X\n", uid, error);
 	assert(error == 0);
 
 	//free the memory
 	error = sceKernelFreeMemBlock(uid);
-	vitaPrintf("sceKernelFreeMemBlock(%d) result: 0x%08X\n", uid, error);
+	vitaVerbosePrintf("sceKernelFreeMemBlock(%d) result: 0x%08X\n", uid, error);
 	assert(error == 0);
 }
 
+//Allocates several pieces of memory as one memblock with one mapping
+void *Graphics::allocGraphicsMemBatch(SceKernelMemBlockType type, GraphicsMemRequest* requests, unsigned int count, unsigned int attributes,
+	SceUID *uid, const char* name, MemoryCategory category)
+{
+	//the memblock itself is aligned well past any request, so offsets only have to be aligned from its start
+	unsigned int size = 0;
+	for (unsigned int i = 0; i < count; i++)
+		size = ALIGN_MEM(size, requests[i].alignment) + requests[i].size;
+	vitaVerbosePrintf("Allocating %u pieces of GPU memory as one %u byte memblock\n", count, size);
+
+	uint8_t* memory = (uint8_t*)allocGraphicsMem(type, size, 4, attributes, uid, name, category);
+	unsigned int offset = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		offset = ALIGN_MEM(offset, requests[i].alignment);
+		requests[i].memory = memory + offset;
+		offset += requests[i].size;
+	}
+	return memory;
+}
+
 //Allocates memory and maps it as a vertex USSE
-void *Graphics::allocVertexUsseMem(unsigned int size, SceUID *uid, unsigned int *usseOffset)
+void *Graphics::allocVertexUsseMem(unsigned int size, SceUID *uid, unsigned int *usseOffset, const char* name, MemoryCategory category)
 {
 	int error = 0;
 	UNUSED(error);
 
-	vitaPrintf("Allocating vertex USSE GPU memory...\n");
-	vitaPrintf("SceSize: %u\n", size);
+	vitaVerbosePrintf("Allocating vertex USSE GPU memory...\n");
+	vitaVerbosePrintf("SceSize: %u\n", size);
 
 	//align the memory block for LPDDR (4kb alignment)
+	unsigned int requestedSize = size;
 	size = ALIGN_MEM(size, 4096);
 
 	//allocate the memory
-	*uid = sceKernelAllocMemBlock("vertex_usse", SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, size, NULL);
+	*uid = sceKernelAllocMemBlock(name, SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, size, NULL);
 	assert(*uid >= 0);
 
 	//get the base address
 	void *memory = NULL;
 	error = sceKernelGetMemBlockBase(*uid, &memory);
-	vitaPrintf("sceKernelGetMemBlockBase(%d) result: 0x%08X\n", *uid, error);
+	vitaVerbosePrintf("sceKernelGetMemBlockBase(%d) result: 0x%08X\n", *uid, error);
+	memoryTracker.record(name, category, MEMORY_POOL_LPDDR, *uid, memory, requestedSize, size, __builtin_return_address(0));
 	//assert(error == 0);
 	if (error < 0)
 		return NULL;
 
 	//map as vertex USSE code for GPU
-	vitaPrintf("Mapping memory as vertex USSE code for gpu\n");
+	vitaVerbosePrintf("Mapping memory as vertex USSE code for gpu\n");
 	error = sceGxmMapVertexUsseMemory(memory, size, usseOffset);
-	vitaPrintf("sceGxmMapVertexUsseMemory(%d) result: 0x%08X\n", *uid, error);
+	vitaVerbosePrintf("sceGxmMapVertexUsseMemory(%d) result: 0x%08X\n", *uid, error);
 	//assert(error == 0);
 	if (error < 0)
+	{
+		vitaPrintf("ERROR: sceGxmMapVertexUsseMemory(%d) result: 0x%08X\n", *uid, error);
 		return NULL;
+	}
 
 	return memory;
 }
@@ -957,58 +1975,68 @@ void *Graphics::allocVertexUsseMem(unsigned int size, SceUID *uid, unsigned int
 void Graphics::freeVertexUsseMem(SceUID uid)
 {
 	int error = 0;
+	UNUSED(error);
 
-	vitaPrintf("Freeing allocated vertex USSE gpu memory for SceUID: %d\n", uid);
+	vitaVerbosePrintf("Freeing allocated vertex USSE gpu memory for SceUID: %d\n", uid);
+	if (!memoryTracker.remove(uid))
+		return;
 
 	//get base addr
 	void *memory = NULL;
 	error = sceKernelGetMemBlockBase(uid, &memory);
-	vitaPrintf("sceKernelGetMemBlockBase(%d) result: 0x%08X\n", uid, error);
-	assert(error == 0);
+	vitaVerbosePrintf("sceKernelGetMemBlockBase(%d) result: 0x%08X\n", uid, error);
+	//assert(error == 0);
+	if (error < 0)
+		return;
 
 	//unmap
-	vitaPrintf("Unmapping vertex USSE memory\n");
+	vitaVerbosePrintf("Unmapping vertex USSE memory\n");
 	error = sceGxmUnmapVertexUsseMemory(memory);
-	vitaPrintf("sceGxmUnmapVertexUsseMemory(%d) result: 0x%08X\n", uid, error);
+	vitaVerbosePrintf("sceGxmUnmapVertexUsseMemory(%d) result: 0x%08X\n", uid, error);
 	assert(error == 0);
 
 	//free memory
 	error = sceKernelFreeMemBlock(uid);
-	vitaPrintf("sceKernelFreeMemBlock(%d) result: 0x%08X\n", uid, error);
+	vitaVerbosePrintf("sceKernelFreeMemBlock(%d) result: 0x%08X\n", uid, error);
 	assert(error == 0);
 }
 
 //Allocates memory and maps it as a fragment USSE
-void *Graphics::allocFragmentUsseMem(unsigned int size, SceUID *uid, unsigned int *usseOffset)
+void *Graphics::allocFragmentUsseMem(unsigned int size, SceUID *uid, unsigned int *usseOffset, const char* name, MemoryCategory category)
 {
 	int error = 0;
 	UNUSED(error);
 
-	vitaPrintf("Allocating fragment USSE GPU memory...\n");
-	vitaPrintf("SceSize: %u\n", size);
+	vitaVerbosePrintf("Allocating fragment USSE GPU memory...\n");
+	vitaVerbosePrintf("SceSize: %u\n", size);
 
 	//align the memory block for LPDDR (4kb alignment)
+	unsigned int requestedSize = size;
 	size = ALIGN_MEM(size, 4096);
 
 	//allocate the memory
-	*uid = sceKernelAllocMemBlock("fragment_usse", SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, size, NULL);
+	*uid = sceKernelAllocMemBlock(name, SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, size, NULL);
 	assert(*uid >= 0);
 
 	//get the base address
 	void *memory = NULL;
 	error = sceKernelGetMemBlockBase(*uid, &memory);
-	vitaPrintf("sceKernelGetMemBlockBase(%d) result: 0x%08X\n", *uid, error);
+	vitaVerbosePrintf("sceKernelGetMemBlockBase(%d) result: 0x%08X\n", *uid, error);
+	memoryTracker.record(name, category, MEMORY_POOL_LPDDR, *uid, memory, requestedSize, size, __builtin_return_address(0));
 	//assert(error == 0);
 	if (error < 0)
 		return NULL;
 
 	//map as fragment USSE code for GPU
-	vitaPrintf("Mapping memory as fragment USSE code for gpu\n");
+	vitaVerbosePrintf("Mapping memory as fragment USSE code for gpu\n");
 	error = sceGxmMapFragmentUsseMemory(memory, size, usseOffset);
-	vitaPrintf("sceGxmMapFragmentUsseMemory(%d) result: 0x%08X\n", *uid, error);
+	vitaVerbosePrintf("sceGxmMapFragmentUsseMemory(%d) result: 0x%08X\n", *uid, error);
 	//assert(error == 0);
 	if (error < 0)
+	{
+		vitaPrintf("ERROR: sceGxmMapFragmentUsseMemory(%d) result: 0x%08X\n", *uid, error);
 		return NULL;
+	}
 
 	return memory;
 }
@@ -1019,46 +2047,78 @@ void Graphics::freeFragmentUsseMem(SceUID uid)
 	int error = 0;
 	UNUSED(error);
 
-	vitaPrintf("Freeing allocated fragment USSE gpu memory for SceUID: %d\n", uid);
+	vitaVerbosePrintf("Freeing allocated fragment USSE gpu memory for SceUID: %d\n", uid);
+	if (!memoryTracker.remove(uid))
+		return;
 
 	//get base addr
 	void *memory = NULL;
 	error = sceKernelGetMemBlockBase(uid, &memory);
-	vitaPrintf("sceKernelGetMemBlockBase(%d) result: 0x%08X\n", uid, error);
+	vitaVerbosePrintf("sceKernelGetMemBlockBase(%d) result: 0x%08X\n", uid, error);
 	//assert(error == 0);
 	if (error < 0)
 		return;
 
 	//unmap
-	vitaPrintf("Unmapping fragment USSE memory\n");
+	vitaVerbosePrintf("Unmapping fragment USSE memory\n");
 	error = sceGxmUnmapFragmentUsseMemory(memory);
-	vitaPrintf("sceGxmUnmapFragmentUsseMemory(%d) result: 0x%08X\n", uid, error);
+	vitaVerbosePrintf("sceGxmUnmapFragmentUsseMemory(%d) result: 0x%08X\n", uid, error);
 	assert(error == 0);
 
 	//free
 	error = sceKernelFreeMemBlock(uid);
-	vitaPrintf("sceKernelFreeMemBlock(%d) result: 0x%08X\n", uid, error);
+	vitaVerbosePrintf("sceKernelFreeMemBlock(%d) result: 0x%08X\n", uid, error);
 	assert(error == 0);
 }
 
+/*----- Memory budget -----*/
+
+MemoryTracker* Graphics::getMemoryTracker()
+{
+	return &memoryTracker;
+}
+
+SceSize Graphics::getMemoryUsage(MemoryPool pool)
+{
+	SceSize total = memoryTracker.getPoolUsage(pool);
+	//the same memory libgxm allocates for itself that logMemoryBudget() reports
+	if (pool == MEMORY_POOL_LPDDR && initialized)
+		total += config.parameterBufferSize;
+	return total;
+}
+
+void Graphics::logMemoryBudget()
+{
+	vitaPrintf("\nGraphics memory budget\n");
+	memoryTracker.logAllocations();
+
+	//memory libgxm allocates for itself, it is not one of our memblocks
+	if (initialized)
+		vitaPrintf("Also in LPDDR: parameter_buffer %u bytes (allocated by libgxm)\n", config.parameterBufferSize);
+
+	//what is left for everything else
+	SceKernelFreeMemorySizeInfo freeInfo;
+	memset(&freeInfo, 0, sizeof(freeInfo));
+	freeInfo.size = sizeof(freeInfo);
+	if (sceKernelGetFreeMemorySize(&freeInfo) == 0)
+		vitaPrintf("Free memory: CDRAM %.2fMB, LPDDR %.2fMB, physically contiguous %.2fMB\n",
+			freeInfo.size_cdram / (1024.0 * 1024.0), freeInfo.size_user / (1024.0 * 1024.0), freeInfo.size_phycont / (1024.0 * 1024.0));
+}
+
 /*----- Static Callback functions start here -----*/
        /*----- Still Memory functions -----*/
 
 //static callback function which allocates memory for the shader patcher, not a member of Graphics
+//userData is the patcher's HostPool, it is called too often to log every allocation, see HostPool::logStats()
 static void* allocPatcherMem(void *userData, SceSize size)
 {
-	vitaPrintf("Allocating patcher memory\n");
-	vitaPrintf("SceSize: %u\n", size);
-	UNUSED(userData);
-	return malloc(size);
+	return ((HostPool*)userData)->allocate(size);
 }
 
 //static callback which frees shader patcher memory, not a member of Graphics
 static void freePatcherMem(void *userData, void *memory)
 {
-	vitaPrintf("Freeing patcher memory at address: %p\n", memory);
-	UNUSED(userData);
-	free(memory);
+	((HostPool*)userData)->release(memory);
 }
 
 /*----- Memory functions end here -----*/
@@ -1073,20 +2133,77 @@ static void displayBufferCallback(const void *callbackData)
 
 	//cast parameters back
 	const DisplayData* dispData = (const DisplayData *)callbackData;
+	PresentStats* stats = &_presentStats[dispData->mode];
 
-	//swap buffers on the next VSYNC
+	//an earlier callback already flipped to this frame while skipping ahead, it has been on screen since
+	//that vblank. Returning hands its old buffer (never shown) back to the GPU
+	if (dispData->frameIndex <= _lastFlippedFrame)
+		return;
+
+	void* addr = dispData->addr;
+	unsigned int shownFrame = dispData->frameIndex;
+	SceUInt64 shownInputTime = dispData->inputSampleTime;
+	SceUInt64 shownEventTime = dispData->inputEventTime;
+	if (dispData->mode == PRESENT_MODE_LATEST_FRAME)
+	{
+		//if the GPU already finished a newer frame, flip straight to it and drop the ones in between.
+		//The currently displayed buffer is still only released once this callback returns after the vblank
+		unsigned int doneFrame = *_frameDoneNotification;
+		if (doneFrame > shownFrame && (doneFrame - shownFrame) < QUEUED_FRAME_HISTORY)
+		{
+			stats->framesDropped += doneFrame - shownFrame;
+			//a press answered by a dropped frame is first seen in this one
+			for (unsigned int skipped = shownFrame + 1; skipped <= doneFrame; skipped++)
+			{
+				SceUInt64 eventTime = _queuedFrames[skipped % QUEUED_FRAME_HISTORY].inputEventTime;
+				if (eventTime != 0 && (shownEventTime == 0 || eventTime < shownEventTime))
+					shownEventTime = eventTime;
+			}
+			shownFrame = doneFrame;
+			addr = _queuedFrames[doneFrame % QUEUED_FRAME_HISTORY].addr;
+			shownInputTime = _queuedFrames[doneFrame % QUEUED_FRAME_HISTORY].inputSampleTime;
+		}
+	}
+
+	//swap buffers, on the next VSYNC unless presenting immediately
 	memset(&fb, 0x00, sizeof(SceDisplayFrameBuf));
 	fb.size			= sizeof(SceDisplayFrameBuf);
-	fb.base			= dispData->addr;
-	fb.pitch		= DISPLAY_STRIDE_IN_PIXELS;
+	fb.base			= addr;
+	fb.pitch		= _displayStrideInPixels;
 	fb.pixelformat	= DISPLAY_PIXEL_FORMAT;
-	fb.width		= DISPLAY_WIDTH;
-	fb.height		= DISPLAY_HEIGHT;
+	fb.width		= _displayWidth;
+	fb.height		= _displayHeight;
 
-	error = sceDisplaySetFrameBuf(&fb, SCE_DISPLAY_SETBUF_NEXTFRAME);
+	error = sceDisplaySetFrameBuf(&fb, (dispData->mode == PRESENT_MODE_IMMEDIATE) ? SCE_DISPLAY_SETBUF_IMMEDIATE : SCE_DISPLAY_SETBUF_NEXTFRAME);
 	//assert(error == 0);
 
 	//Dont allow this callback unless the buffer swap has finished and the old buffer is no longer displayed
-	sceDisplayWaitVblankStart();
+	if (dispData->mode == PRESENT_MODE_VSYNC_HALF)
+		sceDisplayWaitVblankStartMulti(2);
+	else if (dispData->mode != PRESENT_MODE_IMMEDIATE)
+		sceDisplayWaitVblankStart();
 	//assert(error == 0);
+
+	_lastFlippedFrame = shownFrame;
+	stats->framesDisplayed++;
+	if (shownInputTime != 0)
+	{
+		SceUInt64 latency = sceKernelGetProcessTimeWide() - shownInputTime;
+		stats->latencyTotal += latency;
+		stats->latencySamples++;
+		if (stats->latencyMin == 0 || latency < stats->latencyMin)
+			stats->latencyMin = latency;
+		if (latency > stats->latencyMax)
+			stats->latencyMax = latency;
+	}
+	if (shownEventTime != 0)
+	{
+		SceUInt64 latency = sceKernelGetProcessTimeWide() - shownEventTime;
+		stats->eventLatencyTotal += latency;
+		stats->eventLatencySamples++;
+		if (stats->eventLatencyMin == 0 || latency < stats->eventLatencyMin)
+			stats->eventLatencyMin = latency;
+		if (latency > stats->eventLatencyMax)
+			stats->eventLatencyMax = latency;
+	}
 }
\ No newline at end of file
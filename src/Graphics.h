@@ -6,9 +6,18 @@
 #include <map>
 
 #include <psp2/kernel/sysmem.h>
+#include <psp2/kernel/threadmgr.h>
 #include <psp2/gxm.h>
 #include <psp2/display.h>
 
+#include "GraphicsTelemetry.h"
+#include "DynamicResolution.h"
+#include "TextureCache.h"
+#include "MemoryTracker.h"
+#include "HostPool.h"
+#include "CommandCapture.h"
+#include "GpuHandle.h"
+
 //macros and utilities
 #define RGBA8(r, g, b, a)		((((a)&0xFF)<<24) | (((b)&0xFF)<<16) | (((g)&0xFF)<<8) | (((r)&0xFF)<<0))
 #define ALIGN_MEM(addr, align)	(((addr) + ((align) - 1)) & ~((align) - 1))
@@ -23,7 +32,7 @@
 #define COLOR_WHITE RGBA8(255, 255, 255, 255)
 #define COLOR_BLACK RGBA8(0, 0, 0, 255)
 
-//Define the width and height at native resolution
+//Define the default width and height at native resolution, these can be changed at init with a GraphicsConfig
 #define DISPLAY_WIDTH				960
 #define DISPLAY_HEIGHT				544
 #define DISPLAY_STRIDE_IN_PIXELS	1024
@@ -32,19 +41,34 @@
 #define DISPLAY_COLOR_FORMAT		SCE_GXM_COLOR_FORMAT_A8B8G8R8
 #define DISPLAY_PIXEL_FORMAT		SCE_DISPLAY_PIXELFORMAT_A8B8G8R8
 
-//Define the number of back buffers. 1 (single buffering), 2 (double buffering) or 3 (triple buffering).
+//Maximum number of back buffers that can be chosen at init, storage is sized for this many
+#define DISPLAY_MAX_BUFFER_COUNT	3
+
+//Default number of back buffers. 1 (single buffering), 2 (double buffering) or 3 (triple buffering).
 #define DISPLAY_BUFFER_COUNT		3
 
-/*Maximum number of queued swaps that the display queue will allow.
+/*Default maximum number of queued swaps that the display queue will allow.
 This limits the number of frames that the CPU can get ahead of the GPU,
 The display queue will block during sceGxmDisplayQueueAddEntry if this number of swaps
 have already been queued.
 */
 #define DISPLAY_MAX_PENDING_SWAPS	2
 
-//Anti-aliasing; can be none, 4x or 2x.
+//Slot in the gxm notification region the GPU writes the index of the last finished frame into
+#define NOTIFICATION_FRAME_DONE		0
+//Slot the GPU writes the index of the last finished dynamic resolution scene into
+#define NOTIFICATION_SCENE_DONE		1
+
+//Default anti-aliasing; can be none, 4x or 2x.
 #define MSAA_MODE					SCE_GXM_MULTISAMPLE_NONE
 
+//Default dynamic resolution bounds, in percent of the display size
+#define DRS_MIN_SCALE				50
+#define DRS_MAX_SCALE				100
+
+//Default CDRAM budget for textures streamed through the TextureCache, 0 disables the cache
+#define TEXTURE_CACHE_SIZE			(16 * 1024 * 1024)
+
 //Data structures for vertex types
 //clear geometry
 typedef struct ClearVertex
@@ -80,28 +104,132 @@ typedef enum VertexStreamType
 //patcher buffer sizes
 typedef struct PatcherSizes
 {
-	const SceSize patchBufferSize;
-	const SceSize patchVertexUsseSize;
-	const SceSize patchFragmentUsseSize;
+	SceSize patchBufferSize;
+	SceSize patchVertexUsseSize;
+	SceSize patchFragmentUsseSize;
 } PatcherSizes;
 
 //the default patcher sizes
-static PatcherSizes defaultPatcher = {
+static const PatcherSizes defaultPatcher = {
 	(64 * 1024),	//buffer size
 	(64 * 1024),	//vertex USSE size
 	(64 * 1024)		//fragments USSE size
 };
 
+//How finished frames are handed to the display
+typedef enum PresentMode
+{
+	PRESENT_MODE_VSYNC = 0,		//flip on the next vblank, every frame is shown
+	PRESENT_MODE_VSYNC_HALF,	//flip on the next vblank and hold it for two (30fps on the 60Hz panel)
+	PRESENT_MODE_IMMEDIATE,		//flip as soon as the GPU is done, can tear
+	PRESENT_MODE_LATEST_FRAME	//flip on the next vblank, frames superseded by a newer finished one are dropped
+} PresentMode;
+#define NUMBER_OF_PRESENT_MODES 4
+
+//present settings, bufferCount and maxPendingSwaps can only be changed before initGraphics()
+typedef struct PresentParams
+{
+	PresentMode mode;
+	unsigned int bufferCount;		//1 to DISPLAY_MAX_BUFFER_COUNT
+	unsigned int maxPendingSwaps;	//1 to bufferCount - 1 (or 1 when single buffering)
+} PresentParams;
+
+//the default present settings
+static const PresentParams defaultPresent = {
+	PRESENT_MODE_VSYNC,			//mode
+	DISPLAY_BUFFER_COUNT,		//buffer count
+	DISPLAY_MAX_PENDING_SWAPS	//max pending swaps
+};
+
+/*	Everything initGraphics() needs to know, see GraphicsConfig.h to fill one in with defaults,
+load one from a file and validate it. All sizes are in bytes.
+*/
+typedef struct GraphicsConfig
+{
+	/* Display */
+	unsigned int displayWidth;			//960x544, 720x408, 640x368 or 480x272
+	unsigned int displayHeight;
+	unsigned int displayStrideInPixels;	//at least displayWidth, a multiple of 64
+	SceGxmMultisampleMode msaaMode;
+	PresentParams present;
+
+	/* libgxm */
+	unsigned int gxmInitFlags;
+	SceSize parameterBufferSize;		//allocated by libgxm itself during sceGxmInitialize()
+
+	/* Context ring buffers and host memory */
+	SceSize vdmRingBufferSize;
+	SceSize vertexRingBufferSize;
+	SceSize fragmentRingBufferSize;
+	SceSize fragmentUsseRingBufferSize;
+	SceSize contextHostMemSize;
+
+	/* Shader patcher */
+	PatcherSizes patcher;
+
+	/* Telemetry */
+	unsigned int calibrationFrames;		//when non zero, recommend buffer sizes after this many frames
+
+	/* Dynamic resolution */
+	bool dynamicResolution;				//render offscreen at a size picked from the GPU frame time, then scale it to the display
+	unsigned int drsMinScale;			//percent of the display size, 10 to 100
+	unsigned int drsMaxScale;
+	SceUInt64 drsTargetFrameTime;		//microseconds of GPU time per frame, 0 follows the present mode
+
+	/* Textures */
+	SceSize textureCacheSize;			//CDRAM kept for resident textures, a multiple of 256kB, 0 disables the cache
+
+	/* Memory tracking */
+	SceSize memoryBudgets[NUMBER_OF_MEMORY_CATEGORIES];	//bytes each MemoryCategory may hold across all pools, 0 for no limit
+	bool memoryBudgetStrict;			//assert when a budget is exceeded instead of only logging it
+
+	/* Debugging */
+	bool debugFill;						//fill the display buffers with red at init, so anything never drawn over stands out
+	bool verboseLog;					//log every init step, allocation and patcher call, see Logger::writeVerbose()
+} GraphicsConfig;
+
+//Frame statistics gathered per present mode, all times are in microseconds
+typedef struct PresentStats
+{
+	unsigned int framesQueued;		//frames handed to the display queue
+	unsigned int framesDisplayed;	//frames that were actually flipped to the screen
+	unsigned int framesDropped;		//frames superseded before they were shown (latest frame mode only)
+	SceUInt64 frameTimeTotal;		//time between swapBuffers() calls
+	SceUInt64 frameTimeMin;
+	SceUInt64 frameTimeMax;
+	SceUInt64 latencyTotal;			//time from input being sampled to the frame being flipped
+	SceUInt64 latencyMin;
+	SceUInt64 latencyMax;
+	unsigned int latencySamples;
+	SceUInt64 eventLatencyTotal;	//time from a button press to the first frame that responded to it being flipped
+	SceUInt64 eventLatencyMin;
+	SceUInt64 eventLatencyMax;
+	unsigned int eventLatencySamples;
+} PresentStats;
+
 /*	Structure to pass to displayQueue.  Used during sceGxmDisplayQueueAddEntry, 
 and is used to pass data to the display callback function, called from an internal
 thread once the back buffer is ready to be displayed.
-For this program, we only need to pass the base address of the buffer.
+Along with the base address of the buffer, the present mode and frame index travel
+with each frame so the callback never has to read state the render thread is changing.
 */
 typedef struct DisplayData
 {
 	void *addr;
+	PresentMode mode;
+	unsigned int frameIndex;
+	SceUInt64 inputSampleTime;
+	SceUInt64 inputEventTime;
 } DisplayData;
 
+//One piece of a batched allocation, see Graphics::allocGraphicsMemBatch()
+typedef struct GraphicsMemRequest
+{
+	unsigned int size;
+	unsigned int alignment;
+	void* memory;			//filled in by the allocation
+} GraphicsMemRequest;
+
 //C++ singleton Graphics class
 class Graphics
 {
@@ -114,31 +242,137 @@ public:
 	static Graphics* getInstance();
 
 	//Initializes the GXM, allocates ring buffer memory for vertexes, fragments, maps memory, everything
-	//TO DO: either make a few more overloads which accept gxmInitParams, gxmContextParams &/or RenderTargetParams or template the function
-	//TO DO: return something to indicate success
-	void initGraphics();
-	void initGraphics(SceGxmInitializeParams* parameters);
+	//Returns false if the configuration does not validate, nothing is initialized in that case
+	bool initGraphics();
+	//Uses the default configuration with the parameter buffer size, display queue depth and flags taken from parameters
+	bool initGraphics(SceGxmInitializeParams* parameters);
+	bool initGraphics(const GraphicsConfig* configuration);
 	void shutdownGraphics();
 
+	//The configuration the graphics system was initialized with
+	const GraphicsConfig* getConfig();
+	//Logs where every byte of CDRAM, LPDDR and host memory owned by the graphics system went
+	void logMemoryBudget();
+	//Bytes the graphics system holds in a pool right now, memblock padding included
+	SceSize getMemoryUsage(MemoryPool pool);
+	//Every allocation made through Graphics, for budgets, snapshots and the leak report
+	MemoryTracker* getMemoryTracker();
+
+	//Per frame bookkeeping (the texture cache's frame), startScene() does it if nothing has yet this frame
+	void beginFrame();
 	void startScene();
 	void endScene();
 	void swapBuffers();
+
+	/*----- Offscreen scenes -----*/
+	//A render target for scenes of width x height, scenesPerFrame is how many of them one frame renders.
+	//Its driver memory is allocated here, recorded in the tracker under name, and is the handle's getUID()
+	GpuRenderTarget createRenderTarget(unsigned int width, unsigned int height, unsigned int scenesPerFrame,
+		SceGxmMultisampleMode msaaMode, const char* name = "render_target");
+	//The GPU must be done with every scene that used it
+	void destroyRenderTarget(SceGxmRenderTarget* renderTarget, SceUID driverUID);
+	//A scene that renders into color and/or depth rather than the back buffer, it has to end before startScene().
+	//The viewport and region clip cover width x height
+	void beginOffscreenScene(const SceGxmRenderTarget* renderTarget, const SceGxmColorSurface* color,
+		const SceGxmDepthStencilSurface* depthStencil, unsigned int width, unsigned int height);
+	void endOffscreenScene();
+	//Waits until the GPU has finished every frame submitted so far, after this their memory can be freed
+	void finish();
+
+	/*----- Deferred release -----*/
+	//Frees the resource once the GPU has finished the frame being recorded, which may still draw with it.
+	//beginFrame() frees whatever is due and shutdownGraphics() the rest, nothing waits on the GPU for it.
+	//Releases of one frame happen in the order they were queued. GpuHandle does this for whatever it owns
+	void deferRelease(GpuResourceType type, void* resource, SceUID uid = -1);
+	//Releases queued and not yet done
+	unsigned int getPendingReleaseCount();
+
+	/*----- Presentation -----*/
+	//Must be called before initGraphics() to change the buffer count or pending swaps, the mode can be changed any time
+	void setPresentParams(const PresentParams* params);
+	void setPresentMode(PresentMode mode);
+	PresentMode getPresentMode();
+	//Index of the frame being recorded, and of the last frame the GPU finished. Data written for frame n
+	//(dynamic vertices, per frame uniforms) can be reused once getCompletedFrameIndex() reaches n
+	unsigned int getFrameIndex();
+	unsigned int getCompletedFrameIndex();
+	//The time (sceKernelGetProcessTimeWide) the input driving the next frame was sampled, used for latency stats
+	void setInputSampleTime(SceUInt64 sampleTime);
+	//The time of the oldest button press the next frame responds to, only for that frame. Feeds the event latency stats
+	void setInputEventTime(SceUInt64 eventTime);
+	void getPresentStats(PresentMode mode, PresentStats* stats);
+	void resetPresentStats();
+	void logPresentStats();
+
+	/*----- Telemetry -----*/
+	//Ring buffer and parameter buffer pressure, see GraphicsTelemetry.h for what is measured and what is estimated
+	const GraphicsStats* getStats();
+	//Logs recommended ring and parameter buffer sizes for the configuration after frames frames
+	void startCalibration(unsigned int frames);
+	void logStats();
+	//Counts triangles drawn at a level of detail for this frame, Mesh::drawLod() calls this
+	void recordLodDraw(unsigned int lod, unsigned int triangles);
+
+	/*----- Dynamic resolution -----*/
+	//nullptr unless the configuration enabled dynamic resolution
+	const DynamicResolutionStats* getDynamicResolutionStats();
+
+	/*----- Textures -----*/
+	//nullptr when the configuration has no texture cache budget
+	TextureCache* getTextureCache();
+	//Binds a texture to a fragment texture unit for the following draws
+	void setFragmentTexture(unsigned int unit, const SceGxmTexture* texture);
+
+	/*----- Capture -----*/
+	//Records everything submitted through Graphics for the next frames frames into a file the CaptureReplay can
+	//submit again, see CommandCapture.h. The file is written when the last frame is swapped
+	bool startCapture(const char* path, unsigned int frames);
+	bool isCapturing();
+
 	void clearScreen();
 	void clearScreen(uint32_t color);
 
 	void draw(SceGxmPrimitiveType primitive, SceGxmIndexFormat format, const void *indexData, unsigned int indexCount);
+	//indexCount / indexWrap instances of the first indexWrap indices. Streams with an instance index source are read once per
+	//instance, the rest once per index. Captures keep one vertex stream, instanced draws aren't captured
+	void drawInstanced(SceGxmPrimitiveType primitive, SceGxmIndexFormat format, const void *indexData, unsigned int indexCount, unsigned int indexWrap);
 
 	/*----- For dealing with shaders -----*/
 	//Register shader programs with the patcher
 	SceGxmShaderPatcherId patcherRegisterProgram(const SceGxmProgram *const programHeader);
-	//int patcherUnregisterProgram(SceGxmShaderPatcherId programID); now uses a private method to do this all at once during shutdown
+	//Programs still registered at shutdown are unregistered then, every vertex and fragment program made from it must be released first
+	int patcherUnregisterProgram(SceGxmShaderPatcherId programID);
 	void patcherSetProgramCreationParams(VertexStreamType vertexStreamType); //TO DO: only supports 1 vertex stream, change this. Also, make overloads to change other parameters (i.e. blend modes, SceGxmOutputRegisterFormat, etc)
-	SceGxmVertexProgram* patcherCreateVertexProgram(SceGxmShaderPatcherId programID, SceGxmVertexAttribute* attributes, int attributeCount, ...); //the arguments to pass are the names of the attributes as found in shader binary
-	SceGxmFragmentProgram* patcherCreateFragmentProgram(SceGxmShaderPatcherId programID, SceGxmShaderPatcherId vertexProgramID);
+	//The patcherCreate*() programs come in handles, dropping one queues the program for release
+	GpuVertexProgram patcherCreateVertexProgram(SceGxmShaderPatcherId programID, SceGxmVertexAttribute* attributes, int attributeCount, ...); //the arguments to pass are the names of the attributes as found in shader binary
+	//For vertex layouts that aren't one of the VertexStreamTypes, like a loaded Mesh. names holds one shader input name per attribute.
+	//stream points at streamCount streams, more than one for instancing
+	GpuVertexProgram patcherCreateVertexProgram(SceGxmShaderPatcherId programID, SceGxmVertexAttribute* attributes, int attributeCount, const SceGxmVertexStream* stream, const char* const* names,
+		unsigned int streamCount = 1);
+	//blendInfo is baked into the program, NULL writes the fragment color as is
+	GpuFragmentProgram patcherCreateFragmentProgram(SceGxmShaderPatcherId programID, SceGxmShaderPatcherId vertexProgramID, const SceGxmBlendInfo* blendInfo = NULL);
+	//Thread safe, for the ProgramCache's thread: only patches, under the patcher lock, nothing is logged or recorded.
+	//The attributes' regIndex must be filled in. Returns the patcher's result
+	int patcherPatchVertexProgram(SceGxmShaderPatcherId programID, const SceGxmVertexAttribute* attributes, int attributeCount,
+		const SceGxmVertexStream* stream, SceGxmVertexProgram** program, unsigned int streamCount = 1);
+	int patcherPatchFragmentProgram(SceGxmShaderPatcherId programID, SceGxmShaderPatcherId vertexProgramID, const SceGxmBlendInfo* blendInfo,
+		SceGxmFragmentProgram** program);
+	//Render thread: takes on a program patched by the above like one patcherCreate*() made, before anything draws with it
+	void patcherAdoptVertexProgram(SceGxmVertexProgram* program, SceGxmShaderPatcherId programID, const SceGxmVertexAttribute* attributes,
+		int attributeCount, const char* const* names, const SceGxmVertexStream* stream, unsigned int streamCount = 1);
+	void patcherAdoptFragmentProgram(SceGxmFragmentProgram* program, SceGxmShaderPatcherId programID, SceGxmShaderPatcherId vertexProgramID,
+		const SceGxmBlendInfo* blendInfo);
+	//The GPU must be done with every draw that used the program
+	void patcherReleaseVertexProgram(SceGxmVertexProgram* program);
+	void patcherReleaseFragmentProgram(SceGxmFragmentProgram* program);
 	void patcherSetVertexProgram(const SceGxmVertexProgram* program);
 	void patcherSetFragmentProgram(const SceGxmFragmentProgram* program);
 	void patcherSetVertexStream(unsigned int streamIndex, const void* stream);
 	void patcherSetVertexProgramConstants(void* uniformBuffer, const SceGxmProgramParameter* worldViewProjection, unsigned int componentOffset, unsigned int componentCount, const float *sourceData);
+	void patcherSetFragmentProgramConstants(const SceGxmProgramParameter* parameter, unsigned int componentOffset, unsigned int componentCount, const float *sourceData);
+	//Binds buffer as the vertex program's uniform buffer bufferIndex (a ": BUFFER[n]" uniform) for the draws that follow.
+	//Nothing is copied, the GPU reads the memory when it draws, see UniformBuffer.h
+	void patcherSetVertexUniformBuffer(unsigned int bufferIndex, const void* buffer);
 
 private:
 	//There is no need for these member vars to be declared static, being in a singleton class makes them so by default
@@ -154,16 +388,70 @@ private:
 	SceGxmRenderTargetParams gxmRenderTargetParams;
 
 	/* Display buffers, color surfaces and sync objects */
-	//Frame buffers for multibuffering
-	void* _displayBuffers[DISPLAY_BUFFER_COUNT];
-	SceUID _displayBufferUIDs[DISPLAY_BUFFER_COUNT];
+	//Frame buffers for multibuffering, only the first presentParams.bufferCount are used
+	void* _displayBuffers[DISPLAY_MAX_BUFFER_COUNT];
+	//all of them are one memblock, see allocGraphicsMemBatch()
+	SceUID displayBuffersUID;
 	//GXM color surfaces and sync objects for much faster rendering
-	SceGxmColorSurface _colorSurfaces[DISPLAY_BUFFER_COUNT];
-	SceGxmSyncObject* _displaySyncObjects[DISPLAY_BUFFER_COUNT];
+	SceGxmColorSurface _colorSurfaces[DISPLAY_MAX_BUFFER_COUNT];
+	SceGxmSyncObject* _displaySyncObjects[DISPLAY_MAX_BUFFER_COUNT];
 	/* frame buffer indexes */
 	unsigned int backBufIndex;
 	unsigned int frontBufIndex;
 
+	//all of the settings, config.present is changed at runtime by the presentation functions
+	GraphicsConfig config;
+
+	/* Presentation */
+	unsigned int frameIndex;		//index of the last frame handed to the display queue
+	SceUInt64 lastSwapTime;
+	SceUInt64 inputSampleTime;
+	SceUInt64 inputEventTime;		//0 when the frame being recorded doesn't respond to a press
+	bool frameBegun;				//beginFrame() ran for the frame being recorded
+	//the GPU writes the index of each frame here once it finishes rendering it
+	volatile unsigned int* frameDoneNotification_ptr;
+
+	GraphicsTelemetry telemetry;
+
+	/* Dynamic resolution */
+	DynamicResolution dynamicResolution;
+	//the GPU writes the index of each frame here once its offscreen scene is rendered
+	volatile unsigned int* sceneDoneNotification_ptr;
+	//the scene renders into the top left of this display sized buffer, then is scaled into the back buffer
+	void* offscreenBuf_ptr;
+	SceUID offscreenBufUID;
+	SceGxmColorSurface offscreenSurface;
+	SceGxmTexture offscreenTexture;
+	//full screen triangle that samples the offscreen buffer
+	SceGxmShaderPatcherId blitVertexProgramID;
+	SceGxmShaderPatcherId blitFragmentProgramID;
+	GpuVertexProgram blitVertexProgram;
+	GpuFragmentProgram blitFragmentProgram;
+	const SceGxmProgramParameter* blitUvScaleParam_ptr;
+	const SceGxmProgramParameter* blitUvMaxParam_ptr;
+	ClearVertex* blitVertices_ptr;
+	uint16_t* blitIndices_ptr;
+	SceUID blitVerticesUID;
+	SceUID blitIndicesUID;
+
+	/* Deferred release */
+	typedef struct PendingRelease
+	{
+		GpuResourceType type;
+		void* resource;
+		SceUID uid;
+		unsigned int frame;			//freed once getCompletedFrameIndex() reaches it
+	} PendingRelease;
+	//in the order they were queued, which is frame order too
+	std::vector<PendingRelease> _pendingReleases;
+	unsigned int releasedCounts[NUMBER_OF_GPU_RESOURCE_TYPES];
+
+	/* Textures */
+	TextureCache textureCache;
+
+	//sees every program, state change and draw made through Graphics, records them while a capture runs
+	CommandCapture commandCapture;
+
 	/* Ring buffers */
 	//TO DO: further comment the purpose/function of each of these
 	//ring buffers
@@ -172,14 +460,16 @@ private:
 	void* fragmentRingBuf_ptr;
 	void* fragmentUsseRingBuf_ptr;
 	void* vertexUsseRingBuf_ptr;
-	SceUID vdmRingBufUID;
-	SceUID vertexRingBufUID;
-	SceUID fragmentRingBufUID;
+	//the VDM, vertex and fragment rings share one memblock
+	SceUID ringBufUID;
 	SceUID fragmentUsseRingBufUID;
 	SceUID vertexUsseRingBufUID;
 	unsigned int fragmentUsseRingBufOffset;
 	unsigned int vertexUsseRingBufOffset;
 
+	//render target driver memory, sized by sceGxmGetRenderTargetMemSize() so it shows up in the budget
+	SceUID renderTargetDriverUID;
+
 	//depth buffer
 	void* depthBuf_ptr;
 	SceUID depthBufUID;
@@ -197,6 +487,10 @@ private:
 	SceUID patcherFragmentUsseUID;
 	void* patcherFragmentUsse_ptr;
 	unsigned int patcherFragmentUsseOffset;
+	//serves the patcher's host allocations, passed to its callbacks as userData
+	HostPool patcherHostPool;
+	//held around every patcher call, programs are patched on the ProgramCache's thread too
+	SceKernelLwMutexWork patcherLock;
 	//all of the registered programs
 	std::vector<SceGxmShaderPatcherId> _registeredProgramIDs;
 	std::vector<SceGxmVertexProgram*> _vertexPrograms;
@@ -211,23 +505,42 @@ private:
 	//internal initialize functions
 	//The shader patcher initialization is put into its own method to keep the total initialization code easier to read
 	void initShaderPatcher(PatcherSizes* sizes);
+	//Allocates the offscreen buffer and blit programs, starts the GPU timer
+	void initDynamicResolution();
+	void shutdownDynamicResolution();
+	//Scales the offscreen render into the back buffer, as its own scene
+	void blitScaledScene();
+	//Viewport and region clip covering the top left width x height pixels of the render target
+	void setRenderRegion(unsigned int width, unsigned int height);
+	//Releases the vertex and fragment programs still alive and unregisters every program, for shutdown
 	void patcherUnregisterPrograms();
+	//Frees the queued releases the GPU is done with, or every one of them once it is idle
+	void processReleases(bool all);
+	void release(const PendingRelease* pending);
 
 	//Callback and memory related methods
-	//Allocates memory and maps it to the GPU
+	//Allocates memory and maps it to the GPU, name labels the memblock and, with category, its entry in the memory tracker
 public:
-	void *allocGraphicsMem(SceKernelMemBlockType type, unsigned int size, unsigned int alignment, unsigned int attribs, SceUID *uid);
+	void *allocGraphicsMem(SceKernelMemBlockType type, unsigned int size, unsigned int alignment, unsigned int attribs, SceUID *uid,
+		const char* name = "gpu_mem", MemoryCategory category = MEMORY_CATEGORY_OTHER);
 	void freeGraphicsMem(SceUID uid);
+	//Allocates every request out of one memblock with one mapping, for memory that lives and dies together.
+	//Fills in each request's memory and returns the first, freeGraphicsMem(uid) frees them all
+	void *allocGraphicsMemBatch(SceKernelMemBlockType type, GraphicsMemRequest* requests, unsigned int count, unsigned int attribs,
+		SceUID *uid, const char* name, MemoryCategory category = MEMORY_CATEGORY_OTHER);
 private:
 
 	//Allocates memory and maps it as a vertex USSE
-	void *allocVertexUsseMem(unsigned int size, SceUID *uid, unsigned int *usseOffset);
+	void *allocVertexUsseMem(unsigned int size, SceUID *uid, unsigned int *usseOffset, const char* name = "vertex_usse", MemoryCategory category = MEMORY_CATEGORY_SHADERS);
 	void freeVertexUsseMem(SceUID uid);
 
 	//Allocates memory and maps it as a fragment USSE
-	void *allocFragmentUsseMem(unsigned int size, SceUID *uid, unsigned int *usseOffset); 
+	void *allocFragmentUsseMem(unsigned int size, SceUID *uid, unsigned int *usseOffset, const char* name = "fragment_usse", MemoryCategory category = MEMORY_CATEGORY_SHADERS);
 	void freeFragmentUsseMem(SceUID uid);
 
+	//Every memblock and host allocation the graphics system makes is recorded here until it is freed
+	MemoryTracker memoryTracker;
+
 	//These are static callback functions, they will not be members of Graphics
 	//Callback function which allocates memory for the shader patcher
 	//void* allocPatcherMem(void *userData, SceSize size);
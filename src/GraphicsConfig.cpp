@@ -0,0 +1,346 @@
+#include "GraphicsConfig.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <fstream>
+#include <string>
+
+//Display resolutions sceDisplaySetFrameBuf() accepts
+static const unsigned int _displayModes[][2] = { { 960, 544 }, { 720, 408 }, { 640, 368 }, { 480, 272 } };
+#define NUMBER_OF_DISPLAY_MODES 4
+
+static const char* _msaaNames[] = { "none", "2x", "4x" };
+static const char* _presentModeKeys[NUMBER_OF_PRESENT_MODES] = { "vsync", "vsync_half", "immediate", "latest_frame" };
+
+void getDefaultGraphicsConfig(GraphicsConfig* config)
+{
+	memset(config, 0, sizeof(GraphicsConfig));
+
+	/* Display */
+	config->displayWidth = DISPLAY_WIDTH;
+	config->displayHeight = DISPLAY_HEIGHT;
+	config->displayStrideInPixels = DISPLAY_STRIDE_IN_PIXELS;
+	config->msaaMode = MSAA_MODE;
+	config->present = defaultPresent;
+
+	/* libgxm */
+	config->gxmInitFlags = 0;
+	config->parameterBufferSize = SCE_GXM_DEFAULT_PARAMETER_BUFFER_SIZE;
+
+	/* Context ring buffers and host memory */
+	config->vdmRingBufferSize = SCE_GXM_DEFAULT_VDM_RING_BUFFER_SIZE;
+	config->vertexRingBufferSize = SCE_GXM_DEFAULT_VERTEX_RING_BUFFER_SIZE;
+	config->fragmentRingBufferSize = SCE_GXM_DEFAULT_FRAGMENT_RING_BUFFER_SIZE;
+	config->fragmentUsseRingBufferSize = SCE_GXM_DEFAULT_FRAGMENT_USSE_RING_BUFFER_SIZE;
+	config->contextHostMemSize = SCE_GXM_MINIMUM_CONTEXT_HOST_MEM_SIZE;
+
+	/* Shader patcher */
+	config->patcher = defaultPatcher;
+
+	/* Telemetry */
+	config->calibrationFrames = 0;
+
+	/* Dynamic resolution */
+	config->dynamicResolution = false;
+	config->drsMinScale = DRS_MIN_SCALE;
+	config->drsMaxScale = DRS_MAX_SCALE;
+	config->drsTargetFrameTime = 0;
+
+	/* Textures */
+	config->textureCacheSize = TEXTURE_CACHE_SIZE;
+
+	/* Memory tracking */
+	for (int i = 0; i < NUMBER_OF_MEMORY_CATEGORIES; i++)
+		config->memoryBudgets[i] = 0;
+	config->memoryBudgetStrict = false;
+
+	/* Debugging */
+	config->debugFill = false;
+	config->verboseLog = false;
+}
+
+//parses a decimal or 0x prefixed number with an optional K or M suffix
+static bool parseSize(const char* text, SceSize* value)
+{
+	char* end = NULL;
+	unsigned long number = strtoul(text, &end, 0);
+	if (end == text)
+		return false;
+
+	if (*end == 'K' || *end == 'k')
+	{
+		number *= 1024;
+		end++;
+	}
+	else if (*end == 'M' || *end == 'm')
+	{
+		number *= 1024 * 1024;
+		end++;
+	}
+
+	if (*end != '\0')
+		return false;
+
+	*value = (SceSize)number;
+	return true;
+}
+
+//returns text without its leading/trailing whitespace
+static std::string trim(const std::string& text)
+{
+	size_t first = text.find_first_not_of(" \t\r\n");
+	if (first == std::string::npos)
+		return "";
+	size_t last = text.find_last_not_of(" \t\r\n");
+	return text.substr(first, last - first + 1);
+}
+
+//applies one key/value pair, returns false for unknown keys or bad values
+static bool applySetting(GraphicsConfig* config, const std::string& key, const std::string& value)
+{
+	SceSize number = 0;
+	const char* text = value.c_str();
+
+	if (key == "msaa")
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			if (value == _msaaNames[i])
+			{
+				config->msaaMode = (SceGxmMultisampleMode)i;
+				return true;
+			}
+		}
+		return false;
+	}
+	if (key == "present_mode")
+	{
+		for (int i = 0; i < NUMBER_OF_PRESENT_MODES; i++)
+		{
+			if (value == _presentModeKeys[i])
+			{
+				config->present.mode = (PresentMode)i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//everything else is a number
+	if (!parseSize(text, &number))
+		return false;
+
+	//memory_budget_ followed by a category name
+	for (int i = 0; i < NUMBER_OF_MEMORY_CATEGORIES; i++)
+	{
+		if (key == std::string("memory_budget_") + MemoryTracker::getCategoryName((MemoryCategory)i))
+		{
+			config->memoryBudgets[i] = number;
+			return true;
+		}
+	}
+
+	if (key == "display_width")							config->displayWidth = number;
+	else if (key == "display_height")					config->displayHeight = number;
+	else if (key == "display_stride")					config->displayStrideInPixels = number;
+	else if (key == "buffer_count")						config->present.bufferCount = number;
+	else if (key == "max_pending_swaps")				config->present.maxPendingSwaps = number;
+	else if (key == "gxm_flags")						config->gxmInitFlags = number;
+	else if (key == "parameter_buffer_size")			config->parameterBufferSize = number;
+	else if (key == "vdm_ring_buffer_size")				config->vdmRingBufferSize = number;
+	else if (key == "vertex_ring_buffer_size")			config->vertexRingBufferSize = number;
+	else if (key == "fragment_ring_buffer_size")		config->fragmentRingBufferSize = number;
+	else if (key == "fragment_usse_ring_buffer_size")	config->fragmentUsseRingBufferSize = number;
+	else if (key == "context_host_mem_size")			config->contextHostMemSize = number;
+	else if (key == "patcher_buffer_size")				config->patcher.patchBufferSize = number;
+	else if (key == "patcher_vertex_usse_size")			config->patcher.patchVertexUsseSize = number;
+	else if (key == "patcher_fragment_usse_size")		config->patcher.patchFragmentUsseSize = number;
+	else if (key == "calibration_frames")				config->calibrationFrames = number;
+	else if (key == "dynamic_resolution")				config->dynamicResolution = (number != 0);
+	else if (key == "drs_min_scale")					config->drsMinScale = number;
+	else if (key == "drs_max_scale")					config->drsMaxScale = number;
+	else if (key == "drs_target_frame_time")			config->drsTargetFrameTime = number;
+	else if (key == "texture_cache_size")				config->textureCacheSize = number;
+	else if (key == "memory_budget_strict")				config->memoryBudgetStrict = (number != 0);
+	else if (key == "debug_fill")						config->debugFill = (number != 0);
+	else if (key == "verbose_log")						config->verboseLog = (number != 0);
+	else
+		return false;
+
+	return true;
+}
+
+bool loadGraphicsConfig(const char* path, GraphicsConfig* config)
+{
+	vitaPrintf("\nLoading graphics configuration from: %s\n", path);
+
+	std::ifstream inStream(path);
+	if (!inStream.is_open())
+	{
+		vitaPrintf("Could not open the configuration file, keeping the current settings\n");
+		return false;
+	}
+
+	bool result = true;
+	int lineNumber = 0;
+	std::string line;
+	while (std::getline(inStream, line))
+	{
+		lineNumber++;
+
+		//drop comments and blank lines
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+		line = trim(line);
+		if (line.empty())
+			continue;
+
+		size_t separator = line.find('=');
+		if (separator == std::string::npos)
+		{
+			vitaPrintf("ERROR: line %d has no '=': %s\n", lineNumber, line.c_str());
+			result = false;
+			continue;
+		}
+
+		std::string key = trim(line.substr(0, separator));
+		std::string value = trim(line.substr(separator + 1));
+		if (!applySetting(config, key, value))
+		{
+			vitaPrintf("ERROR: line %d, bad setting '%s' = '%s'\n", lineNumber, key.c_str(), value.c_str());
+			result = false;
+		}
+	}
+
+	return result;
+}
+
+//checks a memblock backed size, the memblocks themselves are rounded up to 4kB pages
+static bool validateSize(const char* name, SceSize size, SceSize minimum)
+{
+	if (size < minimum)
+	{
+		vitaPrintf("ERROR: %s is %u bytes, it must be at least %u\n", name, size, minimum);
+		return false;
+	}
+	if (size % 4096 != 0)
+		vitaPrintf("Note: %s (%u) is not a multiple of 4kB, the rest of its last page is wasted\n", name, size);
+	return true;
+}
+
+bool validateGraphicsConfig(const GraphicsConfig* config)
+{
+	bool valid = true;
+
+	/* Display */
+	bool supportedMode = false;
+	for (int i = 0; i < NUMBER_OF_DISPLAY_MODES; i++)
+	{
+		if (config->displayWidth == _displayModes[i][0] && config->displayHeight == _displayModes[i][1])
+			supportedMode = true;
+	}
+	if (!supportedMode)
+	{
+		vitaPrintf("ERROR: %ux%u is not a resolution the display supports\n", config->displayWidth, config->displayHeight);
+		valid = false;
+	}
+	if (config->displayStrideInPixels < config->displayWidth || (config->displayStrideInPixels % 64) != 0)
+	{
+		vitaPrintf("ERROR: display stride %u must be at least the width and a multiple of 64\n", config->displayStrideInPixels);
+		valid = false;
+	}
+	if (config->msaaMode != SCE_GXM_MULTISAMPLE_NONE && config->msaaMode != SCE_GXM_MULTISAMPLE_2X && config->msaaMode != SCE_GXM_MULTISAMPLE_4X)
+	{
+		vitaPrintf("ERROR: unknown multisample mode %u\n", config->msaaMode);
+		valid = false;
+	}
+
+	/* Presentation */
+	if (config->present.mode >= NUMBER_OF_PRESENT_MODES)
+	{
+		vitaPrintf("ERROR: unknown present mode %u\n", config->present.mode);
+		valid = false;
+	}
+	if (config->present.bufferCount < 1 || config->present.bufferCount > DISPLAY_MAX_BUFFER_COUNT)
+	{
+		vitaPrintf("ERROR: buffer count %u must be between 1 and %u\n", config->present.bufferCount, DISPLAY_MAX_BUFFER_COUNT);
+		valid = false;
+	}
+	unsigned int maxPending = (config->present.bufferCount > 1) ? config->present.bufferCount - 1 : 1;
+	if (config->present.maxPendingSwaps < 1 || config->present.maxPendingSwaps > maxPending)
+	{
+		vitaPrintf("ERROR: max pending swaps %u must be between 1 and %u for %u buffers\n",
+			config->present.maxPendingSwaps, maxPending, config->present.bufferCount);
+		valid = false;
+	}
+
+	/* libgxm and context */
+	valid &= validateSize("parameter_buffer_size", config->parameterBufferSize, 1024 * 1024);
+	valid &= validateSize("vdm_ring_buffer_size", config->vdmRingBufferSize, 4096);
+	valid &= validateSize("vertex_ring_buffer_size", config->vertexRingBufferSize, 4096);
+	valid &= validateSize("fragment_ring_buffer_size", config->fragmentRingBufferSize, 4096);
+	valid &= validateSize("fragment_usse_ring_buffer_size", config->fragmentUsseRingBufferSize, 4096);
+	if (config->contextHostMemSize < SCE_GXM_MINIMUM_CONTEXT_HOST_MEM_SIZE)
+	{
+		vitaPrintf("ERROR: context_host_mem_size %u is below the libgxm minimum of %u\n", config->contextHostMemSize, SCE_GXM_MINIMUM_CONTEXT_HOST_MEM_SIZE);
+		valid = false;
+	}
+
+	/* Shader patcher */
+	valid &= validateSize("patcher_buffer_size", config->patcher.patchBufferSize, 4096);
+	valid &= validateSize("patcher_vertex_usse_size", config->patcher.patchVertexUsseSize, 4096);
+	valid &= validateSize("patcher_fragment_usse_size", config->patcher.patchFragmentUsseSize, 4096);
+
+	/* Dynamic resolution */
+	if (config->dynamicResolution && (config->drsMinScale < 10 || config->drsMinScale > config->drsMaxScale || config->drsMaxScale > 100))
+	{
+		vitaPrintf("ERROR: dynamic resolution scales must be 10 <= drs_min_scale (%u) <= drs_max_scale (%u) <= 100\n",
+			config->drsMinScale, config->drsMaxScale);
+		valid = false;
+	}
+
+	/* Textures */
+	//the cache is a single CDRAM memblock and those come in 256kB steps
+	if (config->textureCacheSize % (256 * 1024) != 0)
+	{
+		vitaPrintf("ERROR: texture_cache_size %u is not a multiple of 256kB\n", config->textureCacheSize);
+		valid = false;
+	}
+
+	return valid;
+}
+
+void logGraphicsConfig(const GraphicsConfig* config)
+{
+	vitaPrintf("\nGraphics configuration...\n");
+	vitaPrintf("display_width = %u\n", config->displayWidth);
+	vitaPrintf("display_height = %u\n", config->displayHeight);
+	vitaPrintf("display_stride = %u\n", config->displayStrideInPixels);
+	vitaPrintf("msaa = %s\n", (config->msaaMode < 3) ? _msaaNames[config->msaaMode] : "?");
+	vitaPrintf("present_mode = %s\n", (config->present.mode < NUMBER_OF_PRESENT_MODES) ? _presentModeKeys[config->present.mode] : "?");
+	vitaPrintf("buffer_count = %u\n", config->present.bufferCount);
+	vitaPrintf("max_pending_swaps = %u\n", config->present.maxPendingSwaps);
+	vitaPrintf("gxm_flags = 0x%08X\n", config->gxmInitFlags);
+	vitaPrintf("parameter_buffer_size = %u\n", config->parameterBufferSize);
+	vitaPrintf("vdm_ring_buffer_size = %u\n", config->vdmRingBufferSize);
+	vitaPrintf("vertex_ring_buffer_size = %u\n", config->vertexRingBufferSize);
+	vitaPrintf("fragment_ring_buffer_size = %u\n", config->fragmentRingBufferSize);
+	vitaPrintf("fragment_usse_ring_buffer_size = %u\n", config->fragmentUsseRingBufferSize);
+	vitaPrintf("context_host_mem_size = %u\n", config->contextHostMemSize);
+	vitaPrintf("patcher_buffer_size = %u\n", config->patcher.patchBufferSize);
+	vitaPrintf("patcher_vertex_usse_size = %u\n", config->patcher.patchVertexUsseSize);
+	vitaPrintf("patcher_fragment_usse_size = %u\n", config->patcher.patchFragmentUsseSize);
+	vitaPrintf("calibration_frames = %u\n", config->calibrationFrames);
+	vitaPrintf("dynamic_resolution = %u\n", config->dynamicResolution ? 1 : 0);
+	vitaPrintf("drs_min_scale = %u\n", config->drsMinScale);
+	vitaPrintf("drs_max_scale = %u\n", config->drsMaxScale);
+	vitaPrintf("drs_target_frame_time = %u\n", (unsigned int)config->drsTargetFrameTime);
+	vitaPrintf("texture_cache_size = %u\n", config->textureCacheSize);
+	for (int i = 0; i < NUMBER_OF_MEMORY_CATEGORIES; i++)
+		vitaPrintf("memory_budget_%s = %u\n", MemoryTracker::getCategoryName((MemoryCategory)i), config->memoryBudgets[i]);
+	vitaPrintf("memory_budget_strict = %u\n", config->memoryBudgetStrict ? 1 : 0);
+	vitaPrintf("debug_fill = %u\n", config->debugFill ? 1 : 0);
+	vitaPrintf("verbose_log = %u\n", config->verboseLog ? 1 : 0);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+//----------------------------------------------
+// Graphics configuration helpers
+// Fills in, loads and validates the GraphicsConfig
+// passed to Graphics::initGraphics()
+//-----------------------------------------------
+
+#include "Graphics.h"
+
+//Fills config with the compile time defaults (DISPLAY_*, MSAA_MODE, SCE_GXM_DEFAULT_* and defaultPatcher)
+void getDefaultGraphicsConfig(GraphicsConfig* config);
+
+/*	Overrides the settings in config with the ones found in a text file.
+One "key = value" per line, '#' starts a comment. Sizes take an optional K or M suffix.
+Keys that are missing from the file keep whatever value config already had.
+Returns false if the file can't be opened or a line can't be parsed.
+*/
+bool loadGraphicsConfig(const char* path, GraphicsConfig* config);
+
+//Checks every setting is something libgxm and the display can accept, logs each problem found
+bool validateGraphicsConfig(const GraphicsConfig* config);
+
+//Logs the configuration in the same format loadGraphicsConfig() reads
+void logGraphicsConfig(const GraphicsConfig* config);
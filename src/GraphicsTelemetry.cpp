@@ -0,0 +1,272 @@
+#include "GraphicsTelemetry.h"
+#include "Graphics.h"
+#include "commonUtils.h"
+
+#include <string.h>
+
+//Approximate bytes libgxm writes per command, used wherever the real usage can't be observed.
+//These are deliberately on the high side so the estimates err towards recommending too much
+#define VDM_BYTES_PER_SCENE				256
+#define VDM_BYTES_PER_DRAW				32
+#define VDM_BYTES_PER_STATE_CHANGE		16
+#define VERTEX_RING_BYTES_PER_DRAW		64		//vertex state, the uniforms are added on top
+#define FRAGMENT_RING_BYTES_PER_DRAW	64		//fragment state, the uniforms are added on top
+#define PARAMETER_BYTES_PER_VERTEX		32		//transformed position plus one varying
+#define PARAMETER_BYTES_PER_PRIMITIVE	16		//primitive block and tile list entries
+
+//Headroom added on top of the peaks seen while calibrating
+#define CALIBRATION_HEADROOM_NUM		5
+#define CALIBRATION_HEADROOM_DEN		4
+//The parameter buffer can hold one scene being fragment processed while the next one is built
+#define PARAMETER_BUFFER_SCENES_IN_FLIGHT	2
+
+static const char* _ringNames[NUMBER_OF_TELEMETRY_RINGS] = { "VDM", "vertex", "fragment" };
+static const char* _ringConfigKeys[NUMBER_OF_TELEMETRY_RINGS] = { "vdm_ring_buffer_size", "vertex_ring_buffer_size", "fragment_ring_buffer_size" };
+
+GraphicsTelemetry::GraphicsTelemetry()
+{
+	memset(&stats, 0, sizeof(stats));
+	framesInFlight = 1;
+
+	for (int i = 0; i < NUMBER_OF_TELEMETRY_RINGS; i++)
+	{
+		_ringBases[i] = nullptr;
+		_lastReserve[i] = nullptr;
+		_measuredThisFrame[i] = 0;
+		_modeledThisFrame[i] = 0;
+		_reservesThisFrame[i] = 0;
+		_calibrationPeaks[i] = 0;
+	}
+
+	draws = 0;
+	primitives = 0;
+	memset(_lodTriangles, 0, sizeof(_lodTriangles));
+	sceneParameterBytes = 0;
+
+	calibrationFramesLeft = 0;
+	calibrationParameterPeak = 0;
+}
+
+GraphicsTelemetry::~GraphicsTelemetry()
+{
+
+}
+
+void GraphicsTelemetry::init(SceSize vdmRingSize, SceSize vertexRingSize, SceSize fragmentRingSize, SceSize parameterBufferSize,
+	unsigned int inFlight, const void* vertexRing, const void* fragmentRing)
+{
+	memset(&stats, 0, sizeof(stats));
+	stats.rings[TELEMETRY_RING_VDM].capacity = vdmRingSize;
+	stats.rings[TELEMETRY_RING_VERTEX].capacity = vertexRingSize;
+	stats.rings[TELEMETRY_RING_FRAGMENT].capacity = fragmentRingSize;
+	stats.parameterBuffer.capacity = parameterBufferSize;
+	framesInFlight = (inFlight > 0) ? inFlight : 1;
+
+	//the VDM ring is never handed back to us, it can only be modeled
+	_ringBases[TELEMETRY_RING_VDM] = nullptr;
+	_ringBases[TELEMETRY_RING_VERTEX] = vertexRing;
+	_ringBases[TELEMETRY_RING_FRAGMENT] = fragmentRing;
+}
+
+/*----- Recording -----*/
+
+void GraphicsTelemetry::beginScene()
+{
+	sceneParameterBytes = 0;
+	_modeledThisFrame[TELEMETRY_RING_VDM] += VDM_BYTES_PER_SCENE;
+}
+
+void GraphicsTelemetry::endScene()
+{
+	ParameterBufferStats* parameterBuffer = &stats.parameterBuffer;
+	parameterBuffer->lastScene = sceneParameterBytes;
+
+	if (sceneParameterBytes > parameterBuffer->highWater)
+		parameterBuffer->highWater = sceneParameterBytes;
+	if (sceneParameterBytes > calibrationParameterPeak)
+		calibrationParameterPeak = sceneParameterBytes;
+
+	//libgxm has to flush the scene through fragment processing part way once the buffer is full
+	if (sceneParameterBytes > parameterBuffer->capacity)
+	{
+		parameterBuffer->partialRenders++;
+		parameterBuffer->lastPartialRenderFrame = stats.frames;
+		vitaPrintf("Telemetry: frame %u, scene needs ~%u bytes of the %u byte parameter buffer, partial render likely\n",
+			stats.frames, sceneParameterBytes, parameterBuffer->capacity);
+	}
+}
+
+void GraphicsTelemetry::endFrame()
+{
+	for (int i = 0; i < NUMBER_OF_TELEMETRY_RINGS; i++)
+	{
+		RingBufferStats* ring = &stats.rings[i];
+
+		//the pointer distance covers everything libgxm wrote, prefer it when there is one
+		ring->measured = (_reservesThisFrame[i] > 0 && _measuredThisFrame[i] > 0);
+		ring->lastFrame = ring->measured ? _measuredThisFrame[i] : _modeledThisFrame[i];
+
+		if (ring->lastFrame > _calibrationPeaks[i])
+			_calibrationPeaks[i] = ring->lastFrame;
+
+		//every frame in flight keeps its part of the ring until the GPU is done with it,
+		//past that the CPU waits for the GPU inside libgxm
+		bool stalls = (ring->lastFrame * framesInFlight) > ring->capacity;
+		if (stalls)
+			ring->stallFrames++;
+		if (ring->lastFrame > ring->highWater)
+		{
+			ring->highWater = ring->lastFrame;
+			if (stalls)
+				vitaPrintf("Telemetry: frame %u used %u bytes of the %u byte %s ring buffer, %u frames in flight won't fit\n",
+					stats.frames, ring->lastFrame, ring->capacity, _ringNames[i], framesInFlight);
+		}
+
+		_measuredThisFrame[i] = 0;
+		_modeledThisFrame[i] = 0;
+		_reservesThisFrame[i] = 0;
+	}
+
+	stats.drawsLastFrame = draws;
+	stats.primitivesLastFrame = primitives;
+	memcpy(stats.lodTrianglesLastFrame, _lodTriangles, sizeof(_lodTriangles));
+	draws = 0;
+	primitives = 0;
+	memset(_lodTriangles, 0, sizeof(_lodTriangles));
+	stats.frames++;
+
+	if (calibrationFramesLeft > 0)
+	{
+		calibrationFramesLeft--;
+		if (calibrationFramesLeft == 0)
+			logRecommendations();
+	}
+}
+
+void GraphicsTelemetry::recordLodDraw(unsigned int lod, unsigned int triangles)
+{
+	_lodTriangles[(lod < TELEMETRY_LOD_LEVELS) ? lod : TELEMETRY_LOD_LEVELS - 1] += triangles;
+}
+
+void GraphicsTelemetry::recordDraw(SceGxmPrimitiveType primitive, unsigned int indexCount)
+{
+	unsigned int primitiveCount = 0;
+	switch (primitive)
+	{
+	case SCE_GXM_PRIMITIVE_TRIANGLES:
+	case SCE_GXM_PRIMITIVE_TRIANGLE_EDGES:
+		primitiveCount = indexCount / 3;
+		break;
+	case SCE_GXM_PRIMITIVE_TRIANGLE_STRIP:
+	case SCE_GXM_PRIMITIVE_TRIANGLE_FAN:
+		primitiveCount = (indexCount > 2) ? indexCount - 2 : 0;
+		break;
+	case SCE_GXM_PRIMITIVE_LINES:
+		primitiveCount = indexCount / 2;
+		break;
+	default:
+		primitiveCount = indexCount;
+		break;
+	}
+
+	draws++;
+	primitives += primitiveCount;
+
+	_modeledThisFrame[TELEMETRY_RING_VDM] += VDM_BYTES_PER_DRAW;
+	_modeledThisFrame[TELEMETRY_RING_VERTEX] += VERTEX_RING_BYTES_PER_DRAW;
+	_modeledThisFrame[TELEMETRY_RING_FRAGMENT] += FRAGMENT_RING_BYTES_PER_DRAW;
+
+	//every index is counted as a vertex, shared vertices can only make the real number smaller
+	sceneParameterBytes += indexCount * PARAMETER_BYTES_PER_VERTEX + primitiveCount * PARAMETER_BYTES_PER_PRIMITIVE;
+}
+
+void GraphicsTelemetry::recordStateChange()
+{
+	_modeledThisFrame[TELEMETRY_RING_VDM] += VDM_BYTES_PER_STATE_CHANGE;
+}
+
+void GraphicsTelemetry::recordUniformReserve(TelemetryRing ring, const void* buffer, SceSize size)
+{
+	_modeledThisFrame[ring] += size;
+	_reservesThisFrame[ring]++;
+
+	const char* base = (const char*)_ringBases[ring];
+	const char* current = (const char*)buffer;
+	SceSize capacity = stats.rings[ring].capacity;
+	if (base == nullptr || current < base || current >= base + capacity)
+		return;
+
+	//libgxm allocates from the ring in order, so the distance since the last reservation is
+	//everything it wrote in between, wrapping around the end of the ring
+	if (_lastReserve[ring] != nullptr)
+	{
+		const char* last = (const char*)_lastReserve[ring];
+		_measuredThisFrame[ring] += (current >= last) ? (SceSize)(current - last) : (SceSize)(capacity - (last - current));
+	}
+	_lastReserve[ring] = buffer;
+}
+
+/*----- Calibration -----*/
+
+void GraphicsTelemetry::startCalibration(unsigned int frames)
+{
+	vitaPrintf("\nTelemetry: calibrating buffer sizes over the next %u frames\n", frames);
+	calibrationFramesLeft = frames;
+	for (int i = 0; i < NUMBER_OF_TELEMETRY_RINGS; i++)
+		_calibrationPeaks[i] = 0;
+	calibrationParameterPeak = 0;
+}
+
+bool GraphicsTelemetry::isCalibrating()
+{
+	return calibrationFramesLeft > 0;
+}
+
+void GraphicsTelemetry::logRecommendations()
+{
+	vitaPrintf("\nTelemetry: calibration finished, recommended settings for graphics.cfg\n");
+	for (int i = 0; i < NUMBER_OF_TELEMETRY_RINGS; i++)
+	{
+		//room for every frame in flight plus headroom, in whole pages
+		SceSize recommended = _calibrationPeaks[i] * framesInFlight * CALIBRATION_HEADROOM_NUM / CALIBRATION_HEADROOM_DEN;
+		recommended = ALIGN_MEM(recommended, 4 * 1024);
+		if (recommended < 4 * 1024)
+			recommended = 4 * 1024;
+
+		vitaPrintf("%s = %uK\t# peak %u bytes/frame (%s), currently %uK\n", _ringConfigKeys[i], recommended / 1024,
+			_calibrationPeaks[i], stats.rings[i].measured ? "measured" : "estimated", stats.rings[i].capacity / 1024);
+	}
+
+	SceSize recommended = calibrationParameterPeak * PARAMETER_BUFFER_SCENES_IN_FLIGHT * CALIBRATION_HEADROOM_NUM / CALIBRATION_HEADROOM_DEN;
+	recommended = ALIGN_MEM(recommended, 1024 * 1024);
+	if (recommended < 1024 * 1024)
+		recommended = 1024 * 1024;
+	vitaPrintf("parameter_buffer_size = %uM\t# peak ~%u bytes/scene (estimated), currently %uM\n", recommended / (1024 * 1024),
+		calibrationParameterPeak, stats.parameterBuffer.capacity / (1024 * 1024));
+}
+
+/*----- Stats -----*/
+
+const GraphicsStats* GraphicsTelemetry::getStats()
+{
+	return &stats;
+}
+
+void GraphicsTelemetry::logStats()
+{
+	vitaPrintf("\nGraphics telemetry after %u frames (%u frames in flight)\n", stats.frames, framesInFlight);
+	vitaPrintf("Last frame: %u draws, %u primitives\n", stats.drawsLastFrame, stats.primitivesLastFrame);
+	for (int i = 0; i < TELEMETRY_LOD_LEVELS; i++)
+	{
+		if (stats.lodTrianglesLastFrame[i] > 0)
+			vitaPrintf("\tLOD %d: %u triangles\n", i, stats.lodTrianglesLastFrame[i]);
+	}
+	for (int i = 0; i < NUMBER_OF_TELEMETRY_RINGS; i++)
+	{
+		const RingBufferStats* ring = &stats.rings[i];
+		vitaPrintf("%s ring: last frame %u bytes (%s), high-water %u of %u bytes, %u frames over budget\n", _ringNames[i],
+			ring->lastFrame, ring->measured ? "measured" : "estimated", ring->highWater, ring->capacity, ring->stallFrames);
+	}
+	vitaPrintf("Parameter buffer: last scene ~%u bytes, high-water ~%u of %u bytes, %u likely partial renders\n",
+		stats.parameterBuffer.lastScene, stats.parameterBuffer.highWater, stats.parameterBuffer.capacity, stats.parameterBuffer.partialRenders);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+//----------------------------------------------
+// GraphicsTelemetry Class
+// Tracks how much of the VDM, vertex and fragment ring buffers each frame uses,
+// the parameter buffer high-water mark per scene and likely partial renders.
+// libgxm doesn't report ring usage for an immediate context, so the vertex and
+// fragment rings are measured from where the default uniform buffers it reserves
+// land inside them. Anything that can't be observed is estimated from the
+// commands Graphics submits, using the per-command costs in GraphicsTelemetry.cpp
+//-----------------------------------------------
+
+#include <psp2/gxm.h>
+
+typedef enum TelemetryRing
+{
+	TELEMETRY_RING_VDM = 0,
+	TELEMETRY_RING_VERTEX,
+	TELEMETRY_RING_FRAGMENT
+} TelemetryRing;
+#define NUMBER_OF_TELEMETRY_RINGS 3
+
+typedef struct RingBufferStats
+{
+	SceSize capacity;
+	SceSize lastFrame;			//bytes used by the last complete frame
+	SceSize highWater;			//most bytes used by any single frame
+	unsigned int stallFrames;	//frames that used more than the ring can hold for every frame in flight
+	bool measured;				//true when lastFrame came from ring pointers rather than the cost model
+} RingBufferStats;
+
+typedef struct ParameterBufferStats
+{
+	SceSize capacity;
+	SceSize lastScene;			//estimated bytes used by the last scene
+	SceSize highWater;
+	unsigned int partialRenders;		//scenes estimated to overflow the buffer
+	unsigned int lastPartialRenderFrame;
+} ParameterBufferStats;
+
+//Triangles per level of detail are counted for this many levels, coarser ones count as the last
+#define TELEMETRY_LOD_LEVELS 8
+
+typedef struct GraphicsStats
+{
+	unsigned int frames;
+	unsigned int drawsLastFrame;
+	unsigned int primitivesLastFrame;
+	unsigned int lodTrianglesLastFrame[TELEMETRY_LOD_LEVELS];
+	RingBufferStats rings[NUMBER_OF_TELEMETRY_RINGS];
+	ParameterBufferStats parameterBuffer;
+} GraphicsStats;
+
+class GraphicsTelemetry
+{
+public:
+	GraphicsTelemetry();
+	~GraphicsTelemetry();
+
+	//framesInFlight is how many frames can be queued at once, each ring must hold that many frames worth of data
+	void init(SceSize vdmRingSize, SceSize vertexRingSize, SceSize fragmentRingSize, SceSize parameterBufferSize,
+		unsigned int framesInFlight, const void* vertexRing, const void* fragmentRing);
+
+	/*----- Called by Graphics as it submits work -----*/
+	void beginScene();
+	void endScene();
+	void endFrame();
+	void recordDraw(SceGxmPrimitiveType primitive, unsigned int indexCount);
+	void recordStateChange();
+	void recordLodDraw(unsigned int lod, unsigned int triangles);
+	//buffer is what sceGxmReserve*DefaultUniformBuffer() returned, size is the part of it that was written
+	void recordUniformReserve(TelemetryRing ring, const void* buffer, SceSize size);
+
+	//Tracks peak usage for the next frames frames, then logs recommended sizes for the configuration
+	void startCalibration(unsigned int frames);
+	bool isCalibrating();
+
+	const GraphicsStats* getStats();
+	void logStats();
+
+private:
+	GraphicsStats stats;
+	unsigned int framesInFlight;
+
+	//ring bases, usage is the distance a reservation pointer moved since the last one
+	const void* _ringBases[NUMBER_OF_TELEMETRY_RINGS];
+	const void* _lastReserve[NUMBER_OF_TELEMETRY_RINGS];
+	SceSize _measuredThisFrame[NUMBER_OF_TELEMETRY_RINGS];
+	SceSize _modeledThisFrame[NUMBER_OF_TELEMETRY_RINGS];
+	unsigned int _reservesThisFrame[NUMBER_OF_TELEMETRY_RINGS];
+
+	//this frame/scene
+	unsigned int draws;
+	unsigned int primitives;
+	unsigned int _lodTriangles[TELEMETRY_LOD_LEVELS];
+	SceSize sceneParameterBytes;
+
+	//calibration
+	unsigned int calibrationFramesLeft;
+	SceSize _calibrationPeaks[NUMBER_OF_TELEMETRY_RINGS];
+	SceSize calibrationParameterPeak;
+
+	void logRecommendations();
+};
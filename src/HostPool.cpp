@@ -0,0 +1,173 @@
+#include "HostPool.h"
+#include "commonUtils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+HostPool::HostPool()
+{
+	name = nullptr;
+	category = MEMORY_CATEGORY_OTHER;
+	tracker = nullptr;
+	memset(&stats, 0, sizeof(stats));
+	memset(_freeLists, 0, sizeof(_freeLists));
+}
+
+HostPool::~HostPool()
+{
+	shutdown();
+}
+
+void HostPool::init(const char* poolName, MemoryCategory memoryCategory, MemoryTracker* memoryTracker)
+{
+	assert(_slabs.empty());
+	name = poolName;
+	category = memoryCategory;
+	tracker = memoryTracker;
+	memset(&stats, 0, sizeof(stats));
+	memset(_freeLists, 0, sizeof(_freeLists));
+	for (int i = 0; i < NUMBER_OF_HOST_POOL_CLASSES; i++)
+		stats.classes[i].blockSize = HOST_POOL_MIN_BLOCK << i;
+}
+
+void HostPool::shutdown()
+{
+	if (_slabs.empty() && stats.largeInUse == 0)
+		return;
+
+	unsigned int inUse = stats.largeInUse;
+	for (int i = 0; i < NUMBER_OF_HOST_POOL_CLASSES; i++)
+		inUse += stats.classes[i].inUse;
+	if (inUse != 0)
+		vitaPrintf("ERROR: %s still has %u allocations at shutdown\n", name, inUse);
+
+	std::vector<void*>::iterator iter;
+	for (iter = _slabs.begin(); iter != _slabs.end(); iter++)
+	{
+		if (tracker != nullptr)
+			tracker->removeHost(*iter);
+		free(*iter);
+	}
+	_slabs.clear();
+	memset(_freeLists, 0, sizeof(_freeLists));
+	for (int i = 0; i < NUMBER_OF_HOST_POOL_CLASSES; i++)
+	{
+		stats.classes[i].slabs = 0;
+		stats.classes[i].blocks = 0;
+		stats.classes[i].inUse = 0;
+	}
+	stats.slabBytes = 0;
+}
+
+bool HostPool::addSlab(unsigned int sizeClass)
+{
+	uint8_t* slab = (uint8_t*)malloc(HOST_POOL_SLAB_SIZE);
+	if (slab == nullptr)
+		return false;
+	_slabs.push_back(slab);
+	if (tracker != nullptr)
+		tracker->record(name, category, MEMORY_POOL_HOST, -1, slab, HOST_POOL_SLAB_SIZE, HOST_POOL_SLAB_SIZE, __builtin_return_address(0));
+
+	//thread the whole slab onto the free list, lowest address first out
+	SceSize blockSize = stats.classes[sizeClass].blockSize;
+	unsigned int blocks = HOST_POOL_SLAB_SIZE / blockSize;
+	for (int i = blocks - 1; i >= 0; i--)
+	{
+		void* block = slab + i * blockSize;
+		*(void**)block = _freeLists[sizeClass];
+		_freeLists[sizeClass] = block;
+	}
+
+	stats.classes[sizeClass].slabs++;
+	stats.classes[sizeClass].blocks += blocks;
+	stats.slabBytes += HOST_POOL_SLAB_SIZE;
+	return true;
+}
+
+void* HostPool::allocate(SceSize size)
+{
+	SceSize needed = size + sizeof(BlockHeader);
+	unsigned int sizeClass = 0;
+	while (sizeClass < NUMBER_OF_HOST_POOL_CLASSES && stats.classes[sizeClass].blockSize < needed)
+		sizeClass++;
+
+	BlockHeader* header = nullptr;
+	if (sizeClass == NUMBER_OF_HOST_POOL_CLASSES)
+	{
+		header = (BlockHeader*)malloc(needed);
+		if (header == nullptr)
+			return nullptr;
+		stats.largeInUse++;
+		stats.largeAllocations++;
+		stats.largeBytes += size;
+	}
+	else
+	{
+		if (_freeLists[sizeClass] == nullptr && !addSlab(sizeClass))
+			return nullptr;
+		header = (BlockHeader*)_freeLists[sizeClass];
+		_freeLists[sizeClass] = *(void**)header;
+
+		HostPoolClassStats* classStats = &stats.classes[sizeClass];
+		classStats->inUse++;
+		classStats->allocations++;
+		if (classStats->inUse > classStats->peak)
+			classStats->peak = classStats->inUse;
+	}
+
+	header->sizeClass = sizeClass;
+	header->size = size;
+	stats.requestedBytes += size;
+	//only the large blocks are tracked, the slabs were recorded when addSlab() allocated them
+	if (sizeClass == NUMBER_OF_HOST_POOL_CLASSES && tracker != nullptr)
+		tracker->record(name, category, MEMORY_POOL_HOST, -1, header, size, needed, __builtin_return_address(0));
+	return header + 1;
+}
+
+void HostPool::release(void* memory)
+{
+	if (memory == nullptr)
+		return;
+
+	BlockHeader* header = (BlockHeader*)memory - 1;
+	unsigned int sizeClass = header->sizeClass;
+	assert(sizeClass <= NUMBER_OF_HOST_POOL_CLASSES);
+	stats.requestedBytes -= header->size;
+	stats.frees++;
+
+	if (sizeClass == NUMBER_OF_HOST_POOL_CLASSES)
+	{
+		stats.largeInUse--;
+		stats.largeBytes -= header->size;
+		if (tracker != nullptr)
+			tracker->removeHost(header);
+		free(header);
+		return;
+	}
+
+	*(void**)header = _freeLists[sizeClass];
+	_freeLists[sizeClass] = header;
+	stats.classes[sizeClass].inUse--;
+}
+
+const HostPoolStats* HostPool::getStats()
+{
+	return &stats;
+}
+
+void HostPool::logStats()
+{
+	vitaPrintf("\n%s host pool: %u bytes of slabs, %u bytes requested in use, %u frees\n", name,
+		stats.slabBytes, stats.requestedBytes, stats.frees);
+	for (int i = 0; i < NUMBER_OF_HOST_POOL_CLASSES; i++)
+	{
+		const HostPoolClassStats* classStats = &stats.classes[i];
+		if (classStats->allocations == 0)
+			continue;
+		vitaPrintf("\t%5u byte blocks: %u in use, peak %u of %u in %u slabs, %u allocations\n", classStats->blockSize,
+			classStats->inUse, classStats->peak, classStats->blocks, classStats->slabs, classStats->allocations);
+	}
+	if (stats.largeAllocations != 0)
+		vitaPrintf("\tlarge: %u in use (%u bytes), %u allocations\n", stats.largeInUse, stats.largeBytes, stats.largeAllocations);
+}
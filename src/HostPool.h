@@ -0,0 +1,86 @@
+#pragma once
+
+//----------------------------------------------
+// HostPool Class
+// Size class allocator for small, short lived host memory, the shader patcher's
+// internal allocations in particular. Each class hands out fixed size blocks from
+// slabs it mallocs as it needs them, freed blocks go on a per class free list and are
+// reused, so creating and destroying programs in bulk never goes back to the heap
+// once the slabs are warm and can't fragment it. Anything bigger than the largest
+// class is passed straight to malloc.
+// Slabs are only given back at shutdown. Each slab and each large allocation is
+// recorded in the MemoryTracker, the individual blocks are counted in the stats.
+// Not thread safe, the patcher only calls it while Graphics holds its patcher lock
+//-----------------------------------------------
+
+#include <vector>
+
+#include <psp2/types.h>
+
+#include "MemoryTracker.h"
+
+//Block sizes go up in powers of two from the smallest to the largest, header included
+#define HOST_POOL_MIN_BLOCK			16
+#define HOST_POOL_MAX_BLOCK			4096
+#define NUMBER_OF_HOST_POOL_CLASSES	9
+//Bytes malloced at a time for a class, enough for 4 of the largest blocks
+#define HOST_POOL_SLAB_SIZE			(16 * 1024)
+
+typedef struct HostPoolClassStats
+{
+	SceSize blockSize;
+	unsigned int slabs;
+	unsigned int blocks;				//in all of the slabs
+	unsigned int inUse;
+	unsigned int peak;
+	unsigned int allocations;			//since init
+} HostPoolClassStats;
+
+typedef struct HostPoolStats
+{
+	HostPoolClassStats classes[NUMBER_OF_HOST_POOL_CLASSES];
+	SceSize slabBytes;					//malloced for the classes
+	SceSize requestedBytes;				//asked for by the blocks and large allocations in use
+	unsigned int largeInUse;			//bigger than HOST_POOL_MAX_BLOCK, straight from malloc
+	unsigned int largeAllocations;
+	SceSize largeBytes;
+	unsigned int frees;
+} HostPoolStats;
+
+class HostPool
+{
+public:
+	HostPool();
+	~HostPool();
+
+	//name labels the slabs in the tracker, which may be nullptr
+	void init(const char* name, MemoryCategory category, MemoryTracker* tracker);
+	//Frees every slab, anything still allocated is logged and goes with them
+	void shutdown();
+
+	//8 byte aligned like malloc, nullptr when the heap is out of memory
+	void* allocate(SceSize size);
+	void release(void* memory);
+
+	const HostPoolStats* getStats();
+	void logStats();
+
+private:
+	//Prefixed to every block so release() knows where it goes
+	typedef struct BlockHeader
+	{
+		unsigned int sizeClass;			//NUMBER_OF_HOST_POOL_CLASSES for a large allocation
+		SceSize size;					//what was asked for
+	} BlockHeader;
+
+	bool addSlab(unsigned int sizeClass);
+
+	const char* name;
+	MemoryCategory category;
+	MemoryTracker* tracker;
+	HostPoolStats stats;
+
+	//singly linked through the first word of each free block
+	void* _freeLists[NUMBER_OF_HOST_POOL_CLASSES];
+	std::vector<void*> _slabs;
+};
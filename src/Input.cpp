@@ -0,0 +1,307 @@
+#include "Input.h"
+#include "Graphics.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <assert.h>
+
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+
+#define INPUT_THREAD_STACK_SIZE		(4 * 1024)
+//Above the render thread so a sample is never late because a frame is busy, it sleeps between samples
+#define INPUT_THREAD_PRIORITY		SCE_KERNEL_HIGHEST_PRIORITY_USER
+
+Input::Input()
+{
+	memset(_samples, 0, sizeof(_samples));
+	memset(_events, 0, sizeof(_events));
+	sampleWrite = 0;
+	sampleRead = 0;
+	eventWrite = 0;
+	eventRead = 0;
+	readCount = 0;
+	droppedSamples = 0;
+	droppedEvents = 0;
+	sampleGapMax = 0;
+	running = false;
+	sampleInterval = INPUT_SAMPLE_INTERVAL;
+	samplingThreadUID = -1;
+
+	memset(&stats, 0, sizeof(stats));
+	memset(&state, 0, sizeof(state));
+	pressedButtons = 0;
+	releasedButtons = 0;
+	frameSampleCount = 0;
+	frameEventCount = 0;
+}
+
+Input::~Input()
+{
+	shutdown();
+}
+
+Input* Input::getInstance()
+{
+	static Input instance;
+	return &instance;
+}
+
+void Input::init(unsigned int interval)
+{
+	vitaPrintf("\nStarting input sampling every %uus\n", interval);
+	assert(!running);
+
+	sceCtrlSetSamplingMode(SCE_CTRL_MODE_ANALOG);
+	sampleWrite = sampleRead = 0;
+	eventWrite = eventRead = 0;
+	readCount = 0;
+	droppedSamples = 0;
+	droppedEvents = 0;
+	sampleGapMax = 0;
+	memset(&stats, 0, sizeof(stats));
+	//sticks start centered until the first sample says otherwise
+	memset(&state, 0, sizeof(state));
+	state.lx = state.ly = state.rx = state.ry = 128;
+	sampleInterval = interval;
+
+	running = true;
+	samplingThreadUID = sceKernelCreateThread("input_sampler", &Input::samplingThread, INPUT_THREAD_PRIORITY,
+		INPUT_THREAD_STACK_SIZE, 0, SCE_KERNEL_CPU_MASK_USER_2, NULL);
+	vitaPrintf("sceKernelCreateThread() result: 0x%08X\n", samplingThreadUID);
+	assert(samplingThreadUID >= 0);
+
+	Input* self = this;
+	int error = sceKernelStartThread(samplingThreadUID, sizeof(self), &self);
+	vitaPrintf("sceKernelStartThread() result: 0x%08X\n", error);
+	assert(error == 0);
+}
+
+void Input::shutdown()
+{
+	if (!running)
+		return;
+	vitaPrintf("\nStopping input sampling\n");
+	logStats();
+
+	running = false;
+	sceKernelWaitThreadEnd(samplingThreadUID, NULL, NULL);
+	sceKernelDeleteThread(samplingThreadUID);
+	samplingThreadUID = -1;
+}
+
+bool Input::isRunning()
+{
+	return running;
+}
+
+/*----- Render thread -----*/
+
+void Input::update()
+{
+	SceUInt64 now = sceKernelGetProcessTimeWide();
+	frameSampleCount = 0;
+	frameEventCount = 0;
+	pressedButtons = 0;
+	releasedButtons = 0;
+
+	//drain up to the entries published now, the sampler can publish more as slots free up and a frame's arrays
+	//only hold INPUT_QUEUE_SIZE. Read the index before the slots it publishes
+	unsigned int sampleEnd = sampleWrite;
+	__sync_synchronize();
+	while (sampleRead != sampleEnd)
+	{
+		state = _samples[sampleRead % INPUT_QUEUE_SIZE];
+		_frameSamples[frameSampleCount++] = state;
+		__sync_synchronize();
+		sampleRead++;
+	}
+
+	SceUInt64 firstPress = 0;
+	unsigned int eventEnd = eventWrite;
+	__sync_synchronize();
+	while (eventRead != eventEnd)
+	{
+		const InputEvent* event = &_events[eventRead % INPUT_QUEUE_SIZE];
+		_frameEvents[frameEventCount++] = *event;
+		if (event->pressed)
+		{
+			pressedButtons |= event->button;
+			if (firstPress == 0)
+				firstPress = event->time;
+		}
+		else
+			releasedButtons |= event->button;
+		if (now - event->time > stats.eventAgeMax)
+			stats.eventAgeMax = now - event->time;
+		stats.events++;
+		__sync_synchronize();
+		eventRead++;
+	}
+	stats.changes += frameSampleCount;
+
+	//the state only changes when a sample does, the input is as fresh as the sampler's last read
+	Graphics::getInstance()->setInputSampleTime(now);
+	if (firstPress != 0)
+		Graphics::getInstance()->setInputEventTime(firstPress);
+}
+
+const InputSample* Input::getState()
+{
+	return &state;
+}
+
+bool Input::isDown(unsigned int button)
+{
+	return (state.buttons & button) != 0;
+}
+
+bool Input::wasPressed(unsigned int button)
+{
+	return (pressedButtons & button) != 0;
+}
+
+bool Input::wasReleased(unsigned int button)
+{
+	return (releasedButtons & button) != 0;
+}
+
+unsigned int Input::getSampleCount()
+{
+	return frameSampleCount;
+}
+
+const InputSample* Input::getSample(unsigned int index)
+{
+	return (index < frameSampleCount) ? &_frameSamples[index] : nullptr;
+}
+
+unsigned int Input::getEventCount()
+{
+	return frameEventCount;
+}
+
+const InputEvent* Input::getEvent(unsigned int index)
+{
+	return (index < frameEventCount) ? &_frameEvents[index] : nullptr;
+}
+
+void Input::describeButtons(unsigned int buttons, char* text, SceSize size)
+{
+	if (size == 0)
+		return;
+	text[0] = '\0';
+	SceSize length = 0;
+	for (int bit = 0; bit < NUMBER_OF_PAD_BUTTONS; bit++)
+	{
+		if (!(buttons & (1 << bit)))
+			continue;
+		SceSize labelLength = strlen(_padLables[bit]);
+		if (length + labelLength >= size)
+			break;
+		memcpy(text + length, _padLables[bit], labelLength + 1);
+		length += labelLength;
+	}
+}
+
+void Input::getStats(InputStats* inputStats)
+{
+	*inputStats = stats;
+	inputStats->samples = readCount;
+	inputStats->droppedSamples = droppedSamples;
+	inputStats->droppedEvents = droppedEvents;
+	inputStats->sampleGapMax = sampleGapMax;
+}
+
+void Input::logStats()
+{
+	InputStats inputStats;
+	getStats(&inputStats);
+	vitaPrintf("\nInput stats (sampling every %uus):\n", sampleInterval);
+	vitaPrintf("\t%u samples, %u changed, %u button events\n", inputStats.samples, inputStats.changes, inputStats.events);
+	vitaPrintf("\tLongest gap between samples: %.2fms, longest an event waited for a frame: %.2fms\n",
+		inputStats.sampleGapMax / 1000.0, inputStats.eventAgeMax / 1000.0);
+	if (inputStats.droppedSamples != 0 || inputStats.droppedEvents != 0)
+		vitaPrintf("ERROR: %u samples and %u events dropped, update() isn't being called every frame\n",
+			inputStats.droppedSamples, inputStats.droppedEvents);
+}
+
+/*----- Sampling thread -----*/
+
+int Input::samplingThread(SceSize args, void* argp)
+{
+	(void)args;
+	//argp points at a copy of the pointer passed to sceKernelStartThread()
+	Input* self = *(Input**)argp;
+
+	SceCtrlData ctrl;
+	InputSample last;
+	memset(&last, 0, sizeof(last));
+	last.lx = last.ly = last.rx = last.ry = 128;
+	SceUInt64 lastRead = 0;
+	SceUInt64 nextRead = sceKernelGetProcessTimeWide();
+
+	while (self->running)
+	{
+		//peek never blocks, it returns whatever the driver saw last
+		memset(&ctrl, 0, sizeof(ctrl));
+		sceCtrlPeekBufferPositive(0, &ctrl, 1);
+		SceUInt64 now = sceKernelGetProcessTimeWide();
+		self->readCount++;
+		if (lastRead != 0 && now - lastRead > self->sampleGapMax)
+			self->sampleGapMax = now - lastRead;
+		lastRead = now;
+
+		InputSample sample;
+		sample.time = now;
+		sample.buttons = ctrl.buttons;
+		sample.lx = ctrl.lx;
+		sample.ly = ctrl.ly;
+		sample.rx = ctrl.rx;
+		sample.ry = ctrl.ry;
+
+		if (sample.buttons != last.buttons || sample.lx != last.lx || sample.ly != last.ly ||
+			sample.rx != last.rx || sample.ry != last.ry)
+		{
+			if (self->sampleWrite - self->sampleRead < INPUT_QUEUE_SIZE)
+			{
+				self->_samples[self->sampleWrite % INPUT_QUEUE_SIZE] = sample;
+				//the sample has to be visible to the other core before the index that publishes it
+				__sync_synchronize();
+				self->sampleWrite++;
+			}
+			else
+				self->droppedSamples++;
+
+			//one event per button that changed, lowest bit first
+			unsigned int changed = sample.buttons ^ last.buttons;
+			for (int bit = 0; bit < NUMBER_OF_PAD_BUTTONS; bit++)
+			{
+				if (!(changed & (1 << bit)))
+					continue;
+				if (self->eventWrite - self->eventRead >= INPUT_QUEUE_SIZE)
+				{
+					self->droppedEvents++;
+					continue;
+				}
+				InputEvent* event = &self->_events[self->eventWrite % INPUT_QUEUE_SIZE];
+				event->time = now;
+				event->button = 1 << bit;
+				event->pressed = (sample.buttons & (1 << bit)) != 0;
+				__sync_synchronize();
+				self->eventWrite++;
+			}
+			last = sample;
+		}
+
+		//a fixed rate rather than a fixed sleep, time spent sampling doesn't add up
+		nextRead += self->sampleInterval;
+		now = sceKernelGetProcessTimeWide();
+		if (nextRead > now)
+			sceKernelDelayThread((SceUInt)(nextRead - now));
+		else
+			nextRead = now;
+	}
+
+	return 0;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+//----------------------------------------------
+// Input Class
+// Samples the controller on a thread of its own at a fixed rate instead of once a
+// frame on the render thread, so a press is seen within one sample interval of the
+// driver reporting it rather than up to a frame later. Every sample that changed
+// goes into a single producer single consumer ring with the time it was taken, and
+// the thread turns button changes into timestamped press and release events in a
+// second ring, so presses shorter than a frame are never lost.
+// The render thread drains both once a frame in update(), which also hands the time
+// of the oldest press to Graphics so the display callback can measure how long it
+// took to reach the screen
+//-----------------------------------------------
+
+#include <psp2/types.h>
+#include <psp2/ctrl.h>
+
+//Default time between samples in microseconds, 500Hz
+#define INPUT_SAMPLE_INTERVAL		2000
+//Samples and events in flight, each ring holds this many. Must be a power of two
+#define INPUT_QUEUE_SIZE			128
+#define NUMBER_OF_PAD_BUTTONS		16
+
+typedef struct InputSample
+{
+	SceUInt64 time;				//sceKernelGetProcessTimeWide() when it was read
+	unsigned int buttons;		//SCE_CTRL_* bits
+	unsigned char lx;			//analog sticks, 128 is centered
+	unsigned char ly;
+	unsigned char rx;
+	unsigned char ry;
+} InputSample;
+
+typedef struct InputEvent
+{
+	SceUInt64 time;
+	unsigned int button;		//a single SCE_CTRL_* bit
+	bool pressed;				//false for a release
+} InputEvent;
+
+typedef struct InputStats
+{
+	unsigned int samples;				//controller reads
+	unsigned int changes;				//reads that differed from the one before and went into the ring
+	unsigned int events;
+	unsigned int droppedSamples;		//the ring was full, the render thread isn't calling update()
+	unsigned int droppedEvents;
+	SceUInt64 sampleGapMax;				//microseconds, longest time between two reads (scheduling jitter)
+	SceUInt64 eventAgeMax;				//microseconds, longest an event waited for update()
+} InputStats;
+
+//C++ singleton Input class
+class Input
+{
+protected:
+	Input();
+	Input(Input const&);
+	void operator=(Input const&);
+public:
+	~Input();
+	static Input* getInstance();
+
+	//Starts the sampling thread, interval is in microseconds
+	void init(unsigned int interval = INPUT_SAMPLE_INTERVAL);
+	void shutdown();
+	bool isRunning();
+
+	/*----- Render thread -----*/
+	//Takes everything sampled since the last call, once per frame before reading any input
+	void update();
+	//The newest sample
+	const InputSample* getState();
+	bool isDown(unsigned int button);
+	//Pressed or released at any point since the last update(), even if it has already changed back
+	bool wasPressed(unsigned int button);
+	bool wasReleased(unsigned int button);
+	//The samples and events update() took, oldest first
+	unsigned int getSampleCount();
+	const InputSample* getSample(unsigned int index);
+	unsigned int getEventCount();
+	const InputEvent* getEvent(unsigned int index);
+
+	//Names the buttons set in buttons, "L CROSS " style, using the labels in commonUtils.h
+	static void describeButtons(unsigned int buttons, char* text, SceSize size);
+
+	void getStats(InputStats* stats);
+	void logStats();
+
+private:
+	static int samplingThread(SceSize args, void* argp);
+
+	/* Shared between the threads */
+	//sampling thread to render thread
+	InputSample _samples[INPUT_QUEUE_SIZE];
+	volatile unsigned int sampleWrite;
+	volatile unsigned int sampleRead;
+	InputEvent _events[INPUT_QUEUE_SIZE];
+	volatile unsigned int eventWrite;
+	volatile unsigned int eventRead;
+	//counted by the sampling thread, only ever read by the render thread
+	volatile unsigned int readCount;
+	volatile unsigned int droppedSamples;
+	volatile unsigned int droppedEvents;
+	volatile SceUInt64 sampleGapMax;
+	volatile bool running;
+	unsigned int sampleInterval;
+	SceUID samplingThreadUID;
+
+	/* Render thread only */
+	InputStats stats;
+	InputSample state;
+	unsigned int pressedButtons;
+	unsigned int releasedButtons;
+	InputSample _frameSamples[INPUT_QUEUE_SIZE];
+	unsigned int frameSampleCount;
+	InputEvent _frameEvents[INPUT_QUEUE_SIZE];
+	unsigned int frameEventCount;
+};
@@ -0,0 +1,205 @@
+#include "JobSystem.h"
+#include "Graphics.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <assert.h>
+
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+
+#define JOB_WORKER_STACK_SIZE		(32 * 1024)
+//The same as the render thread, the frame waits for the batch
+#define JOB_WORKER_PRIORITY			SCE_KERNEL_DEFAULT_PRIORITY_USER
+
+//the render thread runs on core 0, the workers take turns on the other two
+static const int _workerCpuMasks[2] = { SCE_KERNEL_CPU_MASK_USER_1, SCE_KERNEL_CPU_MASK_USER_2 };
+
+JobSystem::JobSystem()
+{
+	for (int i = 0; i < JOB_SYSTEM_MAX_WORKERS; i++)
+		_threadUIDs[i] = -1;
+	workerCount = 0;
+	startSemaUID = -1;
+	doneSemaUID = -1;
+	running = false;
+	function = nullptr;
+	userData = nullptr;
+	jobCount = 0;
+	nextJob = 0;
+	finishedWorkers = 0;
+	memset(&stats, 0, sizeof(stats));
+}
+
+JobSystem::~JobSystem()
+{
+	shutdown();
+}
+
+JobSystem* JobSystem::getInstance()
+{
+	static JobSystem instance;
+	return &instance;
+}
+
+bool JobSystem::init(unsigned int workers)
+{
+	vitaPrintf("\nStarting the job system with %u workers\n", workers);
+	assert(!running);
+	if (workers > JOB_SYSTEM_MAX_WORKERS)
+	{
+		vitaPrintf("ERROR: the job system has %d workers at most, clamping %u\n", JOB_SYSTEM_MAX_WORKERS, workers);
+		workers = JOB_SYSTEM_MAX_WORKERS;
+	}
+	memset(&stats, 0, sizeof(stats));
+	workerCount = 0;
+	running = true;
+	if (workers == 0)
+		return true;
+
+	startSemaUID = sceKernelCreateSema("job_start", 0, 0, JOB_SYSTEM_MAX_WORKERS, NULL);
+	doneSemaUID = sceKernelCreateSema("job_done", 0, 0, 1, NULL);
+	if (startSemaUID < 0 || doneSemaUID < 0)
+	{
+		vitaPrintf("ERROR: the job system's semaphores couldn't be created (0x%08X, 0x%08X), jobs run on the calling thread\n",
+			startSemaUID, doneSemaUID);
+		if (startSemaUID >= 0)
+			sceKernelDeleteSema(startSemaUID);
+		if (doneSemaUID >= 0)
+			sceKernelDeleteSema(doneSemaUID);
+		startSemaUID = -1;
+		doneSemaUID = -1;
+		return false;
+	}
+
+	for (unsigned int i = 0; i < workers; i++)
+	{
+		SceUID threadUID = sceKernelCreateThread("job_worker", &JobSystem::workerThread, JOB_WORKER_PRIORITY, JOB_WORKER_STACK_SIZE, 0,
+			_workerCpuMasks[i % 2], NULL);
+		if (threadUID < 0)
+		{
+			vitaPrintf("ERROR: job worker %u couldn't be created: 0x%08X\n", i, threadUID);
+			return false;
+		}
+		JobSystem* self = this;
+		int error = sceKernelStartThread(threadUID, sizeof(self), &self);
+		if (error != 0)
+		{
+			vitaPrintf("ERROR: sceKernelStartThread() of job worker %u result: 0x%08X\n", i, error);
+			sceKernelDeleteThread(threadUID);
+			return false;
+		}
+		_threadUIDs[workerCount++] = threadUID;
+	}
+	return true;
+}
+
+void JobSystem::shutdown()
+{
+	if (!running)
+		return;
+	vitaPrintf("\nStopping the job system\n");
+	logStats();
+
+	//the workers see running is false when they wake
+	running = false;
+	__sync_synchronize();
+	if (startSemaUID >= 0)
+		sceKernelSignalSema(startSemaUID, workerCount);
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		sceKernelWaitThreadEnd(_threadUIDs[i], NULL, NULL);
+		sceKernelDeleteThread(_threadUIDs[i]);
+		_threadUIDs[i] = -1;
+	}
+	workerCount = 0;
+
+	if (startSemaUID >= 0)
+		sceKernelDeleteSema(startSemaUID);
+	if (doneSemaUID >= 0)
+		sceKernelDeleteSema(doneSemaUID);
+	startSemaUID = -1;
+	doneSemaUID = -1;
+}
+
+unsigned int JobSystem::getWorkerCount()
+{
+	return workerCount;
+}
+
+void JobSystem::run(JobFunction function, void* userData, unsigned int jobCount)
+{
+	if (jobCount == 0)
+		return;
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+
+	this->function = function;
+	this->userData = userData;
+	this->jobCount = jobCount;
+	nextJob = 0;
+	finishedWorkers = 0;
+
+	//a single job isn't worth waking anyone for
+	bool wake = workerCount > 0 && jobCount > 1;
+	if (wake)
+	{
+		//the batch has to be visible before the workers wake
+		__sync_synchronize();
+		sceKernelSignalSema(startSemaUID, workerCount);
+	}
+	unsigned int callerJobs = runJobs();
+	if (wake)
+		sceKernelWaitSema(doneSemaUID, 1, NULL);
+
+	SceUInt64 batchTime = sceKernelGetProcessTimeWide() - start;
+	stats.batches++;
+	stats.jobs += jobCount;
+	stats.callerJobs += callerJobs;
+	stats.batchTime += batchTime;
+	if (batchTime > stats.batchTimeMax)
+		stats.batchTimeMax = batchTime;
+}
+
+unsigned int JobSystem::runJobs()
+{
+	unsigned int ran = 0;
+	while (true)
+	{
+		unsigned int job = __sync_fetch_and_add(&nextJob, 1);
+		if (job >= jobCount)
+			return ran;
+		function(userData, job);
+		ran++;
+	}
+}
+
+const JobSystemStats* JobSystem::getStats()
+{
+	return &stats;
+}
+
+void JobSystem::logStats()
+{
+	vitaPrintf("\nJob system: %u workers\n", workerCount);
+	vitaPrintf("\tBatches: %u, %u jobs, %u on the calling thread\n", stats.batches, stats.jobs, stats.callerJobs);
+	if (stats.batches > 0)
+		vitaPrintf("\tBatch time: %.3fms average, %.3fms max\n", stats.batchTime / 1000.0 / stats.batches, stats.batchTimeMax / 1000.0);
+}
+
+int JobSystem::workerThread(SceSize args, void* argp)
+{
+	//argp points at a copy of the pointer passed to sceKernelStartThread()
+	JobSystem* jobSystem = *(JobSystem**)argp;
+	while (true)
+	{
+		sceKernelWaitSema(jobSystem->startSemaUID, 1, NULL);
+		if (!jobSystem->running)
+			return 0;
+
+		jobSystem->runJobs();
+		//the jobs' writes have to be visible before the caller hears the batch is done
+		__sync_synchronize();
+		if (__sync_add_and_fetch(&jobSystem->finishedWorkers, 1) == jobSystem->workerCount)
+			sceKernelSignalSema(jobSystem->doneSemaUID, 1);
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+//----------------------------------------------
+// JobSystem Class
+// Splits a frame's CPU heavy work over the cores the render thread doesn't run on. run() hands
+// a batch of numbered jobs to the worker threads, takes jobs itself as well and returns once
+// every job of the batch is done, so the caller's data is free to use again straight after.
+// Jobs are claimed one at a time with an atomic counter, a worker that finishes early takes
+// the next one instead of waiting for a fixed share.
+// Jobs mustn't log or call into Graphics, neither is safe off the render thread. One batch at
+// a time, started from the render thread
+//-----------------------------------------------
+
+#include <psp2/types.h>
+
+//Worker threads by default, the Vita has 3 cores for applications and the render thread has one
+#define JOB_SYSTEM_DEFAULT_WORKERS	2
+#define JOB_SYSTEM_MAX_WORKERS		8
+
+//Does job number job of a batch, any thread may run any job
+typedef void (*JobFunction)(void* userData, unsigned int job);
+
+typedef struct JobSystemStats
+{
+	unsigned int batches;
+	unsigned int jobs;
+	unsigned int callerJobs;		//jobs the thread calling run() did itself
+	SceUInt64 batchTime;			//microseconds spent in run()
+	SceUInt64 batchTimeMax;
+} JobSystemStats;
+
+//C++ singleton JobSystem class
+class JobSystem
+{
+protected:
+	JobSystem();
+	JobSystem(JobSystem const&);
+	void operator=(JobSystem const&);
+public:
+	~JobSystem();
+	static JobSystem* getInstance();
+
+	//Starts that many worker threads, 0 runs every job on the calling thread. false if a thread couldn't be started, the ones that did are kept
+	bool init(unsigned int workers = JOB_SYSTEM_DEFAULT_WORKERS);
+	//Stops the workers, no batch may be running
+	void shutdown();
+	unsigned int getWorkerCount();
+
+	//Runs function(userData, 0) to function(userData, jobCount - 1) and waits for all of them
+	void run(JobFunction function, void* userData, unsigned int jobCount);
+
+	const JobSystemStats* getStats();
+	void logStats();
+
+private:
+	static int workerThread(SceSize args, void* argp);
+	//Claims and runs jobs of the current batch until there are none left, returns how many it ran
+	unsigned int runJobs();
+
+	SceUID _threadUIDs[JOB_SYSTEM_MAX_WORKERS];
+	unsigned int workerCount;
+	SceUID startSemaUID;		//signalled once per worker for each batch
+	SceUID doneSemaUID;			//signalled by the last worker out of a batch
+	volatile bool running;
+
+	//the current batch, written before the workers are woken
+	JobFunction function;
+	void* userData;
+	unsigned int jobCount;
+	volatile unsigned int nextJob;
+	volatile unsigned int finishedWorkers;
+
+	JobSystemStats stats;
+};
@@ -1,12 +1,12 @@
 #include "Logger.h"
-//#include "text.h"
 
 #include <stdarg.h>
 #include <stdlib.h>
 
 Logger::Logger()
 {
-
+	verbose = false;
+	sceKernelCreateLwMutex(&lock, "logger", 0, 0, NULL);
 }
 
 Logger::~Logger()
@@ -14,6 +14,7 @@ Logger::~Logger()
 	//make sure the stream is closed before destroying Logger
 	if (outStream.is_open())
 		outStream.close();
+	sceKernelDeleteLwMutex(&lock);
 }
 
 Logger* Logger::getInstance()
@@ -27,7 +28,6 @@ void Logger::init()
 	outStream.open("ux0:/graphicsTestLog.txt");
 
 	writeLog("Initializing Logger\n");
-	//textInit();
 	writeLog("Logger Initialized\n");
 }
 
@@ -43,12 +43,43 @@ void Logger::writeLog(const char* info, ...)
 
 	va_list args;
 	va_start(args, info);
-	int result = vsnprintf(buf, sizeof(buf), info, args);
-	outStream << buf;
+	vsnprintf(buf, sizeof(buf), info, args);
 	va_end(args);
+	write(buf);
 }
 
 void Logger::writeLog(std::string info)
 {
-	outStream << info;
+	write(info.c_str());
+}
+
+void Logger::writeVerbose(const char* info, ...)
+{
+	if (!verbose)
+		return;
+
+	char buf[512];
+
+	va_list args;
+	va_start(args, info);
+	vsnprintf(buf, sizeof(buf), info, args);
+	va_end(args);
+	write(buf);
+}
+
+void Logger::setVerbose(bool verbose)
+{
+	this->verbose = verbose;
+}
+
+bool Logger::isVerbose()
+{
+	return verbose;
+}
+
+void Logger::write(const char* text)
+{
+	sceKernelLockLwMutex(&lock, 1, NULL);
+	outStream << text;
+	sceKernelUnlockLwMutex(&lock, 1);
 }
\ No newline at end of file
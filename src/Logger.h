@@ -2,14 +2,18 @@
 
 //----------------------------------------------
 // Logger Class
-// Responsible for logging debug information to a file
-// Also responsible for calculating FPS as well as
-// writing any debug information to the screen
+// Responsible for logging debug information to a file.
+// FPS and other live numbers go on screen through the StatsOverlay.
+// Step by step detail, like every allocation and patcher call, goes through writeVerbose()
+// and is dropped unless verbose logging was turned on.
+// Lines can be written from any thread, each one goes into the file whole
 //-----------------------------------------------
 
 #include <fstream>
 #include <string>
 
+#include <psp2/kernel/threadmgr.h>
+
 class Logger
 {
 protected:
@@ -24,7 +28,15 @@ public:
 	void shutdown();
 	void writeLog(const char* info, ...);
 	void writeLog(std::string info);
+	//Only written when verbose logging is on, otherwise returns without formatting anything
+	void writeVerbose(const char* info, ...);
+	void setVerbose(bool verbose);
+	bool isVerbose();
 
 private:
+	void write(const char* text);
+
 	std::ofstream outStream;
+	bool verbose;
+	SceKernelLwMutexWork lock;
 };
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "Lz4.h"
+
+#include <string.h>
+
+//lengths are a 4 bit field that keeps going in extra bytes while they read 255
+static bool readLength(const uint8_t** in, const uint8_t* inEnd, uint32_t* length)
+{
+	if (*length != 15)
+		return true;
+	uint8_t next = 0;
+	do
+	{
+		if (*in >= inEnd)
+			return false;
+		next = *(*in)++;
+		*length += next;
+	} while (next == 255);
+	return true;
+}
+
+int lz4Decompress(const uint8_t* source, uint32_t sourceSize, uint8_t* destination, uint32_t destinationSize)
+{
+	const uint8_t* in = source;
+	const uint8_t* inEnd = source + sourceSize;
+	uint8_t* out = destination;
+	uint8_t* outEnd = destination + destinationSize;
+
+	while (in < inEnd)
+	{
+		//token, high nibble is the literal run, low nibble the match length - 4
+		uint8_t token = *in++;
+
+		uint32_t literalLength = token >> 4;
+		if (!readLength(&in, inEnd, &literalLength))
+			return -1;
+		if (literalLength > (uint32_t)(inEnd - in) || literalLength > (uint32_t)(outEnd - out))
+			return -1;
+		memcpy(out, in, literalLength);
+		in += literalLength;
+		out += literalLength;
+
+		//the last sequence is literals only
+		if (in == inEnd)
+			break;
+
+		if (inEnd - in < 2)
+			return -1;
+		uint32_t offset = in[0] | (in[1] << 8);
+		in += 2;
+		if (offset == 0 || offset > (uint32_t)(out - destination))
+			return -1;
+
+		uint32_t matchLength = token & 0x0F;
+		if (!readLength(&in, inEnd, &matchLength))
+			return -1;
+		matchLength += 4;
+		if (matchLength > (uint32_t)(outEnd - out))
+			return -1;
+
+		//overlapping matches repeat the last offset bytes, which has to go a byte at a time
+		const uint8_t* match = out - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(out, match, matchLength);
+			out += matchLength;
+		}
+		else
+		{
+			for (uint32_t i = 0; i < matchLength; i++)
+				*out++ = *match++;
+		}
+	}
+	return (int)(out - destination);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+//----------------------------------------------
+// LZ4 block decompression
+// Decodes the LZ4 block format (no frame header) that tools/streamconv writes into
+// .lzs chunks. Every read and write is bounds checked so a corrupt chunk fails instead
+// of scribbling over memory. Has no Vita dependencies, the host tools use it as well
+//-----------------------------------------------
+
+#include <stdint.h>
+
+//Decompresses source into destination, returns the number of bytes written or -1 if
+//the block is malformed or wouldn't fit in destinationSize bytes
+int lz4Decompress(const uint8_t* source, uint32_t sourceSize, uint8_t* destination, uint32_t destinationSize);
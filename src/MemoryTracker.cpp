@@ -0,0 +1,299 @@
+#include "MemoryTracker.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <assert.h>
+
+#include <psp2/kernel/threadmgr.h>
+
+static const char* _categoryNames[NUMBER_OF_MEMORY_CATEGORIES] = { "other", "display", "context", "shaders", "textures", "geometry", "ui", "uniforms" };
+static const char* _poolNames[NUMBER_OF_MEMORY_POOLS] = { "CDRAM", "LPDDR (GPU mapped)", "Host" };
+
+#define MEGABYTES(bytes)	((bytes) / (1024.0 * 1024.0))
+
+MemoryTracker::MemoryTracker()
+{
+	memset(&stats, 0, sizeof(stats));
+	memset(_budgets, 0, sizeof(_budgets));
+	strict = false;
+	nextSerial = 1;
+	memset(_poolBytes, 0, sizeof(_poolBytes));
+	memset(_categoryBytes, 0, sizeof(_categoryBytes));
+	sceKernelCreateLwMutex(&lock, "memory_tracker", SCE_KERNEL_MUTEX_ATTR_RECURSIVE, 0, NULL);
+}
+
+MemoryTracker::~MemoryTracker()
+{
+	sceKernelDeleteLwMutex(&lock);
+}
+
+void MemoryTracker::init(const SceSize* budgets, bool strictBudgets)
+{
+	//allocations already recorded stay, only the budgets and counters start over
+	memset(&stats, 0, sizeof(stats));
+	memcpy(stats.categoryPeak, _categoryBytes, sizeof(_categoryBytes));
+	for (int i = 0; i < NUMBER_OF_MEMORY_CATEGORIES; i++)
+		_budgets[i] = (budgets != nullptr) ? budgets[i] : 0;
+	strict = strictBudgets;
+}
+
+void MemoryTracker::setBudget(MemoryCategory category, SceSize budget)
+{
+	_budgets[category] = budget;
+}
+
+SceSize MemoryTracker::getBudget(MemoryCategory category)
+{
+	return _budgets[category];
+}
+
+void MemoryTracker::record(const char* name, MemoryCategory category, MemoryPool pool, SceUID uid, const void* address,
+	SceSize requested, SceSize allocated, const void* callSite)
+{
+	sceKernelLockLwMutex(&lock, 1, NULL);
+	MemoryAllocation allocation;
+	allocation.name = name;
+	allocation.category = category;
+	allocation.pool = pool;
+	allocation.uid = uid;
+	allocation.address = address;
+	allocation.requested = requested;
+	allocation.allocated = allocated;
+	allocation.callSite = callSite;
+	allocation.serial = nextSerial++;
+	_allocations.push_back(allocation);
+
+	_poolBytes[pool] += allocated;
+	_categoryBytes[category] += allocated;
+	if (_categoryBytes[category] > stats.categoryPeak[category])
+		stats.categoryPeak[category] = _categoryBytes[category];
+	stats.allocations++;
+
+	if (_budgets[category] != 0 && _categoryBytes[category] > _budgets[category])
+	{
+		stats.overBudget++;
+		vitaPrintf("ERROR: %s (%u bytes, called from %p) takes %s memory to %u bytes, over its %u byte budget\n",
+			name, allocated, callSite, _categoryNames[category], _categoryBytes[category], _budgets[category]);
+		assert(!strict);
+	}
+	sceKernelUnlockLwMutex(&lock, 1);
+}
+
+bool MemoryTracker::remove(SceUID uid)
+{
+	sceKernelLockLwMutex(&lock, 1, NULL);
+	for (unsigned int i = 0; i < _allocations.size(); i++)
+	{
+		if (_allocations[i].uid == uid && _allocations[i].pool != MEMORY_POOL_HOST)
+		{
+			erase(i);
+			sceKernelUnlockLwMutex(&lock, 1);
+			return true;
+		}
+	}
+	stats.unknownFrees++;
+	vitaPrintf("ERROR: freeing memblock %d which was never allocated or is already free\n", uid);
+	sceKernelUnlockLwMutex(&lock, 1);
+	return false;
+}
+
+bool MemoryTracker::removeHost(const void* address)
+{
+	sceKernelLockLwMutex(&lock, 1, NULL);
+	for (unsigned int i = 0; i < _allocations.size(); i++)
+	{
+		if (_allocations[i].address == address && _allocations[i].pool == MEMORY_POOL_HOST)
+		{
+			erase(i);
+			sceKernelUnlockLwMutex(&lock, 1);
+			return true;
+		}
+	}
+	stats.unknownFrees++;
+	vitaPrintf("ERROR: freeing host memory at %p which was never allocated or is already free\n", address);
+	sceKernelUnlockLwMutex(&lock, 1);
+	return false;
+}
+
+bool MemoryTracker::isTracked(SceUID uid)
+{
+	bool tracked = false;
+	sceKernelLockLwMutex(&lock, 1, NULL);
+	for (unsigned int i = 0; i < _allocations.size() && !tracked; i++)
+		tracked = _allocations[i].uid == uid && _allocations[i].pool != MEMORY_POOL_HOST;
+	sceKernelUnlockLwMutex(&lock, 1);
+	return tracked;
+}
+
+void MemoryTracker::erase(unsigned int index)
+{
+	_poolBytes[_allocations[index].pool] -= _allocations[index].allocated;
+	_categoryBytes[_allocations[index].category] -= _allocations[index].allocated;
+	_allocations.erase(_allocations.begin() + index);
+	stats.frees++;
+}
+
+SceSize MemoryTracker::getPoolUsage(MemoryPool pool)
+{
+	return _poolBytes[pool];
+}
+
+SceSize MemoryTracker::getCategoryUsage(MemoryCategory category)
+{
+	return _categoryBytes[category];
+}
+
+unsigned int MemoryTracker::getAllocationCount()
+{
+	return _allocations.size();
+}
+
+const MemoryAllocation* MemoryTracker::getAllocation(unsigned int index)
+{
+	return (index < _allocations.size()) ? &_allocations[index] : nullptr;
+}
+
+/*----- Reports -----*/
+
+void MemoryTracker::takeSnapshot(MemorySnapshot* snapshot)
+{
+	sceKernelLockLwMutex(&lock, 1, NULL);
+	snapshot->serial = nextSerial;
+	snapshot->allocations = _allocations.size();
+	memcpy(snapshot->poolBytes, _poolBytes, sizeof(_poolBytes));
+	memcpy(snapshot->categoryBytes, _categoryBytes, sizeof(_categoryBytes));
+	sceKernelUnlockLwMutex(&lock, 1);
+}
+
+void MemoryTracker::logSnapshotDiff(const MemorySnapshot* snapshot)
+{
+	sceKernelLockLwMutex(&lock, 1, NULL);
+	vitaPrintf("\nMemory since snapshot: %u allocations made, %d live (%u then, %u now)\n", nextSerial - snapshot->serial,
+		(int)_allocations.size() - (int)snapshot->allocations, snapshot->allocations, (unsigned int)_allocations.size());
+	for (int pool = 0; pool < NUMBER_OF_MEMORY_POOLS; pool++)
+	{
+		if (_poolBytes[pool] != snapshot->poolBytes[pool])
+			vitaPrintf("\t%-20s %+d bytes (%u now)\n", _poolNames[pool], (int)(_poolBytes[pool] - snapshot->poolBytes[pool]), _poolBytes[pool]);
+	}
+	for (int category = 0; category < NUMBER_OF_MEMORY_CATEGORIES; category++)
+	{
+		if (_categoryBytes[category] != snapshot->categoryBytes[category])
+			vitaPrintf("\t%-20s %+d bytes (%u now)\n", _categoryNames[category],
+				(int)(_categoryBytes[category] - snapshot->categoryBytes[category]), _categoryBytes[category]);
+	}
+
+	//anything allocated after the snapshot that is still around
+	std::vector<MemoryAllocation>::const_iterator iter;
+	for (iter = _allocations.begin(); iter != _allocations.end(); iter++)
+	{
+		if (iter->serial < snapshot->serial)
+			continue;
+		vitaPrintf("\tnew: %-24s %9u bytes, %s %s, called from %p\n", iter->name, iter->allocated,
+			_poolNames[iter->pool], _categoryNames[iter->category], iter->callSite);
+	}
+	sceKernelUnlockLwMutex(&lock, 1);
+}
+
+void MemoryTracker::logAllocations()
+{
+	sceKernelLockLwMutex(&lock, 1, NULL);
+	for (int pool = 0; pool < NUMBER_OF_MEMORY_POOLS; pool++)
+	{
+		SceSize totalRequested = 0;
+		SceSize totalAllocated = 0;
+
+		vitaPrintf("%s:\n", _poolNames[pool]);
+		for (int category = 0; category < NUMBER_OF_MEMORY_CATEGORIES; category++)
+		{
+			for (unsigned int i = 0; i < _allocations.size(); i++)
+			{
+				const MemoryAllocation* allocation = &_allocations[i];
+				if (allocation->pool != pool || allocation->category != category)
+					continue;
+
+				//only the first of a name and call site logs, for all of them
+				bool seen = false;
+				for (unsigned int j = 0; j < i && !seen; j++)
+				{
+					seen = _allocations[j].pool == pool && _allocations[j].callSite == allocation->callSite &&
+						strcmp(_allocations[j].name, allocation->name) == 0;
+				}
+				if (seen)
+					continue;
+
+				unsigned int count = 0;
+				SceSize requested = 0;
+				SceSize allocated = 0;
+				for (unsigned int j = i; j < _allocations.size(); j++)
+				{
+					if (_allocations[j].pool == pool && _allocations[j].callSite == allocation->callSite &&
+						strcmp(_allocations[j].name, allocation->name) == 0)
+					{
+						count++;
+						requested += _allocations[j].requested;
+						allocated += _allocations[j].allocated;
+					}
+				}
+
+				vitaPrintf("\t%-8s %-24s %9u bytes (%u requested, %u padding)", _categoryNames[category], allocation->name,
+					allocated, requested, allocated - requested);
+				if (count > 1)
+					vitaPrintf(" in %u allocations", count);
+				vitaPrintf("\n");
+				totalRequested += requested;
+				totalAllocated += allocated;
+			}
+		}
+		vitaPrintf("\tTotal: %u bytes (%.2fMB), %u bytes of padding\n", totalAllocated, MEGABYTES(totalAllocated),
+			totalAllocated - totalRequested);
+	}
+
+	vitaPrintf("By category:\n");
+	for (int category = 0; category < NUMBER_OF_MEMORY_CATEGORIES; category++)
+	{
+		if (_categoryBytes[category] == 0 && stats.categoryPeak[category] == 0)
+			continue;
+		vitaPrintf("\t%-8s %.2fMB, peak %.2fMB", _categoryNames[category], MEGABYTES(_categoryBytes[category]),
+			MEGABYTES(stats.categoryPeak[category]));
+		if (_budgets[category] != 0)
+			vitaPrintf(", budget %.2fMB", MEGABYTES(_budgets[category]));
+		vitaPrintf("\n");
+	}
+	if (stats.overBudget != 0 || stats.unknownFrees != 0)
+		vitaPrintf("ERROR: %u allocations went over budget, %u frees of unknown memory\n", stats.overBudget, stats.unknownFrees);
+	sceKernelUnlockLwMutex(&lock, 1);
+}
+
+unsigned int MemoryTracker::logLeaks()
+{
+	sceKernelLockLwMutex(&lock, 1, NULL);
+	unsigned int leaks = _allocations.size();
+	vitaPrintf("\nMemory tracker: %u allocations, %u frees\n", stats.allocations, stats.frees);
+	if (leaks == 0)
+		vitaPrintf("No leaks\n");
+	else
+		vitaPrintf("ERROR: %u allocations were never freed:\n", leaks);
+	std::vector<MemoryAllocation>::const_iterator iter;
+	for (iter = _allocations.begin(); iter != _allocations.end(); iter++)
+	{
+		vitaPrintf("\t#%-5u %-24s %9u bytes, %s %s, called from %p\n", iter->serial, iter->name, iter->allocated,
+			_poolNames[iter->pool], _categoryNames[iter->category], iter->callSite);
+	}
+	sceKernelUnlockLwMutex(&lock, 1);
+	return leaks;
+}
+
+const MemoryTrackerStats* MemoryTracker::getStats()
+{
+	return &stats;
+}
+
+const char* MemoryTracker::getCategoryName(MemoryCategory category)
+{
+	return (category < NUMBER_OF_MEMORY_CATEGORIES) ? _categoryNames[category] : "?";
+}
+
+const char* MemoryTracker::getPoolName(MemoryPool pool)
+{
+	return (pool < NUMBER_OF_MEMORY_POOLS) ? _poolNames[pool] : "?";
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+//----------------------------------------------
+// MemoryTracker Class
+// Records every memblock and host allocation the graphics system hands out, tagged
+// with what it is for (a category), which pool it came from and where it was called
+// from, until it is freed. Categories can be given a budget in bytes, an allocation
+// that takes one over is logged with its call site and can be made to assert, so a
+// regression shows up the first time it runs rather than as an out of memory later.
+// Snapshots remember the totals and how far allocation got, diffing against one lists
+// what grew and every allocation made since that is still alive. Whatever is left at
+// shutdown is reported as a leak.
+// Call sites are return addresses, run them through addr2line against the .elf.
+// GPU memory is only allocated on the render thread, but the shader patcher's host memory
+// is also recorded from the ProgramCache's thread, so recording, removing and the reports
+// take a lock. getAllocation() doesn't, it is for the render thread with no patching going on
+//-----------------------------------------------
+
+#include <vector>
+
+#include <psp2/types.h>
+#include <psp2/kernel/threadmgr.h>
+
+//Memory pools a GPU allocation can live in, used for the memory budget report
+typedef enum MemoryPool
+{
+	MEMORY_POOL_CDRAM = 0,		//video memory
+	MEMORY_POOL_LPDDR,			//main memory mapped for the GPU
+	MEMORY_POOL_HOST			//main memory only the CPU (and libgxm internals) touch
+} MemoryPool;
+#define NUMBER_OF_MEMORY_POOLS 3
+
+//What an allocation is for, each category can have its own budget
+typedef enum MemoryCategory
+{
+	MEMORY_CATEGORY_OTHER = 0,		//anything that didn't say
+	MEMORY_CATEGORY_DISPLAY,		//display, depth and offscreen buffers, render target memory
+	MEMORY_CATEGORY_CONTEXT,		//gxm context ring buffers and host memory
+	MEMORY_CATEGORY_SHADERS,		//shader patcher buffers, USSE code and host memory
+	MEMORY_CATEGORY_TEXTURES,
+	MEMORY_CATEGORY_GEOMETRY,		//vertex and index buffers
+	MEMORY_CATEGORY_UI,				//sprite batch and font atlas
+	MEMORY_CATEGORY_UNIFORMS		//uniform buffers and rings
+} MemoryCategory;
+#define NUMBER_OF_MEMORY_CATEGORIES 8
+
+//One live allocation, requested is what the caller asked for, allocated includes memblock padding
+typedef struct MemoryAllocation
+{
+	const char* name;
+	MemoryCategory category;
+	MemoryPool pool;
+	SceUID uid;					//-1 for host memory, that is looked up by address instead
+	const void* address;
+	SceSize requested;
+	SceSize allocated;
+	const void* callSite;		//return address of the call that allocated it
+	unsigned int serial;		//order of allocation, counts up from 1
+} MemoryAllocation;
+
+//Totals at a point in time, see takeSnapshot()
+typedef struct MemorySnapshot
+{
+	unsigned int serial;		//allocations with a serial from here on were made after the snapshot
+	unsigned int allocations;
+	SceSize poolBytes[NUMBER_OF_MEMORY_POOLS];
+	SceSize categoryBytes[NUMBER_OF_MEMORY_CATEGORIES];
+} MemorySnapshot;
+
+typedef struct MemoryTrackerStats
+{
+	unsigned int allocations;			//recorded since init()
+	unsigned int frees;
+	unsigned int overBudget;			//allocations that took a category over its budget
+	unsigned int unknownFrees;			//frees of something that was never recorded or already freed
+	SceSize categoryPeak[NUMBER_OF_MEMORY_CATEGORIES];
+} MemoryTrackerStats;
+
+class MemoryTracker
+{
+public:
+	MemoryTracker();
+	~MemoryTracker();
+
+	//budgets holds bytes per category, 0 for no limit. With strict set going over a budget asserts
+	void init(const SceSize* budgets, bool strict);
+	void setBudget(MemoryCategory category, SceSize budget);
+	SceSize getBudget(MemoryCategory category);
+
+	//Memblocks are looked up by uid, host memory (uid -1) by address
+	void record(const char* name, MemoryCategory category, MemoryPool pool, SceUID uid, const void* address,
+		SceSize requested, SceSize allocated, const void* callSite);
+	//Both return false, and log it, when there is no such allocation. The memory shouldn't be freed then
+	bool remove(SceUID uid);
+	bool removeHost(const void* address);
+	bool isTracked(SceUID uid);
+
+	SceSize getPoolUsage(MemoryPool pool);
+	SceSize getCategoryUsage(MemoryCategory category);
+	unsigned int getAllocationCount();
+	const MemoryAllocation* getAllocation(unsigned int index);
+
+	void takeSnapshot(MemorySnapshot* snapshot);
+	//Logs how every pool and category changed since the snapshot and each allocation made since that is still alive
+	void logSnapshotDiff(const MemorySnapshot* snapshot);
+	//Logs each pool by category, allocations with the same name and call site are summed into one line
+	void logAllocations();
+	//Logs everything still allocated as a leak, returns how many there were
+	unsigned int logLeaks();
+
+	const MemoryTrackerStats* getStats();
+	static const char* getCategoryName(MemoryCategory category);
+	static const char* getPoolName(MemoryPool pool);
+
+private:
+	void erase(unsigned int index);
+
+	MemoryTrackerStats stats;
+	SceSize _budgets[NUMBER_OF_MEMORY_CATEGORIES];
+	bool strict;
+	unsigned int nextSerial;
+	//running totals so the overlay can ask every frame without walking the list
+	SceSize _poolBytes[NUMBER_OF_MEMORY_POOLS];
+	SceSize _categoryBytes[NUMBER_OF_MEMORY_CATEGORIES];
+
+	std::vector<MemoryAllocation> _allocations;
+	SceKernelLwMutexWork lock;
+};
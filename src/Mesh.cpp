@@ -0,0 +1,447 @@
+#include "Mesh.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <psp2/io/fcntl.h>
+#include <psp2/kernel/processmgr.h>
+
+static const char* _semanticNames[NUMBER_OF_MESH_SEMANTICS] = { "aPosition", "aNormal", "aTexcoord", "aColor" };
+
+Mesh::Mesh()
+{
+	memset(&header, 0, sizeof(header));
+	memset(_attributes, 0, sizeof(_attributes));
+	memset(_lods, 0, sizeof(_lods));
+	_submeshes = nullptr;
+	vertices_ptr = nullptr;
+	indices_ptr = nullptr;
+}
+
+Mesh::~Mesh()
+{
+	unload();
+}
+
+bool Mesh::validate(const MeshHeader* fileHeader, SceSize fileSize)
+{
+	if (fileHeader->magic != MESH_MAGIC || fileHeader->version != MESH_VERSION)
+	{
+		vitaPrintf("ERROR: not a version %u mesh file (magic 0x%08X, version %u)\n", MESH_VERSION, fileHeader->magic, fileHeader->version);
+		return false;
+	}
+	if (fileHeader->fileSize != fileSize)
+	{
+		vitaPrintf("ERROR: mesh file is %u bytes, the header says %u\n", fileSize, fileHeader->fileSize);
+		return false;
+	}
+	if (fileHeader->attributeCount == 0 || fileHeader->attributeCount > MESH_MAX_ATTRIBUTES ||
+		fileHeader->submeshCount == 0 || fileHeader->submeshCount > MESH_MAX_SUBMESHES ||
+		fileHeader->lodCount == 0 || fileHeader->lodCount > MESH_MAX_LODS)
+	{
+		vitaPrintf("ERROR: mesh has %u attributes, %u submeshes and %u LODs\n", fileHeader->attributeCount,
+			fileHeader->submeshCount, fileHeader->lodCount);
+		return false;
+	}
+
+	//the tables sit between the header and the vertex blob. Every size is checked against the room left rather
+	//than added up, a crafted header can't wrap the 32 bit sums around
+	if (fileHeader->vertexDataOffset < sizeof(MeshHeader) || fileHeader->vertexDataOffset > fileSize ||
+		fileHeader->attributesOffset < sizeof(MeshHeader) || fileHeader->attributesOffset > fileHeader->vertexDataOffset ||
+		fileHeader->attributeCount > (fileHeader->vertexDataOffset - fileHeader->attributesOffset) / sizeof(MeshAttribute) ||
+		fileHeader->submeshesOffset < sizeof(MeshHeader) || fileHeader->submeshesOffset > fileHeader->vertexDataOffset ||
+		fileHeader->submeshCount > (fileHeader->vertexDataOffset - fileHeader->submeshesOffset) / sizeof(MeshSubmesh) ||
+		fileHeader->lodsOffset < sizeof(MeshHeader) || fileHeader->lodsOffset > fileHeader->vertexDataOffset ||
+		fileHeader->lodCount > (fileHeader->vertexDataOffset - fileHeader->lodsOffset) / sizeof(MeshLod))
+	{
+		vitaPrintf("ERROR: mesh attribute/submesh/LOD tables are malformed\n");
+		return false;
+	}
+
+	if (fileHeader->indexFormat >= NUMBER_OF_MESH_INDEX_FORMATS)
+	{
+		vitaPrintf("ERROR: mesh index format %u is unknown\n", fileHeader->indexFormat);
+		return false;
+	}
+
+	//the blobs have to be where the loader expects them, in order and inside the file
+	SceSize indexSize = (fileHeader->indexFormat == MESH_INDEX_16BIT) ? 2 : 4;
+	if (fileHeader->vertexStride == 0 || fileHeader->vertexDataSize % fileHeader->vertexStride != 0 ||
+		fileHeader->vertexDataSize / fileHeader->vertexStride != fileHeader->vertexCount ||
+		fileHeader->indexDataSize % indexSize != 0 || fileHeader->indexDataSize / indexSize != fileHeader->indexCount ||
+		fileHeader->vertexDataOffset % MESH_BLOB_ALIGNMENT != 0 || fileHeader->indexDataOffset % MESH_BLOB_ALIGNMENT != 0 ||
+		fileHeader->vertexDataSize > fileSize - fileHeader->vertexDataOffset ||
+		fileHeader->indexDataOffset < fileHeader->vertexDataOffset + fileHeader->vertexDataSize ||
+		fileHeader->indexDataOffset > fileSize || fileHeader->indexDataSize > fileSize - fileHeader->indexDataOffset)
+	{
+		vitaPrintf("ERROR: mesh vertex/index blobs are malformed\n");
+		return false;
+	}
+	return true;
+}
+
+bool Mesh::validateTables()
+{
+	//bytes a component of each MeshAttributeFormat takes
+	static const unsigned int componentSizes[NUMBER_OF_MESH_FORMATS] = { 4, 1, 2, 2, 1 };
+	for (unsigned int i = 0; i < header.attributeCount; i++)
+	{
+		const MeshAttribute* attribute = &_attributes[i];
+		if (attribute->format >= NUMBER_OF_MESH_FORMATS || attribute->componentCount == 0 || attribute->componentCount > 4 ||
+			attribute->offset + attribute->componentCount * componentSizes[attribute->format] > header.vertexStride)
+		{
+			vitaPrintf("ERROR: mesh attribute %u (format %u, %u components at %u) doesn't fit a %u byte vertex\n", i,
+				attribute->format, attribute->componentCount, attribute->offset, header.vertexStride);
+			return false;
+		}
+	}
+	for (unsigned int i = 0; i < header.submeshCount; i++)
+	{
+		if (_submeshes[i].firstIndex > header.indexCount || _submeshes[i].indexCount > header.indexCount - _submeshes[i].firstIndex)
+		{
+			vitaPrintf("ERROR: mesh submesh %u refers to %u indices from %u of %u\n", i, _submeshes[i].indexCount,
+				_submeshes[i].firstIndex, header.indexCount);
+			return false;
+		}
+	}
+	for (unsigned int i = 0; i < header.lodCount; i++)
+	{
+		if (_lods[i].submeshCount == 0 || _lods[i].firstSubmesh > header.submeshCount ||
+			_lods[i].submeshCount > header.submeshCount - _lods[i].firstSubmesh)
+		{
+			vitaPrintf("ERROR: mesh LOD %u refers to %u submeshes from %u of %u\n", i, _lods[i].submeshCount,
+				_lods[i].firstSubmesh, header.submeshCount);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Mesh::load(const char* path, SceKernelMemBlockType memoryType)
+{
+	vitaPrintf("\nLoading mesh: %s\n", path);
+	unload();
+	SceUInt64 startTime = sceKernelGetProcessTimeWide();
+
+	SceUID fd = sceIoOpen(path, SCE_O_RDONLY, 0);
+	if (fd < 0)
+	{
+		vitaPrintf("sceIoOpen() result: 0x%08X\n", fd);
+		return false;
+	}
+	SceSize fileSize = (SceSize)sceIoLseek(fd, 0, SCE_SEEK_END);
+	sceIoLseek(fd, 0, SCE_SEEK_SET);
+
+	//the header and tables are tiny and come first, read them in one go
+	MeshHeader fileHeader;
+	if (!readFully(fd, &fileHeader, sizeof(fileHeader)) || !validate(&fileHeader, fileSize))
+	{
+		sceIoClose(fd);
+		return false;
+	}
+	SceSize tableSize = fileHeader.vertexDataOffset - sizeof(MeshHeader);
+	char* tables = (char*)malloc(tableSize);
+	if (!readFully(fd, tables, tableSize))
+	{
+		vitaPrintf("ERROR: could not read the mesh tables\n");
+		free(tables);
+		sceIoClose(fd);
+		return false;
+	}
+	header = fileHeader;
+	memcpy(_attributes, tables + (header.attributesOffset - sizeof(MeshHeader)), header.attributeCount * sizeof(MeshAttribute));
+	_submeshes = (MeshSubmesh*)malloc(header.submeshCount * sizeof(MeshSubmesh));
+	memcpy(_submeshes, tables + (header.submeshesOffset - sizeof(MeshHeader)), header.submeshCount * sizeof(MeshSubmesh));
+	memcpy(_lods, tables + (header.lodsOffset - sizeof(MeshHeader)), header.lodCount * sizeof(MeshLod));
+	free(tables);
+	if (!validateTables())
+	{
+		sceIoClose(fd);
+		unload();
+		return false;
+	}
+
+	//everything from the vertex blob to the end of the index blob goes into GPU memory untouched
+	SceSize blobSize = header.indexDataOffset + header.indexDataSize - header.vertexDataOffset;
+	SceUID uid = -1;
+	char* blob_ptr = (char*)Graphics::getInstance()->allocGraphicsMem(
+		memoryType,
+		blobSize,
+		MESH_BLOB_ALIGNMENT,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		&uid,
+		"mesh",
+		MEMORY_CATEGORY_GEOMETRY
+	);
+	blob = GpuBuffer(blob_ptr, uid);
+	if (!readFully(fd, blob_ptr, blobSize))
+	{
+		vitaPrintf("ERROR: could not read the mesh vertex/index data\n");
+		sceIoClose(fd);
+		unload();
+		return false;
+	}
+	sceIoClose(fd);
+
+	vertices_ptr = blob_ptr;
+	indices_ptr = blob_ptr + (header.indexDataOffset - header.vertexDataOffset);
+
+	SceUInt64 loadTime = sceKernelGetProcessTimeWide() - startTime;
+	vitaPrintf("Loaded %u vertices (%u byte stride), %u indices, %u submeshes, %u LODs, %u bytes in %.2fms (%.2fMB/s)\n", header.vertexCount,
+		header.vertexStride, header.indexCount, header.submeshCount, header.lodCount, fileSize, loadTime / 1000.0,
+		(loadTime > 0) ? (fileSize / (1024.0 * 1024.0)) / (loadTime / 1000000.0) : 0.0);
+	return true;
+}
+
+bool Mesh::loadInPlace(const void* fileData, SceSize fileSize)
+{
+	unload();
+
+	const char* file = (const char*)fileData;
+	if (fileSize < sizeof(MeshHeader) || !validate((const MeshHeader*)file, fileSize))
+		return false;
+
+	header = *(const MeshHeader*)file;
+	memcpy(_attributes, file + header.attributesOffset, header.attributeCount * sizeof(MeshAttribute));
+	_submeshes = (MeshSubmesh*)malloc(header.submeshCount * sizeof(MeshSubmesh));
+	memcpy(_submeshes, file + header.submeshesOffset, header.submeshCount * sizeof(MeshSubmesh));
+	memcpy(_lods, file + header.lodsOffset, header.lodCount * sizeof(MeshLod));
+	if (!validateTables())
+	{
+		unload();
+		return false;
+	}
+
+	vertices_ptr = file + header.vertexDataOffset;
+	indices_ptr = file + header.indexDataOffset;
+	return true;
+}
+
+void Mesh::unload()
+{
+	blob.reset();
+	if (_submeshes != nullptr)
+	{
+		free(_submeshes);
+		_submeshes = nullptr;
+	}
+	vertices_ptr = nullptr;
+	indices_ptr = nullptr;
+	memset(&header, 0, sizeof(header));
+	memset(_lods, 0, sizeof(_lods));
+}
+
+bool Mesh::isLoaded()
+{
+	return vertices_ptr != nullptr;
+}
+
+/*----- Vertex layout -----*/
+
+int Mesh::getVertexAttributes(SceGxmVertexAttribute* attributes, int maxAttributes)
+{
+	int count = 0;
+	for (int i = 0; i < header.attributeCount && count < maxAttributes; i++, count++)
+	{
+		attributes[count].streamIndex = 0;
+		attributes[count].offset = _attributes[i].offset;
+		attributes[count].componentCount = _attributes[i].componentCount;
+		switch (_attributes[i].format)
+		{
+		case MESH_FORMAT_U8N:
+			attributes[count].format = SCE_GXM_ATTRIBUTE_FORMAT_U8N;
+			break;
+		case MESH_FORMAT_F16:
+			attributes[count].format = SCE_GXM_ATTRIBUTE_FORMAT_F16;
+			break;
+		case MESH_FORMAT_S16N:
+			attributes[count].format = SCE_GXM_ATTRIBUTE_FORMAT_S16N;
+			break;
+		case MESH_FORMAT_S8N:
+			attributes[count].format = SCE_GXM_ATTRIBUTE_FORMAT_S8N;
+			break;
+		case MESH_FORMAT_F32:
+		default:
+			attributes[count].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+			break;
+		}
+		attributes[count].regIndex = 0;
+	}
+	return count;
+}
+
+void Mesh::getAttributeNames(const char** names, int maxAttributes)
+{
+	for (int i = 0; i < header.attributeCount && i < maxAttributes; i++)
+		names[i] = (_attributes[i].semantic < NUMBER_OF_MESH_SEMANTICS) ? _semanticNames[_attributes[i].semantic] : "";
+}
+
+void Mesh::getVertexStream(SceGxmVertexStream* stream)
+{
+	stream->stride = header.vertexStride;
+	stream->indexSource = (header.indexFormat == MESH_INDEX_16BIT) ? SCE_GXM_INDEX_SOURCE_INDEX_16BIT : SCE_GXM_INDEX_SOURCE_INDEX_32BIT;
+}
+
+void Mesh::getDecodeMatrix(const float* worldViewProjection, float* matrix)
+{
+	//the shaders do mul(float4(position, 1), wvp), so a row vector times a row major matrix.
+	//decode is diag(scale) with bias on the bottom row, decode * wvp scales the first three rows
+	//by the scale and adds the biased rows into the last one
+	for (int column = 0; column < 4; column++)
+	{
+		for (int row = 0; row < 3; row++)
+			matrix[row * 4 + column] = header.positionScale[row] * worldViewProjection[row * 4 + column];
+		matrix[12 + column] = worldViewProjection[12 + column] +
+			header.positionBias[0] * worldViewProjection[column] +
+			header.positionBias[1] * worldViewProjection[4 + column] +
+			header.positionBias[2] * worldViewProjection[8 + column];
+	}
+}
+
+bool Mesh::hasPackedNormals()
+{
+	for (int i = 0; i < header.attributeCount; i++)
+	{
+		if (_attributes[i].semantic == MESH_SEMANTIC_NORMAL)
+			return _attributes[i].componentCount == 2;
+	}
+	return false;
+}
+
+/*----- Drawing -----*/
+
+void Mesh::draw()
+{
+	drawLod(0);
+}
+
+void Mesh::drawLod(unsigned int lod)
+{
+	if (lod >= header.lodCount)
+		return;
+
+	for (unsigned int i = 0; i < _lods[lod].submeshCount; i++)
+		drawSubmesh(_lods[lod].firstSubmesh + i);
+	Graphics::getInstance()->recordLodDraw(lod, _lods[lod].triangleCount);
+}
+
+void Mesh::drawSubmesh(unsigned int submesh)
+{
+	if (submesh >= header.submeshCount)
+		return;
+
+	const MeshSubmesh* range = &_submeshes[submesh];
+	SceSize indexSize = (header.indexFormat == MESH_INDEX_16BIT) ? 2 : 4;
+	Graphics::getInstance()->patcherSetVertexStream(0, vertices_ptr);
+	Graphics::getInstance()->draw(
+		SCE_GXM_PRIMITIVE_TRIANGLES,
+		(header.indexFormat == MESH_INDEX_16BIT) ? SCE_GXM_INDEX_FORMAT_U16 : SCE_GXM_INDEX_FORMAT_U32,
+		(const char*)indices_ptr + range->firstIndex * indexSize,
+		range->indexCount
+	);
+}
+
+/*----- Level of detail -----*/
+
+float Mesh::pixelsPerUnit(float distance, float fieldOfView, unsigned int screenHeight)
+{
+	if (distance <= 0.0f)
+		return 1e30f;
+	return screenHeight / (2.0f * tanf(0.5f * fieldOfView) * distance);
+}
+
+void Mesh::initLodState(LodState* state)
+{
+	state->lod = 0;
+	state->fadeFromLod = 0;
+	state->fadeFrame = 0;
+	state->fadeFrames = 0;
+}
+
+void Mesh::updateLod(float pixelsPerUnit, LodState* state, const LodParams* params)
+{
+	if (state->fadeFrame < state->fadeFrames)
+		state->fadeFrame++;
+	if (header.lodCount <= 1)
+		return;
+
+	unsigned int current = (state->lod < header.lodCount) ? state->lod : header.lodCount - 1;
+	unsigned int target = current;
+	//errors grow with the LOD index, so the first one over the limit ends the search
+	if (_lods[current].error * pixelsPerUnit > params->maxPixelError * (1.0f + params->hysteresis))
+	{
+		target = 0;
+		for (unsigned int i = current; i > 0; i--)
+		{
+			if (_lods[i - 1].error * pixelsPerUnit <= params->maxPixelError)
+			{
+				target = i - 1;
+				break;
+			}
+		}
+	}
+	else
+	{
+		for (unsigned int i = current + 1; i < header.lodCount; i++)
+		{
+			if (_lods[i].error * pixelsPerUnit > params->maxPixelError * (1.0f - params->hysteresis))
+				break;
+			target = i;
+		}
+	}
+
+	if (target != current)
+	{
+		//switching again mid fade jumps straight to the new pair, the dither hides it
+		state->fadeFromLod = current;
+		state->lod = target;
+		state->fadeFrame = 0;
+		state->fadeFrames = params->fadeFrames;
+	}
+}
+
+unsigned int Mesh::getLodDraws(const LodState* state, LodDraw* draws)
+{
+	draws[0].lod = state->lod;
+	if (state->fadeFrame >= state->fadeFrames)
+	{
+		draws[0].fade = 1.0f;
+		return 1;
+	}
+
+	//positive fade keeps that fraction of the dither pattern, negative keeps the rest of it
+	float fade = (state->fadeFrame + 1) / (float)(state->fadeFrames + 1);
+	draws[0].fade = fade;
+	draws[1].lod = state->fadeFromLod;
+	draws[1].fade = -fade;
+	return 2;
+}
+
+unsigned int Mesh::getLodCount()
+{
+	return header.lodCount;
+}
+
+const MeshLod* Mesh::getLod(unsigned int lod)
+{
+	return (lod < header.lodCount) ? &_lods[lod] : nullptr;
+}
+
+/*----- Accessors -----*/
+
+const MeshHeader* Mesh::getHeader()
+{
+	return &header;
+}
+
+const MeshSubmesh* Mesh::getSubmesh(unsigned int submesh)
+{
+	return (submesh < header.submeshCount) ? &_submeshes[submesh] : nullptr;
+}
+
+const MeshBounds* Mesh::getBounds()
+{
+	return &header.bounds;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+//----------------------------------------------
+// Mesh Class
+// Loads a .mesh file (see MeshFormat.h) made by tools/meshconv. The header and
+// tables are read into host memory, the vertex and index blobs are read straight
+// into one GPU memblock in a single read, nothing is parsed or converted.
+// A mesh can also be pointed at a file image already sitting in GPU mapped memory
+//-----------------------------------------------
+
+#include "Graphics.h"
+#include "MeshFormat.h"
+
+//Default level of detail selection, see Mesh::updateLod()
+#define LOD_MAX_PIXEL_ERROR		1.0f	//coarsest LOD whose error stays under this many pixels is picked
+#define LOD_HYSTERESIS			0.25f	//fraction the error has to move past the threshold before switching
+#define LOD_FADE_FRAMES			8		//frames a switch is cross-faded over, 0 switches instantly
+
+typedef struct LodParams
+{
+	float maxPixelError;
+	float hysteresis;
+	unsigned int fadeFrames;
+} LodParams;
+
+static const LodParams defaultLod = {
+	LOD_MAX_PIXEL_ERROR,	//max pixel error
+	LOD_HYSTERESIS,			//hysteresis
+	LOD_FADE_FRAMES			//fade frames
+};
+
+//Per instance selection state, a mesh drawn several times needs one of these per copy
+typedef struct LodState
+{
+	unsigned int lod;
+	unsigned int fadeFromLod;
+	unsigned int fadeFrame;		//fadeFrames once the fade is done
+	unsigned int fadeFrames;
+} LodState;
+
+//One draw of a LOD, fade goes into the lodFade uniform of mesh_fade_fragment.cg
+typedef struct LodDraw
+{
+	unsigned int lod;
+	float fade;
+} LodDraw;
+
+class Mesh
+{
+public:
+	Mesh();
+	~Mesh();
+
+	//Reads the file at path, the blobs go into memory of the given memblock type
+	bool load(const char* path, SceKernelMemBlockType memoryType = SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE);
+	//Uses a whole .mesh file image in place, the memory must stay valid and be mapped for the GPU
+	bool loadInPlace(const void* fileData, SceSize fileSize);
+	//Its own memblock goes to Graphics' release queue, frames already submitted can still draw from it
+	void unload();
+	bool isLoaded();
+
+	//Fills attributes with one entry per vertex attribute, the regIndex of each is left for the patcher
+	int getVertexAttributes(SceGxmVertexAttribute* attributes, int maxAttributes);
+	//Shader input names matching getVertexAttributes(), "aPosition", "aNormal", "aTexcoord" and "aColor"
+	void getAttributeNames(const char** names, int maxAttributes);
+	void getVertexStream(SceGxmVertexStream* stream);
+	//Folds the position dequantization into a world view projection matrix, both 16 floats row major.
+	//Quantized positions then cost nothing extra in the shader
+	void getDecodeMatrix(const float* worldViewProjection, float* matrix);
+	//True when normals are two component octahedral, they need the mesh shader (decodeOctahedral) to unpack
+	bool hasPackedNormals();
+
+	void draw();
+	void drawLod(unsigned int lod);
+	void drawSubmesh(unsigned int submesh);
+
+	/*----- Level of detail -----*/
+	//Pixels one model unit covers at distance from the camera, for a perspective projection with
+	//the given vertical field of view in radians onto a viewport screenHeight pixels high
+	static float pixelsPerUnit(float distance, float fieldOfView, unsigned int screenHeight);
+	void initLodState(LodState* state);
+	//Picks the LOD for this frame, call once per frame per instance. The coarsest LOD whose error
+	//projects to under maxPixelError is chosen, with hysteresis so objects sitting on a threshold don't flicker
+	void updateLod(float pixelsPerUnit, LodState* state, const LodParams* params = &defaultLod);
+	//What to draw for the state, one draw with fade 1 normally or two complementary dithered draws
+	//(new LOD fading in, old fading out) while switching. Returns the number of draws
+	unsigned int getLodDraws(const LodState* state, LodDraw* draws);
+	unsigned int getLodCount();
+	const MeshLod* getLod(unsigned int lod);
+
+	const MeshHeader* getHeader();
+	const MeshSubmesh* getSubmesh(unsigned int submesh);
+	const MeshBounds* getBounds();
+
+private:
+	bool validate(const MeshHeader* header, SceSize fileSize);
+	//Checks the attribute, submesh and LOD tables against the header once they are read
+	bool validateTables();
+
+	MeshHeader header;
+	MeshAttribute _attributes[MESH_MAX_ATTRIBUTES];
+	MeshSubmesh* _submeshes;
+	MeshLod _lods[MESH_MAX_LODS];
+
+	//where the blobs ended up
+	const void* vertices_ptr;
+	const void* indices_ptr;
+	//the memblock holding them, empty when the mesh points into someone else's memory
+	GpuBuffer blob;
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+//----------------------------------------------
+// Binary mesh file format (.mesh)
+// Shared by the runtime loader (Mesh) and the offline converter in tools/meshconv,
+// so it only uses fixed size types. Everything is little endian like the Vita.
+//
+// Layout, every offset is from the start of the file:
+//	MeshHeader
+//	MeshAttribute[attributeCount]
+//	MeshSubmesh[submeshCount]
+//	MeshLod[lodCount]
+//	padding to MESH_BLOB_ALIGNMENT
+//	vertex blob, vertexCount * vertexStride bytes, ready for the GPU as is
+//	padding to MESH_BLOB_ALIGNMENT
+//	index blob, indexCount 16 or 32 bit indices
+//
+// The vertex and index blobs are contiguous apart from the padding, so the loader
+// reads both straight into one GPU memblock with a single read and nothing to parse
+//
+// Attributes can be quantized to cut vertex fetch bandwidth:
+//	positions as F16 or S16N, the shader sees a value in roughly -1..1 and
+//	the real position is value * positionScale + positionBias (see Mesh::getDecodeMatrix)
+//	normals as two S16N or S8N components holding an octahedral encoded unit vector,
+//	a normal with three components is never encoded
+//	texcoords as F16
+//
+// Levels of detail share the vertex blob, each one is a run of submeshes in the submesh
+// table with its own indices into the same vertices. LOD 0 is the full detail mesh and
+// every coarser one lists the geometric error it introduces so the runtime can pick one
+// by how big that error would be on screen
+//-----------------------------------------------
+
+#include <stdint.h>
+
+#define MESH_MAGIC					0x4853454D	//"MESH"
+#define MESH_VERSION				3
+//Blob alignment in the file, and so in memory relative to the start of the vertex blob
+#define MESH_BLOB_ALIGNMENT			64
+#define MESH_MAX_ATTRIBUTES			8
+#define MESH_MAX_SUBMESHES			256
+#define MESH_MAX_LODS				8
+
+//What an attribute holds, also picks the shader input it is bound to
+typedef enum MeshSemantic
+{
+	MESH_SEMANTIC_POSITION = 0,
+	MESH_SEMANTIC_NORMAL,
+	MESH_SEMANTIC_TEXCOORD,
+	MESH_SEMANTIC_COLOR
+} MeshSemantic;
+#define NUMBER_OF_MESH_SEMANTICS 4
+
+//Component formats, the loader maps these to SceGxmAttributeFormat
+typedef enum MeshAttributeFormat
+{
+	MESH_FORMAT_F32 = 0,
+	MESH_FORMAT_U8N,
+	MESH_FORMAT_F16,
+	MESH_FORMAT_S16N,
+	MESH_FORMAT_S8N
+} MeshAttributeFormat;
+#define NUMBER_OF_MESH_FORMATS 5
+
+typedef enum MeshIndexFormat
+{
+	MESH_INDEX_16BIT = 0,
+	MESH_INDEX_32BIT
+} MeshIndexFormat;
+#define NUMBER_OF_MESH_INDEX_FORMATS 2
+
+typedef struct MeshBounds
+{
+	float min[3];
+	float max[3];
+	float center[3];
+	float radius;		//bounding sphere around center
+} MeshBounds;
+
+typedef struct MeshAttribute
+{
+	uint8_t semantic;		//MeshSemantic
+	uint8_t format;			//MeshAttributeFormat
+	uint8_t componentCount;
+	uint8_t offset;			//bytes from the start of the vertex, a multiple of the component size
+} MeshAttribute;
+
+//A range of indices drawn with one material
+typedef struct MeshSubmesh
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t material;		//index into the material names the converter logged, meaning is up to the application
+	MeshBounds bounds;
+} MeshSubmesh;
+
+//A level of detail, submeshes firstSubmesh to firstSubmesh + submeshCount of the submesh table
+typedef struct MeshLod
+{
+	uint32_t firstSubmesh;
+	uint32_t submeshCount;
+	uint32_t triangleCount;
+	float error;			//worst distance from the full detail surface in model units, 0 for LOD 0
+} MeshLod;
+
+typedef struct MeshHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t fileSize;
+	uint16_t vertexStride;
+	uint8_t attributeCount;
+	uint8_t indexFormat;	//MeshIndexFormat
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t submeshCount;	//across all levels of detail
+	uint32_t lodCount;
+	uint32_t attributesOffset;
+	uint32_t submeshesOffset;
+	uint32_t lodsOffset;
+	uint32_t vertexDataOffset;
+	uint32_t vertexDataSize;
+	uint32_t indexDataOffset;
+	uint32_t indexDataSize;
+	//undoes the position quantization, 1 and 0 for F32 positions
+	float positionScale[3];
+	float positionBias[3];
+	MeshBounds bounds;
+} MeshHeader;
@@ -0,0 +1,421 @@
+#include "ParticleSystem.h"
+#include "JobSystem.h"
+#include "Simd.h"
+#include "commonUtils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include <psp2/kernel/processmgr.h>
+
+//built from src/shaders/*/particle_*.cg by the Makefile
+extern const SceGxmProgram particle_v_gxp_start;
+extern const SceGxmProgram particle_f_gxp_start;
+
+//16 bit instance indices
+#define PARTICLE_SYSTEM_PARTICLE_LIMIT	65536
+//the corners and indices of the quad every instance draws
+#define PARTICLE_CORNERS_SIZE			(4 * 2 * sizeof(float))
+#define PARTICLE_INDICES_SIZE			16
+
+static const float _corners[4 * 2] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+//two triangles, top left, top right, bottom left then bottom left, top right, bottom right
+static const uint16_t _indices[6] = { 0, 1, 2, 2, 1, 3 };
+
+//additive, dst + src * a
+static const SceGxmBlendInfo _blendInfo = {
+	SCE_GXM_COLOR_MASK_ALL, SCE_GXM_BLEND_FUNC_ADD, SCE_GXM_BLEND_FUNC_ADD,
+	SCE_GXM_BLEND_FACTOR_SRC_ALPHA, SCE_GXM_BLEND_FACTOR_ONE,
+	SCE_GXM_BLEND_FACTOR_ZERO, SCE_GXM_BLEND_FACTOR_ONE
+};
+
+ParticleSystem::ParticleSystem()
+{
+	memset(&stats, 0, sizeof(stats));
+	initialized = false;
+	maxParticles = 0;
+	particleCount = 0;
+
+	arrays_ptr = nullptr;
+	x_ptr = nullptr;
+	y_ptr = nullptr;
+	velocityX_ptr = nullptr;
+	velocityY_ptr = nullptr;
+	life_ptr = nullptr;
+	lifeScale_ptr = nullptr;
+	size_ptr = nullptr;
+	color_ptr = nullptr;
+
+	memset(_emitters, 0, sizeof(_emitters));
+	memset(_emitterDebt, 0, sizeof(_emitterDebt));
+	emitterCount = 0;
+	gravityX = 0.0f;
+	gravityY = 0.0f;
+	drag = 0.0f;
+	randomState = 0x9E3779B9;
+
+	frameTime = 0.0f;
+	frameInstances = 0;
+
+	corners_ptr = nullptr;
+	indices_ptr = nullptr;
+	region_ptr = nullptr;
+
+	vertexProgramID = nullptr;
+	fragmentProgramID = nullptr;
+	screenTransformParam_ptr = nullptr;
+}
+
+ParticleSystem::~ParticleSystem()
+{
+	free(arrays_ptr);
+}
+
+void ParticleSystem::init(unsigned int particles)
+{
+	vitaPrintf("\nInitializing particle system for %u particles\n", particles);
+	if (particles == 0 || particles > PARTICLE_SYSTEM_PARTICLE_LIMIT)
+	{
+		vitaPrintf("ERROR: a particle system holds 1 to %u particles, clamping %u\n", PARTICLE_SYSTEM_PARTICLE_LIMIT, particles);
+		particles = (particles == 0) ? 1 : PARTICLE_SYSTEM_PARTICLE_LIMIT;
+	}
+	maxParticles = particles;
+	Graphics* graphics = Graphics::getInstance();
+
+	//the last SIMD group of a job can run past the particle count, the arrays and regions have room for it
+	unsigned int capacity = ALIGN_MEM(maxParticles, SIMD_WIDTH);
+	arrays_ptr = malloc(8 * capacity * sizeof(float));
+	memset(arrays_ptr, 0, 8 * capacity * sizeof(float));
+	x_ptr = (float*)arrays_ptr;
+	y_ptr = x_ptr + capacity;
+	velocityX_ptr = y_ptr + capacity;
+	velocityY_ptr = velocityX_ptr + capacity;
+	life_ptr = velocityY_ptr + capacity;
+	lifeScale_ptr = life_ptr + capacity;
+	size_ptr = lifeScale_ptr + capacity;
+	color_ptr = (uint32_t*)(size_ptr + capacity);
+	particleCount = 0;
+
+	SceUID uid = -1;
+	SceSize regionSize = capacity * sizeof(ParticleInstance);
+	void* memory_ptr = graphics->allocGraphicsMem(
+		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
+		PARTICLE_CORNERS_SIZE + PARTICLE_INDICES_SIZE,
+		16,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		&uid,
+		"particle_system",
+		MEMORY_CATEGORY_GEOMETRY
+	);
+	memory = GpuBuffer(memory_ptr, uid);
+	corners_ptr = (float*)memory_ptr;
+	indices_ptr = (uint16_t*)((uint8_t*)memory_ptr + PARTICLE_CORNERS_SIZE);
+	instanceRing.init(regionSize, 16, "particle_instances", MEMORY_CATEGORY_GEOMETRY);
+	memcpy(corners_ptr, _corners, sizeof(_corners));
+	memcpy(indices_ptr, _indices, sizeof(_indices));
+
+	vertexProgramID = graphics->patcherRegisterProgram(&particle_v_gxp_start);
+	fragmentProgramID = graphics->patcherRegisterProgram(&particle_f_gxp_start);
+
+	//stream 0 is the quad's corners, read by the index. Stream 1 the instances, read by the instance
+	SceGxmVertexAttribute attributes[3];
+	attributes[0].streamIndex = 0;
+	attributes[0].offset = 0;
+	attributes[0].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	attributes[0].componentCount = 2;
+	attributes[1].streamIndex = 1;
+	attributes[1].offset = 0;
+	attributes[1].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	attributes[1].componentCount = 3;
+	attributes[2].streamIndex = 1;
+	attributes[2].offset = 12; //(x, y, size) * 4
+	attributes[2].format = SCE_GXM_ATTRIBUTE_FORMAT_U8N;
+	attributes[2].componentCount = 4;
+	const char* const names[3] = { "aCorner", "aParticle", "aColor" };
+
+	SceGxmVertexStream streams[2];
+	streams[0].stride = 2 * sizeof(float);
+	streams[0].indexSource = SCE_GXM_INDEX_SOURCE_INDEX_16BIT;
+	streams[1].stride = sizeof(ParticleInstance);
+	streams[1].indexSource = SCE_GXM_INDEX_SOURCE_INSTANCE_16BIT;
+	vertexProgram = graphics->patcherCreateVertexProgram(vertexProgramID, attributes, 3, streams, names, 2);
+	fragmentProgram = graphics->patcherCreateFragmentProgram(fragmentProgramID, vertexProgramID, &_blendInfo);
+
+	screenTransformParam_ptr = sceGxmProgramFindParameterByName(&particle_v_gxp_start, "screenTransform");
+	assert(screenTransformParam_ptr && (sceGxmProgramParameterGetCategory(screenTransformParam_ptr) == SCE_GXM_PARAMETER_CATEGORY_UNIFORM));
+
+	region_ptr = (ParticleInstance*)instanceRing.getRegion();
+	frameInstances = 0;
+	initialized = true;
+}
+
+void ParticleSystem::shutdown()
+{
+	if (!initialized)
+		return;
+	vitaPrintf("\nShutting down particle system\n");
+	logStats();
+
+	//queued behind the frames that may still draw with them, the programs before the GXPs they were patched from
+	Graphics* graphics = Graphics::getInstance();
+	fragmentProgram.reset();
+	vertexProgram.reset();
+	graphics->deferRelease(GPU_RESOURCE_REGISTERED_PROGRAM, fragmentProgramID);
+	graphics->deferRelease(GPU_RESOURCE_REGISTERED_PROGRAM, vertexProgramID);
+	fragmentProgramID = nullptr;
+	vertexProgramID = nullptr;
+	memory.reset();
+	instanceRing.shutdown();
+	corners_ptr = nullptr;
+	indices_ptr = nullptr;
+	region_ptr = nullptr;
+	free(arrays_ptr);
+	arrays_ptr = nullptr;
+	particleCount = 0;
+	frameInstances = 0;
+	initialized = false;
+}
+
+bool ParticleSystem::isInitialized()
+{
+	return initialized;
+}
+
+int ParticleSystem::addEmitter(const ParticleEmitter* emitter)
+{
+	if (emitterCount == PARTICLE_SYSTEM_MAX_EMITTERS)
+	{
+		vitaPrintf("ERROR: a particle system has %d emitters at most\n", PARTICLE_SYSTEM_MAX_EMITTERS);
+		return -1;
+	}
+	_emitters[emitterCount] = *emitter;
+	_emitterDebt[emitterCount] = 0.0f;
+	return (int)emitterCount++;
+}
+
+ParticleEmitter* ParticleSystem::getEmitter(int index)
+{
+	if (index < 0 || index >= (int)emitterCount)
+		return nullptr;
+	return &_emitters[index];
+}
+
+void ParticleSystem::setGravity(float x, float y)
+{
+	gravityX = x;
+	gravityY = y;
+}
+
+void ParticleSystem::setDrag(float drag)
+{
+	this->drag = drag;
+}
+
+void ParticleSystem::clear()
+{
+	particleCount = 0;
+}
+
+float ParticleSystem::random()
+{
+	//xorshift32, the top 24 bits as a fraction
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return (randomState >> 8) * (1.0f / 16777216.0f);
+}
+
+void ParticleSystem::beginFrame(unsigned int frame)
+{
+	region_ptr = (ParticleInstance*)instanceRing.beginFrame(frame);
+	stats.stalls = instanceRing.getStalls();
+	frameInstances = 0;
+}
+
+void ParticleSystem::emit(float dt)
+{
+	stats.emittedLastFrame = 0;
+	stats.droppedLastFrame = 0;
+	for (unsigned int e = 0; e < emitterCount; e++)
+	{
+		ParticleEmitter* emitter = &_emitters[e];
+		if (!emitter->active)
+		{
+			_emitterDebt[e] = 0.0f;
+			continue;
+		}
+
+		//a rate that doesn't fill whole frames carries the fraction over
+		_emitterDebt[e] += emitter->rate * dt;
+		unsigned int count = (unsigned int)_emitterDebt[e];
+		_emitterDebt[e] -= (float)count;
+		if (particleCount + count > maxParticles)
+		{
+			stats.droppedLastFrame += particleCount + count - maxParticles;
+			count = maxParticles - particleCount;
+		}
+
+		uint32_t color = emitter->color & 0x00FFFFFF;
+		float alpha = (float)((emitter->color >> 24) & 0xFF);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int p = particleCount++;
+			float angle = emitter->direction + emitter->spread * (2.0f * random() - 1.0f);
+			float speed = emitter->speedMin + (emitter->speedMax - emitter->speedMin) * random();
+			float lifetime = emitter->lifetimeMin + (emitter->lifetimeMax - emitter->lifetimeMin) * random();
+			if (lifetime <= 0.0f)
+				lifetime = 0.001f;
+			x_ptr[p] = emitter->x;
+			y_ptr[p] = emitter->y;
+			velocityX_ptr[p] = cosf(angle) * speed;
+			velocityY_ptr[p] = sinf(angle) * speed;
+			life_ptr[p] = lifetime;
+			lifeScale_ptr[p] = alpha / lifetime;
+			size_ptr[p] = emitter->sizeMin + (emitter->sizeMax - emitter->sizeMin) * random();
+			color_ptr[p] = color;
+		}
+		stats.emittedLastFrame += count;
+	}
+}
+
+void ParticleSystem::simulateJob(void* userData, unsigned int job)
+{
+	ParticleSystem* system = (ParticleSystem*)userData;
+	unsigned int first = job * PARTICLE_JOB_SIZE;
+	unsigned int end = first + PARTICLE_JOB_SIZE;
+	if (end > system->frameInstances)
+		end = system->frameInstances;
+	system->simulate(first, end);
+}
+
+void ParticleSystem::simulate(unsigned int first, unsigned int end)
+{
+	SimdFloat4 dt = simdSplat(frameTime);
+	SimdFloat4 gravityStepX = simdSplat(gravityX * frameTime);
+	SimdFloat4 gravityStepY = simdSplat(gravityY * frameTime);
+	float keep = 1.0f - drag * frameTime;
+	SimdFloat4 damping = simdSplat((keep > 0.0f) ? keep : 0.0f);
+	SimdFloat4 zero = simdSplat(0.0f);
+
+	//four particles at a time, the group at the end may run into the padding past the particle count
+	for (unsigned int i = first; i < end; i += SIMD_WIDTH)
+	{
+		SimdFloat4 velocityX = simdAdd(simdMul(simdLoad(velocityX_ptr + i), damping), gravityStepX);
+		SimdFloat4 velocityY = simdAdd(simdMul(simdLoad(velocityY_ptr + i), damping), gravityStepY);
+		SimdFloat4 x = simdMulAdd(simdLoad(x_ptr + i), velocityX, dt);
+		SimdFloat4 y = simdMulAdd(simdLoad(y_ptr + i), velocityY, dt);
+		SimdFloat4 life = simdSub(simdLoad(life_ptr + i), dt);
+		simdStore(velocityX_ptr + i, velocityX);
+		simdStore(velocityY_ptr + i, velocityY);
+		simdStore(x_ptr + i, x);
+		simdStore(y_ptr + i, y);
+		simdStore(life_ptr + i, life);
+
+		//dead particles are drawn with no size until removeDead() gets to them
+		SimdFloat4 size = simdSelect(simdGreater(life, zero), simdLoad(size_ptr + i), zero);
+		SimdFloat4 alpha = simdMax(simdMul(life, simdLoad(lifeScale_ptr + i)), zero);
+		SimdUint4 color = simdOr(simdLoadUint(color_ptr + i), simdShiftLeft(simdToUint(alpha), 24));
+
+		//the instance stream is an array of structures, four particles make four rows of x, y, size, color
+		SimdFloat4 colorBits = simdAsFloat(color);
+		simdTranspose(&x, &y, &size, &colorBits);
+		float* instance = (float*)(region_ptr + i);
+		simdStore(instance, x);
+		simdStore(instance + 4, y);
+		simdStore(instance + 8, size);
+		simdStore(instance + 12, colorBits);
+	}
+}
+
+void ParticleSystem::removeDead()
+{
+	unsigned int i = 0;
+	while (i < particleCount)
+	{
+		if (life_ptr[i] > 0.0f)
+		{
+			i++;
+			continue;
+		}
+		unsigned int last = --particleCount;
+		x_ptr[i] = x_ptr[last];
+		y_ptr[i] = y_ptr[last];
+		velocityX_ptr[i] = velocityX_ptr[last];
+		velocityY_ptr[i] = velocityY_ptr[last];
+		life_ptr[i] = life_ptr[last];
+		lifeScale_ptr[i] = lifeScale_ptr[last];
+		size_ptr[i] = size_ptr[last];
+		color_ptr[i] = color_ptr[last];
+	}
+}
+
+void ParticleSystem::update(float dt)
+{
+	if (!initialized)
+		return;
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+
+	unsigned int frame = Graphics::getInstance()->getFrameIndex();
+	if (frame != instanceRing.getFrame())
+		beginFrame(frame);
+
+	emit(dt);
+
+	//every particle alive now is drawn this frame, the ones that die on the way with no size
+	frameTime = dt;
+	frameInstances = particleCount;
+	SceUInt64 simulateStart = sceKernelGetProcessTimeWide();
+	JobSystem::getInstance()->run(&ParticleSystem::simulateJob, this, (particleCount + PARTICLE_JOB_SIZE - 1) / PARTICLE_JOB_SIZE);
+	stats.simulateTime = sceKernelGetProcessTimeWide() - simulateStart;
+
+	removeDead();
+
+	stats.particles = particleCount;
+	if (particleCount > stats.particlesPeak)
+		stats.particlesPeak = particleCount;
+	stats.updateTime = sceKernelGetProcessTimeWide() - start;
+}
+
+void ParticleSystem::draw(float width, float height)
+{
+	//nothing was written for a frame update() didn't run in
+	if (!initialized || frameInstances == 0 || instanceRing.getFrame() != Graphics::getInstance()->getFrameIndex())
+		return;
+
+	Graphics* graphics = Graphics::getInstance();
+	const GraphicsConfig* config = graphics->getConfig();
+	if (width <= 0.0f)
+		width = (float)config->displayWidth;
+	if (height <= 0.0f)
+		height = (float)config->displayHeight;
+
+	//pixels to clip space, y grows down the screen
+	float screenTransform[4] = { 2.0f / width, -2.0f / height, -1.0f, 1.0f };
+
+	graphics->patcherSetVertexProgram(vertexProgram.get());
+	graphics->patcherSetFragmentProgram(fragmentProgram.get());
+	graphics->patcherSetVertexProgramConstants(NULL, screenTransformParam_ptr, 0, 4, screenTransform);
+	graphics->patcherSetVertexStream(0, corners_ptr);
+	graphics->patcherSetVertexStream(1, region_ptr);
+	graphics->drawInstanced(SCE_GXM_PRIMITIVE_TRIANGLES, SCE_GXM_INDEX_FORMAT_U16, indices_ptr, frameInstances * 6, 6);
+}
+
+unsigned int ParticleSystem::getParticleCount()
+{
+	return particleCount;
+}
+
+const ParticleSystemStats* ParticleSystem::getStats()
+{
+	return &stats;
+}
+
+void ParticleSystem::logStats()
+{
+	vitaPrintf("\nParticle system: %u of %u particles, peak %u\n", stats.particles, maxParticles, stats.particlesPeak);
+	vitaPrintf("\tLast frame: %u emitted, %u dropped, update %.3fms of which jobs %.3fms\n", stats.emittedLastFrame,
+		stats.droppedLastFrame, stats.updateTime / 1000.0, stats.simulateTime / 1000.0);
+	vitaPrintf("\tStalls: %u\n", stats.stalls);
+}
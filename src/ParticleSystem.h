@@ -0,0 +1,145 @@
+#pragma once
+
+//----------------------------------------------
+// ParticleSystem Class
+// 2D particles from any number of emitters, kept as a structure of arrays so the update works
+// on four particles at a time with the SIMD helpers. update() emits on the render thread, then
+// splits moving and ageing the particles over the JobSystem. Each job writes its particles
+// straight into this frame's instance buffer, and draw() puts all of them on the screen with a
+// single instanced draw of one quad. Particles are blended additively, which doesn't depend on
+// the order they are drawn in, so they are never sorted. The instances go into the frame's
+// region of a FrameRing
+//-----------------------------------------------
+
+#include "Graphics.h"
+#include "FrameRing.h"
+
+//Default number of particles alive at once, anything emitted past it is dropped and counted
+#define PARTICLE_SYSTEM_MAX_PARTICLES	65536
+#define PARTICLE_SYSTEM_MAX_EMITTERS	16
+//Particles one job moves, a multiple of SIMD_WIDTH
+#define PARTICLE_JOB_SIZE				4096
+
+//What the instance stream holds for every particle
+typedef struct ParticleInstance
+{
+	float x;				//center, pixels
+	float y;
+	float size;				//diameter, pixels, 0 once the particle has died
+	unsigned int color;		//RGBA8(), alpha fades out over the particle's life
+} ParticleInstance;
+
+typedef struct ParticleEmitter
+{
+	float x;				//pixels of the screen draw() is given
+	float y;
+	float rate;				//particles a second
+	float direction;		//radians, 0 is to the right and y grows down the screen
+	float spread;			//radians either side of direction
+	float speedMin;			//pixels a second
+	float speedMax;
+	float lifetimeMin;		//seconds
+	float lifetimeMax;
+	float sizeMin;			//pixels
+	float sizeMax;
+	unsigned int color;		//RGBA8(), alpha is what it fades out from
+	bool active;
+} ParticleEmitter;
+
+typedef struct ParticleSystemStats
+{
+	unsigned int particles;				//alive after the last update()
+	unsigned int particlesPeak;
+	unsigned int emittedLastFrame;
+	unsigned int droppedLastFrame;		//emitted past maxParticles, raise it if this isn't 0
+	unsigned int stalls;				//frames that had to wait for the GPU to release their region
+	SceUInt64 updateTime;				//microseconds the last update() took
+	SceUInt64 simulateTime;				//of that, the jobs
+} ParticleSystemStats;
+
+class ParticleSystem
+{
+public:
+	ParticleSystem();
+	~ParticleSystem();
+
+	//Graphics must be initialized, maxParticles is the most alive at once (65536 at most, 16 bit instance indices)
+	void init(unsigned int maxParticles = PARTICLE_SYSTEM_MAX_PARTICLES);
+	//Hands the instance buffer and programs to Graphics' release queue, frames already submitted can still draw with them
+	void shutdown();
+	bool isInitialized();
+
+	//The index of the emitter's copy, -1 if there are PARTICLE_SYSTEM_MAX_EMITTERS already
+	int addEmitter(const ParticleEmitter* emitter);
+	//Change it freely between updates, nullptr for an index addEmitter() never returned
+	ParticleEmitter* getEmitter(int index);
+	//pixels a second squared
+	void setGravity(float x, float y);
+	//the part of its speed a particle loses every second, 0 to 1
+	void setDrag(float drag);
+	//Kills every particle
+	void clear();
+
+	//Emits, moves and ages every particle by dt seconds and writes this frame's instances. Once a frame, before draw()
+	void update(float dt);
+	//Between Graphics::startScene() and endScene(), everything update() wrote this frame. Coordinates are pixels
+	//of a width x height screen with the origin at the top left, 0 uses the display size
+	void draw(float width = 0.0f, float height = 0.0f);
+
+	unsigned int getParticleCount();
+	const ParticleSystemStats* getStats();
+	void logStats();
+
+private:
+	static void simulateJob(void* userData, unsigned int job);
+	//Moves particles first to end - 1 by frameTime and writes their instances
+	void simulate(unsigned int first, unsigned int end);
+	void emit(float dt);
+	//Moves the last particle into every dead one's place
+	void removeDead();
+	//Moves to the frame's instance region
+	void beginFrame(unsigned int frame);
+	//0 to 1
+	float random();
+
+	ParticleSystemStats stats;
+	bool initialized;
+	unsigned int maxParticles;
+	unsigned int particleCount;
+
+	//structure of arrays in one allocation, every array has room for maxParticles rounded up to SIMD_WIDTH
+	void* arrays_ptr;
+	float* x_ptr;
+	float* y_ptr;
+	float* velocityX_ptr;
+	float* velocityY_ptr;
+	float* life_ptr;				//seconds left
+	float* lifeScale_ptr;			//starting alpha / lifetime, the alpha is life * lifeScale
+	float* size_ptr;
+	uint32_t* color_ptr;			//RGBA8() without alpha
+
+	ParticleEmitter _emitters[PARTICLE_SYSTEM_MAX_EMITTERS];
+	float _emitterDebt[PARTICLE_SYSTEM_MAX_EMITTERS];		//particles owed by the fraction of a frame's rate
+	unsigned int emitterCount;
+	float gravityX;
+	float gravityY;
+	float drag;
+	uint32_t randomState;
+
+	//the frame update() is simulating, read by the jobs
+	float frameTime;
+	unsigned int frameInstances;
+
+	//quad corners and quad indices in one memblock, the instances in the ring
+	GpuBuffer memory;
+	float* corners_ptr;
+	uint16_t* indices_ptr;
+	FrameRing instanceRing;
+	ParticleInstance* region_ptr;
+
+	SceGxmShaderPatcherId vertexProgramID;
+	SceGxmShaderPatcherId fragmentProgramID;
+	GpuVertexProgram vertexProgram;
+	GpuFragmentProgram fragmentProgram;
+	const SceGxmProgramParameter* screenTransformParam_ptr;
+};
@@ -0,0 +1,357 @@
+#include "ProgramCache.h"
+#include "Graphics.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <assert.h>
+
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+
+#define PROGRAM_CACHE_STACK_SIZE	(32 * 1024)
+//Below the render thread, it only gets the time loading leaves over
+#define PROGRAM_CACHE_PRIORITY		(SCE_KERNEL_DEFAULT_PRIORITY_USER + 8)
+//How long the render thread sleeps between looks at a variant the cache's thread is patching, in microseconds
+#define PROGRAM_CACHE_STALL_POLL	100
+
+ProgramCache::ProgramCache()
+{
+	memset(_entries, 0, sizeof(_entries));
+	entryCount = 0;
+	doneCount = 0;
+	running = false;
+	threadUID = -1;
+	wakeSemaUID = -1;
+	startTime = 0;
+	prewarmed = 0;
+	patchTime = 0;
+	prewarmTime = 0;
+	memset(&stats, 0, sizeof(stats));
+}
+
+ProgramCache::~ProgramCache()
+{
+	//the thread can't be left patching entries that are about to go away
+	stopThread();
+}
+
+bool ProgramCache::add(const ProgramVariant* variants, unsigned int count)
+{
+	if (entryCount + count > PROGRAM_CACHE_MAX_VARIANTS)
+	{
+		vitaPrintf("ERROR: the program cache holds %d variants, %u more don't fit\n", PROGRAM_CACHE_MAX_VARIANTS, count);
+		return false;
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const ProgramVariant* variant = &variants[i];
+		Entry* entry = &_entries[entryCount];
+		memset(entry, 0, sizeof(Entry));
+		entry->variant = variant;
+		entry->vertexProgramID = registerProgram(variant->vertexProgram);
+		entry->fragmentProgramID = registerProgram(variant->fragmentProgram);
+
+		entry->fallback = -1;
+		if (variant->fallback != nullptr)
+		{
+			entry->fallback = findVariant(variant->fallback);
+			if (entry->fallback < 0)
+				vitaPrintf("ERROR: fallback %s of program variant %s isn't listed before it\n", variant->fallback, variant->name);
+		}
+
+		//attributes the shader doesn't use are dropped, like patcherCreateVertexProgram() does with a stream
+		assert(variant->attributeCount <= PROGRAM_CACHE_MAX_ATTRIBUTES);
+		for (unsigned int j = 0; j < variant->attributeCount; j++)
+		{
+			const SceGxmProgramParameter* attribute_ptr = sceGxmProgramFindParameterByName(variant->vertexProgram, variant->names[j]);
+			if (attribute_ptr == NULL || sceGxmProgramParameterGetCategory(attribute_ptr) != SCE_GXM_PARAMETER_CATEGORY_ATTRIBUTE)
+				continue;
+			entry->attributes[entry->attributeCount] = variant->attributes[j];
+			entry->attributes[entry->attributeCount].regIndex = sceGxmProgramParameterGetResourceIndex(attribute_ptr);
+			entry->names[entry->attributeCount] = variant->names[j];
+			entry->attributeCount++;
+		}
+		entry->state = VARIANT_QUEUED;
+
+		//the cache's thread may pick the entry up as soon as it is counted
+		__sync_synchronize();
+		entryCount++;
+	}
+
+	if (threadUID >= 0)
+		sceKernelSignalSema(wakeSemaUID, 1);
+	return true;
+}
+
+bool ProgramCache::start()
+{
+	if (threadUID >= 0)
+		return true;
+
+	startTime = sceKernelGetProcessTimeWide();
+	running = true;
+	wakeSemaUID = sceKernelCreateSema("program_cache_wake", 0, 0, PROGRAM_CACHE_MAX_VARIANTS + 1, NULL);
+	threadUID = sceKernelCreateThread("program_cache", &ProgramCache::patchingThread, PROGRAM_CACHE_PRIORITY,
+		PROGRAM_CACHE_STACK_SIZE, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+	if (wakeSemaUID < 0 || threadUID < 0)
+	{
+		vitaPrintf("ERROR: the program cache's thread couldn't be created (0x%08X, 0x%08X), variants are patched when they are asked for\n",
+			wakeSemaUID, threadUID);
+		stopThread();
+		return false;
+	}
+
+	ProgramCache* self = this;
+	int error = sceKernelStartThread(threadUID, sizeof(self), &self);
+	if (error != 0)
+	{
+		vitaPrintf("ERROR: sceKernelStartThread() of the program cache's thread result: 0x%08X\n", error);
+		sceKernelDeleteThread(threadUID);
+		threadUID = -1;
+		stopThread();
+		return false;
+	}
+	return true;
+}
+
+void ProgramCache::finish()
+{
+	//rather than only waiting, the render thread takes whatever the cache's thread hasn't got to yet
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		Entry* entry = &_entries[i];
+		if (claim(entry))
+			patch(entry);
+		while (entry->state == VARIANT_PATCHING)
+			sceKernelDelayThread(PROGRAM_CACHE_STALL_POLL);
+	}
+}
+
+bool ProgramCache::isFinished()
+{
+	return doneCount == entryCount;
+}
+
+void ProgramCache::shutdown()
+{
+	stopThread();
+
+	//variants never asked for were never handed to Graphics, their handles are made here to release them all the same.
+	//The frame being recorded may still draw with them, the release queue waits for the GPU and keeps
+	//the order, so the GXPs are unregistered after everything patched from them is gone
+	Graphics* graphics = Graphics::getInstance();
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		Entry* entry = &_entries[i];
+		if (!entry->adopted)
+		{
+			_vertexPrograms[i] = GpuVertexProgram(entry->vertexProgram);
+			_fragmentPrograms[i] = GpuFragmentProgram(entry->fragmentProgram);
+		}
+		_fragmentPrograms[i].reset();
+		_vertexPrograms[i].reset();
+	}
+	for (size_t i = 0; i < _programIDs.size(); i++)
+		graphics->deferRelease(GPU_RESOURCE_REGISTERED_PROGRAM, _programIDs[i]);
+	_programs.clear();
+	_programIDs.clear();
+
+	memset(_entries, 0, sizeof(_entries));
+	entryCount = 0;
+	doneCount = 0;
+	prewarmed = 0;
+	patchTime = 0;
+	prewarmTime = 0;
+	memset(&stats, 0, sizeof(stats));
+}
+
+int ProgramCache::findVariant(const char* name)
+{
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		if (strcmp(_entries[i].variant->name, name) == 0)
+			return (int)i;
+	}
+	return -1;
+}
+
+bool ProgramCache::isReady(int variant)
+{
+	return _entries[variant].state == VARIANT_READY;
+}
+
+bool ProgramCache::getPrograms(int variant, const SceGxmVertexProgram** vertexProgram, const SceGxmFragmentProgram** fragmentProgram)
+{
+	assert(variant >= 0 && variant < (int)entryCount);
+	Entry* entry = &_entries[variant];
+	if (entry->state != VARIANT_READY && entry->state != VARIANT_FAILED)
+	{
+		stats.hitches++;
+		Entry* fallback = (entry->fallback >= 0) ? &_entries[entry->fallback] : nullptr;
+		if (fallback != nullptr && fallback->state == VARIANT_READY)
+		{
+			stats.fallbacks++;
+			entry = fallback;
+		}
+		else
+			stall(entry);
+	}
+
+	//the state has to be read before the programs it says are there
+	__sync_synchronize();
+	if (!entry->adopted)
+		adopt(entry);
+	if (entry->state != VARIANT_READY)
+		return false;
+
+	*vertexProgram = entry->vertexProgram;
+	*fragmentProgram = entry->fragmentProgram;
+	return true;
+}
+
+const ProgramCacheStats* ProgramCache::getStats()
+{
+	stats.variants = entryCount;
+	stats.ready = 0;
+	stats.failed = 0;
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		if (_entries[i].state == VARIANT_READY)
+			stats.ready++;
+		else if (_entries[i].state == VARIANT_FAILED)
+			stats.failed++;
+	}
+	stats.prewarmed = prewarmed;
+	stats.patchTime = patchTime;
+	stats.prewarmTime = prewarmTime;
+	return &stats;
+}
+
+void ProgramCache::logStats()
+{
+	const ProgramCacheStats* cacheStats = getStats();
+	vitaPrintf("\nProgram cache: %u variants, %u ready, %u failed, %u prewarmed in %.2fms (%.2fms of it patching)\n",
+		cacheStats->variants, cacheStats->ready, cacheStats->failed, cacheStats->prewarmed,
+		cacheStats->prewarmTime / 1000.0, cacheStats->patchTime / 1000.0);
+	vitaPrintf("Hitches: %u, %u drew with their fallback, %u stalled the render thread for %.2fms (%.2fms at worst)\n",
+		cacheStats->hitches, cacheStats->fallbacks, cacheStats->stalls, cacheStats->stallTime / 1000.0, cacheStats->stallTimeMax / 1000.0);
+}
+
+bool ProgramCache::claim(Entry* entry)
+{
+	return __sync_bool_compare_and_swap(&entry->state, VARIANT_QUEUED, VARIANT_PATCHING);
+}
+
+void ProgramCache::patch(Entry* entry)
+{
+	Graphics* graphics = Graphics::getInstance();
+	const ProgramVariant* variant = entry->variant;
+	entry->error = graphics->patcherPatchVertexProgram(entry->vertexProgramID, entry->attributes, entry->attributeCount,
+		&variant->stream, &entry->vertexProgram);
+	if (entry->error == 0)
+		entry->error = graphics->patcherPatchFragmentProgram(entry->fragmentProgramID, entry->vertexProgramID, variant->blendInfo,
+			&entry->fragmentProgram);
+
+	//the programs have to be visible before the state says they are there
+	__sync_synchronize();
+	entry->state = (entry->error == 0) ? VARIANT_READY : VARIANT_FAILED;
+	__sync_fetch_and_add(&doneCount, 1);
+}
+
+void ProgramCache::stall(Entry* entry)
+{
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+	if (claim(entry))
+		patch(entry);
+	while (entry->state == VARIANT_PATCHING)
+		sceKernelDelayThread(PROGRAM_CACHE_STALL_POLL);
+	SceUInt64 stallTime = sceKernelGetProcessTimeWide() - start;
+
+	stats.stalls++;
+	stats.stallTime += stallTime;
+	if (stallTime > stats.stallTimeMax)
+		stats.stallTimeMax = stallTime;
+	vitaPrintf("Program variant %s wasn't ready when it was first drawn, the render thread stalled %.2fms for it\n",
+		entry->variant->name, stallTime / 1000.0);
+}
+
+void ProgramCache::adopt(Entry* entry)
+{
+	Graphics* graphics = Graphics::getInstance();
+	entry->adopted = true;
+	if (entry->state == VARIANT_READY)
+	{
+		graphics->patcherAdoptVertexProgram(entry->vertexProgram, entry->vertexProgramID, entry->attributes, entry->attributeCount,
+			entry->names, &entry->variant->stream);
+		graphics->patcherAdoptFragmentProgram(entry->fragmentProgram, entry->fragmentProgramID, entry->vertexProgramID,
+			entry->variant->blendInfo);
+		_vertexPrograms[entry - _entries] = GpuVertexProgram(entry->vertexProgram);
+		_fragmentPrograms[entry - _entries] = GpuFragmentProgram(entry->fragmentProgram);
+		return;
+	}
+
+	vitaPrintf("ERROR: patching program variant %s result: 0x%08X\n", entry->variant->name, entry->error);
+	//the vertex program can be patched when the fragment program can't
+	if (entry->vertexProgram != nullptr)
+		graphics->patcherReleaseVertexProgram(entry->vertexProgram);
+	entry->vertexProgram = nullptr;
+	entry->fragmentProgram = nullptr;
+}
+
+SceGxmShaderPatcherId ProgramCache::registerProgram(const SceGxmProgram* program)
+{
+	for (size_t i = 0; i < _programs.size(); i++)
+	{
+		if (_programs[i] == program)
+			return _programIDs[i];
+	}
+	_programs.push_back(program);
+	_programIDs.push_back(Graphics::getInstance()->patcherRegisterProgram(program));
+	return _programIDs.back();
+}
+
+void ProgramCache::stopThread()
+{
+	running = false;
+	if (threadUID >= 0)
+	{
+		sceKernelSignalSema(wakeSemaUID, 1);
+		sceKernelWaitThreadEnd(threadUID, NULL, NULL);
+		sceKernelDeleteThread(threadUID);
+		threadUID = -1;
+	}
+	if (wakeSemaUID >= 0)
+		sceKernelDeleteSema(wakeSemaUID);
+	wakeSemaUID = -1;
+}
+
+int ProgramCache::patchingThread(SceSize args, void* argp)
+{
+	//argp points at a copy of the pointer passed to sceKernelStartThread()
+	ProgramCache* self = *(ProgramCache**)argp;
+	unsigned int next = 0;
+	while (self->running)
+	{
+		unsigned int count = self->entryCount;
+		//entries are filled in before they are counted
+		__sync_synchronize();
+		for (; next < count && self->running; next++)
+		{
+			Entry* entry = &self->_entries[next];
+			//the render thread got to it first
+			if (!self->claim(entry))
+				continue;
+			SceUInt64 start = sceKernelGetProcessTimeWide();
+			self->patch(entry);
+			SceUInt64 end = sceKernelGetProcessTimeWide();
+			self->patchTime += end - start;
+			self->prewarmed++;
+			self->prewarmTime = end - self->startTime;
+		}
+
+		//add() signals for every list it queues, stopThread() once more
+		sceKernelWaitSema(self->wakeSemaUID, 1, NULL);
+	}
+	return 0;
+}
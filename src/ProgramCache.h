@@ -0,0 +1,144 @@
+#pragma once
+
+//----------------------------------------------
+// ProgramCache Class
+// Patches the vertex and fragment program pairs a level draws with ahead of time, on its own
+// thread while the level loads, so nothing has to be patched when an object first shows up.
+// A level lists what it needs declaratively, as ProgramVariants: the GXPs, the vertex layout
+// and the blending. add() registers the GXPs and queues the variants, start() patches them in
+// list order on the cache's thread. getPrograms() hands out a variant's programs; asking for
+// one that isn't patched yet is a hitch, it draws with its fallback if that is ready or is
+// patched there and then on the render thread. Hitches are counted and timed, see logStats().
+// The patcher itself is shared through Graphics' patcher lock, everything else is render thread only
+//-----------------------------------------------
+
+#include <vector>
+
+#include <psp2/types.h>
+#include <psp2/gxm.h>
+
+#include "GpuHandle.h"
+
+#define PROGRAM_CACHE_MAX_VARIANTS		64
+#define PROGRAM_CACHE_MAX_ATTRIBUTES	8
+
+//One program pair and the vertex layout and blending it is patched for. Lists of these are meant to be
+//static const, nothing in one is copied so it has to outlive the cache
+typedef struct ProgramVariant
+{
+	const char* name;							//what findVariant() looks for
+	const SceGxmProgram* vertexProgram;			//registered once, however many variants use it
+	const SceGxmProgram* fragmentProgram;
+	const SceGxmVertexAttribute* attributes;	//regIndex is looked up by name, attributes the shader doesn't use are dropped
+	const char* const* names;					//the shader input name of each attribute
+	unsigned int attributeCount;				//at most PROGRAM_CACHE_MAX_ATTRIBUTES
+	SceGxmVertexStream stream;
+	const SceGxmBlendInfo* blendInfo;			//nullptr writes the fragment color as is
+	const char* fallback;						//a variant with the same vertex layout to draw with until this one is ready, or nullptr
+} ProgramVariant;
+
+typedef struct ProgramCacheStats
+{
+	unsigned int variants;
+	unsigned int ready;					//patched, on either thread
+	unsigned int failed;
+	unsigned int prewarmed;				//patched on the cache's thread
+	unsigned int hitches;				//getPrograms() calls for a variant that wasn't ready
+	unsigned int fallbacks;				//of those, the ones that drew with the fallback
+	unsigned int stalls;				//of those, the ones the render thread patched or waited for
+	SceUInt64 stallTime;				//microseconds the render thread lost to stalls
+	SceUInt64 stallTimeMax;
+	SceUInt64 patchTime;				//microseconds the cache's thread spent patching
+	SceUInt64 prewarmTime;				//from start() until the cache's thread last caught up with the queue
+} ProgramCacheStats;
+
+class ProgramCache
+{
+public:
+	ProgramCache();
+	~ProgramCache();
+
+	//Registers the GXPs and queues the variants for patching, false if there isn't room for all of them.
+	//A fallback has to be listed, or added, before the variants that use it. Can be called any time,
+	//variants added after start() are picked up straight away
+	bool add(const ProgramVariant* variants, unsigned int count);
+	//Starts the cache's thread, it patches whatever is queued until shutdown(). False if it couldn't be
+	//started, variants are then patched when they are first asked for
+	bool start();
+	//Patches everything still queued on the render thread as well, returns once all of it is done. For loading screens
+	void finish();
+	bool isFinished();
+	//Stops the thread, queues every program and then the GXPs for release. Fine while the GPU still draws with them
+	void shutdown();
+
+	//The index of the variant called name, -1 if there is none. Look it up once, not every frame
+	int findVariant(const char* name);
+	bool isReady(int variant);
+	//The programs to draw the variant with, false if it (and its fallback) couldn't be patched
+	bool getPrograms(int variant, const SceGxmVertexProgram** vertexProgram, const SceGxmFragmentProgram** fragmentProgram);
+
+	const ProgramCacheStats* getStats();
+	void logStats();
+
+private:
+	typedef enum VariantState
+	{
+		VARIANT_QUEUED = 0,
+		VARIANT_PATCHING,
+		VARIANT_READY,
+		VARIANT_FAILED
+	} VariantState;
+
+	typedef struct Entry
+	{
+		const ProgramVariant* variant;
+		SceGxmShaderPatcherId vertexProgramID;
+		SceGxmShaderPatcherId fragmentProgramID;
+		//the attributes the shader uses, with their regIndex filled in
+		SceGxmVertexAttribute attributes[PROGRAM_CACHE_MAX_ATTRIBUTES];
+		const char* names[PROGRAM_CACHE_MAX_ATTRIBUTES];
+		unsigned int attributeCount;
+		int fallback;
+		//written by whichever thread claimed the variant, read once state says it is done
+		SceGxmVertexProgram* vertexProgram;
+		SceGxmFragmentProgram* fragmentProgram;
+		int error;
+		volatile int state;
+		//render thread only, the programs have been handed to Graphics
+		bool adopted;
+	} Entry;
+
+	static int patchingThread(SceSize args, void* argp);
+	//QUEUED to PATCHING, false if the other thread got there first
+	bool claim(Entry* entry);
+	//Patches a variant this thread claimed, either thread
+	void patch(Entry* entry);
+	//Render thread: patches the variant, or waits for the cache's thread to, and counts it as a stall
+	void stall(Entry* entry);
+	//Render thread: hands a finished variant's programs to Graphics and its handles, logs it if it failed
+	void adopt(Entry* entry);
+	SceGxmShaderPatcherId registerProgram(const SceGxmProgram* program);
+	void stopThread();
+
+	/* Shared between the threads */
+	Entry _entries[PROGRAM_CACHE_MAX_VARIANTS];
+	//entries are filled in before they are counted here
+	volatile unsigned int entryCount;
+	volatile unsigned int doneCount;
+	volatile bool running;
+	SceUID threadUID;
+	SceUID wakeSemaUID;
+	SceUInt64 startTime;
+	//counted by the cache's thread, only ever read by the render thread
+	volatile unsigned int prewarmed;
+	volatile SceUInt64 patchTime;
+	volatile SceUInt64 prewarmTime;
+
+	/* Render thread only */
+	ProgramCacheStats stats;
+	//own each entry's programs once the render thread has taken them on, indexed like _entries
+	GpuVertexProgram _vertexPrograms[PROGRAM_CACHE_MAX_VARIANTS];
+	GpuFragmentProgram _fragmentPrograms[PROGRAM_CACHE_MAX_VARIANTS];
+	std::vector<const SceGxmProgram*> _programs;
+	std::vector<SceGxmShaderPatcherId> _programIDs;
+};
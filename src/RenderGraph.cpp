@@ -0,0 +1,534 @@
+#include "RenderGraph.h"
+#include "Graphics.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <assert.h>
+#include <algorithm>
+
+//The back buffer is always the first resource
+#define BACK_BUFFER_RESOURCE	0
+
+RenderGraph::RenderGraph()
+{
+	compiled = false;
+	memory_ptr = nullptr;
+	reset();
+}
+
+RenderGraph::~RenderGraph()
+{
+
+}
+
+void RenderGraph::reset()
+{
+	release();
+	_passes.clear();
+	_resources.clear();
+	memset(&stats, 0, sizeof(stats));
+
+	Resource backBuffer;
+	memset(&backBuffer, 0, sizeof(backBuffer));
+	backBuffer.name = "back_buffer";
+	backBuffer.type = RESOURCE_BACK_BUFFER;
+	backBuffer.firstPass = -1;
+	backBuffer.lastPass = -1;
+	_resources.push_back(backBuffer);
+}
+
+void RenderGraph::release()
+{
+	//frames already submitted may still be rendering into them, the handles queue them rather than waiting for the GPU
+	_targets.clear();
+	memory.reset();
+	memory_ptr = nullptr;
+	compiled = false;
+}
+
+/*----- Building -----*/
+
+RenderResource RenderGraph::getBackBuffer()
+{
+	return BACK_BUFFER_RESOURCE;
+}
+
+RenderResource RenderGraph::createColorTarget(const char* name, unsigned int width, unsigned int height)
+{
+	Resource resource;
+	memset(&resource, 0, sizeof(resource));
+	resource.name = name;
+	resource.type = RESOURCE_COLOR;
+	resource.width = width;
+	resource.height = height;
+	//linear textures have a stride of the width rounded up to 8 texels, the surface uses the same one
+	resource.size = 4 * ALIGN_MEM(width, 8) * height;
+	_resources.push_back(resource);
+	compiled = false;
+	return _resources.size() - 1;
+}
+
+RenderResource RenderGraph::createDepthTarget(const char* name, unsigned int width, unsigned int height)
+{
+	Resource resource;
+	memset(&resource, 0, sizeof(resource));
+	resource.name = name;
+	resource.type = RESOURCE_DEPTH;
+	resource.width = width;
+	resource.height = height;
+	//tiled D24S8, whole tiles. Memory is needed even when it is never loaded or stored, for partial renders
+	resource.size = 4 * ALIGN_MEM(width, SCE_GXM_TILE_SIZEX) * ALIGN_MEM(height, SCE_GXM_TILE_SIZEY);
+	_resources.push_back(resource);
+	compiled = false;
+	return _resources.size() - 1;
+}
+
+RenderPass RenderGraph::addPass(const char* name, RenderPassCallback callback, void* userData)
+{
+	Pass pass;
+	pass.name = name;
+	pass.callback = callback;
+	pass.userData = userData;
+	pass.color = RENDER_RESOURCE_INVALID;
+	pass.depth = RENDER_RESOURCE_INVALID;
+	pass.keepDepth = false;
+	pass.kept = false;
+	pass.live = false;
+	pass.renderTarget = -1;
+	memset(&pass.depthSurface, 0, sizeof(pass.depthSurface));
+	_passes.push_back(pass);
+	compiled = false;
+	return _passes.size() - 1;
+}
+
+void RenderGraph::writeColor(RenderPass pass, RenderResource resource)
+{
+	assert(validPass(pass) && validResource(resource));
+	_passes[pass].color = resource;
+	compiled = false;
+}
+
+void RenderGraph::writeDepth(RenderPass pass, RenderResource resource, bool keepContents)
+{
+	assert(validPass(pass) && validResource(resource));
+	_passes[pass].depth = resource;
+	_passes[pass].keepDepth = keepContents;
+	compiled = false;
+}
+
+void RenderGraph::readTexture(RenderPass pass, RenderResource resource)
+{
+	assert(validPass(pass) && validResource(resource));
+	_passes[pass]._reads.push_back(resource);
+	compiled = false;
+}
+
+void RenderGraph::keep(RenderPass pass)
+{
+	assert(validPass(pass));
+	_passes[pass].kept = true;
+	compiled = false;
+}
+
+bool RenderGraph::validPass(RenderPass pass)
+{
+	return pass >= 0 && pass < (int)_passes.size();
+}
+
+bool RenderGraph::validResource(RenderResource resource)
+{
+	return resource >= 0 && resource < (int)_resources.size();
+}
+
+/*----- Compiling -----*/
+
+bool RenderGraph::compile()
+{
+	vitaPrintf("\nCompiling the render graph, %u passes and %u resources\n", (unsigned int)_passes.size(), (unsigned int)_resources.size());
+	release();
+	memset(&stats, 0, sizeof(stats));
+	stats.passes = _passes.size();
+
+	//check each pass on its own
+	for (unsigned int i = 0; i < _passes.size(); i++)
+	{
+		Pass* pass = &_passes[i];
+		if (pass->color == RENDER_RESOURCE_INVALID && pass->depth == RENDER_RESOURCE_INVALID)
+		{
+			vitaPrintf("ERROR: pass %s doesn't render into anything\n", pass->name);
+			return false;
+		}
+		if (pass->color != RENDER_RESOURCE_INVALID && _resources[pass->color].type == RESOURCE_DEPTH)
+		{
+			vitaPrintf("ERROR: pass %s writes depth target %s as color\n", pass->name, _resources[pass->color].name);
+			return false;
+		}
+		if (pass->depth != RENDER_RESOURCE_INVALID && _resources[pass->depth].type != RESOURCE_DEPTH)
+		{
+			vitaPrintf("ERROR: pass %s uses %s as depth\n", pass->name, _resources[pass->depth].name);
+			return false;
+		}
+		if (pass->color == BACK_BUFFER_RESOURCE && pass->depth != RENDER_RESOURCE_INVALID)
+		{
+			vitaPrintf("ERROR: pass %s renders to the back buffer, it uses the display's depth buffer\n", pass->name);
+			return false;
+		}
+		if (pass->color != RENDER_RESOURCE_INVALID && pass->color != BACK_BUFFER_RESOURCE && pass->depth != RENDER_RESOURCE_INVALID &&
+			(_resources[pass->color].width != _resources[pass->depth].width || _resources[pass->color].height != _resources[pass->depth].height))
+		{
+			vitaPrintf("ERROR: pass %s has color and depth targets of different sizes\n", pass->name);
+			return false;
+		}
+		for (unsigned int r = 0; r < pass->_reads.size(); r++)
+		{
+			RenderResource read = pass->_reads[r];
+			if (_resources[read].type != RESOURCE_COLOR || read == pass->color)
+			{
+				vitaPrintf("ERROR: pass %s can't sample %s\n", pass->name, _resources[read].name);
+				return false;
+			}
+		}
+	}
+
+	//cull from the back, a pass lives if it is kept, draws to the screen or writes something a live pass after it reads
+	std::vector<bool> needed(_resources.size(), false);
+	for (int i = _passes.size() - 1; i >= 0; i--)
+	{
+		Pass* pass = &_passes[i];
+		pass->live = pass->kept || pass->color == BACK_BUFFER_RESOURCE ||
+			(pass->color != RENDER_RESOURCE_INVALID && needed[pass->color]) ||
+			(pass->depth != RENDER_RESOURCE_INVALID && needed[pass->depth]);
+		if (!pass->live)
+		{
+			vitaPrintf("Culled pass %s, nothing uses what it renders\n", pass->name);
+			stats.culledPasses++;
+			continue;
+		}
+
+		//color is never loaded so anything before this pass wrote is gone, depth only when it isn't kept
+		if (pass->color != RENDER_RESOURCE_INVALID)
+			needed[pass->color] = false;
+		if (pass->depth != RENDER_RESOURCE_INVALID)
+			needed[pass->depth] = pass->keepDepth;
+		for (unsigned int r = 0; r < pass->_reads.size(); r++)
+			needed[pass->_reads[r]] = true;
+	}
+
+	//every read needs a live writer before it, and only the last live pass may draw to the screen
+	std::vector<bool> written(_resources.size(), false);
+	int lastLive = -1;
+	int backBufferPass = -1;
+	for (unsigned int i = 0; i < _passes.size(); i++)
+	{
+		Pass* pass = &_passes[i];
+		if (!pass->live)
+			continue;
+		for (unsigned int r = 0; r < pass->_reads.size(); r++)
+		{
+			if (!written[pass->_reads[r]])
+			{
+				vitaPrintf("ERROR: pass %s reads %s before any pass writes it\n", pass->name, _resources[pass->_reads[r]].name);
+				return false;
+			}
+		}
+		if (pass->color == BACK_BUFFER_RESOURCE)
+		{
+			if (backBufferPass != -1)
+			{
+				vitaPrintf("ERROR: passes %s and %s both render to the back buffer\n", _passes[backBufferPass].name, pass->name);
+				return false;
+			}
+			backBufferPass = i;
+		}
+		if (pass->color != RENDER_RESOURCE_INVALID)
+			written[pass->color] = true;
+		if (pass->depth != RENDER_RESOURCE_INVALID)
+			written[pass->depth] = true;
+		lastLive = i;
+	}
+	if (backBufferPass != -1 && backBufferPass != lastLive)
+	{
+		vitaPrintf("ERROR: pass %s renders to the back buffer but isn't the last pass\n", _passes[backBufferPass].name);
+		return false;
+	}
+
+	//lifetimes, from the first live pass to touch a resource to the last
+	for (unsigned int r = 0; r < _resources.size(); r++)
+	{
+		_resources[r].firstPass = -1;
+		_resources[r].lastPass = -1;
+	}
+	for (unsigned int i = 0; i < _passes.size(); i++)
+	{
+		Pass* pass = &_passes[i];
+		if (!pass->live)
+			continue;
+		std::vector<RenderResource> used = pass->_reads;
+		used.push_back(pass->color);
+		used.push_back(pass->depth);
+		for (unsigned int u = 0; u < used.size(); u++)
+		{
+			if (used[u] == RENDER_RESOURCE_INVALID)
+				continue;
+			Resource* resource = &_resources[used[u]];
+			if (resource->firstPass == -1)
+				resource->firstPass = i;
+			resource->lastPass = i;
+		}
+	}
+
+	//one render target per size, for as many scenes as passes of that size
+	for (unsigned int i = 0; i < _passes.size(); i++)
+	{
+		Pass* pass = &_passes[i];
+		if (!pass->live)
+			continue;
+		stats.scenesPerFrame++;
+		if (pass->color == BACK_BUFFER_RESOURCE)
+			continue;
+
+		const Resource* target = &_resources[(pass->color != RENDER_RESOURCE_INVALID) ? pass->color : pass->depth];
+		pass->renderTarget = -1;
+		for (unsigned int t = 0; t < _targets.size() && pass->renderTarget == -1; t++)
+		{
+			if (_targets[t].width == target->width && _targets[t].height == target->height)
+				pass->renderTarget = t;
+		}
+		if (pass->renderTarget == -1)
+		{
+			Target newTarget;
+			newTarget.width = target->width;
+			newTarget.height = target->height;
+			newTarget.scenes = 0;
+			_targets.push_back(std::move(newTarget));
+			pass->renderTarget = _targets.size() - 1;
+		}
+		_targets[pass->renderTarget].scenes++;
+	}
+	for (unsigned int t = 0; t < _targets.size(); t++)
+	{
+		if (_targets[t].scenes > SCE_GXM_MAX_SCENES_PER_RENDERTARGET)
+		{
+			vitaPrintf("ERROR: %u passes render at %ux%u, a render target takes at most %u scenes a frame\n",
+				_targets[t].scenes, _targets[t].width, _targets[t].height, SCE_GXM_MAX_SCENES_PER_RENDERTARGET);
+			_targets.clear();
+			return false;
+		}
+	}
+	for (unsigned int t = 0; t < _targets.size(); t++)
+	{
+		_targets[t].renderTarget = Graphics::getInstance()->createRenderTarget(_targets[t].width, _targets[t].height,
+			_targets[t].scenes, SCE_GXM_MULTISAMPLE_NONE, "render_graph_target");
+	}
+	stats.renderTargets = _targets.size();
+
+	//memory for every live transient target, sharing it where lifetimes allow
+	SceSize memorySize = placeResources();
+	if (memorySize > 0)
+	{
+		SceUID memoryUID = -1;
+		memory_ptr = Graphics::getInstance()->allocGraphicsMem(
+			SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW,
+			memorySize,
+			RENDER_GRAPH_ALIGNMENT,
+			SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
+			&memoryUID,
+			"render_graph",
+			MEMORY_CATEGORY_DISPLAY
+		);
+		memory = GpuBuffer(memory_ptr, memoryUID);
+	}
+
+	for (unsigned int r = 0; r < _resources.size(); r++)
+	{
+		Resource* resource = &_resources[r];
+		if (resource->type != RESOURCE_COLOR || resource->firstPass == -1)
+			continue;
+		void* data = (uint8_t*)memory_ptr + resource->offset;
+		sceGxmColorSurfaceInit(&resource->colorSurface, SCE_GXM_COLOR_FORMAT_A8B8G8R8, SCE_GXM_COLOR_SURFACE_LINEAR,
+			SCE_GXM_COLOR_SURFACE_SCALE_NONE, SCE_GXM_OUTPUT_REGISTER_SIZE_32BIT, resource->width, resource->height,
+			ALIGN_MEM(resource->width, 8), data);
+		sceGxmTextureInitLinear(&resource->texture, data, SCE_GXM_TEXTURE_FORMAT_A8B8G8R8, resource->width, resource->height, 0);
+		sceGxmTextureSetMinFilter(&resource->texture, SCE_GXM_TEXTURE_FILTER_LINEAR);
+		sceGxmTextureSetMagFilter(&resource->texture, SCE_GXM_TEXTURE_FILTER_LINEAR);
+		sceGxmTextureSetUAddrMode(&resource->texture, SCE_GXM_TEXTURE_ADDR_CLAMP);
+		sceGxmTextureSetVAddrMode(&resource->texture, SCE_GXM_TEXTURE_ADDR_CLAMP);
+	}
+
+	//depth surfaces are per pass, each with its own load and store
+	for (unsigned int i = 0; i < _passes.size(); i++)
+	{
+		Pass* pass = &_passes[i];
+		if (!pass->live || pass->depth == RENDER_RESOURCE_INVALID)
+			continue;
+		const Resource* resource = &_resources[pass->depth];
+
+		//loaded if it keeps what a live pass before it wrote, stored if the next live pass using it keeps it
+		bool load = pass->keepDepth && resource->firstPass < (int)i;
+		bool store = false;
+		for (unsigned int j = i + 1; j < _passes.size(); j++)
+		{
+			if (_passes[j].live && _passes[j].depth == pass->depth)
+			{
+				store = _passes[j].keepDepth;
+				break;
+			}
+		}
+
+		sceGxmDepthStencilSurfaceInit(&pass->depthSurface, SCE_GXM_DEPTH_STENCIL_FORMAT_S8D24, SCE_GXM_DEPTH_STENCIL_SURFACE_TILED,
+			ALIGN_MEM(resource->width, SCE_GXM_TILE_SIZEX), (uint8_t*)memory_ptr + resource->offset, NULL);
+		sceGxmDepthStencilSurfaceSetBackgroundDepth(&pass->depthSurface, 1.0f);
+		sceGxmDepthStencilSurfaceSetForceLoadMode(&pass->depthSurface,
+			load ? SCE_GXM_DEPTH_STENCIL_FORCE_LOAD_ENABLED : SCE_GXM_DEPTH_STENCIL_FORCE_LOAD_DISABLED);
+		sceGxmDepthStencilSurfaceSetForceStoreMode(&pass->depthSurface,
+			store ? SCE_GXM_DEPTH_STENCIL_FORCE_STORE_ENABLED : SCE_GXM_DEPTH_STENCIL_FORCE_STORE_DISABLED);
+		if (load)
+			stats.depthLoads++;
+		if (store)
+			stats.depthStores++;
+	}
+
+	compiled = true;
+	logStats();
+	return true;
+}
+
+SceSize RenderGraph::placeResources()
+{
+	//biggest first, each at the lowest offset clear of everything placed that is alive at the same time
+	std::vector<RenderResource> order;
+	for (unsigned int r = 0; r < _resources.size(); r++)
+	{
+		if (_resources[r].type != RESOURCE_BACK_BUFFER && _resources[r].firstPass != -1)
+			order.push_back(r);
+	}
+	for (unsigned int a = 0; a < order.size(); a++)
+	{
+		for (unsigned int b = a + 1; b < order.size(); b++)
+		{
+			if (_resources[order[b]].size > _resources[order[a]].size)
+				std::swap(order[a], order[b]);
+		}
+	}
+
+	SceSize end = 0;
+	std::vector<RenderResource> placed;
+	for (unsigned int o = 0; o < order.size(); o++)
+	{
+		Resource* resource = &_resources[order[o]];
+		SceSize size = ALIGN_MEM(resource->size, RENDER_GRAPH_ALIGNMENT);
+		stats.transientTargets++;
+		stats.transientBytes += size;
+
+		//the candidates are the start of memory and the end of each placed resource, try them lowest first
+		std::vector<SceSize> candidates(1, 0);
+		for (unsigned int p = 0; p < placed.size(); p++)
+			candidates.push_back(_resources[placed[p]].offset + ALIGN_MEM(_resources[placed[p]].size, RENDER_GRAPH_ALIGNMENT));
+		std::sort(candidates.begin(), candidates.end());
+
+		for (unsigned int c = 0; c < candidates.size(); c++)
+		{
+			bool fits = true;
+			for (unsigned int p = 0; p < placed.size() && fits; p++)
+			{
+				const Resource* other = &_resources[placed[p]];
+				bool overlapInTime = resource->firstPass <= other->lastPass && other->firstPass <= resource->lastPass;
+				bool overlapInMemory = candidates[c] < other->offset + ALIGN_MEM(other->size, RENDER_GRAPH_ALIGNMENT) &&
+					other->offset < candidates[c] + size;
+				fits = !(overlapInTime && overlapInMemory);
+			}
+			if (fits)
+			{
+				resource->offset = candidates[c];
+				break;
+			}
+		}
+		placed.push_back(order[o]);
+		if (resource->offset + size > end)
+			end = resource->offset + size;
+	}
+
+	stats.aliasedBytes = end;
+	return end;
+}
+
+bool RenderGraph::isCompiled()
+{
+	return compiled;
+}
+
+/*----- Rendering -----*/
+
+void RenderGraph::execute()
+{
+	assert(compiled);
+	Graphics* graphics = Graphics::getInstance();
+
+	for (unsigned int i = 0; i < _passes.size(); i++)
+	{
+		Pass* pass = &_passes[i];
+		if (!pass->live)
+			continue;
+
+		if (pass->color == BACK_BUFFER_RESOURCE)
+		{
+			graphics->startScene();
+			pass->callback(pass->userData);
+			graphics->endScene();
+			continue;
+		}
+
+		const Target* target = &_targets[pass->renderTarget];
+		graphics->beginOffscreenScene(
+			target->renderTarget.get(),
+			(pass->color != RENDER_RESOURCE_INVALID) ? &_resources[pass->color].colorSurface : NULL,
+			(pass->depth != RENDER_RESOURCE_INVALID) ? &pass->depthSurface : NULL,
+			target->width,
+			target->height
+		);
+		pass->callback(pass->userData);
+		graphics->endOffscreenScene();
+	}
+}
+
+const SceGxmTexture* RenderGraph::getTexture(RenderResource resource)
+{
+	if (!compiled || !validResource(resource) || _resources[resource].type != RESOURCE_COLOR || _resources[resource].firstPass == -1)
+		return nullptr;
+	return &_resources[resource].texture;
+}
+
+unsigned int RenderGraph::getWidth(RenderResource resource)
+{
+	if (resource == BACK_BUFFER_RESOURCE)
+		return Graphics::getInstance()->getConfig()->displayWidth;
+	return validResource(resource) ? _resources[resource].width : 0;
+}
+
+unsigned int RenderGraph::getHeight(RenderResource resource)
+{
+	if (resource == BACK_BUFFER_RESOURCE)
+		return Graphics::getInstance()->getConfig()->displayHeight;
+	return validResource(resource) ? _resources[resource].height : 0;
+}
+
+const RenderGraphStats* RenderGraph::getStats()
+{
+	return &stats;
+}
+
+void RenderGraph::logStats()
+{
+	vitaPrintf("Render graph: %u of %u passes left after culling, %u render targets\n",
+		stats.scenesPerFrame, stats.passes, stats.renderTargets);
+	vitaPrintf("\t%u transient targets need %u bytes, %u when aliased\n", stats.transientTargets, stats.transientBytes, stats.aliasedBytes);
+	vitaPrintf("\t%u depth loads, %u depth stores\n", stats.depthLoads, stats.depthStores);
+	for (unsigned int r = 0; r < _resources.size(); r++)
+	{
+		const Resource* resource = &_resources[r];
+		if (resource->type == RESOURCE_BACK_BUFFER || resource->firstPass == -1)
+			continue;
+		vitaPrintf("\t%-20s %4ux%-4u at %8u, passes %d to %d\n", resource->name, resource->width, resource->height,
+			resource->offset, resource->firstPass, resource->lastPass);
+	}
+}
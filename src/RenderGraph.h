@@ -0,0 +1,156 @@
+#pragma once
+
+//----------------------------------------------
+// RenderGraph Class
+// A frame as a list of passes, each one a gxm scene. Passes declare the color and depth
+// targets they render into and the color targets they sample, compile() then works out
+// everything that follows from that once, up front:
+//  - passes whose output nothing uses are culled (keep() pins one that has side effects)
+//  - transient targets live from the first pass that uses them to the last, targets whose
+//    lifetimes don't overlap share the same CDRAM, so a chain of effects needs the memory of
+//    its widest point rather than of every target
+//  - depth is only loaded when a pass asked to keep what an earlier pass left in it and
+//    only stored when a later pass will load it, otherwise it never leaves the chip
+//  - one render target per size, sized for the number of scenes a frame uses it
+// execute() then runs the passes that are left in the order they were added. The pass that
+// writes the back buffer goes through Graphics::startScene()/endScene() like any other frame,
+// so it has to be the last one; swapBuffers() is still up to the caller.
+// Scenes are fragment processed in submission order, so a target can reuse another's memory
+// as soon as the pass that last read it has been submitted, in this frame or the next
+//-----------------------------------------------
+
+#include <vector>
+
+#include <psp2/gxm.h>
+
+#include "GpuHandle.h"
+
+typedef int RenderResource;
+typedef int RenderPass;
+#define RENDER_RESOURCE_INVALID		-1
+#define RENDER_PASS_INVALID			-1
+
+//Draws a pass, called between the begin and end of its scene
+typedef void (*RenderPassCallback)(void* userData);
+
+//Transient targets are placed at multiples of this in the graph's memory
+#define RENDER_GRAPH_ALIGNMENT		4096
+
+typedef struct RenderGraphStats
+{
+	unsigned int passes;				//added
+	unsigned int culledPasses;
+	unsigned int scenesPerFrame;		//passes left after culling
+	unsigned int transientTargets;		//used by the passes that are left
+	unsigned int renderTargets;			//one per size of offscreen pass
+	SceSize transientBytes;				//all transient targets laid end to end
+	SceSize aliasedBytes;				//what they take sharing memory, before the memblock's 256kB rounding
+	unsigned int depthLoads;			//passes that load depth
+	unsigned int depthStores;			//passes that store depth
+} RenderGraphStats;
+
+class RenderGraph
+{
+public:
+	RenderGraph();
+	~RenderGraph();
+
+	/*----- Building -----*/
+	//Forgets every pass and resource and hands what compile() allocated to Graphics' release queue.
+	//Call it before Graphics shuts down
+	void reset();
+	//The display buffer being rendered this frame, its pass renders with Graphics' own depth buffer
+	RenderResource getBackBuffer();
+	//Transient targets, only valid during the frame. Color is 32 bit RGBA that can be sampled, depth is D24S8
+	RenderResource createColorTarget(const char* name, unsigned int width, unsigned int height);
+	RenderResource createDepthTarget(const char* name, unsigned int width, unsigned int height);
+
+	RenderPass addPass(const char* name, RenderPassCallback callback, void* userData);
+	//What a pass renders into, at most one color and one depth target, both the same size
+	void writeColor(RenderPass pass, RenderResource resource);
+	//keepContents loads what an earlier pass left in the depth target, otherwise it starts cleared to 1.0
+	void writeDepth(RenderPass pass, RenderResource resource, bool keepContents = false);
+	//A color target the pass samples, an earlier pass must write it
+	void readTexture(RenderPass pass, RenderResource resource);
+	//Never culled, for passes with effects the graph can't see
+	void keep(RenderPass pass);
+
+	//Culls, schedules and allocates. Returns false, logging why, if the graph can't be run
+	bool compile();
+	bool isCompiled();
+
+	/*----- Rendering -----*/
+	//Renders every pass left after culling, the caller swaps buffers afterwards
+	void execute();
+	//For pass callbacks binding a target they read, nullptr for the back buffer or before compile()
+	const SceGxmTexture* getTexture(RenderResource resource);
+	unsigned int getWidth(RenderResource resource);
+	unsigned int getHeight(RenderResource resource);
+
+	const RenderGraphStats* getStats();
+	void logStats();
+
+private:
+	typedef enum ResourceType
+	{
+		RESOURCE_BACK_BUFFER = 0,
+		RESOURCE_COLOR,
+		RESOURCE_DEPTH
+	} ResourceType;
+
+	typedef struct Resource
+	{
+		const char* name;
+		ResourceType type;
+		unsigned int width;
+		unsigned int height;
+		SceSize size;				//bytes of CDRAM it needs
+		//set by compile()
+		int firstPass;				//lifetime, in pass indices, -1 when no live pass uses it
+		int lastPass;
+		SceSize offset;				//in the graph's memory
+		SceGxmColorSurface colorSurface;
+		SceGxmTexture texture;
+	} Resource;
+
+	typedef struct Pass
+	{
+		const char* name;
+		RenderPassCallback callback;
+		void* userData;
+		RenderResource color;
+		RenderResource depth;
+		bool keepDepth;
+		bool kept;
+		std::vector<RenderResource> _reads;
+		//set by compile()
+		bool live;
+		int renderTarget;			//index into _targets, -1 for the back buffer pass
+		SceGxmDepthStencilSurface depthSurface;	//with this pass' load and store modes
+	} Pass;
+
+	typedef struct Target
+	{
+		unsigned int width;
+		unsigned int height;
+		unsigned int scenes;
+		GpuRenderTarget renderTarget;
+	} Target;
+
+	bool validPass(RenderPass pass);
+	bool validResource(RenderResource resource);
+	//Queues the memory and render targets compile() made for release
+	void release();
+	//Gives each live transient resource an offset, returns the bytes needed
+	SceSize placeResources();
+
+	bool compiled;
+	RenderGraphStats stats;
+	std::vector<Resource> _resources;
+	std::vector<Pass> _passes;
+	std::vector<Target> _targets;
+
+	//every transient target, aliased
+	GpuBuffer memory;
+	void* memory_ptr;
+};
@@ -0,0 +1,315 @@
+#pragma once
+
+//----------------------------------------------
+// SIMD helpers
+// Four lanes of floats or 32 bit integers at a time: NEON on the Vita, GCC vector extensions
+// anywhere else (SSE on the host build). Meant for structure of arrays data, lane i of every
+// vector belongs to the same element. Loads and stores don't have to be aligned.
+// NEON flushes denormals and its reciprocal estimates are refined once, results can differ
+// from the host in the last bits
+//-----------------------------------------------
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SIMD_NEON
+#include <arm_neon.h>
+typedef float32x4_t SimdFloat4;
+typedef uint32x4_t SimdUint4;
+#else
+#include <math.h>
+typedef float SimdFloat4 __attribute__((vector_size(16)));
+typedef uint32_t SimdUint4 __attribute__((vector_size(16)));
+typedef int32_t SimdInt4 __attribute__((vector_size(16)));
+#endif
+
+#define SIMD_WIDTH	4
+
+/*----- Loads and stores -----*/
+
+static inline SimdFloat4 simdLoad(const float* source)
+{
+#ifdef SIMD_NEON
+	return vld1q_f32(source);
+#else
+	SimdFloat4 value;
+	memcpy(&value, source, sizeof(value));
+	return value;
+#endif
+}
+
+static inline void simdStore(float* destination, SimdFloat4 value)
+{
+#ifdef SIMD_NEON
+	vst1q_f32(destination, value);
+#else
+	memcpy(destination, &value, sizeof(value));
+#endif
+}
+
+static inline SimdUint4 simdLoadUint(const uint32_t* source)
+{
+#ifdef SIMD_NEON
+	return vld1q_u32(source);
+#else
+	SimdUint4 value;
+	memcpy(&value, source, sizeof(value));
+	return value;
+#endif
+}
+
+static inline void simdStoreUint(uint32_t* destination, SimdUint4 value)
+{
+#ifdef SIMD_NEON
+	vst1q_u32(destination, value);
+#else
+	memcpy(destination, &value, sizeof(value));
+#endif
+}
+
+//Four 16 bit integers widened to floats, the caller scales them
+static inline SimdFloat4 simdLoadInt16(const int16_t* source)
+{
+#ifdef SIMD_NEON
+	return vcvtq_f32_s32(vmovl_s16(vld1_s16(source)));
+#else
+	int16_t values[SIMD_WIDTH];
+	memcpy(values, source, sizeof(values));
+	SimdFloat4 result = { (float)values[0], (float)values[1], (float)values[2], (float)values[3] };
+	return result;
+#endif
+}
+
+static inline SimdFloat4 simdLoadUint16(const uint16_t* source)
+{
+#ifdef SIMD_NEON
+	return vcvtq_f32_u32(vmovl_u16(vld1_u16(source)));
+#else
+	uint16_t values[SIMD_WIDTH];
+	memcpy(values, source, sizeof(values));
+	SimdFloat4 result = { (float)values[0], (float)values[1], (float)values[2], (float)values[3] };
+	return result;
+#endif
+}
+
+static inline SimdFloat4 simdSplat(float value)
+{
+#ifdef SIMD_NEON
+	return vdupq_n_f32(value);
+#else
+	SimdFloat4 result = { value, value, value, value };
+	return result;
+#endif
+}
+
+static inline SimdUint4 simdSplatUint(uint32_t value)
+{
+#ifdef SIMD_NEON
+	return vdupq_n_u32(value);
+#else
+	SimdUint4 result = { value, value, value, value };
+	return result;
+#endif
+}
+
+/*----- Arithmetic -----*/
+
+static inline SimdFloat4 simdAdd(SimdFloat4 a, SimdFloat4 b)
+{
+#ifdef SIMD_NEON
+	return vaddq_f32(a, b);
+#else
+	return a + b;
+#endif
+}
+
+static inline SimdFloat4 simdSub(SimdFloat4 a, SimdFloat4 b)
+{
+#ifdef SIMD_NEON
+	return vsubq_f32(a, b);
+#else
+	return a - b;
+#endif
+}
+
+static inline SimdFloat4 simdMul(SimdFloat4 a, SimdFloat4 b)
+{
+#ifdef SIMD_NEON
+	return vmulq_f32(a, b);
+#else
+	return a * b;
+#endif
+}
+
+//a + b * c
+static inline SimdFloat4 simdMulAdd(SimdFloat4 a, SimdFloat4 b, SimdFloat4 c)
+{
+#ifdef SIMD_NEON
+	return vmlaq_f32(a, b, c);
+#else
+	return a + b * c;
+#endif
+}
+
+//a - b * c
+static inline SimdFloat4 simdMulSub(SimdFloat4 a, SimdFloat4 b, SimdFloat4 c)
+{
+#ifdef SIMD_NEON
+	return vmlsq_f32(a, b, c);
+#else
+	return a - b * c;
+#endif
+}
+
+static inline SimdFloat4 simdMin(SimdFloat4 a, SimdFloat4 b)
+{
+#ifdef SIMD_NEON
+	return vminq_f32(a, b);
+#else
+	return (a < b) ? a : b;
+#endif
+}
+
+static inline SimdFloat4 simdMax(SimdFloat4 a, SimdFloat4 b)
+{
+#ifdef SIMD_NEON
+	return vmaxq_f32(a, b);
+#else
+	return (a > b) ? a : b;
+#endif
+}
+
+static inline SimdFloat4 simdClamp(SimdFloat4 value, SimdFloat4 low, SimdFloat4 high)
+{
+	return simdMin(simdMax(value, low), high);
+}
+
+//1 / sqrt(value), value > 0
+static inline SimdFloat4 simdReciprocalSqrt(SimdFloat4 value)
+{
+#ifdef SIMD_NEON
+	//the estimate is good to 8 bits, one Newton-Raphson step takes it to about 16
+	SimdFloat4 estimate = vrsqrteq_f32(value);
+	return vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(value, estimate), estimate));
+#else
+	SimdFloat4 result;
+	for (int i = 0; i < SIMD_WIDTH; i++)
+		result[i] = 1.0f / sqrtf(value[i]);
+	return result;
+#endif
+}
+
+/*----- Comparisons, masks are all ones in the lanes where they hold -----*/
+
+static inline SimdUint4 simdGreater(SimdFloat4 a, SimdFloat4 b)
+{
+#ifdef SIMD_NEON
+	return vcgtq_f32(a, b);
+#else
+	return (SimdUint4)(a > b);
+#endif
+}
+
+static inline SimdUint4 simdLess(SimdFloat4 a, SimdFloat4 b)
+{
+#ifdef SIMD_NEON
+	return vcltq_f32(a, b);
+#else
+	return (SimdUint4)(a < b);
+#endif
+}
+
+//a where mask is set, b elsewhere
+static inline SimdFloat4 simdSelect(SimdUint4 mask, SimdFloat4 a, SimdFloat4 b)
+{
+#ifdef SIMD_NEON
+	return vbslq_f32(mask, a, b);
+#else
+	return (SimdFloat4)((mask & (SimdUint4)a) | (~mask & (SimdUint4)b));
+#endif
+}
+
+/*----- Integers -----*/
+
+static inline SimdUint4 simdAnd(SimdUint4 a, SimdUint4 b)
+{
+#ifdef SIMD_NEON
+	return vandq_u32(a, b);
+#else
+	return a & b;
+#endif
+}
+
+static inline SimdUint4 simdOr(SimdUint4 a, SimdUint4 b)
+{
+#ifdef SIMD_NEON
+	return vorrq_u32(a, b);
+#else
+	return a | b;
+#endif
+}
+
+//Shifted left by a constant
+#ifdef SIMD_NEON
+#define simdShiftLeft(value, bits)	vshlq_n_u32((value), (bits))
+#else
+#define simdShiftLeft(value, bits)	((value) << (bits))
+#endif
+
+//Truncated towards zero, value >= 0
+static inline SimdUint4 simdToUint(SimdFloat4 value)
+{
+#ifdef SIMD_NEON
+	return vcvtq_u32_f32(value);
+#else
+	return (SimdUint4)__builtin_convertvector(value, SimdInt4);
+#endif
+}
+
+//The same bits seen as the other type
+static inline SimdUint4 simdAsUint(SimdFloat4 value)
+{
+#ifdef SIMD_NEON
+	return vreinterpretq_u32_f32(value);
+#else
+	return (SimdUint4)value;
+#endif
+}
+
+static inline SimdFloat4 simdAsFloat(SimdUint4 value)
+{
+#ifdef SIMD_NEON
+	return vreinterpretq_f32_u32(value);
+#else
+	return (SimdFloat4)value;
+#endif
+}
+
+/*----- Structure of arrays to array of structures -----*/
+
+//Rows a, b, c, d become columns: afterwards a holds lane 0 of all four, b lane 1 and so on
+static inline void simdTranspose(SimdFloat4* a, SimdFloat4* b, SimdFloat4* c, SimdFloat4* d)
+{
+#ifdef SIMD_NEON
+	float32x4x2_t ab = vtrnq_f32(*a, *b);
+	float32x4x2_t cd = vtrnq_f32(*c, *d);
+	*a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+	*b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+	*c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+	*d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+#else
+	SimdInt4 low = { 0, 4, 1, 5 };
+	SimdInt4 high = { 2, 6, 3, 7 };
+	SimdFloat4 ab0 = __builtin_shuffle(*a, *b, low);		//a0 b0 a1 b1
+	SimdFloat4 ab1 = __builtin_shuffle(*a, *b, high);		//a2 b2 a3 b3
+	SimdFloat4 cd0 = __builtin_shuffle(*c, *d, low);
+	SimdFloat4 cd1 = __builtin_shuffle(*c, *d, high);
+	SimdInt4 first = { 0, 1, 4, 5 };
+	SimdInt4 second = { 2, 3, 6, 7 };
+	*a = __builtin_shuffle(ab0, cd0, first);
+	*b = __builtin_shuffle(ab0, cd0, second);
+	*c = __builtin_shuffle(ab1, cd1, first);
+	*d = __builtin_shuffle(ab1, cd1, second);
+#endif
+}
@@ -0,0 +1,391 @@
+#include "SpriteBatch.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+//built from src/shaders/*/sprite_*.cg by the Makefile
+extern const SceGxmProgram sprite_v_gxp_start;
+extern const SceGxmProgram sprite_f_gxp_start;
+
+//16 bit indices reach 65536 vertices, 4 per quad
+#define SPRITE_BATCH_QUAD_LIMIT		16384
+//the white texel is a linear texture, its row is padded out to 8 texels
+#define SPRITE_WHITE_TEXEL_SIZE		64
+
+static const SceGxmBlendInfo _blendInfos[NUMBER_OF_SPRITE_BLEND_MODES] = {
+	//alpha
+	{ SCE_GXM_COLOR_MASK_ALL, SCE_GXM_BLEND_FUNC_ADD, SCE_GXM_BLEND_FUNC_ADD,
+		SCE_GXM_BLEND_FACTOR_SRC_ALPHA, SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		SCE_GXM_BLEND_FACTOR_ONE, SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA },
+	//additive
+	{ SCE_GXM_COLOR_MASK_ALL, SCE_GXM_BLEND_FUNC_ADD, SCE_GXM_BLEND_FUNC_ADD,
+		SCE_GXM_BLEND_FACTOR_SRC_ALPHA, SCE_GXM_BLEND_FACTOR_ONE,
+		SCE_GXM_BLEND_FACTOR_ZERO, SCE_GXM_BLEND_FACTOR_ONE },
+	//opaque, never used, the program is created without blending
+	{ SCE_GXM_COLOR_MASK_ALL, SCE_GXM_BLEND_FUNC_NONE, SCE_GXM_BLEND_FUNC_NONE,
+		SCE_GXM_BLEND_FACTOR_ONE, SCE_GXM_BLEND_FACTOR_ZERO,
+		SCE_GXM_BLEND_FACTOR_ONE, SCE_GXM_BLEND_FACTOR_ZERO }
+};
+
+SpriteBatch::SpriteBatch()
+{
+	memset(&stats, 0, sizeof(stats));
+	memset(&frameStats, 0, sizeof(frameStats));
+	memset(&whiteTexture, 0, sizeof(whiteTexture));
+	memset(screenTransform, 0, sizeof(screenTransform));
+	initialized = false;
+	drawing = false;
+	maxQuads = 0;
+	memory_ptr = nullptr;
+	indices_ptr = nullptr;
+	region_ptr = nullptr;
+	regionQuads = 0;
+	pendingStart = 0;
+	pendingTexture = nullptr;
+	pendingBlend = SPRITE_BLEND_ALPHA;
+	blendMode = SPRITE_BLEND_ALPHA;
+
+	vertexProgramID = nullptr;
+	fragmentProgramID = nullptr;
+	screenTransformParam_ptr = nullptr;
+}
+
+SpriteBatch::~SpriteBatch()
+{
+}
+
+void SpriteBatch::init(unsigned int quads)
+{
+	vitaPrintf("\nInitializing sprite batch for %u quads a frame\n", quads);
+	if (quads == 0 || quads > SPRITE_BATCH_QUAD_LIMIT)
+	{
+		vitaPrintf("ERROR: a sprite batch holds 1 to %u quads, clamping %u\n", SPRITE_BATCH_QUAD_LIMIT, quads);
+		quads = (quads == 0) ? 1 : SPRITE_BATCH_QUAD_LIMIT;
+	}
+	maxQuads = quads;
+	Graphics* graphics = Graphics::getInstance();
+
+	SceSize indexSize = ALIGN_MEM(maxQuads * 6 * sizeof(uint16_t), 16);
+	SceSize regionSize = maxQuads * 4 * sizeof(SpriteVertex);
+	SceUID uid = -1;
+	memory_ptr = graphics->allocGraphicsMem(
+		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
+		SPRITE_WHITE_TEXEL_SIZE + indexSize,
+		SPRITE_WHITE_TEXEL_SIZE,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		&uid,
+		"sprite_batch",
+		MEMORY_CATEGORY_UI
+	);
+	memory = GpuBuffer(memory_ptr, uid);
+	indices_ptr = (uint16_t*)((uint8_t*)memory_ptr + SPRITE_WHITE_TEXEL_SIZE);
+	vertexRing.init(regionSize, 16, "sprite_batch_vertices", MEMORY_CATEGORY_UI);
+
+	memset(memory_ptr, 0, SPRITE_WHITE_TEXEL_SIZE);
+	*(unsigned int*)memory_ptr = COLOR_WHITE;
+	int error = sceGxmTextureInitLinear(&whiteTexture, memory_ptr, SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR, 1, 1, 0);
+	if (error != 0)
+		vitaPrintf("sceGxmTextureInitLinear() result: 0x%08X\n", error);
+
+	//two triangles per quad, top left, top right, bottom left then bottom left, top right, bottom right
+	for (unsigned int quad = 0; quad < maxQuads; quad++)
+	{
+		uint16_t* index = indices_ptr + quad * 6;
+		uint16_t vertex = (uint16_t)(quad * 4);
+		index[0] = vertex;
+		index[1] = vertex + 1;
+		index[2] = vertex + 2;
+		index[3] = vertex + 2;
+		index[4] = vertex + 1;
+		index[5] = vertex + 3;
+	}
+
+	vertexProgramID = graphics->patcherRegisterProgram(&sprite_v_gxp_start);
+	fragmentProgramID = graphics->patcherRegisterProgram(&sprite_f_gxp_start);
+
+	SceGxmVertexAttribute attributes[3];
+	attributes[0].streamIndex = 0;
+	attributes[0].offset = 0;
+	attributes[0].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	attributes[0].componentCount = 2;
+	attributes[1].streamIndex = 0;
+	attributes[1].offset = 8; //(x, y) * 4
+	attributes[1].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	attributes[1].componentCount = 2;
+	attributes[2].streamIndex = 0;
+	attributes[2].offset = 16; //(x, y, u, v) * 4
+	attributes[2].format = SCE_GXM_ATTRIBUTE_FORMAT_U8N;
+	attributes[2].componentCount = 4;
+	const char* const names[3] = { "aPosition", "aTexcoord", "aColor" };
+
+	SceGxmVertexStream stream;
+	stream.stride = sizeof(SpriteVertex);
+	stream.indexSource = SCE_GXM_INDEX_SOURCE_INDEX_16BIT;
+	vertexProgram = graphics->patcherCreateVertexProgram(vertexProgramID, attributes, 3, &stream, names);
+
+	//blending is part of the fragment program, one per mode
+	for (int i = 0; i < NUMBER_OF_SPRITE_BLEND_MODES; i++)
+	{
+		const SceGxmBlendInfo* blendInfo = (i == SPRITE_BLEND_OPAQUE) ? NULL : &_blendInfos[i];
+		_fragmentPrograms[i] = graphics->patcherCreateFragmentProgram(fragmentProgramID, vertexProgramID, blendInfo);
+	}
+
+	screenTransformParam_ptr = sceGxmProgramFindParameterByName(&sprite_v_gxp_start, "screenTransform");
+	assert(screenTransformParam_ptr && (sceGxmProgramParameterGetCategory(screenTransformParam_ptr) == SCE_GXM_PARAMETER_CATEGORY_UNIFORM));
+
+	region_ptr = (SpriteVertex*)vertexRing.getRegion();
+	regionQuads = 0;
+	pendingStart = 0;
+	initialized = true;
+}
+
+void SpriteBatch::shutdown()
+{
+	if (!initialized)
+		return;
+	vitaPrintf("\nShutting down sprite batch\n");
+
+	//queued behind the frames that may still draw with them, the programs before the GXPs they were patched from
+	Graphics* graphics = Graphics::getInstance();
+	for (int i = 0; i < NUMBER_OF_SPRITE_BLEND_MODES; i++)
+		_fragmentPrograms[i].reset();
+	vertexProgram.reset();
+	graphics->deferRelease(GPU_RESOURCE_REGISTERED_PROGRAM, fragmentProgramID);
+	graphics->deferRelease(GPU_RESOURCE_REGISTERED_PROGRAM, vertexProgramID);
+	fragmentProgramID = nullptr;
+	vertexProgramID = nullptr;
+	memory.reset();
+	memory_ptr = nullptr;
+	vertexRing.shutdown();
+	indices_ptr = nullptr;
+	region_ptr = nullptr;
+	drawing = false;
+	initialized = false;
+}
+
+bool SpriteBatch::isInitialized()
+{
+	return initialized;
+}
+
+void SpriteBatch::beginFrame(unsigned int frame)
+{
+	//the frame that just ended becomes the last frame
+	stats.quadsLastFrame = frameStats.quadsLastFrame;
+	stats.drawsLastFrame = frameStats.drawsLastFrame;
+	stats.textureBreaksLastFrame = frameStats.textureBreaksLastFrame;
+	stats.blendBreaksLastFrame = frameStats.blendBreaksLastFrame;
+	stats.droppedLastFrame = frameStats.droppedLastFrame;
+	if (frameStats.quadsLastFrame > stats.quadsPeak)
+		stats.quadsPeak = frameStats.quadsLastFrame;
+	memset(&frameStats, 0, sizeof(frameStats));
+
+	region_ptr = (SpriteVertex*)vertexRing.beginFrame(frame);
+	stats.stalls = vertexRing.getStalls();
+	regionQuads = 0;
+	pendingStart = 0;
+}
+
+void SpriteBatch::begin(float width, float height)
+{
+	if (!initialized)
+		return;
+
+	unsigned int frame = Graphics::getInstance()->getFrameIndex();
+	if (frame != vertexRing.getFrame())
+		beginFrame(frame);
+
+	const GraphicsConfig* config = Graphics::getInstance()->getConfig();
+	if (width <= 0.0f)
+		width = (float)config->displayWidth;
+	if (height <= 0.0f)
+		height = (float)config->displayHeight;
+
+	//pixels to clip space, y grows down the screen
+	screenTransform[0] = 2.0f / width;
+	screenTransform[1] = -2.0f / height;
+	screenTransform[2] = -1.0f;
+	screenTransform[3] = 1.0f;
+	drawing = true;
+}
+
+void SpriteBatch::end()
+{
+	flush();
+	drawing = false;
+}
+
+void SpriteBatch::flush()
+{
+	if (!drawing || regionQuads == pendingStart)
+		return;
+
+	Graphics* graphics = Graphics::getInstance();
+	graphics->patcherSetVertexProgram(vertexProgram.get());
+	graphics->patcherSetFragmentProgram(_fragmentPrograms[pendingBlend].get());
+	graphics->patcherSetVertexProgramConstants(NULL, screenTransformParam_ptr, 0, 4, screenTransform);
+	graphics->setFragmentTexture(0, (pendingTexture != nullptr) ? pendingTexture : &whiteTexture);
+
+	//the indices always start at quad 0, the stream starts at the first pending quad instead
+	graphics->patcherSetVertexStream(0, region_ptr + pendingStart * 4);
+	graphics->draw(SCE_GXM_PRIMITIVE_TRIANGLES, SCE_GXM_INDEX_FORMAT_U16, indices_ptr, (regionQuads - pendingStart) * 6);
+	frameStats.drawsLastFrame++;
+	pendingStart = regionQuads;
+}
+
+void SpriteBatch::setBlendMode(SpriteBlendMode mode)
+{
+	blendMode = mode;
+}
+
+SpriteVertex* SpriteBatch::reserveQuad(const SceGxmTexture* texture)
+{
+	if (!drawing)
+		return nullptr;
+	if (regionQuads == maxQuads)
+	{
+		frameStats.droppedLastFrame++;
+		return nullptr;
+	}
+
+	if (regionQuads != pendingStart)
+	{
+		if (texture != pendingTexture)
+		{
+			frameStats.textureBreaksLastFrame++;
+			flush();
+		}
+		else if (blendMode != pendingBlend)
+		{
+			frameStats.blendBreaksLastFrame++;
+			flush();
+		}
+	}
+	pendingTexture = texture;
+	pendingBlend = blendMode;
+
+	SpriteVertex* quad = region_ptr + regionQuads * 4;
+	regionQuads++;
+	frameStats.quadsLastFrame++;
+	return quad;
+}
+
+static inline void setVertex(SpriteVertex* vertex, float x, float y, float u, float v, unsigned int color)
+{
+	vertex->x = x;
+	vertex->y = y;
+	vertex->u = u;
+	vertex->v = v;
+	vertex->color = color;
+}
+
+void SpriteBatch::drawSprite(const SceGxmTexture* texture, float x, float y, float width, float height, unsigned int color)
+{
+	drawSprite(texture, x, y, width, height, 0.0f, 0.0f, 1.0f, 1.0f, color);
+}
+
+void SpriteBatch::drawSprite(const SceGxmTexture* texture, float x, float y, float width, float height,
+	float u0, float v0, float u1, float v1, unsigned int color)
+{
+	SpriteVertex* quad = reserveQuad(texture);
+	if (quad == nullptr)
+		return;
+	setVertex(&quad[0], x, y, u0, v0, color);
+	setVertex(&quad[1], x + width, y, u1, v0, color);
+	setVertex(&quad[2], x, y + height, u0, v1, color);
+	setVertex(&quad[3], x + width, y + height, u1, v1, color);
+}
+
+void SpriteBatch::drawSpriteRotated(const SceGxmTexture* texture, float x, float y, float width, float height, float angle, unsigned int color)
+{
+	SpriteVertex* quad = reserveQuad(texture);
+	if (quad == nullptr)
+		return;
+	float centerX = x + width * 0.5f;
+	float centerY = y + height * 0.5f;
+	float c = cosf(angle);
+	float s = sinf(angle);
+	//the half extents along the rotated axes
+	float wx = width * 0.5f * c;
+	float wy = width * 0.5f * s;
+	float hx = -height * 0.5f * s;
+	float hy = height * 0.5f * c;
+	setVertex(&quad[0], centerX - wx - hx, centerY - wy - hy, 0.0f, 0.0f, color);
+	setVertex(&quad[1], centerX + wx - hx, centerY + wy - hy, 1.0f, 0.0f, color);
+	setVertex(&quad[2], centerX - wx + hx, centerY - wy + hy, 0.0f, 1.0f, color);
+	setVertex(&quad[3], centerX + wx + hx, centerY + wy + hy, 1.0f, 1.0f, color);
+}
+
+void SpriteBatch::drawRect(float x, float y, float width, float height, unsigned int color)
+{
+	drawSprite(nullptr, x, y, width, height, 0.0f, 0.0f, 0.0f, 0.0f, color);
+}
+
+void SpriteBatch::drawRectOutline(float x, float y, float width, float height, float thickness, unsigned int color)
+{
+	//the sides don't overlap the top and bottom, blending would show the corners twice
+	if (thickness * 2.0f >= width || thickness * 2.0f >= height)
+	{
+		drawRect(x, y, width, height, color);
+		return;
+	}
+	drawRect(x, y, width, thickness, color);
+	drawRect(x, y + height - thickness, width, thickness, color);
+	drawRect(x, y + thickness, thickness, height - thickness * 2.0f, color);
+	drawRect(x + width - thickness, y + thickness, thickness, height - thickness * 2.0f, color);
+}
+
+void SpriteBatch::drawLine(float x0, float y0, float x1, float y1, float thickness, unsigned int color)
+{
+	float dx = x1 - x0;
+	float dy = y1 - y0;
+	float length = sqrtf(dx * dx + dy * dy);
+	if (length == 0.0f)
+		return;
+	SpriteVertex* quad = reserveQuad(nullptr);
+	if (quad == nullptr)
+		return;
+	//offset both ends half the thickness to either side
+	float nx = -dy / length * thickness * 0.5f;
+	float ny = dx / length * thickness * 0.5f;
+	setVertex(&quad[0], x0 + nx, y0 + ny, 0.0f, 0.0f, color);
+	setVertex(&quad[1], x1 + nx, y1 + ny, 0.0f, 0.0f, color);
+	setVertex(&quad[2], x0 - nx, y0 - ny, 0.0f, 0.0f, color);
+	setVertex(&quad[3], x1 - nx, y1 - ny, 0.0f, 0.0f, color);
+}
+
+void SpriteBatch::drawTriangle(float x0, float y0, float x1, float y1, float x2, float y2, unsigned int color)
+{
+	SpriteVertex* quad = reserveQuad(nullptr);
+	if (quad == nullptr)
+		return;
+	//the last corner repeats, which makes the quad's second triangle empty
+	setVertex(&quad[0], x0, y0, 0.0f, 0.0f, color);
+	setVertex(&quad[1], x1, y1, 0.0f, 0.0f, color);
+	setVertex(&quad[2], x2, y2, 0.0f, 0.0f, color);
+	setVertex(&quad[3], x2, y2, 0.0f, 0.0f, color);
+}
+
+void SpriteBatch::drawQuad(const SceGxmTexture* texture, const SpriteVertex* corners)
+{
+	SpriteVertex* quad = reserveQuad(texture);
+	if (quad == nullptr)
+		return;
+	memcpy(quad, corners, 4 * sizeof(SpriteVertex));
+}
+
+const SpriteBatchStats* SpriteBatch::getStats()
+{
+	return &stats;
+}
+
+void SpriteBatch::logStats()
+{
+	vitaPrintf("\nSprite batch stats:\n");
+	vitaPrintf("\tLast frame: %u quads in %u draws (%u texture breaks, %u blend breaks)\n", stats.quadsLastFrame,
+		stats.drawsLastFrame, stats.textureBreaksLastFrame, stats.blendBreaksLastFrame);
+	vitaPrintf("\tPeak: %u of %u quads, %u dropped last frame\n", stats.quadsPeak, maxQuads, stats.droppedLastFrame);
+	vitaPrintf("\tWaited on the GPU for a vertex region %u times\n", stats.stalls);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+//----------------------------------------------
+// SpriteBatch Class
+// Immediate mode 2D drawing for UIs and debug overlays. Sprites, rectangles, lines
+// and triangles are all written as quads into a dynamic vertex buffer as they are
+// drawn, and go to the GPU as one draw per run of quads sharing a texture and blend
+// mode. Untextured primitives sample a white texel so they batch with the sprites
+// around them. Every quad uses the same 6 indices, so the index buffer is built once
+// and each draw points the vertex stream at the start of its run. The vertices go into the
+// frame's region of a FrameRing
+//-----------------------------------------------
+
+#include "Graphics.h"
+#include "FrameRing.h"
+
+//Default number of quads one frame can draw, anything past it is dropped and counted
+#define SPRITE_BATCH_MAX_QUADS		4096
+
+typedef struct SpriteVertex
+{
+	float x;
+	float y;
+	float u;
+	float v;
+	unsigned int color;
+} SpriteVertex;
+
+typedef enum SpriteBlendMode
+{
+	SPRITE_BLEND_ALPHA = 0,		//src * a + dst * (1 - a)
+	SPRITE_BLEND_ADDITIVE,		//src * a + dst, for glows and particles
+	SPRITE_BLEND_OPAQUE			//src, ignores alpha
+} SpriteBlendMode;
+#define NUMBER_OF_SPRITE_BLEND_MODES 3
+
+typedef struct SpriteBatchStats
+{
+	unsigned int quadsLastFrame;
+	unsigned int drawsLastFrame;
+	unsigned int textureBreaksLastFrame;	//draws ended early by a texture change
+	unsigned int blendBreaksLastFrame;		//draws ended early by a blend mode change
+	unsigned int droppedLastFrame;			//quads past maxQuads, raise it if this isn't 0
+	unsigned int quadsPeak;
+	unsigned int stalls;					//frames that had to wait for the GPU to release their region
+} SpriteBatchStats;
+
+class SpriteBatch
+{
+public:
+	SpriteBatch();
+	~SpriteBatch();
+
+	//Graphics must be initialized, maxQuads is the most one frame can draw (16384 at most, 16 bit indices)
+	void init(unsigned int maxQuads = SPRITE_BATCH_MAX_QUADS);
+	//Hands the buffers and programs to Graphics' release queue, frames already submitted can still draw with them
+	void shutdown();
+	bool isInitialized();
+
+	//Starts drawing, between Graphics::startScene() and endScene(). Coordinates are pixels of a width x height
+	//screen with the origin at the top left, 0 uses the display size. begin() can be called more than once a frame
+	void begin(float width = 0.0f, float height = 0.0f);
+	//Draws everything still pending
+	void end();
+	//Draws what is pending now, begin() and end() take care of it unless something else draws in between
+	void flush();
+
+	void setBlendMode(SpriteBlendMode mode);
+
+	/*----- Drawing -----*/
+	//A nullptr texture draws in plain color. color is an RGBA8() tint multiplied with the texture
+	void drawSprite(const SceGxmTexture* texture, float x, float y, float width, float height, unsigned int color = COLOR_WHITE);
+	//u0, v0 is the texture coordinate of the top left corner, u1, v1 of the bottom right
+	void drawSprite(const SceGxmTexture* texture, float x, float y, float width, float height,
+		float u0, float v0, float u1, float v1, unsigned int color = COLOR_WHITE);
+	//Rotated by angle radians around its center
+	void drawSpriteRotated(const SceGxmTexture* texture, float x, float y, float width, float height, float angle, unsigned int color = COLOR_WHITE);
+	void drawRect(float x, float y, float width, float height, unsigned int color);
+	//thickness is drawn inside the rectangle
+	void drawRectOutline(float x, float y, float width, float height, float thickness, unsigned int color);
+	void drawLine(float x0, float y0, float x1, float y1, float thickness, unsigned int color);
+	void drawTriangle(float x0, float y0, float x1, float y1, float x2, float y2, unsigned int color);
+	//Anything else, corners are top left, top right, bottom left, bottom right
+	void drawQuad(const SceGxmTexture* texture, const SpriteVertex* corners);
+
+	const SpriteBatchStats* getStats();
+	void logStats();
+
+private:
+	//The next free quad's vertices, nullptr when the frame is out of room. Flushes first if texture or blend mode change
+	SpriteVertex* reserveQuad(const SceGxmTexture* texture);
+	//Rolls the stats over and moves to the frame's vertex region
+	void beginFrame(unsigned int frame);
+
+	SpriteBatchStats stats;
+	SpriteBatchStats frameStats;
+	bool initialized;
+	bool drawing;
+	unsigned int maxQuads;
+
+	//white texel and quad indices in one memblock, the vertices in the ring
+	void* memory_ptr;
+	GpuBuffer memory;
+	uint16_t* indices_ptr;
+	SceGxmTexture whiteTexture;
+
+	FrameRing vertexRing;
+	SpriteVertex* region_ptr;
+	unsigned int regionQuads;			//quads written into the region this frame
+	unsigned int pendingStart;			//first quad not drawn yet
+	const SceGxmTexture* pendingTexture;
+	SpriteBlendMode pendingBlend;
+	SpriteBlendMode blendMode;
+	float screenTransform[4];
+
+	SceGxmShaderPatcherId vertexProgramID;
+	SceGxmShaderPatcherId fragmentProgramID;
+	GpuVertexProgram vertexProgram;
+	GpuFragmentProgram _fragmentPrograms[NUMBER_OF_SPRITE_BLEND_MODES];
+	const SceGxmProgramParameter* screenTransformParam_ptr;
+};
@@ -0,0 +1,79 @@
+#include "StartupTask.h"
+
+#include <assert.h>
+
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+
+#define STARTUP_TASK_STACK_SIZE		(64 * 1024)
+//Below the render thread, the point is to use time it spends waiting on the GPU and the kernel
+#define STARTUP_TASK_PRIORITY		(SCE_KERNEL_DEFAULT_PRIORITY_USER + 1)
+
+StartupTask::StartupTask()
+{
+	function = nullptr;
+	userData = nullptr;
+	threadUID = -1;
+	result = -1;
+	duration = 0;
+}
+
+StartupTask::~StartupTask()
+{
+	//the thread can't be left running with userData about to go away
+	wait();
+}
+
+bool StartupTask::start(const char* name, StartupTaskFunction function, void* userData)
+{
+	assert(threadUID < 0);
+	this->function = function;
+	this->userData = userData;
+	result = -1;
+	duration = 0;
+
+	threadUID = sceKernelCreateThread(name, &StartupTask::taskThread, STARTUP_TASK_PRIORITY, STARTUP_TASK_STACK_SIZE, 0,
+		SCE_KERNEL_CPU_MASK_USER_1, NULL);
+	if (threadUID < 0)
+		return false;
+
+	StartupTask* self = this;
+	if (sceKernelStartThread(threadUID, sizeof(self), &self) != 0)
+	{
+		sceKernelDeleteThread(threadUID);
+		threadUID = -1;
+		return false;
+	}
+	return true;
+}
+
+int StartupTask::wait()
+{
+	if (threadUID < 0)
+		return result;
+
+	sceKernelWaitThreadEnd(threadUID, NULL, NULL);
+	sceKernelDeleteThread(threadUID);
+	threadUID = -1;
+	return result;
+}
+
+bool StartupTask::isStarted()
+{
+	return threadUID >= 0;
+}
+
+SceUInt64 StartupTask::getDuration()
+{
+	return duration;
+}
+
+int StartupTask::taskThread(SceSize args, void* argp)
+{
+	//argp points at a copy of the pointer passed to sceKernelStartThread()
+	StartupTask* task = *(StartupTask**)argp;
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+	task->result = task->function(task->userData);
+	task->duration = sceKernelGetProcessTimeWide() - start;
+	return 0;
+}
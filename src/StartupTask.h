@@ -0,0 +1,38 @@
+#pragma once
+
+//----------------------------------------------
+// StartupTask Class
+// Runs one function on its own thread so slow loading that doesn't touch Graphics (system
+// modules, fonts, files) overlaps with GPU setup and program patching on the render thread.
+// The function mustn't log or call into Graphics, neither is safe off the render thread
+//-----------------------------------------------
+
+#include <psp2/types.h>
+
+//What the task does, the return value is handed back by wait()
+typedef int (*StartupTaskFunction)(void* userData);
+
+class StartupTask
+{
+public:
+	StartupTask();
+	~StartupTask();
+
+	//Starts function on a new thread named name, false if the thread couldn't be started
+	bool start(const char* name, StartupTaskFunction function, void* userData);
+	//Blocks until the function has returned and deletes the thread. Returns what the function did, -1 if it never started
+	int wait();
+	bool isStarted();
+	//Microseconds the function ran for, once wait() returned
+	SceUInt64 getDuration();
+
+private:
+	static int taskThread(SceSize args, void* argp);
+
+	StartupTaskFunction function;
+	void* userData;
+	SceUID threadUID;
+	//written by the task thread, read after wait() joined it
+	int result;
+	SceUInt64 duration;
+};
@@ -0,0 +1,100 @@
+#include "StartupTimer.h"
+#include "commonUtils.h"
+
+#include <string.h>
+
+#include <psp2/kernel/processmgr.h>
+
+StartupTimer::StartupTimer()
+{
+	memset(_phases, 0, sizeof(_phases));
+	phaseCount = 0;
+	memset(_running, 0, sizeof(_running));
+	runningCount = 0;
+	droppedPhases = 0;
+	firstFrameTime = 0;
+}
+
+StartupTimer::~StartupTimer()
+{
+}
+
+StartupTimer* StartupTimer::getInstance()
+{
+	static StartupTimer instance;
+	return &instance;
+}
+
+void StartupTimer::beginPhase(const char* name)
+{
+	//anything nested deeper than that, or past the last slot, is left out rather than breaking the nesting
+	if (droppedPhases > 0 || phaseCount == STARTUP_MAX_PHASES || runningCount == STARTUP_MAX_DEPTH)
+	{
+		droppedPhases++;
+		return;
+	}
+
+	StartupPhase* phase = &_phases[phaseCount];
+	phase->name = name;
+	phase->depth = runningCount;
+	phase->start = sceKernelGetProcessTimeWide();
+	phase->duration = 0;
+	_running[runningCount++] = phaseCount++;
+}
+
+void StartupTimer::endPhase()
+{
+	if (droppedPhases > 0)
+	{
+		droppedPhases--;
+		return;
+	}
+	if (runningCount == 0)
+		return;
+
+	StartupPhase* phase = &_phases[_running[--runningCount]];
+	phase->duration = sceKernelGetProcessTimeWide() - phase->start;
+}
+
+void StartupTimer::frameSubmitted()
+{
+	if (firstFrameTime != 0)
+		return;
+
+	firstFrameTime = sceKernelGetProcessTimeWide();
+	logPhases();
+}
+
+SceUInt64 StartupTimer::getTimeToFirstFrame()
+{
+	return firstFrameTime;
+}
+
+unsigned int StartupTimer::getPhaseCount()
+{
+	return phaseCount;
+}
+
+const StartupPhase* StartupTimer::getPhase(unsigned int index)
+{
+	return (index < phaseCount) ? &_phases[index] : nullptr;
+}
+
+void StartupTimer::logPhases()
+{
+	static const char* _indents[STARTUP_MAX_DEPTH] = { "", "  ", "    ", "      " };
+
+	vitaPrintf("\nStartup phases (ms, started at ms since launch)\n");
+	for (unsigned int i = 0; i < phaseCount; i++)
+	{
+		const StartupPhase* phase = &_phases[i];
+		//deeper phases are padded less so the times line up
+		int width = 24 - 2 * (int)phase->depth;
+		if (phase->duration == 0)
+			vitaPrintf("%s%-*s   running (at %.2f)\n", _indents[phase->depth], width, phase->name, phase->start / 1000.0);
+		else
+			vitaPrintf("%s%-*s %9.2f (at %.2f)\n", _indents[phase->depth], width, phase->name, phase->duration / 1000.0, phase->start / 1000.0);
+	}
+	if (firstFrameTime != 0)
+		vitaPrintf("Time to first frame: %.2fms\n", firstFrameTime / 1000.0);
+}
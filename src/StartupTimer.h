@@ -0,0 +1,57 @@
+#pragma once
+
+//----------------------------------------------
+// StartupTimer Class
+// Times launch as named phases, a phase begun while another is running is nested under it.
+// Times come from sceKernelGetProcessTimeWide(), so they count from when the process started.
+// Graphics::swapBuffers() reports the first frame, the time to it is logged with the phases
+// on every launch. Render thread only
+//-----------------------------------------------
+
+#include <psp2/types.h>
+
+#define STARTUP_MAX_PHASES			32
+#define STARTUP_MAX_DEPTH			4
+
+typedef struct StartupPhase
+{
+	const char* name;
+	unsigned int depth;				//0 for phases begun with nothing else running
+	SceUInt64 start;				//microseconds since the process started
+	SceUInt64 duration;				//0 while it is still running
+} StartupPhase;
+
+//C++ singleton StartupTimer class
+class StartupTimer
+{
+protected:
+	StartupTimer();
+	StartupTimer(StartupTimer const&);
+	void operator=(StartupTimer const&);
+public:
+	~StartupTimer();
+	static StartupTimer* getInstance();
+
+	//Starts a phase inside the one running, name isn't copied so it should be a literal
+	void beginPhase(const char* name);
+	//Ends the phase begun last
+	void endPhase();
+	//The first call records the time to the first frame and logs the phases, later calls return straight away
+	void frameSubmitted();
+
+	//Microseconds from the process starting to the first frame, 0 until there has been one
+	SceUInt64 getTimeToFirstFrame();
+	unsigned int getPhaseCount();
+	const StartupPhase* getPhase(unsigned int index);
+	void logPhases();
+
+private:
+	StartupPhase _phases[STARTUP_MAX_PHASES];
+	unsigned int phaseCount;
+	//indexes into _phases of the phases running, innermost last
+	unsigned int _running[STARTUP_MAX_DEPTH];
+	unsigned int runningCount;
+	//phases that didn't fit are timed by nobody, their endPhase() only has to be matched
+	unsigned int droppedPhases;
+	SceUInt64 firstFrameTime;
+};
@@ -0,0 +1,105 @@
+#include "StatsOverlay.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#include <psp2/kernel/processmgr.h>
+
+#define MEGABYTES(bytes)	((bytes) / (1024.0f * 1024.0f))
+
+StatsOverlay::StatsOverlay()
+{
+	font_ptr = nullptr;
+	visible = false;
+	lastUpdateTime = 0;
+	memset(_frameTimes, 0, sizeof(_frameTimes));
+	sampleIndex = 0;
+	sampleCount = 0;
+}
+
+StatsOverlay::~StatsOverlay()
+{
+}
+
+void StatsOverlay::init(Font* font)
+{
+	font_ptr = font;
+	lastUpdateTime = 0;
+	sampleIndex = 0;
+	sampleCount = 0;
+}
+
+void StatsOverlay::setVisible(bool show)
+{
+	visible = show;
+}
+
+bool StatsOverlay::isVisible()
+{
+	return visible;
+}
+
+void StatsOverlay::update()
+{
+	SceUInt64 now = sceKernelGetProcessTimeWide();
+	if (lastUpdateTime != 0)
+	{
+		_frameTimes[sampleIndex] = now - lastUpdateTime;
+		sampleIndex = (sampleIndex + 1) % OVERLAY_SAMPLE_FRAMES;
+		if (sampleCount < OVERLAY_SAMPLE_FRAMES)
+			sampleCount++;
+	}
+	lastUpdateTime = now;
+}
+
+void StatsOverlay::draw(SpriteBatch* batch)
+{
+	if (!visible || font_ptr == nullptr || !font_ptr->isInitialized())
+		return;
+
+	SceUInt64 frameTimeTotal = 0;
+	SceUInt64 frameTimeMax = 0;
+	for (unsigned int i = 0; i < sampleCount; i++)
+	{
+		frameTimeTotal += _frameTimes[i];
+		if (_frameTimes[i] > frameTimeMax)
+			frameTimeMax = _frameTimes[i];
+	}
+	float frameTime = (sampleCount > 0) ? (float)frameTimeTotal / sampleCount : 0.0f;
+
+	Graphics* graphics = Graphics::getInstance();
+	const GraphicsStats* graphicsStats = graphics->getStats();
+	const SpriteBatchStats* batchStats = batch->getStats();
+
+	char text[512];
+	int length = snprintf(text, sizeof(text), "%.1f FPS  %.2fms (max %.2fms)\nDraws %u  Primitives %u  Sprites %u in %u\n"
+		"CDRAM %.1fMB  LPDDR %.1fMB  Host %.1fMB",
+		(frameTime > 0.0f) ? 1000000.0f / frameTime : 0.0f, frameTime / 1000.0f, frameTimeMax / 1000.0f,
+		graphicsStats->drawsLastFrame, graphicsStats->primitivesLastFrame, batchStats->quadsLastFrame, batchStats->drawsLastFrame,
+		MEGABYTES(graphics->getMemoryUsage(MEMORY_POOL_CDRAM)), MEGABYTES(graphics->getMemoryUsage(MEMORY_POOL_LPDDR)),
+		MEGABYTES(graphics->getMemoryUsage(MEMORY_POOL_HOST)));
+
+	TextureCache* textureCache = graphics->getTextureCache();
+	if (textureCache != nullptr && length > 0 && length < (int)sizeof(text))
+	{
+		const TextureCacheStats* cacheStats = textureCache->getStats();
+		length += snprintf(text + length, sizeof(text) - length, "\nTextures %.1f/%.1fMB, %u streaming",
+			MEGABYTES(cacheStats->residentBytes), MEGABYTES(cacheStats->budget), cacheStats->streaming);
+	}
+	const DynamicResolutionStats* drsStats = graphics->getDynamicResolutionStats();
+	if (drsStats != nullptr && length > 0 && length < (int)sizeof(text))
+	{
+		snprintf(text + length, sizeof(text) - length, "\nResolution %ux%u (%u%%)",
+			drsStats->width, drsStats->height, drsStats->scalePercent);
+	}
+
+	float height;
+	float width = font_ptr->measureText(text, 1.0f, &height);
+
+	//the background is atlas white and the text atlas glyphs, one texture and blend mode, one draw
+	batch->begin();
+	batch->setBlendMode(SPRITE_BLEND_ALPHA);
+	font_ptr->drawRect(batch, OVERLAY_X, OVERLAY_Y, width + OVERLAY_MARGIN * 2.0f, height + OVERLAY_MARGIN * 2.0f, OVERLAY_BACKGROUND_COLOR);
+	font_ptr->drawText(batch, OVERLAY_X + OVERLAY_MARGIN, OVERLAY_Y + OVERLAY_MARGIN, OVERLAY_TEXT_COLOR, text);
+	batch->end();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+//----------------------------------------------
+// StatsOverlay Class
+// Live frame rate, frame time, draw count and memory usage in the corner of the
+// screen. The background and every line of text come out of the font atlas, so
+// the whole overlay is one draw of the SpriteBatch
+//-----------------------------------------------
+
+#include "Font.h"
+
+//Frames the frame time average and maximum are taken over
+#define OVERLAY_SAMPLE_FRAMES		60
+//Top left corner of the overlay, pixels
+#define OVERLAY_X					8.0f
+#define OVERLAY_Y					8.0f
+#define OVERLAY_MARGIN				4.0f
+#define OVERLAY_TEXT_COLOR			COLOR_WHITE
+#define OVERLAY_BACKGROUND_COLOR	RGBA8(0, 0, 0, 160)
+
+class StatsOverlay
+{
+public:
+	StatsOverlay();
+	~StatsOverlay();
+
+	//font must stay initialized for as long as the overlay draws
+	void init(Font* font);
+	void setVisible(bool visible);
+	bool isVisible();
+
+	//Once a frame, the frame time is the time between calls
+	void update();
+	//Between Graphics::startScene() and endScene(), runs its own begin() and end() on batch
+	void draw(SpriteBatch* batch);
+
+private:
+	Font* font_ptr;
+	bool visible;
+	SceUInt64 lastUpdateTime;
+	SceUInt64 _frameTimes[OVERLAY_SAMPLE_FRAMES];
+	unsigned int sampleIndex;
+	unsigned int sampleCount;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+//----------------------------------------------
+// Compressed stream file format (.lzs)
+// Shared by the runtime (StreamLoader) and the offline compressor in tools/streamconv.
+// Any file can be wrapped in one, the StreamLoader recognises the magic when it loads a
+// whole file and hands back the original bytes.
+//
+// Layout, every offset is from the start of the file:
+//	StreamFileHeader
+//	uint32_t chunk sizes, chunkCount of them
+//	the chunks back to back
+//
+// The data is split into chunkSize pieces (the last one may be shorter) that are each one
+// LZ4 block, so the loader never needs more than one chunk of compressed data at a time.
+// A chunk that wouldn't get smaller is stored as it is with STREAM_CHUNK_STORED set
+//-----------------------------------------------
+
+#include <stdint.h>
+
+#define STREAM_MAGIC				0x31535A4C	//"LZS1"
+#define STREAM_VERSION				1
+#define STREAM_CHUNK_SIZE			(64 * 1024)
+#define STREAM_CHUNK_STORED			0x80000000	//set in a chunk size when the chunk isn't compressed
+//Worst case size of an LZ4 block holding size bytes
+#define STREAM_COMPRESS_BOUND(size)	((size) + (size) / 255 + 16)
+
+typedef struct StreamFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t uncompressedSize;
+	uint32_t chunkSize;			//uncompressed bytes per chunk, at most STREAM_CHUNK_SIZE
+	uint32_t chunkCount;
+} StreamFileHeader;
@@ -0,0 +1,545 @@
+#include "StreamLoader.h"
+#include "Lz4.h"
+#include "commonUtils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <algorithm>
+
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+
+#define STREAM_THREAD_STACK_SIZE	(32 * 1024)
+//Below the render thread so loading never takes time from a frame, on a core of its own
+#define STREAM_THREAD_PRIORITY		(SCE_KERNEL_DEFAULT_PRIORITY_USER + 16)
+//How long the loader waits for the render thread to make room for a finished load, in microseconds
+#define STREAM_FULL_WAIT			1000
+
+StreamLoader::StreamLoader()
+{
+	commandWrite = 0;
+	commandRead = 0;
+	completionWrite = 0;
+	completionRead = 0;
+	bytesRead = 0;
+	readAheadBytes = 0;
+	busyTime = 0;
+	decompressTime = 0;
+	running = false;
+	loaderThreadUID = -1;
+	wakeSemaUID = -1;
+
+	memset(&stats, 0, sizeof(stats));
+	nextHandle = 0;
+
+	cancelledHandle = STREAM_HANDLE_INVALID;
+	openPath[0] = '\0';
+	fd = -1;
+	fileSize = 0;
+	readAhead_ptr = nullptr;
+	readAheadOffset = 0;
+	readAheadFill = 0;
+	chunk_ptr = nullptr;
+}
+
+StreamLoader::~StreamLoader()
+{
+	shutdown();
+}
+
+StreamLoader* StreamLoader::getInstance()
+{
+	static StreamLoader instance;
+	return &instance;
+}
+
+bool StreamLoader::loadsLater(const Load& a, const Load& b)
+{
+	if (a.priority != b.priority)
+		return a.priority > b.priority;
+	return a.handle > b.handle;
+}
+
+void StreamLoader::init()
+{
+	vitaPrintf("\nStarting stream loader\n");
+	assert(!running);
+
+	readAhead_ptr = (unsigned char*)malloc(STREAM_READ_AHEAD);
+	chunk_ptr = (unsigned char*)malloc(STREAM_COMPRESS_BOUND(STREAM_CHUNK_SIZE));
+	_queue.reserve(STREAM_QUEUE_SIZE);
+	commandWrite = commandRead = 0;
+	completionWrite = completionRead = 0;
+	memset(&stats, 0, sizeof(stats));
+
+	//counts commands waiting, the loader sleeps on it when it has nothing to do
+	wakeSemaUID = sceKernelCreateSema("stream_loader_wake", 0, 0, STREAM_QUEUE_SIZE, NULL);
+	vitaPrintf("sceKernelCreateSema() result: 0x%08X\n", wakeSemaUID);
+	assert(wakeSemaUID >= 0);
+
+	running = true;
+	loaderThreadUID = sceKernelCreateThread("stream_loader", &StreamLoader::loaderThread, STREAM_THREAD_PRIORITY,
+		STREAM_THREAD_STACK_SIZE, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+	vitaPrintf("sceKernelCreateThread() result: 0x%08X\n", loaderThreadUID);
+	assert(loaderThreadUID >= 0);
+
+	StreamLoader* self = this;
+	int error = sceKernelStartThread(loaderThreadUID, sizeof(self), &self);
+	vitaPrintf("sceKernelStartThread() result: 0x%08X\n", error);
+	assert(error == 0);
+}
+
+void StreamLoader::shutdown()
+{
+	if (loaderThreadUID < 0)
+		return;
+
+	vitaPrintf("\nShutting down stream loader\n");
+	running = false;
+	sceKernelSignalSema(wakeSemaUID, 1);
+	sceKernelWaitThreadEnd(loaderThreadUID, NULL, NULL);
+	sceKernelDeleteThread(loaderThreadUID);
+	sceKernelDeleteSema(wakeSemaUID);
+	loaderThreadUID = -1;
+	wakeSemaUID = -1;
+
+	//the thread is gone, whatever it left behind can be cleaned up from here
+	while (completionRead != completionWrite)
+	{
+		Completion* completion = &_completions[completionRead % STREAM_QUEUE_SIZE];
+		if (completion->ownsData)
+			free(completion->result.data);
+		completionRead++;
+	}
+	_queue.clear();
+	closeFile();
+	free(readAhead_ptr);
+	free(chunk_ptr);
+	readAhead_ptr = nullptr;
+	chunk_ptr = nullptr;
+
+	logStats();
+}
+
+bool StreamLoader::isRunning()
+{
+	return running;
+}
+
+/*----- Render thread -----*/
+
+bool StreamLoader::pushCommand(const Command* command)
+{
+	if (commandWrite - commandRead >= STREAM_QUEUE_SIZE)
+		return false;
+
+	_commands[commandWrite % STREAM_QUEUE_SIZE] = *command;
+	//the command has to be visible to the other core before the index that publishes it
+	__sync_synchronize();
+	commandWrite++;
+	sceKernelSignalSema(wakeSemaUID, 1);
+	return true;
+}
+
+StreamHandle StreamLoader::request(const StreamRequest* streamRequest)
+{
+	assert(running && streamRequest->callback);
+	if (strlen(streamRequest->path) >= STREAM_PATH_LENGTH)
+	{
+		vitaPrintf("ERROR: stream path %s is longer than %u characters\n", streamRequest->path, STREAM_PATH_LENGTH - 1);
+		return STREAM_HANDLE_INVALID;
+	}
+
+	Command command;
+	command.type = COMMAND_LOAD;
+	Load* load = &command.load;
+	load->handle = nextHandle;
+	strcpy(load->path, streamRequest->path);
+	load->offset = streamRequest->offset;
+	load->size = streamRequest->size;
+	load->destination = streamRequest->destination;
+	load->capacity = streamRequest->capacity;
+	load->priority = streamRequest->priority;
+	load->callback = streamRequest->callback;
+	load->userData = streamRequest->userData;
+	load->requestTime = sceKernelGetProcessTimeWide();
+	if (!pushCommand(&command))
+	{
+		vitaPrintf("ERROR: stream queue is full, %s was not requested\n", streamRequest->path);
+		return STREAM_HANDLE_INVALID;
+	}
+
+	nextHandle = (nextHandle == 0x7FFFFFFF) ? 0 : nextHandle + 1;
+	stats.requested++;
+	unsigned int depth = stats.requested - stats.completed - stats.failed - stats.cancelled;
+	if (depth > stats.queueDepthPeak)
+		stats.queueDepthPeak = depth;
+	return load->handle;
+}
+
+void StreamLoader::setPriority(StreamHandle handle, float priority)
+{
+	Command command;
+	command.type = COMMAND_PRIORITY;
+	command.load.handle = handle;
+	command.load.priority = priority;
+	pushCommand(&command);
+}
+
+void StreamLoader::cancel(StreamHandle handle)
+{
+	Command command;
+	command.type = COMMAND_CANCEL;
+	command.load.handle = handle;
+	pushCommand(&command);
+}
+
+void StreamLoader::update()
+{
+	while (completionRead != completionWrite)
+	{
+		//read the index before the slot it publishes
+		__sync_synchronize();
+		Completion* completion = &_completions[completionRead % STREAM_QUEUE_SIZE];
+		StreamResult result = completion->result;
+		StreamCallback callback = completion->callback;
+		result.latency = sceKernelGetProcessTimeWide() - completion->requestTime;
+		//hand the slot back before the callback runs, so it can request more
+		__sync_synchronize();
+		completionRead++;
+
+		switch (result.status)
+		{
+		case STREAM_DONE:
+			stats.completed++;
+			stats.bytesLoaded += result.size;
+			break;
+		case STREAM_FAILED:
+			stats.failed++;
+			vitaPrintf("ERROR: stream load %d failed\n", result.handle);
+			break;
+		default:
+			stats.cancelled++;
+			break;
+		}
+		stats.latencyTotal += result.latency;
+		if (result.latency > stats.latencyMax)
+			stats.latencyMax = result.latency;
+
+		callback(&result);
+	}
+}
+
+void StreamLoader::finishAll()
+{
+	for (;;)
+	{
+		update();
+		if (stats.requested == stats.completed + stats.failed + stats.cancelled)
+			return;
+		sceKernelDelayThread(STREAM_FULL_WAIT);
+	}
+}
+
+void StreamLoader::getStats(StreamStats* streamStats)
+{
+	*streamStats = stats;
+	streamStats->queueDepth = stats.requested - stats.completed - stats.failed - stats.cancelled;
+	//written by the loader thread, a value that is one request behind is fine for stats
+	streamStats->bytesRead = bytesRead;
+	streamStats->readAheadBytes = readAheadBytes;
+	streamStats->busyTime = busyTime;
+	streamStats->decompressTime = decompressTime;
+}
+
+void StreamLoader::logStats()
+{
+	StreamStats current;
+	getStats(&current);
+	unsigned int finished = current.completed + current.failed + current.cancelled;
+
+	vitaPrintf("\nStreaming: %u requested, %u completed, %u failed, %u cancelled, queue depth %u (peak %u)\n", current.requested,
+		current.completed, current.failed, current.cancelled, current.queueDepth, current.queueDepthPeak);
+	vitaPrintf("Read %.2fMB (%.2fMB more from read-ahead), loaded %.2fMB, %.2fMB/s read and %.2fMB/s loaded while busy\n",
+		current.bytesRead / (1024.0 * 1024.0), current.readAheadBytes / (1024.0 * 1024.0), current.bytesLoaded / (1024.0 * 1024.0),
+		(current.busyTime > 0) ? (current.bytesRead / (1024.0 * 1024.0)) / (current.busyTime / 1000000.0) : 0.0,
+		(current.busyTime > 0) ? (current.bytesLoaded / (1024.0 * 1024.0)) / (current.busyTime / 1000000.0) : 0.0);
+	vitaPrintf("Busy %.2fms, %.2fms of it decompressing, latency average %.2fms, max %.2fms\n", current.busyTime / 1000.0,
+		current.decompressTime / 1000.0, (finished > 0) ? current.latencyTotal / 1000.0 / finished : 0.0, current.latencyMax / 1000.0);
+}
+
+/*----- Loader thread -----*/
+
+int StreamLoader::loaderThread(SceSize args, void* argp)
+{
+	(void)args;
+	//argp points at a copy of the pointer passed to sceKernelStartThread()
+	StreamLoader* self = *(StreamLoader**)argp;
+
+	while (self->running)
+	{
+		self->drainCommands();
+		if (self->_queue.empty())
+		{
+			//don't hold on to a file while idle, it may be replaced or the card removed
+			self->closeFile();
+			sceKernelWaitSema(self->wakeSemaUID, 1, NULL);
+			continue;
+		}
+
+		std::pop_heap(self->_queue.begin(), self->_queue.end(), loadsLater);
+		Load load = self->_queue.back();
+		self->_queue.pop_back();
+		self->process(&load);
+	}
+
+	return 0;
+}
+
+void StreamLoader::drainCommands()
+{
+	while (commandRead != commandWrite)
+	{
+		__sync_synchronize();
+		const Command* command = &_commands[commandRead % STREAM_QUEUE_SIZE];
+		StreamHandle handle = command->load.handle;
+
+		if (command->type == COMMAND_LOAD)
+		{
+			_queue.push_back(command->load);
+			std::push_heap(_queue.begin(), _queue.end(), loadsLater);
+		}
+		else
+		{
+			std::vector<Load>::iterator found = _queue.begin();
+			while (found != _queue.end() && found->handle != handle)
+				found++;
+
+			if (found == _queue.end())
+			{
+				//may be the one being loaded right now, it is dropped at the next chunk
+				if (command->type == COMMAND_CANCEL)
+					cancelledHandle = handle;
+			}
+			else if (command->type == COMMAND_PRIORITY)
+			{
+				found->priority = command->load.priority;
+				std::make_heap(_queue.begin(), _queue.end(), loadsLater);
+			}
+			else
+			{
+				Load cancelled = *found;
+				_queue.erase(found);
+				std::make_heap(_queue.begin(), _queue.end(), loadsLater);
+				complete(&cancelled, STREAM_CANCELLED, nullptr, 0, false);
+			}
+		}
+
+		//done with the slot, and with the semaphore count the command added
+		__sync_synchronize();
+		commandRead++;
+		sceKernelPollSema(wakeSemaUID, 1);
+	}
+}
+
+void StreamLoader::complete(const Load* load, StreamStatus status, void* data, SceSize size, bool ownsData)
+{
+	//the render thread is behind on update(), wait for it rather than drop a load
+	while (completionWrite - completionRead >= STREAM_QUEUE_SIZE && running)
+		sceKernelDelayThread(STREAM_FULL_WAIT);
+
+	Completion* completion = &_completions[completionWrite % STREAM_QUEUE_SIZE];
+	completion->result.handle = load->handle;
+	completion->result.status = status;
+	completion->result.data = data;
+	completion->result.size = size;
+	completion->result.userData = load->userData;
+	completion->result.latency = 0;
+	completion->callback = load->callback;
+	completion->requestTime = load->requestTime;
+	completion->ownsData = ownsData;
+	__sync_synchronize();
+	completionWrite++;
+}
+
+void StreamLoader::process(Load* load)
+{
+	SceUInt64 startTime = sceKernelGetProcessTimeWide();
+	cancelledHandle = STREAM_HANDLE_INVALID;
+
+	void* data = nullptr;
+	SceSize size = 0;
+	bool ownsData = false;
+	bool loaded = openFile(load->path);
+	if (loaded)
+	{
+		//whole files get checked for compression, ranges are always taken as they are
+		StreamFileHeader header;
+		if (load->size == 0 && fileSize >= (SceOff)sizeof(header) && readAt(0, &header, sizeof(header)) && header.magic == STREAM_MAGIC)
+		{
+			loaded = loadCompressed(load, &data, &size, &ownsData);
+		}
+		else
+		{
+			size = (load->size == 0) ? (SceSize)(fileSize - load->offset) : load->size;
+			loaded = load->offset >= 0 && load->offset + size <= fileSize;
+			if (loaded && load->destination == nullptr)
+			{
+				data = malloc(size);
+				ownsData = (data != nullptr);
+				loaded = ownsData;
+			}
+			else if (loaded)
+			{
+				data = load->destination;
+				loaded = size <= load->capacity;
+			}
+			if (loaded)
+				loaded = readAt(load->offset, data, size);
+		}
+	}
+	busyTime += sceKernelGetProcessTimeWide() - startTime;
+
+	drainCommands();
+	StreamStatus status = (cancelledHandle == load->handle) ? STREAM_CANCELLED : (loaded ? STREAM_DONE : STREAM_FAILED);
+	if (status != STREAM_DONE && ownsData)
+	{
+		free(data);
+		data = nullptr;
+		ownsData = false;
+	}
+	complete(load, status, data, (status == STREAM_DONE) ? size : 0, ownsData);
+}
+
+bool StreamLoader::loadCompressed(Load* load, void** data, SceSize* size, bool* ownsData)
+{
+	StreamFileHeader header;
+	if (!readAt(0, &header, sizeof(header)))
+		return false;
+	uint32_t expectedChunks = (header.chunkSize > 0) ? (header.uncompressedSize + header.chunkSize - 1) / header.chunkSize : 0;
+	if (header.version != STREAM_VERSION || header.chunkSize == 0 || header.chunkSize > STREAM_CHUNK_SIZE || header.chunkCount != expectedChunks)
+		return false;
+
+	std::vector<uint32_t> chunkSizes(header.chunkCount);
+	SceOff offset = sizeof(header);
+	if (header.chunkCount > 0 && !readAt(offset, &chunkSizes[0], header.chunkCount * sizeof(uint32_t)))
+		return false;
+	offset += header.chunkCount * sizeof(uint32_t);
+
+	unsigned char* out = (unsigned char*)load->destination;
+	if (out == nullptr)
+	{
+		//one extra byte so a zero length file still gets a pointer the callback can free()
+		out = (unsigned char*)malloc(header.uncompressedSize + 1);
+		if (out == nullptr)
+			return false;
+		*ownsData = true;
+	}
+	else if (header.uncompressedSize > load->capacity)
+		return false;
+	*data = out;
+	*size = header.uncompressedSize;
+
+	SceSize remaining = header.uncompressedSize;
+	for (uint32_t i = 0; i < header.chunkCount; i++)
+	{
+		SceSize expected = (remaining < header.chunkSize) ? remaining : header.chunkSize;
+		SceSize stored = chunkSizes[i] & ~STREAM_CHUNK_STORED;
+		if (chunkSizes[i] & STREAM_CHUNK_STORED)
+		{
+			if (stored != expected || !readAt(offset, out, stored))
+				return false;
+		}
+		else
+		{
+			if (stored > STREAM_COMPRESS_BOUND(STREAM_CHUNK_SIZE) || !readAt(offset, chunk_ptr, stored))
+				return false;
+			SceUInt64 decompressStart = sceKernelGetProcessTimeWide();
+			int decompressed = lz4Decompress(chunk_ptr, stored, out, expected);
+			decompressTime += sceKernelGetProcessTimeWide() - decompressStart;
+			if (decompressed != (int)expected)
+				return false;
+		}
+		offset += stored;
+		out += expected;
+		remaining -= expected;
+
+		//a chunk is the most a cancel or a more urgent request has to wait
+		drainCommands();
+		if (cancelledHandle == load->handle)
+			return false;
+	}
+	return true;
+}
+
+/*----- Loader thread file access -----*/
+
+bool StreamLoader::openFile(const char* path)
+{
+	if (fd >= 0 && strcmp(openPath, path) == 0)
+		return true;
+
+	closeFile();
+	fd = sceIoOpen(path, SCE_O_RDONLY, 0);
+	if (fd < 0)
+		return false;
+	strcpy(openPath, path);
+	fileSize = sceIoLseek(fd, 0, SCE_SEEK_END);
+	return true;
+}
+
+void StreamLoader::closeFile()
+{
+	if (fd >= 0)
+		sceIoClose(fd);
+	fd = -1;
+	openPath[0] = '\0';
+	fileSize = 0;
+	readAheadOffset = 0;
+	readAheadFill = 0;
+}
+
+bool StreamLoader::readAt(SceOff offset, void* destination, SceSize size)
+{
+	unsigned char* out = (unsigned char*)destination;
+	if (offset < 0 || offset + size > fileSize)
+		return false;
+
+	while (size > 0)
+	{
+		//whatever an earlier read brought in already is copied from the buffer
+		bool buffered = offset >= readAheadOffset && offset < readAheadOffset + readAheadFill;
+		if (!buffered)
+		{
+			sceIoLseek(fd, offset, SCE_SEEK_SET);
+			//big reads go straight to the destination, buffering them would only add a copy
+			if (size >= STREAM_READ_AHEAD)
+			{
+				if (!readFully(fd, out, size))
+					return false;
+				bytesRead += size;
+				return true;
+			}
+
+			SceOff left = fileSize - offset;
+			SceSize fill = (left < STREAM_READ_AHEAD) ? (SceSize)left : STREAM_READ_AHEAD;
+			readAheadFill = 0;
+			if (!readFully(fd, readAhead_ptr, fill))
+				return false;
+			bytesRead += fill;
+			readAheadOffset = offset;
+			readAheadFill = fill;
+		}
+
+		SceSize available = (SceSize)(readAheadOffset + readAheadFill - offset);
+		SceSize count = (size < available) ? size : available;
+		memcpy(out, readAhead_ptr + (offset - readAheadOffset), count);
+		if (buffered)
+			readAheadBytes += count;
+		out += count;
+		offset += count;
+		size -= count;
+	}
+	return true;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+//----------------------------------------------
+// StreamLoader Class
+// Loads files on its own thread while the render thread keeps drawing.
+// Requests go into a priority queue (lower priority values load sooner, a distance to
+// the camera works), the loader reads through a large read-ahead buffer so small
+// requests from the same file cost one read, and whole .lzs files (see StreamFormat.h)
+// are decompressed on the loader thread too.
+// The two threads only talk through single producer single consumer rings: commands go
+// in one, finished loads come back in the other and their callbacks run on the render
+// thread from update(). Neither side ever takes a lock or waits for the other
+//-----------------------------------------------
+
+#include <vector>
+
+#include <psp2/types.h>
+
+#include "StreamFormat.h"
+
+//Commands and results in flight, each ring holds this many. Must be a power of two
+#define STREAM_QUEUE_SIZE			256
+//Bytes read at a time when a request is smaller than this, the rest stays around for the next one
+#define STREAM_READ_AHEAD			(256 * 1024)
+#define STREAM_PATH_LENGTH			128
+
+typedef int StreamHandle;
+#define STREAM_HANDLE_INVALID		-1
+
+typedef enum StreamStatus
+{
+	STREAM_DONE = 0,
+	STREAM_FAILED,			//couldn't be opened, read or decompressed, or didn't fit in the destination
+	STREAM_CANCELLED
+} StreamStatus;
+
+typedef struct StreamResult
+{
+	StreamHandle handle;
+	StreamStatus status;
+	void* data;				//the destination, or a malloc() the callback now owns when there wasn't one
+	SceSize size;			//bytes loaded, after decompression
+	void* userData;
+	SceUInt64 latency;		//microseconds from request() to the callback
+} StreamResult;
+
+//Called on the render thread from update()
+typedef void (*StreamCallback)(const StreamResult* result);
+
+typedef struct StreamRequest
+{
+	const char* path;			//copied, at most STREAM_PATH_LENGTH - 1 characters
+	SceOff offset;				//where the data starts in the file
+	SceSize size;				//bytes to read, 0 loads the whole file and decompresses it if it is a .lzs
+	void* destination;			//where the data goes, nullptr to have it malloc()ed
+	SceSize capacity;			//bytes destination can hold
+	float priority;				//lower loads sooner
+	StreamCallback callback;
+	void* userData;
+} StreamRequest;
+
+typedef struct StreamStats
+{
+	unsigned int requested;
+	unsigned int completed;
+	unsigned int failed;
+	unsigned int cancelled;
+	unsigned int queueDepth;		//requested and not yet handed back
+	unsigned int queueDepthPeak;
+	SceUInt64 bytesRead;			//from storage, compressed
+	SceUInt64 bytesLoaded;			//handed back, decompressed
+	SceUInt64 readAheadBytes;		//served from the read-ahead buffer instead of storage
+	SceUInt64 busyTime;				//microseconds the loader spent on requests
+	SceUInt64 decompressTime;		//microseconds of busyTime spent decompressing
+	SceUInt64 latencyTotal;			//microseconds, request() to callback
+	SceUInt64 latencyMax;
+} StreamStats;
+
+//C++ singleton StreamLoader class
+class StreamLoader
+{
+protected:
+	StreamLoader();
+	StreamLoader(StreamLoader const&);
+	void operator=(StreamLoader const&);
+public:
+	~StreamLoader();
+	static StreamLoader* getInstance();
+
+	//Starts the loader thread
+	void init();
+	//Stops the loader thread, anything not yet handed back is dropped without its callback
+	void shutdown();
+	bool isRunning();
+
+	/*----- Render thread -----*/
+	//Queues a load, returns STREAM_HANDLE_INVALID if the queue is full
+	StreamHandle request(const StreamRequest* streamRequest);
+	//Changes the priority of a load that hasn't started yet
+	void setPriority(StreamHandle handle, float priority);
+	//The callback still runs, with STREAM_CANCELLED, unless the load already finished
+	void cancel(StreamHandle handle);
+	//Runs the callbacks of every finished load, call once per frame
+	void update();
+	//Blocks until every queued load has been handed back, for shutting down or loading screens
+	void finishAll();
+
+	void getStats(StreamStats* stats);
+	void logStats();
+
+private:
+	typedef enum CommandType
+	{
+		COMMAND_LOAD = 0,
+		COMMAND_PRIORITY,
+		COMMAND_CANCEL
+	} CommandType;
+
+	typedef struct Load
+	{
+		StreamHandle handle;
+		char path[STREAM_PATH_LENGTH];
+		SceOff offset;
+		SceSize size;
+		void* destination;
+		SceSize capacity;
+		float priority;
+		StreamCallback callback;
+		void* userData;
+		SceUInt64 requestTime;
+	} Load;
+
+	typedef struct Command
+	{
+		CommandType type;
+		Load load;					//the whole load for COMMAND_LOAD, handle and priority otherwise
+	} Command;
+
+	typedef struct Completion
+	{
+		StreamResult result;
+		StreamCallback callback;
+		SceUInt64 requestTime;
+		bool ownsData;				//data was malloc()ed by the loader
+	} Completion;
+
+	static int loaderThread(SceSize args, void* argp);
+	//orders the heap so the front is the load that should go next
+	static bool loadsLater(const Load& a, const Load& b);
+	void drainCommands();
+	void process(Load* load);
+	void complete(const Load* load, StreamStatus status, void* data, SceSize size, bool ownsData);
+	bool pushCommand(const Command* command);
+
+	/* Loader thread file access */
+	bool openFile(const char* path);
+	void closeFile();
+	//Reads size bytes at offset, through the read-ahead buffer when they are small enough
+	bool readAt(SceOff offset, void* destination, SceSize size);
+	bool loadCompressed(Load* load, void** data, SceSize* size, bool* ownsData);
+
+	/* Shared between the threads */
+	//render thread to loader thread
+	Command _commands[STREAM_QUEUE_SIZE];
+	volatile unsigned int commandWrite;
+	volatile unsigned int commandRead;
+	//loader thread to render thread
+	Completion _completions[STREAM_QUEUE_SIZE];
+	volatile unsigned int completionWrite;
+	volatile unsigned int completionRead;
+	//counted by the loader thread, only ever read by the render thread
+	volatile SceUInt64 bytesRead;
+	volatile SceUInt64 readAheadBytes;
+	volatile SceUInt64 busyTime;
+	volatile SceUInt64 decompressTime;
+	volatile bool running;
+	SceUID loaderThreadUID;
+	SceUID wakeSemaUID;
+
+	/* Render thread only */
+	StreamStats stats;
+	StreamHandle nextHandle;
+
+	/* Loader thread only */
+	//a binary heap ordered by priority, then by handle so equal priorities load in order
+	std::vector<Load> _queue;
+	//set when the load in progress gets cancelled
+	StreamHandle cancelledHandle;
+	char openPath[STREAM_PATH_LENGTH];
+	SceUID fd;
+	SceOff fileSize;
+	unsigned char* readAhead_ptr;
+	SceOff readAheadOffset;
+	SceSize readAheadFill;
+	//one compressed chunk at a time
+	unsigned char* chunk_ptr;
+};
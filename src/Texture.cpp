@@ -0,0 +1,199 @@
+#include "Texture.h"
+#include "Graphics.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <assert.h>
+
+#include <psp2/kernel/processmgr.h>
+
+static const SceGxmTextureFormat _gxmFormats[NUMBER_OF_TEXTURE_FILE_FORMATS] = {
+	SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR,
+	SCE_GXM_TEXTURE_FORMAT_U5U6U5_BGR,
+	SCE_GXM_TEXTURE_FORMAT_U4U4U4U4_ABGR,
+	SCE_GXM_TEXTURE_FORMAT_UBC1_ABGR,
+	SCE_GXM_TEXTURE_FORMAT_UBC3_ABGR
+};
+
+Texture::Texture()
+{
+	memset(&gxmTexture, 0, sizeof(gxmTexture));
+	memset(&header, 0, sizeof(header));
+	loaded = false;
+}
+
+Texture::~Texture()
+{
+	unload();
+}
+
+bool Texture::validateHeader(const TextureHeader* fileHeader, SceSize fileSize)
+{
+	if (fileHeader->magic != TEXTURE_MAGIC || fileHeader->version != TEXTURE_VERSION)
+	{
+		vitaPrintf("ERROR: not a version %u texture file (magic 0x%08X, version %u)\n", TEXTURE_VERSION, fileHeader->magic, fileHeader->version);
+		return false;
+	}
+	if (fileHeader->fileSize != fileSize || fileHeader->dataOffset < sizeof(TextureHeader) ||
+		fileHeader->dataOffset % TEXTURE_DATA_ALIGNMENT != 0 || fileHeader->dataOffset + fileHeader->dataSize > fileSize)
+	{
+		vitaPrintf("ERROR: texture file is %u bytes, the header says %u with data at %u+%u\n", fileSize, fileHeader->fileSize,
+			fileHeader->dataOffset, fileHeader->dataSize);
+		return false;
+	}
+	if (fileHeader->format >= NUMBER_OF_TEXTURE_FILE_FORMATS || fileHeader->mipCount == 0 || fileHeader->mipCount > TEXTURE_MAX_MIPS ||
+		fileHeader->width == 0 || fileHeader->width > TEXTURE_MAX_SIZE || fileHeader->height == 0 || fileHeader->height > TEXTURE_MAX_SIZE)
+	{
+		vitaPrintf("ERROR: texture is %ux%u, format %u with %u mip levels\n", fileHeader->width, fileHeader->height,
+			fileHeader->format, fileHeader->mipCount);
+		return false;
+	}
+
+	//swizzling only works on power of two sizes
+	bool powerOfTwo = (fileHeader->width & (fileHeader->width - 1)) == 0 && (fileHeader->height & (fileHeader->height - 1)) == 0;
+	if (fileHeader->layout == TEXTURE_LAYOUT_SWIZZLED && !powerOfTwo)
+	{
+		vitaPrintf("ERROR: swizzled texture is %ux%u, not a power of two\n", fileHeader->width, fileHeader->height);
+		return false;
+	}
+
+	//every level has to be where the size rules put it
+	uint32_t offset = 0;
+	uint32_t width = fileHeader->width;
+	uint32_t height = fileHeader->height;
+	for (unsigned int level = 0; level < fileHeader->mipCount; level++)
+	{
+		if (fileHeader->_levelOffsets[level] != offset)
+		{
+			vitaPrintf("ERROR: texture mip level %u is at %u, expected %u\n", level, fileHeader->_levelOffsets[level], offset);
+			return false;
+		}
+		offset += textureLevelSize(fileHeader->format, fileHeader->layout, width, height);
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+	}
+	if (offset != fileHeader->dataSize)
+	{
+		vitaPrintf("ERROR: texture mip levels add up to %u bytes, the header says %u\n", offset, fileHeader->dataSize);
+		return false;
+	}
+	return true;
+}
+
+bool Texture::readHeader(SceUID fd, TextureHeader* fileHeader)
+{
+	SceSize fileSize = (SceSize)sceIoLseek(fd, 0, SCE_SEEK_END);
+	sceIoLseek(fd, 0, SCE_SEEK_SET);
+	if (!readFully(fd, fileHeader, sizeof(TextureHeader)) || !validateHeader(fileHeader, fileSize))
+		return false;
+	sceIoLseek(fd, fileHeader->dataOffset, SCE_SEEK_SET);
+	return true;
+}
+
+bool Texture::load(const char* path, const TextureSampler* sampler, SceKernelMemBlockType memoryType)
+{
+	vitaPrintf("\nLoading texture: %s\n", path);
+	unload();
+	SceUInt64 startTime = sceKernelGetProcessTimeWide();
+
+	SceUID fd = sceIoOpen(path, SCE_O_RDONLY, 0);
+	if (fd < 0)
+	{
+		vitaPrintf("sceIoOpen() result: 0x%08X\n", fd);
+		return false;
+	}
+	TextureHeader fileHeader;
+	if (!readHeader(fd, &fileHeader))
+	{
+		sceIoClose(fd);
+		return false;
+	}
+
+	SceUID uid = -1;
+	void* texels_ptr = Graphics::getInstance()->allocGraphicsMem(
+		memoryType,
+		fileHeader.dataSize,
+		SCE_GXM_TEXTURE_ALIGNMENT,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		&uid,
+		"texture",
+		MEMORY_CATEGORY_TEXTURES
+	);
+	texels = GpuBuffer(texels_ptr, uid);
+	bool read = readFully(fd, texels_ptr, fileHeader.dataSize);
+	sceIoClose(fd);
+	if (!read)
+	{
+		vitaPrintf("ERROR: could not read the texture data\n");
+		unload();
+		return false;
+	}
+
+	if (!initFromMemory(&fileHeader, texels_ptr, sampler))
+	{
+		unload();
+		return false;
+	}
+	vitaPrintf("Loaded %ux%u texture, format %u, %u mip levels, %u bytes in %.2fms\n", header.width, header.height,
+		header.format, header.mipCount, header.dataSize, (sceKernelGetProcessTimeWide() - startTime) / 1000.0);
+	return true;
+}
+
+bool Texture::initFromMemory(const TextureHeader* fileHeader, const void* data, const TextureSampler* sampler)
+{
+	int error = 0;
+	if (fileHeader->layout == TEXTURE_LAYOUT_LINEAR)
+		error = sceGxmTextureInitLinear(&gxmTexture, data, _gxmFormats[fileHeader->format], fileHeader->width, fileHeader->height, fileHeader->mipCount);
+	else
+		error = sceGxmTextureInitSwizzled(&gxmTexture, data, _gxmFormats[fileHeader->format], fileHeader->width, fileHeader->height, fileHeader->mipCount);
+	if (error != 0)
+	{
+		vitaPrintf("sceGxmTextureInit() result: 0x%08X\n", error);
+		return false;
+	}
+
+	header = *fileHeader;
+	loaded = true;
+	setSampler(sampler);
+	return true;
+}
+
+void Texture::unload()
+{
+	texels.reset();
+	memset(&gxmTexture, 0, sizeof(gxmTexture));
+	memset(&header, 0, sizeof(header));
+	loaded = false;
+}
+
+bool Texture::isLoaded()
+{
+	return loaded;
+}
+
+void Texture::setSampler(const TextureSampler* sampler)
+{
+	sceGxmTextureSetMinFilter(&gxmTexture, sampler->minFilter);
+	sceGxmTextureSetMagFilter(&gxmTexture, sampler->magFilter);
+	//mip filtering a texture with one level reads memory that isn't there
+	sceGxmTextureSetMipFilter(&gxmTexture, (header.mipCount > 1) ? sampler->mipFilter : SCE_GXM_TEXTURE_MIP_FILTER_DISABLED);
+	sceGxmTextureSetUAddrMode(&gxmTexture, sampler->addressU);
+	sceGxmTextureSetVAddrMode(&gxmTexture, sampler->addressV);
+	sceGxmTextureSetLodBias(&gxmTexture, sampler->lodBias);
+}
+
+void Texture::bind(unsigned int unit)
+{
+	assert(loaded);
+	Graphics::getInstance()->setFragmentTexture(unit, &gxmTexture);
+}
+
+const SceGxmTexture* Texture::getGxmTexture()
+{
+	return &gxmTexture;
+}
+
+const TextureHeader* Texture::getHeader()
+{
+	return &header;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+//----------------------------------------------
+// Texture Class
+// Loads a .tex file (see TextureFormat.h) made by tools/texconv. The texels are
+// already swizzled or block compressed with all their mipmaps, so they are read
+// straight into GPU memory and handed to sceGxmTextureInit* as they are.
+// A texture either owns its memblock (load) or points into memory someone else
+// manages (initFromMemory, which is what TextureCache uses)
+//-----------------------------------------------
+
+#include <psp2/kernel/sysmem.h>
+#include <psp2/gxm.h>
+
+#include "TextureFormat.h"
+#include "GpuHandle.h"
+
+//Sampler state, libgxm keeps it inside the SceGxmTexture so it belongs to the texture
+typedef struct TextureSampler
+{
+	SceGxmTextureFilter minFilter;
+	SceGxmTextureFilter magFilter;
+	SceGxmTextureMipFilter mipFilter;	//ignored for textures without mipmaps
+	SceGxmTextureAddrMode addressU;
+	SceGxmTextureAddrMode addressV;
+	unsigned int lodBias;				//in 1/8ths of a level, 31 is no bias
+} TextureSampler;
+
+//the default sampler, trilinear and repeating
+static const TextureSampler defaultSampler = {
+	SCE_GXM_TEXTURE_FILTER_LINEAR,		//min filter
+	SCE_GXM_TEXTURE_FILTER_LINEAR,		//mag filter
+	SCE_GXM_TEXTURE_MIP_FILTER_ENABLED,	//mip filter
+	SCE_GXM_TEXTURE_ADDR_REPEAT,		//address U
+	SCE_GXM_TEXTURE_ADDR_REPEAT,		//address V
+	31									//LOD bias
+};
+
+class Texture
+{
+public:
+	Texture();
+	~Texture();
+
+	//Reads the file at path into its own memblock of the given type
+	bool load(const char* path, const TextureSampler* sampler = &defaultSampler, SceKernelMemBlockType memoryType = SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW);
+	//Uses texel data already in GPU mapped memory laid out as fileHeader describes, the memory stays the caller's
+	bool initFromMemory(const TextureHeader* fileHeader, const void* data, const TextureSampler* sampler = &defaultSampler);
+	//Its own memblock goes to Graphics' release queue, frames already submitted can still sample it
+	void unload();
+	bool isLoaded();
+
+	void setSampler(const TextureSampler* sampler);
+	//Binds the texture to a fragment texture unit for the following draws
+	void bind(unsigned int unit);
+
+	const SceGxmTexture* getGxmTexture();
+	const TextureHeader* getHeader();
+
+	//Reads and checks a .tex header, the file is left positioned at the start of the texel data
+	static bool readHeader(SceUID fd, TextureHeader* fileHeader);
+	static bool validateHeader(const TextureHeader* fileHeader, SceSize fileSize);
+
+private:
+	SceGxmTexture gxmTexture;
+	TextureHeader header;
+	bool loaded;
+	//the memblock holding the texels, empty when they live in someone else's memory
+	GpuBuffer texels;
+};
@@ -0,0 +1,380 @@
+#include "TextureCache.h"
+#include "Graphics.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <assert.h>
+
+#include <psp2/kernel/processmgr.h>
+
+TextureCache::TextureCache()
+{
+	memset(&stats, 0, sizeof(stats));
+	initialized = false;
+	memory_ptr = nullptr;
+	frameDoneNotification_ptr = nullptr;
+	currentFrame = 1;
+	texturesUsedThisFrame = 0;
+	bytesUsedThisFrame = 0;
+}
+
+TextureCache::~TextureCache()
+{
+	shutdown();
+}
+
+void TextureCache::init(SceSize budget, volatile unsigned int* frameDoneNotification)
+{
+	vitaPrintf("\nStarting texture cache, %u bytes of CDRAM\n", budget);
+	assert(!initialized && budget > 0);
+
+	SceUID uid = -1;
+	memory_ptr = Graphics::getInstance()->allocGraphicsMem(
+		SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW,
+		budget,
+		SCE_GXM_TEXTURE_ALIGNMENT,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		&uid,
+		"texture_cache",
+		MEMORY_CATEGORY_TEXTURES
+	);
+	memory = GpuBuffer(memory_ptr, uid);
+	frameDoneNotification_ptr = frameDoneNotification;
+
+	memset(&stats, 0, sizeof(stats));
+	stats.budget = budget;
+	currentFrame = 1;
+	texturesUsedThisFrame = 0;
+	bytesUsedThisFrame = 0;
+
+	FreeBlock all = { 0, budget };
+	_freeBlocks.clear();
+	_freeBlocks.push_back(all);
+	initialized = true;
+}
+
+void TextureCache::shutdown()
+{
+	if (!initialized)
+		return;
+
+	vitaPrintf("\nShutting down texture cache\n");
+	//the loader thread may still be writing into the memblock
+	if (stats.streaming > 0)
+		StreamLoader::getInstance()->finishAll();
+	logStats();
+
+	for (unsigned int i = 0; i < _entries.size(); i++)
+		delete _entries[i];
+	_entries.clear();
+	_freeBlocks.clear();
+
+	memory.reset();
+	memory_ptr = nullptr;
+	initialized = false;
+}
+
+bool TextureCache::isInitialized()
+{
+	return initialized;
+}
+
+TextureHandle TextureCache::add(const char* path, const TextureSampler* sampler)
+{
+	assert(initialized);
+
+	SceUID fd = sceIoOpen(path, SCE_O_RDONLY, 0);
+	if (fd < 0)
+	{
+		vitaPrintf("sceIoOpen() result: 0x%08X (%s)\n", fd, path);
+		return TEXTURE_HANDLE_INVALID;
+	}
+	TextureHeader header;
+	bool valid = Texture::readHeader(fd, &header);
+	sceIoClose(fd);
+	if (!valid)
+	{
+		vitaPrintf("ERROR: %s is not a usable texture\n", path);
+		return TEXTURE_HANDLE_INVALID;
+	}
+	if (ALIGN_MEM(header.dataSize, SCE_GXM_TEXTURE_ALIGNMENT) > stats.budget)
+	{
+		vitaPrintf("ERROR: %s needs %u bytes, the texture cache only has %u\n", path, header.dataSize, stats.budget);
+		return TEXTURE_HANDLE_INVALID;
+	}
+
+	CacheEntry* entry = new CacheEntry();
+	entry->path = path;
+	entry->header = header;
+	entry->sampler = *sampler;
+	entry->resident = false;
+	entry->streaming = false;
+	entry->stream = STREAM_HANDLE_INVALID;
+	entry->priority = 0.0f;
+	entry->cache = this;
+	entry->offset = 0;
+	entry->size = ALIGN_MEM(header.dataSize, SCE_GXM_TEXTURE_ALIGNMENT);
+	entry->lastUsedFrame = 0;
+	_entries.push_back(entry);
+	stats.textures++;
+	return (TextureHandle)(_entries.size() - 1);
+}
+
+const SceGxmTexture* TextureCache::acquire(TextureHandle handle, float priority)
+{
+	assert(handle >= 0 && (unsigned int)handle < _entries.size());
+	CacheEntry* entry = _entries[handle];
+
+	if (entry->lastUsedFrame != currentFrame)
+	{
+		texturesUsedThisFrame++;
+		bytesUsedThisFrame += entry->size;
+	}
+	entry->lastUsedFrame = currentFrame;
+
+	if (entry->resident)
+	{
+		stats.hits++;
+		return entry->texture.getGxmTexture();
+	}
+	if (entry->streaming)
+	{
+		//still on its way, it may have become more or less urgent since it was asked for
+		if (priority != entry->priority)
+		{
+			entry->priority = priority;
+			StreamLoader::getInstance()->setPriority(entry->stream, priority);
+		}
+		return nullptr;
+	}
+
+	stats.misses++;
+	entry->priority = priority;
+	if (StreamLoader::getInstance()->isRunning())
+	{
+		if (!startStream(entry))
+			stats.failedLoads++;
+		return nullptr;
+	}
+	if (!load(entry))
+	{
+		stats.failedLoads++;
+		return nullptr;
+	}
+	return entry->texture.getGxmTexture();
+}
+
+bool TextureCache::bind(TextureHandle handle, unsigned int unit, float priority)
+{
+	const SceGxmTexture* texture = acquire(handle, priority);
+	if (!texture)
+		return false;
+	Graphics::getInstance()->setFragmentTexture(unit, texture);
+	return true;
+}
+
+bool TextureCache::isResident(TextureHandle handle)
+{
+	assert(handle >= 0 && (unsigned int)handle < _entries.size());
+	return _entries[handle]->resident;
+}
+
+void TextureCache::beginFrame(unsigned int nextFrameIndex)
+{
+	stats.texturesUsedLastFrame = texturesUsedThisFrame;
+	stats.bytesUsedLastFrame = bytesUsedThisFrame;
+	texturesUsedThisFrame = 0;
+	bytesUsedThisFrame = 0;
+	currentFrame = nextFrameIndex;
+}
+
+bool TextureCache::makeRoom(SceSize size, SceSize* offset)
+{
+	//the free list is coalesced so evicting enough neighbours always opens up a big enough block
+	while (!allocate(size, offset))
+	{
+		CacheEntry* victim = findVictim();
+		if (!victim)
+			return false;
+		evict(victim);
+	}
+	return true;
+}
+
+bool TextureCache::load(CacheEntry* entry)
+{
+	SceUInt64 startTime = sceKernelGetProcessTimeWide();
+
+	SceSize offset = 0;
+	if (!makeRoom(entry->size, &offset))
+	{
+		vitaPrintf("ERROR: no room for %s (%u bytes), everything resident is still in use by the GPU\n",
+			entry->path.c_str(), entry->size);
+		return false;
+	}
+
+	//the header was checked by add(), reading it again catches the file changing since
+	void* texels = (uint8_t*)memory_ptr + offset;
+	SceUID fd = sceIoOpen(entry->path.c_str(), SCE_O_RDONLY, 0);
+	TextureHeader fileHeader;
+	bool read = (fd >= 0) && Texture::readHeader(fd, &fileHeader) && fileHeader.dataSize == entry->header.dataSize &&
+		readFully(fd, texels, entry->header.dataSize);
+	if (fd >= 0)
+		sceIoClose(fd);
+	if (!read || !entry->texture.initFromMemory(&entry->header, texels, &entry->sampler))
+	{
+		vitaPrintf("ERROR: could not load %s into the texture cache\n", entry->path.c_str());
+		release(offset, entry->size);
+		return false;
+	}
+
+	entry->resident = true;
+	entry->offset = offset;
+	stats.residentTextures++;
+	stats.residentBytes += entry->size;
+	if (stats.residentBytes > stats.residentPeak)
+		stats.residentPeak = stats.residentBytes;
+	stats.bytesLoaded += entry->header.dataSize;
+	stats.loadTimeTotal += sceKernelGetProcessTimeWide() - startTime;
+	return true;
+}
+
+bool TextureCache::startStream(CacheEntry* entry)
+{
+	SceSize offset = 0;
+	if (!makeRoom(entry->size, &offset))
+	{
+		vitaPrintf("ERROR: no room for %s (%u bytes), everything resident is still in use by the GPU\n",
+			entry->path.c_str(), entry->size);
+		return false;
+	}
+
+	//the texels go straight into the reserved block, the header was checked by add()
+	StreamRequest request;
+	request.path = entry->path.c_str();
+	request.offset = entry->header.dataOffset;
+	request.size = entry->header.dataSize;
+	request.destination = (uint8_t*)memory_ptr + offset;
+	request.capacity = entry->size;
+	request.priority = entry->priority;
+	request.callback = &TextureCache::streamLoaded;
+	request.userData = entry;
+	entry->stream = StreamLoader::getInstance()->request(&request);
+	if (entry->stream == STREAM_HANDLE_INVALID)
+	{
+		release(offset, entry->size);
+		return false;
+	}
+
+	entry->streaming = true;
+	entry->offset = offset;
+	stats.streaming++;
+	return true;
+}
+
+void TextureCache::streamLoaded(const StreamResult* result)
+{
+	CacheEntry* entry = (CacheEntry*)result->userData;
+	TextureCache* cache = entry->cache;
+	entry->streaming = false;
+	entry->stream = STREAM_HANDLE_INVALID;
+	cache->stats.streaming--;
+
+	if (result->status != STREAM_DONE || !entry->texture.initFromMemory(&entry->header, result->data, &entry->sampler))
+	{
+		vitaPrintf("ERROR: could not stream %s into the texture cache\n", entry->path.c_str());
+		cache->release(entry->offset, entry->size);
+		cache->stats.failedLoads++;
+		return;
+	}
+
+	entry->resident = true;
+	cache->stats.residentTextures++;
+	cache->stats.residentBytes += entry->size;
+	if (cache->stats.residentBytes > cache->stats.residentPeak)
+		cache->stats.residentPeak = cache->stats.residentBytes;
+	cache->stats.bytesLoaded += entry->header.dataSize;
+	cache->stats.loadTimeTotal += result->latency;
+}
+
+void TextureCache::evict(CacheEntry* entry)
+{
+	assert(entry->resident);
+	entry->texture.unload();
+	release(entry->offset, entry->size);
+	entry->resident = false;
+	stats.residentTextures--;
+	stats.residentBytes -= entry->size;
+	stats.evictions++;
+}
+
+TextureCache::CacheEntry* TextureCache::findVictim()
+{
+	//anything used by a frame the GPU hasn't finished may still be sampled
+	unsigned int completedFrame = *frameDoneNotification_ptr;
+	CacheEntry* victim = nullptr;
+	for (unsigned int i = 0; i < _entries.size(); i++)
+	{
+		CacheEntry* entry = _entries[i];
+		if (!entry->resident || entry->lastUsedFrame > completedFrame)
+			continue;
+		if (!victim || entry->lastUsedFrame < victim->lastUsedFrame)
+			victim = entry;
+	}
+	return victim;
+}
+
+bool TextureCache::allocate(SceSize size, SceSize* offset)
+{
+	for (unsigned int i = 0; i < _freeBlocks.size(); i++)
+	{
+		FreeBlock* block = &_freeBlocks[i];
+		if (block->size < size)
+			continue;
+
+		*offset = block->offset;
+		block->offset += size;
+		block->size -= size;
+		if (block->size == 0)
+			_freeBlocks.erase(_freeBlocks.begin() + i);
+		return true;
+	}
+	return false;
+}
+
+void TextureCache::release(SceSize offset, SceSize size)
+{
+	unsigned int i = 0;
+	while (i < _freeBlocks.size() && _freeBlocks[i].offset < offset)
+		i++;
+
+	FreeBlock block = { offset, size };
+	_freeBlocks.insert(_freeBlocks.begin() + i, block);
+
+	//merge with the block after, then the one before
+	if (i + 1 < _freeBlocks.size() && _freeBlocks[i].offset + _freeBlocks[i].size == _freeBlocks[i + 1].offset)
+	{
+		_freeBlocks[i].size += _freeBlocks[i + 1].size;
+		_freeBlocks.erase(_freeBlocks.begin() + i + 1);
+	}
+	if (i > 0 && _freeBlocks[i - 1].offset + _freeBlocks[i - 1].size == _freeBlocks[i].offset)
+	{
+		_freeBlocks[i - 1].size += _freeBlocks[i].size;
+		_freeBlocks.erase(_freeBlocks.begin() + i);
+	}
+}
+
+const TextureCacheStats* TextureCache::getStats()
+{
+	return &stats;
+}
+
+void TextureCache::logStats()
+{
+	vitaPrintf("\nTexture cache: %u of %u textures resident, %u of %u bytes (peak %u), %u free blocks\n", stats.residentTextures,
+		stats.textures, stats.residentBytes, stats.budget, stats.residentPeak, (unsigned int)_freeBlocks.size());
+	vitaPrintf("%u hits, %u misses, %u streaming, %u evictions, %u failed loads\n", stats.hits, stats.misses, stats.streaming,
+		stats.evictions, stats.failedLoads);
+	vitaPrintf("Loaded %u bytes in %.2fms, last frame used %u textures, %u bytes\n", (unsigned int)stats.bytesLoaded,
+		stats.loadTimeTotal / 1000.0, stats.texturesUsedLastFrame, stats.bytesUsedLastFrame);
+}
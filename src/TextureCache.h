@@ -0,0 +1,121 @@
+#pragma once
+
+//----------------------------------------------
+// TextureCache Class
+// Keeps textures resident in a fixed CDRAM budget, one memblock sized by
+// GraphicsConfig::textureCacheSize that is handed out with a first fit free list.
+// Textures are registered up front (only their header is read) and loaded the first
+// time a frame asks for them, through the StreamLoader when it is running so the frame
+// carries on without them, or right away otherwise. When the budget is full the least
+// recently used textures are evicted, but only ones the GPU has finished every frame
+// using, which the frame done notification tells us without ever waiting on the GPU
+//-----------------------------------------------
+
+#include <vector>
+#include <string>
+
+#include <psp2/types.h>
+
+#include "Texture.h"
+#include "StreamLoader.h"
+
+typedef int TextureHandle;
+#define TEXTURE_HANDLE_INVALID		-1
+
+typedef struct TextureCacheStats
+{
+	SceSize budget;
+	SceSize residentBytes;
+	SceSize residentPeak;
+	unsigned int textures;				//registered with add()
+	unsigned int residentTextures;
+	unsigned int hits;
+	unsigned int misses;				//each one is a load from storage
+	unsigned int streaming;				//loads the StreamLoader hasn't finished yet
+	unsigned int evictions;
+	unsigned int failedLoads;			//didn't fit even after evicting everything the GPU was done with, or couldn't be read
+	SceUInt64 bytesLoaded;
+	SceUInt64 loadTimeTotal;			//microseconds from a miss to the texture being usable
+	unsigned int texturesUsedLastFrame;
+	SceSize bytesUsedLastFrame;			//the working set, when it nears the budget textures start thrashing
+} TextureCacheStats;
+
+class TextureCache
+{
+public:
+	TextureCache();
+	~TextureCache();
+
+	//Allocates the budget, frameDoneNotification is where the GPU writes the index of each finished frame
+	void init(SceSize budget, volatile unsigned int* frameDoneNotification);
+	//The GPU must be idle, every texture is evicted and the handles become invalid
+	void shutdown();
+	bool isInitialized();
+
+	//Registers a .tex file without loading it, returns TEXTURE_HANDLE_INVALID if its header doesn't check out
+	TextureHandle add(const char* path, const TextureSampler* sampler = &defaultSampler);
+	//Makes the texture resident for the frame being recorded, loading it on a miss. Returns nullptr
+	//while it streams in or if it can't be made to fit, draws should fall back to something else.
+	//priority orders streaming loads, lower is sooner (a distance to the camera works)
+	const SceGxmTexture* acquire(TextureHandle handle, float priority = 0.0f);
+	//acquire() and bind to a fragment texture unit, false if the texture isn't resident
+	bool bind(TextureHandle handle, unsigned int unit, float priority = 0.0f);
+	bool isResident(TextureHandle handle);
+
+	//Render thread, once per frame before anything is acquired for nextFrameIndex
+	void beginFrame(unsigned int nextFrameIndex);
+
+	const TextureCacheStats* getStats();
+	void logStats();
+
+private:
+	typedef struct CacheEntry
+	{
+		std::string path;
+		TextureHeader header;
+		TextureSampler sampler;
+		Texture texture;
+		bool resident;
+		bool streaming;				//the memory is reserved, the StreamLoader is filling it
+		StreamHandle stream;
+		float priority;
+		TextureCache* cache;
+		SceSize offset;				//into the cache memblock
+		SceSize size;
+		unsigned int lastUsedFrame;
+	} CacheEntry;
+
+	typedef struct FreeBlock
+	{
+		SceSize offset;
+		SceSize size;
+	} FreeBlock;
+
+	bool load(CacheEntry* entry);
+	//Reserves space like load() and has the StreamLoader fill it
+	bool startStream(CacheEntry* entry);
+	static void streamLoaded(const StreamResult* result);
+	//Evicts until a block of size bytes is free, false when everything left is still in use by the GPU
+	bool makeRoom(SceSize size, SceSize* offset);
+	void evict(CacheEntry* entry);
+	//The least recently used resident texture the GPU is done with, nullptr if there are none
+	CacheEntry* findVictim();
+	//First fit out of the free list, returns false when no single block is big enough
+	bool allocate(SceSize size, SceSize* offset);
+	//Returns a block to the free list, merging it with its neighbours
+	void release(SceSize offset, SceSize size);
+
+	TextureCacheStats stats;
+	bool initialized;
+	void* memory_ptr;
+	GpuBuffer memory;
+	volatile unsigned int* frameDoneNotification_ptr;
+	unsigned int currentFrame;
+	unsigned int texturesUsedThisFrame;
+	SceSize bytesUsedThisFrame;
+
+	//entries are never moved so Texture can keep pointing at its own SceGxmTexture
+	std::vector<CacheEntry*> _entries;
+	//sorted by offset, adjacent blocks are always merged
+	std::vector<FreeBlock> _freeBlocks;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+//----------------------------------------------
+// Binary texture file format (.tex)
+// Shared by the runtime (Texture, TextureCache) and the offline converter in tools/texconv.
+// The texel data is already in the layout the GPU samples from, swizzled or block
+// compressed with every mip level, so loading is one read into GPU memory.
+//
+// Layout, every offset is from the start of the file:
+//	TextureHeader
+//	padding to TEXTURE_DATA_ALIGNMENT
+//	mip level 0, level 1, ... each levelSize() bytes and packed back to back
+//
+// Swizzled textures must be a power of two on both sides. Texels (or 4x4 blocks for the
+// compressed formats) are stored in Morton order over the square the smaller side makes,
+// with those squares one after the other along the longer side, which is what
+// sceGxmTextureInitSwizzled() expects. Linear textures have rows padded to 8 texels
+//-----------------------------------------------
+
+#include <stdint.h>
+
+#define TEXTURE_MAGIC				0x30584554	//"TEX0"
+#define TEXTURE_VERSION				1
+#define TEXTURE_DATA_ALIGNMENT		64
+#define TEXTURE_MAX_SIZE			4096
+#define TEXTURE_MAX_MIPS			13			//4096 down to 1
+#define TEXTURE_LINEAR_STRIDE_ALIGN	8			//linear rows are a multiple of this many texels
+
+//Texel formats, the runtime maps these to SceGxmTextureFormat
+typedef enum TextureFileFormat
+{
+	TEXTURE_FILE_RGBA8 = 0,		//32 bits, U8U8U8U8_ABGR, R in the lowest byte
+	TEXTURE_FILE_RGB565,		//16 bits, U5U6U5_BGR, R in the low bits
+	TEXTURE_FILE_RGBA4444,		//16 bits, U4U4U4U4_ABGR, R in the low bits
+	TEXTURE_FILE_UBC1,			//4 bits, 4x4 blocks, opaque (BC1/DXT1)
+	TEXTURE_FILE_UBC3			//8 bits, 4x4 blocks, interpolated alpha (BC3/DXT5)
+} TextureFileFormat;
+#define NUMBER_OF_TEXTURE_FILE_FORMATS 5
+
+typedef enum TextureLayout
+{
+	TEXTURE_LAYOUT_SWIZZLED = 0,
+	TEXTURE_LAYOUT_LINEAR
+} TextureLayout;
+
+typedef struct TextureHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t fileSize;
+	uint16_t width;
+	uint16_t height;
+	uint8_t format;			//TextureFileFormat
+	uint8_t layout;			//TextureLayout
+	uint8_t mipCount;		//1 when there are no mipmaps
+	uint8_t reserved;
+	uint32_t dataOffset;
+	uint32_t dataSize;		//all mip levels
+	uint32_t _levelOffsets[TEXTURE_MAX_MIPS];	//from dataOffset
+} TextureHeader;
+
+static inline bool textureFormatIsCompressed(uint32_t format)
+{
+	return format == TEXTURE_FILE_UBC1 || format == TEXTURE_FILE_UBC3;
+}
+
+//bytes per texel, or per 4x4 block for compressed formats
+static inline uint32_t textureFormatUnitSize(uint32_t format)
+{
+	switch (format)
+	{
+	case TEXTURE_FILE_RGBA8:
+		return 4;
+	case TEXTURE_FILE_UBC1:
+		return 8;
+	case TEXTURE_FILE_UBC3:
+		return 16;
+	default:
+		return 2;
+	}
+}
+
+//Bytes of one mip level of a width x height texture
+static inline uint32_t textureLevelSize(uint32_t format, uint32_t layout, uint32_t width, uint32_t height)
+{
+	if (textureFormatIsCompressed(format))
+		return ((width + 3) / 4) * ((height + 3) / 4) * textureFormatUnitSize(format);
+	if (layout == TEXTURE_LAYOUT_LINEAR)
+		width = (width + TEXTURE_LINEAR_STRIDE_ALIGN - 1) & ~(TEXTURE_LINEAR_STRIDE_ALIGN - 1);
+	return width * height * textureFormatUnitSize(format);
+}
@@ -18,63 +18,61 @@ to type SceGxmProgram.
 */
 extern const SceGxmProgram clear_v_gxp_start;
 extern const SceGxmProgram clear_f_gxp_start;
-extern const SceGxmProgram color_v_gxp_start;
 extern const SceGxmProgram color_f_gxp_start;
+//built from src/shaders/vertexShaders/object_vertex.cg by the Makefile, basic_vertex.cg with wvp in uniform buffer 0
+extern const SceGxmProgram object_v_gxp_start;
 
 static const SceGxmProgram *const clearVertexProgramGXP = &clear_v_gxp_start;
 static const SceGxmProgram *const clearFragmentProgramGXP = &clear_f_gxp_start;
-static const SceGxmProgram *const basicVertexProgramGXP = &color_v_gxp_start;
+static const SceGxmProgram *const basicVertexProgramGXP = &object_v_gxp_start;
 static const SceGxmProgram *const basicFragmentProgramGXP = &color_f_gxp_start;
 
+//vertex format for the clear triangle, the register indexes are looked up by the ProgramCache
+static const SceGxmVertexAttribute _clearVertexAttribs[1] = {
+	{ 0, 0, SCE_GXM_ATTRIBUTE_FORMAT_F32, 2, 0 }		//aPosition
+};
+static const char* const _clearVertexNames[1] = { "aPosition" };
+//vertex format for the shaded triangle
+static const SceGxmVertexAttribute _basicVertexAttribs[2] = {
+	{ 0, 0, SCE_GXM_ATTRIBUTE_FORMAT_F32, 3, 0 },		//aPosition
+	{ 0, 12, SCE_GXM_ATTRIBUTE_FORMAT_U8N, 4, 0 }		//aColor, after (x, y, z) * 4
+};
+static const char* const _basicVertexNames[2] = { "aPosition", "aColor" };
+
+static const ProgramVariant _triangleVariants[2] = {
+	{ "triangle_clear", clearVertexProgramGXP, clearFragmentProgramGXP, _clearVertexAttribs, _clearVertexNames, 1,
+		{ sizeof(ClearVertex), SCE_GXM_INDEX_SOURCE_INDEX_16BIT }, nullptr, nullptr },
+	{ "triangle_basic", basicVertexProgramGXP, basicFragmentProgramGXP, _basicVertexAttribs, _basicVertexNames, 2,
+		{ sizeof(BasicVertex), SCE_GXM_INDEX_SOURCE_INDEX_16BIT }, nullptr, nullptr }
+};
+
 //----------------------------------------------------------------------------------
 // Triangle class
 //----------------------------------------------------------------------------------
 
-Triangle::Triangle() :
-	clearVertices((ClearVertex*)Graphics::getInstance()->allocGraphicsMem(
-		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
-		3 * sizeof(ClearVertex),
-		4,
-		SCE_GXM_MEMORY_ATTRIB_READ,
-		&clearVerticesUID
-	)),
-	clearIndices((uint16_t*)Graphics::getInstance()->allocGraphicsMem(
-		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
-		3 * sizeof(uint16_t),
-		2,
-		SCE_GXM_MEMORY_ATTRIB_READ,
-		&clearIndicesUID
-	)),
-	basicVertices((BasicVertex*)Graphics::getInstance()->allocGraphicsMem(
-		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
-		3 * sizeof(BasicVertex),
-		4,
-		SCE_GXM_MEMORY_ATTRIB_READ,
-		&basicVerticesUID
-	)),
-	basicIndices((uint16_t*)Graphics::getInstance()->allocGraphicsMem(
-		SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE,
-		3 * sizeof(uint16_t),
-		2,
-		SCE_GXM_MEMORY_ATTRIB_READ,
-		&basicIndicesUID
-	))
+Triangle::Triangle()
 {
-	clearVertexProgram_ptr = nullptr;
-	basicVertexProgram_ptr = nullptr;
-	clearFragmentProgram_ptr = nullptr;
-	basicFragmentProgram_ptr = nullptr;
-
-	clearVertexProgramID = nullptr;
-	clearFragmentProgramID = nullptr;
-	basicVertexProgramID = nullptr;
-	basicFragmentProgramID = nullptr;
-
-	clearVerticesUID = -1;
-	clearIndicesUID = -1;
-	basicVerticesUID = -1;
-	basicIndicesUID = -1;
-
+	programCache = nullptr;
+	clearVariant = -1;
+	basicVariant = -1;
+
+	Graphics* graphics = Graphics::getInstance();
+	SceUID uid = -1;
+	clearVertices = (ClearVertex*)graphics->allocGraphicsMem(SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, 3 * sizeof(ClearVertex), 4,
+		SCE_GXM_MEMORY_ATTRIB_READ, &uid, "triangle_clear_vertices", MEMORY_CATEGORY_GEOMETRY);
+	clearVerticesBuffer = GpuBuffer(clearVertices, uid);
+	clearIndices = (uint16_t*)graphics->allocGraphicsMem(SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, 3 * sizeof(uint16_t), 2,
+		SCE_GXM_MEMORY_ATTRIB_READ, &uid, "triangle_clear_indices", MEMORY_CATEGORY_GEOMETRY);
+	clearIndicesBuffer = GpuBuffer(clearIndices, uid);
+	basicVertices = (BasicVertex*)graphics->allocGraphicsMem(SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, 3 * sizeof(BasicVertex), 4,
+		SCE_GXM_MEMORY_ATTRIB_READ, &uid, "triangle_basic_vertices", MEMORY_CATEGORY_GEOMETRY);
+	basicVerticesBuffer = GpuBuffer(basicVertices, uid);
+	basicIndices = (uint16_t*)graphics->allocGraphicsMem(SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, 3 * sizeof(uint16_t), 2,
+		SCE_GXM_MEMORY_ATTRIB_READ, &uid, "triangle_basic_indices", MEMORY_CATEGORY_GEOMETRY);
+	basicIndicesBuffer = GpuBuffer(basicIndices, uid);
+
+	wvpParam_ptr = nullptr;
+	wvpBlock_ptr = nullptr;
 	triangleRotation = 0.0f;
 }
 
@@ -82,73 +80,17 @@ Triangle::~Triangle()
 {
 }
 
-void Triangle::init()
+void Triangle::init(ProgramCache* cache)
 {
 	vitaPrintf("\nInitializing a triangle object\n");
-	int error = 0;
-
-	//register the programs with the patcher that were compiled and linked to using the CG tool
-	clearVertexProgramID = Graphics::getInstance()->patcherRegisterProgram(clearVertexProgramGXP);
-	clearFragmentProgramID = Graphics::getInstance()->patcherRegisterProgram(clearFragmentProgramGXP);
-	basicVertexProgramID = Graphics::getInstance()->patcherRegisterProgram(basicVertexProgramGXP);
-	basicFragmentProgramID = Graphics::getInstance()->patcherRegisterProgram(basicFragmentProgramGXP);
-
-	//create vertex format for clear triangle
-	SceGxmVertexAttribute clearVertexAttribs[1];
-	clearVertexAttribs[0].streamIndex = 0;
-	clearVertexAttribs[0].offset = 0;
-	clearVertexAttribs[0].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
-	clearVertexAttribs[0].componentCount = 2;
-	//This is set in Graphics::patcherCreateVertexProgram()
-	//clearVertexAttribs[0].regIndex = sceGxmProgramParameterGetResourceIndex(paramClearPositionAttribute_ptr);
-
-	//create vertex format for a shaded triangle
-	SceGxmVertexAttribute basicVertexAttribs[2];
-	basicVertexAttribs[0].streamIndex = 0;
-	basicVertexAttribs[0].offset = 0;
-	basicVertexAttribs[0].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
-	basicVertexAttribs[0].componentCount = 3;
-	//This is set in Graphics::patcherCreateVertexProgram()
-	//basicVertexAttribs[0].regIndex = sceGxmProgramParameterGetResourceIndex(paramBasicPositionAttribute_ptr);
-
-	basicVertexAttribs[1].streamIndex = 0;
-	basicVertexAttribs[1].offset = 12; //(x, y, z) * 4
-	basicVertexAttribs[1].format = SCE_GXM_ATTRIBUTE_FORMAT_U8N;
-	basicVertexAttribs[1].componentCount = 4;
-	//This is set in Graphics::patcherCreateVertexProgram()
-	//basicVertexAttribs[1].regIndex = sceGxmProgramParameterGetResourceIndex(paramBasicColorAttribute_ptr);
-	
-	//Set up the graphics system to create the correct kind of shader for intended geometry
-	Graphics::getInstance()->patcherSetProgramCreationParams(GXM_CLEAR_INDEX_16BIT);
-	//TO DO: Graphics::getInstance()->patcherSetProgramCreationParams(outputRegister = SCE_GXM_OUTPUT_REGISTER_FORMAT_UCHAR4);
-	//TO DO: Graphics::getInstance()->patcherSetProgramCreationParams(Vertex Stream Params/Count);
-	//Create the clear programs
-	clearVertexProgram_ptr = Graphics::getInstance()->patcherCreateVertexProgram(
-		clearVertexProgramID, 
-		clearVertexAttribs, 
-		1, 
-		"aPosition"
-	);
-	clearFragmentProgram_ptr = Graphics::getInstance()->patcherCreateFragmentProgram(
-		clearFragmentProgramID,
-		clearVertexProgramID
-	);
-
-	//Set up the graphics system to create the correct kind of shader for intended geometry
-	Graphics::getInstance()->patcherSetProgramCreationParams(GXM_BASIC_INDEX_16BIT);
-	//Create the color programs
-	basicVertexProgram_ptr = Graphics::getInstance()->patcherCreateVertexProgram(
-		basicVertexProgramID,
-		basicVertexAttribs,
-		2,
-		"aPosition", "aColor"
-	);
-	basicFragmentProgram_ptr = Graphics::getInstance()->patcherCreateFragmentProgram(
-		basicFragmentProgramID, 
-		basicVertexProgramID
-	);
-
-	//The memory for all of these was allocated before the constructor 
+
+	//the programs were registered with the patcher and queued for patching when the cache got the variants
+	programCache = cache;
+	clearVariant = programCache->findVariant("triangle_clear");
+	basicVariant = programCache->findVariant("triangle_basic");
+	assert(clearVariant >= 0 && basicVariant >= 0);
+
+	//The memory for all of these was allocated by the constructor
 	vitaPrintf("Setting up clear vertices\n");
 	//create clear triangle vertices/indice
 	clearVertices[0].x = -1.0f;
@@ -183,10 +125,11 @@ void Triangle::init()
 	basicIndices[1] = 1;
 	basicIndices[2] = 2;
 
-	vitaPrintf("Loading World-View-Projection parameters from vertex program at address: %p\n", sceGxmShaderPatcherGetProgramFromId(basicVertexProgramID));
-	const SceGxmProgramParameter* wvpParam_ptr = sceGxmProgramFindParameterByName(sceGxmShaderPatcherGetProgramFromId(basicVertexProgramID), "wvp");
+	vitaPrintf("Loading World-View-Projection parameters from vertex program at address: %p\n", basicVertexProgramGXP);
+	wvpParam_ptr = sceGxmProgramFindParameterByName(basicVertexProgramGXP, "wvp");
 	assert(wvpParam_ptr && (sceGxmProgramParameterGetCategory(wvpParam_ptr) == SCE_GXM_PARAMETER_CATEGORY_UNIFORM));
-	_wvpParams.insert(_wvpParams.begin(), std::make_pair("wvp", wvpParam_ptr));
+	//the matrix changes every frame, it is written into a block of this frame's uniforms by update()
+	wvpRing.init(basicVertexProgramGXP, 0, 1, "triangle_wvp");
 }
 
 void Triangle::update()
@@ -196,8 +139,13 @@ void Triangle::update()
 	if (triangleRotation > ((float)PI * 2.f))
 		triangleRotation -= ((float)PI * 2.f);
 
-	//4x4 matrix for rotation
-	float aspectRatio = (float)DISPLAY_WIDTH / (float)DISPLAY_HEIGHT;
+	//4x4 matrix for rotation, written straight into this frame's uniform block
+	wvpBlock_ptr = wvpRing.allocate();
+	if (wvpBlock_ptr == nullptr)
+		return;
+	float wvpData[16];
+	const GraphicsConfig* config = Graphics::getInstance()->getConfig();
+	float aspectRatio = (float)config->displayWidth / (float)config->displayHeight;
 
 	float s = sin(triangleRotation);
 	float c = cos(triangleRotation);
@@ -222,36 +170,61 @@ void Triangle::update()
 	wvpData[13] = 0.0f;
 	wvpData[14] = 0.0f;
 	wvpData[15] = 1.0f;
+	sceGxmSetUniformDataF(wvpBlock_ptr, wvpParam_ptr, 0, 16, wvpData);
 }
 
 void Triangle::cleanup()
 {	
 	vitaPrintf("\nCleaning up after a triangle object\n");
 
-	/* This is done automatically in Graphics::shutdown()
-	Graphics::getInstance()->patcherUnregisterProgram(basicFragmentProgramID);
-	Graphics::getInstance()->patcherUnregisterProgram(basicVertexProgramID);
-	Graphics::getInstance()->patcherUnregisterProgram(clearFragmentProgramID);
-	Graphics::getInstance()->patcherUnregisterProgram(clearVertexProgramID);
-	*/
+	//the programs belong to the ProgramCache, they are released by its shutdown()
+	programCache = nullptr;
+	clearVariant = -1;
+	basicVariant = -1;
+
+	//the frame being recorded may still draw with the geometry, the release queue frees it once the GPU is done
+	wvpRing.logStats();
+	wvpRing.shutdown();
+	wvpBlock_ptr = nullptr;
+	clearVerticesBuffer.reset();
+	clearIndicesBuffer.reset();
+	basicVerticesBuffer.reset();
+	basicIndicesBuffer.reset();
+	clearVertices = nullptr;
+	clearIndices = nullptr;
+	basicVertices = nullptr;
+	basicIndices = nullptr;
+}
+
+const ProgramVariant* Triangle::getProgramVariants(unsigned int* count)
+{
+	*count = sizeof(_triangleVariants) / sizeof(_triangleVariants[0]);
+	return _triangleVariants;
 }
 
 void Triangle::draw()
 {
-	//set clear shaders
-	Graphics::getInstance()->patcherSetVertexProgram(clearVertexProgram_ptr);
-	Graphics::getInstance()->patcherSetFragmentProgram(clearFragmentProgram_ptr);
-	//draw the clear triangle
-	Graphics::getInstance()->patcherSetVertexStream(0, clearVertices);
-	Graphics::getInstance()->draw(SCE_GXM_PRIMITIVE_TRIANGLES, SCE_GXM_INDEX_FORMAT_U16, clearIndices, 3);
-
-	//set basic shaders
-	Graphics::getInstance()->patcherSetVertexProgram(basicVertexProgram_ptr);
-	Graphics::getInstance()->patcherSetFragmentProgram(basicFragmentProgram_ptr);
-
-	//set vertex program constants
-	void* defaultVertexBuffer;
-	Graphics::getInstance()->patcherSetVertexProgramConstants(defaultVertexBuffer, _wvpParams.find("wvp")->second, 0, 16, wvpData);
+	const SceGxmVertexProgram* vertexProgram_ptr = nullptr;
+	const SceGxmFragmentProgram* fragmentProgram_ptr = nullptr;
+
+	//set clear shaders, the cache has patched them by now unless this is a hitch
+	if (programCache->getPrograms(clearVariant, &vertexProgram_ptr, &fragmentProgram_ptr))
+	{
+		Graphics::getInstance()->patcherSetVertexProgram(vertexProgram_ptr);
+		Graphics::getInstance()->patcherSetFragmentProgram(fragmentProgram_ptr);
+		//draw the clear triangle
+		Graphics::getInstance()->patcherSetVertexStream(0, clearVertices);
+		Graphics::getInstance()->draw(SCE_GXM_PRIMITIVE_TRIANGLES, SCE_GXM_INDEX_FORMAT_U16, clearIndices, 3);
+	}
+
+	//set basic shaders, update() has to have written this frame's matrix
+	if (wvpBlock_ptr == nullptr || !programCache->getPrograms(basicVariant, &vertexProgram_ptr, &fragmentProgram_ptr))
+		return;
+	Graphics::getInstance()->patcherSetVertexProgram(vertexProgram_ptr);
+	Graphics::getInstance()->patcherSetFragmentProgram(fragmentProgram_ptr);
+
+	//bind the matrix update() wrote, nothing is copied into the vertex ring
+	wvpRing.bind(wvpBlock_ptr);
 
 	//draw the rotating triangle
 	Graphics::getInstance()->patcherSetVertexStream(0, basicVertices);
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Graphics.h"
+#include "ProgramCache.h"
+#include "UniformBuffer.h"
 
 //This is just thrown together to get a sample from another SDK working,
 //Actually set up to create/draw 2 different triangles; a clear vertice triangle and a basic shaded one with rotation
@@ -11,38 +13,38 @@ public:
 	Triangle();
 	~Triangle();
 
-	void init();
+	//The programs come from programCache, which has to have the variants from getProgramVariants()
+	void init(ProgramCache* programCache);
 	void cleanup();
 	void update();
 	void draw();
 
+	//What the triangles draw with, for a ProgramCache to patch ahead of time
+	static const ProgramVariant* getProgramVariants(unsigned int* count);
+
 private:
 
 	float triangleRotation;
 
-	//Programs to register with the patcher (linked against with shader(s).obj)
-	SceGxmShaderPatcherId clearVertexProgramID;
-	SceGxmShaderPatcherId basicVertexProgramID;
-	SceGxmShaderPatcherId clearFragmentProgramID;
-	SceGxmShaderPatcherId basicFragmentProgramID;
-
-	//shader program pointers
-	SceGxmVertexProgram* clearVertexProgram_ptr;
-	SceGxmVertexProgram* basicVertexProgram_ptr;
-	SceGxmFragmentProgram* clearFragmentProgram_ptr;
-	SceGxmFragmentProgram* basicFragmentProgram_ptr;
-
-	ClearVertex *const clearVertices;
-	uint16_t *const clearIndices;
-	BasicVertex *const basicVertices;
-	uint16_t *const basicIndices;
-
-	SceUID clearVerticesUID;
-	SceUID clearIndicesUID;
-	SceUID basicVerticesUID;
-	SceUID basicIndicesUID;
-
-	//world view projection parameters
-	std::map<const char*, const SceGxmProgramParameter*> _wvpParams;
-	float wvpData[16];
+	//the programs are patched and owned by the cache, asked for every draw
+	ProgramCache* programCache;
+	int clearVariant;
+	int basicVariant;
+
+	ClearVertex* clearVertices;
+	uint16_t* clearIndices;
+	BasicVertex* basicVertices;
+	uint16_t* basicIndices;
+
+	//own the memory above, cleanup() hands it to the release queue
+	GpuBuffer clearVerticesBuffer;
+	GpuBuffer clearIndicesBuffer;
+	GpuBuffer basicVerticesBuffer;
+	GpuBuffer basicIndicesBuffer;
+
+	//world view projection, in uniform buffer 0 of the shaded triangle's vertex program.
+	//update() writes it into a block of the frame's uniforms, draw() binds the block
+	const SceGxmProgramParameter* wvpParam_ptr;
+	UniformRing wvpRing;
+	void* wvpBlock_ptr;
 };
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include "UniformBuffer.h"
+#include "commonUtils.h"
+
+#include <string.h>
+#include <assert.h>
+
+SceSize getUniformBufferSize(const SceGxmProgram* program, unsigned int bufferIndex)
+{
+	//a buffer ends with the last of its parameters, resource indices and sizes are in 32 bit registers
+	unsigned int registers = 0;
+	for (unsigned int i = 0; i < sceGxmProgramGetParameterCount(program); i++)
+	{
+		const SceGxmProgramParameter* parameter = sceGxmProgramGetParameter(program, i);
+		if (sceGxmProgramParameterGetCategory(parameter) != SCE_GXM_PARAMETER_CATEGORY_UNIFORM ||
+			sceGxmProgramParameterGetContainerIndex(parameter) != bufferIndex)
+			continue;
+		unsigned int end = sceGxmProgramParameterGetResourceIndex(parameter) +
+			sceGxmProgramParameterGetComponentCount(parameter) * sceGxmProgramParameterGetArraySize(parameter);
+		if (end > registers)
+			registers = end;
+	}
+	return registers * sizeof(float);
+}
+
+/*----- UniformBuffer -----*/
+
+UniformBuffer::UniformBuffer()
+{
+	bufferIndex = 0;
+	size = 0;
+}
+
+UniformBuffer::~UniformBuffer()
+{
+}
+
+bool UniformBuffer::init(const SceGxmProgram* program, unsigned int bufferIndex, const char* name)
+{
+	size = getUniformBufferSize(program, bufferIndex);
+	if (size == 0)
+	{
+		vitaPrintf("ERROR: %s: the program reads no uniform buffer %u\n", name, bufferIndex);
+		return false;
+	}
+	this->bufferIndex = bufferIndex;
+
+	SceUID uid = -1;
+	void* memory = Graphics::getInstance()->allocGraphicsMem(SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, size, UNIFORM_BLOCK_ALIGNMENT,
+		SCE_GXM_MEMORY_ATTRIB_READ, &uid, name, MEMORY_CATEGORY_UNIFORMS);
+	memset(memory, 0, size);
+	buffer = GpuBuffer(memory, uid);
+	return true;
+}
+
+void UniformBuffer::shutdown()
+{
+	buffer.reset();
+	size = 0;
+}
+
+void UniformBuffer::setData(const SceGxmProgramParameter* parameter, unsigned int componentOffset, unsigned int componentCount,
+	const float* data)
+{
+	int error = sceGxmSetUniformDataF(buffer.get(), parameter, componentOffset, componentCount, data);
+	if (error != 0)
+		vitaPrintf("ERROR: sceGxmSetUniformDataF() result: 0x%08X\n", error);
+}
+
+void UniformBuffer::bind()
+{
+	Graphics::getInstance()->patcherSetVertexUniformBuffer(bufferIndex, buffer.get());
+}
+
+void* UniformBuffer::getData()
+{
+	return buffer.get();
+}
+
+/*----- UniformRing -----*/
+
+UniformRing::UniformRing()
+{
+	bufferIndex = 0;
+	blockSize = 0;
+	maxBlocks = 0;
+	region_ptr = nullptr;
+	regionBlocks = 0;
+	memset(&stats, 0, sizeof(stats));
+	droppedThisFrame = 0;
+}
+
+UniformRing::~UniformRing()
+{
+}
+
+bool UniformRing::init(const SceGxmProgram* program, unsigned int bufferIndex, unsigned int maxBlocks, const char* name)
+{
+	vitaPrintf("\nInitializing uniform ring %s for %u blocks a frame\n", name, maxBlocks);
+	SceSize size = getUniformBufferSize(program, bufferIndex);
+	if (size == 0 || maxBlocks == 0)
+	{
+		vitaPrintf("ERROR: %s: the program reads no uniform buffer %u\n", name, bufferIndex);
+		return false;
+	}
+	this->bufferIndex = bufferIndex;
+	this->maxBlocks = maxBlocks;
+	blockSize = ALIGN_MEM(size, UNIFORM_BLOCK_ALIGNMENT);
+
+	ring.init(maxBlocks * blockSize, UNIFORM_BLOCK_ALIGNMENT, name, MEMORY_CATEGORY_UNIFORMS);
+	region_ptr = (uint8_t*)ring.getRegion();
+	regionBlocks = 0;
+	memset(&stats, 0, sizeof(stats));
+	droppedThisFrame = 0;
+	return true;
+}
+
+void UniformRing::shutdown()
+{
+	if (!ring.isInitialized())
+		return;
+	ring.shutdown();
+	region_ptr = nullptr;
+	regionBlocks = 0;
+}
+
+bool UniformRing::isInitialized()
+{
+	return ring.isInitialized();
+}
+
+void UniformRing::beginFrame(unsigned int frame)
+{
+	//the frame that just ended becomes the last frame
+	stats.blocksLastFrame = regionBlocks;
+	stats.droppedLastFrame = droppedThisFrame;
+	if (regionBlocks > stats.blocksPeak)
+		stats.blocksPeak = regionBlocks;
+	droppedThisFrame = 0;
+
+	region_ptr = (uint8_t*)ring.beginFrame(frame);
+	regionBlocks = 0;
+	stats.stalls = ring.getStalls();
+}
+
+void* UniformRing::allocate(unsigned int count)
+{
+	if (!ring.isInitialized())
+		return nullptr;
+
+	unsigned int frame = Graphics::getInstance()->getFrameIndex();
+	if (frame != ring.getFrame())
+		beginFrame(frame);
+
+	if (regionBlocks + count > maxBlocks)
+	{
+		droppedThisFrame += count;
+		return nullptr;
+	}
+	void* blocks = region_ptr + regionBlocks * blockSize;
+	regionBlocks += count;
+	return blocks;
+}
+
+SceSize UniformRing::getBlockSize()
+{
+	return blockSize;
+}
+
+void UniformRing::bind(const void* block)
+{
+	assert(block != nullptr);
+	Graphics::getInstance()->patcherSetVertexUniformBuffer(bufferIndex, block);
+}
+
+const UniformRingStats* UniformRing::getStats()
+{
+	return &stats;
+}
+
+void UniformRing::logStats()
+{
+	vitaPrintf("\nUniform ring: %u byte blocks\n", blockSize);
+	vitaPrintf("\tLast frame: %u blocks, %u dropped\n", stats.blocksLastFrame, stats.droppedLastFrame);
+	vitaPrintf("\tPeak: %u of %u blocks, %u stalls\n", stats.blocksPeak, maxBlocks, stats.stalls);
+}
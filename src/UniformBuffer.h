@@ -0,0 +1,91 @@
+#pragma once
+
+//----------------------------------------------
+// UniformBuffer and UniformRing Classes
+// Vertex program constants kept in a uniform buffer (a ": BUFFER[n]" uniform in the .cg) rather
+// than the default uniform buffer. Default uniforms are reserved out of the vertex ring and
+// copied there on every draw that sets them; a uniform buffer is memory the object owns and a
+// draw only binds it with Graphics::patcherSetVertexUniformBuffer().
+// UniformBuffer is for constants that don't change, they are written once after init().
+// UniformRing is for constants written every frame: all of a frame's objects take their blocks
+// out of the frame's region of a FrameRing and are written in one pass, then each draw binds its block.
+// Blocks are written with sceGxmSetUniformDataF(), which puts a parameter at its offset in them
+//-----------------------------------------------
+
+#include "Graphics.h"
+#include "FrameRing.h"
+
+//Blocks start on this many bytes
+#define UNIFORM_BLOCK_ALIGNMENT		16
+
+//Bytes the uniforms of program's uniform buffer bufferIndex take, 0 if it has none there
+SceSize getUniformBufferSize(const SceGxmProgram* program, unsigned int bufferIndex);
+
+class UniformBuffer
+{
+public:
+	UniformBuffer();
+	~UniformBuffer();
+
+	//Allocates room for program's uniform buffer bufferIndex, false if the program doesn't read one there
+	bool init(const SceGxmProgram* program, unsigned int bufferIndex, const char* name = "uniform_buffer");
+	//Hands the memory to Graphics' release queue, draws already submitted can still read it
+	void shutdown();
+
+	//Writes a parameter like sceGxmSetUniformDataF(). Whatever is in flight reads the new values, write before the first draw
+	void setData(const SceGxmProgramParameter* parameter, unsigned int componentOffset, unsigned int componentCount, const float* data);
+	//Binds it for the draws that follow
+	void bind();
+	void* getData();
+
+private:
+	GpuBuffer buffer;
+	unsigned int bufferIndex;
+	SceSize size;
+};
+
+typedef struct UniformRingStats
+{
+	unsigned int blocksLastFrame;
+	unsigned int blocksPeak;
+	unsigned int droppedLastFrame;		//blocks past maxBlocks, raise it if this isn't 0
+	unsigned int stalls;				//frames that had to wait for the GPU to release their region
+} UniformRingStats;
+
+class UniformRing
+{
+public:
+	UniformRing();
+	~UniformRing();
+
+	//Room for maxBlocks blocks of program's uniform buffer bufferIndex a frame, false if the program doesn't read one there
+	bool init(const SceGxmProgram* program, unsigned int bufferIndex, unsigned int maxBlocks, const char* name = "uniform_ring");
+	//Hands the memory to Graphics' release queue, draws already submitted can still read it
+	void shutdown();
+	bool isInitialized();
+
+	//count blocks of the frame being recorded in a row, block i at getBlockSize() * i. nullptr once the frame is out of them.
+	//They belong to this frame only, take them again next frame
+	void* allocate(unsigned int count = 1);
+	SceSize getBlockSize();
+	//Binds a block from allocate() for the draws that follow
+	void bind(const void* block);
+
+	const UniformRingStats* getStats();
+	void logStats();
+
+private:
+	FrameRing ring;
+	unsigned int bufferIndex;
+	SceSize blockSize;
+	unsigned int maxBlocks;
+
+	uint8_t* region_ptr;
+	unsigned int regionBlocks;
+
+	UniformRingStats stats;
+	unsigned int droppedThisFrame;
+
+	//Rolls the stats over and moves to the frame's region
+	void beginFrame(unsigned int frame);
+};
@@ -2,11 +2,45 @@
 
 #include "Logger.h"
 
+#include <psp2/io/fcntl.h>
+
 //Engine specific
 #define vitaPrintf Logger::getInstance()->writeLog
+//step by step detail, only written with verbose logging on
+#define vitaVerbosePrintf Logger::getInstance()->writeVerbose
 //TO DO:
 //#define vitaPrintf Logger::getInstance()->applicationMsg
 //#define LOG Logger::getInstance()->writeLog
 
-static const char* _padLables[16] = { "SELECT ", "", "", "START ", "UP ","RIGHT ","DOWN ","LEFT ",
-	"L ", "R ", "", "", "TRIANGLE ", "CIRCLE ", "CROSS ", "SQUARE " };
\ No newline at end of file
+static const char* const _padLables[16] = { "SELECT ", "", "", "START ", "UP ","RIGHT ","DOWN ","LEFT ",
+	"L ", "R ", "", "", "TRIANGLE ", "CIRCLE ", "CROSS ", "SQUARE " };
+
+//Reads exactly size bytes, sceIoRead can return less than asked for
+static inline bool readFully(SceUID fd, void* data, SceSize size)
+{
+	char* dest = (char*)data;
+	while (size > 0)
+	{
+		int result = sceIoRead(fd, dest, size);
+		if (result <= 0)
+			return false;
+		dest += result;
+		size -= result;
+	}
+	return true;
+}
+
+//Writes exactly size bytes, sceIoWrite can write less than asked for
+static inline bool writeFully(SceUID fd, const void* data, SceSize size)
+{
+	const char* source = (const char*)data;
+	while (size > 0)
+	{
+		int result = sceIoWrite(fd, source, size);
+		if (result <= 0)
+			return false;
+		source += result;
+		size -= result;
+	}
+	return true;
+}
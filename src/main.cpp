@@ -1,53 +1,244 @@
 ﻿#include <string.h>
 
 #include <psp2/kernel/processmgr.h>
-#include <psp2/ctrl.h>
 
 #include "Graphics.h"
+#include "GraphicsConfig.h"
+#include "StreamLoader.h"
+#include "Input.h"
+#include "SpriteBatch.h"
+#include "StatsOverlay.h"
+#include "RenderGraph.h"
+#include "CaptureReplay.h"
+#include "StartupTimer.h"
+#include "StartupTask.h"
+#include "ProgramCache.h"
+#include "JobSystem.h"
+#include "ParticleSystem.h"
+#include "DemoCrowd.h" //Skinned stick figures until there are assets
 #include "Triangle.h" //Just a demo class to get something 3d on the screen
 #include "commonUtils.h"
 
+//TRIANGLE captures this many frames into CAPTURE_PATH, SQUARE replays the capture as a submission benchmark
+#define CAPTURE_PATH		"ux0:data/gxm_capture.gcap"
+#define CAPTURE_FRAMES		60
+//Longest step the particles take, a frame that stalls for longer doesn't throw them across the screen
+#define MAX_FRAME_TIME		0.1f
+
+//Everything the main pass draws
+typedef struct MainPassData
+{
+	Triangle* triangle;
+	DemoCrowd* crowd;
+	ParticleSystem* particles;
+	StatsOverlay* statsOverlay;
+	SpriteBatch* spriteBatch;
+} MainPassData;
+
+//The render graph's pass into the back buffer
+static void drawMainPass(void* userData)
+{
+	MainPassData* data = (MainPassData*)userData;
+	Graphics::getInstance()->clearScreen();
+	data->triangle->draw();
+	data->crowd->draw();
+	data->particles->draw();
+	data->statsOverlay->draw(data->spriteBatch);
+}
+
+//Opens the system font on a StartupTask
+static int loadFont(void* userData)
+{
+	return ((Font*)userData)->load() ? 0 : -1;
+}
+
 //Let's do this
 int main()
 {
+	//every phase of startup is timed, they are logged with the time to the first frame once it is submitted
+	StartupTimer* startup = StartupTimer::getInstance();
+
 	//initialize the logger
 	Logger::getInstance()->init();
 
-	//set up all GXM/Buffers/Shaders/etc using default settings
-	Graphics::getInstance()->initGraphics();
+	//loads on its own thread from here on, finished loads are handed over once a frame
+	StreamLoader::getInstance()->init();
+
+	//the system font loads on its own thread while the GPU is set up and the programs are patched
+	Font font;
+	StartupTask fontTask;
+	if (!fontTask.start("font_loader", loadFont, &font))
+		vitaPrintf("Couldn't start the font loader, loading the font later instead\n");
+
+	//set up all GXM/Buffers/Shaders/etc using the default settings, overridden by the config file if there is one
+	startup->beginPhase("config file");
+	GraphicsConfig graphicsConfig;
+	getDefaultGraphicsConfig(&graphicsConfig);
+	loadGraphicsConfig("app0:graphics.cfg", &graphicsConfig);
+	startup->endPhase();
+	if (!Graphics::getInstance()->initGraphics(&graphicsConfig))
+	{
+		fontTask.wait();
+		font.shutdown();
+		StreamLoader::getInstance()->shutdown();
+		Logger::getInstance()->shutdown();
+		sceKernelExitProcess(0);
+		return 0;
+	}
 
-	//initialize controller data
-	SceCtrlData ctrl;
-	memset(&ctrl, 0, sizeof(ctrl));
+	//the controller is sampled on its own thread from here on, presses are handed over once a frame
+	startup->beginPhase("input");
+	Input::getInstance()->init();
+	startup->endPhase();
 
+	//workers on the two cores the render thread leaves free, the particles are simulated and the crowd animated on them
+	startup->beginPhase("job system");
+	JobSystem::getInstance()->init();
+	startup->endPhase();
+
+	//every program variant the level draws with is patched on the cache's thread from here on, while the rest loads.
+	//The sprite batch still patches its own programs up front, still overlapping the font loading
+	startup->beginPhase("programs");
+	ProgramCache programCache;
+	unsigned int variantCount = 0;
+	const ProgramVariant* variants = Triangle::getProgramVariants(&variantCount);
+	programCache.add(variants, variantCount);
+	programCache.start();
 	Triangle triangle;
-	triangle.init();
+	triangle.init(&programCache);
+	//2D drawing and the stats overlay, START shows and hides it
+	SpriteBatch spriteBatch;
+	spriteBatch.init();
+	startup->endPhase();
+
+	//a fountain either side of the triangle
+	startup->beginPhase("particles");
+	ParticleSystem particles;
+	particles.init();
+	particles.setGravity(0.0f, 240.0f);
+	particles.setDrag(0.2f);
+	ParticleEmitter emitter;
+	memset(&emitter, 0, sizeof(ParticleEmitter));
+	emitter.x = graphicsConfig.displayWidth * 0.25f;
+	emitter.y = graphicsConfig.displayHeight * 0.95f;
+	emitter.rate = 4000.0f;
+	emitter.direction = -1.5708f;
+	emitter.spread = 0.3f;
+	emitter.speedMin = 220.0f;
+	emitter.speedMax = 440.0f;
+	emitter.lifetimeMin = 1.5f;
+	emitter.lifetimeMax = 2.5f;
+	emitter.sizeMin = 3.0f;
+	emitter.sizeMax = 10.0f;
+	emitter.color = RGBA8(255, 140, 40, 160);
+	emitter.active = true;
+	particles.addEmitter(&emitter);
+	emitter.x = graphicsConfig.displayWidth * 0.75f;
+	emitter.color = RGBA8(60, 140, 255, 160);
+	particles.addEmitter(&emitter);
+	startup->endPhase();
+
+	//skinned characters walking and waving
+	startup->beginPhase("animation");
+	DemoCrowd crowd;
+	if (!crowd.init())
+		vitaPrintf("The crowd couldn't be set up, it won't be drawn\n");
+	startup->endPhase();
+
+	//only as long as the font loader is still busy, then the atlas
+	startup->beginPhase("font");
+	fontTask.wait();
+	font.init();
+	StatsOverlay statsOverlay;
+	statsOverlay.init(&font);
+	startup->endPhase();
+	vitaPrintf("The font loader took %.2fms\n", fontTask.getDuration() / 1000.0);
+
+	//the frame is a render graph, for now a single pass straight into the back buffer.
+	//Offscreen passes for effects go in front of it
+	startup->beginPhase("render graph");
+	MainPassData mainPassData = { &triangle, &crowd, &particles, &statsOverlay, &spriteBatch };
+	RenderGraph renderGraph;
+	RenderPass mainPass = renderGraph.addPass("main", drawMainPass, &mainPassData);
+	renderGraph.writeColor(mainPass, renderGraph.getBackBuffer());
+	renderGraph.compile();
+	startup->endPhase();
+
+	//everything from here on should give back what it takes, the difference is logged on the way out
+	MemorySnapshot loadedMemory;
+	Graphics::getInstance()->getMemoryTracker()->takeSnapshot(&loadedMemory);
 
 	//main loop
 	bool running = true;
+	SceUInt64 lastFrameTime = sceKernelGetProcessTimeWide();
 	do
 	{
-		//check control data
-		sceCtrlReadBufferPositive(0, &ctrl, 1);
-		if (ctrl.buttons & SCE_CTRL_SELECT)
+		SceUInt64 frameTime = sceKernelGetProcessTimeWide();
+		float dt = (frameTime - lastFrameTime) / 1000000.0f;
+		lastFrameTime = frameTime;
+		if (dt > MAX_FRAME_TIME)
+			dt = MAX_FRAME_TIME;
+
+		//everything the input thread saw since the last frame, also stamps this frame for the latency stats
+		Input* input = Input::getInstance();
+		input->update();
+		if (input->isDown(SCE_CTRL_SELECT))
 			running = false;
 
-		//rotate the triangle
-		triangle.update();
+		//cycle through the present modes with the shoulder buttons, logging how the last one did
+		if (input->wasPressed(SCE_CTRL_LTRIGGER | SCE_CTRL_RTRIGGER))
+		{
+			int mode = Graphics::getInstance()->getPresentMode();
+			mode += input->wasPressed(SCE_CTRL_RTRIGGER) ? 1 : NUMBER_OF_PRESENT_MODES - 1;
+			Graphics::getInstance()->logPresentStats();
+			Graphics::getInstance()->setPresentMode((PresentMode)(mode % NUMBER_OF_PRESENT_MODES));
+		}
+		if (input->wasPressed(SCE_CTRL_START))
+			statsOverlay.setVisible(!statsOverlay.isVisible());
 
-		Graphics::getInstance()->startScene();
-		Graphics::getInstance()->clearScreen();
+		//capture what the frames submit, or submit the last capture again and log what it cost
+		if (input->wasPressed(SCE_CTRL_TRIANGLE))
+			Graphics::getInstance()->startCapture(CAPTURE_PATH, CAPTURE_FRAMES);
+		if (input->wasPressed(SCE_CTRL_SQUARE) && !Graphics::getInstance()->isCapturing())
+		{
+			CaptureReplay captureReplay;
+			if (captureReplay.load(CAPTURE_PATH))
+			{
+				CaptureReplayStats replayStats;
+				captureReplay.replay(1, &replayStats);
+				CaptureReplay::logStats(&replayStats);
+				captureReplay.unload();
+			}
+		}
 
-		triangle.draw();
+		//run the callbacks of anything that finished streaming in since the last frame
+		StreamLoader::getInstance()->update();
+
+		//rotate the triangle, animate the crowd, move the particles
+		triangle.update();
+		crowd.update(dt);
+		particles.update(dt);
+		statsOverlay.update();
 
-		Graphics::getInstance()->endScene();
+		renderGraph.execute();
 		Graphics::getInstance()->swapBuffers();
 	} while (running);
+	Graphics::getInstance()->getMemoryTracker()->logSnapshotDiff(&loadedMemory);
 
-	//wait until rendering is finished before cleaning things up
-	//sceGxmFinish(Graphics::getInstance()->getGxmContext()); done in Graphics::shutdown for now
+	//everything hands what it owns to the release queue, the GPU can still be busy with it. shutdownGraphics() waits for
+	//rendering to finish before it frees the lot
 	triangle.cleanup();
+	crowd.cleanup();
+	particles.shutdown();
+	programCache.logStats();
+	programCache.shutdown();
+	renderGraph.reset();
+	font.shutdown();
+	spriteBatch.shutdown();
 	Graphics::getInstance()->shutdownGraphics();
+	Input::getInstance()->shutdown();
+	StreamLoader::getInstance()->shutdown();
+	JobSystem::getInstance()->shutdown();
 
 	Logger::getInstance()->shutdown();
 
@@ -0,0 +1,307 @@
+#include "SourceMesh.h"
+#include "MeshFormat.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#define ALIGN_UP(value, align)	(((value) + ((align) - 1)) & ~((align) - 1))
+
+//bounds of the vertices indices refers to, or all vertices when indices is NULL
+static void computeBounds(const SourceMesh* mesh, const std::vector<uint32_t>* indices, MeshBounds* bounds)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		bounds->min[axis] = FLT_MAX;
+		bounds->max[axis] = -FLT_MAX;
+	}
+
+	size_t count = indices ? indices->size() : mesh->vertices.size();
+	for (size_t i = 0; i < count; i++)
+	{
+		const float* position = mesh->vertices[indices ? (*indices)[i] : i].position;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (position[axis] < bounds->min[axis])
+				bounds->min[axis] = position[axis];
+			if (position[axis] > bounds->max[axis])
+				bounds->max[axis] = position[axis];
+		}
+	}
+
+	//sphere around the box center, loose but cheap to test against
+	float radiusSquared = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+		bounds->center[axis] = 0.5f * (bounds->min[axis] + bounds->max[axis]);
+	for (size_t i = 0; i < count; i++)
+	{
+		const float* position = mesh->vertices[indices ? (*indices)[i] : i].position;
+		float dx = position[0] - bounds->center[0];
+		float dy = position[1] - bounds->center[1];
+		float dz = position[2] - bounds->center[2];
+		float distanceSquared = dx * dx + dy * dy + dz * dz;
+		if (distanceSquared > radiusSquared)
+			radiusSquared = distanceSquared;
+	}
+	bounds->radius = sqrtf(radiusSquared);
+}
+
+static int componentSize(MeshAttributeFormat format)
+{
+	switch (format)
+	{
+	case MESH_FORMAT_F32:
+		return 4;
+	case MESH_FORMAT_F16:
+	case MESH_FORMAT_S16N:
+		return 2;
+	default:
+		return 1;
+	}
+}
+
+static void addAttribute(std::vector<MeshAttribute>* attributes, MeshSemantic semantic, MeshAttributeFormat format, int componentCount, int* offset)
+{
+	//components are kept naturally aligned so the GPU never straddles a fetch
+	int size = componentSize(format);
+	*offset = ALIGN_UP(*offset, size);
+
+	MeshAttribute attribute;
+	attribute.semantic = (uint8_t)semantic;
+	attribute.format = (uint8_t)format;
+	attribute.componentCount = (uint8_t)componentCount;
+	attribute.offset = (uint8_t)*offset;
+	attributes->push_back(attribute);
+	*offset += componentCount * size;
+}
+
+//writes values in the attribute's format and returns what the GPU will read back
+static void encodeComponents(const MeshAttribute* attribute, const float* values, unsigned char* vertex, float* decoded)
+{
+	unsigned char* dest = vertex + attribute->offset;
+	for (int i = 0; i < attribute->componentCount; i++)
+	{
+		switch (attribute->format)
+		{
+		case MESH_FORMAT_F16:
+		{
+			uint16_t half = floatToHalf(values[i]);
+			memcpy(dest + i * 2, &half, 2);
+			decoded[i] = halfToFloat(half);
+			break;
+		}
+		case MESH_FORMAT_S16N:
+		{
+			int16_t snorm = (int16_t)floatToSnorm(values[i], 16);
+			memcpy(dest + i * 2, &snorm, 2);
+			decoded[i] = snormToFloat(snorm, 16);
+			break;
+		}
+		case MESH_FORMAT_S8N:
+		{
+			int8_t snorm = (int8_t)floatToSnorm(values[i], 8);
+			memcpy(dest + i, &snorm, 1);
+			decoded[i] = snormToFloat(snorm, 8);
+			break;
+		}
+		case MESH_FORMAT_F32:
+		default:
+			memcpy(dest + i * 4, &values[i], 4);
+			decoded[i] = values[i];
+			break;
+		}
+	}
+}
+
+static float angleBetween(const float a[3], const float b[3])
+{
+	float lengths = sqrtf((a[0] * a[0] + a[1] * a[1] + a[2] * a[2]) * (b[0] * b[0] + b[1] * b[1] + b[2] * b[2]));
+	if (lengths == 0.0f)
+		return 0.0f;
+	float cosine = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) / lengths;
+	cosine = (cosine > 1.0f) ? 1.0f : ((cosine < -1.0f) ? -1.0f : cosine);
+	return acosf(cosine) * (180.0f / 3.14159265f);
+}
+
+size_t writeMesh(const char* path, const SourceMesh* mesh, const WriteOptions* options, QuantizationError* error)
+{
+	/* Vertex layout */
+	std::vector<MeshAttribute> attributes;
+	int stride = 0;
+	bool writeNormals = options->normals && mesh->hasNormals;
+	bool writeTexcoords = options->texcoords && mesh->hasTexcoords;
+	bool packedNormals = options->normalFormat == MESH_FORMAT_S16N || options->normalFormat == MESH_FORMAT_S8N;
+	addAttribute(&attributes, MESH_SEMANTIC_POSITION, options->positionFormat, 3, &stride);
+	if (writeNormals)
+		addAttribute(&attributes, MESH_SEMANTIC_NORMAL, options->normalFormat, packedNormals ? 2 : 3, &stride);
+	if (writeTexcoords)
+		addAttribute(&attributes, MESH_SEMANTIC_TEXCOORD, options->texcoordFormat, 2, &stride);
+	stride = ALIGN_UP(stride, 4);
+
+	//quantized positions are stored relative to the bounding box, mapped into -1..1
+	MeshBounds meshBounds;
+	computeBounds(mesh, NULL, &meshBounds);
+	float positionScale[3] = { 1.0f, 1.0f, 1.0f };
+	float positionBias[3] = { 0.0f, 0.0f, 0.0f };
+	if (options->positionFormat != MESH_FORMAT_F32)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float halfExtent = 0.5f * (meshBounds.max[axis] - meshBounds.min[axis]);
+			positionScale[axis] = (halfExtent > 0.0f) ? halfExtent : 1.0f;
+			positionBias[axis] = meshBounds.center[axis];
+		}
+	}
+
+	QuantizationError worst = { 0.0f, 0.0f, 0.0f };
+	std::vector<unsigned char> vertexData(mesh->vertices.size() * stride, 0);
+	for (size_t i = 0; i < mesh->vertices.size(); i++)
+	{
+		unsigned char* vertex = &vertexData[i * stride];
+		const SourceVertex* source = &mesh->vertices[i];
+		for (size_t a = 0; a < attributes.size(); a++)
+		{
+			float values[3];
+			float decoded[3];
+			if (attributes[a].semantic == MESH_SEMANTIC_POSITION)
+			{
+				for (int axis = 0; axis < 3; axis++)
+					values[axis] = (source->position[axis] - positionBias[axis]) / positionScale[axis];
+				encodeComponents(&attributes[a], values, vertex, decoded);
+				for (int axis = 0; axis < 3; axis++)
+					worst.position = fmaxf(worst.position, fabsf(decoded[axis] * positionScale[axis] + positionBias[axis] - source->position[axis]));
+			}
+			else if (attributes[a].semantic == MESH_SEMANTIC_NORMAL && packedNormals)
+			{
+				int bits = (attributes[a].format == MESH_FORMAT_S16N) ? 16 : 8;
+				int32_t encoded[2];
+				encodeOctahedral(source->normal, bits, encoded);
+				values[0] = snormToFloat(encoded[0], bits);
+				values[1] = snormToFloat(encoded[1], bits);
+				encodeComponents(&attributes[a], values, vertex, decoded);
+				float normal[3];
+				decodeOctahedral(decoded, normal);
+				worst.normal = fmaxf(worst.normal, angleBetween(normal, source->normal));
+			}
+			else if (attributes[a].semantic == MESH_SEMANTIC_NORMAL)
+			{
+				encodeComponents(&attributes[a], source->normal, vertex, decoded);
+				worst.normal = fmaxf(worst.normal, angleBetween(decoded, source->normal));
+			}
+			else if (attributes[a].semantic == MESH_SEMANTIC_TEXCOORD)
+			{
+				encodeComponents(&attributes[a], source->texcoord, vertex, decoded);
+				for (int axis = 0; axis < 2; axis++)
+					worst.texcoord = fmaxf(worst.texcoord, fabsf(decoded[axis] - source->texcoord[axis]));
+			}
+		}
+	}
+	if (error != NULL)
+		*error = worst;
+
+	/* Indices, 16 bit whenever every vertex can be reached with one */
+	MeshIndexFormat indexFormat = (mesh->vertices.size() <= 0x10000) ? MESH_INDEX_16BIT : MESH_INDEX_32BIT;
+	std::vector<MeshSubmesh> submeshes;
+	std::vector<MeshLod> lods;
+	std::vector<unsigned char> indexData;
+	uint32_t indexCount = 0;
+	for (size_t l = 0; l <= mesh->lods.size(); l++)
+	{
+		//LOD 0 is the mesh itself, the rest come from generateLods()
+		const std::vector<SourceSubmesh>& lodSubmeshes = (l == 0) ? mesh->submeshes : mesh->lods[l - 1].submeshes;
+		MeshLod lod;
+		lod.firstSubmesh = (uint32_t)submeshes.size();
+		lod.submeshCount = 0;
+		lod.triangleCount = 0;
+		lod.error = (l == 0) ? 0.0f : mesh->lods[l - 1].error;
+
+		for (size_t s = 0; s < lodSubmeshes.size(); s++)
+		{
+			//a submesh can simplify away entirely
+			const SourceSubmesh* source = &lodSubmeshes[s];
+			if (source->indices.empty())
+				continue;
+
+			MeshSubmesh submesh;
+			memset(&submesh, 0, sizeof(submesh));
+			submesh.firstIndex = indexCount;
+			submesh.indexCount = (uint32_t)source->indices.size();
+			submesh.material = (uint32_t)s;
+			computeBounds(mesh, &source->indices, &submesh.bounds);
+			submeshes.push_back(submesh);
+			lod.submeshCount++;
+			lod.triangleCount += submesh.indexCount / 3;
+
+			for (size_t i = 0; i < source->indices.size(); i++)
+			{
+				uint32_t index = source->indices[i];
+				unsigned char bytes[4];
+				memcpy(bytes, &index, 4);
+				if (indexFormat == MESH_INDEX_16BIT)
+					indexData.insert(indexData.end(), bytes, bytes + 2);
+				else
+					indexData.insert(indexData.end(), bytes, bytes + 4);
+			}
+			indexCount += submesh.indexCount;
+		}
+		if (lod.submeshCount > 0)
+			lods.push_back(lod);
+	}
+
+	if (submeshes.size() > MESH_MAX_SUBMESHES || lods.size() > MESH_MAX_LODS)
+	{
+		fprintf(stderr, "%u submeshes in %u LODs, the format allows %u in %u\n", (unsigned int)submeshes.size(),
+			(unsigned int)lods.size(), MESH_MAX_SUBMESHES, MESH_MAX_LODS);
+		return 0;
+	}
+
+	/* Header and file layout */
+	MeshHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = MESH_MAGIC;
+	header.version = MESH_VERSION;
+	header.vertexStride = (uint16_t)stride;
+	header.attributeCount = (uint8_t)attributes.size();
+	header.indexFormat = (uint8_t)indexFormat;
+	header.vertexCount = (uint32_t)mesh->vertices.size();
+	header.indexCount = indexCount;
+	header.submeshCount = (uint32_t)submeshes.size();
+	header.lodCount = (uint32_t)lods.size();
+	header.attributesOffset = sizeof(MeshHeader);
+	header.submeshesOffset = header.attributesOffset + (uint32_t)(attributes.size() * sizeof(MeshAttribute));
+	header.lodsOffset = header.submeshesOffset + (uint32_t)(submeshes.size() * sizeof(MeshSubmesh));
+	header.vertexDataOffset = ALIGN_UP(header.lodsOffset + (uint32_t)(lods.size() * sizeof(MeshLod)), MESH_BLOB_ALIGNMENT);
+	header.vertexDataSize = (uint32_t)vertexData.size();
+	header.indexDataOffset = ALIGN_UP(header.vertexDataOffset + header.vertexDataSize, MESH_BLOB_ALIGNMENT);
+	header.indexDataSize = (uint32_t)indexData.size();
+	header.fileSize = header.indexDataOffset + header.indexDataSize;
+	memcpy(header.positionScale, positionScale, sizeof(positionScale));
+	memcpy(header.positionBias, positionBias, sizeof(positionBias));
+	header.bounds = meshBounds;
+
+	std::vector<unsigned char> file(header.fileSize, 0);
+	memcpy(&file[0], &header, sizeof(header));
+	memcpy(&file[header.attributesOffset], &attributes[0], attributes.size() * sizeof(MeshAttribute));
+	memcpy(&file[header.submeshesOffset], &submeshes[0], submeshes.size() * sizeof(MeshSubmesh));
+	memcpy(&file[header.lodsOffset], &lods[0], lods.size() * sizeof(MeshLod));
+	if (!vertexData.empty())
+		memcpy(&file[header.vertexDataOffset], &vertexData[0], vertexData.size());
+	if (!indexData.empty())
+		memcpy(&file[header.indexDataOffset], &indexData[0], indexData.size());
+
+	FILE* out = fopen(path, "wb");
+	if (out == NULL)
+	{
+		fprintf(stderr, "Could not create %s\n", path);
+		return 0;
+	}
+	size_t written = fwrite(&file[0], 1, file.size(), out);
+	fclose(out);
+	if (written != file.size())
+	{
+		fprintf(stderr, "Could not write %s\n", path);
+		return 0;
+	}
+	return written;
+}
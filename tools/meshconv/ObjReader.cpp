@@ -0,0 +1,186 @@
+#include "SourceMesh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+
+//one corner of an OBJ face, indices into the position/texcoord/normal lists, -1 when missing
+typedef struct ObjCorner
+{
+	int position;
+	int texcoord;
+	int normal;
+
+	bool operator<(const ObjCorner& other) const
+	{
+		if (position != other.position)
+			return position < other.position;
+		if (texcoord != other.texcoord)
+			return texcoord < other.texcoord;
+		return normal < other.normal;
+	}
+} ObjCorner;
+
+//OBJ indices are 1 based, negative ones count back from the end of the list so far
+static int resolveIndex(const char* text, size_t count)
+{
+	int index = atoi(text);
+	if (index < 0)
+		return (int)count + index;
+	return index - 1;
+}
+
+//parses "v", "v/t", "v//n" or "v/t/n"
+static bool parseCorner(const char* text, size_t positions, size_t texcoords, size_t normals, ObjCorner* corner)
+{
+	corner->position = resolveIndex(text, positions);
+	corner->texcoord = -1;
+	corner->normal = -1;
+
+	const char* slash = strchr(text, '/');
+	if (slash != NULL)
+	{
+		if (slash[1] != '/' && slash[1] != '\0')
+			corner->texcoord = resolveIndex(slash + 1, texcoords);
+		const char* secondSlash = strchr(slash + 1, '/');
+		if (secondSlash != NULL && secondSlash[1] != '\0')
+			corner->normal = resolveIndex(secondSlash + 1, normals);
+	}
+
+	return corner->position >= 0 && corner->position < (int)positions &&
+		corner->texcoord < (int)texcoords && corner->normal < (int)normals;
+}
+
+bool readObj(const char* path, SourceMesh* mesh)
+{
+	FILE* file = fopen(path, "r");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Could not open %s\n", path);
+		return false;
+	}
+
+	std::vector<float> positions;
+	std::vector<float> texcoords;
+	std::vector<float> normals;
+	std::map<ObjCorner, uint32_t> corners;
+
+	mesh->vertices.clear();
+	mesh->submeshes.clear();
+	mesh->hasNormals = false;
+	mesh->hasTexcoords = false;
+
+	SourceSubmesh* current = NULL;
+	std::string currentMaterial = "default";
+	char line[1024];
+	int lineNumber = 0;
+	while (fgets(line, sizeof(line), file))
+	{
+		lineNumber++;
+		char* token = strtok(line, " \t\r\n");
+		if (token == NULL || token[0] == '#')
+			continue;
+
+		if (strcmp(token, "v") == 0 || strcmp(token, "vn") == 0)
+		{
+			std::vector<float>* list = (token[1] == 'n') ? &normals : &positions;
+			for (int i = 0; i < 3; i++)
+			{
+				char* value = strtok(NULL, " \t\r\n");
+				list->push_back(value ? (float)atof(value) : 0.0f);
+			}
+		}
+		else if (strcmp(token, "vt") == 0)
+		{
+			for (int i = 0; i < 2; i++)
+			{
+				char* value = strtok(NULL, " \t\r\n");
+				texcoords.push_back(value ? (float)atof(value) : 0.0f);
+			}
+		}
+		else if (strcmp(token, "usemtl") == 0 || strcmp(token, "o") == 0 || strcmp(token, "g") == 0)
+		{
+			//a new group or material starts a new submesh on its next face
+			if (strcmp(token, "usemtl") == 0)
+			{
+				char* name = strtok(NULL, "\r\n");
+				currentMaterial = name ? name : "default";
+			}
+			current = NULL;
+		}
+		else if (strcmp(token, "f") == 0)
+		{
+			if (current == NULL)
+			{
+				mesh->submeshes.push_back(SourceSubmesh());
+				current = &mesh->submeshes.back();
+				current->material = currentMaterial;
+			}
+
+			std::vector<uint32_t> face;
+			char* cornerText;
+			while ((cornerText = strtok(NULL, " \t\r\n")) != NULL)
+			{
+				ObjCorner corner;
+				if (!parseCorner(cornerText, positions.size() / 3, texcoords.size() / 2, normals.size() / 3, &corner))
+				{
+					fprintf(stderr, "%s:%d: bad face index '%s'\n", path, lineNumber, cornerText);
+					fclose(file);
+					return false;
+				}
+
+				std::map<ObjCorner, uint32_t>::iterator found = corners.find(corner);
+				if (found != corners.end())
+				{
+					face.push_back(found->second);
+					continue;
+				}
+
+				SourceVertex vertex;
+				memset(&vertex, 0, sizeof(vertex));
+				memcpy(vertex.position, &positions[corner.position * 3], sizeof(vertex.position));
+				if (corner.normal >= 0)
+				{
+					memcpy(vertex.normal, &normals[corner.normal * 3], sizeof(vertex.normal));
+					mesh->hasNormals = true;
+				}
+				if (corner.texcoord >= 0)
+				{
+					//OBJ puts v = 0 at the bottom of the image, textures here start at the top row
+					vertex.texcoord[0] = texcoords[corner.texcoord * 2];
+					vertex.texcoord[1] = 1.0f - texcoords[corner.texcoord * 2 + 1];
+					mesh->hasTexcoords = true;
+				}
+
+				uint32_t index = (uint32_t)mesh->vertices.size();
+				mesh->vertices.push_back(vertex);
+				corners.insert(std::make_pair(corner, index));
+				face.push_back(index);
+			}
+
+			//fan triangulate, fine for the convex polygons exporters write
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				current->indices.push_back(face[0]);
+				current->indices.push_back(face[i - 1]);
+				current->indices.push_back(face[i]);
+			}
+		}
+		//everything else (mtllib, s, l, p...) has no effect on the geometry
+	}
+	fclose(file);
+
+	//groups that never got a face
+	for (size_t i = mesh->submeshes.size(); i > 0; i--)
+	{
+		if (mesh->submeshes[i - 1].indices.empty())
+			mesh->submeshes.erase(mesh->submeshes.begin() + (i - 1));
+	}
+	if (mesh->submeshes.empty())
+	{
+		fprintf(stderr, "%s has no faces\n", path);
+		return false;
+	}
+	return true;
+}
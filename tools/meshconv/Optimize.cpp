@@ -0,0 +1,317 @@
+#include "SourceMesh.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+/*----- Vertex cache analysis -----*/
+
+VertexCacheStats analyzeVertexCache(const SourceMesh* mesh, unsigned int cacheSize)
+{
+	//FIFO cache, a vertex is still in it while fewer than cacheSize misses happened since it went in
+	std::vector<uint32_t> insertedAt(mesh->vertices.size(), 0);
+	std::vector<bool> used(mesh->vertices.size(), false);
+	uint32_t misses = 0;
+	uint32_t triangles = 0;
+	uint32_t usedVertices = 0;
+
+	for (size_t s = 0; s < mesh->submeshes.size(); s++)
+	{
+		const std::vector<uint32_t>& indices = mesh->submeshes[s].indices;
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			uint32_t vertex = indices[i];
+			if (!used[vertex])
+			{
+				used[vertex] = true;
+				usedVertices++;
+			}
+			else if (misses - insertedAt[vertex] < cacheSize)
+				continue;
+			misses++;
+			insertedAt[vertex] = misses;
+		}
+		triangles += (uint32_t)(indices.size() / 3);
+	}
+
+	VertexCacheStats stats;
+	stats.transformedVertices = misses;
+	stats.acmr = triangles ? (float)misses / triangles : 0.0f;
+	stats.atvr = usedVertices ? (float)misses / usedVertices : 0.0f;
+	return stats;
+}
+
+/*----- Post transform cache ordering, Tipsify (Sander, Nehab, Barczak 2007) -----*/
+
+typedef struct TriangleAdjacency
+{
+	std::vector<uint32_t> offsets;		//triangles around vertex v are triangles[offsets[v]..offsets[v + 1]]
+	std::vector<uint32_t> triangles;
+} TriangleAdjacency;
+
+static void buildAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount, TriangleAdjacency* adjacency)
+{
+	adjacency->offsets.assign(vertexCount + 1, 0);
+	for (size_t i = 0; i < indices.size(); i++)
+		adjacency->offsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacency->offsets[v + 1] += adjacency->offsets[v];
+
+	std::vector<uint32_t> fill(adjacency->offsets.begin(), adjacency->offsets.end() - 1);
+	adjacency->triangles.resize(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+		adjacency->triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+}
+
+//Reorders the triangles of one index list, returns the triangle index each cluster starts at in clusterStarts.
+//A cluster ends every time the fan runs into a dead end and has to jump somewhere the cache knows nothing about
+static void tipsify(std::vector<uint32_t>* indices, size_t vertexCount, unsigned int cacheSize, std::vector<uint32_t>* clusterStarts)
+{
+	size_t triangleCount = indices->size() / 3;
+	TriangleAdjacency adjacency;
+	buildAdjacency(*indices, vertexCount, &adjacency);
+
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(indices->size());
+	clusterStarts->clear();
+
+	uint32_t time = cacheSize + 1;
+	size_t cursor = 0;
+	//start at the first vertex anything uses
+	int fanVertex = -1;
+	while (cursor < vertexCount && liveTriangles[cursor] == 0)
+		cursor++;
+	if (cursor < vertexCount)
+		fanVertex = (int)cursor;
+	clusterStarts->push_back(0);
+
+	while (fanVertex >= 0)
+	{
+		//emit every remaining triangle around the fan vertex
+		candidates.clear();
+		for (uint32_t a = adjacency.offsets[fanVertex]; a < adjacency.offsets[fanVertex + 1]; a++)
+		{
+			uint32_t triangle = adjacency.triangles[a];
+			if (emitted[triangle])
+				continue;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				uint32_t vertex = (*indices)[triangle * 3 + corner];
+				output.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+				if (time - cacheTime[vertex] > cacheSize)
+				{
+					cacheTime[vertex] = time;
+					time++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		//next fan is the candidate that will still be in the cache by the time its triangles are emitted,
+		//preferring the one that entered the cache first
+		int next = -1;
+		int bestPriority = -1;
+		for (size_t c = 0; c < candidates.size(); c++)
+		{
+			uint32_t vertex = candidates[c];
+			if (liveTriangles[vertex] == 0)
+				continue;
+			int priority = 0;
+			if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+				priority = time - cacheTime[vertex];
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = (int)vertex;
+			}
+		}
+
+		if (next < 0)
+		{
+			//dead end, back track through recently used vertices then fall back to scanning
+			while (!deadEnds.empty() && next < 0)
+			{
+				uint32_t vertex = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTriangles[vertex] > 0)
+					next = (int)vertex;
+			}
+			while (next < 0 && cursor < vertexCount)
+			{
+				if (liveTriangles[cursor] > 0)
+					next = (int)cursor;
+				cursor++;
+			}
+			if (next >= 0 && output.size() / 3 < triangleCount)
+				clusterStarts->push_back((uint32_t)(output.size() / 3));
+		}
+		fanVertex = next;
+	}
+
+	indices->swap(output);
+}
+
+/*----- Overdraw, outward facing clusters first so they occlude the rest -----*/
+
+typedef struct ClusterOrder
+{
+	uint32_t start;
+	uint32_t count;
+	float sortKey;
+
+	bool operator<(const ClusterOrder& other) const
+	{
+		return sortKey > other.sortKey;
+	}
+} ClusterOrder;
+
+static void orderClusters(const SourceMesh* mesh, std::vector<uint32_t>* indices, const std::vector<uint32_t>& clusterStarts)
+{
+	size_t triangleCount = indices->size() / 3;
+	if (clusterStarts.size() < 2)
+		return;
+
+	//area weighted centroid of the whole index list
+	float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+	std::vector<float> areas(triangleCount);
+	std::vector<float> centroids(triangleCount * 3);
+	std::vector<float> normals(triangleCount * 3);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const float* a = mesh->vertices[(*indices)[t * 3]].position;
+		const float* b = mesh->vertices[(*indices)[t * 3 + 1]].position;
+		const float* c = mesh->vertices[(*indices)[t * 3 + 2]].position;
+		float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		float* normal = &normals[t * 3];
+		normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+		normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+		normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+		areas[t] = 0.5f * sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			centroids[t * 3 + axis] = (a[axis] + b[axis] + c[axis]) / 3.0f;
+			meshCentroid[axis] += centroids[t * 3 + axis] * areas[t];
+		}
+		meshArea += areas[t];
+	}
+	if (meshArea > 0.0f)
+	{
+		for (int axis = 0; axis < 3; axis++)
+			meshCentroid[axis] /= meshArea;
+	}
+
+	//how far a cluster sits out along the way it faces, the bigger the more likely it hides something
+	std::vector<ClusterOrder> clusters(clusterStarts.size());
+	for (size_t c = 0; c < clusterStarts.size(); c++)
+	{
+		clusters[c].start = clusterStarts[c];
+		clusters[c].count = (uint32_t)(((c + 1 < clusterStarts.size()) ? clusterStarts[c + 1] : triangleCount) - clusterStarts[c]);
+
+		float centroid[3] = { 0.0f, 0.0f, 0.0f };
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+		float area = 0.0f;
+		for (uint32_t t = clusters[c].start; t < clusters[c].start + clusters[c].count; t++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				centroid[axis] += centroids[t * 3 + axis] * areas[t];
+				//the cross product is already scaled by the area
+				normal[axis] += normals[t * 3 + axis];
+			}
+			area += areas[t];
+		}
+		float sortKey = 0.0f;
+		if (area > 0.0f)
+		{
+			for (int axis = 0; axis < 3; axis++)
+				sortKey += (centroid[axis] / area - meshCentroid[axis]) * normal[axis];
+			float normalLength = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			if (normalLength > 0.0f)
+				sortKey /= normalLength;
+		}
+		clusters[c].sortKey = sortKey;
+	}
+	std::stable_sort(clusters.begin(), clusters.end());
+
+	std::vector<uint32_t> output;
+	output.reserve(indices->size());
+	for (size_t c = 0; c < clusters.size(); c++)
+		output.insert(output.end(), indices->begin() + clusters[c].start * 3, indices->begin() + (clusters[c].start + clusters[c].count) * 3);
+	indices->swap(output);
+}
+
+/*----- Vertex fetch, vertices in the order the indices first use them -----*/
+
+static void remapIndices(std::vector<SourceSubmesh>* submeshes, const SourceMesh* mesh, std::vector<uint32_t>* remap, std::vector<SourceVertex>* vertices)
+{
+	for (size_t s = 0; s < submeshes->size(); s++)
+	{
+		std::vector<uint32_t>& indices = (*submeshes)[s].indices;
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			if ((*remap)[indices[i]] == UINT32_MAX)
+			{
+				(*remap)[indices[i]] = (uint32_t)vertices->size();
+				vertices->push_back(mesh->vertices[indices[i]]);
+			}
+			indices[i] = (*remap)[indices[i]];
+		}
+	}
+}
+
+static uint32_t optimizeVertexFetch(SourceMesh* mesh)
+{
+	//coarser LODs only use vertices LOD 0 does, so LOD 0 decides the order
+	std::vector<uint32_t> remap(mesh->vertices.size(), UINT32_MAX);
+	std::vector<SourceVertex> vertices;
+	vertices.reserve(mesh->vertices.size());
+	remapIndices(&mesh->submeshes, mesh, &remap, &vertices);
+	for (size_t l = 0; l < mesh->lods.size(); l++)
+		remapIndices(&mesh->lods[l].submeshes, mesh, &remap, &vertices);
+
+	uint32_t removed = (uint32_t)(mesh->vertices.size() - vertices.size());
+	mesh->vertices.swap(vertices);
+	return removed;
+}
+
+OptimizeReport optimizeMesh(SourceMesh* mesh, const OptimizeOptions* options)
+{
+	OptimizeReport report;
+	memset(&report, 0, sizeof(report));
+	report.before = analyzeVertexCache(mesh, options->cacheSize);
+
+	for (size_t s = 0; s < mesh->submeshes.size(); s++)
+	{
+		std::vector<uint32_t> clusterStarts;
+		tipsify(&mesh->submeshes[s].indices, mesh->vertices.size(), options->cacheSize, &clusterStarts);
+		if (options->overdraw)
+			orderClusters(mesh, &mesh->submeshes[s].indices, clusterStarts);
+		report.clusters += (uint32_t)clusterStarts.size();
+	}
+	for (size_t l = 0; l < mesh->lods.size(); l++)
+	{
+		for (size_t s = 0; s < mesh->lods[l].submeshes.size(); s++)
+		{
+			std::vector<uint32_t> clusterStarts;
+			tipsify(&mesh->lods[l].submeshes[s].indices, mesh->vertices.size(), options->cacheSize, &clusterStarts);
+			if (options->overdraw)
+				orderClusters(mesh, &mesh->lods[l].submeshes[s].indices, clusterStarts);
+		}
+	}
+	report.unusedVertices = optimizeVertexFetch(mesh);
+
+	report.after = analyzeVertexCache(mesh, options->cacheSize);
+	return report;
+}
@@ -0,0 +1,149 @@
+#include "SourceMesh.h"
+
+#include <string.h>
+#include <math.h>
+
+uint16_t floatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	if (((bits >> 23) & 0xFF) == 0xFF)
+		return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));	//inf or nan
+	if (exponent >= 31)
+		return (uint16_t)(sign | 0x7C00);	//too big, becomes inf
+	if (exponent <= 0)
+	{
+		//denormal or zero, shift the implicit bit in and round to nearest even
+		if (exponent < -10)
+			return (uint16_t)sign;
+		mantissa |= 0x800000;
+		uint32_t shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+			half++;
+		return (uint16_t)(sign | half);
+	}
+
+	uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1FFF;
+	//a carry out of the mantissa bumps the exponent, which is still the right answer
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		half++;
+	return (uint16_t)half;
+}
+
+float halfToFloat(uint16_t half)
+{
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+	uint32_t bits;
+
+	if (exponent == 0)
+	{
+		if (mantissa == 0)
+			bits = sign;
+		else
+		{
+			//renormalise the denormal
+			exponent = 127 - 15 + 1;
+			while ((mantissa & 0x400) == 0)
+			{
+				mantissa <<= 1;
+				exponent--;
+			}
+			bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+		}
+	}
+	else if (exponent == 31)
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+int32_t floatToSnorm(float value, int bits)
+{
+	float maxValue = (float)((1 << (bits - 1)) - 1);
+	if (value > 1.0f)
+		value = 1.0f;
+	if (value < -1.0f)
+		value = -1.0f;
+	return (int32_t)floorf(value * maxValue + 0.5f);
+}
+
+float snormToFloat(int32_t snorm, int bits)
+{
+	//the most negative value maps to -1 as well, same as the GPU
+	float value = snorm / (float)((1 << (bits - 1)) - 1);
+	return (value < -1.0f) ? -1.0f : value;
+}
+
+void decodeOctahedral(const float encoded[2], float normal[3])
+{
+	normal[0] = encoded[0];
+	normal[1] = encoded[1];
+	normal[2] = 1.0f - fabsf(encoded[0]) - fabsf(encoded[1]);
+	float fold = (normal[2] < 0.0f) ? -normal[2] : 0.0f;
+	normal[0] += (normal[0] >= 0.0f) ? -fold : fold;
+	normal[1] += (normal[1] >= 0.0f) ? -fold : fold;
+
+	float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+	for (int i = 0; i < 3; i++)
+		normal[i] /= length;
+}
+
+void encodeOctahedral(const float normal[3], int bits, int32_t encoded[2])
+{
+	//project onto the octahedron, then fold the lower half over the diagonals
+	float sum = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+	if (sum == 0.0f)
+	{
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+	float x = normal[0] / sum;
+	float y = normal[1] / sum;
+	if (normal[2] < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * ((x >= 0.0f) ? 1.0f : -1.0f);
+		float foldedY = (1.0f - fabsf(x)) * ((y >= 0.0f) ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	//plain rounding is up to twice as far off as it needs to be, try the four surrounding codes
+	float maxValue = (float)((1 << (bits - 1)) - 1);
+	int32_t baseX = (int32_t)floorf(x * maxValue);
+	int32_t baseY = (int32_t)floorf(y * maxValue);
+	float bestDot = -2.0f;
+	for (int dy = 0; dy < 2; dy++)
+	{
+		for (int dx = 0; dx < 2; dx++)
+		{
+			int32_t candidate[2] = { baseX + dx, baseY + dy };
+			if (candidate[0] > (int32_t)maxValue || candidate[1] > (int32_t)maxValue)
+				continue;
+			float decodedInput[2] = { snormToFloat(candidate[0], bits), snormToFloat(candidate[1], bits) };
+			float decoded[3];
+			decodeOctahedral(decodedInput, decoded);
+			float dot = decoded[0] * normal[0] + decoded[1] * normal[1] + decoded[2] * normal[2];
+			if (dot > bestDot)
+			{
+				bestDot = dot;
+				encoded[0] = candidate[0];
+				encoded[1] = candidate[1];
+			}
+		}
+	}
+}
@@ -0,0 +1,392 @@
+#include "SourceMesh.h"
+
+#include <math.h>
+#include <string.h>
+#include <map>
+#include <queue>
+
+//Quadric error metric edge collapse (Garland and Heckbert 1997), restricted to half edge
+//collapses so every LOD is a subset of the original vertices and they can all share one vertex blob
+
+//stop making LODs once a pass can't get the triangle count below this fraction of the last one
+#define LOD_MIN_REDUCTION	0.9f
+//a collapse may not turn a triangle further than this, as the cosine between old and new normal
+#define LOD_MIN_NORMAL_DOT	0.2f
+
+//symmetric 4x4 matrix, the upper triangle of the plane outer product sum,
+//and the total area of the planes that went into it
+typedef struct Quadric
+{
+	double a00, a01, a02, a03;
+	double a11, a12, a13;
+	double a22, a23;
+	double a33;
+	double weight;
+} Quadric;
+
+static void quadricAddPlane(Quadric* q, double a, double b, double c, double d, double weight)
+{
+	q->a00 += weight * a * a; q->a01 += weight * a * b; q->a02 += weight * a * c; q->a03 += weight * a * d;
+	q->a11 += weight * b * b; q->a12 += weight * b * c; q->a13 += weight * b * d;
+	q->a22 += weight * c * c; q->a23 += weight * c * d;
+	q->a33 += weight * d * d;
+	q->weight += weight;
+}
+
+static void quadricAdd(Quadric* q, const Quadric* other)
+{
+	q->a00 += other->a00; q->a01 += other->a01; q->a02 += other->a02; q->a03 += other->a03;
+	q->a11 += other->a11; q->a12 += other->a12; q->a13 += other->a13;
+	q->a22 += other->a22; q->a23 += other->a23;
+	q->a33 += other->a33;
+	q->weight += other->weight;
+}
+
+//area weighted mean squared distance from p to the planes in q
+static double quadricError(const Quadric* q, const float p[3])
+{
+	double x = p[0], y = p[1], z = p[2];
+	double error = q->a00 * x * x + 2.0 * q->a01 * x * y + 2.0 * q->a02 * x * z + 2.0 * q->a03 * x +
+		q->a11 * y * y + 2.0 * q->a12 * y * z + 2.0 * q->a13 * y +
+		q->a22 * z * z + 2.0 * q->a23 * z +
+		q->a33;
+	if (error <= 0.0 || q->weight <= 0.0)
+		return 0.0;
+	return error / q->weight;
+}
+
+typedef struct Collapse
+{
+	double cost;
+	uint32_t from;
+	uint32_t to;
+
+	bool operator<(const Collapse& other) const
+	{
+		//std::priority_queue pops the largest, cheapest first is wanted
+		return cost > other.cost;
+	}
+} Collapse;
+
+typedef struct SimplifyTriangle
+{
+	uint32_t corners[3];
+	uint32_t submesh;
+	bool alive;
+} SimplifyTriangle;
+
+typedef struct PositionKey
+{
+	float position[3];
+
+	bool operator<(const PositionKey& other) const
+	{
+		return memcmp(position, other.position, sizeof(position)) < 0;
+	}
+} PositionKey;
+
+class Simplifier
+{
+public:
+	Simplifier(const SourceMesh* mesh, const std::vector<SourceSubmesh>& submeshes);
+	//Collapses edges until at most targetTriangles are left, returns the worst collapse error
+	//as a root mean square distance in model units
+	float simplify(uint32_t targetTriangles);
+	uint32_t getTriangleCount() { return liveTriangles; }
+	void getSubmeshes(std::vector<SourceSubmesh>* submeshes);
+
+private:
+	const SourceMesh* mesh;
+	std::vector<SimplifyTriangle> triangles;
+	std::vector<std::vector<uint32_t> > _vertexTriangles;
+	//vertices sharing a position are welded for topology and error, seams between them are locked
+	std::vector<uint32_t> _positionIds;
+	std::vector<Quadric> _quadrics;		//per position
+	std::vector<bool> _locked;
+	std::vector<bool> _removed;
+	std::priority_queue<Collapse> queue;
+	uint32_t liveTriangles;
+
+	bool hasEdge(uint32_t from, uint32_t to);
+	bool flipsTriangles(uint32_t from, uint32_t to);
+	void pushCollapses(uint32_t vertex);
+	double collapseCost(uint32_t from, uint32_t to);
+};
+
+Simplifier::Simplifier(const SourceMesh* sourceMesh, const std::vector<SourceSubmesh>& submeshes)
+{
+	mesh = sourceMesh;
+	size_t vertexCount = mesh->vertices.size();
+
+	//weld positions
+	std::map<PositionKey, uint32_t> positions;
+	std::vector<uint32_t> verticesAtPosition;
+	_positionIds.resize(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		PositionKey key;
+		memcpy(key.position, mesh->vertices[v].position, sizeof(key.position));
+		std::map<PositionKey, uint32_t>::iterator found = positions.find(key);
+		if (found == positions.end())
+		{
+			found = positions.insert(std::make_pair(key, (uint32_t)positions.size())).first;
+			verticesAtPosition.push_back(0);
+		}
+		_positionIds[v] = found->second;
+	}
+
+	liveTriangles = 0;
+	_vertexTriangles.resize(vertexCount);
+	for (size_t s = 0; s < submeshes.size(); s++)
+	{
+		const std::vector<uint32_t>& indices = submeshes[s].indices;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			SimplifyTriangle triangle;
+			memcpy(triangle.corners, &indices[i], sizeof(triangle.corners));
+			triangle.submesh = (uint32_t)s;
+			triangle.alive = true;
+			for (int c = 0; c < 3; c++)
+				_vertexTriangles[triangle.corners[c]].push_back((uint32_t)triangles.size());
+			triangles.push_back(triangle);
+			liveTriangles++;
+		}
+	}
+
+	//count the vertices actually used at each position, more than one means an attribute seam
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		if (!_vertexTriangles[v].empty())
+			verticesAtPosition[_positionIds[v]]++;
+	}
+
+	//plane quadrics, area weighted so slivers don't dominate
+	_quadrics.assign(positions.size(), Quadric());
+	memset(&_quadrics[0], 0, _quadrics.size() * sizeof(Quadric));
+	for (size_t t = 0; t < triangles.size(); t++)
+	{
+		const float* a = mesh->vertices[triangles[t].corners[0]].position;
+		const float* b = mesh->vertices[triangles[t].corners[1]].position;
+		const float* c = mesh->vertices[triangles[t].corners[2]].position;
+		double ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		double ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		double n[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+		double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length == 0.0)
+			continue;
+		double area = 0.5 * length;
+		n[0] /= length;
+		n[1] /= length;
+		n[2] /= length;
+		double d = -(n[0] * a[0] + n[1] * a[1] + n[2] * a[2]);
+		Quadric plane;
+		memset(&plane, 0, sizeof(plane));
+		quadricAddPlane(&plane, n[0], n[1], n[2], d, area);
+		for (int corner = 0; corner < 3; corner++)
+			quadricAdd(&_quadrics[_positionIds[triangles[t].corners[corner]]], &plane);
+	}
+
+	//open borders and boundaries between submeshes keep their shape, so are locked as well as seams.
+	//an edge is a border when only one triangle of a submesh uses it
+	std::map<std::pair<uint64_t, uint32_t>, uint32_t> edgeUse;
+	for (size_t t = 0; t < triangles.size(); t++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			uint32_t p0 = _positionIds[triangles[t].corners[c]];
+			uint32_t p1 = _positionIds[triangles[t].corners[(c + 1) % 3]];
+			uint64_t edge = (p0 < p1) ? (((uint64_t)p0 << 32) | p1) : (((uint64_t)p1 << 32) | p0);
+			edgeUse[std::make_pair(edge, triangles[t].submesh)]++;
+		}
+	}
+	std::vector<bool> lockedPositions(positions.size(), false);
+	for (std::map<std::pair<uint64_t, uint32_t>, uint32_t>::iterator e = edgeUse.begin(); e != edgeUse.end(); ++e)
+	{
+		if (e->second == 1)
+		{
+			lockedPositions[(uint32_t)(e->first.first >> 32)] = true;
+			lockedPositions[(uint32_t)(e->first.first & 0xFFFFFFFF)] = true;
+		}
+	}
+
+	_locked.resize(vertexCount);
+	_removed.assign(vertexCount, false);
+	for (size_t v = 0; v < vertexCount; v++)
+		_locked[v] = lockedPositions[_positionIds[v]] || verticesAtPosition[_positionIds[v]] > 1;
+
+	for (size_t v = 0; v < vertexCount; v++)
+		pushCollapses((uint32_t)v);
+}
+
+double Simplifier::collapseCost(uint32_t from, uint32_t to)
+{
+	Quadric combined = _quadrics[_positionIds[from]];
+	quadricAdd(&combined, &_quadrics[_positionIds[to]]);
+	return quadricError(&combined, mesh->vertices[to].position);
+}
+
+void Simplifier::pushCollapses(uint32_t vertex)
+{
+	//every edge around vertex, in both directions where the moving end isn't locked
+	for (size_t i = 0; i < _vertexTriangles[vertex].size(); i++)
+	{
+		const SimplifyTriangle* triangle = &triangles[_vertexTriangles[vertex][i]];
+		if (!triangle->alive)
+			continue;
+		for (int c = 0; c < 3; c++)
+		{
+			uint32_t other = triangle->corners[c];
+			if (other == vertex)
+				continue;
+			if (!_locked[vertex])
+			{
+				Collapse collapse = { collapseCost(vertex, other), vertex, other };
+				queue.push(collapse);
+			}
+			if (!_locked[other])
+			{
+				Collapse collapse = { collapseCost(other, vertex), other, vertex };
+				queue.push(collapse);
+			}
+		}
+	}
+}
+
+bool Simplifier::hasEdge(uint32_t from, uint32_t to)
+{
+	for (size_t i = 0; i < _vertexTriangles[from].size(); i++)
+	{
+		const SimplifyTriangle* triangle = &triangles[_vertexTriangles[from][i]];
+		if (triangle->alive && (triangle->corners[0] == to || triangle->corners[1] == to || triangle->corners[2] == to))
+			return true;
+	}
+	return false;
+}
+
+bool Simplifier::flipsTriangles(uint32_t from, uint32_t to)
+{
+	const float* target = mesh->vertices[to].position;
+	for (size_t i = 0; i < _vertexTriangles[from].size(); i++)
+	{
+		const SimplifyTriangle* triangle = &triangles[_vertexTriangles[from][i]];
+		if (!triangle->alive || triangle->corners[0] == to || triangle->corners[1] == to || triangle->corners[2] == to)
+			continue;
+
+		const float* before[3];
+		const float* after[3];
+		for (int c = 0; c < 3; c++)
+		{
+			before[c] = mesh->vertices[triangle->corners[c]].position;
+			after[c] = (triangle->corners[c] == from) ? target : before[c];
+		}
+		float normalBefore[3];
+		float normalAfter[3];
+		faceNormal(before[0], before[1], before[2], normalBefore);
+		faceNormal(after[0], after[1], after[2], normalAfter);
+		float dot = normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2];
+		if (dot < LOD_MIN_NORMAL_DOT)
+			return true;
+	}
+	return false;
+}
+
+float Simplifier::simplify(uint32_t targetTriangles)
+{
+	double worstCost = 0.0;
+	while (liveTriangles > targetTriangles && !queue.empty())
+	{
+		Collapse collapse = queue.top();
+		queue.pop();
+		if (_removed[collapse.from] || _removed[collapse.to] || !hasEdge(collapse.from, collapse.to))
+			continue;
+
+		//costs only grow as quadrics merge, a stale entry is pushed back with its current cost
+		double cost = collapseCost(collapse.from, collapse.to);
+		if (cost > collapse.cost * 1.0001 + 1e-12)
+		{
+			collapse.cost = cost;
+			queue.push(collapse);
+			continue;
+		}
+		if (flipsTriangles(collapse.from, collapse.to))
+			continue;
+
+		//move every triangle of from over to to, the ones along the edge collapse to nothing
+		for (size_t i = 0; i < _vertexTriangles[collapse.from].size(); i++)
+		{
+			uint32_t t = _vertexTriangles[collapse.from][i];
+			SimplifyTriangle* triangle = &triangles[t];
+			if (!triangle->alive)
+				continue;
+			for (int c = 0; c < 3; c++)
+			{
+				if (triangle->corners[c] == collapse.from)
+					triangle->corners[c] = collapse.to;
+			}
+			uint32_t p0 = _positionIds[triangle->corners[0]];
+			uint32_t p1 = _positionIds[triangle->corners[1]];
+			uint32_t p2 = _positionIds[triangle->corners[2]];
+			if (p0 == p1 || p1 == p2 || p0 == p2)
+			{
+				triangle->alive = false;
+				liveTriangles--;
+			}
+			else
+				_vertexTriangles[collapse.to].push_back(t);
+		}
+		_vertexTriangles[collapse.from].clear();
+		_removed[collapse.from] = true;
+		quadricAdd(&_quadrics[_positionIds[collapse.to]], &_quadrics[_positionIds[collapse.from]]);
+		if (cost > worstCost)
+			worstCost = cost;
+
+		pushCollapses(collapse.to);
+	}
+
+	return (float)sqrt(worstCost);
+}
+
+void Simplifier::getSubmeshes(std::vector<SourceSubmesh>* submeshes)
+{
+	for (size_t s = 0; s < submeshes->size(); s++)
+		(*submeshes)[s].indices.clear();
+	for (size_t t = 0; t < triangles.size(); t++)
+	{
+		if (!triangles[t].alive)
+			continue;
+		std::vector<uint32_t>& indices = (*submeshes)[triangles[t].submesh].indices;
+		indices.insert(indices.end(), triangles[t].corners, triangles[t].corners + 3);
+	}
+}
+
+unsigned int generateLods(SourceMesh* mesh, const LodOptions* options)
+{
+	mesh->lods.clear();
+	if (options->count <= 1)
+		return 1;
+
+	uint32_t triangleCount = 0;
+	for (size_t s = 0; s < mesh->submeshes.size(); s++)
+		triangleCount += (uint32_t)(mesh->submeshes[s].indices.size() / 3);
+
+	//each LOD is simplified from the one before, so the errors only ever grow
+	Simplifier simplifier(mesh, mesh->submeshes);
+	float error = 0.0f;
+	for (unsigned int lod = 1; lod < options->count && lod < MESH_MAX_LODS; lod++)
+	{
+		uint32_t target = (uint32_t)(triangleCount * options->ratio);
+		float lodError = simplifier.simplify(target);
+		uint32_t reached = simplifier.getTriangleCount();
+		if (reached == 0 || reached > triangleCount * LOD_MIN_REDUCTION)
+			break;
+
+		error = (lodError > error) ? lodError : error;
+		SourceLod sourceLod;
+		sourceLod.submeshes = mesh->submeshes;
+		simplifier.getSubmeshes(&sourceLod.submeshes);
+		sourceLod.error = error;
+		mesh->lods.push_back(sourceLod);
+		triangleCount = reached;
+	}
+	return (unsigned int)mesh->lods.size() + 1;
+}
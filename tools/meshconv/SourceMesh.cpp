@@ -0,0 +1,65 @@
+#include "SourceMesh.h"
+
+#include <math.h>
+#include <string.h>
+
+void faceNormal(const float a[3], const float b[3], const float c[3], float normal[3])
+{
+	float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+	normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+	normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+
+	float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+	if (length > 0.0f)
+	{
+		normal[0] /= length;
+		normal[1] /= length;
+		normal[2] /= length;
+	}
+}
+
+void generateNormals(SourceMesh* mesh)
+{
+	for (size_t i = 0; i < mesh->vertices.size(); i++)
+		memset(mesh->vertices[i].normal, 0, sizeof(mesh->vertices[i].normal));
+
+	for (size_t s = 0; s < mesh->submeshes.size(); s++)
+	{
+		const std::vector<uint32_t>& indices = mesh->submeshes[s].indices;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			SourceVertex* corners[3] = { &mesh->vertices[indices[i]], &mesh->vertices[indices[i + 1]], &mesh->vertices[indices[i + 2]] };
+			const float* a = corners[0]->position;
+			const float* b = corners[1]->position;
+			const float* c = corners[2]->position;
+
+			//the unnormalized cross product is twice the area, which is the weighting we want
+			float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float cross[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+			for (int corner = 0; corner < 3; corner++)
+			{
+				corners[corner]->normal[0] += cross[0];
+				corners[corner]->normal[1] += cross[1];
+				corners[corner]->normal[2] += cross[2];
+			}
+		}
+	}
+
+	for (size_t i = 0; i < mesh->vertices.size(); i++)
+	{
+		float* normal = mesh->vertices[i].normal;
+		float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length > 0.0f)
+		{
+			normal[0] /= length;
+			normal[1] /= length;
+			normal[2] /= length;
+		}
+		else
+			normal[2] = 1.0f;
+	}
+	mesh->hasNormals = true;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+//----------------------------------------------
+// In memory mesh the importers fill in and the writer turns into a .mesh file.
+// Vertices are fully expanded, one per unique position/normal/texcoord combination
+//-----------------------------------------------
+
+#include "MeshFormat.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+typedef struct SourceVertex
+{
+	float position[3];
+	float normal[3];
+	float texcoord[2];
+} SourceVertex;
+
+typedef struct SourceSubmesh
+{
+	std::string material;
+	std::vector<uint32_t> indices;		//triangle list into SourceMesh::vertices
+} SourceSubmesh;
+
+//A coarser level of detail, same submeshes as the full mesh with fewer triangles over the same vertices
+typedef struct SourceLod
+{
+	std::vector<SourceSubmesh> submeshes;
+	float error;		//root mean square distance from the full detail surface
+} SourceLod;
+
+typedef struct SourceMesh
+{
+	std::vector<SourceVertex> vertices;
+	std::vector<SourceSubmesh> submeshes;
+	std::vector<SourceLod> lods;		//LOD 1 onwards, LOD 0 is submeshes
+	bool hasNormals;
+	bool hasTexcoords;
+} SourceMesh;
+
+/*----- Helpers -----*/
+//Unit normal of the triangle a, b, c wound counter clockwise
+void faceNormal(const float a[3], const float b[3], const float c[3], float normal[3]);
+//Smooth vertex normals, the area weighted average of the faces around each vertex
+void generateNormals(SourceMesh* mesh);
+
+/*----- Importers, return false and print why on failure -----*/
+//Wavefront OBJ, polygons are fan triangulated, usemtl/o/g start a new submesh
+bool readObj(const char* path, SourceMesh* mesh);
+//Binary or ASCII STL, one submesh with face normals
+bool readStl(const char* path, SourceMesh* mesh);
+
+/*----- Level of detail -----*/
+typedef struct LodOptions
+{
+	unsigned int count;		//levels to make including the full detail one
+	float ratio;			//each level aims for this fraction of the previous one's triangles
+} LodOptions;
+
+//Fills mesh->lods by edge collapse, stops early once the mesh won't simplify any further.
+//Returns the number of levels including LOD 0
+unsigned int generateLods(SourceMesh* mesh, const LodOptions* options);
+
+/*----- Optimization -----*/
+//Post transform cache behaviour of the index order, simulated with a FIFO of cacheSize vertices
+typedef struct VertexCacheStats
+{
+	uint32_t transformedVertices;
+	float acmr;		//average cache miss ratio, transformed vertices per triangle, 0.5 is the ideal
+	float atvr;		//average transformed vertex ratio, transformed per referenced vertex, 1.0 is the ideal
+} VertexCacheStats;
+
+typedef struct OptimizeOptions
+{
+	unsigned int cacheSize;		//post transform cache entries to optimize for
+	bool overdraw;				//reorder the cache friendly clusters so outward facing ones draw first
+} OptimizeOptions;
+
+typedef struct OptimizeReport
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+	uint32_t clusters;			//triangle runs the overdraw pass could move around
+	uint32_t unusedVertices;	//dropped because no index referenced them
+} OptimizeReport;
+
+VertexCacheStats analyzeVertexCache(const SourceMesh* mesh, unsigned int cacheSize);
+//Reorders triangles for the vertex cache (Tipsify), then clusters for overdraw, then
+//vertices into first use order for fetch locality. Submeshes and LODs keep their own triangles,
+//the report covers LOD 0
+OptimizeReport optimizeMesh(SourceMesh* mesh, const OptimizeOptions* options);
+
+/*----- Quantization -----*/
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t half);
+//Signed normalized integer with the given number of bits, value is clamped to -1..1
+int32_t floatToSnorm(float value, int bits);
+float snormToFloat(int32_t snorm, int bits);
+//Octahedral encoding of a unit vector, quantized to bits per component and picked to
+//minimise the angle to the original rather than just rounded
+void encodeOctahedral(const float normal[3], int bits, int32_t encoded[2]);
+void decodeOctahedral(const float encoded[2], float normal[3]);
+
+/*----- Writer -----*/
+typedef struct WriteOptions
+{
+	bool normals;							//write normals if the source has them
+	bool texcoords;							//write texcoords if the source has them
+	MeshAttributeFormat positionFormat;		//F32, F16 or S16N
+	MeshAttributeFormat normalFormat;		//F32, or S16N/S8N for octahedral packing
+	MeshAttributeFormat texcoordFormat;		//F32 or F16
+} WriteOptions;
+
+//Worst case error the quantization introduced, measured by decoding what was written
+typedef struct QuantizationError
+{
+	float position;		//in model units
+	float normal;		//in degrees
+	float texcoord;
+} QuantizationError;
+
+//Writes a .mesh file, returns the number of bytes written or 0 on failure
+size_t writeMesh(const char* path, const SourceMesh* mesh, const WriteOptions* options, QuantizationError* error);
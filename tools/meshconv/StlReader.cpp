@@ -0,0 +1,132 @@
+#include "SourceMesh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+
+//vertices are shared when both the position and the face normal match, so flat faces stay flat
+typedef struct StlKey
+{
+	float values[6];
+
+	bool operator<(const StlKey& other) const
+	{
+		return memcmp(values, other.values, sizeof(values)) < 0;
+	}
+} StlKey;
+
+static void addTriangle(SourceMesh* mesh, std::map<StlKey, uint32_t>* shared, const float fileNormal[3], const float corners[9])
+{
+	//plenty of exporters leave the normal as zero, work it out from the winding instead
+	float normal[3] = { fileNormal[0], fileNormal[1], fileNormal[2] };
+	if (normal[0] == 0.0f && normal[1] == 0.0f && normal[2] == 0.0f)
+		faceNormal(&corners[0], &corners[3], &corners[6], normal);
+
+	for (int i = 0; i < 3; i++)
+	{
+		StlKey key;
+		memcpy(key.values, &corners[i * 3], 3 * sizeof(float));
+		memcpy(key.values + 3, normal, 3 * sizeof(float));
+
+		std::map<StlKey, uint32_t>::iterator found = shared->find(key);
+		if (found != shared->end())
+		{
+			mesh->submeshes[0].indices.push_back(found->second);
+			continue;
+		}
+
+		SourceVertex vertex;
+		memset(&vertex, 0, sizeof(vertex));
+		memcpy(vertex.position, &corners[i * 3], sizeof(vertex.position));
+		memcpy(vertex.normal, normal, sizeof(vertex.normal));
+
+		uint32_t index = (uint32_t)mesh->vertices.size();
+		mesh->vertices.push_back(vertex);
+		shared->insert(std::make_pair(key, index));
+		mesh->submeshes[0].indices.push_back(index);
+	}
+}
+
+bool readStl(const char* path, SourceMesh* mesh)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Could not open %s\n", path);
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	mesh->vertices.clear();
+	mesh->submeshes.assign(1, SourceSubmesh());
+	mesh->submeshes[0].material = "default";
+	mesh->hasNormals = true;
+	mesh->hasTexcoords = false;
+	std::map<StlKey, uint32_t> shared;
+
+	//ASCII files start with "solid" too, so the size is what tells them apart
+	unsigned char binaryHeader[84];
+	uint32_t triangleCount = 0;
+	bool binary = false;
+	if (fileSize >= 84 && fread(binaryHeader, 1, 84, file) == 84)
+	{
+		memcpy(&triangleCount, binaryHeader + 80, sizeof(triangleCount));
+		binary = (fileSize == 84 + (long)triangleCount * 50);
+	}
+
+	if (binary)
+	{
+		for (uint32_t i = 0; i < triangleCount; i++)
+		{
+			//normal, three corners and a 16 bit attribute count nobody uses
+			unsigned char record[50];
+			if (fread(record, 1, 50, file) != 50)
+			{
+				fprintf(stderr, "%s is truncated\n", path);
+				fclose(file);
+				return false;
+			}
+			float values[12];
+			memcpy(values, record, sizeof(values));
+			addTriangle(mesh, &shared, values, values + 3);
+		}
+	}
+	else
+	{
+		fseek(file, 0, SEEK_SET);
+		char line[512];
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+		float corners[9];
+		int corner = 0;
+		while (fgets(line, sizeof(line), file))
+		{
+			char* text = line;
+			while (*text == ' ' || *text == '\t')
+				text++;
+
+			if (strncmp(text, "facet normal", 12) == 0)
+			{
+				sscanf(text + 12, "%f %f %f", &normal[0], &normal[1], &normal[2]);
+				corner = 0;
+			}
+			else if (strncmp(text, "vertex", 6) == 0 && corner < 3)
+			{
+				sscanf(text + 6, "%f %f %f", &corners[corner * 3], &corners[corner * 3 + 1], &corners[corner * 3 + 2]);
+				corner++;
+			}
+			else if (strncmp(text, "endfacet", 8) == 0 && corner == 3)
+				addTriangle(mesh, &shared, normal, corners);
+		}
+	}
+	fclose(file);
+
+	if (mesh->submeshes[0].indices.empty())
+	{
+		fprintf(stderr, "%s has no triangles\n", path);
+		return false;
+	}
+	return true;
+}
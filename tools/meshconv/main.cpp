@@ -0,0 +1,255 @@
+//----------------------------------------------
+// meshconv
+// Converts OBJ and STL files into the .mesh format the Mesh class loads
+//
+// usage: meshconv [options] input.obj|input.stl output.mesh
+//-----------------------------------------------
+
+#include "SourceMesh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+//post transform cache size the reordering targets, small enough to also do well on bigger caches
+#define DEFAULT_CACHE_SIZE	16
+#define DEFAULT_LOD_RATIO	0.5f
+
+static void printUsage()
+{
+	printf("usage: meshconv [options] input.obj|input.stl output.mesh\n");
+	printf("options:\n");
+	printf("  --no-normals       drop normals\n");
+	printf("  --no-texcoords     drop texture coordinates\n");
+	printf("  --smooth-normals   replace the source normals with smooth ones, generated anyway when the source has none\n");
+	printf("  --positions=f32|f16|s16n   position format, quantized ones are stored relative to the bounds\n");
+	printf("  --normals=f32|oct16|oct8   normal format, oct packs the unit vector into two components\n");
+	printf("  --texcoords=f32|f16        texture coordinate format\n");
+	printf("  --quantize                 shorthand for --positions=s16n --normals=oct16 --texcoords=f16\n");
+	printf("  --lods=N           generate N levels of detail including the full one, at most %u\n", MESH_MAX_LODS);
+	printf("  --lod-ratio=R      triangle fraction each LOD keeps of the one before, default %.2f\n", DEFAULT_LOD_RATIO);
+	printf("  --no-optimize      keep the source triangle and vertex order\n");
+	printf("  --no-overdraw      optimize for the vertex cache only, skip the overdraw cluster sort\n");
+	printf("  --cache-size=N     post transform cache entries to optimize for, default %u\n", DEFAULT_CACHE_SIZE);
+}
+
+//value of a --name=value option, NULL when arg is not that option
+static const char* optionValue(const char* arg, const char* name)
+{
+	size_t length = strlen(name);
+	if (strncmp(arg, name, length) == 0 && arg[length] == '=')
+		return arg + length + 1;
+	return NULL;
+}
+
+static bool parseFormat(const char* value, const char* const* names, const MeshAttributeFormat* formats, int count, MeshAttributeFormat* format)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (strcmp(value, names[i]) == 0)
+		{
+			*format = formats[i];
+			return true;
+		}
+	}
+	fprintf(stderr, "Unknown format %s\n", value);
+	return false;
+}
+
+static const char* formatName(MeshAttributeFormat format, bool normal)
+{
+	switch (format)
+	{
+	case MESH_FORMAT_F16:
+		return "f16";
+	case MESH_FORMAT_S16N:
+		return normal ? "oct16" : "s16n";
+	case MESH_FORMAT_S8N:
+		return normal ? "oct8" : "s8n";
+	case MESH_FORMAT_U8N:
+		return "u8n";
+	default:
+		return "f32";
+	}
+}
+
+static bool hasExtension(const char* path, const char* extension)
+{
+	size_t length = strlen(path);
+	size_t extensionLength = strlen(extension);
+	return length >= extensionLength && strcasecmp(path + length - extensionLength, extension) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+	WriteOptions options;
+	options.normals = true;
+	options.texcoords = true;
+	options.positionFormat = MESH_FORMAT_F32;
+	options.normalFormat = MESH_FORMAT_F32;
+	options.texcoordFormat = MESH_FORMAT_F32;
+	bool smoothNormals = false;
+	bool optimize = true;
+	OptimizeOptions optimizeOptions;
+	optimizeOptions.cacheSize = DEFAULT_CACHE_SIZE;
+	optimizeOptions.overdraw = true;
+	LodOptions lodOptions;
+	lodOptions.count = 1;
+	lodOptions.ratio = DEFAULT_LOD_RATIO;
+
+	static const char* positionNames[] = { "f32", "f16", "s16n" };
+	static const MeshAttributeFormat positionFormats[] = { MESH_FORMAT_F32, MESH_FORMAT_F16, MESH_FORMAT_S16N };
+	static const char* normalNames[] = { "f32", "oct16", "oct8" };
+	static const MeshAttributeFormat normalFormats[] = { MESH_FORMAT_F32, MESH_FORMAT_S16N, MESH_FORMAT_S8N };
+	static const char* texcoordNames[] = { "f32", "f16" };
+	static const MeshAttributeFormat texcoordFormats[] = { MESH_FORMAT_F32, MESH_FORMAT_F16 };
+
+	const char* inputPath = NULL;
+	const char* outputPath = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--no-normals") == 0)
+			options.normals = false;
+		else if (strcmp(argv[i], "--no-texcoords") == 0)
+			options.texcoords = false;
+		else if (strcmp(argv[i], "--smooth-normals") == 0)
+			smoothNormals = true;
+		else if (strcmp(argv[i], "--quantize") == 0)
+		{
+			options.positionFormat = MESH_FORMAT_S16N;
+			options.normalFormat = MESH_FORMAT_S16N;
+			options.texcoordFormat = MESH_FORMAT_F16;
+		}
+		else if (strcmp(argv[i], "--no-optimize") == 0)
+			optimize = false;
+		else if (strcmp(argv[i], "--no-overdraw") == 0)
+			optimizeOptions.overdraw = false;
+		else if (optionValue(argv[i], "--cache-size"))
+		{
+			optimizeOptions.cacheSize = (unsigned int)atoi(optionValue(argv[i], "--cache-size"));
+			if (optimizeOptions.cacheSize < 3)
+			{
+				fprintf(stderr, "Cache size has to be at least 3\n");
+				return 1;
+			}
+		}
+		else if (optionValue(argv[i], "--lods"))
+		{
+			lodOptions.count = (unsigned int)atoi(optionValue(argv[i], "--lods"));
+			if (lodOptions.count < 1 || lodOptions.count > MESH_MAX_LODS)
+			{
+				fprintf(stderr, "LOD count has to be 1 to %u\n", MESH_MAX_LODS);
+				return 1;
+			}
+		}
+		else if (optionValue(argv[i], "--lod-ratio"))
+		{
+			lodOptions.ratio = (float)atof(optionValue(argv[i], "--lod-ratio"));
+			if (lodOptions.ratio <= 0.0f || lodOptions.ratio >= 1.0f)
+			{
+				fprintf(stderr, "LOD ratio has to be between 0 and 1\n");
+				return 1;
+			}
+		}
+		else if (optionValue(argv[i], "--positions"))
+		{
+			if (!parseFormat(optionValue(argv[i], "--positions"), positionNames, positionFormats, 3, &options.positionFormat))
+				return 1;
+		}
+		else if (optionValue(argv[i], "--normals"))
+		{
+			if (!parseFormat(optionValue(argv[i], "--normals"), normalNames, normalFormats, 3, &options.normalFormat))
+				return 1;
+		}
+		else if (optionValue(argv[i], "--texcoords"))
+		{
+			if (!parseFormat(optionValue(argv[i], "--texcoords"), texcoordNames, texcoordFormats, 2, &options.texcoordFormat))
+				return 1;
+		}
+		else if (argv[i][0] == '-')
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			printUsage();
+			return 1;
+		}
+		else if (inputPath == NULL)
+			inputPath = argv[i];
+		else if (outputPath == NULL)
+			outputPath = argv[i];
+	}
+	if (inputPath == NULL || outputPath == NULL)
+	{
+		printUsage();
+		return 1;
+	}
+
+	SourceMesh mesh;
+	bool imported = false;
+	if (hasExtension(inputPath, ".obj"))
+		imported = readObj(inputPath, &mesh);
+	else if (hasExtension(inputPath, ".stl"))
+		imported = readStl(inputPath, &mesh);
+	else
+		fprintf(stderr, "Don't know how to read %s, expected .obj or .stl\n", inputPath);
+	if (!imported)
+		return 1;
+
+	if (options.normals && (smoothNormals || !mesh.hasNormals))
+		generateNormals(&mesh);
+
+	//simplify before optimizing so the LODs get reordered too
+	if (lodOptions.count > 1)
+		generateLods(&mesh, &lodOptions);
+
+	OptimizeReport optimizeReport;
+	memset(&optimizeReport, 0, sizeof(optimizeReport));
+	if (optimize)
+		optimizeReport = optimizeMesh(&mesh, &optimizeOptions);
+
+	size_t triangles = 0;
+	for (size_t i = 0; i < mesh.submeshes.size(); i++)
+		triangles += mesh.submeshes[i].indices.size() / 3;
+
+	QuantizationError error;
+	size_t fileSize = writeMesh(outputPath, &mesh, &options, &error);
+	if (fileSize == 0)
+		return 1;
+
+	printf("%s: %u vertices, %u triangles, %u submeshes, %u bytes\n", outputPath, (unsigned int)mesh.vertices.size(),
+		(unsigned int)triangles, (unsigned int)mesh.submeshes.size(), (unsigned int)fileSize);
+	for (size_t i = 0; i < mesh.submeshes.size(); i++)
+		printf("  submesh %u: material %s, %u triangles\n", (unsigned int)i, mesh.submeshes[i].material.c_str(),
+			(unsigned int)(mesh.submeshes[i].indices.size() / 3));
+	for (size_t l = 0; l < mesh.lods.size(); l++)
+	{
+		size_t lodTriangles = 0;
+		for (size_t i = 0; i < mesh.lods[l].submeshes.size(); i++)
+			lodTriangles += mesh.lods[l].submeshes[i].indices.size() / 3;
+		printf("  LOD %u: %u triangles (%.1f%%), error %g\n", (unsigned int)(l + 1), (unsigned int)lodTriangles,
+			100.0 * lodTriangles / triangles, mesh.lods[l].error);
+	}
+	if (lodOptions.count > 1 && mesh.lods.size() + 1 < lodOptions.count)
+		printf("  only %u of %u LODs, the mesh would not simplify further\n", (unsigned int)mesh.lods.size() + 1, lodOptions.count);
+	printf("  %s indices\n", (mesh.vertices.size() <= 0x10000) ? "16 bit" : "32 bit");
+	if (optimize)
+	{
+		printf("  vertex cache (%u entries): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u clusters",
+			optimizeOptions.cacheSize, optimizeReport.before.acmr, optimizeReport.after.acmr,
+			optimizeReport.before.atvr, optimizeReport.after.atvr, optimizeReport.clusters);
+		if (optimizeReport.unusedVertices > 0)
+			printf(", %u unused vertices dropped", optimizeReport.unusedVertices);
+		printf("\n");
+	}
+	else
+	{
+		VertexCacheStats stats = analyzeVertexCache(&mesh, optimizeOptions.cacheSize);
+		printf("  vertex cache (%u entries): ACMR %.3f, ATVR %.3f\n", optimizeOptions.cacheSize, stats.acmr, stats.atvr);
+	}
+	printf("  positions %s, max error %g\n", formatName(options.positionFormat, false), error.position);
+	if (options.normals)
+		printf("  normals %s, max error %.3f degrees\n", formatName(options.normalFormat, true), error.normal);
+	if (options.texcoords && mesh.hasTexcoords)
+		printf("  texcoords %s, max error %g\n", formatName(options.texcoordFormat, false), error.texcoord);
+	return 0;
+}
@@ -0,0 +1,106 @@
+#include "Lz4Compress.h"
+
+#include <string.h>
+#include <vector>
+
+#define HASH_BITS		14
+//the format needs the last match to start 12 bytes from the end and the last 5 bytes to be literals
+#define MATCH_LIMIT		12
+#define LAST_LITERALS	5
+#define MIN_MATCH		4
+#define MAX_OFFSET		65535
+
+static uint32_t read32(const uint8_t* data)
+{
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static uint32_t hash(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+//the 4 bit token field holds up to 15, the rest follows in bytes of 255 and a final one
+static uint8_t* writeLength(uint8_t* out, uint32_t length)
+{
+	while (length >= 255)
+	{
+		*out++ = 255;
+		length -= 255;
+	}
+	*out++ = (uint8_t)length;
+	return out;
+}
+
+static uint8_t* writeSequence(uint8_t* out, const uint8_t* literals, uint32_t literalLength, uint32_t offset, uint32_t matchLength)
+{
+	uint8_t* token = out++;
+	*token = (uint8_t)(((literalLength >= 15) ? 15 : literalLength) << 4);
+	if (literalLength >= 15)
+		out = writeLength(out, literalLength - 15);
+	memcpy(out, literals, literalLength);
+	out += literalLength;
+
+	//the literal only sequence at the end has no match
+	if (matchLength == 0)
+		return out;
+
+	*out++ = (uint8_t)offset;
+	*out++ = (uint8_t)(offset >> 8);
+	uint32_t extra = matchLength - MIN_MATCH;
+	*token |= (uint8_t)((extra >= 15) ? 15 : extra);
+	if (extra >= 15)
+		out = writeLength(out, extra - 15);
+	return out;
+}
+
+uint32_t lz4Compress(const uint8_t* source, uint32_t sourceSize, uint8_t* destination)
+{
+	uint8_t* out = destination;
+	uint32_t anchor = 0;
+
+	if (sourceSize > MATCH_LIMIT)
+	{
+		//positions + 1 so 0 can mean empty
+		std::vector<uint32_t> table(1 << HASH_BITS, 0);
+		uint32_t matchLimit = sourceSize - MATCH_LIMIT;
+		uint32_t position = 0;
+		while (position < matchLimit)
+		{
+			uint32_t sequence = read32(source + position);
+			uint32_t slot = hash(sequence);
+			uint32_t candidate = table[slot];
+			table[slot] = position + 1;
+			if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || read32(source + candidate - 1) != sequence)
+			{
+				position++;
+				continue;
+			}
+			uint32_t match = candidate - 1;
+
+			//extend backwards over literals that also match, then forwards up to the literal tail
+			while (position > anchor && match > 0 && source[position - 1] == source[match - 1])
+			{
+				position--;
+				match--;
+			}
+			uint32_t length = MIN_MATCH;
+			uint32_t maxLength = sourceSize - LAST_LITERALS - position;
+			while (length < maxLength && source[position + length] == source[match + length])
+				length++;
+
+			out = writeSequence(out, source + anchor, position - anchor, position - match, length);
+			position += length;
+			anchor = position;
+
+			//remember a position inside the match too, long runs find their way back quicker
+			if (position - 2 < matchLimit)
+				table[hash(read32(source + position - 2))] = position - 2 + 1;
+		}
+	}
+
+	out = writeSequence(out, source + anchor, sourceSize - anchor, 0, 0);
+	return (uint32_t)(out - destination);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+//----------------------------------------------
+// LZ4 block compression, the counterpart of src/Lz4.cpp.
+// Greedy with a hash table of the last position each 4 byte sequence was seen at,
+// which is what makes LZ4 fast to compress as well as to decompress
+//-----------------------------------------------
+
+#include <stdint.h>
+
+//Compresses source into destination, which must hold STREAM_COMPRESS_BOUND(sourceSize) bytes.
+//Returns the compressed size
+uint32_t lz4Compress(const uint8_t* source, uint32_t sourceSize, uint8_t* destination);
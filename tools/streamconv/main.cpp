@@ -0,0 +1,233 @@
+//----------------------------------------------
+// streamconv
+// Wraps any file in the compressed .lzs format (see StreamFormat.h) the StreamLoader
+// decompresses on its loader thread. Every chunk is decompressed again with the
+// runtime's decoder before the file is written
+//
+// usage: streamconv [options] input output.lzs
+//-----------------------------------------------
+
+#include "Lz4Compress.h"
+#include "Lz4.h"
+#include "StreamFormat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+static void printUsage()
+{
+	printf("usage: streamconv [options] input output.lzs\n");
+	printf("options:\n");
+	printf("  --chunk-size=N     uncompressed bytes per chunk, 4096 to %u, default %u\n", STREAM_CHUNK_SIZE, STREAM_CHUNK_SIZE);
+	printf("  --decompress       turn a .lzs file back into the original\n");
+}
+
+//value of a --name=value option, NULL when arg is not that option
+static const char* optionValue(const char* arg, const char* name)
+{
+	size_t length = strlen(name);
+	if (strncmp(arg, name, length) == 0 && arg[length] == '=')
+		return arg + length + 1;
+	return NULL;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>* bytes)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Could not open %s\n", path);
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	bytes->resize(fileSize > 0 ? (size_t)fileSize : 0);
+	bool read = bytes->empty() || fread(&(*bytes)[0], 1, bytes->size(), file) == bytes->size();
+	fclose(file);
+	if (!read)
+		fprintf(stderr, "Could not read %s\n", path);
+	return read;
+}
+
+static bool writeFile(const char* path, const std::vector<uint8_t>* bytes)
+{
+	FILE* out = fopen(path, "wb");
+	if (out == NULL)
+	{
+		fprintf(stderr, "Could not create %s\n", path);
+		return false;
+	}
+	bool written = bytes->empty() || fwrite(&(*bytes)[0], 1, bytes->size(), out) == bytes->size();
+	fclose(out);
+	if (!written)
+		fprintf(stderr, "Could not write %s\n", path);
+	return written;
+}
+
+//Decodes a whole .lzs file the way StreamLoader does, returns false and prints why if it is malformed
+static bool decompressStream(const std::vector<uint8_t>* file, std::vector<uint8_t>* data)
+{
+	StreamFileHeader header;
+	if (file->size() < sizeof(header))
+	{
+		fprintf(stderr, "Too small to be a .lzs file\n");
+		return false;
+	}
+	memcpy(&header, &(*file)[0], sizeof(header));
+	if (header.magic != STREAM_MAGIC || header.version != STREAM_VERSION || header.chunkSize == 0 || header.chunkSize > STREAM_CHUNK_SIZE)
+	{
+		fprintf(stderr, "Not a version %u .lzs file\n", STREAM_VERSION);
+		return false;
+	}
+
+	size_t offset = sizeof(header) + header.chunkCount * sizeof(uint32_t);
+	if (offset > file->size())
+	{
+		fprintf(stderr, "The chunk table is truncated\n");
+		return false;
+	}
+	data->assign(header.uncompressedSize, 0);
+	uint32_t remaining = header.uncompressedSize;
+	for (uint32_t i = 0; i < header.chunkCount; i++)
+	{
+		uint32_t chunkSize = 0;
+		memcpy(&chunkSize, &(*file)[sizeof(header) + i * sizeof(uint32_t)], sizeof(chunkSize));
+		uint32_t stored = chunkSize & ~STREAM_CHUNK_STORED;
+		uint32_t expected = (remaining < header.chunkSize) ? remaining : header.chunkSize;
+		if (offset + stored > file->size())
+		{
+			fprintf(stderr, "Chunk %u is truncated\n", i);
+			return false;
+		}
+		uint8_t* out = &(*data)[header.uncompressedSize - remaining];
+		if (chunkSize & STREAM_CHUNK_STORED)
+		{
+			if (stored != expected)
+			{
+				fprintf(stderr, "Stored chunk %u is %u bytes, expected %u\n", i, stored, expected);
+				return false;
+			}
+			memcpy(out, &(*file)[offset], stored);
+		}
+		else if (lz4Decompress(&(*file)[offset], stored, out, expected) != (int)expected)
+		{
+			fprintf(stderr, "Chunk %u does not decompress to %u bytes\n", i, expected);
+			return false;
+		}
+		offset += stored;
+		remaining -= expected;
+	}
+	return remaining == 0;
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t chunkSize = STREAM_CHUNK_SIZE;
+	bool decompress = false;
+
+	const char* inputPath = NULL;
+	const char* outputPath = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--decompress") == 0)
+			decompress = true;
+		else if (optionValue(argv[i], "--chunk-size"))
+		{
+			chunkSize = (uint32_t)atoi(optionValue(argv[i], "--chunk-size"));
+			if (chunkSize < 4096 || chunkSize > STREAM_CHUNK_SIZE)
+			{
+				fprintf(stderr, "Chunk size has to be 4096 to %u\n", STREAM_CHUNK_SIZE);
+				return 1;
+			}
+		}
+		else if (argv[i][0] == '-')
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			printUsage();
+			return 1;
+		}
+		else if (inputPath == NULL)
+			inputPath = argv[i];
+		else if (outputPath == NULL)
+			outputPath = argv[i];
+	}
+	if (inputPath == NULL || outputPath == NULL)
+	{
+		printUsage();
+		return 1;
+	}
+
+	std::vector<uint8_t> input;
+	if (!readFile(inputPath, &input))
+		return 1;
+
+	if (decompress)
+	{
+		std::vector<uint8_t> data;
+		if (!decompressStream(&input, &data) || !writeFile(outputPath, &data))
+			return 1;
+		printf("%s: %u bytes\n", outputPath, (unsigned int)data.size());
+		return 0;
+	}
+
+	StreamFileHeader header;
+	header.magic = STREAM_MAGIC;
+	header.version = STREAM_VERSION;
+	header.uncompressedSize = (uint32_t)input.size();
+	header.chunkSize = chunkSize;
+	header.chunkCount = (header.uncompressedSize + chunkSize - 1) / chunkSize;
+
+	clock_t startTime = clock();
+	std::vector<uint32_t> chunkSizes;
+	std::vector<uint8_t> chunks;
+	std::vector<uint8_t> compressed(STREAM_COMPRESS_BOUND(chunkSize));
+	uint32_t storedChunks = 0;
+	for (uint32_t i = 0; i < header.chunkCount; i++)
+	{
+		const uint8_t* chunk = &input[(size_t)i * chunkSize];
+		uint32_t size = (header.uncompressedSize - i * chunkSize < chunkSize) ? header.uncompressedSize - i * chunkSize : chunkSize;
+		uint32_t compressedSize = lz4Compress(chunk, size, &compressed[0]);
+		//incompressible data is cheaper to store than to run through the decoder
+		if (compressedSize >= size)
+		{
+			chunkSizes.push_back(size | STREAM_CHUNK_STORED);
+			chunks.insert(chunks.end(), chunk, chunk + size);
+			storedChunks++;
+		}
+		else
+		{
+			chunkSizes.push_back(compressedSize);
+			chunks.insert(chunks.end(), compressed.begin(), compressed.begin() + compressedSize);
+		}
+	}
+	double compressTime = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+
+	std::vector<uint8_t> file(sizeof(header));
+	memcpy(&file[0], &header, sizeof(header));
+	if (!chunkSizes.empty())
+		file.insert(file.end(), (const uint8_t*)&chunkSizes[0], (const uint8_t*)&chunkSizes[0] + chunkSizes.size() * sizeof(uint32_t));
+	file.insert(file.end(), chunks.begin(), chunks.end());
+
+	//check it round trips before anything ships with it
+	std::vector<uint8_t> check;
+	startTime = clock();
+	if (!decompressStream(&file, &check) || check != input)
+	{
+		fprintf(stderr, "%s did not decompress back to the original, nothing written\n", inputPath);
+		return 1;
+	}
+	double decompressTime = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+	if (!writeFile(outputPath, &file))
+		return 1;
+
+	printf("%s: %u -> %u bytes (%.1f%%), %u chunks of %u, %u stored\n", outputPath, header.uncompressedSize,
+		(unsigned int)file.size(), input.empty() ? 100.0 : 100.0 * file.size() / input.size(), header.chunkCount, chunkSize, storedChunks);
+	printf("  host compress %.1fMB/s, decompress %.1fMB/s\n",
+		(compressTime > 0.0) ? input.size() / (1024.0 * 1024.0) / compressTime : 0.0,
+		(decompressTime > 0.0) ? input.size() / (1024.0 * 1024.0) / decompressTime : 0.0);
+	return 0;
+}
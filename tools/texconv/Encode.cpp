@@ -0,0 +1,485 @@
+#include "SourceImage.h"
+
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+/*----- Swizzling -----*/
+
+//spreads the low 16 bits of value out to the even bits
+static uint32_t spreadBits(uint32_t value)
+{
+	value &= 0xFFFF;
+	value = (value | (value << 8)) & 0x00FF00FF;
+	value = (value | (value << 4)) & 0x0F0F0F0F;
+	value = (value | (value << 2)) & 0x33333333;
+	value = (value | (value << 1)) & 0x55555555;
+	return value;
+}
+
+uint32_t swizzleIndex(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+	//Morton order with x on the even bits inside the square the smaller side makes,
+	//the squares follow each other along the longer side
+	uint32_t side = (width < height) ? width : height;
+	uint32_t squareSize = side * side;
+	uint32_t mask = side - 1;
+	uint32_t square = (width > height) ? x / side : y / side;
+	return square * squareSize + (spreadBits(x & mask) | (spreadBits(y & mask) << 1));
+}
+
+/*----- Uncompressed formats -----*/
+
+static uint32_t quantize(uint8_t value, uint32_t maximum)
+{
+	return (value * maximum + 127) / 255;
+}
+
+static uint8_t expand(uint32_t value, uint32_t bits)
+{
+	//replicating the top bits into the bottom ones maps the maximum to exactly 255
+	uint32_t shifted = value << (8 - bits);
+	return (uint8_t)(shifted | (shifted >> bits));
+}
+
+static void encodeTexel(const uint8_t* rgba, TextureFileFormat format, uint8_t* out)
+{
+	uint16_t packed = 0;
+	switch (format)
+	{
+	case TEXTURE_FILE_RGBA8:
+		memcpy(out, rgba, 4);
+		return;
+	case TEXTURE_FILE_RGB565:
+		packed = (uint16_t)(quantize(rgba[0], 31) | (quantize(rgba[1], 63) << 5) | (quantize(rgba[2], 31) << 11));
+		break;
+	default:
+		packed = (uint16_t)(quantize(rgba[0], 15) | (quantize(rgba[1], 15) << 4) | (quantize(rgba[2], 15) << 8) | (quantize(rgba[3], 15) << 12));
+		break;
+	}
+	out[0] = (uint8_t)packed;
+	out[1] = (uint8_t)(packed >> 8);
+}
+
+static void decodeTexel(const uint8_t* data, TextureFileFormat format, uint8_t* rgba)
+{
+	uint16_t packed = (uint16_t)(data[0] | (data[1] << 8));
+	switch (format)
+	{
+	case TEXTURE_FILE_RGBA8:
+		memcpy(rgba, data, 4);
+		return;
+	case TEXTURE_FILE_RGB565:
+		rgba[0] = expand(packed & 0x1F, 5);
+		rgba[1] = expand((packed >> 5) & 0x3F, 6);
+		rgba[2] = expand(packed >> 11, 5);
+		rgba[3] = 255;
+		return;
+	default:
+		rgba[0] = expand(packed & 0xF, 4);
+		rgba[1] = expand((packed >> 4) & 0xF, 4);
+		rgba[2] = expand((packed >> 8) & 0xF, 4);
+		rgba[3] = expand(packed >> 12, 4);
+		return;
+	}
+}
+
+/*----- Block compression -----*/
+
+//standard BC1 endpoint packing, red in the high bits
+static uint16_t packColor565(const float color[3])
+{
+	uint32_t r = (uint32_t)(fminf(fmaxf(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+	uint32_t g = (uint32_t)(fminf(fmaxf(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+	uint32_t b = (uint32_t)(fminf(fmaxf(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpackColor565(uint16_t packed, int color[3])
+{
+	color[0] = expand(packed >> 11, 5);
+	color[1] = expand((packed >> 5) & 0x3F, 6);
+	color[2] = expand(packed & 0x1F, 5);
+}
+
+//the four colors a BC1 block can pick from, three plus black when color0 <= color1
+static void colorPalette(uint16_t color0, uint16_t color1, int palette[4][3])
+{
+	unpackColor565(color0, palette[0]);
+	unpackColor565(color1, palette[1]);
+	for (int c = 0; c < 3; c++)
+	{
+		if (color0 > color1)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+}
+
+//picks the closest palette entry for every texel, returns the total squared error
+static uint32_t fitIndices(const uint8_t block[64], uint16_t color0, uint16_t color1, uint32_t* indices)
+{
+	int palette[4][3];
+	colorPalette(color0, color1, palette);
+	uint32_t totalError = 0;
+	*indices = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		uint32_t bestError = UINT32_MAX;
+		uint32_t best = 0;
+		for (uint32_t p = 0; p < 4; p++)
+		{
+			int dr = block[i * 4 + 0] - palette[p][0];
+			int dg = block[i * 4 + 1] - palette[p][1];
+			int db = block[i * 4 + 2] - palette[p][2];
+			uint32_t error = (uint32_t)(dr * dr + dg * dg + db * db);
+			if (error < bestError)
+			{
+				bestError = error;
+				best = p;
+			}
+		}
+		*indices |= best << (i * 2);
+		totalError += bestError;
+	}
+	return totalError;
+}
+
+//least squares endpoints for the indices already picked, in four color mode
+static bool refitEndpoints(const uint8_t block[64], uint32_t indices, float start[3], float end[3])
+{
+	static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+	float ax[3] = { 0.0f, 0.0f, 0.0f };
+	float bx[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		float a = weights[(indices >> (i * 2)) & 3];
+		float b = 1.0f - a;
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for (int c = 0; c < 3; c++)
+		{
+			ax[c] += a * block[i * 4 + c];
+			bx[c] += b * block[i * 4 + c];
+		}
+	}
+	float determinant = aa * bb - ab * ab;
+	if (fabsf(determinant) < 1e-6f)
+		return false;
+	for (int c = 0; c < 3; c++)
+	{
+		start[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+		end[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+	}
+	return true;
+}
+
+//puts the endpoints in four color order and remaps the indices to match
+static void orderEndpoints(uint16_t* color0, uint16_t* color1, uint32_t* indices)
+{
+	if (*color0 > *color1)
+		return;
+	if (*color0 == *color1)
+	{
+		//a solid block, every texel is color0 whichever mode it decodes in
+		*indices = 0;
+		return;
+	}
+	uint16_t swap = *color0;
+	*color0 = *color1;
+	*color1 = swap;
+	//0 <-> 1 and 2 <-> 3 is flipping the low bit of every index
+	*indices ^= 0x55555555;
+}
+
+static void encodeColorBlock(const uint8_t block[64], uint8_t out[8])
+{
+	//principal axis of the colors by power iteration on the covariance matrix
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+			mean[c] += block[i * 4 + c] / 16.0f;
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		float r = block[i * 4 + 0] - mean[0];
+		float g = block[i * 4 + 1] - mean[1];
+		float b = block[i * 4 + 2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[3];
+		next[0] = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		next[1] = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		next[2] = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+		float length = fmaxf(fmaxf(fabsf(next[0]), fabsf(next[1])), fabsf(next[2]));
+		if (length < 1e-6f)
+			break;
+		for (int c = 0; c < 3; c++)
+			axis[c] = next[c] / length;
+	}
+
+	//endpoints are the extremes along the axis
+	float minimum = FLT_MAX;
+	float maximum = -FLT_MAX;
+	for (int i = 0; i < 16; i++)
+	{
+		float projected = 0.0f;
+		for (int c = 0; c < 3; c++)
+			projected += (block[i * 4 + c] - mean[c]) * axis[c];
+		minimum = fminf(minimum, projected);
+		maximum = fmaxf(maximum, projected);
+	}
+	float axisLengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	float start[3];
+	float end[3];
+	for (int c = 0; c < 3; c++)
+	{
+		start[c] = mean[c] + axis[c] * maximum / axisLengthSquared;
+		end[c] = mean[c] + axis[c] * minimum / axisLengthSquared;
+	}
+
+	uint16_t color0 = packColor565(start);
+	uint16_t color1 = packColor565(end);
+	if (color0 < color1)
+	{
+		uint16_t swap = color0;
+		color0 = color1;
+		color1 = swap;
+	}
+	uint32_t indices = 0;
+	uint32_t error = fitIndices(block, color0, color1, &indices);
+
+	//one least squares pass usually pulls the endpoints in off the outliers
+	if (color0 != color1 && refitEndpoints(block, indices, start, end))
+	{
+		uint16_t refit0 = packColor565(start);
+		uint16_t refit1 = packColor565(end);
+		if (refit0 < refit1)
+		{
+			uint16_t swap = refit0;
+			refit0 = refit1;
+			refit1 = swap;
+		}
+		uint32_t refitIndices = 0;
+		if (refit0 != refit1 && fitIndices(block, refit0, refit1, &refitIndices) < error)
+		{
+			color0 = refit0;
+			color1 = refit1;
+			indices = refitIndices;
+		}
+	}
+	orderEndpoints(&color0, &color1, &indices);
+
+	out[0] = (uint8_t)color0;
+	out[1] = (uint8_t)(color0 >> 8);
+	out[2] = (uint8_t)color1;
+	out[3] = (uint8_t)(color1 >> 8);
+	for (int i = 0; i < 4; i++)
+		out[4 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+static void decodeColorBlock(const uint8_t in[8], uint8_t block[64])
+{
+	uint16_t color0 = (uint16_t)(in[0] | (in[1] << 8));
+	uint16_t color1 = (uint16_t)(in[2] | (in[3] << 8));
+	uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+	int palette[4][3];
+	colorPalette(color0, color1, palette);
+	for (int i = 0; i < 16; i++)
+	{
+		uint32_t index = (indices >> (i * 2)) & 3;
+		for (int c = 0; c < 3; c++)
+			block[i * 4 + c] = (uint8_t)palette[index][c];
+		block[i * 4 + 3] = 255;
+	}
+}
+
+//the eight alphas a BC3 block can pick from when alpha0 > alpha1
+static void alphaPalette(uint32_t alpha0, uint32_t alpha1, uint32_t palette[8])
+{
+	palette[0] = alpha0;
+	palette[1] = alpha1;
+	if (alpha0 > alpha1)
+	{
+		for (uint32_t i = 1; i < 7; i++)
+			palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+	}
+	else
+	{
+		for (uint32_t i = 1; i < 5; i++)
+			palette[i + 1] = ((5 - i) * alpha0 + i * alpha1) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+static void encodeAlphaBlock(const uint8_t block[64], uint8_t out[8])
+{
+	uint32_t alpha0 = 0;
+	uint32_t alpha1 = 255;
+	for (int i = 0; i < 16; i++)
+	{
+		if (block[i * 4 + 3] > alpha0)
+			alpha0 = block[i * 4 + 3];
+		if (block[i * 4 + 3] < alpha1)
+			alpha1 = block[i * 4 + 3];
+	}
+
+	uint64_t indices = 0;
+	if (alpha0 > alpha1)
+	{
+		uint32_t palette[8];
+		alphaPalette(alpha0, alpha1, palette);
+		for (int i = 0; i < 16; i++)
+		{
+			uint32_t best = 0;
+			int bestError = 256;
+			for (uint32_t p = 0; p < 8; p++)
+			{
+				int error = abs((int)block[i * 4 + 3] - (int)palette[p]);
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= (uint64_t)best << (i * 3);
+		}
+	}
+
+	out[0] = (uint8_t)alpha0;
+	out[1] = (uint8_t)alpha1;
+	for (int i = 0; i < 6; i++)
+		out[2 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+static void decodeAlphaBlock(const uint8_t in[8], uint8_t block[64])
+{
+	uint32_t palette[8];
+	alphaPalette(in[0], in[1], palette);
+	uint64_t indices = 0;
+	for (int i = 0; i < 6; i++)
+		indices |= (uint64_t)in[2 + i] << (i * 8);
+	for (int i = 0; i < 16; i++)
+		block[i * 4 + 3] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+}
+
+/*----- Levels -----*/
+
+void encodeLevel(const SourceImage* level, TextureFileFormat format, TextureLayout layout, std::vector<uint8_t>* data)
+{
+	data->assign(textureLevelSize(format, layout, level->width, level->height), 0);
+	uint32_t unitSize = textureFormatUnitSize(format);
+
+	if (!textureFormatIsCompressed(format))
+	{
+		uint32_t stride = (layout == TEXTURE_LAYOUT_LINEAR) ?
+			(level->width + TEXTURE_LINEAR_STRIDE_ALIGN - 1) & ~(TEXTURE_LINEAR_STRIDE_ALIGN - 1) : level->width;
+		for (uint32_t y = 0; y < level->height; y++)
+		{
+			for (uint32_t x = 0; x < level->width; x++)
+			{
+				uint32_t index = (layout == TEXTURE_LAYOUT_LINEAR) ? y * stride + x : swizzleIndex(x, y, level->width, level->height);
+				encodeTexel(&level->rgba[((size_t)y * level->width + x) * 4], format, &(*data)[(size_t)index * unitSize]);
+			}
+		}
+		return;
+	}
+
+	//levels smaller than a block still take a whole one, the texels are repeated to fill it
+	uint32_t blocksWide = (level->width + 3) / 4;
+	uint32_t blocksHigh = (level->height + 3) / 4;
+	for (uint32_t by = 0; by < blocksHigh; by++)
+	{
+		for (uint32_t bx = 0; bx < blocksWide; bx++)
+		{
+			uint8_t block[64];
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				uint32_t x = bx * 4 + (i % 4);
+				uint32_t y = by * 4 + (i / 4);
+				if (x >= level->width)
+					x = level->width - 1;
+				if (y >= level->height)
+					y = level->height - 1;
+				memcpy(&block[i * 4], &level->rgba[((size_t)y * level->width + x) * 4], 4);
+			}
+
+			uint32_t index = (layout == TEXTURE_LAYOUT_LINEAR) ? by * blocksWide + bx : swizzleIndex(bx, by, blocksWide, blocksHigh);
+			uint8_t* out = &(*data)[(size_t)index * unitSize];
+			if (format == TEXTURE_FILE_UBC3)
+			{
+				encodeAlphaBlock(block, out);
+				out += 8;
+			}
+			encodeColorBlock(block, out);
+		}
+	}
+}
+
+void decodeLevel(const uint8_t* data, uint32_t width, uint32_t height, TextureFileFormat format, TextureLayout layout, SourceImage* level)
+{
+	level->width = width;
+	level->height = height;
+	level->rgba.resize((size_t)width * height * 4);
+	level->hasAlpha = false;
+	uint32_t unitSize = textureFormatUnitSize(format);
+
+	if (!textureFormatIsCompressed(format))
+	{
+		uint32_t stride = (layout == TEXTURE_LAYOUT_LINEAR) ?
+			(width + TEXTURE_LINEAR_STRIDE_ALIGN - 1) & ~(TEXTURE_LINEAR_STRIDE_ALIGN - 1) : width;
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				uint32_t index = (layout == TEXTURE_LAYOUT_LINEAR) ? y * stride + x : swizzleIndex(x, y, width, height);
+				decodeTexel(&data[(size_t)index * unitSize], format, &level->rgba[((size_t)y * width + x) * 4]);
+			}
+		}
+		return;
+	}
+
+	uint32_t blocksWide = (width + 3) / 4;
+	uint32_t blocksHigh = (height + 3) / 4;
+	for (uint32_t by = 0; by < blocksHigh; by++)
+	{
+		for (uint32_t bx = 0; bx < blocksWide; bx++)
+		{
+			uint32_t index = (layout == TEXTURE_LAYOUT_LINEAR) ? by * blocksWide + bx : swizzleIndex(bx, by, blocksWide, blocksHigh);
+			const uint8_t* in = &data[(size_t)index * unitSize];
+			uint8_t block[64];
+			if (format == TEXTURE_FILE_UBC3)
+			{
+				decodeColorBlock(in + 8, block);
+				decodeAlphaBlock(in, block);
+			}
+			else
+				decodeColorBlock(in, block);
+
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				uint32_t x = bx * 4 + (i % 4);
+				uint32_t y = by * 4 + (i / 4);
+				if (x < width && y < height)
+					memcpy(&level->rgba[((size_t)y * width + x) * 4], &block[i * 4], 4);
+			}
+		}
+	}
+}
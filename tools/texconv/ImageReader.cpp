@@ -0,0 +1,258 @@
+#include "SourceImage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+static bool readFile(const char* path, std::vector<uint8_t>* bytes)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Could not open %s\n", path);
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	bytes->resize(fileSize > 0 ? (size_t)fileSize : 0);
+	bool read = fileSize > 0 && fread(&(*bytes)[0], 1, bytes->size(), file) == bytes->size();
+	fclose(file);
+	if (!read)
+		fprintf(stderr, "Could not read %s\n", path);
+	return read;
+}
+
+static void checkAlpha(SourceImage* image)
+{
+	image->hasAlpha = false;
+	for (size_t i = 3; i < image->rgba.size(); i += 4)
+	{
+		if (image->rgba[i] != 255)
+		{
+			image->hasAlpha = true;
+			return;
+		}
+	}
+}
+
+/*----- TGA -----*/
+
+//stores one source pixel, TGA keeps color as BGR(A)
+static void storeTgaPixel(const uint8_t* pixel, unsigned int bytesPerPixel, uint8_t* rgba)
+{
+	if (bytesPerPixel == 1)
+	{
+		rgba[0] = rgba[1] = rgba[2] = pixel[0];
+		rgba[3] = 255;
+		return;
+	}
+	rgba[0] = pixel[2];
+	rgba[1] = pixel[1];
+	rgba[2] = pixel[0];
+	rgba[3] = (bytesPerPixel == 4) ? pixel[3] : 255;
+}
+
+bool readTga(const char* path, SourceImage* image)
+{
+	std::vector<uint8_t> bytes;
+	if (!readFile(path, &bytes))
+		return false;
+	if (bytes.size() < 18)
+	{
+		fprintf(stderr, "%s is too small to be a TGA file\n", path);
+		return false;
+	}
+
+	unsigned int idLength = bytes[0];
+	unsigned int colorMapType = bytes[1];
+	unsigned int imageType = bytes[2];
+	unsigned int width = bytes[12] | (bytes[13] << 8);
+	unsigned int height = bytes[14] | (bytes[15] << 8);
+	unsigned int bitsPerPixel = bytes[16];
+	unsigned int descriptor = bytes[17];
+
+	//2 truecolor, 3 grayscale, +8 for run length encoded
+	bool rle = (imageType == 10 || imageType == 11);
+	bool grayscale = (imageType == 3 || imageType == 11);
+	bool supportedDepth = grayscale ? (bitsPerPixel == 8) : (bitsPerPixel == 24 || bitsPerPixel == 32);
+	if (colorMapType != 0 || !(imageType == 2 || imageType == 3 || rle) || !supportedDepth)
+	{
+		fprintf(stderr, "%s: only 24/32 bit truecolor and 8 bit grayscale TGA files are supported (type %u, %u bits)\n",
+			path, imageType, bitsPerPixel);
+		return false;
+	}
+	if (width == 0 || height == 0)
+	{
+		fprintf(stderr, "%s is empty\n", path);
+		return false;
+	}
+
+	unsigned int bytesPerPixel = bitsPerPixel / 8;
+	size_t position = 18 + idLength;
+	size_t pixelCount = (size_t)width * height;
+	std::vector<uint8_t> pixels(pixelCount * bytesPerPixel);
+	if (!rle)
+	{
+		if (position + pixels.size() > bytes.size())
+		{
+			fprintf(stderr, "%s is truncated\n", path);
+			return false;
+		}
+		memcpy(&pixels[0], &bytes[position], pixels.size());
+	}
+	else
+	{
+		//packets are a count byte, high bit set repeats the following pixel, clear copies that many pixels
+		size_t pixel = 0;
+		while (pixel < pixelCount)
+		{
+			if (position >= bytes.size())
+			{
+				fprintf(stderr, "%s is truncated\n", path);
+				return false;
+			}
+			unsigned int header = bytes[position++];
+			size_t count = (header & 0x7F) + 1;
+			bool repeat = (header & 0x80) != 0;
+			size_t packetBytes = repeat ? bytesPerPixel : count * bytesPerPixel;
+			if (pixel + count > pixelCount || position + packetBytes > bytes.size())
+			{
+				fprintf(stderr, "%s has a run past the end of the image\n", path);
+				return false;
+			}
+			for (size_t i = 0; i < count; i++)
+				memcpy(&pixels[(pixel + i) * bytesPerPixel], &bytes[position + (repeat ? 0 : i * bytesPerPixel)], bytesPerPixel);
+			position += packetBytes;
+			pixel += count;
+		}
+	}
+
+	//rows are bottom to top unless descriptor bit 5 says otherwise
+	bool topToBottom = (descriptor & 0x20) != 0;
+	bool rightToLeft = (descriptor & 0x10) != 0;
+	image->width = width;
+	image->height = height;
+	image->rgba.resize(pixelCount * 4);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		unsigned int sourceY = topToBottom ? y : height - 1 - y;
+		for (unsigned int x = 0; x < width; x++)
+		{
+			unsigned int sourceX = rightToLeft ? width - 1 - x : x;
+			storeTgaPixel(&pixels[((size_t)sourceY * width + sourceX) * bytesPerPixel], bytesPerPixel, &image->rgba[((size_t)y * width + x) * 4]);
+		}
+	}
+	checkAlpha(image);
+	return true;
+}
+
+/*----- PNM -----*/
+
+//next whitespace separated token of a header, skipping # comments
+static bool pnmToken(const std::vector<uint8_t>* bytes, size_t* position, char* token, size_t tokenSize)
+{
+	size_t length = 0;
+	while (*position < bytes->size())
+	{
+		char c = (char)(*bytes)[*position];
+		if (c == '#')
+		{
+			while (*position < bytes->size() && (*bytes)[*position] != '\n')
+				(*position)++;
+			continue;
+		}
+		if (isspace((unsigned char)c))
+		{
+			(*position)++;
+			if (length > 0)
+				break;
+			continue;
+		}
+		if (length + 1 < tokenSize)
+			token[length++] = c;
+		(*position)++;
+	}
+	token[length] = '\0';
+	return length > 0;
+}
+
+bool readPnm(const char* path, SourceImage* image)
+{
+	std::vector<uint8_t> bytes;
+	if (!readFile(path, &bytes))
+		return false;
+
+	size_t position = 0;
+	char token[64];
+	if (!pnmToken(&bytes, &position, token, sizeof(token)) || !(strcmp(token, "P5") == 0 || strcmp(token, "P6") == 0 || strcmp(token, "P7") == 0))
+	{
+		fprintf(stderr, "%s is not a binary PPM, PGM or PAM file\n", path);
+		return false;
+	}
+
+	unsigned int width = 0;
+	unsigned int height = 0;
+	unsigned int maxValue = 0;
+	unsigned int channels = 0;
+	if (strcmp(token, "P7") == 0)
+	{
+		//PAM, key value pairs up to ENDHDR
+		while (pnmToken(&bytes, &position, token, sizeof(token)) && strcmp(token, "ENDHDR") != 0)
+		{
+			char value[64];
+			if (!pnmToken(&bytes, &position, value, sizeof(value)))
+				break;
+			if (strcmp(token, "WIDTH") == 0)
+				width = (unsigned int)atoi(value);
+			else if (strcmp(token, "HEIGHT") == 0)
+				height = (unsigned int)atoi(value);
+			else if (strcmp(token, "DEPTH") == 0)
+				channels = (unsigned int)atoi(value);
+			else if (strcmp(token, "MAXVAL") == 0)
+				maxValue = (unsigned int)atoi(value);
+		}
+	}
+	else
+	{
+		channels = (token[1] == '6') ? 3 : 1;
+		if (pnmToken(&bytes, &position, token, sizeof(token)))
+			width = (unsigned int)atoi(token);
+		if (pnmToken(&bytes, &position, token, sizeof(token)))
+			height = (unsigned int)atoi(token);
+		//exactly one whitespace byte follows maxval, pnmToken() already consumed it
+		if (pnmToken(&bytes, &position, token, sizeof(token)))
+			maxValue = (unsigned int)atoi(token);
+	}
+
+	if (width == 0 || height == 0 || maxValue != 255 || channels < 1 || channels > 4)
+	{
+		fprintf(stderr, "%s: only 8 bit images with 1 to 4 channels are supported (%ux%u, maxval %u, %u channels)\n",
+			path, width, height, maxValue, channels);
+		return false;
+	}
+	size_t pixelCount = (size_t)width * height;
+	if (position + pixelCount * channels > bytes.size())
+	{
+		fprintf(stderr, "%s is truncated\n", path);
+		return false;
+	}
+
+	image->width = width;
+	image->height = height;
+	image->rgba.resize(pixelCount * 4);
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		const uint8_t* pixel = &bytes[position + i * channels];
+		uint8_t* rgba = &image->rgba[i * 4];
+		//1 gray, 2 gray and alpha, 3 RGB, 4 RGBA
+		bool color = (channels >= 3);
+		rgba[0] = pixel[0];
+		rgba[1] = color ? pixel[1] : pixel[0];
+		rgba[2] = color ? pixel[2] : pixel[0];
+		rgba[3] = (channels == 2 || channels == 4) ? pixel[channels - 1] : 255;
+	}
+	checkAlpha(image);
+	return true;
+}
@@ -0,0 +1,91 @@
+#include "SourceImage.h"
+
+#include <math.h>
+
+static float srgbToLinear(float value)
+{
+	return (value <= 0.04045f) ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float value)
+{
+	return (value <= 0.0031308f) ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+static uint8_t toByte(float value)
+{
+	if (value <= 0.0f)
+		return 0;
+	if (value >= 1.0f)
+		return 255;
+	return (uint8_t)(value * 255.0f + 0.5f);
+}
+
+//halves each side that is over 1, an odd source column or row is folded into the last texel
+static void downsample(const SourceImage* source, const float* decoded, bool linearData, SourceImage* level)
+{
+	level->width = (source->width > 1) ? source->width / 2 : 1;
+	level->height = (source->height > 1) ? source->height / 2 : 1;
+	level->rgba.resize((size_t)level->width * level->height * 4);
+	level->hasAlpha = source->hasAlpha;
+
+	for (uint32_t y = 0; y < level->height; y++)
+	{
+		uint32_t y0 = (source->height > 1) ? y * 2 : 0;
+		uint32_t y1 = (y == level->height - 1) ? source->height : y0 + 2;
+		for (uint32_t x = 0; x < level->width; x++)
+		{
+			uint32_t x0 = (source->width > 1) ? x * 2 : 0;
+			uint32_t x1 = (x == level->width - 1) ? source->width : x0 + 2;
+
+			//colors are weighted by alpha so transparent texels don't bleed their color into the edges
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			float weight = 0.0f;
+			unsigned int count = 0;
+			for (uint32_t sy = y0; sy < y1; sy++)
+			{
+				for (uint32_t sx = x0; sx < x1; sx++)
+				{
+					const float* texel = &decoded[((size_t)sy * source->width + sx) * 4];
+					float alpha = source->hasAlpha ? texel[3] : 1.0f;
+					for (int c = 0; c < 3; c++)
+						sum[c] += texel[c] * alpha;
+					sum[3] += texel[3];
+					weight += alpha;
+					count++;
+				}
+			}
+
+			uint8_t* out = &level->rgba[((size_t)y * level->width + x) * 4];
+			for (int c = 0; c < 3; c++)
+			{
+				float value = (weight > 0.0f) ? sum[c] / weight : 0.0f;
+				out[c] = toByte(linearData ? value : linearToSrgb(value));
+			}
+			out[3] = toByte(sum[3] / count);
+		}
+	}
+}
+
+void generateMips(const SourceImage* image, bool linearData, unsigned int maxLevels, std::vector<SourceImage>* levels)
+{
+	levels->clear();
+	levels->push_back(*image);
+
+	std::vector<float> decoded;
+	while (levels->size() < maxLevels && (levels->back().width > 1 || levels->back().height > 1))
+	{
+		//each level is made from the one before, converted to linear light first
+		const SourceImage* source = &levels->back();
+		decoded.resize(source->rgba.size());
+		for (size_t i = 0; i < source->rgba.size(); i++)
+		{
+			float value = source->rgba[i] / 255.0f;
+			decoded[i] = (linearData || (i % 4) == 3) ? value : srgbToLinear(value);
+		}
+
+		SourceImage level;
+		downsample(source, &decoded[0], linearData, &level);
+		levels->push_back(level);
+	}
+}
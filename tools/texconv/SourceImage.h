@@ -0,0 +1,50 @@
+#pragma once
+
+//----------------------------------------------
+// In memory image the readers fill in and the encoders turn into a .tex file.
+// Always 8 bit RGBA, rows top to bottom, whatever the source stored
+//-----------------------------------------------
+
+#include "TextureFormat.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+typedef struct SourceImage
+{
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint8_t> rgba;		//width * height * 4
+	bool hasAlpha;					//the source had an alpha channel with something other than 255 in it
+} SourceImage;
+
+/*----- Readers, return false and print why on failure -----*/
+//Truecolor or grayscale TGA, uncompressed or RLE
+bool readTga(const char* path, SourceImage* image);
+//Binary PPM (P6), PGM (P5) or PAM (P7) with a maxval of 255
+bool readPnm(const char* path, SourceImage* image);
+
+/*----- Mipmaps -----*/
+//Box filters the chain down to 1x1, levels[0] is the image itself.
+//Color data is averaged in linear light unless linearData says it already is linear (normal maps, masks)
+void generateMips(const SourceImage* image, bool linearData, unsigned int maxLevels, std::vector<SourceImage>* levels);
+
+/*----- Encoding -----*/
+//One level in the file's format and layout, textureLevelSize() bytes
+void encodeLevel(const SourceImage* level, TextureFileFormat format, TextureLayout layout, std::vector<uint8_t>* data);
+//Decodes what encodeLevel() wrote back into RGBA, to measure what the format lost
+void decodeLevel(const uint8_t* data, uint32_t width, uint32_t height, TextureFileFormat format, TextureLayout layout, SourceImage* level);
+//Index of the texel (or block) x, y in a swizzled width x height level
+uint32_t swizzleIndex(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+/*----- Writer -----*/
+//Error of level 0 after encoding
+typedef struct EncodeError
+{
+	float rmse;			//root mean square over RGBA, in 0..255 units
+	float psnr;			//in dB, infinite when the encoding is lossless
+} EncodeError;
+
+//Writes a .tex file with every level, returns the number of bytes written or 0 on failure
+size_t writeTexture(const char* path, const std::vector<SourceImage>* levels, TextureFileFormat format, TextureLayout layout, EncodeError* error);
@@ -0,0 +1,78 @@
+#include "SourceImage.h"
+#include "TextureFormat.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define ALIGN_UP(value, align)	(((value) + ((align) - 1)) & ~((align) - 1))
+
+//compares level 0 with what the GPU will sample after encoding, only the channels the format keeps count
+static EncodeError measureError(const SourceImage* source, const uint8_t* data, TextureFileFormat format, TextureLayout layout)
+{
+	SourceImage decoded;
+	decodeLevel(data, source->width, source->height, format, layout, &decoded);
+
+	int channels = (format == TEXTURE_FILE_RGB565 || format == TEXTURE_FILE_UBC1) ? 3 : 4;
+	double squaredError = 0.0;
+	for (size_t i = 0; i < source->rgba.size(); i++)
+	{
+		if ((int)(i % 4) >= channels)
+			continue;
+		double difference = (double)source->rgba[i] - decoded.rgba[i];
+		squaredError += difference * difference;
+	}
+	double meanSquared = squaredError / ((double)source->width * source->height * channels);
+
+	EncodeError error;
+	error.rmse = (float)sqrt(meanSquared);
+	error.psnr = (meanSquared > 0.0) ? (float)(10.0 * log10(255.0 * 255.0 / meanSquared)) : INFINITY;
+	return error;
+}
+
+size_t writeTexture(const char* path, const std::vector<SourceImage>* levels, TextureFileFormat format, TextureLayout layout, EncodeError* error)
+{
+	TextureHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = TEXTURE_MAGIC;
+	header.version = TEXTURE_VERSION;
+	header.width = (uint16_t)(*levels)[0].width;
+	header.height = (uint16_t)(*levels)[0].height;
+	header.format = (uint8_t)format;
+	header.layout = (uint8_t)layout;
+	header.mipCount = (uint8_t)levels->size();
+	header.dataOffset = ALIGN_UP((uint32_t)sizeof(TextureHeader), TEXTURE_DATA_ALIGNMENT);
+
+	//levels are packed back to back, the runtime checks every offset against textureLevelSize()
+	std::vector<uint8_t> data;
+	std::vector<uint8_t> level;
+	for (size_t i = 0; i < levels->size(); i++)
+	{
+		encodeLevel(&(*levels)[i], format, layout, &level);
+		header._levelOffsets[i] = (uint32_t)data.size();
+		if (i == 0 && error != NULL)
+			*error = measureError(&(*levels)[0], &level[0], format, layout);
+		data.insert(data.end(), level.begin(), level.end());
+	}
+	header.dataSize = (uint32_t)data.size();
+	header.fileSize = header.dataOffset + header.dataSize;
+
+	std::vector<uint8_t> file(header.fileSize, 0);
+	memcpy(&file[0], &header, sizeof(header));
+	memcpy(&file[header.dataOffset], &data[0], data.size());
+
+	FILE* out = fopen(path, "wb");
+	if (out == NULL)
+	{
+		fprintf(stderr, "Could not create %s\n", path);
+		return 0;
+	}
+	size_t written = fwrite(&file[0], 1, file.size(), out);
+	fclose(out);
+	if (written != file.size())
+	{
+		fprintf(stderr, "Could not write %s\n", path);
+		return 0;
+	}
+	return written;
+}
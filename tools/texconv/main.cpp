@@ -0,0 +1,157 @@
+//----------------------------------------------
+// texconv
+// Converts TGA and PPM/PGM/PAM images into the .tex format the Texture class loads,
+// encoded, mipmapped and swizzled ahead of time so the Vita only has to copy them
+//
+// usage: texconv [options] input.tga|input.ppm output.tex
+//-----------------------------------------------
+
+#include "SourceImage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char* _formatNames[NUMBER_OF_TEXTURE_FILE_FORMATS] = { "rgba8", "rgb565", "rgba4444", "bc1", "bc3" };
+
+static void printUsage()
+{
+	printf("usage: texconv [options] input.tga|input.ppm|input.pgm|input.pam output.tex\n");
+	printf("options:\n");
+	printf("  --format=rgba8|rgb565|rgba4444|bc1|bc3   texel format, default bc1 for opaque images and bc3 otherwise\n");
+	printf("  --no-mips          only write the full size level\n");
+	printf("  --mips=N           write at most N levels including the full size one\n");
+	printf("  --linear-data      the texels aren't sRGB colors (normal maps, masks), filter them as they are\n");
+	printf("  --linear           row major instead of swizzled, needed for sizes that aren't a power of two.\n");
+	printf("                     Uncompressed formats only and no mipmaps, it samples slower\n");
+}
+
+//value of a --name=value option, NULL when arg is not that option
+static const char* optionValue(const char* arg, const char* name)
+{
+	size_t length = strlen(name);
+	if (strncmp(arg, name, length) == 0 && arg[length] == '=')
+		return arg + length + 1;
+	return NULL;
+}
+
+static bool hasExtension(const char* path, const char* extension)
+{
+	size_t length = strlen(path);
+	size_t extensionLength = strlen(extension);
+	return length >= extensionLength && strcasecmp(path + length - extensionLength, extension) == 0;
+}
+
+static bool isPowerOfTwo(uint32_t value)
+{
+	return (value & (value - 1)) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+	int format = -1;
+	unsigned int maxLevels = TEXTURE_MAX_MIPS;
+	bool linearData = false;
+	TextureLayout layout = TEXTURE_LAYOUT_SWIZZLED;
+
+	const char* inputPath = NULL;
+	const char* outputPath = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--no-mips") == 0)
+			maxLevels = 1;
+		else if (strcmp(argv[i], "--linear-data") == 0)
+			linearData = true;
+		else if (strcmp(argv[i], "--linear") == 0)
+			layout = TEXTURE_LAYOUT_LINEAR;
+		else if (optionValue(argv[i], "--mips"))
+		{
+			maxLevels = (unsigned int)atoi(optionValue(argv[i], "--mips"));
+			if (maxLevels < 1 || maxLevels > TEXTURE_MAX_MIPS)
+			{
+				fprintf(stderr, "Mip level count has to be 1 to %u\n", TEXTURE_MAX_MIPS);
+				return 1;
+			}
+		}
+		else if (optionValue(argv[i], "--format"))
+		{
+			const char* value = optionValue(argv[i], "--format");
+			for (int f = 0; f < NUMBER_OF_TEXTURE_FILE_FORMATS; f++)
+			{
+				if (strcmp(value, _formatNames[f]) == 0)
+					format = f;
+			}
+			if (format < 0)
+			{
+				fprintf(stderr, "Unknown format %s\n", value);
+				return 1;
+			}
+		}
+		else if (argv[i][0] == '-')
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			printUsage();
+			return 1;
+		}
+		else if (inputPath == NULL)
+			inputPath = argv[i];
+		else if (outputPath == NULL)
+			outputPath = argv[i];
+	}
+	if (inputPath == NULL || outputPath == NULL)
+	{
+		printUsage();
+		return 1;
+	}
+
+	SourceImage image;
+	bool imported = false;
+	if (hasExtension(inputPath, ".tga"))
+		imported = readTga(inputPath, &image);
+	else if (hasExtension(inputPath, ".ppm") || hasExtension(inputPath, ".pgm") || hasExtension(inputPath, ".pam") || hasExtension(inputPath, ".pnm"))
+		imported = readPnm(inputPath, &image);
+	else
+		fprintf(stderr, "Don't know how to read %s, expected .tga, .ppm, .pgm or .pam\n", inputPath);
+	if (!imported)
+		return 1;
+
+	if (image.width > TEXTURE_MAX_SIZE || image.height > TEXTURE_MAX_SIZE)
+	{
+		fprintf(stderr, "%s is %ux%u, textures can be at most %u on a side\n", inputPath, image.width, image.height, TEXTURE_MAX_SIZE);
+		return 1;
+	}
+	if (format < 0)
+		format = image.hasAlpha ? TEXTURE_FILE_UBC3 : TEXTURE_FILE_UBC1;
+	if (layout == TEXTURE_LAYOUT_SWIZZLED && !(isPowerOfTwo(image.width) && isPowerOfTwo(image.height)))
+	{
+		fprintf(stderr, "%s is %ux%u, swizzled textures have to be a power of two on both sides, use --linear\n",
+			inputPath, image.width, image.height);
+		return 1;
+	}
+	if (layout == TEXTURE_LAYOUT_LINEAR)
+	{
+		if (textureFormatIsCompressed(format))
+		{
+			fprintf(stderr, "Linear textures have to use an uncompressed format\n");
+			return 1;
+		}
+		maxLevels = 1;
+	}
+	if ((format == TEXTURE_FILE_UBC1 || format == TEXTURE_FILE_RGB565) && image.hasAlpha)
+		printf("Note: %s has alpha, %s drops it\n", inputPath, _formatNames[format]);
+
+	std::vector<SourceImage> levels;
+	generateMips(&image, linearData, maxLevels, &levels);
+
+	EncodeError error;
+	size_t fileSize = writeTexture(outputPath, &levels, (TextureFileFormat)format, layout, &error);
+	if (fileSize == 0)
+		return 1;
+
+	printf("%s: %ux%u %s, %s, %u mip levels, %u bytes\n", outputPath, image.width, image.height, _formatNames[format],
+		(layout == TEXTURE_LAYOUT_LINEAR) ? "linear" : "swizzled", (unsigned int)levels.size(), (unsigned int)fileSize);
+	printf("  %.2f bits per texel, level 0 RMSE %.3f, PSNR %.2f dB\n",
+		textureLevelSize(format, layout, image.width, image.height) * 8.0 / ((double)image.width * image.height), error.rmse, error.psnr);
+	return 0;
+}